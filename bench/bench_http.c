@@ -0,0 +1,505 @@
+// clang-format off
+#include <getopt.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "dbmanager_conf.h"
+#include "src/http_client.h"
+#include "src/key.h"
+#include "src/macro.h"
+#include "src/wire.h"
+#include "src/wire_client.h"
+// clang-format on
+
+#define DEFAULT_BASE_URL "http://localhost:" STR_HELPER(HTTP_PORT)
+#define DEFAULT_CLIENTS 16
+#define DEFAULT_DURATION 10
+#define DEFAULT_WIRE_ADDRESS "localhost:" STR_HELPER(WIRE_PORT)
+#define DEFAULT_PIPELINE 32
+
+typedef struct bench_op {
+  char *url;
+  char *operation;
+  char *table;
+  char *data;
+  char *where;
+  int clients;
+  int duration;
+  bool json_body;
+  bool binary;  // 使用二进制协议
+  int pipeline; // 每个压测线程同时在途的请求数，HTTP 大于 1 时使用异步接口
+  bool usage;
+} bench_op_t;
+
+// 流水线中一个在途请求
+typedef struct {
+  uint32_t id;
+  double begin;
+  bool used;
+} inflight_t;
+
+// 单个压测线程的统计
+typedef struct bench_worker {
+  pthread_t thread;
+  const bench_op_t *op;
+  double deadline;
+  unsigned long long ops;
+  unsigned long long errors;
+  unsigned long long not_modified; // 服务端以 304 确认缓存仍然有效的 READ
+  double *latencies; // 单位：微秒
+  size_t num_latencies;
+  size_t cap_latencies;
+} bench_worker_t;
+
+/**
+ * @brief 获取单调时钟（秒）
+ *
+ * @return double 秒
+ */
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 输出 usage
+ *
+ * @param program_name 程序名
+ */
+static void print_usage(const char *program_name) {
+  printf("Usage:   %s [options]\n", program_name);
+  printf("Version: %s\n", OHNO_VERSION);
+  printf("Options:\n");
+  printf("  --help, -h        Show this help message\n");
+  printf("  --url=URL         HTTP server URL (default: %s)\n", DEFAULT_BASE_URL);
+  printf("                    unix:PATH connects through a Unix socket\n");
+  printf("  --op=OPERATION    Operation to issue: read, create, update or delete\n");
+  printf("                    (default: read)\n");
+  printf("  --table=TABLE     Table name\n");
+  printf("  --data=DATA       Data for create and update operations\n");
+  printf("  --where=WHERE     Condition for read, update and delete operations\n");
+  printf("  --clients=N       Concurrent client threads (default: %d)\n", DEFAULT_CLIENTS);
+  printf("  --duration=SEC    Benchmark duration in seconds (default: %d)\n", DEFAULT_DURATION);
+  printf("  --body=ENC        Request body encoding: form or json (default: form)\n");
+  printf("  --protocol=P      Protocol: http or binary (default: http)\n");
+  printf("                    binary connects to HOST:PORT (default: %s)\n",
+         DEFAULT_WIRE_ADDRESS);
+  printf("  --pipeline=N      Requests in flight per client (default: %d for binary, 1 for http)\n",
+         DEFAULT_PIPELINE);
+  printf("                    http above 1 uses the asynchronous client API\n");
+}
+
+/**
+ * @brief 操作是否带 data（create 和 update）
+ *
+ * @param op 命令行参数
+ * @return bool 带 data
+ */
+static bool op_has_data(const bench_op_t *op) {
+  return strcmp(op->operation, KEY_OP_CREATE) == 0 || strcmp(op->operation, KEY_OP_UPDATE) == 0;
+}
+
+/**
+ * @brief 解析命令行参数
+ *
+ * @param argc 命令行个数
+ * @param argv 命令行选项
+ * @param op 结构体保存命令行参数
+ * @return int 成功（0）；失败（-1）
+ */
+static int parse_command(int argc, char **argv, bench_op_t *op) {
+  op->url = NULL;
+  op->operation = KEY_OP_READ;
+  op->table = NULL;
+  op->data = NULL;
+  op->where = NULL;
+  op->clients = DEFAULT_CLIENTS;
+  op->duration = DEFAULT_DURATION;
+  op->json_body = false;
+  op->binary = false;
+  op->pipeline = 0;
+  op->usage = false;
+
+  static struct option long_options[] = {
+      {"help", no_argument, 0, 'h'},          {"url", required_argument, 0, 'u'},
+      {"op", required_argument, 0, 'o'},      {"table", required_argument, 0, 't'},
+      {"data", required_argument, 0, 'd'},    {"where", required_argument, 0, 'w'},
+      {"clients", required_argument, 0, 'c'}, {"duration", required_argument, 0, 'D'},
+      {"body", required_argument, 0, 'b'},    {"protocol", required_argument, 0, 'p'},
+      {"pipeline", required_argument, 0, 'P'}, {0, 0, 0, 0}};
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "hu:o:t:d:w:c:D:b:p:P:", long_options, NULL)) != -1) {
+    switch (opt) {
+    case 'h':
+      op->usage = true;
+      return 0;
+    case 'u':
+      op->url = optarg;
+      break;
+    case 'o':
+      op->operation = optarg;
+      break;
+    case 't':
+      op->table = optarg;
+      break;
+    case 'd':
+      op->data = optarg;
+      break;
+    case 'w':
+      op->where = optarg;
+      break;
+    case 'c':
+      op->clients = atoi(optarg);
+      break;
+    case 'D':
+      op->duration = atoi(optarg);
+      break;
+    case 'b':
+      if (strcmp(optarg, "form") != 0 && strcmp(optarg, "json") != 0) {
+        return -1;
+      }
+      op->json_body = strcmp(optarg, "json") == 0;
+      break;
+    case 'p':
+      if (strcmp(optarg, "http") != 0 && strcmp(optarg, "binary") != 0) {
+        return -1;
+      }
+      op->binary = strcmp(optarg, "binary") == 0;
+      break;
+    case 'P':
+      op->pipeline = atoi(optarg);
+      break;
+    default:
+      return -1;
+    }
+  }
+
+  if (!op->url) {
+    op->url = op->binary ? DEFAULT_WIRE_ADDRESS : DEFAULT_BASE_URL;
+  }
+  if (op->pipeline == 0) {
+    op->pipeline = op->binary ? DEFAULT_PIPELINE : 1;
+  }
+  if (!op->table || op->clients <= 0 || op->duration <= 0 || op->pipeline <= 0) {
+    return -1;
+  }
+  // 只支持 CRUD 四种操作
+  if (!op_has_data(op) && strcmp(op->operation, KEY_OP_READ) != 0 &&
+      strcmp(op->operation, KEY_OP_DELETE) != 0) {
+    return -1;
+  }
+  if (op_has_data(op) && !op->data) {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 记录一次请求延迟
+ *
+ * @param worker 压测线程
+ * @param latency_us 延迟（微秒）
+ */
+static void record_latency(bench_worker_t *worker, double latency_us) {
+  if (worker->num_latencies == worker->cap_latencies) {
+    size_t new_cap = worker->cap_latencies ? worker->cap_latencies * 2 : 4096;
+    double *ptr = realloc(worker->latencies, new_cap * sizeof(double));
+    if (!ptr) {
+      return;
+    }
+    worker->latencies = ptr;
+    worker->cap_latencies = new_cap;
+  }
+  worker->latencies[worker->num_latencies++] = latency_us;
+}
+
+/**
+ * @brief 二进制协议压测：一个连接上保持 pipeline 个请求在途，收到一个响应就补发一个
+ *
+ * @param worker 压测线程
+ */
+static void bench_wire_run(bench_worker_t *worker) {
+  const bench_op_t *op = worker->op;
+  wire_client_t *client = wire_client_init(op->url);
+  inflight_t *slots = calloc(op->pipeline, sizeof(inflight_t));
+  if (!client || !slots) {
+    wire_client_cleanup(client);
+    free(slots);
+    return;
+  }
+
+  const char *data = op_has_data(op) ? op->data : NULL;
+  const char *where = strcmp(op->operation, KEY_OP_CREATE) == 0 ? NULL : op->where;
+  int inflight = 0;
+  for (;;) {
+    // 截止之前补满流水线，之后只收取剩余的响应
+    bool open = now_sec() < worker->deadline;
+    for (int i = 0; open && i < op->pipeline && inflight < op->pipeline; ++i) {
+      if (slots[i].used) {
+        continue;
+      }
+      if (wire_client_send(client, op->operation, op->table, data, where, &slots[i].id) != 0) {
+        break;
+      }
+      slots[i].begin = now_sec();
+      slots[i].used = true;
+      ++inflight;
+    }
+    if (inflight == 0) {
+      break;
+    }
+
+    wire_reply_t reply;
+    if (wire_client_receive(client, &reply) != 0) {
+      worker->errors += inflight;
+      break;
+    }
+    double end = now_sec();
+    for (int i = 0; i < op->pipeline; ++i) {
+      if (slots[i].used && slots[i].id == reply.id) {
+        slots[i].used = false;
+        --inflight;
+        if (reply.status == WIRE_STATUS_OK && strncmp(reply.body, "error:", 6) != 0) {
+          ++worker->ops;
+          record_latency(worker, (end - slots[i].begin) * 1e6);
+        } else {
+          ++worker->errors;
+        }
+        break;
+      }
+    }
+    wire_reply_free(&reply);
+  }
+
+  free(slots);
+  wire_client_cleanup(client);
+}
+
+/**
+ * @brief HTTP 异步压测：保持 pipeline 个请求在途，http_client 在复用的连接上并发执行，
+ *        取到一个结果就补发一个
+ *
+ * @param worker 压测线程
+ */
+static void bench_http_async_run(bench_worker_t *worker) {
+  const bench_op_t *op = worker->op;
+  http_client_t *client = http_client_init(op->url);
+  inflight_t *slots = calloc(op->pipeline, sizeof(inflight_t));
+  if (!client || !slots || http_client_set_max_active(client, op->pipeline) != 0) {
+    http_client_cleanup(client);
+    free(slots);
+    return;
+  }
+  http_client_set_json_body(client, op->json_body);
+
+  const char *data = op_has_data(op) ? op->data : NULL;
+  const char *where = strcmp(op->operation, KEY_OP_CREATE) == 0 ? NULL : op->where;
+  int inflight = 0;
+  for (;;) {
+    bool open = now_sec() < worker->deadline;
+    for (int i = 0; open && i < op->pipeline && inflight < op->pipeline; ++i) {
+      if (slots[i].used) {
+        continue;
+      }
+      if (http_client_submit(client, op->operation, op->table, data, where, NULL, &slots[i],
+                             NULL) != 0) {
+        break;
+      }
+      slots[i].begin = now_sec();
+      slots[i].used = true;
+      ++inflight;
+    }
+    if (inflight == 0) {
+      break;
+    }
+
+    http_completion_t completion;
+    if (http_client_receive(client, HTTP_CLIENT_DEFAULT_TIMEOUT_MS, &completion) != 1) {
+      worker->errors += inflight;
+      break;
+    }
+    inflight_t *slot = completion.userdata;
+    slot->used = false;
+    --inflight;
+    if (completion.result >= 0) {
+      ++worker->ops;
+      worker->not_modified += completion.cached;
+      record_latency(worker, (now_sec() - slot->begin) * 1e6);
+    } else {
+      ++worker->errors;
+    }
+    free(completion.output);
+  }
+
+  free(slots);
+  http_client_cleanup(client);
+}
+
+/**
+ * @brief 压测线程：在截止时间之前循环发起请求
+ *
+ * @param arg 压测线程对象
+ * @return void* NULL
+ */
+static void *bench_worker_run(void *arg) {
+  bench_worker_t *worker = (bench_worker_t *)arg;
+  const bench_op_t *op = worker->op;
+  if (op->binary) {
+    bench_wire_run(worker);
+    return NULL;
+  }
+  if (op->pipeline > 1) {
+    bench_http_async_run(worker);
+    return NULL;
+  }
+
+  http_client_t *client = http_client_init(op->url);
+  if (!client) {
+    return NULL;
+  }
+  http_client_set_json_body(client, op->json_body);
+
+  while (now_sec() < worker->deadline) {
+    char *output = NULL;
+    double begin = now_sec();
+    int ret;
+    if (strcmp(op->operation, KEY_OP_CREATE) == 0) {
+      ret = http_client_create(client, op->table, op->data, &output);
+    } else if (strcmp(op->operation, KEY_OP_UPDATE) == 0) {
+      ret = http_client_update(client, op->table, op->data, op->where, &output);
+    } else if (strcmp(op->operation, KEY_OP_DELETE) == 0) {
+      ret = http_client_delete(client, op->table, op->where, &output);
+    } else {
+      ret = http_client_read(client, op->table, op->where, NULL, &output);
+    }
+    double end = now_sec();
+
+    if (ret >= 0) {
+      ++worker->ops;
+      worker->not_modified += http_client_last_read_cached(client);
+      record_latency(worker, (end - begin) * 1e6);
+    } else {
+      ++worker->errors;
+    }
+    if (output) {
+      free(output);
+    }
+  }
+
+  http_client_cleanup(client);
+  return NULL;
+}
+
+/**
+ * @brief 获取进程已消耗的 CPU 时间（用户态与内核态之和）
+ *
+ * @return double 秒
+ */
+static double cpu_sec(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec +
+         usage.ru_stime.tv_usec / 1e6;
+}
+
+/**
+ * @brief qsort 比较函数
+ */
+static int compare_double(const void *lhs, const void *rhs) {
+  double a = *(const double *)lhs;
+  double b = *(const double *)rhs;
+  return (a > b) - (a < b);
+}
+
+/**
+ * @brief 获取分位数
+ *
+ * @param sorted 已排序的数组
+ * @param num 数组长度
+ * @param quantile 分位（0~1）
+ * @return double 分位数
+ */
+static double percentile(const double *sorted, size_t num, double quantile) {
+  if (num == 0) {
+    return 0;
+  }
+  size_t index = (size_t)(quantile * (num - 1));
+  return sorted[index];
+}
+
+int main(int argc, char **argv) {
+  bench_op_t op;
+  if (parse_command(argc, argv, &op) != 0) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (op.usage) {
+    print_usage(argv[0]);
+    return EXIT_SUCCESS;
+  }
+
+  curl_global_init(CURL_GLOBAL_ALL);
+
+  bench_worker_t *workers = calloc(op.clients, sizeof(bench_worker_t));
+  if (!workers) {
+    return EXIT_FAILURE;
+  }
+
+  double begin = now_sec();
+  double cpu_begin = cpu_sec();
+  for (int i = 0; i < op.clients; ++i) {
+    workers[i].op = &op;
+    workers[i].deadline = begin + op.duration;
+    pthread_create(&workers[i].thread, NULL, bench_worker_run, &workers[i]);
+  }
+
+  unsigned long long total_ops = 0;
+  unsigned long long total_errors = 0;
+  unsigned long long total_not_modified = 0;
+  size_t total_latencies = 0;
+  for (int i = 0; i < op.clients; ++i) {
+    pthread_join(workers[i].thread, NULL);
+    total_ops += workers[i].ops;
+    total_errors += workers[i].errors;
+    total_not_modified += workers[i].not_modified;
+    total_latencies += workers[i].num_latencies;
+  }
+  double elapsed = now_sec() - begin;
+  double cpu = cpu_sec() - cpu_begin;
+
+  double *latencies = malloc((total_latencies + 1) * sizeof(double));
+  size_t offset = 0;
+  for (int i = 0; i < op.clients; ++i) {
+    if (latencies && workers[i].num_latencies > 0) {
+      memcpy(latencies + offset, workers[i].latencies, workers[i].num_latencies * sizeof(double));
+      offset += workers[i].num_latencies;
+    }
+    free(workers[i].latencies);
+  }
+  if (latencies) {
+    qsort(latencies, offset, sizeof(double), compare_double);
+  }
+
+  // 客户端每 CPU 秒完成的操作数，衡量协议本身的开销
+  printf("op=%s protocol=%s body=%s clients=%d pipeline=%d duration=%.2fs ops=%llu errors=%llu "
+         "not_modified=%llu throughput=%.1f ops/s client_cpu=%.2fs ops_per_cpu_sec=%.1f "
+         "p50=%.1fus p90=%.1fus p99=%.1fus\n",
+         op.operation, op.binary ? "binary" : "http", op.json_body ? "json" : "form", op.clients,
+         op.pipeline, elapsed, total_ops, total_errors,
+         total_not_modified, total_ops / elapsed, cpu,
+         cpu > 0 ? total_ops / cpu : 0,
+         latencies ? percentile(latencies, offset, 0.50) : 0,
+         latencies ? percentile(latencies, offset, 0.90) : 0,
+         latencies ? percentile(latencies, offset, 0.99) : 0);
+
+  free(latencies);
+  free(workers);
+  curl_global_cleanup();
+  return total_ops > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# 请在根目录下运行，依次以不同的 HTTP 线程数启动 daemon，观察吞吐随线程数的变化
+# 用法：bench/bench_http_threads.sh [build 目录] [模式: pool|shard]
+
+set -e
+
+BUILD_DIR=${1:-build}
+HTTP_MODE=${2:-pool}
+MYSQL_USER="root"
+MYSQL_PASSWORD="root"
+MYSQL_HOST="localhost"
+MYSQL_PORT="3306"
+POOL_SIZE=8
+CLIENTS=64
+DURATION=10
+
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -e "CREATE DATABASE IF NOT EXISTS mydb;"
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -Dmydb -e "DROP TABLE IF EXISTS bench_users;"
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -Dmydb -e "CREATE TABLE bench_users (id INT AUTO_INCREMENT PRIMARY KEY, name VARCHAR(100), age INT);"
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -Dmydb -e "INSERT INTO bench_users (name, age) VALUES ('Alice', 30), ('Bob', 31), ('Carol', 32);"
+
+for THREADS in 1 2 4 8; do
+  $BUILD_DIR/dbmanager --db-host=$MYSQL_HOST \
+              --db-user=$MYSQL_USER \
+              --db-password=$MYSQL_PASSWORD \
+              --db-name=mydb \
+              --pool-size=$POOL_SIZE \
+              --http-mode=$HTTP_MODE \
+              --http-threads=$THREADS > /dev/null 2>&1 &
+  PID=$!
+  sleep 2
+  echo -n "mode=$HTTP_MODE threads=$THREADS "
+  $BUILD_DIR/bench/bench_http --table=bench_users --where="id=1" --clients=$CLIENTS --duration=$DURATION
+  kill $PID
+  wait $PID 2>/dev/null || true
+done
@@ -0,0 +1,68 @@
+#!/bin/bash
+
+# 请在根目录下运行，daemon 同时监听 TCP 回环和 Unix 域套接字，对比两种传输下小请求的延迟
+# 用法：bench/bench_http_unix.sh [build 目录]
+
+set -e
+
+BUILD_DIR=${1:-build}
+MYSQL_USER="root"
+MYSQL_PASSWORD="root"
+MYSQL_HOST="localhost"
+MYSQL_PORT="3306"
+POOL_SIZE=8
+DURATION=10
+SOCKET_PATH="/tmp/dbmanager_bench.sock"
+TCP_URL="http://localhost:60001"
+UNIX_URL="unix:$SOCKET_PATH"
+
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -e "CREATE DATABASE IF NOT EXISTS mydb;"
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -Dmydb -e "DROP TABLE IF EXISTS bench_users;"
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -Dmydb -e "CREATE TABLE bench_users (id INT AUTO_INCREMENT PRIMARY KEY, name VARCHAR(100), age INT);"
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -Dmydb -e "INSERT INTO bench_users (name, age) VALUES ('Alice', 30), ('Bob', 31), ('Carol', 32);"
+
+$BUILD_DIR/dbmanager --db-host=$MYSQL_HOST \
+            --db-user=$MYSQL_USER \
+            --db-password=$MYSQL_PASSWORD \
+            --db-name=mydb \
+            --pool-size=$POOL_SIZE \
+            --unix-socket=$SOCKET_PATH > /dev/null 2>&1 &
+PID=$!
+trap 'kill $PID; wait $PID 2>/dev/null || true' EXIT
+sleep 2
+
+run() {
+  local url=$1
+  shift
+  $BUILD_DIR/bench/bench_http --url=$url --table=bench_users --duration=$DURATION "$@"
+}
+
+p50() {
+  sed -n 's/.* p50=\([0-9.]*\)us.*/\1/p'
+}
+
+# 单个客户端衡量单请求延迟：同一个小请求先后经 TCP 回环和 Unix 域套接字发送，
+# 最后一行是两者 p50 的差，负数表示 Unix 域套接字更快
+compare() {
+  local tcp unix
+  tcp=$(run $TCP_URL --clients=1 "$@")
+  unix=$(run $UNIX_URL --clients=1 "$@")
+  echo "tcp  $tcp"
+  echo "unix $unix"
+  awk -v t="$(echo "$tcp" | p50)" -v u="$(echo "$unix" | p50)" \
+      'BEGIN { printf "p50 tcp=%.1fus unix=%.1fus delta=%+.1fus (%+.1f%%)\n", t, u, u - t, (u - t) / t * 100 }'
+}
+
+compare --op=read --where="id=1"
+compare --op=create --data="name='Dave',age=33"
+compare --op=update --data="age=age+1" --where="id=2"
+# 不匹配任何行的删除，表中的数据不变，只衡量一次往返
+compare --op=delete --where="id=0"
+
+# 多个客户端衡量吞吐
+for URL in $TCP_URL $UNIX_URL; do
+  echo -n "url=$URL "
+  run $URL --where="id=1" --clients=16
+  echo -n "url=$URL "
+  run $URL --op=create --data="name='Dave',age=33" --clients=16
+done
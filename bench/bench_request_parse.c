@@ -0,0 +1,325 @@
+// clang-format off
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "src/arena.h"
+#include "src/batch.h"
+#include "src/json_escape.h"
+#include "src/json_request.h"
+#include "src/key.h"
+#include "src/operation.h"
+#include "src/strbuf.h"
+// clang-format on
+
+#define DEFAULT_REQUESTS 200000
+#define DEFAULT_WIDTH 64
+#define MAX_WIDTH (1024 * 1024)
+// 与 http_server.c 相同的请求内存区域块大小和 post processor 缓冲区大小
+#define REQUEST_ARENA_SIZE 4096
+#define POST_BUFFER_SIZE 8192
+
+// data 字段的内容，-w 控制长度，模拟 SQL 片段（引号、空格、逗号都需要 URL 编码）
+static char data_text[MAX_WIDTH + 1];
+
+/**
+ * @brief 获取单调时钟（秒）
+ *
+ * @return double 秒
+ */
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 与 http_client.c 相同的 URL 编码
+ */
+static int append_form_field(strbuf_t *body, const char *key, const char *value) {
+  if (strbuf_appendf(body, "%s%s=", body->len ? "&" : "", key) != 0) {
+    return -1;
+  }
+  for (const unsigned char *p = (const unsigned char *)value; *p; ++p) {
+    unsigned char c = *p;
+    int rc = ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+              c == '-' || c == '_' || c == '.' || c == '~')
+                 ? strbuf_append_char(body, (char)c)
+                 : strbuf_appendf(body, "%%%02X", c);
+    if (rc != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int append_json_field(strbuf_t *body, const char *key, const char *value) {
+  bool first = body->data[body->len - 1] == '{';
+  if (strbuf_appendf(body, "%s\"%s\":\"", first ? "" : ",", key) != 0 ||
+      json_escape_append(body, value, strlen(value)) != 0) {
+    return -1;
+  }
+  return strbuf_append_char(body, '"');
+}
+
+/**
+ * @brief 构造请求体：items 为 0 时是单个 create，否则是包含 items 个 create 的批量请求
+ */
+static int build_bodies(size_t items, strbuf_t *form, strbuf_t *json) {
+  if (items == 0) {
+    return append_form_field(form, KEY_POST_OPERATION, KEY_OP_CREATE) ||
+           append_form_field(form, KEY_POST_TABLE, "bench_users") ||
+           append_form_field(form, KEY_POST_DATA, data_text) || strbuf_append_char(json, '{') ||
+           append_json_field(json, KEY_POST_OPERATION, KEY_OP_CREATE) ||
+           append_json_field(json, KEY_POST_TABLE, "bench_users") ||
+           append_json_field(json, KEY_POST_DATA, data_text) || strbuf_append_char(json, '}');
+  }
+
+  int rc = append_form_field(form, KEY_POST_OPERATION, KEY_OP_BATCH) ||
+           strbuf_appendf(json, "{\"%s\":\"%s\",\"%s\":[", KEY_POST_OPERATION, KEY_OP_BATCH,
+                          KEY_JSON_ITEMS);
+  for (size_t i = 0; rc == 0 && i < items; ++i) {
+    rc = append_form_field(form, KEY_POST_ITEM_OPERATION, KEY_OP_CREATE) ||
+         append_form_field(form, KEY_POST_ITEM_TABLE, "bench_users") ||
+         append_form_field(form, KEY_POST_ITEM_DATA, data_text) ||
+         (i > 0 && strbuf_append_char(json, ',') != 0) || strbuf_append_char(json, '{') ||
+         append_json_field(json, KEY_POST_OPERATION, KEY_OP_CREATE) ||
+         append_json_field(json, KEY_POST_TABLE, "bench_users") ||
+         append_json_field(json, KEY_POST_DATA, data_text) || strbuf_append_char(json, '}');
+  }
+  return rc || strbuf_append_str(json, "]}");
+}
+
+static int hex_value(char ch) {
+  if (ch >= '0' && ch <= '9') {
+    return ch - '0';
+  }
+  if (ch >= 'a' && ch <= 'f') {
+    return ch - 'a' + 10;
+  }
+  if (ch >= 'A' && ch <= 'F') {
+    return ch - 'A' + 10;
+  }
+  return -1;
+}
+
+/**
+ * @brief 表单字段分派：与 http_server.c 中 post_data_iterator() 相同的 strcmp 链
+ */
+static char **form_field(const char *key, char **fields, batch_t *batch, bool first_chunk) {
+  if (strcmp(key, KEY_POST_OPERATION) == 0) {
+    return &fields[0];
+  } else if (strcmp(key, KEY_POST_TABLE) == 0) {
+    return &fields[1];
+  } else if (strcmp(key, KEY_POST_DATA) == 0) {
+    return &fields[2];
+  } else if (strcmp(key, KEY_POST_WHERE) == 0) {
+    return &fields[3];
+  } else if (strcmp(key, KEY_POST_TRANSACTION) == 0) {
+    return NULL;
+  } else if (strncmp(key, "item_", 5) == 0) {
+    batch_item_t *item = batch_last_item(batch);
+    if (strcmp(key, KEY_POST_ITEM_OPERATION) == 0) {
+      if (first_chunk) {
+        item = batch_add_item(batch);
+      }
+      return item ? &item->operation : NULL;
+    }
+    if (!item) {
+      return NULL;
+    }
+    if (strcmp(key, KEY_POST_ITEM_TABLE) == 0) {
+      return &item->table;
+    } else if (strcmp(key, KEY_POST_ITEM_DATA) == 0) {
+      return &item->data;
+    } else if (strcmp(key, KEY_POST_ITEM_WHERE) == 0) {
+      return &item->where;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief 与 http_server.c 中 store_post_field() 相同：分片追加到请求内存区域
+ */
+static void form_store(arena_t *arena, char **field, const char *data, size_t off, size_t size) {
+  size_t old_len = (off > 0 && *field) ? strlen(*field) : 0;
+  char *ptr = arena_grow(arena, old_len ? *field : NULL, old_len + 1, old_len + size + 1);
+  if (ptr) {
+    memcpy(ptr + old_len, data, size);
+    ptr[old_len + size] = '\0';
+    *field = ptr;
+  }
+}
+
+/**
+ * @brief 表单路径的模型：按 post processor 的方式把值解码到 8 KB 缓冲区，每满一次或值结束时
+ *        交给迭代器，由 strcmp 链分派后复制到请求内存区域
+ *
+ * @return size_t 解析出的字段长度之和（校验用）
+ */
+static size_t parse_form(const char *body, size_t len) {
+  arena_t *arena = arena_create(REQUEST_ARENA_SIZE);
+  batch_t batch;
+  batch_init(&batch, arena);
+  char *fields[4] = {NULL, NULL, NULL, NULL};
+  char key[64];
+  char buffer[POST_BUFFER_SIZE];
+
+  const char *p = body;
+  const char *end = body + len;
+  while (p < end) {
+    size_t key_len = 0;
+    while (p < end && *p != '=' && *p != '&') {
+      if (key_len < sizeof(key) - 1) {
+        key[key_len++] = *p;
+      }
+      ++p;
+    }
+    key[key_len] = '\0';
+    if (p < end && *p == '=') {
+      ++p;
+    }
+
+    size_t off = 0;
+    size_t used = 0;
+    while (p < end && *p != '&') {
+      char ch = *p++;
+      if (ch == '+') {
+        ch = ' ';
+      } else if (ch == '%' && end - p >= 2 && hex_value(p[0]) >= 0 && hex_value(p[1]) >= 0) {
+        ch = (char)(hex_value(p[0]) << 4 | hex_value(p[1]));
+        p += 2;
+      }
+      buffer[used++] = ch;
+      if (used == sizeof(buffer)) {
+        char **field = form_field(key, fields, &batch, off == 0);
+        if (field) {
+          form_store(arena, field, buffer, off, used);
+        }
+        off += used;
+        used = 0;
+      }
+    }
+    if (used > 0) {
+      char **field = form_field(key, fields, &batch, off == 0);
+      if (field) {
+        form_store(arena, field, buffer, off, used);
+      }
+    }
+    if (p < end) {
+      ++p;
+    }
+  }
+
+  size_t sum = fields[0] && strcmp(fields[0], KEY_OP_BATCH) == 0 ? batch.num_items : 0;
+  for (size_t i = 0; i < batch.num_items; ++i) {
+    sum += batch.items[i].data ? strlen(batch.items[i].data) : 0;
+  }
+  sum += fields[2] ? strlen(fields[2]) : 0;
+  arena_destroy(arena);
+  return sum;
+}
+
+/**
+ * @brief JSON 路径：请求体复制一次到请求内存区域（对应接收），然后原地解析
+ *
+ * @return size_t 解析出的字段长度之和（校验用），失败返回 0
+ */
+static size_t parse_json(const char *body, size_t len) {
+  arena_t *arena = arena_create(REQUEST_ARENA_SIZE);
+  char *copy = arena_alloc(arena, len);
+  memcpy(copy, body, len);
+
+  batch_t batch;
+  batch_init(&batch, arena);
+  json_request_t req;
+  json_request_error_t error;
+  req.batch = &batch;
+  size_t sum = 0;
+  if (json_request_parse(copy, len, &req, &error) == 0) {
+    sum = db_op_from_str(req.operation) == DB_OP_BATCH ? batch.num_items : 0;
+    for (size_t i = 0; i < batch.num_items; ++i) {
+      sum += batch.items[i].data ? strlen(batch.items[i].data) : 0;
+    }
+    sum += req.data ? strlen(req.data) : 0;
+  }
+  arena_destroy(arena);
+  return sum;
+}
+
+/**
+ * @brief 重复解析同一个请求体
+ */
+static double run(size_t (*parse)(const char *, size_t), const strbuf_t *body, size_t requests,
+                  size_t *checksum) {
+  volatile size_t sink = 0;
+  double start = now_sec();
+  for (size_t i = 0; i < requests; ++i) {
+    sink += parse(body->data, body->len);
+  }
+  *checksum = sink;
+  return now_sec() - start;
+}
+
+int main(int argc, char **argv) {
+  size_t requests = DEFAULT_REQUESTS;
+  size_t width = DEFAULT_WIDTH;
+  size_t items = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:w:b:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      requests = strtoull(optarg, NULL, 10);
+      break;
+    case 'w':
+      width = strtoull(optarg, NULL, 10);
+      width = width > MAX_WIDTH ? MAX_WIDTH : width;
+      break;
+    case 'b':
+      items = strtoull(optarg, NULL, 10);
+      items = items > BATCH_MAX_ITEMS ? BATCH_MAX_ITEMS : items;
+      break;
+    default:
+      printf("Usage: %s [-n REQUESTS] [-w WIDTH] [-b ITEMS]\n"
+             "  (default: %d requests, %d-byte data field, single create; -b sends a batch)\n",
+             argv[0], DEFAULT_REQUESTS, DEFAULT_WIDTH);
+      return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  // 形如 name='xxxx', note="x y"：字母之外每 8 个字节有一个需要 URL 编码的字符，
+  // 每 97 个字节有一个需要 JSON 转义的双引号
+  static const char punct[] = "' ,=()'";
+  for (size_t i = 0; i < width; ++i) {
+    data_text[i] = i % 97 == 96 ? '"' : i % 8 == 7 ? punct[i / 8 % (sizeof(punct) - 1)]
+                                                   : (char)('a' + i % 26);
+  }
+  data_text[width] = '\0';
+
+  strbuf_t form, json;
+  strbuf_init(&form);
+  strbuf_init(&json);
+  if (build_bodies(items, &form, &json) != 0) {
+    fprintf(stderr, "Failed to build request bodies\n");
+    return EXIT_FAILURE;
+  }
+
+  size_t form_sum = 0, json_sum = 0;
+  double form_time = run(parse_form, &form, requests, &form_sum);
+  double json_time = run(parse_json, &json, requests, &json_sum);
+
+  printf("requests: %zu, data field: %zu bytes, batch items: %zu\n", requests, width, items);
+  printf("%-8s %14s %14s %14s\n", "body", "bytes", "parse(ms)", "ns/request");
+  printf("%-8s %14zu %14.2f %14.1f\n", "form", form.len, form_time * 1e3,
+         form_time * 1e9 / requests);
+  printf("%-8s %14zu %14.2f %14.1f\n", "json", json.len, json_time * 1e3,
+         json_time * 1e9 / requests);
+  printf("size ratio (json/form): %.2f, speedup (form/json): %.2f\n",
+         (double)json.len / form.len, form_time / json_time);
+  printf("checksum: form=%zu json=%zu\n", form_sum, json_sum);
+
+  strbuf_free(&form);
+  strbuf_free(&json);
+  return form_sum == json_sum ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,227 @@
+// clang-format off
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "src/result_encoder.h"
+#include "src/rowset.h"
+// clang-format on
+
+#define DEFAULT_ROWS 100000
+#define DEFAULT_WIDTH 12 // 超过 15 字节后文本表格的列之间不再有空格，无法可靠解析
+#define MAX_WIDTH 4096
+#define NUM_COLUMNS 5
+
+// 宽字符串列的内容，-w 控制长度，模拟宽行
+static char wide_text[MAX_WIDTH + 1];
+static size_t wide_len;
+
+/**
+ * @brief 获取单调时钟（秒）
+ *
+ * @return double 秒
+ */
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 构造一行模拟数据（MySQL 文本协议下所有列都是字符串）
+ *
+ * @param i 行号
+ * @param storage 每列的字符串存储
+ * @param row 行数据
+ * @param lengths 各列长度
+ */
+static void make_row(size_t i, char storage[NUM_COLUMNS][64], MYSQL_ROW row,
+                     unsigned long *lengths) {
+  snprintf(storage[0], 64, "%zu", i + 1);
+  snprintf(storage[2], 64, "%.2f", (double)(i % 10000) / 7.0);
+  snprintf(storage[3], 64, "2024-%02zu-%02zu 12:34:56", i % 12 + 1, i % 28 + 1);
+  for (int c = 0; c < NUM_COLUMNS - 1; ++c) {
+    row[c] = storage[c];
+    lengths[c] = strlen(storage[c]);
+  }
+  row[1] = wide_text;
+  lengths[1] = wide_len;
+  // 最后一列一半为 NULL
+  if (i % 2) {
+    snprintf(storage[4], 64, "%zu", i * 31);
+    row[4] = storage[4];
+    lengths[4] = strlen(storage[4]);
+  } else {
+    row[4] = NULL;
+    lengths[4] = 0;
+  }
+}
+
+/**
+ * @brief 只构造行、不编码，作为编码耗时的基线
+ *
+ * @param rows 行数
+ * @return double 耗时（秒）
+ */
+static double generate_all(size_t rows) {
+  char storage[NUM_COLUMNS][64];
+  char *row[NUM_COLUMNS];
+  unsigned long lengths[NUM_COLUMNS];
+  volatile unsigned long sink = 0;
+
+  double start = now_sec();
+  for (size_t i = 0; i < rows; ++i) {
+    make_row(i, storage, row, lengths);
+    sink += lengths[0];
+  }
+  (void)sink;
+  return now_sec() - start;
+}
+
+/**
+ * @brief 编码全部行
+ *
+ * @param format 编码格式
+ * @param fields 字段元数据
+ * @param rows 行数
+ * @param out 输出缓冲区
+ * @return double 耗时（秒）
+ */
+static double encode_all(result_format_t format, const MYSQL_FIELD *fields, size_t rows,
+                         strbuf_t *out) {
+  char storage[NUM_COLUMNS][64];
+  char *row[NUM_COLUMNS];
+  unsigned long lengths[NUM_COLUMNS];
+  result_encoder_t encoder;
+
+  double start = now_sec();
+  result_encoder_init(&encoder, format, fields, NUM_COLUMNS);
+  result_encoder_begin(&encoder, out);
+  for (size_t i = 0; i < rows; ++i) {
+    make_row(i, storage, row, lengths);
+    result_encoder_row(&encoder, row, lengths, out);
+  }
+  result_encoder_end(&encoder, out);
+  return now_sec() - start;
+}
+
+/**
+ * @brief 模拟客户端解析文本表格：按行切分，再把数值列转换为原生类型
+ *
+ * @param data 文本
+ * @param checksum 校验值，防止编译器优化掉解析过程
+ * @return double 耗时（秒）
+ */
+static double parse_text(const char *data, double *checksum) {
+  double start = now_sec();
+  const char *line = strchr(data, '\n');
+  line = line ? strchr(line + 1, '\n') : NULL; // 跳过表头与分隔线
+  while (line && *++line) {
+    char *end;
+    *checksum += (double)strtoll(line, &end, 10);
+    while (*end == ' ') {
+      ++end;
+    }
+    end = strchr(end, ' '); // name
+    *checksum += strtod(end, &end);
+    line = strchr(end, '\n');
+  }
+  return now_sec() - start;
+}
+
+/**
+ * @brief 解码二进制结果集
+ *
+ * @param data 数据
+ * @param len 数据长度
+ * @param checksum 校验值
+ * @return double 耗时（秒），解码失败返回负数
+ */
+static double parse_rowset(const char *data, size_t len, double *checksum) {
+  double start = now_sec();
+  rowset_t *rowset = rowset_decode(data, len);
+  if (!rowset) {
+    return -1;
+  }
+  for (size_t i = 0; i < rowset->num_rows; ++i) {
+    *checksum += (double)rowset_value(rowset, i, 0)->i64 + rowset_value(rowset, i, 2)->f64;
+  }
+  double elapsed = now_sec() - start;
+  rowset_free(rowset);
+  return elapsed;
+}
+
+int main(int argc, char **argv) {
+  size_t rows = DEFAULT_ROWS;
+  wide_len = DEFAULT_WIDTH;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:w:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      rows = strtoull(optarg, NULL, 10);
+      break;
+    case 'w':
+      wide_len = strtoull(optarg, NULL, 10);
+      wide_len = wide_len > MAX_WIDTH ? MAX_WIDTH : wide_len;
+      break;
+    default:
+      printf("Usage: %s [-n ROWS] [-w WIDTH] (default: %d rows, %d-byte string column)\n",
+             argv[0], DEFAULT_ROWS, DEFAULT_WIDTH);
+      return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  // 每 61 个字节带一个需要 JSON 转义的双引号
+  for (size_t i = 0; i < wide_len; ++i) {
+    wide_text[i] = i % 61 == 60 ? '"' : 'a' + i % 26;
+  }
+
+  MYSQL_FIELD fields[NUM_COLUMNS];
+  memset(fields, 0, sizeof(fields));
+  fields[0].name = "id";
+  fields[0].type = MYSQL_TYPE_LONGLONG;
+  fields[1].name = "name";
+  fields[1].type = MYSQL_TYPE_VAR_STRING;
+  fields[2].name = "score";
+  fields[2].type = MYSQL_TYPE_DOUBLE;
+  fields[3].name = "created_at";
+  fields[3].type = MYSQL_TYPE_DATETIME;
+  fields[4].name = "ref";
+  fields[4].type = MYSQL_TYPE_LONG;
+  fields[4].flags = UNSIGNED_FLAG;
+
+  strbuf_t text, binary;
+  strbuf_init(&text);
+  strbuf_init(&binary);
+  double text_encode = encode_all(RESULT_FORMAT_TEXT, fields, rows, &text);
+  double binary_encode = encode_all(RESULT_FORMAT_ROWSET, fields, rows, &binary);
+
+  double text_sum = 0, binary_sum = 0;
+  double text_parse = parse_text(text.data, &text_sum);
+  double binary_parse = parse_rowset(binary.data, binary.len, &binary_sum);
+  if (binary_parse < 0) {
+    fprintf(stderr, "Failed to decode binary result set\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("rows: %zu, string column: %zu bytes, row generation: %.2f ms (included in encode)\n",
+         rows, wide_len, generate_all(rows) * 1e3);
+  printf("%-8s %14s %14s %14s\n", "format", "bytes", "encode(ms)", "parse(ms)");
+  printf("%-8s %14zu %14.2f %14.2f\n", "text", text.len, text_encode * 1e3, text_parse * 1e3);
+  printf("%-8s %14zu %14.2f %14.2f\n", "binary", binary.len, binary_encode * 1e3,
+         binary_parse * 1e3);
+  for (result_format_t format = RESULT_FORMAT_JSON; format <= RESULT_FORMAT_NDJSON; ++format) {
+    strbuf_t json;
+    strbuf_init(&json);
+    double json_encode = encode_all(format, fields, rows, &json);
+    printf("%-8s %14zu %14.2f %14s\n", format == RESULT_FORMAT_JSON ? "json" : "ndjson", json.len,
+           json_encode * 1e3, "-");
+    strbuf_free(&json);
+  }
+  printf("size ratio (binary/text): %.2f\n", (double)binary.len / text.len);
+  printf("checksum: text=%.2f binary=%.2f\n", text_sum, binary_sum);
+
+  strbuf_free(&text);
+  strbuf_free(&binary);
+  return EXIT_SUCCESS;
+}
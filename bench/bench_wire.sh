@@ -0,0 +1,53 @@
+#!/bin/bash
+
+# 请在根目录下运行，daemon 同时监听 HTTP 和二进制协议，对比两种协议的吞吐和每核效率
+# 用法：bench/bench_wire.sh [build 目录]
+
+set -e
+
+BUILD_DIR=${1:-build}
+MYSQL_USER="root"
+MYSQL_PASSWORD="root"
+MYSQL_HOST="localhost"
+MYSQL_PORT="3306"
+POOL_SIZE=8
+DURATION=10
+CLIENTS=4
+PIPELINE=32
+HTTP_URL="http://localhost:60001"
+WIRE_ADDRESS="localhost:60002"
+
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -e "CREATE DATABASE IF NOT EXISTS mydb;"
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -Dmydb -e "DROP TABLE IF EXISTS bench_users;"
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -Dmydb -e "CREATE TABLE bench_users (id INT AUTO_INCREMENT PRIMARY KEY, name VARCHAR(100), age INT);"
+mysql -u$MYSQL_USER -p$MYSQL_PASSWORD -h$MYSQL_HOST -P$MYSQL_PORT -Dmydb -e "INSERT INTO bench_users (name, age) VALUES ('Alice', 30), ('Bob', 31), ('Carol', 32);"
+
+$BUILD_DIR/dbmanager --db-host=$MYSQL_HOST \
+            --db-user=$MYSQL_USER \
+            --db-password=$MYSQL_PASSWORD \
+            --db-name=mydb \
+            --pool-size=$POOL_SIZE \
+            --binary-port=60002 > /dev/null 2>&1 &
+PID=$!
+trap 'kill $PID; wait $PID 2>/dev/null || true' EXIT
+sleep 2
+
+# daemon 已消耗的 CPU 秒数（/proc/PID/stat 的 utime 与 stime，单位为时钟周期）
+server_cpu() {
+  awk -v hz="$(getconf CLK_TCK)" '{ printf "%.2f", ($14 + $15) / hz }' /proc/$PID/stat
+}
+
+run() {
+  local before after
+  before=$(server_cpu)
+  echo -n "$($BUILD_DIR/bench/bench_http "$@" --table=bench_users --where="id=1" \
+                                          --clients=$CLIENTS --duration=$DURATION) "
+  after=$(server_cpu)
+  echo "server_cpu=$(echo "$after - $before" | bc)s"
+}
+
+# HTTP 每个连接同一时刻只有一个请求，异步接口用多个保持的连接并发；二进制协议在每个连接上流水线发送
+run --protocol=http --url=$HTTP_URL
+run --protocol=http --url=$HTTP_URL --pipeline=$PIPELINE
+run --protocol=binary --url=$WIRE_ADDRESS --pipeline=1
+run --protocol=binary --url=$WIRE_ADDRESS --pipeline=$PIPELINE
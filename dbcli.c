@@ -1,22 +1,45 @@
 // clang-format off
 #include <getopt.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include "dbmanager_conf.h"
 #include "src/http_client.h"
 #include "src/http_server.h"
 #include "src/key.h"
 #include "src/macro.h"
+#include "src/wire_client.h"
 // clang-format on
 
 #define DEFAULT_BASE_URL "http://localhost:" STR_HELPER(HTTP_PORT)
+#define DEFAULT_WIRE_ADDRESS "localhost:" STR_HELPER(WIRE_PORT)
+
+// 两种协议的客户端，只有一个非空
+typedef struct {
+  http_client_t *http;
+  wire_client_t *wire;
+} client_t;
 
 typedef struct command_op {
   char *table;
   char *data;
   char *where;
   char *url;
+  char *file;
+  bool binary; // 使用二进制协议
+  result_format_t format;
+  bool json_body; // 以 JSON 发送请求体
+  bulk_format_t bulk_format; // bulk_create 上传的行的格式
+  bool bulk_format_set;      // 为 false 时按文件扩展名判断
+  bool transaction;
+  bool timing; // 输出服务端各阶段耗时
+  long timeout_ms;
+  char *api_key; // 服务端按它计算客户端配额
+  char *cursor;  // watch 的起始位置
+  read_options_t read; // read 的分页（page_size 为 0 时一次读完）、选择的列、排序和行数上限
+  db_params_t params;  // data 和 where 中 '?' 的值，count 为 0 表示不是参数化操作
   bool usage;
 } command_op_t;
 
@@ -30,12 +53,52 @@ static void print_usage(const char *program_name) {
   printf("Version: %s\n", OHNO_VERSION);
   printf("Operations:\n");
   printf("  create --table=TABLE --data=DATA\n");
-  printf("  read   --table=TABLE [--where=WHERE]\n");
+  printf("  read   --table=TABLE [--where=WHERE] [--columns=COLS] [--order=ORDER]\n"
+         "         [--limit=N] [--page-size=N] [--param=V]...\n");
   printf("  update --table=TABLE --data=DATA --where=WHERE\n");
   printf("  delete --table=TABLE --where=WHERE\n");
+  printf("  batch  --file=FILE [--transaction]\n");
+  printf("         FILE ('-' for stdin) has one operation per line:\n");
+  printf("         OPERATION<TAB>TABLE<TAB>DATA<TAB>WHERE (empty fields are omitted)\n");
+  printf("  bulk_create --table=TABLE --file=FILE [--body=csv|ndjson]\n");
+  printf("         Stream FILE ('-' for stdin) as CSV with a header row or as one JSON\n");
+  printf("         object per line, the format follows the .csv/.ndjson/.jsonl extension\n");
+  printf("         unless --body is given (http only)\n");
+  printf("  watch  --table=TABLE [--cursor=CURSOR]\n");
+  printf("         Print the table's row changes as JSON lines until interrupted, the\n");
+  printf("         latest cursor goes to stderr, pass it back to resume (http only)\n");
   printf("\nOptions:\n");
   printf("  --help, -h    Show this help message\n");
   printf("  --url=URL     HTTP server URL (default: %s)\n", DEFAULT_BASE_URL);
+  printf("                unix:PATH connects through the daemon's Unix socket at PATH\n");
+  printf("                HOST:PORT with --protocol=binary (default: %s)\n", DEFAULT_WIRE_ADDRESS);
+  printf("  --protocol=P  Protocol: http or binary, binary needs the daemon started\n"
+         "                with --binary-port (default: http)\n");
+  printf("  --format=FMT  Read result format: text, binary, json or ndjson (default: text)\n");
+  printf("  --body=ENC    Request body encoding: form or json (default: form), csv or\n"
+         "                ndjson for bulk_create\n");
+  printf("  --transaction Run the whole batch in one transaction\n");
+  printf("  --timing      Print the trace ID and the server's per-phase timings to stderr\n");
+  printf("  --timeout=MS  Give up after MS milliseconds, the server stops waiting for a\n"
+         "                connection and kills the query by then, 0 waits forever\n"
+         "                (default: %d)\n",
+         HTTP_CLIENT_DEFAULT_TIMEOUT_MS);
+  printf("  --api-key=KEY Send KEY as X-Api-Key, the server applies its per-client quota\n"
+         "                to the key instead of this host's address\n");
+  printf("  --cursor=C    Resume watch after the changes covered by C (a GTID set), by\n"
+         "                default watch starts from the current position\n");
+  printf("  --page-size=N Read N rows per request by primary key and fetch every page,\n"
+         "                keeps each response bounded on large tables (http only,\n"
+         "                at most %d)\n",
+         READ_MAX_PAGE_SIZE);
+  printf("  --columns=C   Read only the comma-separated columns C instead of all of them\n");
+  printf("  --order=O     Sort the rows by O, comma-separated 'COLUMN [ASC|DESC]' items\n");
+  printf("  --limit=N     Read at most N rows (--columns, --order and --limit are http\n"
+         "                only and checked against the table's columns by the server)\n");
+  printf("  --param=V     Bind V to the next '?' in --data and --where, repeat once per\n"
+         "                placeholder; the server runs a cached prepared statement and\n"
+         "                the values never enter the SQL text (http only, at most %d)\n",
+         DB_PARAMS_MAX);
 }
 
 /**
@@ -50,17 +113,39 @@ static int parse_command(int argc, char **argv, command_op_t *op) {
   op->table = NULL;
   op->data = NULL;
   op->where = NULL;
-  op->url = DEFAULT_BASE_URL;
+  op->url = NULL;
+  op->file = NULL;
+  op->binary = false;
+  op->format = RESULT_FORMAT_TEXT;
+  op->json_body = false;
+  op->bulk_format = BULK_FORMAT_CSV;
+  op->bulk_format_set = false;
+  op->transaction = false;
+  op->timing = false;
+  op->timeout_ms = HTTP_CLIENT_DEFAULT_TIMEOUT_MS;
+  op->api_key = NULL;
+  op->cursor = NULL;
+  op->read = (read_options_t){0};
+  op->params.count = 0;
+  op->params.overflow = false;
   op->usage = false;
 
   // 解析命令行参数
   static struct option long_options[] = {
       {"help", no_argument, 0, 'h'},       {"table", required_argument, 0, 't'},
       {"data", required_argument, 0, 'd'}, {"where", required_argument, 0, 'w'},
-      {"url", required_argument, 0, 'u'},  {0, 0, 0, 0}};
+      {"url", required_argument, 0, 'u'},  {"format", required_argument, 0, 'f'},
+      {"file", required_argument, 0, 'F'}, {"transaction", no_argument, 0, 'T'},
+      {"body", required_argument, 0, 'b'}, {"timing", no_argument, 0, 'i'},
+      {"timeout", required_argument, 0, 'o'}, {"protocol", required_argument, 0, 'p'},
+      {"api-key", required_argument, 0, 'k'}, {"cursor", required_argument, 0, 'c'},
+      {"page-size", required_argument, 0, 'n'}, {"columns", required_argument, 0, 'C'},
+      {"order", required_argument, 0, 'O'}, {"limit", required_argument, 0, 'l'},
+      {"param", required_argument, 0, 'P'}, {0, 0, 0, 0}};
 
   int opt;
-  while ((opt = getopt_long(argc - 1, argv + 1, "ht:d:w:u:", long_options, NULL)) != -1) {
+  while ((opt = getopt_long(argc - 1, argv + 1, "ht:d:w:u:f:F:Tb:io:p:k:c:n:C:O:l:P:",
+                            long_options, NULL)) != -1) {
     switch (opt) {
     case 'h':
       op->usage = true;
@@ -77,6 +162,102 @@ static int parse_command(int argc, char **argv, command_op_t *op) {
     case 'u':
       op->url = optarg;
       break;
+    case 'f':
+      if (strcmp(optarg, "text") == 0) {
+        op->format = RESULT_FORMAT_TEXT;
+      } else if (strcmp(optarg, "binary") == 0) {
+        op->format = RESULT_FORMAT_ROWSET;
+      } else if (strcmp(optarg, "json") == 0) {
+        op->format = RESULT_FORMAT_JSON;
+      } else if (strcmp(optarg, "ndjson") == 0) {
+        op->format = RESULT_FORMAT_NDJSON;
+      } else {
+        fprintf(stderr, "Unknown format: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'F':
+      op->file = optarg;
+      break;
+    case 'T':
+      op->transaction = true;
+      break;
+    case 'b':
+      if (strcmp(optarg, "form") == 0) {
+        op->json_body = false;
+      } else if (strcmp(optarg, "json") == 0) {
+        op->json_body = true;
+      } else if (strcmp(optarg, "csv") == 0 || strcmp(optarg, "ndjson") == 0) {
+        op->bulk_format = optarg[0] == 'c' ? BULK_FORMAT_CSV : BULK_FORMAT_NDJSON;
+        op->bulk_format_set = true;
+      } else {
+        fprintf(stderr, "Unknown body encoding: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'i':
+      op->timing = true;
+      break;
+    case 'o': {
+      char *end = NULL;
+      op->timeout_ms = strtol(optarg, &end, 10);
+      if (*optarg == '\0' || *end != '\0' || op->timeout_ms < 0) {
+        fprintf(stderr, "Invalid timeout: %s\n", optarg);
+        return -1;
+      }
+      break;
+    }
+    case 'p':
+      if (strcmp(optarg, "http") == 0) {
+        op->binary = false;
+      } else if (strcmp(optarg, "binary") == 0) {
+        op->binary = true;
+      } else {
+        fprintf(stderr, "Unknown protocol: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'k':
+      op->api_key = optarg;
+      break;
+    case 'c':
+      op->cursor = optarg;
+      break;
+    case 'n': {
+      char *end = NULL;
+      unsigned long page_size = strtoul(optarg, &end, 10);
+      if (*optarg < '1' || *optarg > '9' || *end != '\0' || page_size > READ_MAX_PAGE_SIZE) {
+        fprintf(stderr, "Invalid page size: %s\n", optarg);
+        return -1;
+      }
+      op->read.page_size = (unsigned int)page_size;
+      break;
+    }
+    case 'C':
+      op->read.columns = optarg;
+      break;
+    case 'O':
+      op->read.order_by = optarg;
+      break;
+    case 'l': {
+      char *end = NULL;
+      unsigned long limit = strtoul(optarg, &end, 10);
+      if (*optarg < '1' || *optarg > '9' || *end != '\0' || limit > UINT_MAX) {
+        fprintf(stderr, "Invalid limit: %s\n", optarg);
+        return -1;
+      }
+      op->read.limit = (unsigned int)limit;
+      break;
+    }
+    case 'P':
+      // 以字符串发送，服务端按列类型转换
+      if (op->params.count == DB_PARAMS_MAX) {
+        fprintf(stderr, "Too many params, at most %d\n", DB_PARAMS_MAX);
+        return -1;
+      }
+      op->params.values[op->params.count++] =
+          (db_param_t){.type = DB_PARAM_STRING, .str = optarg, .len = strlen(optarg)};
+      break;
     case '?':
       return -1;
     default:
@@ -84,9 +265,345 @@ static int parse_command(int argc, char **argv, command_op_t *op) {
     }
   }
 
+  if (!op->url) {
+    op->url = op->binary ? DEFAULT_WIRE_ADDRESS : DEFAULT_BASE_URL;
+  }
+  if (op->binary && op->json_body) {
+    fprintf(stderr, "--body applies to the http protocol only\n");
+    return -1;
+  }
+  if (op->binary && op->api_key) {
+    fprintf(stderr, "--api-key applies to the http protocol only\n");
+    return -1;
+  }
+  if (op->binary && (op->read.page_size > 0 || op->read.columns || op->read.order_by ||
+                     op->read.limit > 0)) {
+    fprintf(stderr,
+            "--page-size, --columns, --order and --limit apply to the http protocol only\n");
+    return -1;
+  }
+  if (op->read.page_size > 0 && (op->read.order_by || op->read.limit > 0)) {
+    fprintf(stderr, "--page-size reads in primary key order, it excludes --order and --limit\n");
+    return -1;
+  }
+  if (op->params.count > 0 && (op->binary || op->read.page_size > 0)) {
+    fprintf(stderr, "--param applies to the http protocol only and excludes --page-size\n");
+    return -1;
+  }
+  if (op->params.count > 0) {
+    op->read.params = &op->params;
+  }
   return 0;
 }
 
+/**
+ * @brief 按命令行选择的协议初始化客户端
+ *
+ * @param client 输出客户端
+ * @param op 命令行参数
+ * @return int 成功（0）；失败（-1）
+ */
+static int client_init(client_t *client, const command_op_t *op) {
+  client->http = NULL;
+  client->wire = NULL;
+  if (op->binary) {
+    client->wire = wire_client_init(op->url);
+    if (!client->wire) {
+      return -1;
+    }
+    wire_client_set_format(client->wire, op->format);
+    wire_client_set_timeout(client->wire, op->timeout_ms);
+    return 0;
+  }
+
+  client->http = http_client_init(op->url);
+  if (!client->http) {
+    return -1;
+  }
+  http_client_set_format(client->http, op->format);
+  http_client_set_json_body(client->http, op->json_body);
+  http_client_set_timeout(client->http, op->timeout_ms);
+  if (http_client_set_api_key(client->http, op->api_key) != 0) {
+    http_client_cleanup(client->http);
+    client->http = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 销毁客户端
+ *
+ * @param client 客户端
+ */
+static void client_cleanup(client_t *client) {
+  http_client_cleanup(client->http);
+  wire_client_cleanup(client->wire);
+}
+
+/**
+ * @brief 输出最近一次请求的追踪 ID 和服务端各阶段耗时
+ *
+ * @param client 客户端
+ */
+static void print_timing(const client_t *client) {
+  trace_t trace;
+  uint64_t total_us = 0;
+  if (!client->http) {
+    fprintf(stderr, "Timing is not available over the binary protocol\n");
+    return;
+  }
+  if (http_client_last_timing(client->http, &trace, &total_us) != 0) {
+    fprintf(stderr, "No timing returned by the server\n");
+    return;
+  }
+
+  fprintf(stderr, "Trace ID: %s\n", trace.id);
+  uint64_t server_us = 0;
+  for (int phase = 0; phase < TRACE_PHASE_SEND; ++phase) {
+    fprintf(stderr, "  %-10s %10.3f ms\n", trace_phase_name((trace_phase_t)phase),
+            (double)trace.phase_us[phase] / 1000);
+    server_us += trace.phase_us[phase];
+  }
+  // 发送阶段在响应头发出之后才结束，归入网络和发送
+  fprintf(stderr, "  %-10s %10.3f ms\n", "server", (double)server_us / 1000);
+  fprintf(stderr, "  %-10s %10.3f ms (network, send and client)\n", "other",
+          total_us > server_us ? (double)(total_us - server_us) / 1000 : 0.0);
+  fprintf(stderr, "  %-10s %10.3f ms\n", "total", (double)total_us / 1000);
+}
+
+/**
+ * @brief 读取批量操作文件，每行一个操作，字段以制表符分隔
+ *
+ * @param path 文件路径，'-' 表示标准输入
+ * @param lines 输出文件内容（各条目的字段指向其中）
+ * @param items 输出条目
+ * @return int 条目数量，失败返回 -1
+ */
+static int load_batch_file(const char *path, char **lines, http_batch_item_t **items) {
+  FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (!fp) {
+    perror(path);
+    return -1;
+  }
+
+  size_t size = 0;
+  FILE *mem = open_memstream(lines, &size);
+  char chunk[4096];
+  size_t n;
+  while (mem && (n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+    fwrite(chunk, 1, n, mem);
+  }
+  if (fp != stdin) {
+    fclose(fp);
+  }
+  if (!mem || fclose(mem) != 0) {
+    fprintf(stderr, "Failed to read %s\n", path);
+    return -1;
+  }
+
+  int num_items = 0, cap_items = 0;
+  *items = NULL;
+  char *save = NULL;
+  for (char *line = strtok_r(*lines, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+    if (line[0] == '#' || line[0] == '\0') {
+      continue;
+    }
+    if (num_items == cap_items) {
+      cap_items = cap_items ? cap_items * 2 : 16;
+      http_batch_item_t *ptr = realloc(*items, cap_items * sizeof(http_batch_item_t));
+      if (!ptr) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+      }
+      *items = ptr;
+    }
+
+    // 依次为 operation、table、data、where，空字段视为未提供
+    const char *fields[4] = {NULL, NULL, NULL, NULL};
+    char *field = line;
+    for (int i = 0; i < 4 && field; ++i) {
+      char *tab = strchr(field, '\t');
+      if (tab) {
+        *tab = '\0';
+      }
+      fields[i] = field[0] ? field : NULL;
+      field = tab ? tab + 1 : NULL;
+    }
+    (*items)[num_items++] = (http_batch_item_t){fields[0], fields[1], fields[2], fields[3]};
+  }
+  return num_items;
+}
+
+/**
+ * @brief 执行批量操作并输出每个条目的结果
+ *
+ * @param client 客户端
+ * @param op 命令行参数
+ * @return int 出错（-1）；成功（已执行的条目数）
+ */
+static int run_batch(const client_t *client, const command_op_t *op) {
+  char *lines = NULL;
+  http_batch_item_t *items = NULL;
+  int num_items = load_batch_file(op->file, &lines, &items);
+  if (num_items <= 0) {
+    if (num_items == 0) {
+      fprintf(stderr, "Batch file contains no operations\n");
+    }
+    free(items);
+    free(lines);
+    return -1;
+  }
+
+  http_batch_result_t *results = calloc(num_items, sizeof(http_batch_result_t));
+  char *output = NULL;
+  int result = -1;
+  if (results) {
+    result = client->wire ? wire_client_batch(client->wire, items, num_items, op->transaction,
+                                              results, &output)
+                          : http_client_batch(client->http, items, num_items, op->transaction,
+                                              results, &output);
+    for (int i = 0; i < num_items; ++i) {
+      if (results[i].output) {
+        // 单行信息以空格开头，READ 的表格另起一行
+        FILE *stream = results[i].result >= 0 ? stdout : stderr;
+        fprintf(stream, "[%d] %s %s:%s%s\n", i + 1, items[i].operation,
+                items[i].table ? items[i].table : "", results[i].output[0] == ' ' ? "" : "\n",
+                results[i].output);
+      }
+    }
+    http_batch_results_free(results, num_items);
+  }
+  if (output) {
+    fprintf(result >= 0 ? stdout : stderr, "%s\n", output);
+    free(output);
+  } else if (result < 0) {
+    fprintf(stderr, "Batch operation failed\n");
+  }
+
+  free(results);
+  free(items);
+  free(lines);
+  return result;
+}
+
+/**
+ * @brief 逐页读取整张表（或满足条件的全部行），每页输出到标准输出；文本结果只输出一次表头
+ *
+ * @param client 客户端
+ * @param op 命令行参数
+ * @return int 出错（-1）；成功（1）
+ */
+static int run_read_pages(const client_t *client, const command_op_t *op) {
+  read_options_t options = op->read;
+  char *token = NULL;
+  bool first = true;
+  for (;;) {
+    char *output = NULL, *next_page = NULL;
+    options.page_token = token;
+    int result =
+        http_client_read_page(client->http, op->table, op->where, &options, &output, &next_page);
+    free(token);
+    if (result < 0) {
+      fprintf(stderr, "%s\n", output ? output : "Read operation failed");
+      free(output);
+      return -1;
+    }
+
+    // 文本表头占两行（列名和分隔线），之后的页跳过
+    const char *rows = output ? output : "";
+    bool text = op->format == RESULT_FORMAT_TEXT || op->format == RESULT_FORMAT_ROWSET;
+    for (int i = 0; text && !first && i < 2 && *rows; ++i) {
+      const char *eol = strchr(rows, '\n');
+      rows = eol ? eol + 1 : rows + strlen(rows);
+    }
+    fputs(rows, stdout);
+    free(output);
+    first = false;
+    if (!next_page) {
+      return 1;
+    }
+    token = next_page;
+  }
+}
+
+/**
+ * @brief 批量写入：文件以流的形式上传，输出服务端的汇总和出错的行
+ *
+ * @param client 客户端
+ * @param op 命令行参数
+ * @return int 出错（-1）；成功（写入的行数）
+ */
+static int run_bulk_create(const client_t *client, const command_op_t *op) {
+  if (!client->http) {
+    fprintf(stderr, "Bulk create is not available over the binary protocol\n");
+    return -1;
+  }
+
+  bulk_format_t format = op->bulk_format;
+  if (!op->bulk_format_set) {
+    const char *ext = strrchr(op->file, '.');
+    if (ext && (strcasecmp(ext, ".ndjson") == 0 || strcasecmp(ext, ".jsonl") == 0)) {
+      format = BULK_FORMAT_NDJSON;
+    } else if (!ext || strcasecmp(ext, ".csv") != 0) {
+      fprintf(stderr, "Cannot tell the format of %s, pass --body=csv or --body=ndjson\n",
+              op->file);
+      return -1;
+    }
+  }
+
+  FILE *fp = strcmp(op->file, "-") == 0 ? stdin : fopen(op->file, "rb");
+  if (!fp) {
+    perror(op->file);
+    return -1;
+  }
+  char *output = NULL;
+  int result = http_client_bulk_create(client->http, op->table, format, fp, &output);
+  if (fp != stdin) {
+    fclose(fp);
+  }
+  if (output) {
+    fprintf(result >= 0 ? stdout : stderr, "%s", output);
+    free(output);
+  } else if (result < 0) {
+    fprintf(stderr, "Bulk create operation failed\n");
+  }
+  return result;
+}
+
+/**
+ * @brief 持续长轮询表的行变更，变更输出到标准输出，游标变化时输出到标准错误
+ *
+ * @param client 客户端
+ * @param op 命令行参数
+ * @return int 出错（-1），否则不返回
+ */
+static int run_watch(const client_t *client, const command_op_t *op) {
+  if (!client->http) {
+    fprintf(stderr, "Watch is not available over the binary protocol\n");
+    return -1;
+  }
+
+  char *cursor = op->cursor ? strdup(op->cursor) : NULL;
+  for (;;) {
+    char *events = NULL, *next_cursor = NULL;
+    if (http_client_watch(client->http, op->table, cursor, &events, &next_cursor) < 0) {
+      fprintf(stderr, "%s\n", events ? events : "Watch operation failed");
+      free(events);
+      free(cursor);
+      return -1;
+    }
+    fputs(events, stdout);
+    fflush(stdout);
+    if (!cursor || strcmp(cursor, next_cursor) != 0) {
+      fprintf(stderr, "cursor: %s\n", next_cursor);
+    }
+    free(events);
+    free(cursor);
+    cursor = next_cursor;
+  }
+}
+
 int main(int argc, char **argv) {
   if (argc == 2) {
     if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) {
@@ -109,9 +626,9 @@ int main(int argc, char **argv) {
     return EXIT_SUCCESS;
   }
 
-  // 初始化 HTTP 客户端
-  http_client_t *client = http_client_init(op.url);
-  if (!client) {
+  // 初始化客户端
+  client_t client;
+  if (client_init(&client, &op) != 0) {
     return EXIT_FAILURE;
   }
 
@@ -122,7 +639,14 @@ int main(int argc, char **argv) {
     if (!op.table || !op.data) {
       fprintf(stderr, "Create operation requires --table or --data\n");
     } else {
-      result = http_client_create(client, op.table, op.data, &output);
+      if (client.wire) {
+        result = wire_client_create(client.wire, op.table, op.data, &output);
+      } else if (op.params.count > 0) {
+        result = http_client_execute(client.http, KEY_OP_CREATE, op.table, op.data, NULL,
+                                     &op.params, &output);
+      } else {
+        result = http_client_create(client.http, op.table, op.data, &output);
+      }
       if (result >= 0) {
         if (output) {
           printf("%s\n", output);
@@ -140,8 +664,11 @@ int main(int argc, char **argv) {
   } else if (strcmp(operation, KEY_OP_READ) == 0) {
     if (!op.table) {
       fprintf(stderr, "Read operation requires --table\n");
+    } else if (op.read.page_size > 0) {
+      result = run_read_pages(&client, &op);
     } else {
-      result = http_client_read(client, op.table, op.where, &output);
+      result = client.wire ? wire_client_read(client.wire, op.table, op.where, &output)
+                           : http_client_read(client.http, op.table, op.where, &op.read, &output);
       if (result >= 0) {
         if (output) {
           printf("%s\n", output);
@@ -158,7 +685,14 @@ int main(int argc, char **argv) {
     if (!op.table || !op.data || !op.where) {
       fprintf(stderr, "Update operation requires --table, --data or --where\n");
     } else {
-      result = http_client_update(client, op.table, op.data, op.where, &output);
+      if (client.wire) {
+        result = wire_client_update(client.wire, op.table, op.data, op.where, &output);
+      } else if (op.params.count > 0) {
+        result = http_client_execute(client.http, KEY_OP_UPDATE, op.table, op.data, op.where,
+                                     &op.params, &output);
+      } else {
+        result = http_client_update(client.http, op.table, op.data, op.where, &output);
+      }
       if (result >= 0) {
         if (output) {
           printf("%s\n", output);
@@ -177,7 +711,14 @@ int main(int argc, char **argv) {
     if (!op.table || !op.where) {
       fprintf(stderr, "Delete operation requires --table or --where\n");
     } else {
-      result = http_client_delete(client, op.table, op.where, &output);
+      if (client.wire) {
+        result = wire_client_delete(client.wire, op.table, op.where, &output);
+      } else if (op.params.count > 0) {
+        result = http_client_execute(client.http, KEY_OP_DELETE, op.table, NULL, op.where,
+                                     &op.params, &output);
+      } else {
+        result = http_client_delete(client.http, op.table, op.where, &output);
+      }
       if (result >= 0) {
         if (output) {
           printf("%s\n", output);
@@ -192,14 +733,35 @@ int main(int argc, char **argv) {
         }
       }
     }
+  } else if (strcmp(operation, KEY_OP_BATCH) == 0) {
+    if (!op.file) {
+      fprintf(stderr, "Batch operation requires --file\n");
+    } else {
+      result = run_batch(&client, &op);
+    }
+  } else if (strcmp(operation, KEY_OP_BULK_CREATE) == 0) {
+    if (!op.table || !op.file) {
+      fprintf(stderr, "Bulk create operation requires --table and --file\n");
+    } else {
+      result = run_bulk_create(&client, &op);
+    }
+  } else if (strcmp(operation, KEY_OP_WATCH) == 0) {
+    if (!op.table) {
+      fprintf(stderr, "Watch operation requires --table\n");
+    } else {
+      result = run_watch(&client, &op);
+    }
   } else {
     fprintf(stderr, "Unknown operation: %s\n", operation);
     print_usage(argv[0]);
   }
+  if (op.timing) {
+    print_timing(&client);
+  }
 
   if (output != NULL) {
     free(output);
   }
-  http_client_cleanup(client);
+  client_cleanup(&client);
   return (result >= 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
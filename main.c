@@ -1,7 +1,10 @@
 // clang-format off
 #include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include "dbmanager_conf.h"
 #include "src/db_manager.h"
 #include "src/http_server.h"
@@ -9,6 +12,16 @@
 // clang-format on
 
 #define DEFAULT_MAX_POOL_SIZE 1
+#define DEFAULT_DB_QUEUE_SIZE 1024
+#define DEFAULT_COMPRESS_MIN_SIZE 1024
+#define DEFAULT_UNIX_SOCKET_MODE 0660
+#define DEFAULT_MAX_PENDING 256
+#define DEFAULT_QUEUE_TARGET_MS 5
+#define DEFAULT_QUEUE_INTERVAL_MS 100
+#define DEFAULT_SLOW_REQUEST_MS 500
+#define DEFAULT_MAX_WATCHERS 8
+#define DEFAULT_WATCH_SERVER_ID 1000
+#define DEFAULT_READ_CACHE_TTL_MS 1000
 
 typedef struct command_op {
   char *db_host;
@@ -16,6 +29,30 @@ typedef struct command_op {
   char *db_password;
   char *db_name;
   int pool_size;
+  http_thread_mode_t http_mode;
+  int http_threads; // 0 表示与连接池大小一致
+  int db_workers;   // -1 表示与连接池大小一致，0 表示在 HTTP 线程上执行查询
+  int db_queue;
+  long compress_min_size;
+  char *unix_socket; // NULL 表示不监听 Unix 域套接字
+  mode_t unix_socket_mode;
+  bool no_tcp;
+  int max_pending;
+  int queue_target_ms;
+  int queue_interval_ms;
+  int slow_request_ms;
+  int binary_port; // 0 表示不监听二进制协议
+  int table_poll_ms; // 0 表示不轮询 information_schema
+  double client_rate; // 0 表示不限速
+  int client_burst;
+  int client_max_active; // 0 表示不限
+  char *client_keys;     // NULL 表示按对端地址识别所有客户端
+  int max_watchers;      // 0 表示不提供变更订阅
+  unsigned int watch_server_id;
+  int read_cache_mb; // 0 表示不缓存 READ 结果
+  int read_cache_ttl_ms;
+  char *read_cache_table_ttls; // NULL 表示各表都用默认 TTL
+  bool no_coalesce_reads;
   bool usage;
 } command_op_t;
 
@@ -35,6 +72,75 @@ static void print_usage(const char *program_name) {
   printf("  --db-name=NAME      Database name\n");
   printf("  --pool-size=SIZE    Database connection pool size (default: %d)\n",
          DEFAULT_MAX_POOL_SIZE);
+  printf("  --http-mode=MODE    HTTP threading mode: single, pool or shard (default: pool)\n");
+  printf("  --http-threads=N    HTTP thread pool size or shard count (default: pool size)\n");
+  printf("  --db-workers=N      DB worker threads, HTTP threads suspend requests and hand them\n"
+         "                      off to workers; 0 runs queries on HTTP threads (default: pool\n"
+         "                      size)\n");
+  printf("  --db-queue=N        Pending DB task queue capacity (default: %d)\n",
+         DEFAULT_DB_QUEUE_SIZE);
+  printf("  --compress-min-size=BYTES\n"
+         "                      Compress responses of at least BYTES with gzip or zstd when\n"
+         "                      the client accepts it, 0 disables compression (default: %d)\n",
+         DEFAULT_COMPRESS_MIN_SIZE);
+  printf("  --unix-socket=PATH  Also listen on a Unix domain socket at PATH\n");
+  printf("  --unix-socket-mode=MODE\n"
+         "                      Octal permissions of the Unix socket file (default: %04o)\n",
+         DEFAULT_UNIX_SOCKET_MODE);
+  printf("  --no-tcp            Do not listen on TCP port %d, requires --unix-socket\n",
+         HTTP_PORT);
+  printf("  --max-pending=N     Requests queued or running at once, more are answered with 503\n"
+         "                      immediately, 0 disables admission control (default: %d)\n",
+         DEFAULT_MAX_PENDING);
+  printf("  --queue-target-ms=MS\n"
+         "                      Queue delay target, once even the fastest request of an\n"
+         "                      interval waits longer only requests that need not queue are\n"
+         "                      admitted (default: %d)\n",
+         DEFAULT_QUEUE_TARGET_MS);
+  printf("  --queue-interval-ms=MS\n"
+         "                      Window to detect a standing queue (default: %d)\n",
+         DEFAULT_QUEUE_INTERVAL_MS);
+  printf("  --slow-request-ms=MS\n"
+         "                      Log the trace ID and phase timings of requests taking at least\n"
+         "                      MS, 0 disables the slow request log (default: %d)\n",
+         DEFAULT_SLOW_REQUEST_MS);
+  printf("  --binary-port=PORT  Also serve the multiplexed binary protocol on PORT (usually %d),\n"
+         "                      many requests may be in flight per connection and complete out\n"
+         "                      of order (default: disabled)\n",
+         WIRE_PORT);
+  printf("  --table-poll-ms=MS  Poll information_schema every MS for writes made by other\n"
+         "                      clients, so their ETags change too, 0 only tracks writes\n"
+         "                      made through the daemon (default: 0)\n");
+  printf("  --client-rate=N     Requests per second per client, identified by a known X-Api-Key\n"
+         "                      header or the peer address, more are answered with 429, may\n"
+         "                      be fractional, 0 disables the limit (default: 0)\n");
+  printf("  --client-burst=N    Requests a client may send at once after being idle\n"
+         "                      (default: one second of --client-rate)\n");
+  printf("  --client-max-active=N\n"
+         "                      Requests per client queued or running at once, more are\n"
+         "                      answered with 429, 0 disables the cap (default: 0)\n");
+  printf("  --client-keys=FILE  API keys, one per line, that get a quota of their own, other\n"
+         "                      X-Api-Key values are ignored and the peer address is used\n"
+         "                      (default: none)\n");
+  printf("  --max-watchers=N    Concurrent operation=watch long polls, each holds its own\n"
+         "                      replication connection, 0 disables watch, at most %d\n"
+         "                      (default: %d)\n",
+         HTTP_MAX_WATCHERS, DEFAULT_MAX_WATCHERS);
+  printf("  --watch-server-id=ID\n"
+         "                      First replica server_id used by watch connections, IDs up to\n"
+         "                      ID + max watchers - 1 must not clash with other replicas\n"
+         "                      (default: %d)\n",
+         DEFAULT_WATCH_SERVER_ID);
+  printf("  --read-cache-mb=MB  Cache encoded READ results in up to MB of memory, any write to a\n"
+         "                      table drops its entries, 0 disables the cache (default: 0)\n");
+  printf("  --read-cache-ttl-ms=MS\n"
+         "                      Longest time a cached result is reused, bounds staleness after\n"
+         "                      writes made by other clients (default: %d)\n",
+         DEFAULT_READ_CACHE_TTL_MS);
+  printf("  --read-cache-table-ttl=TABLE:MS[,TABLE:MS...]\n"
+         "                      Per-table TTL overrides, 0 never caches the table\n");
+  printf("  --no-coalesce-reads Run every READ on its own, instead of answering identical reads\n"
+         "                      that arrive while one is running with its result\n");
 }
 
 /**
@@ -55,6 +161,30 @@ static int parse_command(int argc, char **argv, command_op_t *op) {
                                          {"db-password", required_argument, 0, 'p'},
                                          {"db-name", required_argument, 0, 'n'},
                                          {"pool-size", required_argument, 0, 's'},
+                                         {"http-mode", required_argument, 0, 'm'},
+                                         {"http-threads", required_argument, 0, 't'},
+                                         {"db-workers", required_argument, 0, 'w'},
+                                         {"db-queue", required_argument, 0, 'q'},
+                                         {"compress-min-size", required_argument, 0, 'z'},
+                                         {"unix-socket", required_argument, 0, 'U'},
+                                         {"unix-socket-mode", required_argument, 0, 'M'},
+                                         {"no-tcp", no_argument, 0, 'T'},
+                                         {"max-pending", required_argument, 0, 'P'},
+                                         {"queue-target-ms", required_argument, 0, 'G'},
+                                         {"queue-interval-ms", required_argument, 0, 'I'},
+                                         {"slow-request-ms", required_argument, 0, 'S'},
+                                         {"binary-port", required_argument, 0, 'B'},
+                                         {"table-poll-ms", required_argument, 0, 'W'},
+                                         {"client-rate", required_argument, 0, 'r'},
+                                         {"client-burst", required_argument, 0, 'b'},
+                                         {"client-max-active", required_argument, 0, 'c'},
+                                         {"client-keys", required_argument, 0, 'K'},
+                                         {"max-watchers", required_argument, 0, 'x'},
+                                         {"watch-server-id", required_argument, 0, 'i'},
+                                         {"read-cache-mb", required_argument, 0, 'C'},
+                                         {"read-cache-ttl-ms", required_argument, 0, 'L'},
+                                         {"read-cache-table-ttl", required_argument, 0, 'E'},
+                                         {"no-coalesce-reads", no_argument, 0, 'O'},
                                          {0, 0, 0, 0}};
 
   op->db_host = NULL;
@@ -62,9 +192,35 @@ static int parse_command(int argc, char **argv, command_op_t *op) {
   op->db_password = NULL;
   op->db_name = NULL;
   op->pool_size = DEFAULT_MAX_POOL_SIZE;
+  op->http_mode = HTTP_THREAD_MODE_POOL;
+  op->http_threads = 0;
+  op->db_workers = -1;
+  op->db_queue = DEFAULT_DB_QUEUE_SIZE;
+  op->compress_min_size = DEFAULT_COMPRESS_MIN_SIZE;
+  op->unix_socket = NULL;
+  op->unix_socket_mode = DEFAULT_UNIX_SOCKET_MODE;
+  op->no_tcp = false;
+  op->max_pending = DEFAULT_MAX_PENDING;
+  op->queue_target_ms = DEFAULT_QUEUE_TARGET_MS;
+  op->queue_interval_ms = DEFAULT_QUEUE_INTERVAL_MS;
+  op->slow_request_ms = DEFAULT_SLOW_REQUEST_MS;
+  op->binary_port = 0;
+  op->table_poll_ms = 0;
+  op->client_rate = 0;
+  op->client_burst = 0;
+  op->client_max_active = 0;
+  op->client_keys = NULL;
+  op->max_watchers = DEFAULT_MAX_WATCHERS;
+  op->watch_server_id = DEFAULT_WATCH_SERVER_ID;
+  op->read_cache_mb = 0;
+  op->read_cache_ttl_ms = DEFAULT_READ_CACHE_TTL_MS;
+  op->read_cache_table_ttls = NULL;
+  op->no_coalesce_reads = false;
   op->usage = false;
 
-  while ((c = getopt_long(argc, argv, "hH:u:p:n:s:", long_options, &option_index)) != -1) {
+  while ((c = getopt_long(argc, argv,
+                          "hH:u:p:n:s:m:t:w:q:z:U:M:TP:G:I:S:B:W:r:b:c:K:x:i:C:L:E:O", long_options,
+                          &option_index)) != -1) {
     switch (c) {
     case 'h':
       op->usage = true;
@@ -84,6 +240,156 @@ static int parse_command(int argc, char **argv, command_op_t *op) {
     case 's':
       op->pool_size = atoi(optarg);
       break;
+    case 'm':
+      if (http_thread_mode_parse(optarg, &op->http_mode) != 0) {
+        fprintf(stderr, "Invalid HTTP threading mode: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 't':
+      op->http_threads = atoi(optarg);
+      if (op->http_threads <= 0) {
+        fprintf(stderr, "Invalid HTTP thread count: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'w':
+      op->db_workers = atoi(optarg);
+      if (op->db_workers < 0) {
+        fprintf(stderr, "Invalid DB worker count: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'q':
+      op->db_queue = atoi(optarg);
+      if (op->db_queue <= 0) {
+        fprintf(stderr, "Invalid DB queue capacity: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'z':
+      op->compress_min_size = atol(optarg);
+      if (op->compress_min_size < 0) {
+        fprintf(stderr, "Invalid compression threshold: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'U':
+      op->unix_socket = optarg;
+      break;
+    case 'M': {
+      char *end = NULL;
+      long mode = strtol(optarg, &end, 8);
+      if (*optarg == '\0' || *end != '\0' || mode < 0 || mode > 0777) {
+        fprintf(stderr, "Invalid Unix socket mode: %s\n", optarg);
+        return -1;
+      }
+      op->unix_socket_mode = (mode_t)mode;
+      break;
+    }
+    case 'T':
+      op->no_tcp = true;
+      break;
+    case 'P':
+      op->max_pending = atoi(optarg);
+      if (op->max_pending < 0) {
+        fprintf(stderr, "Invalid max pending requests: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'G':
+      op->queue_target_ms = atoi(optarg);
+      if (op->queue_target_ms < 0) {
+        fprintf(stderr, "Invalid queue delay target: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'I':
+      op->queue_interval_ms = atoi(optarg);
+      if (op->queue_interval_ms <= 0) {
+        fprintf(stderr, "Invalid queue delay interval: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'S':
+      op->slow_request_ms = atoi(optarg);
+      if (op->slow_request_ms < 0) {
+        fprintf(stderr, "Invalid slow request threshold: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'B':
+      op->binary_port = atoi(optarg);
+      if (op->binary_port <= 0 || op->binary_port > 65535) {
+        fprintf(stderr, "Invalid binary protocol port: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'W':
+      op->table_poll_ms = atoi(optarg);
+      if (op->table_poll_ms < 0) {
+        fprintf(stderr, "Invalid table poll interval: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'r':
+      op->client_rate = atof(optarg);
+      if (op->client_rate < 0) {
+        fprintf(stderr, "Invalid client rate: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'b':
+      op->client_burst = atoi(optarg);
+      if (op->client_burst <= 0) {
+        fprintf(stderr, "Invalid client burst: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'c':
+      op->client_max_active = atoi(optarg);
+      if (op->client_max_active < 0) {
+        fprintf(stderr, "Invalid client concurrent request cap: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'K':
+      op->client_keys = optarg;
+      break;
+    case 'x':
+      op->max_watchers = atoi(optarg);
+      if (op->max_watchers < 0 || op->max_watchers > HTTP_MAX_WATCHERS) {
+        fprintf(stderr, "Invalid max watchers: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'i':
+      op->watch_server_id = (unsigned int)strtoul(optarg, NULL, 10);
+      if (op->watch_server_id == 0) {
+        fprintf(stderr, "Invalid watch server id: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'C':
+      op->read_cache_mb = atoi(optarg);
+      if (op->read_cache_mb < 0) {
+        fprintf(stderr, "Invalid read cache size: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'L':
+      op->read_cache_ttl_ms = atoi(optarg);
+      if (op->read_cache_ttl_ms <= 0) {
+        fprintf(stderr, "Invalid read cache TTL: %s\n", optarg);
+        return -1;
+      }
+      break;
+    case 'E':
+      op->read_cache_table_ttls = optarg;
+      break;
+    case 'O':
+      op->no_coalesce_reads = true;
+      break;
     case '?':
       return -1;
     default:
@@ -91,6 +397,11 @@ static int parse_command(int argc, char **argv, command_op_t *op) {
     }
   }
 
+  if (op->no_tcp && !op->unix_socket) {
+    fprintf(stderr, "--no-tcp requires --unix-socket\n");
+    return -1;
+  }
+
   return 0;
 }
 
@@ -104,6 +415,17 @@ int main(int argc, char **argv) {
     return EXIT_SUCCESS;
   }
 
+  // 在创建任何线程之前屏蔽退出信号，所有线程都继承这个掩码，信号只由主线程的 sigwait 接收，
+  // 停止服务器的工作（加锁、join 线程）因此都在普通的线程上下文中进行
+  sigset_t stop_signals;
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  if (pthread_sigmask(SIG_BLOCK, &stop_signals, NULL) != 0) {
+    fprintf(stderr, "failed to block SIGINT and SIGTERM\n");
+    return EXIT_FAILURE;
+  }
+
   if (logger_init(LOG_CONF) == -1) {
     fprintf(stderr, "log initialization failed with config: %s\n", LOG_CONF);
     logger_fini();
@@ -118,8 +440,45 @@ int main(int argc, char **argv) {
     logger_fini();
     return EXIT_FAILURE;
   }
+  if (op.table_poll_ms > 0 && db_manager_watch_tables(db_mgr, op.table_poll_ms) != 0) {
+    LOG_ERROR("Failed to start the table version poller");
+    db_manager_destroy(db_mgr);
+    logger_fini();
+    return EXIT_FAILURE;
+  }
+  if (op.read_cache_mb > 0 &&
+      db_manager_enable_read_cache(db_mgr, (size_t)op.read_cache_mb << 20,
+                                   (uint64_t)op.read_cache_ttl_ms,
+                                   op.read_cache_table_ttls) != 0) {
+    LOG_ERROR("Failed to enable the read cache");
+    db_manager_destroy(db_mgr);
+    logger_fini();
+    return EXIT_FAILURE;
+  }
+  db_manager_coalesce_reads(db_mgr, !op.no_coalesce_reads);
 
-  http_server_t *http_server = http_server_init(db_mgr);
+  http_server_conf_t http_conf;
+  http_conf.thread_mode = op.http_mode;
+  http_conf.num_threads = op.http_threads > 0 ? op.http_threads : op.pool_size;
+  http_conf.num_workers = op.db_workers >= 0 ? op.db_workers : op.pool_size;
+  http_conf.queue_size = op.db_queue;
+  http_conf.compress_min_size = (size_t)op.compress_min_size;
+  http_conf.listen_tcp = !op.no_tcp;
+  http_conf.unix_path = op.unix_socket;
+  http_conf.unix_mode = op.unix_socket_mode;
+  http_conf.max_pending = op.max_pending;
+  http_conf.queue_target_us = (uint64_t)op.queue_target_ms * 1000;
+  http_conf.queue_interval_us = (uint64_t)op.queue_interval_ms * 1000;
+  http_conf.slow_request_us = (uint64_t)op.slow_request_ms * 1000;
+  http_conf.wire_port = op.binary_port;
+  http_conf.client_rate = op.client_rate;
+  http_conf.client_burst = op.client_burst;
+  http_conf.client_max_active = op.client_max_active;
+  http_conf.client_keys = op.client_keys;
+  http_conf.max_watchers = op.max_watchers;
+  http_conf.watch_server_id = op.watch_server_id;
+
+  http_server_t *http_server = http_server_init(db_mgr, &http_conf);
   if (!http_server) {
     LOG_ERROR("Failed to initialize HTTP server");
     db_manager_destroy(db_mgr);
@@ -136,9 +495,12 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
-  LOG_INFO("DB Manager HTTP server is running on port %d", HTTP_PORT);
+  LOG_INFO("DB Manager HTTP server is running");
 
-  pause();
+  int sig = 0;
+  if (sigwait(&stop_signals, &sig) == 0) {
+    LOG_INFO("Received signal %d, shutting down HTTP server...", sig);
+  }
 
   http_server_destroy(http_server);
   db_manager_destroy(db_mgr);
@@ -0,0 +1,222 @@
+// clang-format off
+#include <string.h>
+#include "admission.h"
+#include "src/assert.h"
+#include "src/clock.h"
+#include "src/logger.h"
+// clang-format on
+
+/**
+ * @brief 窗口到期时根据窗口内的最小排队延迟更新过载状态并开启新窗口，调用者需持有锁
+ *
+ * 最小延迟超过目标说明整个窗口内每个请求都在排队，即存在持续排队而不是突发；
+ * 窗口内没有样本说明该阶段空闲
+ *
+ * @param adm 准入控制对象
+ * @param window 观察窗口
+ * @param now_us 当前时间
+ */
+static void window_roll(admission_t *adm, admission_window_t *window, uint64_t now_us) {
+  if (now_us < window->end_us) {
+    return;
+  }
+
+  // 窗口结束后又过了一整个窗口才被检查，说明期间没有流量，旧样本不再代表当前状态
+  bool stale = now_us - window->end_us >= adm->interval_us;
+  bool overloaded = !stale && window->min_delay_us != UINT64_MAX &&
+                    window->min_delay_us > adm->target_us;
+  if (overloaded && !window->overloaded) {
+    LOG_WARN("Queue delay %llu us stayed above target %llu us, shedding load (shed so far: %llu)",
+             (unsigned long long)window->min_delay_us, (unsigned long long)adm->target_us,
+             admission_shed_count(adm));
+  } else if (!overloaded && window->overloaded) {
+    LOG_INFO("Queue delay back under target, accepting requests");
+  }
+  window->overloaded = overloaded;
+  window->min_delay_us = UINT64_MAX;
+  window->end_us = now_us + adm->interval_us;
+}
+
+/**
+ * @brief 是否有任一阶段处于过载状态，调用者需持有锁
+ *
+ * @param adm 准入控制对象
+ * @return true 过载
+ * @return false 未过载
+ */
+static bool overloaded_locked(admission_t *adm) {
+  uint64_t now_us = clock_now_us();
+  bool overloaded = false;
+  for (int i = 0; i < ADMISSION_STAGE_COUNT; ++i) {
+    window_roll(adm, &adm->windows[i], now_us);
+    overloaded = overloaded || adm->windows[i].overloaded;
+  }
+  return overloaded;
+}
+
+/**
+ * @brief 初始化准入控制
+ *
+ * @param adm 准入控制对象
+ * @param max_pending 在途请求上限，0 表示不做准入控制
+ * @param concurrency 能同时执行的请求数
+ * @param target_us 排队延迟目标
+ * @param interval_us 观察窗口长度
+ * @return int 成功（0）；失败（-1）
+ */
+int admission_init(admission_t *adm, int max_pending, int concurrency, uint64_t target_us,
+                   uint64_t interval_us) {
+  DBMNGR_ASSERT(adm);
+  if (max_pending < 0 || concurrency <= 0 || interval_us == 0) {
+    LOG_ERROR("Invalid admission control configuration: max pending=%d, concurrency=%d",
+              max_pending, concurrency);
+    return -1;
+  }
+
+  memset(adm, 0, sizeof(*adm));
+  adm->max_pending = max_pending;
+  adm->concurrency = concurrency;
+  adm->target_us = target_us;
+  adm->interval_us = interval_us;
+  atomic_init(&adm->shed, 0);
+
+  uint64_t now_us = clock_now_us();
+  for (int i = 0; i < ADMISSION_STAGE_COUNT; ++i) {
+    adm->windows[i].end_us = now_us + interval_us;
+    adm->windows[i].min_delay_us = UINT64_MAX;
+    adm->windows[i].overloaded = false;
+  }
+
+  if (pthread_mutex_init(&adm->mutex, NULL) != 0) {
+    LOG_ERROR("Failed to initialize admission control mutex");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 销毁准入控制
+ *
+ * @param adm 准入控制对象
+ */
+void admission_destroy(admission_t *adm) {
+  if (adm) {
+    pthread_mutex_destroy(&adm->mutex);
+  }
+}
+
+/**
+ * @brief 尝试接纳一个请求，成功后必须调用 admission_leave()
+ *
+ * 在途请求达到上限时拒绝；存在持续排队时只接纳无需排队就能执行的请求
+ *
+ * @param adm 准入控制对象
+ * @return true 接纳
+ * @return false 拒绝
+ */
+bool admission_enter(admission_t *adm) {
+  if (adm->max_pending == 0) {
+    return true;
+  }
+
+  pthread_mutex_lock(&adm->mutex);
+  int limit = overloaded_locked(adm) && adm->concurrency < adm->max_pending ? adm->concurrency
+                                                                           : adm->max_pending;
+  bool admitted = adm->pending < limit;
+  if (admitted) {
+    ++adm->pending;
+  }
+  pthread_mutex_unlock(&adm->mutex);
+
+  if (!admitted) {
+    admission_shed(adm);
+  }
+  return admitted;
+}
+
+/**
+ * @brief 已接纳的请求处理结束
+ *
+ * @param adm 准入控制对象
+ */
+void admission_leave(admission_t *adm) {
+  if (adm->max_pending == 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&adm->mutex);
+  DBMNGR_ASSERT(adm->pending > 0);
+  --adm->pending;
+  pthread_mutex_unlock(&adm->mutex);
+}
+
+/**
+ * @brief 记录一个请求在某个阶段的排队延迟
+ *
+ * @param adm 准入控制对象
+ * @param stage 排队阶段
+ * @param delay_us 排队延迟
+ */
+void admission_record_delay(admission_t *adm, admission_stage_t stage, uint64_t delay_us) {
+  if (adm->max_pending == 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&adm->mutex);
+  admission_window_t *window = &adm->windows[stage];
+  window_roll(adm, window, clock_now_us());
+  if (delay_us < window->min_delay_us) {
+    window->min_delay_us = delay_us;
+  }
+  pthread_mutex_unlock(&adm->mutex);
+}
+
+/**
+ * @brief 是否存在持续排队
+ *
+ * @param adm 准入控制对象
+ * @return true 过载
+ * @return false 未过载
+ */
+bool admission_overloaded(admission_t *adm) {
+  if (adm->max_pending == 0) {
+    return false;
+  }
+
+  pthread_mutex_lock(&adm->mutex);
+  bool overloaded = overloaded_locked(adm);
+  pthread_mutex_unlock(&adm->mutex);
+  return overloaded;
+}
+
+/**
+ * @brief 记录一个在准入之后被拒绝的请求（例如任务队列已满）
+ *
+ * @param adm 准入控制对象
+ */
+void admission_shed(admission_t *adm) {
+  atomic_fetch_add_explicit(&adm->shed, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief 累计拒绝的请求数
+ *
+ * @param adm 准入控制对象
+ * @return unsigned long long 请求数
+ */
+unsigned long long admission_shed_count(admission_t *adm) {
+  return atomic_load_explicit(&adm->shed, memory_order_relaxed);
+}
+
+/**
+ * @brief 在途请求数，未启用准入控制时不统计，恒为 0
+ *
+ * @param adm 准入控制对象
+ * @return int 请求数
+ */
+int admission_pending(admission_t *adm) {
+  pthread_mutex_lock(&adm->mutex);
+  int pending = adm->pending;
+  pthread_mutex_unlock(&adm->mutex);
+  return pending;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// clang-format off
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+// clang-format on
+
+// 拒绝请求时建议客户端等待的秒数（Retry-After）
+#define ADMISSION_RETRY_AFTER_SEC 1
+
+// 排队阶段，每个阶段独立判断是否存在持续排队
+typedef enum {
+  ADMISSION_STAGE_QUEUE = 0,   // 数据库任务队列
+  ADMISSION_STAGE_CONNECTION,  // 等待连接池空闲连接
+  ADMISSION_STAGE_COUNT,
+} admission_stage_t;
+
+// CoDel 观察窗口
+typedef struct {
+  uint64_t end_us;       // 当前窗口结束时间
+  uint64_t min_delay_us; // 当前窗口内最小排队延迟，UINT64_MAX 表示没有样本
+  bool overloaded;       // 上一个窗口的最小排队延迟超过目标
+} admission_window_t;
+
+typedef struct {
+  int max_pending;      // 在途请求（排队 + 执行）上限，0 表示不做准入控制
+  int concurrency;      // 能同时执行的请求数，过载时只接纳不需要排队的请求
+  uint64_t target_us;   // 排队延迟目标
+  uint64_t interval_us; // 观察窗口长度
+  pthread_mutex_t mutex;
+  int pending;
+  admission_window_t windows[ADMISSION_STAGE_COUNT];
+  atomic_ullong shed; // 累计拒绝的请求数
+} admission_t;
+
+int admission_init(admission_t *adm, int max_pending, int concurrency, uint64_t target_us,
+                   uint64_t interval_us);
+void admission_destroy(admission_t *adm);
+bool admission_enter(admission_t *adm);
+void admission_leave(admission_t *adm);
+void admission_record_delay(admission_t *adm, admission_stage_t stage, uint64_t delay_us);
+bool admission_overloaded(admission_t *adm);
+void admission_shed(admission_t *adm);
+unsigned long long admission_shed_count(admission_t *adm);
+int admission_pending(admission_t *adm);
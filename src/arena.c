@@ -0,0 +1,253 @@
+// clang-format off
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+// clang-format on
+
+#define ARENA_ALIGN alignof(max_align_t)
+#define ARENA_ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+struct arena_block {
+  arena_block_t *next;
+  char *ptr; // 下一次分配的位置
+  char *end;
+};
+
+struct arena_owned {
+  void *ptr;
+  arena_owned_t *next;
+};
+
+// 块头之后的数据区起始位置
+#define BLOCK_DATA(block) ((char *)(block) + ARENA_ALIGN_UP(sizeof(arena_block_t)))
+// 与区域对象一起分配的首块
+#define FIRST_BLOCK(arena) ((arena_block_t *)((char *)(arena) + ARENA_ALIGN_UP(sizeof(arena_t))))
+
+/**
+ * @brief 创建内存区域，区域对象和首块在同一次 malloc 中分配
+ *
+ * @param block_size 每个块的数据区大小
+ * @return arena_t* 内存区域；失败返回 NULL
+ */
+arena_t *arena_create(size_t block_size) {
+  block_size = ARENA_ALIGN_UP(block_size);
+  arena_t *arena = malloc(ARENA_ALIGN_UP(sizeof(arena_t)) +
+                          ARENA_ALIGN_UP(sizeof(arena_block_t)) + block_size);
+  if (!arena) {
+    return NULL;
+  }
+
+  arena_block_t *block = FIRST_BLOCK(arena);
+  block->next = NULL;
+  block->ptr = BLOCK_DATA(block);
+  block->end = block->ptr + block_size;
+
+  arena->head = block;
+  arena->owned = NULL;
+  arena->last = NULL;
+  arena->block_size = block_size;
+  arena->num_allocs = 0;
+  arena->num_blocks = 1;
+  arena->bytes = 0;
+  return arena;
+}
+
+/**
+ * @brief 申请新块；大于块大小四分之一的分配独占一个块，挂在当前块之后，不浪费当前块的剩余空间
+ *
+ * @param arena 内存区域
+ * @param size 需要的大小（已对齐）
+ * @return arena_block_t* 新块；失败返回 NULL
+ */
+static arena_block_t *arena_new_block(arena_t *arena, size_t size) {
+  bool dedicated = size > arena->block_size / 4;
+  size_t data_size = dedicated ? size : arena->block_size;
+  arena_block_t *block = malloc(ARENA_ALIGN_UP(sizeof(arena_block_t)) + data_size);
+  if (!block) {
+    return NULL;
+  }
+  block->ptr = BLOCK_DATA(block);
+  block->end = block->ptr + data_size;
+  ++arena->num_blocks;
+
+  if (dedicated) {
+    block->next = arena->head->next;
+    arena->head->next = block;
+  } else {
+    block->next = arena->head;
+    arena->head = block;
+  }
+  return block;
+}
+
+/**
+ * @brief 分配内存，按 max_align_t 对齐
+ *
+ * @param arena 内存区域
+ * @param size 大小
+ * @return void* 内存；失败返回 NULL
+ */
+void *arena_alloc(arena_t *arena, size_t size) {
+  size_t aligned = ARENA_ALIGN_UP(size ? size : 1);
+  arena_block_t *block = arena->head;
+  if ((size_t)(block->end - block->ptr) < aligned) {
+    block = arena_new_block(arena, aligned);
+    if (!block) {
+      return NULL;
+    }
+  }
+
+  void *ptr = block->ptr;
+  block->ptr += aligned;
+  // 独占块分配完就满了，不能原地扩展
+  arena->last = block == arena->head ? ptr : NULL;
+  ++arena->num_allocs;
+  arena->bytes += size;
+  return ptr;
+}
+
+/**
+ * @brief 分配并清零
+ *
+ * @param arena 内存区域
+ * @param size 大小
+ * @return void* 内存；失败返回 NULL
+ */
+void *arena_calloc(arena_t *arena, size_t size) {
+  void *ptr = arena_alloc(arena, size);
+  if (ptr) {
+    memset(ptr, 0, size);
+  }
+  return ptr;
+}
+
+/**
+ * @brief 扩大一次分配；是最近一次分配且当前块放得下时原地扩展，否则重新分配并复制
+ *
+ * @param arena 内存区域
+ * @param ptr 原内存，为 NULL 时等同于 arena_alloc()
+ * @param old_size 原大小
+ * @param new_size 新大小
+ * @return void* 新内存；失败返回 NULL，原内存保持不变
+ */
+void *arena_grow(arena_t *arena, void *ptr, size_t old_size, size_t new_size) {
+  if (!ptr) {
+    return arena_alloc(arena, new_size);
+  }
+  if (new_size <= old_size) {
+    return ptr;
+  }
+
+  if (ptr == arena->last) {
+    arena_block_t *block = arena->head;
+    char *new_end = (char *)ptr + ARENA_ALIGN_UP(new_size);
+    if (new_end <= block->end) {
+      block->ptr = new_end;
+      arena->bytes += new_size - old_size;
+      return ptr;
+    }
+  }
+
+  void *new_ptr = arena_alloc(arena, new_size);
+  if (new_ptr) {
+    memcpy(new_ptr, ptr, old_size);
+  }
+  return new_ptr;
+}
+
+/**
+ * @brief 复制字符串
+ *
+ * @param arena 内存区域
+ * @param str 字符串
+ * @return char* 副本；失败返回 NULL
+ */
+char *arena_strdup(arena_t *arena, const char *str) {
+  size_t len = strlen(str);
+  char *ptr = arena_alloc(arena, len + 1);
+  if (ptr) {
+    memcpy(ptr, str, len + 1);
+  }
+  return ptr;
+}
+
+/**
+ * @brief 格式化字符串，先尝试直接写入当前块的剩余空间，放不下时再按实际长度分配
+ *
+ * @param arena 内存区域
+ * @param fmt 格式
+ * @return char* 字符串；失败返回 NULL
+ */
+char *arena_sprintf(arena_t *arena, const char *fmt, ...) {
+  arena_block_t *block = arena->head;
+  size_t avail = (size_t)(block->end - block->ptr);
+
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(block->ptr, avail, fmt, args);
+  va_end(args);
+  if (len < 0) {
+    return NULL;
+  }
+
+  // 剩余空间是对齐单位的整数倍，放得下时 arena_alloc() 返回的正是刚写入的位置
+  char *ptr = arena_alloc(arena, (size_t)len + 1);
+  if ((size_t)len < avail) {
+    return ptr;
+  }
+  if (!ptr) {
+    return NULL;
+  }
+  va_start(args, fmt);
+  vsnprintf(ptr, (size_t)len + 1, fmt, args);
+  va_end(args);
+  return ptr;
+}
+
+/**
+ * @brief 托管一块堆内存（malloc 分配），销毁内存区域时一起释放
+ *
+ * @param arena 内存区域
+ * @param ptr 堆内存
+ * @return int 成功（0）；失败（-1），此时 ptr 仍由调用者负责释放
+ */
+int arena_own(arena_t *arena, void *ptr) {
+  arena_owned_t *owned = arena_alloc(arena, sizeof(arena_owned_t));
+  if (!owned) {
+    return -1;
+  }
+  owned->ptr = ptr;
+  owned->next = arena->owned;
+  arena->owned = owned;
+  return 0;
+}
+
+/**
+ * @brief 销毁内存区域，释放所有块和托管的堆内存
+ *
+ * @param arena 内存区域
+ */
+void arena_destroy(arena_t *arena) {
+  if (!arena) {
+    return;
+  }
+
+  for (arena_owned_t *owned = arena->owned; owned; owned = owned->next) {
+    free(owned->ptr);
+  }
+
+  // 首块与区域对象一起分配，随区域对象释放
+  arena_block_t *block = arena->head;
+  while (block) {
+    arena_block_t *next = block->next;
+    if (block != FIRST_BLOCK(arena)) {
+      free(block);
+    }
+    block = next;
+  }
+  free(arena);
+}
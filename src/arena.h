@@ -0,0 +1,29 @@
+#pragma once
+
+// clang-format off
+#include <stdarg.h>
+#include <stddef.h>
+// clang-format on
+
+typedef struct arena_block arena_block_t;
+typedef struct arena_owned arena_owned_t;
+
+// 单调分配（bump）的内存区域：只分配不单独释放，销毁时一次性归还
+typedef struct {
+  arena_block_t *head;   // 当前分配所在的块
+  arena_owned_t *owned;  // 托管的堆内存，销毁时释放
+  void *last;            // 最近一次分配，可原地扩展
+  size_t block_size;
+  size_t num_allocs;  // 分配次数
+  size_t num_blocks;  // 向堆申请内存的次数（包括首块）
+  size_t bytes;       // 已分配的字节数
+} arena_t;
+
+arena_t *arena_create(size_t block_size);
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_calloc(arena_t *arena, size_t size);
+void *arena_grow(arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+char *arena_strdup(arena_t *arena, const char *str);
+char *arena_sprintf(arena_t *arena, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+int arena_own(arena_t *arena, void *ptr);
+void arena_destroy(arena_t *arena);
@@ -0,0 +1,253 @@
+// clang-format off
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+#include "src/key.h"
+#include "src/logger.h"
+#include "src/operation.h"
+#include "src/result_encoder.h"
+#include "src/strbuf.h"
+// clang-format on
+
+/**
+ * @brief 初始化批量请求
+ *
+ * @param batch 批量请求
+ * @param arena 条目及其字段所在的内存区域，随区域一起释放
+ */
+void batch_init(batch_t *batch, arena_t *arena) {
+  batch->arena = arena;
+  batch->items = NULL;
+  batch->num_items = 0;
+  batch->cap_items = 0;
+  batch->transaction = false;
+}
+
+/**
+ * @brief 追加一个空条目
+ *
+ * @param batch 批量请求
+ * @return batch_item_t* 新条目，超过 BATCH_MAX_ITEMS 或内存不足返回 NULL
+ */
+batch_item_t *batch_add_item(batch_t *batch) {
+  if (batch->num_items >= BATCH_MAX_ITEMS) {
+    LOG_WARN("Batch exceeds %d items", BATCH_MAX_ITEMS);
+    return NULL;
+  }
+
+  if (batch->num_items == batch->cap_items) {
+    size_t new_cap = batch->cap_items ? batch->cap_items * 2 : 8;
+    batch_item_t *ptr = arena_grow(batch->arena, batch->items,
+                                   batch->cap_items * sizeof(batch_item_t),
+                                   new_cap * sizeof(batch_item_t));
+    if (!ptr) {
+      LOG_ERROR("Failed to allocate memory for batch items");
+      return NULL;
+    }
+    batch->items = ptr;
+    batch->cap_items = new_cap;
+  }
+
+  batch_item_t *item = &batch->items[batch->num_items++];
+  memset(item, 0, sizeof(batch_item_t));
+  return item;
+}
+
+/**
+ * @brief 获取最后一个条目
+ *
+ * @param batch 批量请求
+ * @return batch_item_t* 最后一个条目，没有条目返回 NULL
+ */
+batch_item_t *batch_last_item(batch_t *batch) {
+  return batch->num_items ? &batch->items[batch->num_items - 1] : NULL;
+}
+
+/**
+ * @brief 输出操作失败的信息
+ *
+ * @param out 输出缓冲区
+ * @param db_mgr 数据库管理对象
+ * @param op_name 操作名
+ * @return int 成功（0）；失败（-1）
+ */
+static int append_failure(strbuf_t *out, db_manager_t *db_mgr, const char *op_name) {
+  const char *last_error = db_manager_last_error(db_mgr);
+  if (last_error) {
+    return strbuf_appendf(out, "%s %s operation failed: %s", KEY_RESP_ERROR, op_name, last_error);
+  }
+  return strbuf_appendf(out, "%s %s operation failed", KEY_RESP_ERROR, op_name);
+}
+
+/**
+ * @brief 将查询结果编码为文本表格
+ *
+ * @param out 输出缓冲区
+ * @param result 结果集
+ * @return int 成功（0）；失败（-1）
+ */
+static int append_result(strbuf_t *out, db_result_t *result) {
+  MYSQL_FIELD *fields = result->mysql_res ? mysql_fetch_fields(result->mysql_res) : NULL;
+  result_encoder_t encoder;
+  result_encoder_init(&encoder, RESULT_FORMAT_TEXT, fields, result->num_fields);
+  if (result_encoder_begin(&encoder, out) != 0) {
+    return -1;
+  }
+
+  MYSQL_ROW row;
+  while (result->mysql_res && (row = mysql_fetch_row(result->mysql_res)) != NULL) {
+    if (result_encoder_row(&encoder, row, mysql_fetch_lengths(result->mysql_res), out) != 0) {
+      return -1;
+    }
+  }
+  return result_encoder_end(&encoder, out);
+}
+
+/**
+ * @brief 在会话中执行一个条目，输出与单个操作相同格式的响应
+ *
+ * @param session 会话
+ * @param item 条目
+ * @param out 输出缓冲区
+ * @param ok 输出条目是否执行成功
+ * @return int 成功（0）；内存不足（-1）
+ */
+static int execute_item(db_session_t *session, const batch_item_t *item, strbuf_t *out, bool *ok) {
+  db_manager_t *db_mgr = session->manager;
+  *ok = false;
+
+  if (!item->operation || !item->table) {
+    return strbuf_append_str(out, KEY_RESP_ERROR " Missing required fields: operation, table");
+  }
+
+  switch (db_op_from_str(item->operation)) {
+  case DB_OP_CREATE: {
+    if (!item->data) {
+      return strbuf_append_str(out, KEY_RESP_ERROR " Missing data field for create operation");
+    }
+    int result = db_session_create_row(session, item->table, item->data);
+    if (result < 0) {
+      return append_failure(out, db_mgr, "Create");
+    }
+    *ok = true;
+    return strbuf_appendf(out, "%s Created %d row(s)", KEY_RESP_SUCCESS, result);
+  }
+  case DB_OP_READ: {
+    db_result_t *result = db_session_read_row(session, item->table, item->where);
+    if (!result) {
+      return append_failure(out, db_mgr, "Read");
+    }
+    int rc = append_result(out, result);
+    db_result_free(result);
+    *ok = (rc == 0);
+    return rc;
+  }
+  case DB_OP_UPDATE: {
+    if (!item->data || !item->where) {
+      return strbuf_append_str(out,
+                               KEY_RESP_ERROR " Missing data or where field for update operation");
+    }
+    int result = db_session_update_row(session, item->table, item->data, item->where);
+    if (result < 0) {
+      return append_failure(out, db_mgr, "Update");
+    }
+    *ok = true;
+    return strbuf_appendf(out, "%s Updated %d row(s)", KEY_RESP_SUCCESS, result);
+  }
+  case DB_OP_DELETE: {
+    if (!item->where) {
+      return strbuf_append_str(out, KEY_RESP_ERROR " Missing where field for delete operation");
+    }
+    int result = db_session_delete_row(session, item->table, item->where);
+    if (result < 0) {
+      return append_failure(out, db_mgr, "Delete");
+    }
+    *ok = true;
+    return strbuf_appendf(out, "%s Deleted %d row(s)", KEY_RESP_SUCCESS, result);
+  }
+  default:
+    return strbuf_appendf(out, "%s Unknown operation: %s", KEY_RESP_ERROR, item->operation);
+  }
+}
+
+/**
+ * @brief 在同一个连接上按顺序执行全部条目
+ *
+ * 事务模式下遇到第一个失败的条目即回滚并停止，否则每个条目独立执行
+ *
+ * @param db_mgr 数据库管理对象
+ * @param batch 批量请求
+ * @return char* 响应，内存不足返回 NULL
+ */
+char *batch_execute(db_manager_t *db_mgr, const batch_t *batch) {
+  if (batch->num_items == 0) {
+    return strdup(KEY_RESP_ERROR " Batch contains no items");
+  }
+
+  LOG_INFO("Processing batch of %zu item(s)%s", batch->num_items,
+           batch->transaction ? " in a transaction" : "");
+
+  db_session_t *session = db_session_begin(db_mgr, batch->transaction);
+  if (!session) {
+    strbuf_t out;
+    strbuf_init(&out);
+    append_failure(&out, db_mgr, "Batch");
+    return strbuf_detach(&out);
+  }
+
+  strbuf_t items, item;
+  strbuf_init(&items);
+  strbuf_init(&item);
+  size_t executed = 0, failed = 0;
+  bool oom = false;
+  for (size_t i = 0; i < batch->num_items; ++i) {
+    bool ok;
+    strbuf_reset(&item);
+    if (execute_item(session, &batch->items[i], &item, &ok) != 0 ||
+        strbuf_appendf(&items, "%s %zu %zu\n", KEY_RESP_ITEM, i + 1, item.len) != 0 ||
+        strbuf_append(&items, item.data, item.len) != 0 || strbuf_append_char(&items, '\n') != 0) {
+      oom = true;
+      break;
+    }
+    ++executed;
+    if (!ok) {
+      ++failed;
+      if (batch->transaction) {
+        break;
+      }
+    }
+  }
+  strbuf_free(&item);
+
+  // 事务模式下只有全部成功才提交
+  bool commit = !oom && failed == 0;
+  int end_rc = db_session_end(session, commit);
+
+  strbuf_t out;
+  strbuf_init(&out);
+  int rc;
+  if (oom) {
+    LOG_ERROR("Failed to allocate memory for batch response");
+    rc = -1;
+  } else if (batch->transaction && failed > 0) {
+    rc = strbuf_appendf(&out, "%s Batch failed at item %zu, transaction rolled back\n",
+                        KEY_RESP_ERROR, executed);
+  } else if (end_rc != 0) {
+    const char *last_error = db_manager_last_error(db_mgr);
+    rc = strbuf_appendf(&out, "%s Batch commit failed: %s\n", KEY_RESP_ERROR,
+                        last_error ? last_error : "unknown error");
+  } else {
+    rc = strbuf_appendf(&out, "%s Batch executed %zu item(s), %zu failed\n", KEY_RESP_SUCCESS,
+                        executed, failed);
+  }
+  if (rc == 0) {
+    rc = strbuf_append(&out, items.data, items.len);
+  }
+  strbuf_free(&items);
+
+  if (rc != 0) {
+    strbuf_free(&out);
+    return NULL;
+  }
+  return strbuf_detach(&out);
+}
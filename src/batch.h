@@ -0,0 +1,34 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+#include "src/arena.h"
+#include "src/db_manager.h"
+// clang-format on
+
+// 单个请求中最多的操作数
+#define BATCH_MAX_ITEMS 1000
+
+// 批量响应格式：
+//   首行：success: / error: 开头的汇总
+//   每个已执行的条目：item <序号> <长度>\n<与单个操作相同的响应，共 <长度> 字节>\n
+typedef struct {
+  char *operation;
+  char *table;
+  char *data;
+  char *where;
+} batch_item_t;
+
+typedef struct {
+  arena_t *arena;
+  batch_item_t *items;
+  size_t num_items;
+  size_t cap_items;
+  bool transaction; // 所有条目在同一个事务中执行，任一失败则全部回滚
+} batch_t;
+
+void batch_init(batch_t *batch, arena_t *arena);
+batch_item_t *batch_add_item(batch_t *batch);
+batch_item_t *batch_last_item(batch_t *batch);
+char *batch_execute(db_manager_t *db_mgr, const batch_t *batch);
@@ -0,0 +1,898 @@
+// clang-format off
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <mysql/mysql.h>
+#include "binlog.h"
+#include "src/json_escape.h"
+#include "src/logger.h"
+// clang-format on
+
+// FORMAT_DESCRIPTION 事件中的校验和算法
+#define BINLOG_CHECKSUM_ALG_CRC32 1
+#define BINLOG_CHECKSUM_LEN 4
+
+// TABLE_MAP 事件的可选元数据类型
+#define TABLE_META_SIGNEDNESS 1
+#define TABLE_META_COLUMN_NAME 4
+
+// 按事件内容顺序读取的游标，越界时读取失败
+typedef struct {
+  const unsigned char *ptr;
+  size_t left;
+} reader_t;
+
+static int read_bytes(reader_t *r, size_t n, const unsigned char **out) {
+  if (r->left < n) {
+    return -1;
+  }
+  *out = r->ptr;
+  r->ptr += n;
+  r->left -= n;
+  return 0;
+}
+
+static int skip_bytes(reader_t *r, size_t n) {
+  const unsigned char *ignored;
+  return read_bytes(r, n, &ignored);
+}
+
+// 小端无符号整数
+static int read_uint(reader_t *r, size_t n, uint64_t *out) {
+  const unsigned char *bytes;
+  if (read_bytes(r, n, &bytes) != 0) {
+    return -1;
+  }
+  uint64_t value = 0;
+  for (size_t i = 0; i < n; ++i) {
+    value |= (uint64_t)bytes[i] << (8 * i);
+  }
+  *out = value;
+  return 0;
+}
+
+// 大端无符号整数，时间类型和 DECIMAL 使用
+static uint64_t be_uint(const unsigned char *bytes, size_t n) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < n; ++i) {
+    value = value << 8 | bytes[i];
+  }
+  return value;
+}
+
+// 长度编码整数
+static int read_lenenc(reader_t *r, uint64_t *out) {
+  uint64_t first;
+  if (read_uint(r, 1, &first) != 0) {
+    return -1;
+  }
+  switch (first) {
+  case 0xFC:
+    return read_uint(r, 2, out);
+  case 0xFD:
+    return read_uint(r, 3, out);
+  case 0xFE:
+    return read_uint(r, 8, out);
+  case 0xFB:
+  case 0xFF:
+    return -1;
+  default:
+    *out = first;
+    return 0;
+  }
+}
+
+static char *dup_bytes(const unsigned char *data, size_t len) {
+  char *str = malloc(len + 1);
+  if (str) {
+    memcpy(str, data, len);
+    str[len] = '\0';
+  }
+  return str;
+}
+
+static void table_free(binlog_table_t *table) {
+  if (table->names) {
+    for (size_t i = 0; i < table->num_columns; ++i) {
+      free(table->names[i]);
+    }
+  }
+  free(table->names);
+  free(table->table);
+  free(table->types);
+  free(table->meta);
+  free(table->is_unsigned);
+  memset(table, 0, sizeof(binlog_table_t));
+}
+
+static void clear_tables(binlog_decoder_t *dec) {
+  for (size_t i = 0; i < dec->num_tables; ++i) {
+    table_free(&dec->tables[i]);
+  }
+  dec->num_tables = 0;
+}
+
+/**
+ * @brief 初始化解码器
+ *
+ * @param dec 解码器
+ * @param db 库名
+ * @param table 表名
+ * @return int 成功（0）；失败（-1）
+ */
+int binlog_decoder_init(binlog_decoder_t *dec, const char *db, const char *table) {
+  memset(dec, 0, sizeof(binlog_decoder_t));
+  strbuf_init(&dec->pending);
+  dec->db = strdup(db);
+  dec->table = strdup(table);
+  if (!dec->db || !dec->table) {
+    binlog_decoder_free(dec);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 释放解码器
+ *
+ * @param dec 解码器
+ */
+void binlog_decoder_free(binlog_decoder_t *dec) {
+  clear_tables(dec);
+  free(dec->tables);
+  free(dec->db);
+  free(dec->table);
+  strbuf_free(&dec->pending);
+  memset(dec, 0, sizeof(binlog_decoder_t));
+}
+
+static binlog_table_t *find_table(binlog_decoder_t *dec, uint64_t table_id) {
+  for (size_t i = 0; i < dec->num_tables; ++i) {
+    if (dec->tables[i].table_id == table_id) {
+      return &dec->tables[i];
+    }
+  }
+  return NULL;
+}
+
+static bool is_numeric_type(unsigned char type) {
+  switch (type) {
+  case MYSQL_TYPE_TINY:
+  case MYSQL_TYPE_SHORT:
+  case MYSQL_TYPE_INT24:
+  case MYSQL_TYPE_LONG:
+  case MYSQL_TYPE_LONGLONG:
+  case MYSQL_TYPE_NEWDECIMAL:
+  case MYSQL_TYPE_FLOAT:
+  case MYSQL_TYPE_DOUBLE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief 读取一列的元数据；CHAR、ENUM、SET、DECIMAL 按 (byte0 << 8) | byte1 保存，
+ *        VARCHAR、BIT 按小端保存
+ */
+static int read_column_meta(reader_t *r, unsigned char type, uint16_t *meta) {
+  const unsigned char *bytes;
+  switch (type) {
+  case MYSQL_TYPE_FLOAT:
+  case MYSQL_TYPE_DOUBLE:
+  case MYSQL_TYPE_BLOB:
+  case MYSQL_TYPE_JSON:
+  case MYSQL_TYPE_GEOMETRY:
+  case MYSQL_TYPE_TIMESTAMP2:
+  case MYSQL_TYPE_DATETIME2:
+  case MYSQL_TYPE_TIME2:
+    if (read_bytes(r, 1, &bytes) != 0) {
+      return -1;
+    }
+    *meta = bytes[0];
+    return 0;
+  case MYSQL_TYPE_VARCHAR:
+  case MYSQL_TYPE_VAR_STRING:
+  case MYSQL_TYPE_BIT:
+    if (read_bytes(r, 2, &bytes) != 0) {
+      return -1;
+    }
+    *meta = (uint16_t)(bytes[0] | bytes[1] << 8);
+    return 0;
+  case MYSQL_TYPE_STRING:
+  case MYSQL_TYPE_ENUM:
+  case MYSQL_TYPE_SET:
+  case MYSQL_TYPE_NEWDECIMAL:
+    if (read_bytes(r, 2, &bytes) != 0) {
+      return -1;
+    }
+    *meta = (uint16_t)(bytes[0] << 8 | bytes[1]);
+    return 0;
+  default:
+    *meta = 0;
+    return 0;
+  }
+}
+
+/**
+ * @brief 解析 TABLE_MAP 的可选元数据，取出数值列的符号和列名
+ */
+static int read_optional_meta(reader_t *r, binlog_table_t *table) {
+  while (r->left > 0) {
+    uint64_t type, len;
+    const unsigned char *value;
+    if (read_uint(r, 1, &type) != 0 || read_lenenc(r, &len) != 0 ||
+        read_bytes(r, len, &value) != 0) {
+      return -1;
+    }
+
+    if (type == TABLE_META_SIGNEDNESS) {
+      // 每个数值列一位，高位在前，1 表示无符号
+      size_t bit = 0;
+      for (size_t i = 0; i < table->num_columns; ++i) {
+        if (!is_numeric_type(table->types[i])) {
+          continue;
+        }
+        if (bit / 8 < len) {
+          table->is_unsigned[i] = (value[bit / 8] >> (7 - bit % 8)) & 1;
+        }
+        ++bit;
+      }
+    } else if (type == TABLE_META_COLUMN_NAME) {
+      reader_t names = {value, len};
+      table->names = calloc(table->num_columns, sizeof(char *));
+      if (!table->names) {
+        return -1;
+      }
+      for (size_t i = 0; i < table->num_columns; ++i) {
+        uint64_t name_len;
+        const unsigned char *name;
+        if (read_lenenc(&names, &name_len) != 0 || read_bytes(&names, name_len, &name) != 0 ||
+            !(table->names[i] = dup_bytes(name, name_len))) {
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief 解析 TABLE_MAP 事件
+ */
+static int decode_table_map(binlog_decoder_t *dec, reader_t *r) {
+  uint64_t table_id, db_len, table_len, num_columns, meta_len;
+  const unsigned char *db, *name, *types, *meta;
+  if (read_uint(r, 6, &table_id) != 0 || skip_bytes(r, 2) != 0 || read_uint(r, 1, &db_len) != 0 ||
+      read_bytes(r, db_len, &db) != 0 || skip_bytes(r, 1) != 0 ||
+      read_uint(r, 1, &table_len) != 0 || read_bytes(r, table_len, &name) != 0 ||
+      skip_bytes(r, 1) != 0 || read_lenenc(r, &num_columns) != 0 ||
+      read_bytes(r, num_columns, &types) != 0 || read_lenenc(r, &meta_len) != 0 ||
+      read_bytes(r, meta_len, &meta) != 0 || skip_bytes(r, (num_columns + 7) / 8) != 0) {
+    return -1;
+  }
+
+  binlog_table_t *table = find_table(dec, table_id);
+  if (table) {
+    table_free(table);
+  } else {
+    if (dec->num_tables == dec->cap_tables) {
+      size_t cap = dec->cap_tables ? dec->cap_tables * 2 : 4;
+      binlog_table_t *tables = realloc(dec->tables, cap * sizeof(binlog_table_t));
+      if (!tables) {
+        return -1;
+      }
+      dec->tables = tables;
+      dec->cap_tables = cap;
+    }
+    table = &dec->tables[dec->num_tables++];
+    memset(table, 0, sizeof(binlog_table_t));
+  }
+  table->table_id = table_id;
+  table->matched = db_len == strlen(dec->db) && memcmp(db, dec->db, db_len) == 0 &&
+                   table_len == strlen(dec->table) && memcmp(name, dec->table, table_len) == 0;
+  if (!table->matched) {
+    // 其他表的行事件直接跳过，不必解析列信息
+    return 0;
+  }
+
+  table->num_columns = num_columns;
+  table->table = dup_bytes(name, table_len);
+  table->types = malloc(num_columns ? num_columns : 1);
+  table->meta = calloc(num_columns ? num_columns : 1, sizeof(uint16_t));
+  table->is_unsigned = calloc(num_columns ? num_columns : 1, 1);
+  if (!table->table || !table->types || !table->meta || !table->is_unsigned) {
+    return -1;
+  }
+  memcpy(table->types, types, num_columns);
+
+  reader_t meta_reader = {meta, meta_len};
+  for (size_t i = 0; i < num_columns; ++i) {
+    if (read_column_meta(&meta_reader, types[i], &table->meta[i]) != 0) {
+      return -1;
+    }
+  }
+  return read_optional_meta(r, table);
+}
+
+/**
+ * @brief 输出 DECIMAL 列：binlog 中是按每 9 位十进制数一组的大端二进制，
+ *        首字节最高位取反作为符号，负数的所有字节再取反
+ */
+static int append_decimal(reader_t *r, uint16_t meta, strbuf_t *out) {
+  static const int dig2bytes[10] = {0, 1, 1, 2, 2, 3, 3, 4, 4, 4};
+  int precision = meta >> 8;
+  int scale = meta & 0xFF;
+  if (scale > precision || precision > 65) {
+    return -1;
+  }
+  int intg = precision - scale;
+  int intg0 = intg / 9, intg0x = intg % 9;
+  int frac0 = scale / 9, frac0x = scale % 9;
+  size_t size = intg0 * 4 + dig2bytes[intg0x] + frac0 * 4 + dig2bytes[frac0x];
+
+  const unsigned char *raw;
+  unsigned char bytes[40];
+  if (size == 0 || read_bytes(r, size, &raw) != 0) {
+    return -1;
+  }
+  memcpy(bytes, raw, size);
+  bool negative = !(bytes[0] & 0x80);
+  bytes[0] ^= 0x80;
+  if (negative) {
+    for (size_t i = 0; i < size; ++i) {
+      bytes[i] ^= 0xFF;
+    }
+  }
+
+  int rc = strbuf_append_str(out, negative ? "\"-" : "\"");
+  const unsigned char *ptr = bytes;
+  bool started = false;
+  if (intg0x > 0) {
+    uint64_t value = be_uint(ptr, dig2bytes[intg0x]);
+    ptr += dig2bytes[intg0x];
+    if (value > 0) {
+      rc = rc || strbuf_appendf(out, "%" PRIu64, value);
+      started = true;
+    }
+  }
+  for (int i = 0; i < intg0; ++i, ptr += 4) {
+    uint64_t value = be_uint(ptr, 4);
+    if (started) {
+      rc = rc || strbuf_appendf(out, "%09" PRIu64, value);
+    } else if (value > 0) {
+      rc = rc || strbuf_appendf(out, "%" PRIu64, value);
+      started = true;
+    }
+  }
+  if (!started) {
+    rc = rc || strbuf_append_char(out, '0');
+  }
+  if (scale > 0) {
+    rc = rc || strbuf_append_char(out, '.');
+    for (int i = 0; i < frac0; ++i, ptr += 4) {
+      rc = rc || strbuf_appendf(out, "%09" PRIu64, be_uint(ptr, 4));
+    }
+    if (frac0x > 0) {
+      rc = rc || strbuf_appendf(out, "%0*" PRIu64, frac0x, be_uint(ptr, dig2bytes[frac0x]));
+    }
+  }
+  return rc || strbuf_append_char(out, '"') ? -1 : 0;
+}
+
+/**
+ * @brief 读取 TIMESTAMP2、DATETIME2、TIME2 的小数秒部分，转换为微秒
+ */
+static int read_fraction(reader_t *r, unsigned int fsp, uint64_t *usec) {
+  const unsigned char *bytes;
+  size_t n = (fsp + 1) / 2;
+  if (fsp > 6 || read_bytes(r, n, &bytes) != 0) {
+    return -1;
+  }
+  static const uint64_t scale[4] = {0, 10000, 100, 1};
+  *usec = n > 0 ? be_uint(bytes, n) * scale[n] : 0;
+  return 0;
+}
+
+static int append_fraction(strbuf_t *out, unsigned int fsp, uint64_t usec) {
+  if (fsp == 0) {
+    return 0;
+  }
+  static const uint64_t divisor[7] = {1000000, 100000, 10000, 1000, 100, 10, 1};
+  return strbuf_appendf(out, ".%0*" PRIu64, (int)fsp, usec / divisor[fsp]);
+}
+
+/**
+ * @brief 输出 TIME2 列：3 字节整数部分（时 10 位、分 6 位、秒 6 位）加小数秒，
+ *        整体加偏移量保存，以便按字节比较
+ */
+static int append_time2(reader_t *r, unsigned int fsp, strbuf_t *out) {
+  const unsigned char *bytes;
+  int64_t packed;
+  if (fsp > 6) {
+    return -1;
+  }
+  if (fsp >= 5) {
+    if (read_bytes(r, 6, &bytes) != 0) {
+      return -1;
+    }
+    packed = (int64_t)be_uint(bytes, 6) - 0x800000000000LL;
+  } else {
+    if (read_bytes(r, 3, &bytes) != 0) {
+      return -1;
+    }
+    int64_t intpart = (int64_t)be_uint(bytes, 3) - 0x800000;
+    int64_t frac = 0;
+    if (fsp >= 1) {
+      size_t n = (fsp + 1) / 2;
+      const unsigned char *frac_bytes;
+      if (read_bytes(r, n, &frac_bytes) != 0) {
+        return -1;
+      }
+      // 小数部分是有符号数，负值时向整数部分借位
+      frac = (int64_t)be_uint(frac_bytes, n);
+      int64_t range = n == 1 ? 0x100 : 0x10000;
+      if (intpart < 0 && frac) {
+        ++intpart;
+        frac -= range;
+      }
+      frac *= n == 1 ? 10000 : 100;
+    }
+    packed = intpart * ((int64_t)1 << 24) + frac;
+  }
+
+  bool negative = packed < 0;
+  uint64_t value = negative ? (uint64_t)-packed : (uint64_t)packed;
+  uint64_t hms = value >> 24;
+  return strbuf_appendf(out, "\"%s%02u:%02u:%02u", negative ? "-" : "",
+                        (unsigned)((hms >> 12) % (1 << 10)), (unsigned)((hms >> 6) % (1 << 6)),
+                        (unsigned)(hms % (1 << 6)))
+             || append_fraction(out, fsp, value % (1 << 24))
+             || strbuf_append_char(out, '"')
+         ? -1
+         : 0;
+}
+
+static int append_string(strbuf_t *out, const unsigned char *data, size_t len) {
+  return strbuf_append_char(out, '"') || json_escape_append(out, (const char *)data, len) ||
+                 strbuf_append_char(out, '"')
+             ? -1
+             : 0;
+}
+
+static int append_hex(strbuf_t *out, const unsigned char *data, size_t len) {
+  static const char digits[] = "0123456789abcdef";
+  if (strbuf_append_char(out, '"') != 0 || strbuf_reserve(out, len * 2 + 1) != 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < len; ++i) {
+    out->data[out->len++] = digits[data[i] >> 4];
+    out->data[out->len++] = digits[data[i] & 0xF];
+  }
+  out->data[out->len] = '\0';
+  return strbuf_append_char(out, '"');
+}
+
+/**
+ * @brief 读取带长度前缀的值，前缀占 prefix 字节
+ */
+static int read_prefixed(reader_t *r, size_t prefix, const unsigned char **data, size_t *len) {
+  uint64_t n;
+  if (prefix == 0 || prefix > 4 || read_uint(r, prefix, &n) != 0 ||
+      read_bytes(r, n, data) != 0) {
+    return -1;
+  }
+  *len = n;
+  return 0;
+}
+
+/**
+ * @brief 把一列的值按 JSON 输出：整数、浮点数为数字，DECIMAL 为字符串以免丢失精度，
+ *        时间类型为 MySQL 的文本格式（TIMESTAMP 为 UTC），JSON、GEOMETRY 为十六进制
+ */
+static int append_value(reader_t *r, unsigned char type, uint16_t meta, bool is_unsigned,
+                        strbuf_t *out) {
+  const unsigned char *data;
+  size_t len;
+  uint64_t value;
+
+  switch (type) {
+  case MYSQL_TYPE_TINY:
+  case MYSQL_TYPE_SHORT:
+  case MYSQL_TYPE_INT24:
+  case MYSQL_TYPE_LONG:
+  case MYSQL_TYPE_LONGLONG: {
+    size_t n = type == MYSQL_TYPE_TINY    ? 1
+               : type == MYSQL_TYPE_SHORT ? 2
+               : type == MYSQL_TYPE_INT24 ? 3
+               : type == MYSQL_TYPE_LONG  ? 4
+                                          : 8;
+    if (read_uint(r, n, &value) != 0) {
+      return -1;
+    }
+    if (is_unsigned) {
+      return strbuf_appendf(out, "%" PRIu64, value);
+    }
+    // 符号扩展
+    int64_t signed_value =
+        n == 8 ? (int64_t)value : (int64_t)(value << (64 - 8 * n)) >> (64 - 8 * n);
+    return strbuf_appendf(out, "%" PRId64, signed_value);
+  }
+  case MYSQL_TYPE_FLOAT: {
+    float f;
+    if (read_bytes(r, 4, &data) != 0) {
+      return -1;
+    }
+    memcpy(&f, data, sizeof(f));
+    return isfinite(f) ? strbuf_appendf(out, "%.9g", (double)f) : strbuf_append_str(out, "null");
+  }
+  case MYSQL_TYPE_DOUBLE: {
+    double d;
+    if (read_bytes(r, 8, &data) != 0) {
+      return -1;
+    }
+    memcpy(&d, data, sizeof(d));
+    return isfinite(d) ? strbuf_appendf(out, "%.17g", d) : strbuf_append_str(out, "null");
+  }
+  case MYSQL_TYPE_NEWDECIMAL:
+    return append_decimal(r, meta, out);
+  case MYSQL_TYPE_YEAR:
+    if (read_uint(r, 1, &value) != 0) {
+      return -1;
+    }
+    return strbuf_appendf(out, "%u", value ? (unsigned)value + 1900 : 0);
+  case MYSQL_TYPE_DATE:
+    if (read_uint(r, 3, &value) != 0) {
+      return -1;
+    }
+    return strbuf_appendf(out, "\"%04u-%02u-%02u\"", (unsigned)(value >> 9),
+                          (unsigned)(value >> 5 & 15), (unsigned)(value & 31));
+  case MYSQL_TYPE_TIME:
+    if (read_uint(r, 3, &value) != 0) {
+      return -1;
+    }
+    return strbuf_appendf(out, "\"%02u:%02u:%02u\"", (unsigned)(value / 10000),
+                          (unsigned)(value / 100 % 100), (unsigned)(value % 100));
+  case MYSQL_TYPE_DATETIME:
+    if (read_uint(r, 8, &value) != 0) {
+      return -1;
+    }
+    return strbuf_appendf(out, "\"%04u-%02u-%02u %02u:%02u:%02u\"",
+                          (unsigned)(value / 10000000000ULL), (unsigned)(value / 100000000 % 100),
+                          (unsigned)(value / 1000000 % 100), (unsigned)(value / 10000 % 100),
+                          (unsigned)(value / 100 % 100), (unsigned)(value % 100));
+  case MYSQL_TYPE_TIMESTAMP:
+  case MYSQL_TYPE_TIMESTAMP2: {
+    uint64_t usec = 0;
+    if (type == MYSQL_TYPE_TIMESTAMP) {
+      if (read_uint(r, 4, &value) != 0) {
+        return -1;
+      }
+    } else {
+      if (read_bytes(r, 4, &data) != 0 || read_fraction(r, meta, &usec) != 0) {
+        return -1;
+      }
+      value = be_uint(data, 4);
+    }
+    if (value == 0) {
+      return strbuf_append_str(out, "\"0000-00-00 00:00:00\"");
+    }
+    time_t seconds = (time_t)value;
+    struct tm tm;
+    gmtime_r(&seconds, &tm);
+    return strbuf_appendf(out, "\"%04d-%02d-%02d %02d:%02d:%02d", tm.tm_year + 1900,
+                          tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec)
+                   || append_fraction(out, type == MYSQL_TYPE_TIMESTAMP ? 0 : meta, usec)
+                   || strbuf_append_char(out, '"')
+               ? -1
+               : 0;
+  }
+  case MYSQL_TYPE_DATETIME2: {
+    // 符号 1 位、年*13+月 17 位、日 5 位、时 5 位、分 6 位、秒 6 位
+    uint64_t usec;
+    if (read_bytes(r, 5, &data) != 0 || read_fraction(r, meta, &usec) != 0) {
+      return -1;
+    }
+    value = be_uint(data, 5) - 0x8000000000ULL;
+    uint64_t ym = value >> 22 & 0x1FFFF;
+    return strbuf_appendf(out, "\"%04u-%02u-%02u %02u:%02u:%02u", (unsigned)(ym / 13),
+                          (unsigned)(ym % 13), (unsigned)(value >> 17 & 31),
+                          (unsigned)(value >> 12 & 31), (unsigned)(value >> 6 & 63),
+                          (unsigned)(value & 63))
+                   || append_fraction(out, meta, usec) || strbuf_append_char(out, '"')
+               ? -1
+               : 0;
+  }
+  case MYSQL_TYPE_TIME2:
+    return append_time2(r, meta, out);
+  case MYSQL_TYPE_VARCHAR:
+  case MYSQL_TYPE_VAR_STRING:
+    if (read_prefixed(r, meta < 256 ? 1 : 2, &data, &len) != 0) {
+      return -1;
+    }
+    return append_string(out, data, len);
+  case MYSQL_TYPE_STRING:
+  case MYSQL_TYPE_ENUM:
+  case MYSQL_TYPE_SET: {
+    // CHAR 的元数据是 (实际类型, 长度)，超过 255 字节的 CHAR 把长度的高位存在实际类型里
+    unsigned int real_type = type;
+    unsigned int max_len = meta;
+    if (meta >= 256) {
+      unsigned int byte0 = meta >> 8, byte1 = meta & 0xFF;
+      if ((byte0 & 0x30) != 0x30) {
+        max_len = byte1 | (((byte0 & 0x30) ^ 0x30) << 4);
+        real_type = byte0 | 0x30;
+      } else {
+        max_len = byte1;
+        real_type = byte0;
+      }
+    }
+    if (real_type == MYSQL_TYPE_ENUM || real_type == MYSQL_TYPE_SET) {
+      // 输出 ENUM 的序号和 SET 的位图
+      if (max_len == 0 || max_len > 8 || read_uint(r, max_len, &value) != 0) {
+        return -1;
+      }
+      return strbuf_appendf(out, "%" PRIu64, value);
+    }
+    if (read_prefixed(r, max_len < 256 ? 1 : 2, &data, &len) != 0) {
+      return -1;
+    }
+    return append_string(out, data, len);
+  }
+  case MYSQL_TYPE_BIT: {
+    size_t n = (size_t)((meta >> 8) * 8 + (meta & 0xFF) + 7) / 8;
+    if (n == 0 || n > 8 || read_bytes(r, n, &data) != 0) {
+      return -1;
+    }
+    return strbuf_appendf(out, "%" PRIu64, be_uint(data, n));
+  }
+  case MYSQL_TYPE_BLOB:
+    if (read_prefixed(r, meta, &data, &len) != 0) {
+      return -1;
+    }
+    return append_string(out, data, len);
+  case MYSQL_TYPE_JSON:
+  case MYSQL_TYPE_GEOMETRY:
+    // JSON 列是 MySQL 内部的二进制格式，GEOMETRY 是 WKB，都原样以十六进制输出
+    if (read_prefixed(r, meta, &data, &len) != 0) {
+      return -1;
+    }
+    return append_hex(out, data, len);
+  default:
+    LOG_ERROR("Unsupported column type %u in binlog row event", type);
+    return -1;
+  }
+}
+
+/**
+ * @brief 解析一个行镜像并输出为 JSON 对象
+ *
+ * @param r 游标
+ * @param table 表结构
+ * @param present 镜像中包含的列
+ * @param out 输出
+ * @return int 成功（0）；失败（-1）
+ */
+static int append_row_image(reader_t *r, const binlog_table_t *table,
+                            const unsigned char *present, strbuf_t *out) {
+  size_t num_present = 0;
+  for (size_t i = 0; i < table->num_columns; ++i) {
+    num_present += present[i / 8] >> (i % 8) & 1;
+  }
+  const unsigned char *nulls;
+  if (read_bytes(r, (num_present + 7) / 8, &nulls) != 0) {
+    return -1;
+  }
+
+  int rc = strbuf_append_char(out, '{');
+  size_t n = 0;
+  for (size_t i = 0; rc == 0 && i < table->num_columns; ++i) {
+    if (!(present[i / 8] >> (i % 8) & 1)) {
+      continue;
+    }
+    bool is_null = nulls[n / 8] >> (n % 8) & 1;
+    if (n++ > 0) {
+      rc = strbuf_append_char(out, ',');
+    }
+    if (table->names && table->names[i]) {
+      rc = rc || append_string(out, (const unsigned char *)table->names[i],
+                               strlen(table->names[i]));
+    } else {
+      // 没有列名（binlog_row_metadata=MINIMAL）时与 mysqlbinlog 一样用 @序号
+      rc = rc || strbuf_appendf(out, "\"@%zu\"", i + 1);
+    }
+    rc = rc || strbuf_append_char(out, ':');
+    rc = rc || (is_null ? strbuf_append_str(out, "null")
+                        : append_value(r, table->types[i], table->meta[i],
+                                       table->is_unsigned[i], out));
+  }
+  return rc || strbuf_append_char(out, '}') ? -1 : 0;
+}
+
+/**
+ * @brief 解析 WRITE/UPDATE/DELETE_ROWS 事件，每行变更追加一行 JSON 到当前事务
+ */
+static int decode_rows(binlog_decoder_t *dec, reader_t *r, unsigned char event_type) {
+  uint64_t table_id, num_columns;
+  if (read_uint(r, 6, &table_id) != 0 || skip_bytes(r, 2) != 0) {
+    return -1;
+  }
+  bool v2 = event_type >= BINLOG_WRITE_ROWS_EVENT;
+  if (v2) {
+    uint64_t extra_len;
+    if (read_uint(r, 2, &extra_len) != 0 || extra_len < 2 || skip_bytes(r, extra_len - 2) != 0) {
+      return -1;
+    }
+  }
+
+  const binlog_table_t *table = find_table(dec, table_id);
+  if (!table) {
+    LOG_ERROR("Binlog rows event references unknown table id %" PRIu64, table_id);
+    return -1;
+  }
+  if (!table->matched) {
+    return 0;
+  }
+
+  const char *type = "insert";
+  bool is_update = false;
+  if (event_type == BINLOG_UPDATE_ROWS_EVENT || event_type == BINLOG_UPDATE_ROWS_EVENT_V1) {
+    type = "update";
+    is_update = true;
+  } else if (event_type == BINLOG_DELETE_ROWS_EVENT ||
+             event_type == BINLOG_DELETE_ROWS_EVENT_V1) {
+    type = "delete";
+  }
+
+  const unsigned char *before_present, *after_present = NULL;
+  if (read_lenenc(r, &num_columns) != 0 || num_columns != table->num_columns ||
+      read_bytes(r, (num_columns + 7) / 8, &before_present) != 0 ||
+      (is_update && read_bytes(r, (num_columns + 7) / 8, &after_present) != 0)) {
+    return -1;
+  }
+
+  char gtid[GTID_TEXT_LEN] = "";
+  if (dec->has_gtid) {
+    gtid_format(dec->uuid, dec->gno, gtid, sizeof(gtid));
+  }
+  while (r->left > 0) {
+    strbuf_t *out = &dec->pending;
+    int rc = strbuf_appendf(out, "{\"gtid\":\"%s\",\"table\":", gtid) ||
+             append_string(out, (const unsigned char *)table->table, strlen(table->table)) ||
+             strbuf_appendf(out, ",\"type\":\"%s\",\"%s\":", type, is_update ? "before" : "row") ||
+             append_row_image(r, table, before_present, out);
+    if (rc == 0 && is_update) {
+      rc = strbuf_append_str(out, ",\"after\":") ||
+           append_row_image(r, table, after_present, out);
+    }
+    if (rc != 0 || strbuf_append_str(out, "}\n") != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief QUERY 事件是否是事务开头的 BEGIN；其他语句（COMMIT、DDL）都结束一个事务
+ */
+static int query_is_begin(reader_t *r, bool *is_begin) {
+  uint64_t db_len, status_len;
+  if (skip_bytes(r, 8) != 0 || read_uint(r, 1, &db_len) != 0 || skip_bytes(r, 2) != 0 ||
+      read_uint(r, 2, &status_len) != 0 || skip_bytes(r, status_len + db_len + 1) != 0) {
+    return -1;
+  }
+  *is_begin = r->left == 5 && memcmp(r->ptr, "BEGIN", 5) == 0;
+  return 0;
+}
+
+/**
+ * @brief 事务结束：输出它的变更，清空表结构
+ */
+static int commit(binlog_decoder_t *dec, strbuf_t *out) {
+  int rc = strbuf_append(out, dec->pending.data, dec->pending.len);
+  strbuf_reset(&dec->pending);
+  clear_tables(dec);
+  return rc;
+}
+
+/**
+ * @brief 解码一个 binlog 事件（含 19 字节事件头）
+ *
+ * 一个事务的行变更先缓存在解码器中，读到 XID 或结束事务的 QUERY 事件时才追加到 out，
+ * 此时 dec->uuid、dec->gno 为刚结束的事务的 GTID。DDL 不输出变更，但同样算作一个事务
+ *
+ * @param dec 解码器
+ * @param event 事件
+ * @param len 事件长度
+ * @param out 输出，每行变更一个 JSON 对象，以换行结尾
+ * @param kind 输出事件对调用方的意义
+ * @return int 成功（0）；格式错误或不支持的事件（-1）
+ */
+int binlog_decode(binlog_decoder_t *dec, const unsigned char *event, size_t len, strbuf_t *out,
+                  binlog_event_kind_t *kind) {
+  *kind = BINLOG_EVENT_OTHER;
+  if (len < BINLOG_HEADER_LEN) {
+    return -1;
+  }
+  unsigned char type = event[4];
+
+  if (type == BINLOG_FORMAT_DESCRIPTION_EVENT) {
+    // 校验和算法在事件末尾，后面是 FORMAT_DESCRIPTION 事件自身的校验和
+    dec->checksum = len >= BINLOG_HEADER_LEN + BINLOG_CHECKSUM_LEN + 1 &&
+                    event[len - BINLOG_CHECKSUM_LEN - 1] == BINLOG_CHECKSUM_ALG_CRC32;
+    return 0;
+  }
+  if (dec->checksum && type != BINLOG_ROTATE_EVENT) {
+    if (len < BINLOG_HEADER_LEN + BINLOG_CHECKSUM_LEN) {
+      return -1;
+    }
+    len -= BINLOG_CHECKSUM_LEN;
+  }
+  reader_t r = {event + BINLOG_HEADER_LEN, len - BINLOG_HEADER_LEN};
+
+  switch (type) {
+  case BINLOG_GTID_EVENT:
+  case BINLOG_ANONYMOUS_GTID_EVENT: {
+    const unsigned char *uuid;
+    uint64_t gno;
+    if (skip_bytes(&r, 1) != 0 || read_bytes(&r, GTID_UUID_LEN, &uuid) != 0 ||
+        read_uint(&r, 8, &gno) != 0) {
+      return -1;
+    }
+    memcpy(dec->uuid, uuid, GTID_UUID_LEN);
+    dec->gno = gno;
+    dec->has_gtid = type == BINLOG_GTID_EVENT;
+    strbuf_reset(&dec->pending);
+    clear_tables(dec);
+    return 0;
+  }
+  case BINLOG_TABLE_MAP_EVENT:
+    if (decode_table_map(dec, &r) != 0) {
+      LOG_ERROR("Malformed binlog table map event");
+      return -1;
+    }
+    return 0;
+  case BINLOG_WRITE_ROWS_EVENT_V1:
+  case BINLOG_UPDATE_ROWS_EVENT_V1:
+  case BINLOG_DELETE_ROWS_EVENT_V1:
+  case BINLOG_WRITE_ROWS_EVENT:
+  case BINLOG_UPDATE_ROWS_EVENT:
+  case BINLOG_DELETE_ROWS_EVENT:
+    if (decode_rows(dec, &r, type) != 0) {
+      LOG_ERROR("Malformed binlog rows event");
+      return -1;
+    }
+    return 0;
+  case BINLOG_XID_EVENT:
+    *kind = BINLOG_EVENT_COMMIT;
+    return commit(dec, out);
+  case BINLOG_QUERY_EVENT: {
+    bool is_begin;
+    if (query_is_begin(&r, &is_begin) != 0) {
+      LOG_ERROR("Malformed binlog query event");
+      return -1;
+    }
+    if (is_begin) {
+      return 0;
+    }
+    *kind = BINLOG_EVENT_COMMIT;
+    return commit(dec, out);
+  }
+  case BINLOG_HEARTBEAT_EVENT:
+  case BINLOG_HEARTBEAT_EVENT_V2:
+    *kind = BINLOG_EVENT_HEARTBEAT;
+    return 0;
+  case BINLOG_PARTIAL_UPDATE_ROWS_EVENT:
+    LOG_ERROR("Binlog partial JSON updates are not supported, set binlog_row_value_options=''");
+    return -1;
+  case BINLOG_TRANSACTION_PAYLOAD_EVENT:
+    LOG_ERROR("Compressed binlog transactions are not supported, "
+              "set binlog_transaction_compression=OFF");
+    return -1;
+  default:
+    return 0;
+  }
+}
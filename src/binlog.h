@@ -0,0 +1,71 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "src/gtid.h"
+#include "src/strbuf.h"
+// clang-format on
+
+// 事件头长度（binlog v4）
+#define BINLOG_HEADER_LEN 19
+
+// binlog 事件类型，只列出解码时关心的
+typedef enum {
+  BINLOG_QUERY_EVENT = 2,
+  BINLOG_ROTATE_EVENT = 4,
+  BINLOG_FORMAT_DESCRIPTION_EVENT = 15,
+  BINLOG_XID_EVENT = 16,
+  BINLOG_TABLE_MAP_EVENT = 19,
+  BINLOG_WRITE_ROWS_EVENT_V1 = 23,
+  BINLOG_UPDATE_ROWS_EVENT_V1 = 24,
+  BINLOG_DELETE_ROWS_EVENT_V1 = 25,
+  BINLOG_HEARTBEAT_EVENT = 27,
+  BINLOG_WRITE_ROWS_EVENT = 30,
+  BINLOG_UPDATE_ROWS_EVENT = 31,
+  BINLOG_DELETE_ROWS_EVENT = 32,
+  BINLOG_GTID_EVENT = 33,
+  BINLOG_ANONYMOUS_GTID_EVENT = 34,
+  BINLOG_PARTIAL_UPDATE_ROWS_EVENT = 39,
+  BINLOG_TRANSACTION_PAYLOAD_EVENT = 40,
+  BINLOG_HEARTBEAT_EVENT_V2 = 41,
+} binlog_event_type_t;
+
+// binlog_decode() 对调用方有意义的结果
+typedef enum {
+  BINLOG_EVENT_OTHER = 0, // 事务中间的事件或与变更无关的事件
+  BINLOG_EVENT_COMMIT,    // 一个事务结束，它的变更已追加到输出
+  BINLOG_EVENT_HEARTBEAT, // 主库没有新事件时定期发送的心跳
+} binlog_event_kind_t;
+
+// TABLE_MAP 事件描述的表结构，行事件按 table_id 引用
+typedef struct {
+  uint64_t table_id;
+  bool matched;           // 是否是要输出的表，不是时跳过它的行事件
+  char *table;            // 表名
+  size_t num_columns;
+  unsigned char *types;   // 列类型
+  uint16_t *meta;         // 列元数据，含义取决于类型
+  unsigned char *is_unsigned;
+  char **names;           // 列名，binlog_row_metadata=FULL 时才有，否则为 NULL
+} binlog_table_t;
+
+// 行事件解码器：把 ROW 格式的 binlog 事件转换成每行一个 JSON 对象的变更流
+typedef struct {
+  char *db;               // 只输出该库的变更
+  char *table;            // 只输出该表的变更
+  bool checksum;          // 事件末尾带 CRC32 校验和
+  binlog_table_t *tables; // 当前事务的表结构
+  size_t num_tables;
+  size_t cap_tables;
+  unsigned char uuid[GTID_UUID_LEN]; // 当前事务的 GTID
+  uint64_t gno;
+  bool has_gtid;
+  strbuf_t pending;       // 当前事务已解码的变更，提交时才输出
+} binlog_decoder_t;
+
+int binlog_decoder_init(binlog_decoder_t *dec, const char *db, const char *table);
+void binlog_decoder_free(binlog_decoder_t *dec);
+int binlog_decode(binlog_decoder_t *dec, const unsigned char *event, size_t len, strbuf_t *out,
+                  binlog_event_kind_t *kind);
@@ -0,0 +1,615 @@
+// clang-format off
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "bulk_load.h"
+#include "src/key.h"
+#include "src/logger.h"
+#include "src/sql_quote.h"
+// clang-format on
+
+// 一个值写进语句的方式
+typedef enum {
+  CELL_DEFAULT = 0, // NDJSON 中缺少的列，写 DEFAULT
+  CELL_NULL,
+  CELL_NUMBER, // 已校验的数字原文
+  CELL_STRING,
+} cell_kind_t;
+
+/**
+ * @brief 由 Content-Type 确定行的格式，忽略参数（如 charset）
+ *
+ * @param content_type Content-Type 请求头，可以为 NULL
+ * @param format 输出格式
+ * @return int 成功（0）；不是 CSV 或 NDJSON（-1）
+ */
+int bulk_format_from_content_type(const char *content_type, bulk_format_t *format) {
+  if (!content_type) {
+    return -1;
+  }
+  size_t len = strcspn(content_type, "; \t");
+  if (len == strlen(KEY_MIME_CSV) && strncasecmp(content_type, KEY_MIME_CSV, len) == 0) {
+    *format = BULK_FORMAT_CSV;
+    return 0;
+  }
+  if (len == strlen(KEY_MIME_NDJSON) && strncasecmp(content_type, KEY_MIME_NDJSON, len) == 0) {
+    *format = BULK_FORMAT_NDJSON;
+    return 0;
+  }
+  return -1;
+}
+
+/**
+ * @brief 创建批量写入
+ *
+ * @param table 表，与其他操作一样原样写进语句
+ * @param format 行的格式
+ * @return bulk_load_t* 批量写入；内存不足返回 NULL
+ */
+bulk_load_t *bulk_load_create(const char *table, bulk_format_t format) {
+  bulk_load_t *load = calloc(1, sizeof(bulk_load_t));
+  if (!load) {
+    LOG_ERROR("Failed to allocate memory for bulk load");
+    return NULL;
+  }
+  load->format = format;
+  load->table = strdup(table);
+  strbuf_init(&load->record);
+  strbuf_init(&load->prefix);
+  strbuf_init(&load->stmt);
+  if (!load->table) {
+    LOG_ERROR("Failed to allocate memory for bulk load");
+    bulk_load_destroy(load);
+    return NULL;
+  }
+  return load;
+}
+
+/**
+ * @brief 释放批量写入，包括尚未取出的批次
+ *
+ * @param load 批量写入，可以为 NULL
+ */
+void bulk_load_destroy(bulk_load_t *load) {
+  if (!load) {
+    return;
+  }
+  for (size_t i = 0; i < load->num_columns; ++i) {
+    free(load->columns[i]);
+  }
+  free(load->columns);
+  free(load->column_lens);
+  for (size_t i = load->ready_head; i < load->num_ready; ++i) {
+    free(load->ready[i].sql);
+  }
+  free(load->ready);
+  free(load->json_row);
+  free(load->cells);
+  free(load->cell_lens);
+  free(load->cell_kinds);
+  strbuf_free(&load->record);
+  strbuf_free(&load->prefix);
+  strbuf_free(&load->stmt);
+  free(load->table);
+  free(load);
+}
+
+/**
+ * @brief 记录一个错误，超过 BULK_LOAD_MAX_ERRORS 时只计数
+ */
+static void add_error(bulk_load_t *load, size_t first_row, size_t rows, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void add_error(bulk_load_t *load, size_t first_row, size_t rows, const char *fmt, ...) {
+  if (load->num_errors == BULK_LOAD_MAX_ERRORS) {
+    ++load->errors_dropped;
+    return;
+  }
+  bulk_error_t *error = &load->errors[load->num_errors++];
+  error->first_row = first_row;
+  error->rows = rows;
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(error->message, sizeof(error->message), fmt, args);
+  va_end(args);
+}
+
+/**
+ * @brief 请求体无法继续解析，之后的数据都不再接收
+ *
+ * @return int 总是 -1
+ */
+static int fail(bulk_load_t *load, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static int fail(bulk_load_t *load, const char *fmt, ...) {
+  if (!load->failed) {
+    load->failed = true;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(load->fatal, sizeof(load->fatal), fmt, args);
+    va_end(args);
+    LOG_WARN("Bulk load into %s stopped: %s", load->table, load->fatal);
+  }
+  return -1;
+}
+
+/**
+ * @brief 确定列名，生成每个批次共用的 INSERT INTO table (`a`, `b`) VALUES
+ *
+ * @param load 批量写入
+ * @param names 列名
+ * @param lens 列名长度
+ * @param count 列数
+ * @return int 成功（0）；失败（-1）
+ */
+static int set_columns(bulk_load_t *load, const char *const *names, const size_t *lens,
+                       size_t count) {
+  if (count == 0) {
+    return fail(load, "No columns");
+  }
+  load->columns = calloc(count, sizeof(char *));
+  load->column_lens = calloc(count, sizeof(size_t));
+  load->cells = calloc(count, sizeof(const char *));
+  load->cell_lens = calloc(count, sizeof(size_t));
+  load->cell_kinds = calloc(count, sizeof(unsigned char));
+  if (!load->columns || !load->column_lens || !load->cells || !load->cell_lens ||
+      !load->cell_kinds) {
+    return fail(load, "Out of memory");
+  }
+
+  int rc = strbuf_appendf(&load->prefix, "INSERT INTO %s (", load->table);
+  for (size_t i = 0; rc == 0 && i < count; ++i) {
+    if (lens[i] == 0) {
+      return fail(load, "Column %zu has no name", i + 1);
+    }
+    for (size_t j = 0; j < i; ++j) {
+      if (lens[j] == lens[i] && memcmp(names[j], names[i], lens[i]) == 0) {
+        return fail(load, "Duplicate column %.*s", (int)lens[i], names[i]);
+      }
+    }
+    load->columns[i] = strndup(names[i], lens[i]);
+    if (!load->columns[i]) {
+      return fail(load, "Out of memory");
+    }
+    load->column_lens[i] = lens[i];
+    load->num_columns = i + 1;
+    rc = (i > 0 ? strbuf_append_str(&load->prefix, ", ") : 0) ||
+         sql_identifier_append(&load->prefix, names[i], lens[i]);
+  }
+  if (rc != 0 || strbuf_append_str(&load->prefix, ") VALUES ") != 0) {
+    return fail(load, "Out of memory");
+  }
+  load->header_done = true;
+  return 0;
+}
+
+/**
+ * @brief 当前批次凑满，移入待执行队列
+ *
+ * @return int 成功（0）；失败（-1）
+ */
+static int seal_batch(bulk_load_t *load) {
+  if (load->stmt_rows == 0) {
+    return 0;
+  }
+  if (load->num_ready == load->cap_ready) {
+    // 已取出的批次留下的空位先挪掉
+    if (load->ready_head > 0) {
+      memmove(load->ready, load->ready + load->ready_head,
+              (load->num_ready - load->ready_head) * sizeof(bulk_batch_t));
+      load->num_ready -= load->ready_head;
+      load->ready_head = 0;
+    }
+    if (load->num_ready == load->cap_ready) {
+      size_t cap = load->cap_ready ? load->cap_ready * 2 : 4;
+      bulk_batch_t *ready = realloc(load->ready, cap * sizeof(bulk_batch_t));
+      if (!ready) {
+        return fail(load, "Out of memory");
+      }
+      load->ready = ready;
+      load->cap_ready = cap;
+    }
+  }
+
+  bulk_batch_t *batch = &load->ready[load->num_ready++];
+  batch->len = load->stmt.len;
+  batch->sql = strbuf_detach(&load->stmt);
+  batch->first_row = load->stmt_first_row;
+  batch->rows = load->stmt_rows;
+  load->stmt_rows = 0;
+  return 0;
+}
+
+/**
+ * @brief 把 cells 中的一行追加到当前批次，超过长度或行数上限时先把之前的行凑成一批
+ *
+ * @return int 成功（0）；失败（-1）
+ */
+static int add_row(bulk_load_t *load, size_t row) {
+  strbuf_t *stmt = &load->stmt;
+  size_t mark = stmt->len;
+  int rc = load->stmt_rows == 0 ? strbuf_append(stmt, load->prefix.data, load->prefix.len)
+                                : strbuf_append(stmt, ", ", 2);
+  size_t row_start = stmt->len;
+  rc = rc || strbuf_append_char(stmt, '(');
+  for (size_t i = 0; rc == 0 && i < load->num_columns; ++i) {
+    rc = i > 0 ? strbuf_append(stmt, ", ", 2) : 0;
+    switch (load->cell_kinds[i]) {
+    case CELL_DEFAULT:
+      rc = rc || strbuf_append_str(stmt, "DEFAULT");
+      break;
+    case CELL_NULL:
+      rc = rc || strbuf_append_str(stmt, "NULL");
+      break;
+    case CELL_NUMBER:
+      rc = rc || strbuf_append(stmt, load->cells[i], load->cell_lens[i]);
+      break;
+    default:
+      rc = rc || sql_string_append(stmt, load->cells[i], load->cell_lens[i]);
+    }
+  }
+  if (rc != 0 || strbuf_append_char(stmt, ')') != 0) {
+    return fail(load, "Out of memory");
+  }
+
+  if (load->stmt_rows > 0 && stmt->len > BULK_LOAD_BATCH_BYTES) {
+    // 这一行放不下了：之前的行凑成一批，这一行开始新的批次
+    strbuf_t next;
+    strbuf_init(&next);
+    if (strbuf_append(&next, load->prefix.data, load->prefix.len) != 0 ||
+        strbuf_append(&next, stmt->data + row_start, stmt->len - row_start) != 0) {
+      strbuf_free(&next);
+      return fail(load, "Out of memory");
+    }
+    stmt->len = mark;
+    stmt->data[mark] = '\0';
+    if (seal_batch(load) != 0) {
+      strbuf_free(&next);
+      return -1;
+    }
+    *stmt = next;
+  }
+  if (load->stmt_rows++ == 0) {
+    load->stmt_first_row = row;
+  }
+  return load->stmt_rows == BULK_LOAD_BATCH_ROWS ? seal_batch(load) : 0;
+}
+
+/**
+ * @brief 原地拆分一条 CSV 记录：去掉引号并还原 ""，字段指向记录内部
+ *
+ * @param record 记录，不含行尾换行
+ * @param len 长度
+ * @param fields 输出字段
+ * @param lens 输出字段长度
+ * @param quoted 输出字段是否加了引号
+ * @param count 输出字段数
+ * @return int 成功（0）；字段数超过上限或引号不匹配（-1）
+ */
+static int split_csv(char *record, size_t len, const char **fields, size_t *lens, bool *quoted,
+                     size_t *count) {
+  char *src = record;
+  char *end = record + len;
+  *count = 0;
+  for (;;) {
+    if (*count == BULK_LOAD_MAX_COLUMNS) {
+      return -1;
+    }
+    char *dst = src;
+    char *start = src;
+    bool in_quotes = src < end && *src == '"';
+    quoted[*count] = in_quotes;
+    if (in_quotes) {
+      start = dst = ++src;
+      for (;;) {
+        if (src == end) {
+          return -1;
+        }
+        if (*src == '"') {
+          if (src + 1 < end && src[1] == '"') {
+            *dst++ = '"';
+            src += 2;
+            continue;
+          }
+          ++src;
+          break;
+        }
+        *dst++ = *src++;
+      }
+      // 右引号之后只能是分隔符或记录结尾
+      if (src < end && *src != ',') {
+        return -1;
+      }
+    } else {
+      while (src < end && *src != ',') {
+        if (*src == '"') {
+          return -1;
+        }
+        ++src;
+      }
+      dst = src;
+    }
+    fields[*count] = start;
+    lens[*count] = (size_t)(dst - start);
+    ++*count;
+    if (src == end) {
+      return 0;
+    }
+    ++src; // ','
+  }
+}
+
+/**
+ * @brief 处理一条 CSV 记录：第一条是列名，其余每条一行
+ */
+static int csv_record(bulk_load_t *load, char *record, size_t len) {
+  static __thread const char *fields[BULK_LOAD_MAX_COLUMNS];
+  static __thread size_t lens[BULK_LOAD_MAX_COLUMNS];
+  static __thread bool quoted[BULK_LOAD_MAX_COLUMNS];
+  size_t count = 0;
+  int rc = split_csv(record, len, fields, lens, quoted, &count);
+  if (!load->header_done) {
+    if (rc != 0) {
+      return fail(load, "Malformed CSV header");
+    }
+    return set_columns(load, fields, lens, count);
+  }
+
+  size_t row = ++load->rows;
+  if (rc != 0) {
+    ++load->rows_rejected;
+    add_error(load, row, 0, "malformed CSV record");
+    return 0;
+  }
+  if (count != load->num_columns) {
+    ++load->rows_rejected;
+    add_error(load, row, 0, "expected %zu field(s), found %zu", load->num_columns, count);
+    return 0;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    bool null = !quoted[i] && lens[i] == 2 && fields[i][0] == '\\' && fields[i][1] == 'N';
+    load->cell_kinds[i] = null ? CELL_NULL : CELL_STRING;
+    load->cells[i] = fields[i];
+    load->cell_lens[i] = lens[i];
+  }
+  return add_row(load, row);
+}
+
+/**
+ * @brief 查找列，先看同一位置，字段顺序与第一行相同时不需要比较其他列
+ */
+static size_t find_column(const bulk_load_t *load, size_t hint, const char *name, size_t len) {
+  if (hint < load->num_columns && load->column_lens[hint] == len &&
+      memcmp(load->columns[hint], name, len) == 0) {
+    return hint;
+  }
+  for (size_t i = 0; i < load->num_columns; ++i) {
+    if (load->column_lens[i] == len && memcmp(load->columns[i], name, len) == 0) {
+      return i;
+    }
+  }
+  return load->num_columns;
+}
+
+/**
+ * @brief 处理一个 NDJSON 对象：第一个对象的字段名确定列，缺少的列写 DEFAULT
+ */
+static int ndjson_record(bulk_load_t *load, char *record, size_t len) {
+  if (!load->json_row && !(load->json_row = malloc(sizeof(json_row_t)))) {
+    return fail(load, "Out of memory");
+  }
+  json_row_t *json = load->json_row;
+  json_request_error_t error;
+  size_t row = ++load->rows;
+  if (json_row_parse(record, len, json, &error) != 0) {
+    ++load->rows_rejected;
+    add_error(load, row, 0, "%s at offset %zu", error.message, error.offset);
+    return 0;
+  }
+
+  if (!load->header_done) {
+    static __thread const char *names[BULK_LOAD_MAX_COLUMNS];
+    static __thread size_t lens[BULK_LOAD_MAX_COLUMNS];
+    for (size_t i = 0; i < json->count; ++i) {
+      names[i] = json->values[i].name;
+      lens[i] = json->values[i].name_len;
+    }
+    if (set_columns(load, names, lens, json->count) != 0) {
+      return -1;
+    }
+  }
+
+  memset(load->cell_kinds, CELL_DEFAULT, load->num_columns);
+  for (size_t i = 0; i < json->count; ++i) {
+    const json_row_value_t *value = &json->values[i];
+    size_t column = find_column(load, i, value->name, value->name_len);
+    if (column == load->num_columns || load->cell_kinds[column] != CELL_DEFAULT) {
+      ++load->rows_rejected;
+      add_error(load, row, 0, "%s column %.*s",
+                column == load->num_columns ? "unknown" : "duplicate", (int)value->name_len,
+                value->name);
+      return 0;
+    }
+    load->cell_kinds[column] = value->type == JSON_VALUE_NULL     ? CELL_NULL
+                               : value->type == JSON_VALUE_NUMBER ? CELL_NUMBER
+                                                                  : CELL_STRING;
+    load->cells[column] = value->value;
+    load->cell_lens[column] = value->len;
+  }
+  return add_row(load, row);
+}
+
+/**
+ * @brief 处理一条完整的记录，空行忽略
+ */
+static int process_record(bulk_load_t *load, char *record, size_t len) {
+  if (len > 0 && record[len - 1] == '\r') {
+    --len;
+  }
+  if (len == 0) {
+    return 0;
+  }
+  return load->format == BULK_FORMAT_CSV ? csv_record(load, record, len)
+                                         : ndjson_record(load, record, len);
+}
+
+/**
+ * @brief 送入请求体的一个分片，完整的记录立即转成批次中的行，不完整的留到下一个分片
+ *
+ * CSV 中引号内的换行属于字段，不结束记录
+ *
+ * @param load 批量写入
+ * @param data 分片
+ * @param len 长度
+ * @return int 成功（0）；请求体无法继续解析或内存不足（-1，原因在 load->fatal）
+ */
+int bulk_load_feed(bulk_load_t *load, const char *data, size_t len) {
+  if (load->failed) {
+    return -1;
+  }
+  if (strbuf_append(&load->record, data, len) != 0) {
+    return fail(load, "Out of memory");
+  }
+
+  strbuf_t *buf = &load->record;
+  size_t start = 0;
+  size_t pos = load->scanned;
+  while (pos < buf->len) {
+    if (load->format == BULK_FORMAT_NDJSON) {
+      char *newline = memchr(buf->data + pos, '\n', buf->len - pos);
+      if (!newline) {
+        pos = buf->len;
+        break;
+      }
+      pos = (size_t)(newline - buf->data);
+    } else {
+      while (pos < buf->len && (load->in_quotes || buf->data[pos] != '\n')) {
+        if (buf->data[pos] == '"') {
+          load->in_quotes = !load->in_quotes;
+        }
+        ++pos;
+      }
+      if (pos == buf->len) {
+        break;
+      }
+    }
+    if (process_record(load, buf->data + start, pos - start) != 0) {
+      return -1;
+    }
+    start = ++pos;
+  }
+
+  // 已处理的记录一次移走，剩下不完整的记录
+  size_t rest = buf->len - start;
+  if (start > 0) {
+    memmove(buf->data, buf->data + start, rest);
+    buf->len = rest;
+    buf->data[rest] = '\0';
+  }
+  load->scanned = rest;
+  if (rest > BULK_LOAD_MAX_RECORD) {
+    return fail(load, "Row %zu exceeds %d bytes", load->rows + 1, BULK_LOAD_MAX_RECORD);
+  }
+  return 0;
+}
+
+/**
+ * @brief 请求体结束：处理没有换行结尾的最后一条记录，剩下的行凑成最后一个批次
+ *
+ * @param load 批量写入
+ * @return int 成功（0）；失败（-1，原因在 load->fatal）
+ */
+int bulk_load_finish(bulk_load_t *load) {
+  if (load->failed) {
+    return -1;
+  }
+  if (load->in_quotes) {
+    return fail(load, "Unterminated quoted field in row %zu", load->rows + 1);
+  }
+  if (load->record.len > 0 &&
+      process_record(load, load->record.data, load->record.len) != 0) {
+    return -1;
+  }
+  strbuf_reset(&load->record);
+  load->scanned = 0;
+  if (load->format == BULK_FORMAT_CSV && !load->header_done) {
+    return fail(load, "Missing CSV header");
+  }
+  return seal_batch(load);
+}
+
+/**
+ * @brief 取出下一个待执行的批次，按行的顺序
+ *
+ * @param load 批量写入
+ * @param batch 输出批次，执行后交给 bulk_load_record()
+ * @return bool 取到（true）；没有待执行的批次（false）
+ */
+bool bulk_load_take(bulk_load_t *load, bulk_batch_t *batch) {
+  if (load->ready_head == load->num_ready) {
+    load->ready_head = load->num_ready = 0;
+    return false;
+  }
+  *batch = load->ready[load->ready_head++];
+  return true;
+}
+
+/**
+ * @brief 记录一个批次的执行结果并释放批次
+ *
+ * @param load 批量写入
+ * @param batch 已执行的批次
+ * @param affected 写入的行数
+ * @param error 失败时的错误信息，成功为 NULL
+ */
+void bulk_load_record(bulk_load_t *load, bulk_batch_t *batch, long long affected,
+                      const char *error) {
+  ++load->batches;
+  if (error) {
+    ++load->batches_failed;
+    load->rows_failed += batch->rows;
+    add_error(load, batch->first_row, batch->rows, "%s", error);
+  } else if (affected > 0) {
+    load->rows_inserted += (size_t)affected;
+  }
+  free(batch->sql);
+  batch->sql = NULL;
+}
+
+/**
+ * @brief 生成响应：首行为汇总和写入速度，之后每行一个错误
+ *
+ *   success: Inserted 10000 of 10000 row(s) in 2 batch(es), 0 failed, 52310 rows/s
+ *   error: Inserted 4999 of 5001 row(s) in 2 batch(es), 1 failed, 48120 rows/s
+ *   row 17: expected 3 field(s), found 2
+ *   rows 5001-10000: Duplicate entry '7' for key 'users.PRIMARY'
+ *
+ * @param load 批量写入
+ * @param elapsed_us 从收到请求起的耗时
+ * @param out 输出
+ * @return int 成功（0）；失败（-1）
+ */
+int bulk_load_summary(const bulk_load_t *load, uint64_t elapsed_us, strbuf_t *out) {
+  bool ok = !load->failed && load->rows_rejected == 0 && load->batches_failed == 0;
+  double rate = elapsed_us > 0 ? (double)load->rows_inserted * 1e6 / (double)elapsed_us : 0.0;
+  int rc = strbuf_appendf(out, "%s Inserted %zu of %zu row(s) in %zu batch(es), %zu failed, %.0f "
+                               "rows/s\n",
+                          ok ? KEY_RESP_SUCCESS : KEY_RESP_ERROR, load->rows_inserted, load->rows,
+                          load->batches, load->batches_failed, rate);
+  if (rc == 0 && load->failed) {
+    rc = strbuf_appendf(out, "stopped: %s\n", load->fatal);
+  }
+  for (size_t i = 0; rc == 0 && i < load->num_errors; ++i) {
+    const bulk_error_t *error = &load->errors[i];
+    rc = error->rows == 0
+             ? strbuf_appendf(out, "row %zu: %s\n", error->first_row, error->message)
+             : strbuf_appendf(out, "rows %zu-%zu: %s\n", error->first_row,
+                              error->first_row + error->rows - 1, error->message);
+  }
+  if (rc == 0 && load->errors_dropped > 0) {
+    rc = strbuf_appendf(out, "%zu more error(s)\n", load->errors_dropped);
+  }
+  return rc != 0 ? -1 : 0;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "src/json_request.h"
+#include "src/strbuf.h"
+// clang-format on
+
+// 一条多行 INSERT 的长度上限，远低于 max_allowed_packet 的默认值（8.0 为 64 MB，5.7 为 4 MB）
+#define BULK_LOAD_BATCH_BYTES (1024 * 1024)
+// 一条多行 INSERT 最多的行数，失败时整批的行一起报告
+#define BULK_LOAD_BATCH_ROWS 5000
+// 一行（一条 CSV 记录或一个 NDJSON 对象）的长度上限，超过时整个请求失败
+#define BULK_LOAD_MAX_RECORD (1024 * 1024)
+// 一行最多的列数
+#define BULK_LOAD_MAX_COLUMNS JSON_ROW_MAX_COLUMNS
+// 响应中详细列出的错误数，其余只计数
+#define BULK_LOAD_MAX_ERRORS 100
+
+typedef enum {
+  BULK_FORMAT_CSV = 0, // RFC 4180，首行为列名；不加引号的 \N 为 NULL，与 LOAD DATA 相同
+  BULK_FORMAT_NDJSON,  // 每行一个对象，列取自第一个对象的字段名
+} bulk_format_t;
+
+// 一条准备好的多行 INSERT
+typedef struct {
+  char *sql;
+  size_t len;
+  size_t first_row; // 第一行的行号，从 1 开始，不含 CSV 的标题行
+  size_t rows;
+} bulk_batch_t;
+
+// 被拒绝的行或执行失败的批次
+typedef struct {
+  size_t first_row;
+  size_t rows; // 0 表示解析失败的单行
+  char message[256];
+} bulk_error_t;
+
+// 流式批量写入：请求体分片送入 bulk_load_feed()，凑满的批次由调用者取出执行后报告结果
+typedef struct {
+  bulk_format_t format;
+  char *table;
+  strbuf_t record; // 跨分片的不完整记录
+  size_t scanned;  // record 中已检查过的长度
+  bool in_quotes;  // CSV 扫描到的位置在引号内
+  bool header_done;
+  char **columns; // 列名，已还原转义
+  size_t *column_lens;
+  size_t num_columns;
+  strbuf_t prefix; // INSERT INTO table (`a`, `b`) VALUES
+  strbuf_t stmt;   // 正在凑的批次
+  size_t stmt_first_row;
+  size_t stmt_rows;
+  bulk_batch_t *ready; // 凑满、等待执行的批次，从 ready_head 开始
+  size_t ready_head;
+  size_t num_ready;
+  size_t cap_ready;
+  json_row_t *json_row; // NDJSON 的解析结果，只在需要时分配
+  const char **cells;   // 按列排列的一行的值
+  size_t *cell_lens;
+  unsigned char *cell_kinds; // 值写进语句的方式，见 bulk_load.c 中的 cell_kind_t
+  bool failed;           // 请求体无法继续解析，不再接收数据
+  char fatal[256];       // failed 的原因
+  size_t rows;           // 已解析的行数，含被拒绝的行
+  size_t rows_rejected;  // 解析失败的行数
+  size_t rows_inserted;  // 成功批次写入的行数
+  size_t rows_failed;    // 失败批次中的行数
+  size_t batches;        // 已执行的批次数
+  size_t batches_failed; // 执行失败的批次数
+  bulk_error_t errors[BULK_LOAD_MAX_ERRORS];
+  size_t num_errors;
+  size_t errors_dropped; // 超出 BULK_LOAD_MAX_ERRORS 没有详细列出的错误
+} bulk_load_t;
+
+int bulk_format_from_content_type(const char *content_type, bulk_format_t *format);
+bulk_load_t *bulk_load_create(const char *table, bulk_format_t format);
+void bulk_load_destroy(bulk_load_t *load);
+int bulk_load_feed(bulk_load_t *load, const char *data, size_t len);
+int bulk_load_finish(bulk_load_t *load);
+bool bulk_load_take(bulk_load_t *load, bulk_batch_t *batch);
+void bulk_load_record(bulk_load_t *load, bulk_batch_t *batch, long long affected,
+                      const char *error);
+int bulk_load_summary(const bulk_load_t *load, uint64_t elapsed_us, strbuf_t *out);
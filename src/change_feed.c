@@ -0,0 +1,235 @@
+// clang-format off
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <mysql/mysql.h>
+#include "change_feed.h"
+#include "src/binlog.h"
+#include "src/clock.h"
+#include "src/gtid.h"
+#include "src/logger.h"
+#include "src/macro.h"
+// clang-format on
+
+// 复制会话的心跳间隔以纳秒为单位
+#define HEARTBEAT_PERIOD_NS STR_HELPER(CHANGE_FEED_HEARTBEAT_MS) "000000"
+
+/**
+ * @brief 查询当前库名和 GTID 状态；没有游标时从当前已执行的位置开始，只看之后的变更
+ *
+ * @param mysql 连接
+ * @param executed 起始位置，没有游标时填入 @@GLOBAL.gtid_executed
+ * @param from_now 是否从当前位置开始
+ * @param db 输出库名，调用者释放
+ * @param error 失败时输出原因
+ * @return int 成功（0）；失败（-1）
+ */
+static int query_server_state(MYSQL *mysql, gtid_set_t *executed, bool from_now, char **db,
+                              const char **error) {
+  if (mysql_query(mysql, "SELECT DATABASE(), @@GLOBAL.gtid_mode, @@GLOBAL.gtid_executed") != 0) {
+    LOG_ERROR("Change feed failed to query GTID state: %s", mysql_error(mysql));
+    *error = "Failed to query GTID state";
+    return -1;
+  }
+  MYSQL_RES *res = mysql_store_result(mysql);
+  MYSQL_ROW row = res ? mysql_fetch_row(res) : NULL;
+  int rc = -1;
+  if (!row) {
+    *error = "Failed to query GTID state";
+  } else if (!row[0]) {
+    *error = "No default database configured";
+  } else if (!row[1] || strcasecmp(row[1], "ON") != 0) {
+    *error = "Change feed requires gtid_mode=ON";
+  } else if (from_now && gtid_set_parse(executed, row[2] ? row[2] : "") != 0) {
+    LOG_ERROR("Change feed failed to parse gtid_executed: %s", row[2]);
+    *error = "Failed to parse gtid_executed";
+  } else if (!(*db = strdup(row[0]))) {
+    *error = "Out of memory";
+  } else {
+    rc = 0;
+  }
+  if (res) {
+    mysql_free_result(res);
+  }
+  return rc;
+}
+
+/**
+ * @brief 把编码好的 GTID 集合拷贝进 COM_BINLOG_DUMP_GTID 请求
+ */
+static void fix_gtid_set(MYSQL_RPL *rpl, unsigned char *packet_gtid_set) {
+  memcpy(packet_gtid_set, rpl->gtid_set_arg, rpl->gtid_set_encoded_size);
+}
+
+/**
+ * @brief 以副本身份打开 binlog 流，跳过 executed 中的事务
+ *
+ * @param mysql 连接
+ * @param rpl 复制流
+ * @param server_id 副本的 server_id
+ * @param encoded 编码后的 GTID 集合，流关闭前不能释放
+ * @param error 失败时输出原因
+ * @return int 成功（0）；失败（-1）
+ */
+static int open_binlog(MYSQL *mysql, MYSQL_RPL *rpl, unsigned int server_id,
+                       const strbuf_t *encoded, const char **error) {
+  // 声明能校验 CRC32，否则开启了 binlog_checksum 的主库拒绝发送；8.0.26 起变量改名，两个都设置
+  if (mysql_query(mysql, "SET @master_binlog_checksum = @@GLOBAL.binlog_checksum, "
+                         "@source_binlog_checksum = @@GLOBAL.binlog_checksum") != 0 ||
+      mysql_query(mysql, "SET @master_heartbeat_period = " HEARTBEAT_PERIOD_NS ", "
+                         "@source_heartbeat_period = " HEARTBEAT_PERIOD_NS) != 0) {
+    LOG_ERROR("Change feed failed to configure replication session: %s", mysql_error(mysql));
+    *error = "Failed to configure replication session";
+    return -1;
+  }
+
+  memset(rpl, 0, sizeof(MYSQL_RPL));
+  rpl->start_position = 4;
+  rpl->server_id = server_id;
+  rpl->flags = MYSQL_RPL_GTID;
+  rpl->gtid_set_encoded_size = encoded->len;
+  rpl->gtid_set_arg = encoded->data;
+  rpl->fix_gtid_set = fix_gtid_set;
+  if (mysql_binlog_open(mysql, rpl) != 0) {
+    LOG_ERROR("Change feed failed to open binlog stream: %s", mysql_error(mysql));
+    *error = "Failed to open binlog stream (requires the REPLICATION SLAVE privilege)";
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 是否应该结束本次轮询
+ */
+static bool should_return(const change_feed_opts_t *opts, const strbuf_t *changes,
+                          binlog_event_kind_t kind) {
+  // 有变更且主库已没有新事件时立即返回，否则攒到截止时间或长度上限
+  return (kind == BINLOG_EVENT_HEARTBEAT && changes->len > 0) ||
+         changes->len >= opts->max_bytes || clock_now_us() >= opts->deadline_us ||
+         (opts->stop && atomic_load_explicit(opts->stop, memory_order_acquire));
+}
+
+/**
+ * @brief 读取 binlog 直到应该返回，把已提交事务的变更追加到 changes，GTID 加入 executed
+ *
+ * 事务的变更在提交时才追加，GTID 也在提交时才加入游标，随时返回都不会截断事务
+ *
+ * @return change_feed_result_t 结果
+ */
+static change_feed_result_t tail_binlog(MYSQL *mysql, MYSQL_RPL *rpl, binlog_decoder_t *dec,
+                                        gtid_set_t *executed, const change_feed_opts_t *opts,
+                                        strbuf_t *changes, const char **error) {
+  for (;;) {
+    if (mysql_binlog_fetch(mysql, rpl) != 0) {
+      LOG_ERROR("Change feed failed to read binlog: %s", mysql_error(mysql));
+      *error = "Failed to read binlog";
+      // 已读到的变更和对应的游标仍然有效
+      return changes->len > 0 ? CHANGE_FEED_OK : CHANGE_FEED_ERROR;
+    }
+    if (rpl->size == 0) {
+      return CHANGE_FEED_OK;
+    }
+
+    // 第一个字节是包的状态标记
+    binlog_event_kind_t kind;
+    if (binlog_decode(dec, rpl->buffer + 1, rpl->size - 1, changes, &kind) != 0) {
+      *error = "Failed to decode binlog event";
+      return CHANGE_FEED_ERROR;
+    }
+    if (kind == BINLOG_EVENT_COMMIT && dec->has_gtid &&
+        gtid_set_add(executed, dec->uuid, dec->gno) != 0) {
+      *error = "Out of memory";
+      return CHANGE_FEED_ERROR;
+    }
+    if (should_return(opts, changes, kind)) {
+      return CHANGE_FEED_OK;
+    }
+  }
+}
+
+/**
+ * @brief 在复制连接上读取变更，输出变更和新的游标
+ *
+ * @return change_feed_result_t 结果
+ */
+static change_feed_result_t run_feed(MYSQL *mysql, const char *table, gtid_set_t *executed,
+                                     bool from_now, const change_feed_opts_t *opts, strbuf_t *out,
+                                     const char **error) {
+  char *db = NULL;
+  if (query_server_state(mysql, executed, from_now, &db, error) != 0) {
+    return CHANGE_FEED_ERROR;
+  }
+
+  binlog_decoder_t dec;
+  if (binlog_decoder_init(&dec, db, table) != 0) {
+    free(db);
+    *error = "Out of memory";
+    return CHANGE_FEED_ERROR;
+  }
+  free(db);
+
+  change_feed_result_t result = CHANGE_FEED_ERROR;
+  strbuf_t encoded, changes;
+  strbuf_init(&encoded);
+  strbuf_init(&changes);
+  MYSQL_RPL rpl;
+  if (gtid_set_encode(executed, &encoded) != 0) {
+    *error = "Out of memory";
+  } else if (open_binlog(mysql, &rpl, opts->server_id, &encoded, error) == 0) {
+    result = tail_binlog(mysql, &rpl, &dec, executed, opts, &changes, error);
+    mysql_binlog_close(mysql, &rpl);
+  }
+
+  if (result == CHANGE_FEED_OK &&
+      (strbuf_append(out, changes.data, changes.len) != 0 ||
+       strbuf_append_str(out, "{\"cursor\":\"") != 0 || gtid_set_format(executed, out) != 0 ||
+       strbuf_append_str(out, "\"}\n") != 0)) {
+    *error = "Out of memory";
+    result = CHANGE_FEED_ERROR;
+  }
+  strbuf_free(&changes);
+  strbuf_free(&encoded);
+  binlog_decoder_free(&dec);
+  return result;
+}
+
+/**
+ * @brief 长轮询一张表的行变更
+ *
+ * 每次建立一条独立连接，以副本身份从游标处读取 binlog，解码出该表的 INSERT、UPDATE、
+ * DELETE，直到追上主库、到达截止时间或变更足够多。只输出已提交的事务，返回的游标包含
+ * 读到的所有事务（包括其他表的），下一次从这里继续，不会重复也不会遗漏
+ *
+ * 输出每行一个 JSON 对象，最后一行为 {"cursor":"<GTID 集合>"}
+ *
+ * @param pool 数据库连接池，用它的连接参数建立复制连接
+ * @param table 表名
+ * @param cursor 上次返回的游标，NULL 或空串表示从当前位置开始
+ * @param opts 选项
+ * @param out 输出
+ * @param error 失败时输出原因
+ * @return change_feed_result_t 结果
+ */
+change_feed_result_t change_feed_poll(connection_pool_t *pool, const char *table,
+                                      const char *cursor, const change_feed_opts_t *opts,
+                                      strbuf_t *out, const char **error) {
+  gtid_set_t executed;
+  gtid_set_init(&executed);
+  bool from_now = !cursor || *cursor == '\0';
+  if (!from_now && gtid_set_parse(&executed, cursor) != 0) {
+    gtid_set_free(&executed);
+    *error = "Invalid cursor, expected a GTID set";
+    return CHANGE_FEED_BAD_CURSOR;
+  }
+
+  change_feed_result_t result = CHANGE_FEED_ERROR;
+  MYSQL *mysql = connection_pool_connect(pool, "change feed");
+  if (mysql) {
+    result = run_feed(mysql, table, &executed, from_now, opts, out, error);
+    mysql_close(mysql);
+  } else {
+    *error = "Failed to connect to MySQL";
+  }
+  gtid_set_free(&executed);
+  return result;
+}
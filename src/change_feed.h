@@ -0,0 +1,29 @@
+#pragma once
+
+// clang-format off
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "src/connection_pool.h"
+#include "src/strbuf.h"
+// clang-format on
+
+// 主库没有新事件时发送心跳的间隔，决定了长轮询发现“已追上”和响应停止的延迟
+#define CHANGE_FEED_HEARTBEAT_MS 100
+
+typedef struct {
+  unsigned int server_id;  // 以副本身份连接主库使用的 server_id，不能与其他副本重复
+  uint64_t deadline_us;    // 到达后返回已提交的变更
+  size_t max_bytes;        // 变更达到该长度后返回
+  const atomic_bool *stop; // 服务停止时置位，可以为 NULL
+} change_feed_opts_t;
+
+typedef enum {
+  CHANGE_FEED_OK = 0,
+  CHANGE_FEED_BAD_CURSOR, // 游标不是合法的 GTID 集合
+  CHANGE_FEED_ERROR,      // MySQL 配置不满足要求或读取 binlog 失败
+} change_feed_result_t;
+
+change_feed_result_t change_feed_poll(connection_pool_t *pool, const char *table,
+                                      const char *cursor, const change_feed_opts_t *opts,
+                                      strbuf_t *out, const char **error);
@@ -0,0 +1,428 @@
+// clang-format off
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "client_quota.h"
+#include "src/assert.h"
+#include "src/logger.h"
+#include "src/metrics.h"
+// clang-format on
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t fnv1a(const char *str) {
+  uint64_t hash = FNV_OFFSET;
+  for (const unsigned char *ptr = (const unsigned char *)str; *ptr; ++ptr) {
+    hash = (hash ^ *ptr) * FNV_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * @brief 槽位使用的摘要，0 留给正在被接管的槽位
+ */
+static uint64_t slot_hash(const char *id) {
+  uint64_t hash = fnv1a(id);
+  return hash ? hash : 1;
+}
+
+static int compare_keys(const void *a, const void *b) {
+  return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/**
+ * @brief 初始化客户端配额
+ *
+ * @param quota 配额对象
+ * @param rate 每个客户端每秒的请求数，0 表示不限速
+ * @param burst 令牌桶容量，即空闲后允许的突发请求数，0 表示与 rate 相同（至少为 1）
+ * @param max_active 每个客户端的在途请求上限，0 表示不限
+ * @return int 成功（0）；失败（-1）
+ */
+int client_quota_init(client_quota_t *quota, double rate, int burst, int max_active) {
+  DBMNGR_ASSERT(quota);
+  if (rate < 0 || burst < 0 || max_active < 0) {
+    LOG_ERROR("Invalid client quota: rate=%g, burst=%d, max active=%d", rate, burst, max_active);
+    return -1;
+  }
+
+  memset(quota, 0, sizeof(*quota));
+  if (rate > 0) {
+    quota->interval_us = (uint64_t)(1e6 / rate);
+    if (quota->interval_us == 0) {
+      quota->interval_us = 1;
+    }
+    if (burst == 0) {
+      burst = rate < 1 ? 1 : (int)rate;
+    }
+    quota->tolerance_us = (uint64_t)(burst - 1) * quota->interval_us;
+  }
+  quota->max_active = max_active;
+  snprintf(quota->overflow.id, sizeof(quota->overflow.id), "other");
+
+  if (pthread_mutex_init(&quota->mutex, NULL) != 0) {
+    LOG_ERROR("Failed to initialize client quota mutex");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 销毁客户端配额
+ *
+ * @param quota 配额对象
+ */
+void client_quota_destroy(client_quota_t *quota) {
+  if (quota) {
+    for (size_t i = 0; i < quota->num_keys; ++i) {
+      free(quota->keys[i]);
+    }
+    free(quota->keys);
+    quota->keys = NULL;
+    quota->num_keys = 0;
+    pthread_mutex_destroy(&quota->mutex);
+  }
+}
+
+/**
+ * @brief 读取已知的 API Key，每行一个，忽略空行和 # 开头的注释行
+ *
+ * 只有已知的 X-Api-Key 单独记账，其余请求按对端地址识别，客户端不能靠换 Key 绕过配额，
+ * 也不能靠编造 Key 占满槽位。在服务开始接收请求之前调用
+ *
+ * @param quota 配额对象
+ * @param path 文件路径
+ * @return int 成功（0）；失败（-1）
+ */
+int client_quota_load_keys(client_quota_t *quota, const char *path) {
+  DBMNGR_ASSERT(quota && path);
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    LOG_ERROR("Failed to open client key file %s: %s", path, strerror(errno));
+    return -1;
+  }
+
+  char *line = NULL;
+  size_t line_cap = 0;
+  size_t cap = quota->num_keys;
+  int rc = 0;
+  ssize_t len;
+  while (rc == 0 && (len = getline(&line, &line_cap, file)) != -1) {
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' ' ||
+                       line[len - 1] == '\t')) {
+      line[--len] = '\0';
+    }
+    if (len == 0 || line[0] == '#') {
+      continue;
+    }
+    if (quota->num_keys == cap) {
+      cap = cap ? cap * 2 : 16;
+      char **keys = realloc(quota->keys, cap * sizeof(char *));
+      if (!keys) {
+        rc = -1;
+        break;
+      }
+      quota->keys = keys;
+    }
+    if (!(quota->keys[quota->num_keys] = strdup(line))) {
+      rc = -1;
+      break;
+    }
+    ++quota->num_keys;
+  }
+  if (rc == 0 && ferror(file)) {
+    rc = -1;
+  }
+  free(line);
+  fclose(file);
+  if (rc != 0) {
+    LOG_ERROR("Failed to read client key file %s", path);
+    return -1;
+  }
+
+  qsort(quota->keys, quota->num_keys, sizeof(char *), compare_keys);
+  LOG_INFO("Loaded %zu client API keys from %s", quota->num_keys, path);
+  return 0;
+}
+
+/**
+ * @brief 是否限制了速率或并发，都不限制时不必识别客户端
+ *
+ * @param quota 配额对象
+ * @return bool 启用返回 true
+ */
+bool client_quota_enabled(const client_quota_t *quota) {
+  return quota->interval_us > 0 || quota->max_active > 0;
+}
+
+/**
+ * @brief 生成客户端标识：API Key 已知时用它的摘要（指标中不暴露密钥），否则用对端 IP 地址
+ *
+ * @param quota 配额对象
+ * @param api_key API Key 请求头，可以为 NULL；不在 client_quota_load_keys() 读入的列表中时忽略
+ * @param addr 对端地址，可以为 NULL
+ * @param id 输出
+ * @param size 输出缓冲区大小，至少 CLIENT_QUOTA_ID_LEN + 1
+ * @return int 成功（0）；失败（-1）
+ */
+int client_quota_id(const client_quota_t *quota, const char *api_key, const struct sockaddr *addr,
+                    char *id, size_t size) {
+  if (api_key && *api_key && quota->num_keys > 0 &&
+      bsearch(&api_key, quota->keys, quota->num_keys, sizeof(char *), compare_keys)) {
+    int n = snprintf(id, size, "key-%016llx", (unsigned long long)fnv1a(api_key));
+    return n > 0 && (size_t)n < size ? 0 : -1;
+  }
+
+  const char *name = NULL;
+  if (addr && addr->sa_family == AF_INET) {
+    name = inet_ntop(AF_INET, &((const struct sockaddr_in *)addr)->sin_addr, id, (socklen_t)size);
+  } else if (addr && addr->sa_family == AF_INET6) {
+    name =
+        inet_ntop(AF_INET6, &((const struct sockaddr_in6 *)addr)->sin6_addr, id, (socklen_t)size);
+  } else if (addr && addr->sa_family == AF_UNIX) {
+    // 同一台机器上经 Unix 域套接字连接的客户端没有地址可以区分
+    name = id;
+    snprintf(id, size, "unix");
+  }
+  if (!name) {
+    snprintf(id, size, "unknown");
+  }
+  return 0;
+}
+
+/**
+ * @brief 槽位仍属于 hash 时计入一个在途请求
+ *
+ * 先加 active 再确认 hash，接管方先清 hash 再确认 active 为 0（都是顺序一致的原子操作），
+ * 两边至少有一方看到对方的写入，被钉住的槽位不会被接管
+ *
+ * @param active 输出计入之前的在途请求数
+ * @return bool 钉住返回 true
+ */
+static bool slot_pin(client_quota_slot_t *slot, uint64_t hash, int *active) {
+  if (atomic_load(&slot->hash) != hash) {
+    return false;
+  }
+  *active = atomic_fetch_add(&slot->active, 1);
+  if (atomic_load(&slot->hash) == hash) {
+    return true;
+  }
+  atomic_fetch_sub(&slot->active, 1);
+  return false;
+}
+
+/**
+ * @brief 把空闲、令牌已补满的槽位改名给新客户端，调用方持有 mutex
+ *
+ * @return bool 接管成功返回 true
+ */
+static bool slot_reclaim(client_quota_slot_t *slot, const char *id, uint64_t hash,
+                         uint64_t now_us) {
+  uint64_t old_hash = atomic_load(&slot->hash);
+  if (atomic_load(&slot->active) != 0 ||
+      atomic_load_explicit(&slot->tat_us, memory_order_relaxed) > now_us) {
+    return false;
+  }
+  atomic_store(&slot->hash, 0);
+  if (atomic_load(&slot->active) != 0) {
+    atomic_store(&slot->hash, old_hash);
+    return false;
+  }
+  // 令牌已补满，旧客户端再来时从满桶开始，与继续占着槽位没有区别
+  LOG_DEBUG("Client %s idle, quota slot reused for %s", slot->id, id);
+  snprintf(slot->id, sizeof(slot->id), "%s", id);
+  atomic_store_explicit(&slot->tat_us, 0, memory_order_relaxed);
+  atomic_store_explicit(&slot->admitted, 0, memory_order_relaxed);
+  atomic_store_explicit(&slot->rate_limited, 0, memory_order_relaxed);
+  atomic_store_explicit(&slot->concurrency_limited, 0, memory_order_relaxed);
+  atomic_store_explicit(&slot->active, 1, memory_order_relaxed);
+  atomic_store(&slot->hash, hash);
+  return true;
+}
+
+/**
+ * @brief 查找客户端的配额并计入一个在途请求，第一次出现时登记；
+ *        槽位用完时接管一个空闲的槽位，都在忙时共用 overflow
+ *
+ * @param active 输出计入之前的在途请求数
+ * @return client_quota_slot_t* 已钉住的配额
+ */
+static client_quota_slot_t *slot_acquire(client_quota_t *quota, const char *id, uint64_t now_us,
+                                         int *active) {
+  uint64_t hash = slot_hash(id);
+  size_t start = hash % CLIENT_QUOTA_SLOTS;
+
+  // 已登记的槽位不会变回空闲，查找到第一个空槽位为止
+  for (size_t i = 0; i < CLIENT_QUOTA_SLOTS; ++i) {
+    client_quota_slot_t *slot = &quota->slots[(start + i) % CLIENT_QUOTA_SLOTS];
+    if (!atomic_load_explicit(&slot->used, memory_order_acquire)) {
+      break;
+    }
+    if (slot_pin(slot, hash, active)) {
+      return slot;
+    }
+  }
+
+  pthread_mutex_lock(&quota->mutex);
+  client_quota_slot_t *found = NULL;
+  for (size_t i = 0; i < CLIENT_QUOTA_SLOTS && !found; ++i) {
+    client_quota_slot_t *slot = &quota->slots[(start + i) % CLIENT_QUOTA_SLOTS];
+    if (!atomic_load_explicit(&slot->used, memory_order_relaxed)) {
+      snprintf(slot->id, sizeof(slot->id), "%s", id);
+      *active = 0;
+      atomic_store(&slot->active, 1);
+      atomic_store(&slot->hash, hash);
+      atomic_store_explicit(&slot->used, true, memory_order_release);
+      if (atomic_fetch_add_explicit(&quota->num_used, 1, memory_order_relaxed) + 1 ==
+          CLIENT_QUOTA_SLOTS) {
+        LOG_WARN("Client quota slots exhausted, idle clients give up their slots");
+      }
+      found = slot;
+    } else if (slot_pin(slot, hash, active)) {
+      found = slot;
+    }
+  }
+  for (size_t i = 0; i < CLIENT_QUOTA_SLOTS && !found; ++i) {
+    client_quota_slot_t *slot = &quota->slots[(start + i) % CLIENT_QUOTA_SLOTS];
+    if (slot_reclaim(slot, id, hash, now_us)) {
+      *active = 0;
+      found = slot;
+    }
+  }
+  pthread_mutex_unlock(&quota->mutex);
+  if (found) {
+    return found;
+  }
+  *active = atomic_fetch_add(&quota->overflow.active, 1);
+  return &quota->overflow;
+}
+
+/**
+ * @brief 尝试为客户端接纳一个请求，成功后必须调用 client_quota_leave()
+ *
+ * 先检查并发上限，再从令牌桶取令牌，被并发上限拒绝的请求不消耗令牌；
+ * 只有新客户端登记和接管槽位时加锁
+ *
+ * @param quota 配额对象
+ * @param id 客户端标识，见 client_quota_id()
+ * @param now_us 当前时间（单调时钟）
+ * @param slot 接纳时输出客户端的配额，被拒绝时输出 NULL
+ * @param retry_after_sec 被拒绝时输出建议客户端等待的秒数
+ * @return client_quota_result_t 结果
+ */
+client_quota_result_t client_quota_enter(client_quota_t *quota, const char *id, uint64_t now_us,
+                                         client_quota_slot_t **slot,
+                                         unsigned int *retry_after_sec) {
+  int active = 0;
+  client_quota_slot_t *client = slot_acquire(quota, id, now_us, &active);
+  *slot = NULL;
+  if (quota->max_active > 0 && active >= quota->max_active) {
+    atomic_fetch_sub_explicit(&client->active, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&client->concurrency_limited, 1, memory_order_relaxed);
+    *retry_after_sec = CLIENT_QUOTA_RETRY_AFTER_SEC;
+    return CLIENT_QUOTA_CONCURRENCY_LIMITED;
+  }
+
+  if (quota->interval_us > 0) {
+    // 桶满时 tat 不晚于当前时间；每个请求把 tat 推后一个间隔，超前超过桶容量即为桶空
+    uint64_t tat = atomic_load_explicit(&client->tat_us, memory_order_relaxed);
+    for (;;) {
+      uint64_t start = tat > now_us ? tat : now_us;
+      if (start - now_us > quota->tolerance_us) {
+        uint64_t wait_us = start - now_us - quota->tolerance_us;
+        atomic_fetch_sub_explicit(&client->active, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&client->rate_limited, 1, memory_order_relaxed);
+        *retry_after_sec = (unsigned int)((wait_us + 999999) / 1000000);
+        return CLIENT_QUOTA_RATE_LIMITED;
+      }
+      if (atomic_compare_exchange_weak_explicit(&client->tat_us, &tat, start + quota->interval_us,
+                                                memory_order_relaxed, memory_order_relaxed)) {
+        break;
+      }
+    }
+  }
+
+  atomic_fetch_add_explicit(&client->admitted, 1, memory_order_relaxed);
+  *slot = client;
+  return CLIENT_QUOTA_OK;
+}
+
+/**
+ * @brief 已接纳的请求处理结束
+ *
+ * @param slot 客户端的配额
+ */
+void client_quota_leave(client_quota_slot_t *slot) {
+  // release：接管槽位的线程看到 active 归零时，这个请求对槽位的访问都已结束
+  int active = atomic_fetch_sub_explicit(&slot->active, 1, memory_order_release);
+  DBMNGR_ASSERT(active > 0);
+}
+
+/**
+ * @brief 输出一个客户端一行用量
+ */
+static int render_slot(strbuf_t *out, const char *name, const char *id,
+                       unsigned long long value) {
+  return strbuf_appendf(out, METRIC_PREFIX "%s{client=\"%s\"} %llu\n", name, id, value);
+}
+
+/**
+ * @brief 以 Prometheus 文本格式输出每个客户端的用量
+ *
+ * @param quota 配额对象
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int client_quota_render(client_quota_t *quota, strbuf_t *out) {
+  static const struct {
+    const char *name;
+    const char *type;
+    const char *help;
+  } families[] = {
+      {"client_requests_total", "counter", "Requests admitted per client."},
+      {"client_rate_limited_total", "counter", "Requests answered 429 for the client's rate."},
+      {"client_concurrency_limited_total", "counter",
+       "Requests answered 429 for the client's concurrent request cap."},
+      {"client_active_requests", "gauge", "Requests of the client queued or running."},
+  };
+
+  // 槽位的名字只在持有 mutex 时改写
+  pthread_mutex_lock(&quota->mutex);
+  int rc = 0;
+  for (size_t f = 0; rc == 0 && f < sizeof(families) / sizeof(families[0]); ++f) {
+    rc = strbuf_appendf(out, "# HELP " METRIC_PREFIX "%s %s\n# TYPE " METRIC_PREFIX "%s %s\n",
+                        families[f].name, families[f].help, families[f].name, families[f].type);
+    for (size_t i = 0; rc == 0 && i <= CLIENT_QUOTA_SLOTS; ++i) {
+      client_quota_slot_t *slot = i < CLIENT_QUOTA_SLOTS ? &quota->slots[i] : &quota->overflow;
+      bool used = i < CLIENT_QUOTA_SLOTS
+                      ? atomic_load_explicit(&slot->used, memory_order_acquire)
+                      : atomic_load_explicit(&quota->num_used, memory_order_relaxed) ==
+                            CLIENT_QUOTA_SLOTS;
+      if (!used) {
+        continue;
+      }
+      unsigned long long value;
+      switch (f) {
+      case 0:
+        value = atomic_load_explicit(&slot->admitted, memory_order_relaxed);
+        break;
+      case 1:
+        value = atomic_load_explicit(&slot->rate_limited, memory_order_relaxed);
+        break;
+      case 2:
+        value = atomic_load_explicit(&slot->concurrency_limited, memory_order_relaxed);
+        break;
+      default:
+        value = (unsigned long long)atomic_load_explicit(&slot->active, memory_order_relaxed);
+        break;
+      }
+      rc = render_slot(out, families[f].name, slot->id, value);
+    }
+  }
+  pthread_mutex_unlock(&quota->mutex);
+  return rc;
+}
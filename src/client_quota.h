@@ -0,0 +1,63 @@
+#pragma once
+
+// clang-format off
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include "src/strbuf.h"
+// clang-format on
+
+// 单独记账的客户端上限，超出的客户端共用一个配额（overflow）
+#define CLIENT_QUOTA_SLOTS 1024
+// 客户端标识：IPv6 地址或 API Key 的摘要
+#define CLIENT_QUOTA_ID_LEN 64
+// 超出并发上限时建议客户端等待的秒数（Retry-After）
+#define CLIENT_QUOTA_RETRY_AFTER_SEC 1
+
+typedef enum {
+  CLIENT_QUOTA_OK = 0,
+  CLIENT_QUOTA_RATE_LIMITED,        // 令牌桶已空
+  CLIENT_QUOTA_CONCURRENCY_LIMITED, // 在途请求达到上限
+} client_quota_result_t;
+
+// 一个客户端的配额和用量；读者按 hash 匹配并先计入 active 钉住槽位，
+// 空闲且令牌已补满的槽位在表满时可以被新客户端接管，名字只在持有 mutex 时改写
+typedef struct {
+  alignas(64) atomic_bool used;
+  atomic_ullong hash; // 标识的摘要，0 表示槽位正在被接管
+  char id[CLIENT_QUOTA_ID_LEN + 1];
+  atomic_ullong tat_us; // GCRA 理论到达时间，等价于令牌桶，一次 CAS 完成取令牌
+  atomic_int active;    // 在途请求数
+  atomic_ullong admitted;
+  atomic_ullong rate_limited;
+  atomic_ullong concurrency_limited;
+} client_quota_slot_t;
+
+// 按客户端（API Key 或对端地址）限速和限制并发，防止单个客户端占满连接池
+typedef struct {
+  uint64_t interval_us;  // 两个令牌之间的间隔，0 表示不限速
+  uint64_t tolerance_us; // 桶容量对应的提前量：(burst - 1) * interval_us
+  int max_active;        // 每个客户端的在途请求上限，0 表示不限
+  client_quota_slot_t slots[CLIENT_QUOTA_SLOTS];
+  client_quota_slot_t overflow;
+  pthread_mutex_t mutex; // 登记、接管客户端槽位，输出指标时读取名字
+  atomic_int num_used;
+  char **keys; // 已知的 API Key，升序排列，不在其中的请求头按对端地址识别
+  size_t num_keys;
+} client_quota_t;
+
+int client_quota_init(client_quota_t *quota, double rate, int burst, int max_active);
+void client_quota_destroy(client_quota_t *quota);
+bool client_quota_enabled(const client_quota_t *quota);
+int client_quota_load_keys(client_quota_t *quota, const char *path);
+int client_quota_id(const client_quota_t *quota, const char *api_key, const struct sockaddr *addr,
+                    char *id, size_t size);
+client_quota_result_t client_quota_enter(client_quota_t *quota, const char *id, uint64_t now_us,
+                                         client_quota_slot_t **slot,
+                                         unsigned int *retry_after_sec);
+void client_quota_leave(client_quota_slot_t *slot);
+int client_quota_render(client_quota_t *quota, strbuf_t *out);
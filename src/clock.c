@@ -0,0 +1,15 @@
+// clang-format off
+#include <time.h>
+#include "clock.h"
+// clang-format on
+
+/**
+ * @brief 获取单调时钟
+ *
+ * @return uint64_t 微秒
+ */
+uint64_t clock_now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
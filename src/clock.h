@@ -0,0 +1,7 @@
+#pragma once
+
+// clang-format off
+#include <stdint.h>
+// clang-format on
+
+uint64_t clock_now_us(void);
@@ -0,0 +1,261 @@
+// clang-format off
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+#include <zstd.h>
+#include "compress.h"
+#include "src/logger.h"
+// clang-format on
+
+// 每次为压缩输出预留的空间
+#define COMPRESS_OUT_CHUNK (16 * 1024)
+
+struct compressor {
+  content_encoding_t encoding;
+  z_stream zs;
+  ZSTD_CCtx *zstd;
+};
+
+/**
+ * @brief 解析 Accept-Encoding 中的一项，得到编码名及其权重
+ *
+ * @param token 一项的起始位置
+ * @param len 一项的长度
+ * @param name_len 输出编码名长度
+ * @return double 权重（q 值），未声明时为 1
+ */
+static double parse_coding(const char *token, size_t len, size_t *name_len) {
+  const char *semicolon = memchr(token, ';', len);
+  size_t n = semicolon ? (size_t)(semicolon - token) : len;
+  while (n > 0 && (token[n - 1] == ' ' || token[n - 1] == '\t')) {
+    --n;
+  }
+  *name_len = n;
+
+  if (!semicolon) {
+    return 1.0;
+  }
+  const char *q = strstr(semicolon, "q=");
+  if (!q || q >= token + len) {
+    return 1.0;
+  }
+  return strtod(q + 2, NULL);
+}
+
+/**
+ * @brief 根据 Accept-Encoding 选择编码，客户端同时支持时优先 zstd（压缩和解压都更快）
+ *
+ * 每种编码记下显式声明的权重，q=0 表示拒绝；"*" 只对没有单独列出的 gzip 生效，
+ * 因此 "gzip;q=0, *" 不会选择 gzip
+ *
+ * @param accept_encoding Accept-Encoding 头，可以为 NULL
+ * @return content_encoding_t 编码
+ */
+content_encoding_t content_encoding_negotiate(const char *accept_encoding) {
+  if (!accept_encoding) {
+    return CONTENT_ENCODING_IDENTITY;
+  }
+
+  // 未列出时为负数
+  double gzip = -1, zstd = -1, any = -1;
+  const char *ptr = accept_encoding;
+  while (*ptr) {
+    while (*ptr == ' ' || *ptr == '\t' || *ptr == ',') {
+      ++ptr;
+    }
+    const char *comma = strchr(ptr, ',');
+    size_t len = comma ? (size_t)(comma - ptr) : strlen(ptr);
+    size_t name_len;
+    if (len > 0) {
+      double q = parse_coding(ptr, len, &name_len);
+      if (name_len == 4 && strncasecmp(ptr, "gzip", 4) == 0) {
+        gzip = q;
+      } else if (name_len == 4 && strncasecmp(ptr, "zstd", 4) == 0) {
+        zstd = q;
+      } else if (name_len == 1 && ptr[0] == '*') {
+        any = q;
+      }
+    }
+    ptr += len;
+  }
+
+  if (zstd > 0) {
+    return CONTENT_ENCODING_ZSTD;
+  }
+  if (gzip < 0) {
+    gzip = any;
+  }
+  return gzip > 0 ? CONTENT_ENCODING_GZIP : CONTENT_ENCODING_IDENTITY;
+}
+
+/**
+ * @brief 获取编码对应的 Content-Encoding 值
+ *
+ * @param encoding 编码
+ * @return const char* Content-Encoding 值
+ */
+const char *content_encoding_name(content_encoding_t encoding) {
+  switch (encoding) {
+  case CONTENT_ENCODING_GZIP:
+    return "gzip";
+  case CONTENT_ENCODING_ZSTD:
+    return "zstd";
+  case CONTENT_ENCODING_IDENTITY:
+  default:
+    return "identity";
+  }
+}
+
+/**
+ * @brief 创建流式压缩器
+ *
+ * @param encoding 编码，不能是 CONTENT_ENCODING_IDENTITY
+ * @return compressor_t* 压缩器，失败返回 NULL
+ */
+compressor_t *compressor_create(content_encoding_t encoding) {
+  compressor_t *compressor = calloc(1, sizeof(compressor_t));
+  if (!compressor) {
+    LOG_ERROR("Failed to allocate memory for compressor");
+    return NULL;
+  }
+  compressor->encoding = encoding;
+
+  if (encoding == CONTENT_ENCODING_GZIP) {
+    // windowBits 加 16 输出 gzip 头和尾
+    if (deflateInit2(&compressor->zs, COMPRESS_GZIP_LEVEL, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      LOG_ERROR("Failed to initialize gzip compressor");
+      free(compressor);
+      return NULL;
+    }
+  } else if (encoding == CONTENT_ENCODING_ZSTD) {
+    compressor->zstd = ZSTD_createCCtx();
+    if (!compressor->zstd ||
+        ZSTD_isError(ZSTD_CCtx_setParameter(compressor->zstd, ZSTD_c_compressionLevel,
+                                            COMPRESS_ZSTD_LEVEL))) {
+      LOG_ERROR("Failed to initialize zstd compressor");
+      ZSTD_freeCCtx(compressor->zstd);
+      free(compressor);
+      return NULL;
+    }
+  } else {
+    free(compressor);
+    return NULL;
+  }
+  return compressor;
+}
+
+/**
+ * @brief gzip 压缩
+ */
+static int gzip_write(compressor_t *compressor, const void *data, size_t len,
+                      compress_flush_t flush, strbuf_t *out) {
+  static const int modes[] = {Z_NO_FLUSH, Z_SYNC_FLUSH, Z_FINISH};
+  z_stream *zs = &compressor->zs;
+  zs->next_in = (Bytef *)data;
+  zs->avail_in = (uInt)len;
+
+  while (true) {
+    if (strbuf_reserve(out, COMPRESS_OUT_CHUNK) != 0) {
+      return -1;
+    }
+    zs->next_out = (Bytef *)out->data + out->len;
+    zs->avail_out = COMPRESS_OUT_CHUNK;
+    int ret = deflate(zs, modes[flush]);
+    out->len += COMPRESS_OUT_CHUNK - zs->avail_out;
+    if (ret == Z_STREAM_ERROR) {
+      LOG_ERROR("gzip compression failed");
+      return -1;
+    }
+    // 输出空间没有用完说明本次输入已全部处理并按要求刷新
+    if (zs->avail_out != 0 || ret == Z_STREAM_END) {
+      break;
+    }
+  }
+  out->data[out->len] = '\0';
+  return 0;
+}
+
+/**
+ * @brief zstd 压缩
+ */
+static int zstd_write(compressor_t *compressor, const void *data, size_t len,
+                      compress_flush_t flush, strbuf_t *out) {
+  static const ZSTD_EndDirective modes[] = {ZSTD_e_continue, ZSTD_e_flush, ZSTD_e_end};
+  ZSTD_inBuffer input = {data, len, 0};
+
+  while (true) {
+    if (strbuf_reserve(out, COMPRESS_OUT_CHUNK) != 0) {
+      return -1;
+    }
+    ZSTD_outBuffer output = {out->data + out->len, COMPRESS_OUT_CHUNK, 0};
+    size_t remaining = ZSTD_compressStream2(compressor->zstd, &output, &input, modes[flush]);
+    out->len += output.pos;
+    if (ZSTD_isError(remaining)) {
+      LOG_ERROR("zstd compression failed: %s", ZSTD_getErrorName(remaining));
+      return -1;
+    }
+    // continue 模式下只要求消费完输入，flush/end 模式下 remaining 为 0 表示已全部输出
+    if (flush == COMPRESS_CONTINUE ? input.pos == input.size : remaining == 0) {
+      break;
+    }
+  }
+  out->data[out->len] = '\0';
+  return 0;
+}
+
+/**
+ * @brief 压缩数据并追加到输出缓冲区
+ *
+ * @param compressor 压缩器
+ * @param data 数据
+ * @param len 数据长度
+ * @param flush 刷新方式
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int compressor_write(compressor_t *compressor, const void *data, size_t len,
+                     compress_flush_t flush, strbuf_t *out) {
+  if (compressor->encoding == CONTENT_ENCODING_GZIP) {
+    return gzip_write(compressor, data, len, flush, out);
+  }
+  return zstd_write(compressor, data, len, flush, out);
+}
+
+/**
+ * @brief 销毁压缩器
+ *
+ * @param compressor 压缩器
+ */
+void compressor_destroy(compressor_t *compressor) {
+  if (!compressor) {
+    return;
+  }
+  if (compressor->encoding == CONTENT_ENCODING_GZIP) {
+    deflateEnd(&compressor->zs);
+  } else {
+    ZSTD_freeCCtx(compressor->zstd);
+  }
+  free(compressor);
+}
+
+/**
+ * @brief 一次性压缩整块数据
+ *
+ * @param encoding 编码
+ * @param data 数据
+ * @param len 数据长度
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int compress_buffer(content_encoding_t encoding, const void *data, size_t len, strbuf_t *out) {
+  compressor_t *compressor = compressor_create(encoding);
+  if (!compressor) {
+    return -1;
+  }
+  int rc = compressor_write(compressor, data, len, COMPRESS_END, out);
+  compressor_destroy(compressor);
+  return rc;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// clang-format off
+#include <stddef.h>
+#include "src/strbuf.h"
+// clang-format on
+
+// 压缩级别偏向速度：填充过的文本表格和 JSON 在低级别下已有 5~10 倍压缩率
+#define COMPRESS_GZIP_LEVEL 1
+#define COMPRESS_ZSTD_LEVEL 3
+
+// 响应体编码（Content-Encoding）
+typedef enum {
+  CONTENT_ENCODING_IDENTITY = 0,
+  CONTENT_ENCODING_GZIP,
+  CONTENT_ENCODING_ZSTD,
+} content_encoding_t;
+
+// 压缩器每次写入后的刷新方式
+typedef enum {
+  COMPRESS_CONTINUE = 0, // 由压缩器决定何时输出
+  COMPRESS_FLUSH,        // 输出目前为止的全部数据，接收方可以立即解压
+  COMPRESS_END,          // 结束压缩流
+} compress_flush_t;
+
+typedef struct compressor compressor_t;
+
+content_encoding_t content_encoding_negotiate(const char *accept_encoding);
+const char *content_encoding_name(content_encoding_t encoding);
+compressor_t *compressor_create(content_encoding_t encoding);
+int compressor_write(compressor_t *compressor, const void *data, size_t len,
+                     compress_flush_t flush, strbuf_t *out);
+void compressor_destroy(compressor_t *compressor);
+int compress_buffer(content_encoding_t encoding, const void *data, size_t len, strbuf_t *out);
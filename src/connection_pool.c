@@ -1,10 +1,13 @@
 // clang-format off
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include "connection_pool.h"
 #include "src/assert.h"
+#include "src/clock.h"
 #include "src/logger.h"
+#include "src/sql_quote.h"
 // clang-format on
 
 /**
@@ -15,11 +18,13 @@
  * @param password 密码字符串
  * @param database 数据库字符串
  * @param connection_id 唯一标识
+ * @param stmt_counters 语句缓存的计数
  * @return mysql_connection_t* 数据库连接对象
  */
 static mysql_connection_t *create_single_connection(const char *host, const char *user,
                                                     const char *password, const char *database,
-                                                    int connection_id) {
+                                                    int connection_id,
+                                                    stmt_cache_counters_t *stmt_counters) {
   DBMNGR_ASSERT(host);
   DBMNGR_ASSERT(user);
   DBMNGR_ASSERT(password);
@@ -38,6 +43,8 @@ static mysql_connection_t *create_single_connection(const char *host, const char
     return NULL;
   }
 
+  // 语句中的字符串字面量按这个字符集转义，不能随服务端的默认字符集变化
+  mysql_options(conn->mysql_conn, MYSQL_SET_CHARSET_NAME, SQL_QUOTE_CHARSET);
   if (mysql_real_connect(conn->mysql_conn, host, user, password, database, 0, NULL, 0) == NULL) {
     LOG_ERROR("mysql_real_connect() failed for connection %d: %s", connection_id,
               mysql_error(conn->mysql_conn));
@@ -45,6 +52,14 @@ static mysql_connection_t *create_single_connection(const char *host, const char
     free(conn);
     return NULL;
   }
+  // 服务端的全局 sql_mode 含 NO_BACKSLASH_ESCAPES 时，反斜杠转义会变成普通字符
+  if (mysql_query(conn->mysql_conn, SQL_QUOTE_SESSION_SQL_MODE) != 0) {
+    LOG_ERROR("Failed to set sql_mode for connection %d: %s", connection_id,
+              mysql_error(conn->mysql_conn));
+    mysql_close(conn->mysql_conn);
+    free(conn);
+    return NULL;
+  }
 
   conn->connection_id = connection_id;
   conn->in_use = false;
@@ -54,6 +69,10 @@ static mysql_connection_t *create_single_connection(const char *host, const char
   conn->password = strdup(password);
   conn->database = strdup(database);
   conn->port = 0; // 使用默认端口
+  conn->deadline_us = 0;
+  conn->thread_id = 0;
+  conn->killed = false;
+  stmt_cache_init(&conn->stmts, stmt_counters);
 
   LOG_DEBUG("Created MySQL connection %d to %s@%s/%s", connection_id, user, host, database);
 
@@ -95,7 +114,12 @@ connection_pool_t *create_connection_pool(const char *host, const char *user, co
 
   pool->pool_size = pool_size;
   pool->active_connections = 0;
+  pool->waiters = 0;
+  pool->reconnects = 0;
   pool->shutdown = false;
+  pool->wait_observer = NULL;
+  pool->wait_ctx = NULL;
+  stmt_cache_counters_init(&pool->stmt_counters);
 
   if (pthread_mutex_init(&pool->pool_mutex, NULL) != 0) {
     LOG_ERROR("Failed to initialize pool mutex");
@@ -104,7 +128,13 @@ connection_pool_t *create_connection_pool(const char *host, const char *user, co
     return NULL;
   }
 
-  if (pthread_cond_init(&pool->connection_available, NULL) != 0) {
+  // 等待截止时间按单调时钟计算，与 clock_now_us() 一致，不受系统时间调整影响
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  int cond_ret = pthread_cond_init(&pool->connection_available, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+  if (cond_ret != 0) {
     LOG_ERROR("Failed to initialize condition variable");
     pthread_mutex_destroy(&pool->pool_mutex);
     free(pool->connections);
@@ -114,7 +144,8 @@ connection_pool_t *create_connection_pool(const char *host, const char *user, co
 
   int successful_connections = 0;
   for (int i = 0; i < pool_size; ++i) {
-    pool->connections[i] = *create_single_connection(host, user, password, database, i);
+    pool->connections[i] = *create_single_connection(host, user, password, database, i,
+                                                      &pool->stmt_counters);
     if (pool->connections[i].mysql_conn != NULL) {
       ++successful_connections;
     } else {
@@ -135,17 +166,29 @@ connection_pool_t *create_connection_pool(const char *host, const char *user, co
 }
 
 /**
- * @brief 获取数据库连接对象
+ * @brief 获取数据库连接对象，没有空闲连接时一直等待
  *
  * @param pool 数据库连接池
  * @return mysql_connection_t* 数据库连接对象
  */
 mysql_connection_t *get_connection(connection_pool_t *pool) {
+  return get_connection_until(pool, 0);
+}
+
+/**
+ * @brief 获取数据库连接对象，没有空闲连接时最多等到截止时间
+ *
+ * @param pool 数据库连接池
+ * @param deadline_us 截止时间（clock_now_us() 的单调时钟），0 表示一直等待
+ * @return mysql_connection_t* 数据库连接对象；超时或失败返回 NULL
+ */
+mysql_connection_t *get_connection_until(connection_pool_t *pool, uint64_t deadline_us) {
   if (pool == NULL || pool->shutdown) {
     LOG_ERROR("Attempted to get connection from invalid or shutdown pool");
     return NULL;
   }
 
+  uint64_t begin_us = pool->wait_observer ? clock_now_us() : 0;
   pthread_mutex_lock(&pool->pool_mutex);
 
   while (true) {
@@ -157,13 +200,17 @@ mysql_connection_t *get_connection(connection_pool_t *pool) {
           LOG_WARN("Connection %d is unhealthy, attempting to reconnect", conn->connection_id);
 
           // 健康检查失败则重新建立连接
+          // 旧会话上准备的语句随连接一起作废
           mysql_close(conn->mysql_conn);
-          mysql_connection_t *new_conn = create_single_connection(
-              conn->host, conn->user, conn->password, conn->database, conn->connection_id);
+          stmt_cache_clear(&conn->stmts);
+          mysql_connection_t *new_conn =
+              create_single_connection(conn->host, conn->user, conn->password, conn->database,
+                                       conn->connection_id, &pool->stmt_counters);
 
           if (new_conn != NULL) {
             *conn = *new_conn;
             free(new_conn);
+            ++pool->reconnects;
           } else {
             LOG_ERROR("Failed to reconnect connection %d", conn->connection_id);
             continue; // 跳过这个连接，继续找下一个
@@ -178,13 +225,33 @@ mysql_connection_t *get_connection(connection_pool_t *pool) {
 
         LOG_DEBUG("Acquired connection %d, active: %d", conn->connection_id,
                   pool->active_connections);
+        if (pool->wait_observer) {
+          pool->wait_observer(pool->wait_ctx, clock_now_us() - begin_us);
+        }
         return conn;
       } // end if()
     } // end for()
 
     // 没有可用连接
     LOG_DEBUG("No available connections, waiting...");
-    pthread_cond_wait(&pool->connection_available, &pool->pool_mutex);
+    ++pool->waiters;
+    int ret = 0;
+    if (deadline_us == 0) {
+      pthread_cond_wait(&pool->connection_available, &pool->pool_mutex);
+    } else {
+      struct timespec abstime = {.tv_sec = (time_t)(deadline_us / 1000000),
+                                 .tv_nsec = (long)(deadline_us % 1000000) * 1000};
+      ret = pthread_cond_timedwait(&pool->connection_available, &pool->pool_mutex, &abstime);
+    }
+    --pool->waiters;
+    if (ret == ETIMEDOUT) {
+      pthread_mutex_unlock(&pool->pool_mutex);
+      LOG_DEBUG("Timed out waiting for a connection");
+      if (pool->wait_observer) {
+        pool->wait_observer(pool->wait_ctx, clock_now_us() - begin_us);
+      }
+      return NULL;
+    }
   } // end while()
 }
 
@@ -257,6 +324,7 @@ void destroy_connection_pool(connection_pool_t *pool) {
 
     if (conn->mysql_conn != NULL) {
       mysql_close(conn->mysql_conn);
+      stmt_cache_clear(&conn->stmts);
       conn->mysql_conn = NULL;
     }
 
@@ -274,3 +342,65 @@ void destroy_connection_pool(connection_pool_t *pool) {
   free(pool);
   LOG_INFO("Connection pool destroyed");
 }
+
+/**
+ * @brief 设置获取连接的等待时间观察者，需在连接池被并发使用之前设置
+ *
+ * @param pool 数据库连接池
+ * @param fn 观察者，为 NULL 时取消
+ * @param ctx 观察者上下文
+ */
+void connection_pool_set_wait_observer(connection_pool_t *pool, connection_wait_fn fn, void *ctx) {
+  if (pool) {
+    pool->wait_observer = fn;
+    pool->wait_ctx = ctx;
+  }
+}
+
+/**
+ * @brief 获取连接池状态
+ *
+ * @param pool 数据库连接池
+ * @param stats 输出状态
+ */
+void connection_pool_stats(connection_pool_t *pool, connection_pool_stats_t *stats) {
+  pthread_mutex_lock(&pool->pool_mutex);
+  stats->pool_size = pool->pool_size;
+  stats->active_connections = pool->active_connections;
+  stats->waiters = pool->waiters;
+  stats->reconnects = pool->reconnects;
+  pthread_mutex_unlock(&pool->pool_mutex);
+  stmt_cache_counters_stats(&pool->stmt_counters, &stats->stmts);
+}
+
+/**
+ * @brief 用连接池的账号建立一条池外的连接，供后台线程使用，不占用池中的连接
+ *
+ * @param pool 数据库连接池
+ * @param purpose 用途，用于日志
+ * @return MYSQL* 连接，使用完毕后调用 mysql_close() 关闭；失败返回 NULL
+ */
+MYSQL *connection_pool_connect(connection_pool_t *pool, const char *purpose) {
+  mysql_connection_t *conn = NULL;
+  for (int i = 0; i < pool->pool_size && !conn; ++i) {
+    if (pool->connections[i].host) {
+      conn = &pool->connections[i];
+    }
+  }
+  if (!conn) {
+    return NULL;
+  }
+
+  MYSQL *mysql = mysql_init(NULL);
+  if (!mysql) {
+    LOG_ERROR("mysql_init() failed for the %s", purpose);
+    return NULL;
+  }
+  if (mysql_real_connect(mysql, conn->host, conn->user, conn->password, conn->database, conn->port,
+                         NULL, 0) == NULL) {
+    LOG_ERROR("The %s failed to connect: %s", purpose, mysql_error(mysql));
+    mysql_close(mysql);
+    return NULL;
+  }
+  return mysql;
+}
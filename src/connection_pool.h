@@ -3,7 +3,9 @@
 // clang-format off
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <mysql/mysql.h>
+#include "src/stmt_cache.h"
 // clang-format on
 
 typedef struct {
@@ -16,20 +18,46 @@ typedef struct {
   char *password;
   char *database;
   unsigned int port;
+  // 以下字段由 query_watchdog 在其互斥锁下读写
+  uint64_t deadline_us;    // 正在执行的语句的截止时间，0 表示没有
+  unsigned long thread_id; // 语句所在的 MySQL 会话 ID，KILL QUERY 的目标
+  bool killed;             // 语句因超过截止时间被终止
+  stmt_cache_t stmts;      // 这个连接上准备好的语句，连接重建时全部作废
 } mysql_connection_t;
 
+// 获取连接的等待时间观察者
+typedef void (*connection_wait_fn)(void *ctx, uint64_t wait_us);
+
+// 连接池状态快照
+typedef struct {
+  int pool_size;
+  int active_connections;
+  int waiters;                   // 正在等待空闲连接的线程数
+  unsigned long long reconnects; // 累计重建的连接数
+  stmt_cache_stats_t stmts;      // 各连接的语句缓存合计
+} connection_pool_stats_t;
+
 typedef struct {
   mysql_connection_t *connections; // 共享资源，数组形式组织
   int pool_size;
   int active_connections;
+  int waiters;
+  unsigned long long reconnects;
   pthread_mutex_t pool_mutex;
   pthread_cond_t connection_available;
   bool shutdown;
+  connection_wait_fn wait_observer; // 为 NULL 时不统计等待时间
+  void *wait_ctx;
+  stmt_cache_counters_t stmt_counters; // 全部连接的语句缓存共享的计数
 } connection_pool_t;
 
 connection_pool_t *create_connection_pool(const char *host, const char *user, const char *password,
                                           const char *database, int pool_size);
 mysql_connection_t *get_connection(connection_pool_t *pool);
+mysql_connection_t *get_connection_until(connection_pool_t *pool, uint64_t deadline_us);
 void release_connection(connection_pool_t *pool, mysql_connection_t *conn);
 void destroy_connection_pool(connection_pool_t *pool);
 bool check_connection_health(mysql_connection_t *conn);
+void connection_pool_set_wait_observer(connection_pool_t *pool, connection_wait_fn fn, void *ctx);
+void connection_pool_stats(connection_pool_t *pool, connection_pool_stats_t *stats);
+MYSQL *connection_pool_connect(connection_pool_t *pool, const char *purpose);
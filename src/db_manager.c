@@ -1,11 +1,233 @@
 // clang-format off
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <mysql/mysqld_error.h>
 #include "db_manager.h"
 #include "src/assert.h"
+#include "src/clock.h"
 #include "src/logger.h"
+#include "src/macro.h"
+#include "src/sql_quote.h"
+#include "src/strbuf.h"
 // clang-format on
 
+// 每个线程独立保存最近一次的错误信息，避免并发请求之间互相覆盖
+static __thread char tls_last_error[DB_ERROR_MSG_LEN];
+// 每个线程独立累计数据库操作各阶段的耗时，请求在哪个线程上执行就从哪个线程读取
+static __thread db_timing_t tls_timing;
+// 当前线程上请求的截止时间，0 表示不限时
+static __thread uint64_t tls_deadline_us;
+static __thread bool tls_deadline_exceeded;
+
+/**
+ * @brief 记录当前线程的错误信息
+ *
+ * @param error_msg 错误信息
+ */
+static void db_manager_set_error(const char *error_msg) {
+  snprintf(tls_last_error, sizeof(tls_last_error), "%s", error_msg);
+}
+
+/**
+ * @brief 获取当前线程最近一次操作的错误信息
+ *
+ * @param manager 数据库管理对象
+ * @return const char* 错误信息，没有错误返回 NULL
+ */
+const char *db_manager_last_error(db_manager_t *manager) {
+  (void)manager;
+  return tls_last_error[0] != '\0' ? tls_last_error : NULL;
+}
+
+/**
+ * @brief 获取因连接断开而重试的累计次数
+ *
+ * @param manager 数据库管理对象
+ * @return unsigned long long 重试次数
+ */
+unsigned long long db_manager_retry_count(db_manager_t *manager) {
+  return atomic_load_explicit(&manager->retries, memory_order_relaxed);
+}
+
+/**
+ * @brief 清零当前线程的阶段耗时，在一个请求开始执行数据库操作之前调用
+ */
+void db_manager_timing_reset(void) {
+  memset(&tls_timing, 0, sizeof(tls_timing));
+}
+
+/**
+ * @brief 获取当前线程自上次清零以来各阶段的累计耗时
+ *
+ * @param timing 输出耗时
+ */
+void db_manager_timing(db_timing_t *timing) {
+  *timing = tls_timing;
+}
+
+/**
+ * @brief 设置当前线程上后续数据库操作的截止时间：限制等待连接的时间，给 SELECT 加上
+ *        MAX_EXECUTION_TIME，并在语句超时后由监视线程 KILL QUERY
+ *
+ * @param deadline_us 截止时间（clock_now_us() 的单调时钟），0 表示不限时
+ */
+void db_manager_set_deadline(uint64_t deadline_us) {
+  tls_deadline_us = deadline_us;
+  tls_deadline_exceeded = false;
+}
+
+/**
+ * @brief 当前线程自上次 db_manager_set_deadline() 以来是否有操作因超过截止时间而失败
+ *
+ * @return bool 超时返回 true
+ */
+bool db_manager_deadline_exceeded(void) {
+  return tls_deadline_exceeded;
+}
+
+/**
+ * @brief 当前线程上的截止时间
+ *
+ * @return uint64_t 截止时间（clock_now_us() 的单调时钟），0 表示不限时
+ */
+uint64_t db_manager_deadline(void) {
+  return tls_deadline_us;
+}
+
+/**
+ * @brief 定期轮询 information_schema，让绕过本进程的写入也能使 ETag 失效
+ *
+ * @param manager 数据库管理对象
+ * @param poll_ms 轮询间隔（毫秒）
+ * @return int 成功（0）；失败（-1）
+ */
+int db_manager_watch_tables(db_manager_t *manager, int poll_ms) {
+  if (!manager) {
+    return -1;
+  }
+  return table_versions_watch(&manager->versions, manager->conn_pool, poll_ms);
+}
+
+/**
+ * @brief 启用 READ 结果缓存
+ *
+ * @param manager 数据库管理对象
+ * @param budget_bytes 缓存的字节数上限，0 表示不启用
+ * @param ttl_ms 默认 TTL（毫秒）
+ * @param table_ttls 各表的 TTL，形如 "orders:500,audit_log:0"，可以为 NULL
+ * @return int 成功（0）；失败（-1）
+ */
+int db_manager_enable_read_cache(db_manager_t *manager, size_t budget_bytes, uint64_t ttl_ms,
+                                 const char *table_ttls) {
+  if (!manager) {
+    return -1;
+  }
+  if (table_ttls && read_cache_parse_table_ttls(&manager->cache, table_ttls) != 0) {
+    return -1;
+  }
+  return read_cache_enable(&manager->cache, budget_bytes, ttl_ms);
+}
+
+/**
+ * @brief 是否合并相同的在途 READ，默认合并，需在开始处理请求之前设置
+ *
+ * @param manager 数据库管理对象
+ * @param enabled 是否合并
+ */
+void db_manager_coalesce_reads(db_manager_t *manager, bool enabled) {
+  manager->flights.enabled = enabled && manager->flights.shards;
+}
+
+/**
+ * @brief 从连接池取出连接，设置了截止时间时最多等到截止时间，并累计等待时间
+ *
+ * @param manager 数据库管理对象
+ * @return mysql_connection_t* 连接，失败返回 NULL
+ */
+static mysql_connection_t *db_manager_get_connection(db_manager_t *manager) {
+  uint64_t start_us = clock_now_us();
+  if (tls_deadline_us > 0 && start_us >= tls_deadline_us) {
+    tls_deadline_exceeded = true;
+    db_manager_set_error("Deadline exceeded before getting a database connection");
+    return NULL;
+  }
+
+  mysql_connection_t *conn = get_connection_until(manager->conn_pool, tls_deadline_us);
+  uint64_t end_us = clock_now_us();
+  tls_timing.conn_wait_us += end_us - start_us;
+  if (!conn && tls_deadline_us > 0 && end_us >= tls_deadline_us) {
+    tls_deadline_exceeded = true;
+    db_manager_set_error("Deadline exceeded while waiting for a database connection");
+  }
+  return conn;
+}
+
+/**
+ * @brief 语句结束后注销截止时间，判断失败是否由超时引起
+ *
+ * @param manager 数据库管理对象
+ * @param conn 连接
+ * @param failed 语句是否失败
+ */
+static void db_manager_check_deadline(db_manager_t *manager, mysql_connection_t *conn,
+                                      bool failed) {
+  bool killed = query_watchdog_disarm(&manager->watchdog, conn);
+  if (!failed || tls_deadline_us == 0) {
+    return;
+  }
+  // 语句执行完之后才送达的 KILL QUERY 不影响结果，MySQL 会在下一条语句开始时清除它
+  unsigned int error_no = mysql_errno(conn->mysql_conn);
+  if (killed || error_no == ER_QUERY_TIMEOUT ||
+      (error_no == ER_QUERY_INTERRUPTED && clock_now_us() >= tls_deadline_us)) {
+    tls_deadline_exceeded = true;
+  }
+}
+
+/**
+ * @brief 执行 sql 语句，并累计执行时间
+ *
+ * @param manager 数据库管理对象
+ * @param conn 连接
+ * @param query sql 语句
+ * @return int mysql_query() 的返回值
+ */
+static int db_manager_query(db_manager_t *manager, mysql_connection_t *conn, const char *query) {
+  uint64_t start_us = clock_now_us();
+  query_watchdog_arm(&manager->watchdog, conn, tls_deadline_us);
+  int ret = mysql_query(conn->mysql_conn, query);
+  db_manager_check_deadline(manager, conn, ret != 0);
+  tls_timing.query_us += clock_now_us() - start_us;
+  return ret;
+}
+
+/**
+ * @brief 获取结果集，并累计获取时间
+ *
+ * @param manager 数据库管理对象
+ * @param conn 连接
+ * @param buffered 为 true 时一次性读取到客户端（mysql_store_result），
+ *                 否则逐行拉取（mysql_use_result）
+ * @return MYSQL_RES* 结果集
+ */
+static MYSQL_RES *db_manager_result(db_manager_t *manager, mysql_connection_t *conn,
+                                    bool buffered) {
+  uint64_t start_us = clock_now_us();
+  MYSQL_RES *mysql_res = NULL;
+  if (buffered) {
+    // 一次性读取整个结果集也可能很慢，同样受截止时间约束
+    query_watchdog_arm(&manager->watchdog, conn, tls_deadline_us);
+    mysql_res = mysql_store_result(conn->mysql_conn);
+    db_manager_check_deadline(manager, conn,
+                              !mysql_res && mysql_field_count(conn->mysql_conn) > 0);
+  } else {
+    mysql_res = mysql_use_result(conn->mysql_conn);
+  }
+  tls_timing.result_us += clock_now_us() - start_us;
+  return mysql_res;
+}
+
 /**
  * @brief 初始化数据库管理器
  *
@@ -38,8 +260,40 @@ db_manager_t *db_manager_init(const char *host, const char *user, const char *pa
     return NULL;
   }
 
-  manager->last_error = NULL;
   manager->max_retries = DB_MAX_RETRIES;
+  atomic_init(&manager->retries, 0);
+  read_cache_init(&manager->cache);
+
+  if (table_versions_init(&manager->versions) != 0) {
+    destroy_connection_pool(manager->conn_pool);
+    free(manager);
+    return NULL;
+  }
+
+  if (single_flight_init(&manager->flights, true) != 0) {
+    table_versions_destroy(&manager->versions);
+    destroy_connection_pool(manager->conn_pool);
+    free(manager);
+    return NULL;
+  }
+
+  if (table_schemas_init(&manager->schemas) != 0) {
+    single_flight_destroy(&manager->flights);
+    table_versions_destroy(&manager->versions);
+    destroy_connection_pool(manager->conn_pool);
+    free(manager);
+    return NULL;
+  }
+
+  if (query_watchdog_start(&manager->watchdog, manager->conn_pool) != 0) {
+    LOG_ERROR("Failed to start query watchdog for DB manager");
+    table_schemas_destroy(&manager->schemas);
+    single_flight_destroy(&manager->flights);
+    table_versions_destroy(&manager->versions);
+    destroy_connection_pool(manager->conn_pool);
+    free(manager);
+    return NULL;
+  }
 
   LOG_INFO("DB manager initialized successfully");
   return manager;
@@ -57,14 +311,15 @@ void db_manager_destroy(db_manager_t *manager) {
 
   LOG_INFO("Destroying DB manager");
 
+  query_watchdog_stop(&manager->watchdog);
+  table_versions_destroy(&manager->versions);
+  read_cache_destroy(&manager->cache);
+  single_flight_destroy(&manager->flights);
+  table_schemas_destroy(&manager->schemas);
   if (manager->conn_pool) {
     destroy_connection_pool(manager->conn_pool);
   }
 
-  if (manager->last_error) {
-    free(manager->last_error);
-  }
-
   free(manager);
   LOG_INFO("DB manager destroyed");
 }
@@ -83,30 +338,36 @@ static mysql_connection_t *db_manager_execute_common(db_manager_t *manager, cons
 
   mysql_connection_t *conn = NULL;
   int retry_count = 0;
+  tls_last_error[0] = '\0';
 
   while (retry_count < manager->max_retries) {
-    conn = get_connection(manager->conn_pool);
+    conn = db_manager_get_connection(manager);
     if (!conn) {
+      if (tls_deadline_exceeded) {
+        LOG_WARN("Deadline exceeded while waiting for a connection");
+        break;
+      }
       LOG_ERROR("Failed to get connection (attempt %d/%d)", retry_count + 1, manager->max_retries);
       ++retry_count;
+      atomic_fetch_add_explicit(&manager->retries, 1, memory_order_relaxed);
       continue;
     }
 
-    if (mysql_query(conn->mysql_conn, query) != 0) {
+    if (db_manager_query(manager, conn, query) != 0) {
       const char *error_msg = mysql_error(conn->mysql_conn);
+      unsigned int error_no = mysql_errno(conn->mysql_conn);
       LOG_ERROR("Query execution failed: %s (attempt %d/%d)", error_msg, retry_count + 1,
                 manager->max_retries);
 
-      if (manager->last_error) {
-        free(manager->last_error);
-      }
-      manager->last_error = strdup(error_msg);
+      db_manager_set_error(error_msg);
+      // 归还后连接可能立即被其他线程取走，错误码需要在归还之前读取
       release_connection(manager->conn_pool, conn);
 
-      // 连接错误重试
-      if (mysql_errno(conn->mysql_conn) == CR_SERVER_GONE_ERROR ||
-          mysql_errno(conn->mysql_conn) == CR_SERVER_LOST) {
+      // 连接错误重试，超过截止时间后不再重试
+      if (!tls_deadline_exceeded &&
+          (error_no == CR_SERVER_GONE_ERROR || error_no == CR_SERVER_LOST)) {
         retry_count++;
+        atomic_fetch_add_explicit(&manager->retries, 1, memory_order_relaxed);
         continue;
       } else {
         break;
@@ -140,16 +401,13 @@ static db_result_t *db_manager_execute_query(db_manager_t *manager, const char *
     return NULL;
   }
 
-  MYSQL_RES *mysql_res = mysql_store_result(conn->mysql_conn);
+  MYSQL_RES *mysql_res = db_manager_result(manager, conn, true);
   if (!mysql_res && mysql_field_count(conn->mysql_conn) > 0) {
     // 应该有结果集但没有获取到
     const char *error_msg = mysql_error(conn->mysql_conn);
     LOG_ERROR("Failed to store result: %s", error_msg);
 
-    if (manager->last_error) {
-      free(manager->last_error);
-    }
-    manager->last_error = strdup(error_msg);
+    db_manager_set_error(error_msg);
     release_connection(manager->conn_pool, conn);
     return NULL;
   }
@@ -203,107 +461,1433 @@ static int db_manager_execute_update(db_manager_t *manager, const char *query) {
 }
 
 /**
- * @brief 释放结果集
+ * @brief 把参数绑定到预处理语句，参数个数必须与语句中的 '?' 一致
  *
- * @param result 结果集对象
+ * @param stmt 预处理语句
+ * @param params 参数
+ * @param binds 绑定数组，至少 params->count 个，执行完之前必须有效
+ * @param lengths 字符串参数的长度，至少 params->count 个，执行完之前必须有效
+ * @param error_msg 出错时输出错误信息
+ * @param size 错误信息缓冲区大小
+ * @return int 成功（0）；失败（-1）
  */
-void db_result_free(db_result_t *result) {
-  if (!result)
-    return;
-
-  if (result->mysql_res) {
-    mysql_free_result(result->mysql_res);
+static int bind_params(MYSQL_STMT *stmt, const db_params_t *params, MYSQL_BIND *binds,
+                       unsigned long *lengths, char *error_msg, size_t size) {
+  unsigned long expected = mysql_stmt_param_count(stmt);
+  if (expected != params->count) {
+    snprintf(error_msg, size, "Statement has %lu placeholders but %zu params were given",
+             expected, params->count);
+    return -1;
+  }
+  if (params->count == 0) {
+    return 0;
   }
 
-  free(result);
+  memset(binds, 0, sizeof(MYSQL_BIND) * params->count);
+  for (size_t i = 0; i < params->count; ++i) {
+    const db_param_t *param = &params->values[i];
+    switch (param->type) {
+    case DB_PARAM_INT:
+      binds[i].buffer_type = MYSQL_TYPE_LONGLONG;
+      binds[i].buffer = (void *)&param->i;
+      break;
+    case DB_PARAM_DOUBLE:
+      binds[i].buffer_type = MYSQL_TYPE_DOUBLE;
+      binds[i].buffer = (void *)&param->d;
+      break;
+    case DB_PARAM_STRING:
+      lengths[i] = (unsigned long)param->len;
+      binds[i].buffer_type = MYSQL_TYPE_STRING;
+      binds[i].buffer = (void *)param->str;
+      binds[i].buffer_length = lengths[i];
+      binds[i].length = &lengths[i];
+      break;
+    default:
+      binds[i].buffer_type = MYSQL_TYPE_NULL;
+      break;
+    }
+  }
+  if (mysql_stmt_bind_param(stmt, binds)) {
+    snprintf(error_msg, size, "%s", mysql_stmt_error(stmt));
+    return -1;
+  }
+  return 0;
 }
 
 /**
- * @brief 执行插入操作（INSERT）
+ * @brief 以预处理语句执行参数化操作：语句从连接的语句缓存中取得，值以二进制协议发送
+ *
+ * 重试和截止时间的处理与 db_manager_execute_common() 相同；断线后连接池重建连接时，
+ * 这个连接上缓存的语句一并作废，重试时重新准备
  *
  * @param manager 数据库管理对象
- * @param table 表
- * @param data 数据
- * @return int 生效条目数量
+ * @param query 语句，值用 '?' 占位
+ * @param params 参数
+ * @param stmt 输出执行过的语句，属于连接的语句缓存
+ * @return mysql_connection_t* 数据库连接对象，失败返回 NULL
  */
-int db_manager_create_row(db_manager_t *manager, const char *table, const char *data) {
-  if (!manager || !table || !data) {
-    LOG_ERROR("Invalid parameters for create_row");
-    return -1;
+static mysql_connection_t *db_manager_execute_prepared(db_manager_t *manager, const char *query,
+                                                       const db_params_t *params,
+                                                       MYSQL_STMT **stmt) {
+  tls_last_error[0] = '\0';
+  if (params->overflow) {
+    db_manager_set_error("Too many params, at most " STR_HELPER(DB_PARAMS_MAX));
+    return NULL;
   }
 
-  char query[1024];
-  snprintf(query, sizeof(query), "INSERT INTO %s SET %s", table, data);
+  MYSQL_BIND binds[DB_PARAMS_MAX];
+  unsigned long lengths[DB_PARAMS_MAX];
+  int retry_count = 0;
+  while (retry_count < manager->max_retries) {
+    mysql_connection_t *conn = db_manager_get_connection(manager);
+    if (!conn) {
+      if (tls_deadline_exceeded) {
+        LOG_WARN("Deadline exceeded while waiting for a connection");
+        break;
+      }
+      LOG_ERROR("Failed to get connection (attempt %d/%d)", retry_count + 1, manager->max_retries);
+      ++retry_count;
+      atomic_fetch_add_explicit(&manager->retries, 1, memory_order_relaxed);
+      continue;
+    }
 
-  LOG_INFO("Creating row in %s: %s", table, data);
-  return db_manager_execute_update(manager, query);
+    char error_msg[DB_ERROR_MSG_LEN];
+    unsigned int error_no = 0;
+    uint64_t start_us = clock_now_us();
+    *stmt = stmt_cache_prepare(&conn->stmts, conn->mysql_conn, query, &error_no, error_msg,
+                               sizeof(error_msg));
+    if (*stmt &&
+        bind_params(*stmt, params, binds, lengths, error_msg, sizeof(error_msg)) == 0) {
+      query_watchdog_arm(&manager->watchdog, conn, tls_deadline_us);
+      int ret = mysql_stmt_execute(*stmt);
+      db_manager_check_deadline(manager, conn, ret != 0);
+      tls_timing.query_us += clock_now_us() - start_us;
+      if (ret == 0) {
+        return conn;
+      }
+      error_no = mysql_stmt_errno(*stmt);
+      snprintf(error_msg, sizeof(error_msg), "%s", mysql_stmt_error(*stmt));
+    } else {
+      tls_timing.query_us += clock_now_us() - start_us;
+    }
+    *stmt = NULL;
+
+    LOG_ERROR("Prepared statement failed: %s (attempt %d/%d)", error_msg, retry_count + 1,
+              manager->max_retries);
+    db_manager_set_error(error_msg);
+    release_connection(manager->conn_pool, conn);
+
+    // 连接错误重试，超过截止时间后不再重试
+    if (!tls_deadline_exceeded &&
+        (error_no == CR_SERVER_GONE_ERROR || error_no == CR_SERVER_LOST)) {
+      ++retry_count;
+      atomic_fetch_add_explicit(&manager->retries, 1, memory_order_relaxed);
+      continue;
+    }
+    break;
+  }
+  return NULL;
 }
 
+// 参数化读取的结果：各列都绑定为字符串，由客户端库按列类型转换，与文本协议的结果一样交给调用者
+struct db_stmt_result {
+  MYSQL_STMT *stmt; // 属于连接的语句缓存
+  int num_fields;
+  MYSQL_BIND *binds;
+  MYSQL_ROW row;
+  unsigned long *lengths;
+  bool *nulls;
+  bool *truncated;
+};
+
+// 各列缓冲区的初始大小，放不下的值按实际长度加大
+#define STMT_COLUMN_BUFFER 256
+
 /**
- * @brief 执行查询操作（SELECT）
+ * @brief 释放参数化读取的结果，未读完的行由 mysql_stmt_free_result() 读出丢弃，语句留在缓存中
  *
- * @param manager 数据库管理对象
- * @param table 表
- * @param where 条件
- * @return db_result_t* 结果集
+ * @param result 结果
  */
-db_result_t *db_manager_read_row(db_manager_t *manager, const char *table, const char *where) {
-  if (!manager || !table) {
-    LOG_ERROR("Invalid parameters for read_row");
+static void db_stmt_result_free(db_stmt_result_t *result) {
+  if (!result) {
+    return;
+  }
+  mysql_stmt_free_result(result->stmt);
+  for (int i = 0; result->binds && i < result->num_fields; ++i) {
+    free(result->binds[i].buffer);
+  }
+  free(result->binds);
+  free(result->row);
+  free(result->lengths);
+  free(result->nulls);
+  free(result->truncated);
+  free(result);
+}
+
+/**
+ * @brief 为执行过的语句的各列分配缓冲区并绑定
+ *
+ * @param stmt 执行过的语句
+ * @param num_fields 列数
+ * @return db_stmt_result_t* 结果；失败返回 NULL，语句的结果已释放
+ */
+static db_stmt_result_t *db_stmt_result_new(MYSQL_STMT *stmt, int num_fields) {
+  db_stmt_result_t *result = calloc(1, sizeof(db_stmt_result_t));
+  if (!result) {
+    mysql_stmt_free_result(stmt);
+    return NULL;
+  }
+  result->stmt = stmt;
+  result->num_fields = num_fields;
+  result->binds = calloc((size_t)num_fields, sizeof(MYSQL_BIND));
+  result->row = calloc((size_t)num_fields, sizeof(char *));
+  result->lengths = calloc((size_t)num_fields, sizeof(unsigned long));
+  result->nulls = calloc((size_t)num_fields, sizeof(bool));
+  result->truncated = calloc((size_t)num_fields, sizeof(bool));
+  bool ok = result->binds && result->row && result->lengths && result->nulls && result->truncated;
+  for (int i = 0; ok && i < num_fields; ++i) {
+    MYSQL_BIND *bind = &result->binds[i];
+    bind->buffer = malloc(STMT_COLUMN_BUFFER);
+    ok = bind->buffer != NULL;
+    bind->buffer_type = MYSQL_TYPE_STRING;
+    bind->buffer_length = STMT_COLUMN_BUFFER - 1; // 留一个字节给结尾的 '\0'
+    bind->length = &result->lengths[i];
+    bind->is_null = &result->nulls[i];
+    bind->error = &result->truncated[i];
+  }
+  if (!ok || mysql_stmt_bind_result(stmt, result->binds)) {
+    db_stmt_result_free(result);
     return NULL;
   }
+  return result;
+}
 
-  char query[1024];
-  if (where && where[0] != '\0') {
-    snprintf(query, sizeof(query), "SELECT * FROM %s WHERE %s", table, where);
-  } else {
-    snprintf(query, sizeof(query), "SELECT * FROM %s", table);
+/**
+ * @brief 读取参数化读取的下一行，缓冲区放不下的列加大后单独重新读取
+ *
+ * @param result 结果
+ * @param error_msg 出错时输出错误信息
+ * @param size 错误信息缓冲区大小
+ * @param failed 输出是否出错
+ * @return MYSQL_ROW 行数据，NULL 列为 NULL；读完或出错返回 NULL
+ */
+static MYSQL_ROW db_stmt_result_fetch(db_stmt_result_t *result, char *error_msg, size_t size,
+                                      bool *failed) {
+  *failed = false;
+  int rc = mysql_stmt_fetch(result->stmt);
+  if (rc == MYSQL_NO_DATA) {
+    return NULL;
+  }
+  if (rc == MYSQL_DATA_TRUNCATED) {
+    bool rebind = false;
+    for (int i = 0; i < result->num_fields; ++i) {
+      if (!result->truncated[i]) {
+        continue;
+      }
+      MYSQL_BIND *bind = &result->binds[i];
+      char *buffer = realloc(bind->buffer, result->lengths[i] + 1);
+      if (!buffer) {
+        snprintf(error_msg, size, "Out of memory");
+        *failed = true;
+        return NULL;
+      }
+      bind->buffer = buffer;
+      bind->buffer_length = result->lengths[i];
+      rebind = true;
+      if (mysql_stmt_fetch_column(result->stmt, bind, (unsigned int)i, 0) != 0) {
+        snprintf(error_msg, size, "%s", mysql_stmt_error(result->stmt));
+        *failed = true;
+        return NULL;
+      }
+    }
+    // 加大的缓冲区从下一行开始生效
+    if (rebind && mysql_stmt_bind_result(result->stmt, result->binds)) {
+      snprintf(error_msg, size, "%s", mysql_stmt_error(result->stmt));
+      *failed = true;
+      return NULL;
+    }
+  } else if (rc != 0) {
+    snprintf(error_msg, size, "%s", mysql_stmt_error(result->stmt));
+    *failed = true;
+    return NULL;
   }
 
-  LOG_INFO("Reading from %s with condition: %s", table, where ? where : "none");
-  return db_manager_execute_query(manager, query);
+  for (int i = 0; i < result->num_fields; ++i) {
+    char *buffer = result->binds[i].buffer;
+    result->row[i] = result->nulls[i] ? NULL : buffer;
+    if (!result->nulls[i]) {
+      buffer[result->lengths[i]] = '\0';
+    }
+  }
+  return result->row;
 }
 
 /**
- * @brief 执行更新操作（UPDATE）
+ * @brief 释放结果集
  *
- * @param manager 数据库管理对象
- * @param table 表
- * @param data 数据
- * @param where 条件
- * @return int 生效条目数
+ * @param result 结果集对象
  */
-int db_manager_update_row(db_manager_t *manager, const char *table, const char *data,
-                          const char *where) {
-  if (!manager || !table || !data || !where) {
-    LOG_ERROR("Invalid parameters for update_row");
-    return -1;
+void db_result_free(db_result_t *result) {
+  if (!result)
+    return;
+
+  if (result->mysql_res) {
+    mysql_free_result(result->mysql_res);
   }
 
-  char query[1024];
-  snprintf(query, sizeof(query), "UPDATE %s SET %s WHERE %s", table, data, where);
+  free(result);
+}
 
-  LOG_INFO("Updating %s: SET %s WHERE %s", table, data, where);
-  return db_manager_execute_update(manager, query);
+/**
+ * @brief 设置了截止时间时由 MySQL 自己在剩余时间用完后中止 SELECT（MAX_EXECUTION_TIME 以毫秒计）
+ *
+ * 预处理语句的文本是语句缓存的键，剩余时间向上取到固定的几档，同样形状的语句只有几个版本；
+ * 因此 MySQL 可能比截止时间晚中止，准确的截止时间仍由 query_watchdog 保证
+ *
+ * @param hint 输出优化器提示，不限时为空串
+ * @param size 缓冲区大小
+ * @param coarse 剩余时间是否取整到固定的档位
+ */
+static void build_deadline_hint(char *hint, size_t size, bool coarse) {
+  static const uint64_t steps_ms[] = {1000, 2000, 5000, 10000, 30000, 60000, 300000};
+  hint[0] = '\0';
+  if (tls_deadline_us > 0) {
+    uint64_t now_us = clock_now_us();
+    uint64_t remaining_ms = tls_deadline_us > now_us ? (tls_deadline_us - now_us) / 1000 : 0;
+    if (remaining_ms == 0) {
+      remaining_ms = 1;
+    }
+    if (coarse) {
+      size_t num_steps = sizeof(steps_ms) / sizeof(steps_ms[0]);
+      size_t i = 0;
+      while (i < num_steps && steps_ms[i] < remaining_ms) {
+        ++i;
+      }
+      // 超过最高一档时取整到分钟
+      remaining_ms = i < num_steps ? steps_ms[i] : (remaining_ms + 59999) / 60000 * 60000;
+    }
+    snprintf(hint, size, "/*+ MAX_EXECUTION_TIME(%llu) */ ", (unsigned long long)remaining_ms);
+  }
 }
 
 /**
- * @brief 执行删除操作
+ * @brief 生成查询语句
  *
- * @param manager 数据库管理对象
+ * @param query 输出缓冲区
+ * @param size 缓冲区大小
  * @param table 表
  * @param where 条件
- * @return int 生效条目数量
  */
-int db_manager_delete_row(db_manager_t *manager, const char *table, const char *where) {
-  if (!manager || !table || !where) {
-    LOG_ERROR("Invalid parameters for delete_row");
-    return -1;
-  }
+static void build_read_query(char *query, size_t size, const char *table, const char *where) {
+  char hint[64];
+  build_deadline_hint(hint, sizeof(hint), false);
+  if (where && where[0] != '\0') {
+    snprintf(query, size, "SELECT %s* FROM %s WHERE %s", hint, table, where);
+  } else {
+    snprintf(query, size, "SELECT %s* FROM %s", hint, table);
+  }
+}
+
+/**
+ * @brief 追加反引号括起的标识符
+ *
+ * @param query 语句
+ * @param name 标识符
+ * @return int 成功（0）；失败（-1）
+ */
+static int append_identifier(strbuf_t *query, const char *name) {
+  return sql_identifier_append(query, name, strlen(name));
+}
+
+/**
+ * @brief 追加主键值的字面量：数值列原样追加，其余加单引号并转义
+ *
+ * @param query 语句
+ * @param value 值
+ * @param len 长度
+ * @param numeric 是否为数值列，令牌解码时已校验只含数字等字符
+ * @return int 成功（0）；失败（-1）
+ */
+static int append_key_literal(strbuf_t *query, const char *value, size_t len, bool numeric) {
+  return numeric ? strbuf_append(query, value, len) : sql_string_append(query, value, len);
+}
+
+/**
+ * @brief 取出逗号分隔列表中的下一项，去掉首尾空白
+ *
+ * @param pos 当前位置，取出后移到下一项
+ * @param item 输出这一项
+ * @param len 输出长度，可能为 0
+ * @return bool 取到（true）；列表已结束（false）
+ */
+static bool next_list_item(const char **pos, const char **item, size_t *len) {
+  if (!*pos) {
+    return false;
+  }
+  const char *start = *pos;
+  const char *comma = strchr(start, ',');
+  const char *end = comma ? comma : start + strlen(start);
+  *pos = comma ? comma + 1 : NULL;
+  while (start < end && isspace((unsigned char)*start)) {
+    ++start;
+  }
+  while (end > start && isspace((unsigned char)end[-1])) {
+    --end;
+  }
+  *item = start;
+  *len = (size_t)(end - start);
+  return true;
+}
+
+/**
+ * @brief 追加选择的列，列名必须都在表中
+ *
+ * @param query 语句
+ * @param schema 表结构
+ * @param columns 逗号分隔的列名
+ * @param error_msg 出错时输出错误信息
+ * @param size 错误信息缓冲区大小
+ * @return int 成功（0）；失败（-1）
+ */
+static int append_columns(strbuf_t *query, const table_schema_t *schema, const char *columns,
+                          char *error_msg, size_t size) {
+  const char *pos = columns, *name;
+  size_t len;
+  for (int i = 0; next_list_item(&pos, &name, &len); ++i) {
+    int column = table_schema_column(schema, name, len);
+    if (column < 0) {
+      snprintf(error_msg, size, "Unknown column '%.*s' in columns", (int)len, name);
+      return -1;
+    }
+    if ((i > 0 && strbuf_append_str(query, ", ") != 0) ||
+        append_identifier(query, schema->columns[column]) != 0) {
+      snprintf(error_msg, size, "Out of memory");
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief 追加排序，每一项为 "列名 [ASC|DESC]"，列名必须在表中
+ *
+ * @param query 语句
+ * @param schema 表结构
+ * @param order_by 逗号分隔的排序项
+ * @param error_msg 出错时输出错误信息
+ * @param size 错误信息缓冲区大小
+ * @return int 成功（0）；失败（-1）
+ */
+static int append_order_by(strbuf_t *query, const table_schema_t *schema, const char *order_by,
+                           char *error_msg, size_t size) {
+  const char *pos = order_by, *item;
+  size_t len;
+  for (int i = 0; next_list_item(&pos, &item, &len); ++i) {
+    size_t name_len = 0;
+    while (name_len < len && !isspace((unsigned char)item[name_len])) {
+      ++name_len;
+    }
+    const char *direction = item + name_len;
+    size_t direction_len = len - name_len;
+    while (direction_len > 0 && isspace((unsigned char)*direction)) {
+      ++direction;
+      --direction_len;
+    }
+    bool desc = direction_len == 4 && strncasecmp(direction, "DESC", 4) == 0;
+    bool asc = direction_len == 0 || (direction_len == 3 && strncasecmp(direction, "ASC", 3) == 0);
+    int column = table_schema_column(schema, item, name_len);
+    if (column < 0 || !(asc || desc)) {
+      snprintf(error_msg, size, "Invalid order_by item '%.*s'", (int)len, item);
+      return -1;
+    }
+    if ((i > 0 && strbuf_append_str(query, ", ") != 0) ||
+        append_identifier(query, schema->columns[column]) != 0 ||
+        (desc && strbuf_append_str(query, " DESC") != 0)) {
+      snprintf(error_msg, size, "Out of memory");
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief 生成带读取参数的查询语句：
+ *        SELECT 列 FROM t [WHERE where] [ORDER BY 排序] [LIMIT 行数]
+ *
+ * 分页时语句为 SELECT 列 FROM t WHERE (where) AND (k1, k2) > (上一页最后一行)
+ * ORDER BY k1, k2 LIMIT n + 1：从主键索引上的位置开始范围扫描，任意一页的代价都与第一页相同
+ * （OFFSET 要扫过前面所有行）；多取的一行只用来判断是否还有下一页
+ *
+ * 参数化读取的语句文本是语句缓存的键，MAX_EXECUTION_TIME 提示的剩余时间取整到固定的档位
+ *
+ * @param query 输出语句
+ * @param table 表
+ * @param where 条件，可以为 NULL
+ * @param schema 表结构
+ * @param options 读取参数
+ * @param after 上一页最后一行的主键值，不分页或第一页为 NULL
+ * @param error_msg 出错时输出错误信息
+ * @param size 错误信息缓冲区大小
+ * @return int 成功（0）；列名或排序不合法、内存不足（-1）
+ */
+static int build_select(strbuf_t *query, const char *table, const char *where,
+                        const table_schema_t *schema, const read_options_t *options,
+                        const page_token_t *after, char *error_msg, size_t size) {
+  char hint[64];
+  build_deadline_hint(hint, sizeof(hint), options->params != NULL);
+  if (strbuf_appendf(query, "SELECT %s", hint) != 0) {
+    snprintf(error_msg, size, "Out of memory");
+    return -1;
+  }
+  if (options->columns && options->columns[0] != '\0') {
+    if (append_columns(query, schema, options->columns, error_msg, size) != 0) {
+      return -1;
+    }
+  } else if (strbuf_append_char(query, '*') != 0) {
+    snprintf(error_msg, size, "Out of memory");
+    return -1;
+  }
+
+  bool has_where = where && where[0] != '\0';
+  bool row = schema->num_keys > 1;
+  int rc = strbuf_appendf(query, " FROM %s", table);
+  if (rc == 0 && (has_where || after)) {
+    rc = strbuf_append_str(query, " WHERE ");
+  }
+  if (rc == 0 && has_where) {
+    rc = strbuf_appendf(query, after ? "(%s) AND " : "%s", where);
+  }
+  if (rc == 0 && after) {
+    rc = row ? strbuf_append_char(query, '(') : 0;
+    for (size_t i = 0; rc == 0 && i < schema->num_keys; ++i) {
+      rc = (i > 0 ? strbuf_append_str(query, ", ") : 0) ||
+           append_identifier(query, schema->columns[schema->keys[i]]);
+    }
+    rc = rc || strbuf_append_str(query, row ? ") > (" : " > ");
+    for (size_t i = 0; rc == 0 && i < after->num_values; ++i) {
+      size_t len = 0;
+      const char *value = page_token_value(after, i, &len);
+      rc = (i > 0 ? strbuf_append_str(query, ", ") : 0) ||
+           append_key_literal(query, value, len, after->numeric[i]);
+    }
+    rc = rc || (row && strbuf_append_char(query, ')'));
+  }
+  if (rc == 0 && options->page_size > 0) {
+    rc = strbuf_append_str(query, " ORDER BY ");
+    for (size_t i = 0; rc == 0 && i < schema->num_keys; ++i) {
+      rc = (i > 0 ? strbuf_append_str(query, ", ") : 0) ||
+           append_identifier(query, schema->columns[schema->keys[i]]);
+    }
+    rc = rc || strbuf_appendf(query, " LIMIT %u", options->page_size + 1);
+  } else if (rc == 0 && options->order_by && options->order_by[0] != '\0') {
+    rc = strbuf_append_str(query, " ORDER BY ");
+    if (rc == 0 && append_order_by(query, schema, options->order_by, error_msg, size) != 0) {
+      return -1;
+    }
+  }
+  if (rc == 0 && options->page_size == 0 && options->limit > 0) {
+    rc = strbuf_appendf(query, " LIMIT %u", options->limit);
+  }
+  if (rc != 0) {
+    snprintf(error_msg, size, "Out of memory");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 生成插入语句
+ *
+ * @param query 输出缓冲区
+ * @param size 缓冲区大小
+ * @param table 表
+ * @param data 数据
+ */
+static void build_create_query(char *query, size_t size, const char *table, const char *data) {
+  snprintf(query, size, "INSERT INTO %s SET %s", table, data);
+}
+
+/**
+ * @brief 生成更新语句
+ *
+ * @param query 输出缓冲区
+ * @param size 缓冲区大小
+ * @param table 表
+ * @param data 数据
+ * @param where 条件
+ */
+static void build_update_query(char *query, size_t size, const char *table, const char *data,
+                               const char *where) {
+  snprintf(query, size, "UPDATE %s SET %s WHERE %s", table, data, where);
+}
+
+/**
+ * @brief 生成删除语句
+ *
+ * @param query 输出缓冲区
+ * @param size 缓冲区大小
+ * @param table 表
+ * @param where 条件
+ */
+static void build_delete_query(char *query, size_t size, const char *table, const char *where) {
+  snprintf(query, size, "DELETE FROM %s WHERE %s", table, where);
+}
+
+/**
+ * @brief 执行插入操作（INSERT）
+ *
+ * @param manager 数据库管理对象
+ * @param table 表
+ * @param data 数据
+ * @return int 生效条目数量
+ */
+int db_manager_create_row(db_manager_t *manager, const char *table, const char *data) {
+  if (!manager || !table || !data) {
+    LOG_ERROR("Invalid parameters for create_row");
+    return -1;
+  }
+
+  char query[1024];
+  build_create_query(query, sizeof(query), table, data);
+
+  LOG_INFO("Creating row in %s: %s", table, data);
+  int affected = db_manager_execute_update(manager, query);
+  // 失败的语句也可能已经部分生效（非事务引擎），一律递增
+  table_version_bump(&manager->versions, table);
+  return affected;
+}
+
+/**
+ * @brief 执行批量写入生成的一条多行 INSERT
+ *
+ * 语句已由 bulk_load.c 转义，这里只负责执行；每条语句自动提交，一个批次失败不影响其他批次
+ *
+ * @param manager 数据库管理对象
+ * @param table 表，用于递增表版本
+ * @param query 多行 INSERT
+ * @return int 写入的行数；失败（-1）
+ */
+int db_manager_bulk_insert(db_manager_t *manager, const char *table, const char *query) {
+  if (!manager || !table || !query) {
+    LOG_ERROR("Invalid parameters for bulk_insert");
+    return -1;
+  }
+
+  int affected = db_manager_execute_update(manager, query);
+  table_version_bump(&manager->versions, table);
+  return affected;
+}
+
+/**
+ * @brief 获取表结构，缓存中没有或已过期时从 information_schema 查询
+ *
+ * @param manager 数据库管理对象
+ * @param table 表
+ * @return table_schema_t* 表结构，用完后调用 table_schema_release()；失败返回 NULL，错误已记录
+ */
+static table_schema_t *db_manager_table_schema(db_manager_t *manager, const char *table) {
+  table_schema_t *schema = table_schema_lookup(&manager->schemas, table);
+  if (schema) {
+    return schema;
+  }
+
+  mysql_connection_t *conn = db_manager_get_connection(manager);
+  if (!conn) {
+    if (!tls_deadline_exceeded) {
+      db_manager_set_error("No database connection available");
+    }
+    return NULL;
+  }
+  uint64_t start_us = clock_now_us();
+  schema = table_schema_load(conn->mysql_conn, table);
+  tls_timing.query_us += clock_now_us() - start_us;
+  release_connection(manager->conn_pool, conn);
+  if (!schema) {
+    char error_msg[DB_ERROR_MSG_LEN];
+    snprintf(error_msg, sizeof(error_msg), "Failed to look up the schema of table %s", table);
+    db_manager_set_error(error_msg);
+    return NULL;
+  }
+  table_schema_store(&manager->schemas, schema);
+  return schema;
+}
+
+/**
+ * @brief 读取参数是否改变了默认的 SELECT * 语句
+ */
+static bool read_options_used(const read_options_t *options) {
+  return options && (options->page_size > 0 || (options->columns && options->columns[0]) ||
+                     (options->order_by && options->order_by[0]) || options->limit > 0 ||
+                     options->params);
+}
+
+/**
+ * @brief 准备带参数的读取：按表结构校验列名和排序，分页时找到主键、校验续读令牌，生成语句
+ *
+ * @param manager 数据库管理对象
+ * @param table 表
+ * @param where 条件
+ * @param options 读取参数
+ * @param query 输出语句
+ * @return table_schema_t* 表结构，用完后调用 table_schema_release()；失败返回 NULL，错误已记录
+ */
+static table_schema_t *db_manager_prepare_read(db_manager_t *manager, const char *table,
+                                               const char *where, const read_options_t *options,
+                                               strbuf_t *query) {
+  char error_msg[DB_ERROR_MSG_LEN];
+  if (options->page_size > READ_MAX_PAGE_SIZE) {
+    snprintf(error_msg, sizeof(error_msg), "Page size exceeds %d rows", READ_MAX_PAGE_SIZE);
+    db_manager_set_error(error_msg);
+    return NULL;
+  }
+  if (options->page_size > 0 &&
+      ((options->order_by && options->order_by[0]) || options->limit > 0)) {
+    // 分页按主键排序，每页的行数由 page_size 决定
+    db_manager_set_error("order_by and limit cannot be combined with page_size");
+    return NULL;
+  }
+  if (options->page_size > 0 && options->params) {
+    // 续读令牌中的主键值拼进语句，每一页的语句都不同，不适合预处理
+    db_manager_set_error("params cannot be combined with page_size");
+    return NULL;
+  }
+
+  tls_last_error[0] = '\0';
+  table_schema_t *schema = db_manager_table_schema(manager, table);
+  if (!schema) {
+    return NULL;
+  }
+  if (options->page_size > 0 && schema->num_keys == 0) {
+    snprintf(error_msg, sizeof(error_msg), "Table %s has no primary key to page by", table);
+    db_manager_set_error(error_msg);
+    table_schema_release(schema);
+    return NULL;
+  }
+
+  page_token_t after;
+  bool has_token =
+      options->page_size > 0 && options->page_token && options->page_token[0] != '\0';
+  if (has_token &&
+      (page_token_decode(options->page_token, page_token_check(table, where), &after) != 0 ||
+       after.num_values != schema->num_keys)) {
+    db_manager_set_error("Invalid page token for this table and condition");
+    table_schema_release(schema);
+    return NULL;
+  }
+
+  if (build_select(query, table, where, schema, options, has_token ? &after : NULL, error_msg,
+                   sizeof(error_msg)) != 0) {
+    LOG_WARN("Failed to build read of %s: %s", table, error_msg);
+    db_manager_set_error(error_msg);
+    table_schema_release(schema);
+    return NULL;
+  }
+  return schema;
+}
+
+/**
+ * @brief 执行查询操作（SELECT）
+ *
+ * @param manager 数据库管理对象
+ * @param table 表
+ * @param where 条件
+ * @param options 读取参数，可以为 NULL；选择的列、排序和行数上限直接写进语句，不支持分页和参数
+ * @return db_result_t* 结果集
+ */
+db_result_t *db_manager_read_row(db_manager_t *manager, const char *table, const char *where,
+                                 const read_options_t *options) {
+  if (!manager || !table) {
+    LOG_ERROR("Invalid parameters for read_row");
+    return NULL;
+  }
+  if (options && (options->page_size > 0 || options->params)) {
+    // 结果集中没有下一页的续读令牌，分页需要游标；预处理语句的结果也只按游标逐行转换
+    LOG_ERROR("Paged and parameterized reads need db_manager_read_open()");
+    return NULL;
+  }
+
+  if (!read_options_used(options)) {
+    char query[1024];
+    build_read_query(query, sizeof(query), table, where);
+    LOG_INFO("Reading from %s with condition: %s", table, where ? where : "none");
+    return db_manager_execute_query(manager, query);
+  }
+
+  strbuf_t query;
+  strbuf_init(&query);
+  table_schema_t *schema = db_manager_prepare_read(manager, table, where, options, &query);
+  if (!schema) {
+    strbuf_free(&query);
+    return NULL;
+  }
+  table_schema_release(schema);
+  LOG_INFO("Reading from %s with condition: %s", table, where ? where : "none");
+  db_result_t *result = db_manager_execute_query(manager, query.data);
+  strbuf_free(&query);
+  return result;
+}
+
+/**
+ * @brief 结果中的列是否为数值类型，续读令牌中的数值不加引号，比较时不经过字符串转换
+ */
+static bool numeric_field(const MYSQL_FIELD *field) {
+  switch (field->type) {
+  case MYSQL_TYPE_DECIMAL:
+  case MYSQL_TYPE_NEWDECIMAL:
+  case MYSQL_TYPE_TINY:
+  case MYSQL_TYPE_SHORT:
+  case MYSQL_TYPE_LONG:
+  case MYSQL_TYPE_INT24:
+  case MYSQL_TYPE_LONGLONG:
+  case MYSQL_TYPE_FLOAT:
+  case MYSQL_TYPE_DOUBLE:
+  case MYSQL_TYPE_YEAR:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief 游标进入分页模式：在结果中找到主键各列
+ *
+ * @param cursor 游标
+ * @param schema 表结构
+ * @param table 表
+ * @param where 条件，与表名一起决定令牌的查询摘要
+ * @param page_size 每页行数
+ * @return int 成功（0）；失败（-1，错误已记录）
+ */
+static int db_cursor_page(db_cursor_t *cursor, const table_schema_t *schema, const char *table,
+                          const char *where, unsigned int page_size) {
+  cursor->page_size = page_size;
+  for (size_t i = 0; i < schema->num_keys; ++i) {
+    const char *name = schema->columns[schema->keys[i]];
+    int index = 0;
+    while (index < cursor->num_fields && strcmp(cursor->fields[index].name, name) != 0) {
+      ++index;
+    }
+    if (index == cursor->num_fields) {
+      char error_msg[DB_ERROR_MSG_LEN];
+      snprintf(error_msg, sizeof(error_msg), "Primary key column %s is missing from the result",
+               name);
+      db_manager_set_error(error_msg);
+      return -1;
+    }
+    cursor->keys[i] = index;
+  }
+  cursor->num_keys = schema->num_keys;
+
+  cursor->last = malloc(sizeof(page_token_t));
+  if (!cursor->last) {
+    LOG_ERROR("Failed to allocate memory for page token");
+    db_manager_set_error("Out of memory");
+    return -1;
+  }
+  page_token_init(cursor->last, page_token_check(table, where));
+  return 0;
+}
+
+/**
+ * @brief 打开流式读取游标（SELECT），结果集不在客户端缓存，由 db_cursor_fetch() 逐行拉取
+ *
+ * @param manager 数据库管理对象
+ * @param table 表
+ * @param where 条件
+ * @param options 读取参数，可以为 NULL；分页时游标读满一页即结束，续读令牌在 cursor->next_page；
+ *        有参数时以预处理语句执行，结果经二进制协议读取
+ * @return db_cursor_t* 游标，失败返回 NULL
+ */
+db_cursor_t *db_manager_read_open(db_manager_t *manager, const char *table, const char *where,
+                                  const read_options_t *options) {
+  if (!manager || !table) {
+    LOG_ERROR("Invalid parameters for read_open");
+    return NULL;
+  }
 
   char query[1024];
-  snprintf(query, sizeof(query), "DELETE FROM %s WHERE %s", table, where);
+  strbuf_t options_query;
+  strbuf_init(&options_query);
+  table_schema_t *schema = NULL;
+  if (read_options_used(options)) {
+    schema = db_manager_prepare_read(manager, table, where, options, &options_query);
+    if (!schema) {
+      strbuf_free(&options_query);
+      return NULL;
+    }
+    const char *what = options->page_size > 0 ? "a page"
+                       : options->params        ? "prepared rows"
+                                                : "selected rows";
+    LOG_INFO("Streaming %s from %s with condition: %s", what, table, where ? where : "none");
+  } else {
+    build_read_query(query, sizeof(query), table, where);
+    LOG_INFO("Streaming from %s with condition: %s", table, where ? where : "none");
+  }
+
+  MYSQL_STMT *stmt = NULL;
+  mysql_connection_t *conn =
+      schema && options->params
+          ? db_manager_execute_prepared(manager, options_query.data, options->params, &stmt)
+          : db_manager_execute_common(manager, schema ? options_query.data : query);
+  strbuf_free(&options_query);
+  if (conn == NULL) {
+    LOG_ERROR("Query execution failed after %d attempts", manager->max_retries);
+    table_schema_release(schema);
+    return NULL;
+  }
+
+  // 预处理语句的结果不在客户端缓存，与 mysql_use_result() 一样逐行拉取
+  MYSQL_RES *mysql_res =
+      stmt ? mysql_stmt_result_metadata(stmt) : db_manager_result(manager, conn, false);
+  db_stmt_result_t *prepared = NULL;
+  if (stmt && mysql_res) {
+    prepared = db_stmt_result_new(stmt, (int)mysql_num_fields(mysql_res));
+    if (!prepared) {
+      mysql_free_result(mysql_res);
+      db_manager_set_error("Out of memory");
+      release_connection(manager->conn_pool, conn);
+      table_schema_release(schema);
+      return NULL;
+    }
+  }
+  if (!mysql_res &&
+      (stmt ? mysql_stmt_field_count(stmt) : mysql_field_count(conn->mysql_conn)) > 0) {
+    const char *error_msg = stmt ? mysql_stmt_error(stmt) : mysql_error(conn->mysql_conn);
+    LOG_ERROR("Failed to use result: %s", error_msg);
+    db_manager_set_error(error_msg);
+    if (stmt) {
+      mysql_stmt_free_result(stmt);
+    }
+    release_connection(manager->conn_pool, conn);
+    table_schema_release(schema);
+    return NULL;
+  }
+
+  db_cursor_t *cursor = calloc(1, sizeof(db_cursor_t));
+  if (!cursor) {
+    LOG_ERROR("Failed to allocate memory for cursor");
+    if (mysql_res) {
+      mysql_free_result(mysql_res);
+    }
+    db_stmt_result_free(prepared);
+    release_connection(manager->conn_pool, conn);
+    table_schema_release(schema);
+    return NULL;
+  }
+
+  cursor->manager = manager;
+  cursor->conn = conn;
+  cursor->mysql_res = mysql_res;
+  cursor->prepared = prepared;
+  cursor->fields = mysql_res ? mysql_fetch_fields(mysql_res) : NULL;
+  cursor->num_fields = mysql_res ? (int)mysql_num_fields(mysql_res) : 0;
+  cursor->done = (mysql_res == NULL);
+  // 逐行拉取期间语句仍在 MySQL 上执行，截止时间一直登记到游标关闭，期间超时同样 KILL QUERY
+  query_watchdog_arm(&manager->watchdog, conn, tls_deadline_us);
+  if (schema && mysql_res && options->page_size > 0 &&
+      db_cursor_page(cursor, schema, table, where, options->page_size) != 0) {
+    db_cursor_close(cursor);
+    cursor = NULL;
+  }
+  table_schema_release(schema);
+  return cursor;
+}
+
+/**
+ * @brief 记下本页最后一行的主键值，之后还有行时由它生成续读令牌
+ *
+ * @param cursor 游标
+ * @param row 行数据
+ * @param lengths 各列长度
+ * @return int 成功（0）；主键值超过令牌的上限（-1）
+ */
+static int db_cursor_remember(db_cursor_t *cursor, MYSQL_ROW row, const unsigned long *lengths) {
+  page_token_init(cursor->last, cursor->last->check);
+  for (size_t i = 0; i < cursor->num_keys; ++i) {
+    int index = cursor->keys[i];
+    if (!row[index] || page_token_add(cursor->last, row[index], lengths[index],
+                                      numeric_field(&cursor->fields[index])) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief 从游标读取下一行
+ *
+ * @param cursor 游标
+ * @param lengths 输出各列长度
+ * @return MYSQL_ROW 行数据，读完或出错返回 NULL（出错时 cursor->failed 为 true）
+ */
+MYSQL_ROW db_cursor_fetch(db_cursor_t *cursor, unsigned long **lengths) {
+  if (!cursor || cursor->done) {
+    return NULL;
+  }
+
+  char error_msg[DB_ERROR_MSG_LEN];
+  bool failed = false;
+  MYSQL_ROW row =
+      cursor->prepared
+          ? db_stmt_result_fetch(cursor->prepared, error_msg, sizeof(error_msg), &failed)
+          : mysql_fetch_row(cursor->mysql_res);
+  if (!row) {
+    cursor->done = true;
+    if (!cursor->prepared && mysql_errno(cursor->conn->mysql_conn) != 0) {
+      snprintf(error_msg, sizeof(error_msg), "%s", mysql_error(cursor->conn->mysql_conn));
+      failed = true;
+    }
+    if (failed) {
+      LOG_ERROR("Failed to fetch row: %s", error_msg);
+      db_manager_set_error(error_msg);
+      cursor->failed = true;
+      // 游标可能在另一个线程上读取，按游标登记的截止时间判断
+      if (cursor->conn->deadline_us > 0 && clock_now_us() >= cursor->conn->deadline_us) {
+        tls_deadline_exceeded = true;
+      }
+    }
+    return NULL;
+  }
+
+  if (cursor->page_size > 0 && cursor->num_rows == cursor->page_size) {
+    // 多取的一行只说明还有下一页，不交给调用者
+    cursor->done = true;
+    strbuf_t token;
+    strbuf_init(&token);
+    if (page_token_encode(cursor->last, &token) != 0) {
+      LOG_ERROR("Failed to allocate memory for page token");
+      db_manager_set_error("Out of memory");
+      cursor->failed = true;
+      strbuf_free(&token);
+      return NULL;
+    }
+    cursor->next_page = strbuf_detach(&token);
+    return NULL;
+  }
+
+  *lengths = cursor->prepared ? cursor->prepared->lengths : mysql_fetch_lengths(cursor->mysql_res);
+  ++cursor->num_rows;
+  if (cursor->page_size > 0 && cursor->num_rows == cursor->page_size &&
+      db_cursor_remember(cursor, row, *lengths) != 0) {
+    db_manager_set_error("Primary key is too long for a page token");
+    cursor->done = true;
+    cursor->failed = true;
+    return NULL;
+  }
+  return row;
+}
+
+/**
+ * @brief 关闭游标并归还连接，未读完的行由 mysql_free_result() 或 mysql_stmt_free_result() 读出丢弃
+ *
+ * @param cursor 游标
+ */
+void db_cursor_close(db_cursor_t *cursor) {
+  if (!cursor) {
+    return;
+  }
+
+  db_stmt_result_free(cursor->prepared);
+  if (cursor->mysql_res) {
+    mysql_free_result(cursor->mysql_res);
+  }
+  // 丢弃剩余的行之后才注销截止时间，读出丢弃的过程同样受截止时间约束
+  query_watchdog_disarm(&cursor->manager->watchdog, cursor->conn);
+  release_connection(cursor->manager->conn_pool, cursor->conn);
+
+  LOG_DEBUG("Cursor closed, %llu rows fetched", cursor->num_rows);
+  free(cursor->last);
+  free(cursor->next_page);
+  free(cursor);
+}
+
+/**
+ * @brief 流式执行查询操作（SELECT），每读到一行调用一次回调，内存占用与结果集大小无关
+ *
+ * @param manager 数据库管理对象
+ * @param table 表
+ * @param where 条件
+ * @param callback 逐行回调
+ * @param ctx 回调的用户数据
+ * @return long long 读取的行数，失败返回 -1
+ */
+long long db_manager_read_row_each(db_manager_t *manager, const char *table, const char *where,
+                                   db_row_callback_t callback, void *ctx) {
+  if (!callback) {
+    LOG_ERROR("Invalid parameters for read_row_each");
+    return -1;
+  }
+
+  db_cursor_t *cursor = db_manager_read_open(manager, table, where, NULL);
+  if (!cursor) {
+    return -1;
+  }
+
+  MYSQL_ROW row;
+  unsigned long *lengths = NULL;
+  while ((row = db_cursor_fetch(cursor, &lengths)) != NULL) {
+    if (callback(ctx, cursor, row, lengths) != 0) {
+      break;
+    }
+  }
+
+  long long num_rows = cursor->failed ? -1 : (long long)cursor->num_rows;
+  db_cursor_close(cursor);
+  return num_rows;
+}
+
+/**
+ * @brief 执行更新操作（UPDATE）
+ *
+ * @param manager 数据库管理对象
+ * @param table 表
+ * @param data 数据
+ * @param where 条件
+ * @return int 生效条目数
+ */
+int db_manager_update_row(db_manager_t *manager, const char *table, const char *data,
+                          const char *where) {
+  if (!manager || !table || !data || !where) {
+    LOG_ERROR("Invalid parameters for update_row");
+    return -1;
+  }
+
+  char query[1024];
+  build_update_query(query, sizeof(query), table, data, where);
+
+  LOG_INFO("Updating %s: SET %s WHERE %s", table, data, where);
+  int affected = db_manager_execute_update(manager, query);
+  table_version_bump(&manager->versions, table);
+  return affected;
+}
+
+/**
+ * @brief 执行删除操作
+ *
+ * @param manager 数据库管理对象
+ * @param table 表
+ * @param where 条件
+ * @return int 生效条目数量
+ */
+int db_manager_delete_row(db_manager_t *manager, const char *table, const char *where) {
+  if (!manager || !table || !where) {
+    LOG_ERROR("Invalid parameters for delete_row");
+    return -1;
+  }
+
+  char query[1024];
+  build_delete_query(query, sizeof(query), table, where);
 
   LOG_INFO("Deleting from %s WHERE %s", table, where);
-  return db_manager_execute_update(manager, query);
+  int affected = db_manager_execute_update(manager, query);
+  table_version_bump(&manager->versions, table);
+  return affected;
+}
+
+/**
+ * @brief 执行参数化的写操作（CREATE、UPDATE、DELETE）：data 和 where 中的 '?' 依次取 params 的值
+ *
+ * 语句在连接上准备一次之后缓存起来，之后相同形状的语句只发送参数，MySQL 不再解析语句
+ *
+ * @param manager 数据库管理对象
+ * @param op 操作
+ * @param table 表
+ * @param data 数据，CREATE 和 UPDATE 需要
+ * @param where 条件，UPDATE 和 DELETE 需要
+ * @param params 参数
+ * @return int 生效条目数量，失败返回 -1
+ */
+int db_manager_execute_params(db_manager_t *manager, db_op_t op, const char *table,
+                              const char *data, const char *where, const db_params_t *params) {
+  if (!manager || !table || !params || ((op == DB_OP_CREATE || op == DB_OP_UPDATE) && !data) ||
+      ((op == DB_OP_UPDATE || op == DB_OP_DELETE) && !where)) {
+    LOG_ERROR("Invalid parameters for execute_params");
+    return -1;
+  }
+
+  strbuf_t query;
+  strbuf_init(&query);
+  int rc = 0;
+  switch (op) {
+  case DB_OP_CREATE:
+    rc = strbuf_appendf(&query, "INSERT INTO %s SET %s", table, data);
+    break;
+  case DB_OP_UPDATE:
+    rc = strbuf_appendf(&query, "UPDATE %s SET %s WHERE %s", table, data, where);
+    break;
+  case DB_OP_DELETE:
+    rc = strbuf_appendf(&query, "DELETE FROM %s WHERE %s", table, where);
+    break;
+  default:
+    LOG_ERROR("Unsupported operation for execute_params");
+    return -1;
+  }
+  if (rc != 0) {
+    LOG_ERROR("Failed to allocate memory for query");
+    strbuf_free(&query);
+    return -1;
+  }
+
+  LOG_INFO("Executing prepared %s on %s with %zu params", db_op_name(op), table, params->count);
+  MYSQL_STMT *stmt = NULL;
+  mysql_connection_t *conn = db_manager_execute_prepared(manager, query.data, params, &stmt);
+  strbuf_free(&query);
+  int affected = -1;
+  if (conn) {
+    affected = (int)mysql_stmt_affected_rows(stmt);
+    release_connection(manager->conn_pool, conn);
+  }
+  table_version_bump(&manager->versions, table);
+  return affected;
+}
+
+/**
+ * @brief 开始会话：从连接池取出一个连接，之后的操作都在这个连接上执行
+ *
+ * 会话内的语句不重试：事务中途断线后重试会丢失之前的修改
+ *
+ * @param manager 数据库管理对象
+ * @param transaction 是否在同一个事务中执行
+ * @return db_session_t* 会话，失败返回 NULL
+ */
+db_session_t *db_session_begin(db_manager_t *manager, bool transaction) {
+  if (!manager) {
+    LOG_ERROR("Invalid parameters for session_begin");
+    return NULL;
+  }
+
+  tls_last_error[0] = '\0';
+  db_session_t *session = calloc(1, sizeof(db_session_t));
+  if (!session) {
+    LOG_ERROR("Failed to allocate memory for session");
+    return NULL;
+  }
+
+  session->manager = manager;
+  session->conn = db_manager_get_connection(manager);
+  if (!session->conn) {
+    LOG_ERROR("Failed to get connection for session");
+    if (!tls_deadline_exceeded) {
+      db_manager_set_error("No database connection available");
+    }
+    free(session);
+    return NULL;
+  }
+
+  if (transaction) {
+    if (db_manager_query(manager, session->conn, "START TRANSACTION") != 0) {
+      const char *error_msg = mysql_error(session->conn->mysql_conn);
+      LOG_ERROR("Failed to start transaction: %s", error_msg);
+      db_manager_set_error(error_msg);
+      release_connection(manager->conn_pool, session->conn);
+      free(session);
+      return NULL;
+    }
+    session->in_transaction = true;
+  }
+  return session;
+}
+
+/**
+ * @brief 在会话连接上执行语句
+ *
+ * @param session 会话
+ * @param query sql 语句
+ * @return int 成功（0）；失败（-1）
+ */
+static int db_session_query(db_session_t *session, const char *query) {
+  LOG_DEBUG("Executing in session: %s", query);
+  if (db_manager_query(session->manager, session->conn, query) != 0) {
+    const char *error_msg = mysql_error(session->conn->mysql_conn);
+    LOG_ERROR("Session query failed: %s", error_msg);
+    db_manager_set_error(error_msg);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 记录会话写过的表：自动提交时立即递增版本号，事务中等到提交之后
+ *
+ * @param session 会话
+ * @param table 表
+ */
+static void db_session_written(db_session_t *session, const char *table) {
+  table_versions_t *versions = &session->manager->versions;
+  if (!session->in_transaction) {
+    table_version_bump(versions, table);
+    return;
+  }
+
+  for (size_t i = 0; i < session->num_written; ++i) {
+    if (strcmp(session->written[i], table) == 0) {
+      return;
+    }
+  }
+  if (session->num_written == session->cap_written) {
+    size_t cap = session->cap_written ? session->cap_written * 2 : 4;
+    char **ptr = realloc(session->written, cap * sizeof(char *));
+    if (!ptr) {
+      // 记不下来就提前递增，提交之前读到旧数据的 ETag 会在下一次写入时失效
+      table_version_bump(versions, table);
+      return;
+    }
+    session->written = ptr;
+    session->cap_written = cap;
+  }
+  if ((session->written[session->num_written] = strdup(table)) == NULL) {
+    table_version_bump(versions, table);
+    return;
+  }
+  ++session->num_written;
+}
+
+/**
+ * @brief 在会话中执行更新类语句
+ *
+ * @param session 会话
+ * @param table 写入的表
+ * @param query sql 语句
+ * @return int 生效条目数，失败返回 -1
+ */
+static int db_session_execute_update(db_session_t *session, const char *table,
+                                     const char *query) {
+  int ret = db_session_query(session, query);
+  db_session_written(session, table);
+  if (ret != 0) {
+    return -1;
+  }
+  return (int)mysql_affected_rows(session->conn->mysql_conn);
+}
+
+/**
+ * @brief 在会话中执行插入操作（INSERT）
+ *
+ * @param session 会话
+ * @param table 表
+ * @param data 数据
+ * @return int 生效条目数量，失败返回 -1
+ */
+int db_session_create_row(db_session_t *session, const char *table, const char *data) {
+  if (!session || !table || !data) {
+    LOG_ERROR("Invalid parameters for session_create_row");
+    return -1;
+  }
+
+  char query[1024];
+  build_create_query(query, sizeof(query), table, data);
+  return db_session_execute_update(session, table, query);
+}
+
+/**
+ * @brief 在会话中执行查询操作（SELECT），结果集一次性读取到客户端
+ *
+ * @param session 会话
+ * @param table 表
+ * @param where 条件
+ * @return db_result_t* 结果集，失败返回 NULL
+ */
+db_result_t *db_session_read_row(db_session_t *session, const char *table, const char *where) {
+  if (!session || !table) {
+    LOG_ERROR("Invalid parameters for session_read_row");
+    return NULL;
+  }
+
+  char query[1024];
+  build_read_query(query, sizeof(query), table, where);
+  if (db_session_query(session, query) != 0) {
+    return NULL;
+  }
+
+  MYSQL_RES *mysql_res = db_manager_result(session->manager, session->conn, true);
+  if (!mysql_res && mysql_field_count(session->conn->mysql_conn) > 0) {
+    const char *error_msg = mysql_error(session->conn->mysql_conn);
+    LOG_ERROR("Failed to store result: %s", error_msg);
+    db_manager_set_error(error_msg);
+    return NULL;
+  }
+
+  db_result_t *result = malloc(sizeof(db_result_t));
+  if (!result) {
+    LOG_ERROR("Failed to allocate memory for result");
+    if (mysql_res) {
+      mysql_free_result(mysql_res);
+    }
+    return NULL;
+  }
+
+  result->mysql_res = mysql_res;
+  result->num_rows = mysql_res ? mysql_num_rows(mysql_res) : 0;
+  result->num_fields = mysql_res ? mysql_num_fields(mysql_res) : 0;
+  return result;
+}
+
+/**
+ * @brief 在会话中执行更新操作（UPDATE）
+ *
+ * @param session 会话
+ * @param table 表
+ * @param data 数据
+ * @param where 条件
+ * @return int 生效条目数，失败返回 -1
+ */
+int db_session_update_row(db_session_t *session, const char *table, const char *data,
+                          const char *where) {
+  if (!session || !table || !data || !where) {
+    LOG_ERROR("Invalid parameters for session_update_row");
+    return -1;
+  }
+
+  char query[1024];
+  build_update_query(query, sizeof(query), table, data, where);
+  return db_session_execute_update(session, table, query);
+}
+
+/**
+ * @brief 在会话中执行删除操作（DELETE）
+ *
+ * @param session 会话
+ * @param table 表
+ * @param where 条件
+ * @return int 生效条目数，失败返回 -1
+ */
+int db_session_delete_row(db_session_t *session, const char *table, const char *where) {
+  if (!session || !table || !where) {
+    LOG_ERROR("Invalid parameters for session_delete_row");
+    return -1;
+  }
+
+  char query[1024];
+  build_delete_query(query, sizeof(query), table, where);
+  return db_session_execute_update(session, table, query);
+}
+
+/**
+ * @brief 结束会话并归还连接，会话处于事务中时提交或回滚
+ *
+ * @param session 会话
+ * @param commit 提交（true）；回滚（false）
+ * @return int 成功（0）；提交失败（-1，事务已被 MySQL 回滚）
+ */
+int db_session_end(db_session_t *session, bool commit) {
+  if (!session) {
+    return -1;
+  }
+
+  int ret = 0;
+  if (session->in_transaction) {
+    if (db_session_query(session, commit ? "COMMIT" : "ROLLBACK") != 0) {
+      ret = -1;
+    }
+  }
+  // 提交之后其他会话才看得到写入；回滚或提交失败时多递增一次也无妨
+  for (size_t i = 0; i < session->num_written; ++i) {
+    table_version_bump(&session->manager->versions, session->written[i]);
+    free(session->written[i]);
+  }
+  free(session->written);
+
+  release_connection(session->manager->conn_pool, session->conn);
+  free(session);
+  return ret;
 }
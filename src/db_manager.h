@@ -1,10 +1,21 @@
 #pragma once
 
 // clang-format off
+#include <stdatomic.h>
+#include <stdint.h>
 #include "connection_pool.h"
+#include "src/operation.h"
+#include "src/page_token.h"
+#include "src/query_watchdog.h"
+#include "src/read_cache.h"
+#include "src/read_options.h"
+#include "src/single_flight.h"
+#include "src/table_schema.h"
+#include "src/table_version.h"
 // clang-format on
 
 #define DB_MAX_RETRIES 3
+#define DB_ERROR_MSG_LEN 512
 
 typedef struct {
   MYSQL_RES *mysql_res;
@@ -12,18 +23,94 @@ typedef struct {
   int num_fields;
 } db_result_t;
 
+typedef struct db_manager db_manager_t;
+typedef struct db_stmt_result db_stmt_result_t;
+
+// 当前线程上数据库操作各阶段的累计耗时（微秒），由 db_manager_timing_reset() 清零
+typedef struct {
+  uint64_t conn_wait_us; // get_connection()
+  uint64_t query_us;     // mysql_query() / mysql_stmt_prepare() + mysql_stmt_execute()
+  uint64_t result_us;    // mysql_store_result() / mysql_use_result()
+} db_timing_t;
+
+// 流式读取游标（mysql_use_result），逐行从 MySQL 拉取数据，关闭之前一直占用一个连接
 typedef struct {
+  db_manager_t *manager;
+  mysql_connection_t *conn;
+  MYSQL_RES *mysql_res;       // 语句没有结果集时为 NULL；参数化读取时为结果的元数据
+  db_stmt_result_t *prepared; // 参数化读取的结果（二进制协议），各列转成字符串逐行交给调用者
+  MYSQL_FIELD *fields;
+  int num_fields;
+  unsigned long long num_rows; // 已读取的行数
+  bool done;
+  bool failed;
+  // 分页读取：读满 page_size 行后停止，之后还有行时 next_page 为下一页的续读令牌
+  unsigned int page_size;
+  size_t num_keys;
+  int keys[PAGE_TOKEN_MAX_VALUES]; // 主键各列在结果中的下标
+  page_token_t *last;              // 本页最后一行的主键值
+  char *next_page;                 // 没有下一页时为 NULL
+} db_cursor_t;
+
+// 逐行回调，返回非 0 表示停止读取
+typedef int (*db_row_callback_t)(void *ctx, const db_cursor_t *cursor, MYSQL_ROW row,
+                                 const unsigned long *lengths);
+
+// 会话：多个操作固定使用同一个连接，可选地包在一个事务中
+typedef struct {
+  db_manager_t *manager;
+  mysql_connection_t *conn;
+  bool in_transaction;
+  char **written; // 事务中写过的表，提交后才递增它们的版本号
+  size_t num_written;
+  size_t cap_written;
+} db_session_t;
+
+struct db_manager {
   connection_pool_t *conn_pool;
-  char *last_error;
   int max_retries;
-} db_manager_t;
+  atomic_ullong retries; // 连接断开后重试的次数
+  query_watchdog_t watchdog; // 终止超过截止时间的语句
+  table_versions_t versions; // 各表的写入版本号，READ 的 ETag 由它生成
+  read_cache_t cache;        // READ 结果缓存，条目随表的版本号失效
+  single_flight_t flights;   // 在途的 READ，相同的读取只查询一次
+  table_schemas_t schemas;   // 表的列和主键，分页读取按主键生成语句
+};
 
 db_manager_t *db_manager_init(const char *host, const char *user, const char *password,
                               const char *database, int pool_size);
 void db_manager_destroy(db_manager_t *manager);
+const char *db_manager_last_error(db_manager_t *manager);
+unsigned long long db_manager_retry_count(db_manager_t *manager);
+void db_manager_timing_reset(void);
+void db_manager_timing(db_timing_t *timing);
+void db_manager_set_deadline(uint64_t deadline_us);
+bool db_manager_deadline_exceeded(void);
+uint64_t db_manager_deadline(void);
+int db_manager_watch_tables(db_manager_t *manager, int poll_ms);
+int db_manager_enable_read_cache(db_manager_t *manager, size_t budget_bytes, uint64_t ttl_ms,
+                                 const char *table_ttls);
+void db_manager_coalesce_reads(db_manager_t *manager, bool enabled);
 void db_result_free(db_result_t *result);
 int db_manager_create_row(db_manager_t *manager, const char *table, const char *data);
-db_result_t *db_manager_read_row(db_manager_t *manager, const char *table, const char *where);
+int db_manager_bulk_insert(db_manager_t *manager, const char *table, const char *query);
+db_result_t *db_manager_read_row(db_manager_t *manager, const char *table, const char *where,
+                                 const read_options_t *options);
+db_cursor_t *db_manager_read_open(db_manager_t *manager, const char *table, const char *where,
+                                  const read_options_t *options);
+MYSQL_ROW db_cursor_fetch(db_cursor_t *cursor, unsigned long **lengths);
+void db_cursor_close(db_cursor_t *cursor);
+long long db_manager_read_row_each(db_manager_t *manager, const char *table, const char *where,
+                                   db_row_callback_t callback, void *ctx);
 int db_manager_update_row(db_manager_t *manager, const char *table, const char *data,
                           const char *where);
 int db_manager_delete_row(db_manager_t *manager, const char *table, const char *where);
+int db_manager_execute_params(db_manager_t *manager, db_op_t op, const char *table,
+                              const char *data, const char *where, const db_params_t *params);
+db_session_t *db_session_begin(db_manager_t *manager, bool transaction);
+int db_session_create_row(db_session_t *session, const char *table, const char *data);
+db_result_t *db_session_read_row(db_session_t *session, const char *table, const char *where);
+int db_session_update_row(db_session_t *session, const char *table, const char *data,
+                          const char *where);
+int db_session_delete_row(db_session_t *session, const char *table, const char *where);
+int db_session_end(db_session_t *session, bool commit);
@@ -0,0 +1,32 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+// clang-format on
+
+// 一条参数化语句最多的参数个数
+#define DB_PARAMS_MAX 64
+
+typedef enum {
+  DB_PARAM_NULL = 0,
+  DB_PARAM_INT,    // long long
+  DB_PARAM_DOUBLE, // double
+  DB_PARAM_STRING, // 字符串，按 MYSQL_TYPE_STRING 发送，由服务器按列类型转换
+} db_param_type_t;
+
+// 一个参数值，绑定到语句中按出现顺序对应的 '?'
+typedef struct {
+  db_param_type_t type;
+  long long i;
+  double d;
+  const char *str; // 不必以 '\0' 结尾
+  size_t len;
+} db_param_t;
+
+// 参数化操作的参数：data 和 where 中的 '?' 依次取这里的值，值以二进制协议发送，不拼进语句
+typedef struct {
+  size_t count;
+  bool overflow; // 参数个数超过 DB_PARAMS_MAX，多出的参数被忽略
+  db_param_t values[DB_PARAMS_MAX];
+} db_params_t;
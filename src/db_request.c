@@ -0,0 +1,221 @@
+// clang-format off
+#include <stdlib.h>
+#include <string.h>
+#include "db_request.h"
+#include "src/key.h"
+#include "src/logger.h"
+#include "src/operation.h"
+#include "src/strbuf.h"
+// clang-format on
+
+/**
+ * @brief 生成操作失败的响应
+ *
+ * @param db_mgr 数据库管理对象
+ * @param arena 请求内存区域
+ * @param op_name 操作名称
+ * @return const char* 响应字符串
+ */
+const char *db_request_failed(db_manager_t *db_mgr, arena_t *arena, const char *op_name) {
+  const char *last_error = db_manager_last_error(db_mgr);
+  const char *response = NULL;
+  if (last_error != NULL) {
+    response =
+        arena_sprintf(arena, "%s %s operation failed: %s", KEY_RESP_ERROR, op_name, last_error);
+  }
+  return response ? response : KEY_RESP_ERROR " Operation failed";
+}
+
+/**
+ * @brief 查询并把完整的结果集按请求的格式编码；读取中途出错时与流式响应一样以错误记录结尾
+ *
+ * @param db_mgr 数据库管理对象
+ * @param req 请求
+ * @param arena 请求内存区域
+ * @param len 输出响应长度（二进制格式中可能含有 '\0'）
+ * @param complete 输出是否完整读完了结果集，只有这样的结果可以缓存或交给其他请求
+ * @return const char* 响应
+ */
+static const char *read_encoded(db_manager_t *db_mgr, const db_request_t *req, arena_t *arena,
+                                size_t *len, bool *complete) {
+  *complete = false;
+  read_options_t options = {.params = req->params};
+  db_cursor_t *cursor = db_manager_read_open(db_mgr, req->table, req->where, &options);
+  if (!cursor) {
+    const char *response = db_request_failed(db_mgr, arena, "Read");
+    *len = strlen(response);
+    return response;
+  }
+
+  strbuf_t out;
+  strbuf_init(&out);
+  result_encoder_t encoder;
+  result_encoder_init(&encoder, req->format, cursor->fields, cursor->num_fields);
+  int rc = result_encoder_begin(&encoder, &out);
+  MYSQL_ROW row;
+  unsigned long *lengths = NULL;
+  while (rc == 0 && cursor->mysql_res && (row = db_cursor_fetch(cursor, &lengths)) != NULL) {
+    rc = result_encoder_row(&encoder, row, lengths, &out);
+  }
+  bool failed = cursor->failed;
+  if (rc == 0 && failed) {
+    const char *last_error = db_manager_last_error(db_mgr);
+    rc = result_encoder_error(&encoder, last_error ? last_error : "unknown error", &out);
+  } else if (rc == 0) {
+    rc = result_encoder_end(&encoder, &out);
+  }
+  db_cursor_close(cursor);
+
+  if (rc != 0 || !out.data || arena_own(arena, out.data) != 0) {
+    LOG_ERROR("Failed to encode read result");
+    strbuf_free(&out);
+    *len = strlen(KEY_RESP_ERROR " Failed to encode read result");
+    return KEY_RESP_ERROR " Failed to encode read result";
+  }
+  *complete = !failed;
+  *len = out.len;
+  return out.data;
+}
+
+/**
+ * @brief 读取完整的结果集并编码
+ *
+ * 先查 READ 结果缓存；未命中时如果相同的读取正在进行，等待并复制它的结果，否则查询 MySQL，
+ * 完整读完的结果存入缓存并交给等待的请求。参数化读取的结果随参数变化，条件不足以区分，
+ * 直接查询
+ *
+ * @param db_mgr 数据库管理对象
+ * @param req 请求
+ * @param arena 请求内存区域
+ * @param len 输出响应长度（二进制格式中可能含有 '\0'）
+ * @return const char* 响应
+ */
+static const char *read_buffered(db_manager_t *db_mgr, const db_request_t *req, arena_t *arena,
+                                 size_t *len) {
+  // 版本号必须在查询之前读取，查询期间的写入只会让存入的结果立即失效，不会让旧结果看起来是新的
+  uint64_t version = table_version_get(&db_mgr->versions, req->table);
+  read_cache_t *cache = &db_mgr->cache;
+  bool cached = !req->params && read_cache_wanted(cache, req->table, req->where);
+  const char *body =
+      cached ? read_cache_get(cache, req->table, req->where, req->format, version, arena, len)
+             : NULL;
+  if (body) {
+    return body;
+  }
+
+  bool leader = false;
+  single_flight_call_t *call =
+      req->params ? NULL
+                  : single_flight_join(&db_mgr->flights, req->table, req->where, req->format,
+                                       version, &leader);
+  if (call && !leader) {
+    body = single_flight_wait(&db_mgr->flights, call, db_manager_deadline(), arena, len);
+    if (body) {
+      return body;
+    }
+    call = NULL;
+  }
+
+  bool complete = false;
+  body = read_encoded(db_mgr, req, arena, len, &complete);
+  if (cached && complete) {
+    read_cache_put(cache, req->table, req->where, req->format, version, body, *len);
+  }
+  if (call) {
+    single_flight_finish(&db_mgr->flights, call, complete ? body : NULL, *len);
+  }
+  return body;
+}
+
+/**
+ * @brief 执行数据库请求
+ *
+ * HTTP 的 READ 以流的形式边读边发，不经过这里；其余操作以及二进制协议的全部操作都由这里执行
+ *
+ * @param db_mgr 数据库管理对象
+ * @param req 请求
+ * @param arena 请求内存区域
+ * @param len 输出响应长度，可以为 NULL（此时调用者按字符串处理响应）
+ * @return const char* 响应，属于请求内存区域（或是常量）；内存不足返回 NULL
+ */
+const char *db_request_execute(db_manager_t *db_mgr, const db_request_t *req, arena_t *arena,
+                               size_t *len) {
+  size_t response_len = 0;
+  bool has_len = false; // 响应长度已知，不能按字符串计算
+  const char *response = NULL;
+
+  db_op_t op = db_op_from_str(req->operation);
+  if (op == DB_OP_BATCH) {
+    if (req->batch_overflow) {
+      response =
+          arena_sprintf(arena, "%s Batch exceeds %d items", KEY_RESP_ERROR, BATCH_MAX_ITEMS);
+    } else {
+      char *batch_response = batch_execute(db_mgr, req->batch);
+      if (batch_response && arena_own(arena, batch_response) != 0) {
+        free(batch_response);
+        batch_response = NULL;
+      }
+      response = batch_response;
+    }
+  } else if (!req->operation || !req->table) {
+    response = KEY_RESP_ERROR " Missing required fields: operation, table";
+  } else {
+    LOG_INFO("Processing DB operation: %s on table %s", req->operation, req->table);
+
+    switch (op) {
+    case DB_OP_CREATE:
+      if (!req->data) {
+        response = KEY_RESP_ERROR " Missing data field for create operation";
+      } else {
+        int result = req->params ? db_manager_execute_params(db_mgr, op, req->table, req->data,
+                                                             NULL, req->params)
+                                 : db_manager_create_row(db_mgr, req->table, req->data);
+        response = result >= 0
+                       ? arena_sprintf(arena, "%s Created %d row(s)", KEY_RESP_SUCCESS, result)
+                       : db_request_failed(db_mgr, arena, "Create");
+      }
+      break;
+    case DB_OP_READ:
+      response = read_buffered(db_mgr, req, arena, &response_len);
+      has_len = true;
+      break;
+    case DB_OP_UPDATE:
+      if (!req->data || !req->where) {
+        response = KEY_RESP_ERROR " Missing data or where field for update operation";
+      } else {
+        int result = req->params ? db_manager_execute_params(db_mgr, op, req->table, req->data,
+                                                             req->where, req->params)
+                                 : db_manager_update_row(db_mgr, req->table, req->data, req->where);
+        response = result >= 0
+                       ? arena_sprintf(arena, "%s Updated %d row(s)", KEY_RESP_SUCCESS, result)
+                       : db_request_failed(db_mgr, arena, "Update");
+      }
+      break;
+    case DB_OP_DELETE:
+      if (!req->where) {
+        response = KEY_RESP_ERROR " Missing where field for delete operation";
+      } else {
+        int result = req->params ? db_manager_execute_params(db_mgr, op, req->table, NULL,
+                                                             req->where, req->params)
+                                 : db_manager_delete_row(db_mgr, req->table, req->where);
+        response = result >= 0
+                       ? arena_sprintf(arena, "%s Deleted %d row(s)", KEY_RESP_SUCCESS, result)
+                       : db_request_failed(db_mgr, arena, "Delete");
+      }
+      break;
+    case DB_OP_BULK_CREATE:
+      // 行只能以请求体的形式流式上传，见 http_server.c
+      response = KEY_RESP_ERROR " bulk_create takes its rows as a " KEY_MIME_CSV
+                                " or " KEY_MIME_NDJSON " body";
+      break;
+    default:
+      response = KEY_RESP_ERROR " Unknown operation";
+      break;
+    }
+  }
+
+  if (len) {
+    *len = has_len ? response_len : (response ? strlen(response) : 0);
+  }
+  return response;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+#include "src/arena.h"
+#include "src/batch.h"
+#include "src/db_manager.h"
+#include "src/result_encoder.h"
+// clang-format on
+
+// 一个数据库请求，HTTP 和二进制协议解析后都转成这个结构，由同一套逻辑执行并生成相同的响应
+typedef struct {
+  const char *operation;
+  const char *table;
+  const char *data;
+  const char *where;
+  const batch_t *batch;      // operation=batch 时的条目
+  bool batch_overflow;       // 条目数超过 BATCH_MAX_ITEMS
+  const db_params_t *params; // data 和 where 中 '?' 的值，不为 NULL 时以预处理语句执行
+  result_format_t format;    // READ 结果集的编码格式
+} db_request_t;
+
+const char *db_request_failed(db_manager_t *db_mgr, arena_t *arena, const char *op_name);
+const char *db_request_execute(db_manager_t *db_mgr, const db_request_t *req, arena_t *arena,
+                               size_t *len);
@@ -0,0 +1,297 @@
+// clang-format off
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gtid.h"
+// clang-format on
+
+/**
+ * @brief 初始化空集合
+ *
+ * @param set 集合
+ */
+void gtid_set_init(gtid_set_t *set) { memset(set, 0, sizeof(gtid_set_t)); }
+
+/**
+ * @brief 释放集合
+ *
+ * @param set 集合
+ */
+void gtid_set_free(gtid_set_t *set) {
+  for (size_t i = 0; i < set->num_sids; ++i) {
+    free(set->sids[i].intervals);
+  }
+  free(set->sids);
+  gtid_set_init(set);
+}
+
+static int hex_value(char ch) {
+  if (ch >= '0' && ch <= '9') {
+    return ch - '0';
+  }
+  ch = (char)tolower((unsigned char)ch);
+  return ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 : -1;
+}
+
+/**
+ * @brief 解析 8-4-4-4-12 格式的 UUID
+ *
+ * @param text 文本，至少 36 个字符
+ * @param uuid 输出
+ * @return int 成功（0）；格式错误（-1）
+ */
+static int parse_uuid(const char *text, unsigned char uuid[GTID_UUID_LEN]) {
+  size_t n = 0;
+  for (size_t i = 0; i < 36; ++i) {
+    if (i == 8 || i == 13 || i == 18 || i == 23) {
+      if (text[i] != '-') {
+        return -1;
+      }
+      continue;
+    }
+    int high = hex_value(text[i]);
+    int low = i + 1 < 36 ? hex_value(text[i + 1]) : -1;
+    if (high < 0 || low < 0) {
+      return -1;
+    }
+    uuid[n++] = (unsigned char)(high << 4 | low);
+    ++i;
+  }
+  return 0;
+}
+
+static void format_uuid(const unsigned char uuid[GTID_UUID_LEN], char out[37]) {
+  snprintf(out, 37,
+           "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x", uuid[0],
+           uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7], uuid[8], uuid[9],
+           uuid[10], uuid[11], uuid[12], uuid[13], uuid[14], uuid[15]);
+}
+
+/**
+ * @brief 查找服务器的事务编号集合，不存在时添加
+ */
+static gtid_sid_t *find_sid(gtid_set_t *set, const unsigned char uuid[GTID_UUID_LEN]) {
+  for (size_t i = 0; i < set->num_sids; ++i) {
+    if (memcmp(set->sids[i].uuid, uuid, GTID_UUID_LEN) == 0) {
+      return &set->sids[i];
+    }
+  }
+  if (set->num_sids == set->cap_sids) {
+    size_t cap = set->cap_sids ? set->cap_sids * 2 : 4;
+    gtid_sid_t *sids = realloc(set->sids, cap * sizeof(gtid_sid_t));
+    if (!sids) {
+      return NULL;
+    }
+    set->sids = sids;
+    set->cap_sids = cap;
+  }
+  gtid_sid_t *sid = &set->sids[set->num_sids++];
+  memset(sid, 0, sizeof(gtid_sid_t));
+  memcpy(sid->uuid, uuid, GTID_UUID_LEN);
+  return sid;
+}
+
+/**
+ * @brief 把区间 [start, end) 并入有序的区间列表，与之重叠或相邻的区间合并为一个
+ */
+static int add_interval(gtid_sid_t *sid, uint64_t start, uint64_t end) {
+  size_t i = 0;
+  while (i < sid->num_intervals && sid->intervals[i].end < start) {
+    ++i;
+  }
+  // i 之后与新区间重叠或相邻的区间
+  size_t j = i;
+  while (j < sid->num_intervals && sid->intervals[j].start <= end) {
+    if (sid->intervals[j].start < start) {
+      start = sid->intervals[j].start;
+    }
+    if (sid->intervals[j].end > end) {
+      end = sid->intervals[j].end;
+    }
+    ++j;
+  }
+
+  if (i == j) {
+    if (sid->num_intervals == sid->cap_intervals) {
+      size_t cap = sid->cap_intervals ? sid->cap_intervals * 2 : 4;
+      gtid_interval_t *intervals = realloc(sid->intervals, cap * sizeof(gtid_interval_t));
+      if (!intervals) {
+        return -1;
+      }
+      sid->intervals = intervals;
+      sid->cap_intervals = cap;
+    }
+    memmove(&sid->intervals[i + 1], &sid->intervals[i],
+            (sid->num_intervals - i) * sizeof(gtid_interval_t));
+    ++sid->num_intervals;
+  } else {
+    memmove(&sid->intervals[i + 1], &sid->intervals[j],
+            (sid->num_intervals - j) * sizeof(gtid_interval_t));
+    sid->num_intervals -= j - i - 1;
+  }
+  sid->intervals[i].start = start;
+  sid->intervals[i].end = end;
+  return 0;
+}
+
+/**
+ * @brief 解析 GTID 集合文本（@@GLOBAL.gtid_executed 的格式），追加到集合中
+ *
+ * 不支持 MySQL 8.3 引入的带标签的 GTID
+ *
+ * @param set 集合
+ * @param text 文本，逗号分隔，可以含空白；空串表示空集合
+ * @return int 成功（0）；格式错误或内存不足（-1）
+ */
+int gtid_set_parse(gtid_set_t *set, const char *text) {
+  const char *ptr = text;
+  for (;;) {
+    while (isspace((unsigned char)*ptr) || *ptr == ',') {
+      ++ptr;
+    }
+    if (*ptr == '\0') {
+      return 0;
+    }
+
+    unsigned char uuid[GTID_UUID_LEN];
+    if (strlen(ptr) < 36 || parse_uuid(ptr, uuid) != 0) {
+      return -1;
+    }
+    ptr += 36;
+    gtid_sid_t *sid = find_sid(set, uuid);
+    if (!sid) {
+      return -1;
+    }
+
+    // 一个或多个 :N 或 :N-M
+    if (*ptr != ':') {
+      return -1;
+    }
+    while (*ptr == ':') {
+      char *end = NULL;
+      ++ptr;
+      if (!isdigit((unsigned char)*ptr)) {
+        return -1;
+      }
+      unsigned long long start = strtoull(ptr, &end, 10);
+      unsigned long long last = start;
+      ptr = end;
+      if (*ptr == '-') {
+        ++ptr;
+        if (!isdigit((unsigned char)*ptr)) {
+          return -1;
+        }
+        last = strtoull(ptr, &end, 10);
+        ptr = end;
+      }
+      if (start == 0 || last < start || last == UINT64_MAX ||
+          add_interval(sid, start, last + 1) != 0) {
+        return -1;
+      }
+    }
+    while (isspace((unsigned char)*ptr)) {
+      ++ptr;
+    }
+    if (*ptr != ',' && *ptr != '\0') {
+      return -1;
+    }
+  }
+}
+
+/**
+ * @brief 加入一个事务
+ *
+ * @param set 集合
+ * @param uuid 服务器 UUID
+ * @param gno 事务编号
+ * @return int 成功（0）；内存不足（-1）
+ */
+int gtid_set_add(gtid_set_t *set, const unsigned char uuid[GTID_UUID_LEN], uint64_t gno) {
+  gtid_sid_t *sid = find_sid(set, uuid);
+  return sid && gno > 0 && gno < UINT64_MAX ? add_interval(sid, gno, gno + 1) : -1;
+}
+
+/**
+ * @brief 输出集合的文本形式，没有空白，可以原样传回 gtid_set_parse()
+ *
+ * @param set 集合
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int gtid_set_format(const gtid_set_t *set, strbuf_t *out) {
+  int rc = 0;
+  bool first = true;
+  for (size_t i = 0; rc == 0 && i < set->num_sids; ++i) {
+    const gtid_sid_t *sid = &set->sids[i];
+    if (sid->num_intervals == 0) {
+      continue;
+    }
+    char uuid[37];
+    format_uuid(sid->uuid, uuid);
+    rc = strbuf_appendf(out, "%s%s", first ? "" : ",", uuid);
+    first = false;
+    for (size_t j = 0; rc == 0 && j < sid->num_intervals; ++j) {
+      const gtid_interval_t *interval = &sid->intervals[j];
+      rc = interval->end - interval->start == 1
+               ? strbuf_appendf(out, ":%llu", (unsigned long long)interval->start)
+               : strbuf_appendf(out, ":%llu-%llu", (unsigned long long)interval->start,
+                                (unsigned long long)interval->end - 1);
+    }
+  }
+  // 空集合输出空串
+  return rc == 0 ? strbuf_reserve(out, 0) : -1;
+}
+
+static int append_uint64(strbuf_t *out, uint64_t value) {
+  unsigned char bytes[8];
+  for (int i = 0; i < 8; ++i) {
+    bytes[i] = (unsigned char)(value >> (8 * i));
+  }
+  return strbuf_append(out, bytes, sizeof(bytes));
+}
+
+/**
+ * @brief 按 COM_BINLOG_DUMP_GTID 的格式编码集合：服务器数、
+ *        每个服务器的 UUID、区间数和各区间，整数均为 8 字节小端
+ *
+ * @param set 集合
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int gtid_set_encode(const gtid_set_t *set, strbuf_t *out) {
+  size_t num_sids = 0;
+  for (size_t i = 0; i < set->num_sids; ++i) {
+    num_sids += set->sids[i].num_intervals > 0;
+  }
+  int rc = append_uint64(out, num_sids);
+  for (size_t i = 0; rc == 0 && i < set->num_sids; ++i) {
+    const gtid_sid_t *sid = &set->sids[i];
+    if (sid->num_intervals == 0) {
+      continue;
+    }
+    rc = strbuf_append(out, sid->uuid, GTID_UUID_LEN) || append_uint64(out, sid->num_intervals);
+    for (size_t j = 0; rc == 0 && j < sid->num_intervals; ++j) {
+      rc = append_uint64(out, sid->intervals[j].start) ||
+           append_uint64(out, sid->intervals[j].end);
+    }
+  }
+  return rc == 0 ? 0 : -1;
+}
+
+/**
+ * @brief 输出单个 GTID 的文本形式 uuid:gno
+ *
+ * @param uuid 服务器 UUID
+ * @param gno 事务编号
+ * @param out 输出
+ * @param size 输出缓冲区大小，至少 GTID_TEXT_LEN
+ * @return int 成功（0）；失败（-1）
+ */
+int gtid_format(const unsigned char uuid[GTID_UUID_LEN], uint64_t gno, char *out, size_t size) {
+  char text[37];
+  format_uuid(uuid, text);
+  int n = snprintf(out, size, "%s:%llu", text, (unsigned long long)gno);
+  return n > 0 && (size_t)n < size ? 0 : -1;
+}
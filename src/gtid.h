@@ -0,0 +1,41 @@
+#pragma once
+
+// clang-format off
+#include <stddef.h>
+#include <stdint.h>
+#include "src/strbuf.h"
+// clang-format on
+
+// server_uuid 的二进制长度
+#define GTID_UUID_LEN 16
+// "uuid:gno" 的最大长度
+#define GTID_TEXT_LEN 64
+
+// 左闭右开区间 [start, end)，与复制协议中的编码一致
+typedef struct {
+  uint64_t start;
+  uint64_t end;
+} gtid_interval_t;
+
+// 一个服务器（server_uuid）执行过的事务编号，区间有序且互不相邻
+typedef struct {
+  unsigned char uuid[GTID_UUID_LEN];
+  gtid_interval_t *intervals;
+  size_t num_intervals;
+  size_t cap_intervals;
+} gtid_sid_t;
+
+// GTID 集合，例如 3E11FA47-71CA-11E1-9E33-C80AA9429562:1-5:7,...
+typedef struct {
+  gtid_sid_t *sids;
+  size_t num_sids;
+  size_t cap_sids;
+} gtid_set_t;
+
+void gtid_set_init(gtid_set_t *set);
+void gtid_set_free(gtid_set_t *set);
+int gtid_set_parse(gtid_set_t *set, const char *text);
+int gtid_set_add(gtid_set_t *set, const unsigned char uuid[GTID_UUID_LEN], uint64_t gno);
+int gtid_set_format(const gtid_set_t *set, strbuf_t *out);
+int gtid_set_encode(const gtid_set_t *set, strbuf_t *out);
+int gtid_format(const unsigned char uuid[GTID_UUID_LEN], uint64_t gno, char *out, size_t size);
@@ -1,9 +1,12 @@
 // clang-format off
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "dbmanager_conf.h"
 #include "http_client.h"
+#include "src/clock.h"
+#include "src/json_escape.h"
 #include "src/key.h"
 #include "src/logger.h"
 #include "src/macro.h"
@@ -11,6 +14,14 @@
 
 #define VERSION0 DBCLI STR_HELPER(-)
 #define VERSION VERSION0 STR_HELPER(OHNO_VERSION)
+// 以该前缀开头的 url 表示 Unix 域套接字路径
+#define UNIX_URL_PREFIX "unix:"
+#define UNIX_HTTP_URL "http://localhost/"
+// 单个请求最多的请求头：Content-Type、Accept、If-None-Match、X-Api-Key、X-Deadline-Ms；
+// 批量写入没有 Accept 和 If-None-Match，另有 Transfer-Encoding
+#define REQUEST_MAX_HEADERS 5
+// 同步请求等待时每次阻塞的最长时间
+#define SYNC_WAIT_SLICE_MS 1000
 
 // HTTP 响应缓冲区
 typedef struct {
@@ -18,6 +29,37 @@ typedef struct {
   size_t size;
 } response_buffer_t;
 
+// 一个请求，从提交到完成；请求头的链表节点和内容都在结构体内，不单独分配
+typedef struct http_request {
+  uint64_t id;
+  CURL *curl;            // 开始后占用的句柄
+  const char *operation; // KEY_OP_*
+  char *table;           // READ 保存表和条件，用于缓存响应
+  char *where;
+  result_format_t format;
+  bool revalidate; // 带了 If-None-Match
+  bool raw;        // 只接收响应体，由调用者解析（批量、变更订阅）
+  bool sync;       // 同步请求，完成后由等待者取走
+  bool running;    // 已交给 multi
+  bool done;
+  long timeout_ms;
+  strbuf_t body;
+  char *url;    // 带查询参数的地址，NULL 表示 client->base_url
+  FILE *upload; // 不为 NULL 时请求体边读边发送，不使用 body
+  struct curl_slist headers[REQUEST_MAX_HEADERS];
+  size_t num_headers;
+  char accept[128];
+  char condition[128];
+  char deadline[64];
+  char *api_key_header;
+  response_buffer_t response;
+  CURLcode code;
+  rowset_t **rowset; // 同步 READ 要求解码后的结果集时不为 NULL
+  http_client_callback_t callback;
+  http_completion_t completion;
+  struct http_request *next;
+} http_request_t;
+
 /**
  * @brief libcurl 回调
  *
@@ -46,191 +88,498 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, void *us
 }
 
 /**
- * @brief URL 编码函数
+ * @brief URL 编码后追加，不分配临时缓冲区
  *
- * @param str 要编码的字符串
- * @return char* 编码后的字符串
+ * @param buf 缓冲区
+ * @param str 要编码的数据，可以含 '\0'
+ * @param len 长度
+ * @return int 成功（0）；失败（-1）
  */
-static char *url_encode(const char *str) {
-  if (!str) {
-    return NULL;
-  }
-
-  // 计算需要的缓冲区大小
-  size_t len = strlen(str);
-  char *encoded = malloc(len * 3 + 1); // 最坏情况：每个字符变成 %XX
-  if (!encoded) {
-    return NULL;
+static int url_encode_append(strbuf_t *buf, const char *str, size_t len) {
+  static const char hex[] = "0123456789ABCDEF";
+  // 最坏情况：每个字符变成 %XX
+  if (strbuf_reserve(buf, len * 3) != 0) {
+    return -1;
   }
 
-  char *ptr = encoded;
+  char *ptr = buf->data + buf->len;
   for (size_t i = 0; i < len; i++) {
     unsigned char c = str[i];
     if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-' ||
         c == '_' || c == '.' || c == '~') {
       *ptr++ = c;
     } else {
-      sprintf(ptr, "%%%02X", c);
-      ptr += 3;
+      *ptr++ = '%';
+      *ptr++ = hex[c >> 4];
+      *ptr++ = hex[c & 0xF];
     }
   }
   *ptr = '\0';
+  buf->len = ptr - buf->data;
+  return 0;
+}
+
+/**
+ * @brief 创建一个 libcurl 句柄，设置所有请求共用的选项
+ *
+ * @param client http client 对象
+ * @return CURL* 句柄；失败返回 NULL
+ */
+static CURL *easy_handle_new(const http_client_t *client) {
+  CURL *curl = curl_easy_init();
+  if (!curl) {
+    LOG_ERROR("Failed to initialize libcurl");
+    return NULL;
+  }
 
-  return encoded;
+  if (client->unix_socket) {
+    // 请求仍按 HTTP 发送，只是连接走 Unix 域套接字，主机名不参与寻址
+    curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, client->unix_socket);
+  }
+  curl_easy_setopt(curl, CURLOPT_URL, client->base_url);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, VERSION);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  // 空字符串表示声明 libcurl 支持的全部编码（gzip、zstd），响应由 libcurl 透明解压
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+  return curl;
 }
 
 /**
  * @brief 初始化 http client
  *
- * @param base_url url
+ * @param base_url url，"unix:PATH" 表示通过 Unix 域套接字 PATH 连接本机 daemon
  * @return http_client_t* 对象
  */
 http_client_t *http_client_init(const char *base_url) {
-  http_client_t *client = malloc(sizeof(http_client_t));
+  http_client_t *client = calloc(1, sizeof(http_client_t));
   if (!client) {
     LOG_ERROR("Failed to allocate memory for HTTP client");
     return NULL;
   }
 
-  client->curl = curl_easy_init();
-  if (!client->curl) {
+  bool unix_socket = strncmp(base_url, UNIX_URL_PREFIX, strlen(UNIX_URL_PREFIX)) == 0;
+  if (unix_socket) {
+    client->unix_socket = strdup(base_url + strlen(UNIX_URL_PREFIX));
+    client->base_url = strdup(UNIX_HTTP_URL);
+  } else {
+    client->base_url = strdup(base_url);
+  }
+  client->format = RESULT_FORMAT_TEXT;
+  client->json_body = false;
+  client->api_key_header = NULL;
+  client->last_read_cached = false;
+  http_client_set_timeout(client, HTTP_CLIENT_DEFAULT_TIMEOUT_MS);
+
+  if (!client->base_url || (unix_socket && !client->unix_socket)) {
+    LOG_ERROR("Failed to allocate memory for HTTP client");
+    http_client_cleanup(client);
+    return NULL;
+  }
+  client->curl = easy_handle_new(client);
+  client->multi = curl_multi_init();
+  if (!client->curl || !client->multi ||
+      http_client_set_max_active(client, HTTP_CLIENT_DEFAULT_MAX_ACTIVE) != 0) {
     LOG_ERROR("Failed to initialize libcurl");
-    free(client);
+    http_client_cleanup(client);
     return NULL;
   }
 
-  client->base_url = strdup(base_url);
-
-  curl_easy_setopt(client->curl, CURLOPT_USERAGENT, VERSION);
-  curl_easy_setopt(client->curl, CURLOPT_WRITEFUNCTION, write_callback);
-  curl_easy_setopt(client->curl, CURLOPT_TIMEOUT, 10L);
-  curl_easy_setopt(client->curl, CURLOPT_FOLLOWLOCATION, 1L);
-
   LOG_DEBUG("HTTP client initialized with base URL: %s", base_url);
   return client;
 }
 
 /**
- * @brief 销毁 http client
+ * @brief 清空缓存的 READ 响应
  *
- * @param client 对象
+ * @param cache 缓存
  */
-void http_client_cleanup(http_client_t *client) {
-  if (client) {
-    if (client->curl) {
-      curl_easy_cleanup(client->curl);
+static void read_cache_clear(http_read_cache_t *cache) {
+  free(cache->table);
+  free(cache->where);
+  free(cache->etag);
+  free(cache->body);
+  memset(cache, 0, sizeof(http_read_cache_t));
+}
+
+/**
+ * @brief 缓存的响应是否属于同一个查询（表、条件和结果集格式都相同）
+ *
+ * @param cache 缓存
+ * @param table 表
+ * @param where 条件，可以为 NULL
+ * @param format 结果集编码格式
+ * @return bool 是同一个查询返回 true
+ */
+static bool read_cache_match(const http_read_cache_t *cache, const char *table, const char *where,
+                             result_format_t format) {
+  return cache->etag && table && strcmp(cache->table, table) == 0 &&
+         (cache->where ? where && strcmp(cache->where, where) == 0 : !where) &&
+         cache->format == format;
+}
+
+/**
+ * @brief 保存带 ETag 的 READ 响应，失败时清空缓存
+ *
+ * @param cache 缓存
+ * @param table 表
+ * @param where 条件，可以为 NULL
+ * @param format 结果集编码格式
+ * @param etag ETag 响应头
+ * @param body 响应体
+ * @param size 响应体长度
+ * @param rowset 响应体是二进制结果集
+ */
+static void read_cache_store(http_read_cache_t *cache, const char *table, const char *where,
+                             result_format_t format, const char *etag, const char *body,
+                             size_t size, bool rowset) {
+  read_cache_clear(cache);
+  cache->table = strdup(table);
+  cache->where = where ? strdup(where) : NULL;
+  cache->etag = strdup(etag);
+  cache->body = malloc(size + 1);
+  if (!cache->table || (where && !cache->where) || !cache->etag || !cache->body) {
+    read_cache_clear(cache);
+    return;
+  }
+  memcpy(cache->body, body, size);
+  cache->body[size] = '\0';
+  cache->size = size;
+  cache->format = format;
+  cache->rowset = rowset;
+}
+
+/**
+ * @brief 解码二进制结果集响应，二进制协议客户端也使用
+ *
+ * @param data 响应数据
+ * @param size 响应长度
+ * @param output 未要求 rowset 时输出渲染后的文本；出错时输出错误信息
+ * @param rowset 不为 NULL 时输出解码后的结果集
+ * @return int 出错（-1）；成功（1）
+ */
+int http_client_parse_rowset(const char *data, size_t size, char **output, rowset_t **rowset) {
+  rowset_t *decoded = rowset_decode(data, size);
+  if (!decoded) {
+    LOG_ERROR("Malformed binary result set (%zu bytes)", size);
+    if (output) {
+      *output = strdup("Malformed binary result set");
     }
-    if (client->base_url) {
-      free(client->base_url);
+    return -1;
+  }
+
+  if (decoded->error) {
+    // 服务端在发送部分数据后出错，整个结果视为失败
+    if (output) {
+      *output = strdup(decoded->error);
     }
-    free(client);
+    rowset_free(decoded);
+    return -1;
+  }
+
+  if (rowset) {
+    *rowset = decoded;
+    return 1;
   }
+
+  int result = -1;
+  if (output) {
+    strbuf_t text;
+    strbuf_init(&text);
+    if (rowset_to_text(decoded, &text) == 0) {
+      *output = strbuf_detach(&text);
+      result = 1;
+    }
+    strbuf_free(&text);
+  }
+  rowset_free(decoded);
+  return result;
 }
 
 /**
- * @brief 发送 http 请求
+ * @brief 设置 READ 操作请求的结果集编码格式
  *
  * @param client http client 对象
- * @param operation 操作类型
- * @param table 表
- * @param data 数据
- * @param where 条件
- * @param output 输出（仅 READ 操作使用）
- * @return int 出错返回 -1，成功返回值大于等于 0
+ * @param format 编码格式
  */
-static int send_http_request(http_client_t *client, const char *operation, const char *table,
-                             const char *data, const char *where, char **output) {
-  if (!client || !client->curl) {
-    return -1;
+void http_client_set_format(http_client_t *client, result_format_t format) {
+  if (client) {
+    client->format = format;
   }
+}
 
-  char *encoded_operation = url_encode(operation);
-  char *encoded_table = url_encode(table);
-  char *encoded_data = data ? url_encode(data) : NULL;
-  char *encoded_where = where ? url_encode(where) : NULL;
-
-  size_t post_data_len = strlen(encoded_operation) + strlen(encoded_table) + 50;
-  if (encoded_data) {
-    post_data_len += strlen(encoded_data) + 10;
+/**
+ * @brief 设置请求体编码：JSON 请求体不需要 URL 编码，服务端原地解析，适合较大的 data/where
+ *
+ * @param client http client 对象
+ * @param json_body true 表示以 application/json 发送，false 表示表单编码
+ */
+void http_client_set_json_body(http_client_t *client, bool json_body) {
+  if (client) {
+    client->json_body = json_body;
   }
-  if (encoded_where) {
-    post_data_len += strlen(encoded_where) + 10;
+}
+
+/**
+ * @brief 设置请求超时；每个请求带上 X-Deadline-Ms 头，服务端超时后不再等待连接、终止语句，
+ *        不会在客户端放弃之后继续占用数据库连接
+ *
+ * @param client http client 对象
+ * @param timeout_ms 超时毫秒数，0 表示不限时
+ */
+void http_client_set_timeout(http_client_t *client, long timeout_ms) {
+  if (client && timeout_ms >= 0) {
+    client->timeout_ms = timeout_ms;
   }
+}
 
-  char *post_data = malloc(post_data_len);
-  if (!post_data) {
-    LOG_ERROR("Failed to allocate memory for POST data");
-    free(encoded_operation);
-    free(encoded_table);
-    if (encoded_data) {
-      free(encoded_data);
-    }
-    if (encoded_where) {
-      free(encoded_where);
-    }
+/**
+ * @brief 设置 API Key，服务端按它识别客户端并计算速率和并发配额
+ *
+ * @param client http client 对象
+ * @param api_key API Key，NULL 表示不发送
+ * @return int 成功（0）；失败（-1）
+ */
+int http_client_set_api_key(http_client_t *client, const char *api_key) {
+  if (!client) {
     return -1;
   }
+  char *header = NULL;
+  if (api_key) {
+    size_t size = strlen(KEY_HEADER_API_KEY ": ") + strlen(api_key) + 1;
+    header = malloc(size);
+    if (!header) {
+      LOG_ERROR("Failed to allocate memory for API key");
+      return -1;
+    }
+    snprintf(header, size, KEY_HEADER_API_KEY ": %s", api_key);
+  }
+  free(client->api_key_header);
+  client->api_key_header = header;
+  return 0;
+}
 
-  snprintf(post_data, post_data_len, "%s=%s&%s=%s", KEY_POST_OPERATION, encoded_operation,
-           KEY_POST_TABLE, encoded_table);
-
-  if (encoded_data) {
-    strcat(post_data, "&");
-    strcat(post_data, KEY_POST_DATA);
-    strcat(post_data, "=");
-    strcat(post_data, encoded_data);
+/**
+ * @brief 获取最近一次请求的追踪 ID 和服务端各阶段耗时（来自 X-Trace-Id、Server-Timing 响应头）
+ *
+ * @param client http client 对象
+ * @param trace 输出追踪 ID 和各阶段耗时
+ * @param total_us 输出客户端看到的请求总耗时，可以为 NULL
+ * @return int 成功（0）；响应中没有 Server-Timing（-1）
+ */
+int http_client_last_timing(http_client_t *client, trace_t *trace, uint64_t *total_us) {
+  if (!client || !trace) {
+    return -1;
   }
 
-  if (encoded_where) {
-    strcat(post_data, "&");
-    strcat(post_data, KEY_POST_WHERE);
-    strcat(post_data, "=");
-    strcat(post_data, encoded_where);
+  struct curl_header *header = NULL;
+  trace->id[0] = '\0';
+  if (curl_easy_header(client->curl, TRACE_ID_HEADER, 0, CURLH_HEADER, -1, &header) ==
+      CURLHE_OK) {
+    snprintf(trace->id, sizeof(trace->id), "%s", header->value);
+  }
+  if (total_us) {
+    curl_off_t total = 0;
+    curl_easy_getinfo(client->curl, CURLINFO_TOTAL_TIME_T, &total);
+    *total_us = (uint64_t)total;
   }
 
-  LOG_DEBUG("Sending HTTP request: %s", post_data);
+  if (curl_easy_header(client->curl, TRACE_SERVER_TIMING_HEADER, 0, CURLH_HEADER, -1, &header) !=
+      CURLHE_OK) {
+    return -1;
+  }
+  return trace_parse_server_timing(header->value, trace) > 0 ? 0 : -1;
+}
 
-  // 准备 HTTP 请求
-  response_buffer_t response_buffer = {0};
-  curl_easy_setopt(client->curl, CURLOPT_URL, client->base_url);
-  curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, post_data);
-  curl_easy_setopt(client->curl, CURLOPT_WRITEDATA, &response_buffer);
+/**
+ * @brief 最近一次 READ 是否由服务端确认未变化（304）、直接复用了上一次的结果
+ *
+ * @param client http client 对象
+ * @return bool 复用了缓存返回 true
+ */
+bool http_client_last_read_cached(http_client_t *client) {
+  return client && client->last_read_cached;
+}
 
-  struct curl_slist *headers = NULL;
-  headers = curl_slist_append(headers, "Content-Type: application/x-www-form-urlencoded");
-  curl_easy_setopt(client->curl, CURLOPT_HTTPHEADER, headers);
+/**
+ * @brief 追加一个 URL 编码后的 POST 字段
+ *
+ * @param post_data POST 数据
+ * @param key 字段名
+ * @param value 字段值，为 NULL 时不追加
+ * @return int 成功（0）；失败（-1）
+ */
+static int append_post_field(strbuf_t *post_data, const char *key, const char *value) {
+  if (!value) {
+    return 0;
+  }
+  if (strbuf_appendf(post_data, "%s%s=", post_data->len ? "&" : "", key) != 0) {
+    return -1;
+  }
+  return url_encode_append(post_data, value, strlen(value));
+}
 
-  CURLcode res = curl_easy_perform(client->curl);
-  curl_slist_free_all(headers);
+/**
+ * @brief 追加一个 JSON 字符串成员
+ *
+ * @param body JSON 对象，已写入左花括号
+ * @param key 字段名
+ * @param value 字段值，为 NULL 时不追加
+ * @return int 成功（0）；失败（-1）
+ */
+static int append_json_field(strbuf_t *body, const char *key, const char *value) {
+  if (!value) {
+    return 0;
+  }
+  bool first = body->data[body->len - 1] == '{';
+  if (strbuf_appendf(body, "%s\"%s\":\"", first ? "" : ",", key) != 0 ||
+      json_escape_append(body, value, strlen(value)) != 0) {
+    return -1;
+  }
+  return strbuf_append_char(body, '"');
+}
 
-  free(encoded_operation);
-  free(encoded_table);
-  if (encoded_data) {
-    free(encoded_data);
+/**
+ * @brief 追加参数化操作的参数：JSON 编码时是带类型的数组，表单编码时每个值一个 param 字段
+ *
+ * 表单只能传字符串，数值以文本发送，由服务端按列类型转换；NULL 无法用表单表示
+ *
+ * @param client http client 对象
+ * @param body 请求体，JSON 编码时已写入左花括号
+ * @param params 参数，为 NULL 时不追加
+ * @return int 成功（0）；失败（-1）
+ */
+static int append_params(const http_client_t *client, strbuf_t *body, const db_params_t *params) {
+  if (!params) {
+    return 0;
   }
-  if (encoded_where) {
-    free(encoded_where);
+  if (client->json_body && strbuf_appendf(body, ",\"%s\":[", KEY_JSON_PARAMS) != 0) {
+    return -1;
   }
-  free(post_data);
+  for (size_t i = 0; i < params->count; ++i) {
+    const db_param_t *param = &params->values[i];
+    char number[32] = "";
+    if (param->type == DB_PARAM_INT) {
+      snprintf(number, sizeof(number), "%lld", param->i);
+    } else if (param->type == DB_PARAM_DOUBLE) {
+      snprintf(number, sizeof(number), "%.17g", param->d);
+    }
+    if (!client->json_body) {
+      if (param->type == DB_PARAM_NULL) {
+        LOG_ERROR("NULL params need a JSON request body");
+        return -1;
+      }
+      bool text = param->type == DB_PARAM_STRING;
+      if (strbuf_appendf(body, "%s%s=", body->len ? "&" : "", KEY_POST_PARAM) != 0 ||
+          url_encode_append(body, text ? param->str : number,
+                            text ? param->len : strlen(number)) != 0) {
+        return -1;
+      }
+      continue;
+    }
 
-  if (res != CURLE_OK) {
-    LOG_ERROR("HTTP request failed: %s", curl_easy_strerror(res));
-    if (response_buffer.data) {
-      free(response_buffer.data);
+    int rc = i > 0 ? strbuf_append_char(body, ',') : 0;
+    if (rc == 0 && param->type == DB_PARAM_NULL) {
+      rc = strbuf_append_str(body, "null");
+    } else if (rc == 0 && param->type == DB_PARAM_STRING) {
+      rc = strbuf_append_char(body, '"') || json_escape_append(body, param->str, param->len) ||
+           strbuf_append_char(body, '"');
+    } else if (rc == 0) {
+      rc = strbuf_append_str(body, number);
     }
-    return -1;
+    if (rc != 0) {
+      return -1;
+    }
+  }
+  return client->json_body ? strbuf_append_char(body, ']') : 0;
+}
+
+/**
+ * @brief 按客户端设置的编码生成单个操作的请求体
+ *
+ * @param client http client 对象
+ * @param body 输出请求体
+ * @param operation 操作类型
+ * @param table 表
+ * @param data 数据，可以为 NULL
+ * @param where 条件，可以为 NULL
+ * @param params 参数化操作的参数，可以为 NULL
+ * @return int 成功（0）；失败（-1）
+ */
+static int build_request_body(const http_client_t *client, strbuf_t *body, const char *operation,
+                              const char *table, const char *data, const char *where,
+                              const db_params_t *params) {
+  if (client->json_body) {
+    return strbuf_append_char(body, '{') ||
+           append_json_field(body, KEY_POST_OPERATION, operation) ||
+           append_json_field(body, KEY_POST_TABLE, table) ||
+           append_json_field(body, KEY_POST_DATA, data) ||
+           append_json_field(body, KEY_POST_WHERE, where) ||
+           append_params(client, body, params) || strbuf_append_char(body, '}');
   }
+  return append_post_field(body, KEY_POST_OPERATION, operation) ||
+         append_post_field(body, KEY_POST_TABLE, table) ||
+         append_post_field(body, KEY_POST_DATA, data) ||
+         append_post_field(body, KEY_POST_WHERE, where) || append_params(client, body, params);
+}
 
-  LOG_DEBUG("Received HTTP response: %s", response_buffer.data);
+/**
+ * @brief 生成带读取参数的 READ 请求体，未设置的参数不发送
+ *
+ * @param client http client 对象
+ * @param body 输出请求体
+ * @param table 表
+ * @param where 条件，可以为 NULL
+ * @param options 读取参数
+ * @return int 成功（0）；失败（-1）
+ */
+static int build_read_body(const http_client_t *client, strbuf_t *body, const char *table,
+                           const char *where, const read_options_t *options) {
+  char page_size[16], limit[16];
+  snprintf(page_size, sizeof(page_size), "%u", options->page_size);
+  snprintf(limit, sizeof(limit), "%u", options->limit);
+  if (client->json_body) {
+    return strbuf_append_char(body, '{') ||
+           append_json_field(body, KEY_POST_OPERATION, KEY_OP_READ) ||
+           append_json_field(body, KEY_POST_TABLE, table) ||
+           append_json_field(body, KEY_POST_WHERE, where) ||
+           append_json_field(body, KEY_POST_COLUMNS, options->columns) ||
+           append_json_field(body, KEY_POST_ORDER_BY, options->order_by) ||
+           (options->limit > 0 && strbuf_appendf(body, ",\"%s\":%s", KEY_POST_LIMIT, limit)) ||
+           (options->page_size > 0 &&
+            strbuf_appendf(body, ",\"%s\":%s", KEY_POST_PAGE_SIZE, page_size)) ||
+           append_json_field(body, KEY_POST_PAGE_TOKEN, options->page_token) ||
+           append_params(client, body, options->params) || strbuf_append_char(body, '}');
+  }
+  return append_post_field(body, KEY_POST_OPERATION, KEY_OP_READ) ||
+         append_post_field(body, KEY_POST_TABLE, table) ||
+         append_post_field(body, KEY_POST_WHERE, where) ||
+         append_post_field(body, KEY_POST_COLUMNS, options->columns) ||
+         append_post_field(body, KEY_POST_ORDER_BY, options->order_by) ||
+         append_post_field(body, KEY_POST_LIMIT, options->limit > 0 ? limit : NULL) ||
+         append_post_field(body, KEY_POST_PAGE_SIZE, options->page_size > 0 ? page_size : NULL) ||
+         append_post_field(body, KEY_POST_PAGE_TOKEN, options->page_token) ||
+         append_params(client, body, options->params);
+}
 
-  // 解析 HTTP 响应
+/**
+ * @brief 解析单个操作的文本响应，二进制协议客户端也使用
+ *
+ * @param operation 操作类型
+ * @param data 响应
+ * @param output 输出
+ * @return int 出错返回 -1，成功返回值大于等于 0
+ */
+int http_client_parse_response(const char *operation, const char *data, char **output) {
   int result = -1;
   size_t len_succ = strlen(KEY_RESP_SUCCESS);
   size_t len_fail = strlen(KEY_RESP_ERROR);
-  if (strncmp(response_buffer.data, KEY_RESP_SUCCESS, len_succ) == 0) {
+  if (strncmp(data, KEY_RESP_SUCCESS, len_succ) == 0) {
     // CREATE, UPDATE, DELETE
-    char *ptr = response_buffer.data + 8;
-    *output = strdup(ptr);
+    const char *ptr = data + len_succ;
+    if (output) {
+      *output = strdup(ptr);
+    }
     while (*ptr && !(*ptr >= '0' && *ptr <= '9')) {
       ptr++;
     }
@@ -239,70 +588,1236 @@ static int send_http_request(http_client_t *client, const char *operation, const
     } else {
       result = 0;
     }
-  } else if (strncmp(response_buffer.data, KEY_RESP_ERROR, len_fail) == 0) {
-    *output = strdup(response_buffer.data + 6);
+  } else if (strncmp(data, KEY_RESP_ERROR, len_fail) == 0) {
+    if (output) {
+      *output = strdup(data + len_fail);
+    }
   } else {
     // READ
     if (strcmp(operation, KEY_OP_READ) == 0 && output) {
-      *output = strdup(response_buffer.data);
+      *output = strdup(data);
       result = 1;
     }
   }
-
-  free(response_buffer.data);
   return result;
 }
 
 /**
- * @brief 通过 http 发起数据库 create
+ * @brief 追加一个请求头，节点在请求内，不分配内存
  *
- * @param client http client
- * @param table 表
- * @param data 数据
- * @param output 返回值
- * @return int 出错（-1）；成功（大于等于 0，含义为已生效的条目数）
+ * @param req 请求
+ * @param line 请求头，生命周期不短于请求
  */
-int http_client_create(http_client_t *client, const char *table, const char *data, char **output) {
-  return send_http_request(client, KEY_OP_CREATE, table, data, NULL, output);
+static void request_add_header(http_request_t *req, const char *line) {
+  struct curl_slist *node = &req->headers[req->num_headers];
+  node->data = (char *)line;
+  node->next = NULL;
+  if (req->num_headers > 0) {
+    req->headers[req->num_headers - 1].next = node;
+  }
+  ++req->num_headers;
 }
 
 /**
- * @brief 通过 http 发起数据库 read
+ * @brief 释放请求
  *
- * @param client http client
- * @param table 表
- * @param where 条件
- * @param output 返回值
- * @return int 出错（-1）；成功（1）
+ * @param req 请求
  */
-int http_client_read(http_client_t *client, const char *table, const char *where, char **output) {
-  return send_http_request(client, KEY_OP_READ, table, NULL, where, output);
+static void request_free(http_request_t *req) {
+  strbuf_free(&req->body);
+  free(req->url);
+  free(req->table);
+  free(req->where);
+  free(req->api_key_header);
+  free(req->response.data);
+  free(req->completion.output);
+  free(req);
 }
 
 /**
- * @brief 通过 http 发起数据库 update
+ * @brief 按客户端当前的设置创建请求，设置在请求创建之后的修改不影响它
  *
- * @param client http client
- * @param table 表
- * @param data 数据
- * @param where 条件
- * @param output 返回值
- * @return int 出错（-1）；成功（大于等于 0，含义为已生效的条目数）
+ * @param client http client 对象
+ * @param operation 操作类型
+ * @param table 表，READ 时用于缓存响应
+ * @param where 条件，READ 时用于缓存响应
+ * @param body 已编码的请求体，由请求接管
+ * @return http_request_t* 请求；失败返回 NULL
  */
-int http_client_update(http_client_t *client, const char *table, const char *data,
-                       const char *where, char **output) {
-  return send_http_request(client, KEY_OP_UPDATE, table, data, where, output);
+static http_request_t *request_new(http_client_t *client, const char *operation,
+                                   const char *table, const char *where, strbuf_t *body) {
+  http_request_t *req = calloc(1, sizeof(http_request_t));
+  if (!req) {
+    LOG_ERROR("Failed to allocate memory for HTTP request");
+    return NULL;
+  }
+  req->id = ++client->next_id;
+  req->operation = operation;
+  req->format = client->format;
+  req->timeout_ms = client->timeout_ms;
+  req->body = *body;
+  strbuf_init(body);
+  LOG_DEBUG("Sending HTTP request: %s", req->body.data);
+
+  bool is_read = strcmp(operation, KEY_OP_READ) == 0;
+  request_add_header(req, client->json_body ? "Content-Type: " KEY_MIME_JSON
+                                            : "Content-Type: application/x-www-form-urlencoded");
+  if (is_read && client->format != RESULT_FORMAT_TEXT) {
+    snprintf(req->accept, sizeof(req->accept), "Accept: %s, " KEY_MIME_TEXT ";q=0.5",
+             result_format_content_type(client->format));
+    request_add_header(req, req->accept);
+  }
+  // 同一查询再次读取时请服务端确认缓存的结果是否仍然有效
+  if (is_read && read_cache_match(&client->last_read, table, where, client->format)) {
+    snprintf(req->condition, sizeof(req->condition), "If-None-Match: %s",
+             client->last_read.etag);
+    request_add_header(req, req->condition);
+    req->revalidate = true;
+  }
+  if (client->api_key_header) {
+    req->api_key_header = strdup(client->api_key_header);
+    if (!req->api_key_header) {
+      request_free(req);
+      return NULL;
+    }
+    request_add_header(req, req->api_key_header);
+  }
+  if (req->timeout_ms > 0) {
+    long deadline_ms = req->timeout_ms > 2 * HTTP_CLIENT_DEADLINE_MARGIN_MS
+                           ? req->timeout_ms - HTTP_CLIENT_DEADLINE_MARGIN_MS
+                           : req->timeout_ms;
+    snprintf(req->deadline, sizeof(req->deadline), KEY_HEADER_DEADLINE ": %ld", deadline_ms);
+    request_add_header(req, req->deadline);
+  }
+
+  if (is_read && table) {
+    req->table = strdup(table);
+    req->where = where ? strdup(where) : NULL;
+    if (!req->table || (where && !req->where)) {
+      request_free(req);
+      return NULL;
+    }
+  }
+  return req;
 }
 
 /**
- * @brief 通过 http 发起数据库 delete
+ * @brief 生成单个操作的请求体并创建请求
  *
- * @param client http client
- * @param table 表
- * @param where 条件
- * @param output 返回值
- * @return int 出错（-1）；成功（大于等于 0，含义为已生效的条目数）
+ * @return http_request_t* 请求；失败返回 NULL
  */
-int http_client_delete(http_client_t *client, const char *table, const char *where, char **output) {
-  return send_http_request(client, KEY_OP_DELETE, table, NULL, where, output);
+static http_request_t *request_create(http_client_t *client, const char *operation,
+                                      const char *table, const char *data, const char *where,
+                                      const db_params_t *params) {
+  strbuf_t post_data;
+  strbuf_init(&post_data);
+  if (build_request_body(client, &post_data, operation, table, data, where, params) != 0) {
+    LOG_ERROR("Failed to build POST data");
+    strbuf_free(&post_data);
+    return NULL;
+  }
+  // 参数化读取的结果取决于参数，不参与客户端的缓存
+  http_request_t *req = params ? request_new(client, operation, NULL, NULL, &post_data)
+                               : request_new(client, operation, table, where, &post_data);
+  strbuf_free(&post_data);
+  return req;
+}
+
+/**
+ * @brief 创建带读取参数的 READ 请求
+ *
+ * 选择的列、排序和行数不同，结果也不同：它们与条件一起作为缓存结果的键，与服务端的做法相同；
+ * 分页读取和参数化读取不带 If-None-Match，响应也不缓存
+ *
+ * @return http_request_t* 请求；失败返回 NULL
+ */
+static http_request_t *read_request_create(http_client_t *client, const char *table,
+                                           const char *where, const read_options_t *options) {
+  strbuf_t post_data, key;
+  strbuf_init(&post_data);
+  strbuf_init(&key);
+  bool cacheable = options->page_size == 0 && !options->params;
+  if (build_read_body(client, &post_data, table, where, options) != 0 ||
+      (cacheable &&
+       strbuf_appendf(&key, "%s\x1f%s\x1f%s\x1f%u", where ? where : "",
+                      options->columns ? options->columns : "",
+                      options->order_by ? options->order_by : "", options->limit) != 0)) {
+    LOG_ERROR("Failed to build POST data");
+    strbuf_free(&post_data);
+    strbuf_free(&key);
+    return NULL;
+  }
+  http_request_t *req = cacheable
+                            ? request_new(client, KEY_OP_READ, table, key.data, &post_data)
+                            : request_new(client, KEY_OP_READ, NULL, NULL, &post_data);
+  strbuf_free(&post_data);
+  strbuf_free(&key);
+  return req;
+}
+
+/**
+ * @brief 追加到链表尾部
+ */
+static void request_list_push(http_request_t **head, http_request_t **tail, http_request_t *req) {
+  req->next = NULL;
+  if (*tail) {
+    (*tail)->next = req;
+  } else {
+    *head = req;
+  }
+  *tail = req;
+}
+
+/**
+ * @brief 从链表中移除，tail 可以为 NULL
+ */
+static void request_list_remove(http_request_t **head, http_request_t **tail,
+                                http_request_t *req) {
+  http_request_t *prev = NULL;
+  for (http_request_t *it = *head; it; prev = it, it = it->next) {
+    if (it != req) {
+      continue;
+    }
+    if (prev) {
+      prev->next = it->next;
+    } else {
+      *head = it->next;
+    }
+    if (tail && *tail == req) {
+      *tail = prev;
+    }
+    req->next = NULL;
+    return;
+  }
+}
+
+/**
+ * @brief 归还请求占用的句柄，空闲句柄留给之后的异步请求
+ *
+ * @param client http client 对象
+ * @param req 请求
+ */
+static void request_release_handle(http_client_t *client, http_request_t *req) {
+  if (req->curl && req->curl != client->curl) {
+    if (client->num_idle < client->max_active) {
+      client->idle[client->num_idle++] = req->curl;
+    } else {
+      curl_easy_cleanup(req->curl);
+    }
+  }
+  req->curl = NULL;
+}
+
+/**
+ * @brief 开始请求：取一个句柄，设置本次请求的选项后交给 multi
+ *
+ * @param client http client 对象
+ * @param req 请求
+ * @return int 成功（0）；失败（-1）
+ */
+static int request_start(http_client_t *client, http_request_t *req) {
+  if (!req->curl) {
+    req->curl = client->num_idle > 0 ? client->idle[--client->num_idle] : easy_handle_new(client);
+    if (!req->curl) {
+      return -1;
+    }
+  }
+
+  CURL *curl = req->curl;
+  // 句柄在请求之间复用，地址和请求体的来源每次都要设置
+  curl_easy_setopt(curl, CURLOPT_URL, req->url ? req->url : client->base_url);
+  if (req->upload) {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, NULL);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, -1L);
+    curl_easy_setopt(curl, CURLOPT_READDATA, req->upload);
+  } else {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->body.data);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)req->body.len);
+  }
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &req->response);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->headers);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, req->timeout_ms);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, req);
+  if (curl_multi_add_handle(client->multi, curl) != CURLM_OK) {
+    request_release_handle(client, req);
+    return -1;
+  }
+  req->next = client->active;
+  client->active = req;
+  req->running = true;
+  ++client->num_active;
+  return 0;
+}
+
+/**
+ * @brief 检查响应并解析出单个操作的结果，READ 同时更新缓存；raw 请求只检查响应
+ *
+ * @param client http client 对象
+ * @param req 已结束的请求，句柄尚未归还
+ */
+static void request_complete(http_client_t *client, http_request_t *req) {
+  http_completion_t *completion = &req->completion;
+  response_buffer_t *response = &req->response;
+  completion->id = req->id;
+  completion->result = -1;
+  if (req->code != CURLE_OK) {
+    LOG_ERROR("HTTP request failed: %s", curl_easy_strerror(req->code));
+    return;
+  }
+
+  long status = 0;
+  curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE, &status);
+  bool not_modified = status == 304 && req->revalidate;
+  if (not_modified) {
+    free(response->data);
+    response->data = NULL;
+    response->size = 0;
+  } else if (!response->data) {
+    LOG_ERROR("Empty HTTP response");
+    return;
+  }
+  if (req->raw) {
+    LOG_DEBUG("Received HTTP response: %s", response->data);
+    completion->result = 0;
+    return;
+  }
+
+  const char *content_type = NULL;
+  curl_easy_getinfo(req->curl, CURLINFO_CONTENT_TYPE, &content_type);
+  bool is_rowset =
+      content_type && strncmp(content_type, KEY_MIME_ROWSET, strlen(KEY_MIME_ROWSET)) == 0;
+  http_read_cache_t *cache = &client->last_read;
+  if (not_modified) {
+    // 304：表没有写入，复用缓存的响应；并发的其他 READ 可能已经替换了缓存
+    if (!read_cache_match(cache, req->table, req->where, req->format)) {
+      LOG_ERROR("Cached response of %s was replaced before it could be reused", req->table);
+      return;
+    }
+    LOG_DEBUG("Read of %s not modified, reusing the cached response", req->table);
+    response->data = malloc(cache->size + 1);
+    if (!response->data) {
+      LOG_ERROR("Failed to allocate memory for HTTP response");
+      return;
+    }
+    memcpy(response->data, cache->body, cache->size + 1);
+    response->size = cache->size;
+    is_rowset = cache->rowset;
+    completion->cached = true;
+  } else if (req->table) {
+    struct curl_header *etag = NULL;
+    if (curl_easy_header(req->curl, "ETag", 0, CURLH_HEADER, -1, &etag) == CURLHE_OK) {
+      read_cache_store(cache, req->table, req->where, req->format, etag->value, response->data,
+                       response->size, is_rowset);
+    } else {
+      read_cache_clear(cache);
+    }
+  }
+
+  // 二进制结果集不是文本，不能按字符串处理
+  if (is_rowset) {
+    LOG_DEBUG("Received binary HTTP response: %zu bytes", response->size);
+    completion->result =
+        http_client_parse_rowset(response->data, response->size, &completion->output, req->rowset);
+  } else {
+    LOG_DEBUG("Received HTTP response: %s", response->data);
+    completion->result =
+        http_client_parse_response(req->operation, response->data, &completion->output);
+  }
+  free(response->data);
+  response->data = NULL;
+}
+
+/**
+ * @brief 请求结束：解析结果，归还句柄，然后交给等待者、回调或完成队列
+ *
+ * @param client http client 对象
+ * @param req 请求，已不在 multi 中
+ */
+static void request_finish(http_client_t *client, http_request_t *req) {
+  request_complete(client, req);
+  request_release_handle(client, req);
+  req->done = true;
+  if (req->sync) {
+    return;
+  }
+  if (req->callback) {
+    req->callback(&req->completion);
+    request_free(req);
+    return;
+  }
+  request_list_push(&client->done, &client->done_tail, req);
+}
+
+/**
+ * @brief 在上限内开始排队的请求
+ *
+ * @param client http client 对象
+ */
+static void start_queued(http_client_t *client) {
+  while (client->queued && client->num_active < client->max_active) {
+    http_request_t *req = client->queued;
+    request_list_remove(&client->queued, &client->queued_tail, req);
+    if (request_start(client, req) != 0) {
+      LOG_ERROR("Failed to start HTTP request %" PRIu64, req->id);
+      req->code = CURLE_FAILED_INIT;
+      request_finish(client, req);
+    }
+  }
+}
+
+/**
+ * @brief 取出 multi 中已结束的请求
+ *
+ * @param client http client 对象
+ * @return size_t 结束的请求数
+ */
+static size_t collect_finished(http_client_t *client) {
+  size_t finished = 0;
+  CURLMsg *msg;
+  int left;
+  while ((msg = curl_multi_info_read(client->multi, &left))) {
+    if (msg->msg != CURLMSG_DONE) {
+      continue;
+    }
+    char *priv = NULL;
+    curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+    http_request_t *req = (http_request_t *)priv;
+    req->code = msg->data.result;
+    curl_multi_remove_handle(client->multi, req->curl);
+    request_list_remove(&client->active, NULL, req);
+    req->running = false;
+    --client->num_active;
+    request_finish(client, req);
+    ++finished;
+  }
+  return finished;
+}
+
+/**
+ * @brief 推进所有请求：开始排队的请求，收发数据；没有请求结束时最多等待 timeout_ms
+ *
+ * @param client http client 对象
+ * @param timeout_ms 最长等待时间，0 表示不等待
+ * @return int 成功（0）；失败（-1）
+ */
+static int client_drive(http_client_t *client, long timeout_ms) {
+  start_queued(client);
+  int running = 0;
+  CURLMcode mc = curl_multi_perform(client->multi, &running);
+  size_t finished = mc == CURLM_OK ? collect_finished(client) : 0;
+  if (mc == CURLM_OK && finished == 0 && client->num_active > 0 && timeout_ms > 0) {
+    mc = curl_multi_poll(client->multi, NULL, 0, (int)timeout_ms, NULL);
+    if (mc == CURLM_OK) {
+      mc = curl_multi_perform(client->multi, &running);
+    }
+    if (mc == CURLM_OK) {
+      collect_finished(client);
+    }
+  }
+  if (mc != CURLM_OK) {
+    LOG_ERROR("HTTP multi request failed: %s", curl_multi_strerror(mc));
+    return -1;
+  }
+  // 腾出的名额马上给排队的请求，下一次推进时就能收发
+  start_queued(client);
+  return 0;
+}
+
+/**
+ * @brief 丢弃一个未结束的请求
+ *
+ * @param client http client 对象
+ * @param req 请求
+ */
+static void request_abort(http_client_t *client, http_request_t *req) {
+  if (!req->done) {
+    if (req->running) {
+      curl_multi_remove_handle(client->multi, req->curl);
+      request_list_remove(&client->active, NULL, req);
+      --client->num_active;
+    } else {
+      request_list_remove(&client->queued, &client->queued_tail, req);
+    }
+    request_release_handle(client, req);
+  }
+  request_free(req);
+}
+
+/**
+ * @brief 同步执行请求：和异步请求一起排队，推进到它结束为止
+ *
+ * @param client http client 对象
+ * @param req 请求，成功时由调用者读取结果后释放
+ * @return int 成功（0）；失败（-1，请求已释放）
+ */
+static int request_wait(http_client_t *client, http_request_t *req) {
+  req->sync = true;
+  // 同步请求固定使用 client->curl，结束后还能从它读取响应头和耗时
+  req->curl = client->curl;
+  request_list_push(&client->queued, &client->queued_tail, req);
+  while (!req->done) {
+    if (client_drive(client, SYNC_WAIT_SLICE_MS) != 0) {
+      request_abort(client, req);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief 设置同时进行的请求数上限，同时决定保持的连接数
+ *
+ * @param client http client 对象
+ * @param max_active 上限，至少为 1
+ * @return int 成功（0）；失败（-1）
+ */
+int http_client_set_max_active(http_client_t *client, size_t max_active) {
+  if (!client || max_active == 0) {
+    return -1;
+  }
+  while (client->num_idle > max_active) {
+    curl_easy_cleanup(client->idle[--client->num_idle]);
+  }
+  CURL **idle = realloc(client->idle, max_active * sizeof(CURL *));
+  if (!idle) {
+    LOG_ERROR("Failed to allocate memory for HTTP handles");
+    return -1;
+  }
+  client->idle = idle;
+  client->max_active = max_active;
+  // 每个进行中的请求占一个连接，结束后连接保持，供之后的请求复用
+  curl_multi_setopt(client->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)max_active);
+  curl_multi_setopt(client->multi, CURLMOPT_MAXCONNECTS, (long)max_active);
+  return 0;
+}
+
+/**
+ * @brief 提交一个异步的 create、read、update 或 delete，不等待结果
+ *
+ * 请求在 http_client_poll()、http_client_receive() 或同步接口中推进，超过上限时排队。
+ * 设置了回调时，结果交给回调；否则由 http_client_receive() 取走。回调中可以提交新的请求，
+ * 但不能调用同步接口、http_client_poll() 或 http_client_receive()
+ *
+ * @param client http client
+ * @param operation 操作类型
+ * @param table 表
+ * @param data 数据，可以为 NULL
+ * @param where 条件，可以为 NULL
+ * @param callback 完成回调，可以为 NULL
+ * @param userdata 原样放入结果
+ * @param id 输出请求 ID，可以为 NULL
+ * @return int 成功（0）；失败（-1）
+ */
+int http_client_submit(http_client_t *client, const char *operation, const char *table,
+                       const char *data, const char *where, http_client_callback_t callback,
+                       void *userdata, uint64_t *id) {
+  static const char *const operations[] = {KEY_OP_CREATE, KEY_OP_READ, KEY_OP_UPDATE,
+                                           KEY_OP_DELETE};
+  if (!client || !client->multi || !operation) {
+    return -1;
+  }
+  const char *op = NULL;
+  for (size_t i = 0; !op && i < sizeof(operations) / sizeof(operations[0]); ++i) {
+    if (strcmp(operation, operations[i]) == 0) {
+      op = operations[i];
+    }
+  }
+  if (!op) {
+    LOG_ERROR("Unsupported asynchronous operation: %s", operation);
+    return -1;
+  }
+
+  http_request_t *req = request_create(client, op, table, data, where, NULL);
+  if (!req) {
+    return -1;
+  }
+  req->callback = callback;
+  req->completion.userdata = userdata;
+  request_list_push(&client->queued, &client->queued_tail, req);
+  if (id) {
+    *id = req->id;
+  }
+  return 0;
+}
+
+/**
+ * @brief 推进异步请求，调用已完成请求的回调；没有请求完成时最多等待 timeout_ms
+ *
+ * @param client http client
+ * @param timeout_ms 最长等待时间，0 表示不等待
+ * @return int 出错（-1）；成功（尚未完成的请求数）
+ */
+int http_client_poll(http_client_t *client, long timeout_ms) {
+  if (!client || !client->multi || client_drive(client, timeout_ms) != 0) {
+    return -1;
+  }
+  size_t pending = client->num_active;
+  for (http_request_t *req = client->queued; req; req = req->next) {
+    ++pending;
+  }
+  return (int)pending;
+}
+
+/**
+ * @brief 取走一个已完成、没有设置回调的异步请求的结果，没有时推进请求，最多等待 timeout_ms
+ *
+ * @param client http client
+ * @param timeout_ms 最长等待时间，0 表示不等待
+ * @param completion 输出结果，output 由调用者释放
+ * @return int 出错（-1）；超时或没有未完成的请求（0）；取到结果（1）
+ */
+int http_client_receive(http_client_t *client, long timeout_ms, http_completion_t *completion) {
+  if (!client || !client->multi || !completion) {
+    return -1;
+  }
+  uint64_t deadline_us = clock_now_us() + (uint64_t)timeout_ms * 1000;
+  while (!client->done && (client->queued || client->active)) {
+    uint64_t now_us = clock_now_us();
+    long wait_ms = now_us < deadline_us ? (long)((deadline_us - now_us + 999) / 1000) : 0;
+    if (client_drive(client, wait_ms) != 0) {
+      return -1;
+    }
+    if (wait_ms == 0) {
+      break;
+    }
+  }
+
+  http_request_t *req = client->done;
+  if (!req) {
+    return 0;
+  }
+  request_list_remove(&client->done, &client->done_tail, req);
+  *completion = req->completion;
+  req->completion.output = NULL;
+  request_free(req);
+  return 1;
+}
+
+/**
+ * @brief 释放链表中的所有请求
+ */
+static void request_list_free(http_request_t *req) {
+  while (req) {
+    http_request_t *next = req->next;
+    request_free(req);
+    req = next;
+  }
+}
+
+/**
+ * @brief 销毁 http client，未完成的请求直接丢弃，不调用回调
+ *
+ * @param client 对象
+ */
+void http_client_cleanup(http_client_t *client) {
+  if (client) {
+    for (http_request_t *req = client->active; req; req = req->next) {
+      curl_multi_remove_handle(client->multi, req->curl);
+      request_release_handle(client, req);
+    }
+    request_list_free(client->active);
+    request_list_free(client->queued);
+    request_list_free(client->done);
+    while (client->num_idle > 0) {
+      curl_easy_cleanup(client->idle[--client->num_idle]);
+    }
+    free(client->idle);
+    read_cache_clear(&client->last_read);
+    if (client->curl) {
+      curl_easy_cleanup(client->curl);
+    }
+    if (client->multi) {
+      curl_multi_cleanup(client->multi);
+    }
+    free(client->base_url);
+    free(client->unix_socket);
+    free(client->api_key_header);
+    free(client);
+  }
+}
+
+/**
+ * @brief 同步执行请求并取出结果，请求随后释放
+ *
+ * @param client http client 对象
+ * @param req 请求
+ * @param output 输出（仅 READ 操作使用）
+ * @return int 出错返回 -1，成功返回值大于等于 0
+ */
+static int request_run(http_client_t *client, http_request_t *req, char **output) {
+  bool is_read = strcmp(req->operation, KEY_OP_READ) == 0;
+  if (is_read) {
+    client->last_read_cached = false;
+  }
+  if (request_wait(client, req) != 0) {
+    return -1;
+  }
+
+  if (is_read) {
+    client->last_read_cached = req->completion.cached;
+  }
+  int result = req->completion.result;
+  if (output) {
+    *output = req->completion.output;
+    req->completion.output = NULL;
+  }
+  request_free(req);
+  return result;
+}
+
+/**
+ * @brief 发送 http 请求
+ *
+ * @param client http client 对象
+ * @param operation 操作类型
+ * @param table 表
+ * @param data 数据
+ * @param where 条件
+ * @param output 输出（仅 READ 操作使用）
+ * @param rowset 不为 NULL 时，二进制结果集解码后直接交给调用者，不再渲染成文本
+ * @return int 出错返回 -1，成功返回值大于等于 0
+ */
+static int send_http_request(http_client_t *client, const char *operation, const char *table,
+                             const char *data, const char *where, char **output,
+                             rowset_t **rowset) {
+  if (!client || !client->curl) {
+    return -1;
+  }
+
+  http_request_t *req = request_create(client, operation, table, data, where, NULL);
+  if (!req) {
+    return -1;
+  }
+  req->rowset = rowset;
+  return request_run(client, req, output);
+}
+
+/**
+ * @brief 通过 http 发起数据库 create
+ *
+ * @param client http client
+ * @param table 表
+ * @param data 数据
+ * @param output 返回值
+ * @return int 出错（-1）；成功（大于等于 0，含义为已生效的条目数）
+ */
+int http_client_create(http_client_t *client, const char *table, const char *data, char **output) {
+  return send_http_request(client, KEY_OP_CREATE, table, data, NULL, output, NULL);
+}
+
+/**
+ * @brief 通过 http 发起数据库 read
+ *
+ * @param client http client
+ * @param table 表
+ * @param where 条件
+ * @param options 读取参数，可以为 NULL：只返回的列、排序和行数上限，由服务端写进查询语句；
+ * 条件中 '?' 的参数；分页请使用 http_client_read_page()
+ * @param output 返回值
+ * @return int 出错（-1）；成功（1）
+ */
+int http_client_read(http_client_t *client, const char *table, const char *where,
+                     const read_options_t *options, char **output) {
+  if (!options ||
+      (!options->columns && !options->order_by && options->limit == 0 && !options->params)) {
+    return send_http_request(client, KEY_OP_READ, table, NULL, where, output, NULL);
+  }
+  if (!client || !client->curl || options->page_size > 0) {
+    return -1;
+  }
+  http_request_t *req = read_request_create(client, table, where, options);
+  return req ? request_run(client, req, output) : -1;
+}
+
+/**
+ * @brief 通过 http 分页读取：每次一页，以返回的续读令牌读取下一页，直到令牌为 NULL
+ *
+ * 每页都从上一页最后一行的主键之后开始，翻到多深代价都与第一页相同；分页读取不带
+ * If-None-Match，响应也不缓存
+ *
+ * @param client http client
+ * @param table 表
+ * @param where 条件，各页必须相同
+ * @param options 读取参数，page_size 大于 0，page_token 为 NULL 表示第一页
+ * @param output 返回值
+ * @param next_page 输出下一页的续读令牌，最后一页为 NULL，使用完毕后 free()
+ * @return int 出错（-1）；成功（1）
+ */
+int http_client_read_page(http_client_t *client, const char *table, const char *where,
+                          const read_options_t *options, char **output, char **next_page) {
+  if (!client || !client->curl || !options || options->page_size == 0 || !next_page) {
+    return -1;
+  }
+  *next_page = NULL;
+
+  http_request_t *req = read_request_create(client, table, where, options);
+  if (!req) {
+    return -1;
+  }
+  int result = request_run(client, req, output);
+
+  // 同步请求使用 client->curl，响应头在下一个同步请求之前一直可读
+  struct curl_header *header = NULL;
+  if (result > 0 && curl_easy_header(client->curl, KEY_HEADER_NEXT_PAGE, 0, CURLH_HEADER, -1,
+                                     &header) == CURLHE_OK) {
+    *next_page = strdup(header->value);
+    if (!*next_page) {
+      LOG_ERROR("Failed to allocate memory for page token");
+      return -1;
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief 通过 http 发起数据库 update
+ *
+ * @param client http client
+ * @param table 表
+ * @param data 数据
+ * @param where 条件
+ * @param output 返回值
+ * @return int 出错（-1）；成功（大于等于 0，含义为已生效的条目数）
+ */
+int http_client_update(http_client_t *client, const char *table, const char *data,
+                       const char *where, char **output) {
+  return send_http_request(client, KEY_OP_UPDATE, table, data, where, output, NULL);
+}
+
+/**
+ * @brief 通过 http 发起数据库 delete
+ *
+ * @param client http client
+ * @param table 表
+ * @param where 条件
+ * @param output 返回值
+ * @return int 出错（-1）；成功（大于等于 0，含义为已生效的条目数）
+ */
+int http_client_delete(http_client_t *client, const char *table, const char *where, char **output) {
+  return send_http_request(client, KEY_OP_DELETE, table, NULL, where, output, NULL);
+}
+
+/**
+ * @brief 通过 http 发起参数化操作：data 和 where 中的 '?' 依次取 params 中的值
+ *
+ * 值不拼进语句，服务端以预处理语句执行，同样形状的语句在连接上只准备一次；结果不参与客户端的缓存
+ *
+ * @param client http client
+ * @param operation 操作类型
+ * @param table 表
+ * @param data 数据，可以为 NULL
+ * @param where 条件，可以为 NULL
+ * @param params 参数
+ * @param output 返回值
+ * @return int 出错（-1）；成功（大于等于 0，含义与对应的操作相同）
+ */
+int http_client_execute(http_client_t *client, const char *operation, const char *table,
+                        const char *data, const char *where, const db_params_t *params,
+                        char **output) {
+  if (!client || !client->curl || !operation || !params) {
+    return -1;
+  }
+  if (strcmp(operation, KEY_OP_READ) == 0) {
+    read_options_t options = {.params = params};
+    return http_client_read(client, table, where, &options, output);
+  }
+  http_request_t *req = request_create(client, operation, table, data, where, params);
+  return req ? request_run(client, req, output) : -1;
+}
+
+/**
+ * @brief 通过 http 批量写入：文件中的行作为请求体流式上传，服务端边接收边写入
+ *
+ * 操作和表放在 URL 的查询参数中；请求体的长度不必事先知道，以 chunked 编码发送。上传时间随
+ * 文件大小增长，请求不设超时
+ *
+ * @param client http client
+ * @param table 表
+ * @param format 行的格式，CSV 首行为列名
+ * @param rows 行所在的文件，从当前位置读到文件结尾
+ * @param output 服务端的汇总，之后每行一个出错的行或批次
+ * @return int 出错（-1，output 中有原因）；成功（写入的行数）
+ */
+int http_client_bulk_create(http_client_t *client, const char *table, bulk_format_t format,
+                            FILE *rows, char **output) {
+  if (!client || !client->curl || !table || !rows || !output) {
+    return -1;
+  }
+  *output = NULL;
+
+  strbuf_t url, body;
+  strbuf_init(&url);
+  strbuf_init(&body);
+  if (strbuf_appendf(&url, "%s?" KEY_POST_OPERATION "=" KEY_OP_BULK_CREATE "&" KEY_POST_TABLE "=",
+                     client->base_url) != 0 ||
+      url_encode_append(&url, table, strlen(table)) != 0) {
+    LOG_ERROR("Failed to allocate memory for request URL");
+    strbuf_free(&url);
+    return -1;
+  }
+
+  long timeout_ms = client->timeout_ms;
+  http_client_set_timeout(client, 0);
+  http_request_t *req = request_new(client, KEY_OP_BULK_CREATE, NULL, NULL, &body);
+  http_client_set_timeout(client, timeout_ms);
+  if (!req) {
+    strbuf_free(&url);
+    return -1;
+  }
+  // request_new() 的第一个请求头总是 Content-Type
+  req->headers[0].data = format == BULK_FORMAT_CSV ? "Content-Type: " KEY_MIME_CSV
+                                                   : "Content-Type: " KEY_MIME_NDJSON;
+  request_add_header(req, "Transfer-Encoding: chunked");
+  req->url = strbuf_detach(&url);
+  req->upload = rows;
+  req->raw = true;
+  if (request_wait(client, req) != 0) {
+    return -1;
+  }
+
+  int result = req->completion.result;
+  const char *data = req->response.data;
+  size_t len_success = strlen(KEY_RESP_SUCCESS);
+  if (result == 0 && strncmp(data, KEY_RESP_SUCCESS, len_success) == 0) {
+    const char *inserted = strstr(data, "Inserted ");
+    result = inserted ? atoi(inserted + strlen("Inserted ")) : 0;
+    *output = strdup(data + len_success);
+  } else {
+    if (result == 0) {
+      size_t len_fail = strlen(KEY_RESP_ERROR);
+      *output = strdup(strncmp(data, KEY_RESP_ERROR, len_fail) == 0 ? data + len_fail : data);
+    }
+    result = -1;
+  }
+  request_free(req);
+  return result;
+}
+
+/**
+ * @brief 通过 http 发起数据库 read，以二进制格式接收并返回带类型的结果集
+ *
+ * @param client http client
+ * @param table 表
+ * @param where 条件
+ * @param rowset 结果集，使用完毕后调用 rowset_free() 释放
+ * @param output 出错时的错误信息
+ * @return int 出错（-1）；成功（1）；服务端未返回二进制格式（0，文本结果保存在 output）
+ */
+int http_client_read_rowset(http_client_t *client, const char *table, const char *where,
+                            rowset_t **rowset, char **output) {
+  if (!client || !rowset) {
+    return -1;
+  }
+
+  *rowset = NULL;
+  result_format_t format = client->format;
+  client->format = RESULT_FORMAT_ROWSET;
+  int result = send_http_request(client, KEY_OP_READ, table, NULL, where, output, rowset);
+  client->format = format;
+  if (result > 0 && !*rowset) {
+    // 服务端不支持二进制格式，退回到文本
+    return 0;
+  }
+  return result;
+}
+
+/**
+ * @brief 解析批量响应中的各个条目（item <序号> <长度>\n<响应>\n）
+ *
+ * @param body 去掉首行之后的响应
+ * @param end 响应结尾
+ * @param items 请求的条目
+ * @param num_items 条目数量
+ * @param results 输出各条目的结果
+ * @return size_t 解析出的条目数
+ */
+static size_t parse_batch_items(const char *body, const char *end, const http_batch_item_t *items,
+                                size_t num_items, http_batch_result_t *results) {
+  size_t parsed = 0;
+  while (body < end) {
+    size_t index, len;
+    int header_len;
+    header_len = 0;
+    if (sscanf(body, KEY_RESP_ITEM " %zu %zu%n", &index, &len, &header_len) != 2 ||
+        body[header_len] != '\n' || index == 0 || index > num_items ||
+        (size_t)(end - body - header_len - 1) < len) {
+      LOG_ERROR("Malformed batch response item");
+      break;
+    }
+    body += header_len + 1;
+
+    char *payload = strndup(body, len);
+    if (!payload) {
+      break;
+    }
+    http_batch_result_t *result = &results[index - 1];
+    result->result =
+        http_client_parse_response(items[index - 1].operation, payload, &result->output);
+    free(payload);
+
+    body += len;
+    if (body < end && *body == '\n') {
+      ++body;
+    }
+    ++parsed;
+  }
+  return parsed;
+}
+
+/**
+ * @brief 解析批量响应，二进制协议客户端也使用
+ *
+ * @param data 响应数据，以 '\0' 结尾，解析时会被修改
+ * @param size 响应长度
+ * @param items 请求的条目
+ * @param num_items 条目数量
+ * @param results 输出各条目的结果，调用前已初始化为未执行
+ * @param output 批量执行的汇总信息
+ * @return int 出错（-1）；成功（解析出的条目数）
+ */
+int http_client_parse_batch(char *data, size_t size, const http_batch_item_t *items,
+                            size_t num_items, http_batch_result_t *results, char **output) {
+  // 首行是汇总信息，之后是各条目
+  char *body = strchr(data, '\n');
+  char *end = data + size;
+  if (body) {
+    *body++ = '\0';
+  }
+  int result = http_client_parse_response(KEY_OP_BATCH, data, output);
+  size_t parsed = body ? parse_batch_items(body, end, items, num_items, results) : 0;
+  if (result >= 0) {
+    result = (int)parsed;
+  }
+  return result;
+}
+
+/**
+ * @brief 生成表单编码的批量请求体
+ *
+ * @param post_data 输出请求体
+ * @param items 操作列表
+ * @param num_items 操作数量
+ * @param transaction 是否在同一个事务中执行
+ * @return int 成功（0）；失败（-1）
+ */
+static int build_batch_form(strbuf_t *post_data, const http_batch_item_t *items, size_t num_items,
+                            bool transaction) {
+  int rc = append_post_field(post_data, KEY_POST_OPERATION, KEY_OP_BATCH) ||
+           append_post_field(post_data, KEY_POST_TRANSACTION, transaction ? "1" : NULL);
+  for (size_t i = 0; rc == 0 && i < num_items; ++i) {
+    // item_operation 必须在前，服务端据此开始一个新条目
+    rc = append_post_field(post_data, KEY_POST_ITEM_OPERATION, items[i].operation) ||
+         append_post_field(post_data, KEY_POST_ITEM_TABLE, items[i].table) ||
+         append_post_field(post_data, KEY_POST_ITEM_DATA, items[i].data) ||
+         append_post_field(post_data, KEY_POST_ITEM_WHERE, items[i].where);
+  }
+  return rc;
+}
+
+/**
+ * @brief 生成 JSON 批量请求体，条目放在 items 数组中
+ *
+ * @param body 输出请求体
+ * @param items 操作列表
+ * @param num_items 操作数量
+ * @param transaction 是否在同一个事务中执行
+ * @return int 成功（0）；失败（-1）
+ */
+static int build_batch_json(strbuf_t *body, const http_batch_item_t *items, size_t num_items,
+                            bool transaction) {
+  int rc = strbuf_appendf(body, "{\"%s\":\"%s\",\"%s\":%s,\"%s\":[", KEY_POST_OPERATION,
+                          KEY_OP_BATCH, KEY_POST_TRANSACTION, transaction ? "true" : "false",
+                          KEY_JSON_ITEMS);
+  for (size_t i = 0; rc == 0 && i < num_items; ++i) {
+    rc = (i > 0 && strbuf_append_char(body, ',') != 0) || strbuf_append_char(body, '{') ||
+         append_json_field(body, KEY_POST_OPERATION, items[i].operation) ||
+         append_json_field(body, KEY_POST_TABLE, items[i].table) ||
+         append_json_field(body, KEY_POST_DATA, items[i].data) ||
+         append_json_field(body, KEY_POST_WHERE, items[i].where) || strbuf_append_char(body, '}');
+  }
+  return rc || strbuf_append_str(body, "]}");
+}
+
+/**
+ * @brief 通过 http 在一个请求中按顺序发起多个数据库操作，服务端在同一个连接上执行
+ *
+ * @param client http client
+ * @param items 操作列表
+ * @param num_items 操作数量
+ * @param transaction 是否在同一个事务中执行（任一失败则全部回滚）
+ * @param results 输出各操作的结果，未执行的操作 result 为 -1、output 为 NULL；
+ *                使用完毕后调用 http_batch_results_free() 释放
+ * @param output 批量执行的汇总信息
+ * @return int 出错（-1，事务模式下表示已回滚）；成功（已执行的操作数）
+ */
+int http_client_batch(http_client_t *client, const http_batch_item_t *items, size_t num_items,
+                      bool transaction, http_batch_result_t *results, char **output) {
+  if (!client || !client->curl || !items || !results || num_items == 0) {
+    return -1;
+  }
+
+  for (size_t i = 0; i < num_items; ++i) {
+    if (!items[i].operation) {
+      LOG_ERROR("Batch item %zu has no operation", i + 1);
+      return -1;
+    }
+    results[i].result = -1;
+    results[i].output = NULL;
+  }
+
+  strbuf_t post_data;
+  strbuf_init(&post_data);
+  int rc = client->json_body ? build_batch_json(&post_data, items, num_items, transaction)
+                             : build_batch_form(&post_data, items, num_items, transaction);
+  if (rc != 0) {
+    LOG_ERROR("Failed to allocate memory for POST data");
+    strbuf_free(&post_data);
+    return -1;
+  }
+
+  http_request_t *req = request_new(client, KEY_OP_BATCH, NULL, NULL, &post_data);
+  strbuf_free(&post_data);
+  if (!req) {
+    return -1;
+  }
+  req->raw = true;
+  if (request_wait(client, req) != 0) {
+    return -1;
+  }
+  int result = req->completion.result;
+  if (result == 0) {
+    result = http_client_parse_batch(req->response.data, req->response.size, items, num_items,
+                                     results, output);
+  }
+  request_free(req);
+  return result;
+}
+
+/**
+ * @brief 拆分变更订阅的响应：前面每行一个变更，最后一行为 {"cursor":"..."}
+ *
+ * @param data 响应
+ * @param events 输出变更
+ * @param next_cursor 输出游标
+ * @return int 出错（-1）；成功（变更数）
+ */
+static int parse_watch_response(const char *data, char **events, char **next_cursor) {
+  static const char prefix[] = "{\"" KEY_POST_CURSOR "\":\"";
+  size_t len = strlen(data);
+  while (len > 0 && data[len - 1] == '\n') {
+    --len;
+  }
+  size_t last = len;
+  while (last > 0 && data[last - 1] != '\n') {
+    --last;
+  }
+  size_t prefix_len = sizeof(prefix) - 1;
+  if (len - last < prefix_len + 2 || strncmp(data + last, prefix, prefix_len) != 0 ||
+      strncmp(data + len - 2, "\"}", 2) != 0) {
+    LOG_ERROR("Malformed watch response: %s", data);
+    return -1;
+  }
+
+  *events = strndup(data, last);
+  *next_cursor = strndup(data + last + prefix_len, len - 2 - last - prefix_len);
+  if (!*events || !*next_cursor) {
+    free(*events);
+    free(*next_cursor);
+    *events = NULL;
+    *next_cursor = NULL;
+    return -1;
+  }
+  int count = 0;
+  for (size_t i = 0; i < last; ++i) {
+    count += data[i] == '\n';
+  }
+  return count;
+}
+
+/**
+ * @brief 长轮询一张表的行变更
+ *
+ * 服务端有变更时立即返回，没有时最多等待约 30 秒后返回新的游标；请求期间使用
+ * HTTP_CLIENT_WATCH_TIMEOUT_MS 超时。下一次以返回的游标继续，变更不会重复也不会遗漏
+ *
+ * @param client http client
+ * @param table 表
+ * @param cursor 上次返回的游标，NULL 表示从当前位置开始
+ * @param events 输出变更，每行一个 JSON 对象；出错时为错误信息
+ * @param next_cursor 成功时输出新的游标
+ * @return int 出错（-1）；成功（变更数）
+ */
+int http_client_watch(http_client_t *client, const char *table, const char *cursor, char **events,
+                      char **next_cursor) {
+  if (!client || !client->curl || !table || !events || !next_cursor) {
+    return -1;
+  }
+  *events = NULL;
+  *next_cursor = NULL;
+
+  strbuf_t post_data;
+  strbuf_init(&post_data);
+  int rc;
+  if (client->json_body) {
+    rc = strbuf_append_char(&post_data, '{') ||
+         append_json_field(&post_data, KEY_POST_OPERATION, KEY_OP_WATCH) ||
+         append_json_field(&post_data, KEY_POST_TABLE, table) ||
+         append_json_field(&post_data, KEY_POST_CURSOR, cursor) ||
+         strbuf_append_char(&post_data, '}');
+  } else {
+    rc = append_post_field(&post_data, KEY_POST_OPERATION, KEY_OP_WATCH) ||
+         append_post_field(&post_data, KEY_POST_TABLE, table) ||
+         append_post_field(&post_data, KEY_POST_CURSOR, cursor);
+  }
+  if (rc != 0) {
+    LOG_ERROR("Failed to allocate memory for POST data");
+    strbuf_free(&post_data);
+    return -1;
+  }
+
+  // 请求创建时取用超时设置，之后恢复
+  long timeout_ms = client->timeout_ms;
+  if (timeout_ms > 0 && timeout_ms < HTTP_CLIENT_WATCH_TIMEOUT_MS) {
+    http_client_set_timeout(client, HTTP_CLIENT_WATCH_TIMEOUT_MS);
+  }
+  http_request_t *req = request_new(client, KEY_OP_WATCH, table, NULL, &post_data);
+  http_client_set_timeout(client, timeout_ms);
+  strbuf_free(&post_data);
+  if (!req) {
+    return -1;
+  }
+  req->raw = true;
+  if (request_wait(client, req) != 0) {
+    return -1;
+  }
+
+  int result = req->completion.result;
+  size_t len_fail = strlen(KEY_RESP_ERROR);
+  if (result != 0) {
+    result = -1;
+  } else if (strncmp(req->response.data, KEY_RESP_ERROR, len_fail) == 0) {
+    *events = strdup(req->response.data + len_fail);
+    result = -1;
+  } else {
+    result = parse_watch_response(req->response.data, events, next_cursor);
+  }
+  request_free(req);
+  return result;
+}
+
+/**
+ * @brief 释放批量请求的结果
+ *
+ * @param results 结果
+ * @param num_items 条目数量
+ */
+void http_batch_results_free(http_batch_result_t *results, size_t num_items) {
+  if (!results) {
+    return;
+  }
+  for (size_t i = 0; i < num_items; ++i) {
+    free(results[i].output);
+    results[i].output = NULL;
+  }
 }
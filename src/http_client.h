@@ -1,18 +1,123 @@
 #pragma once
 
 // clang-format off
+#include <stdbool.h>
+#include <stdio.h>
 #include "curl/curl.h"
+#include "src/bulk_load.h"
+#include "src/read_options.h"
+#include "src/result_encoder.h"
+#include "src/rowset.h"
+#include "src/trace.h"
 // clang-format on
 
+// 默认的请求超时
+#define HTTP_CLIENT_DEFAULT_TIMEOUT_MS 10000
+// 告知服务端的截止时间比客户端超时早这么多，让超时的错误响应赶在客户端放弃之前到达
+#define HTTP_CLIENT_DEADLINE_MARGIN_MS 50
+// 变更订阅的请求超时，长于服务端一次长轮询的最长时间
+#define HTTP_CLIENT_WATCH_TIMEOUT_MS 35000
+
+// 同时进行的请求数上限的默认值
+#define HTTP_CLIENT_DEFAULT_MAX_ACTIVE 8
+
+// 最近一次带 ETag 的 READ 响应；同一查询再次读取时带上 If-None-Match，服务端应答 304 时直接复用
+typedef struct {
+  char *table;
+  char *where;
+  result_format_t format;
+  char *etag;
+  char *body;
+  size_t size;
+  bool rowset; // 响应体是二进制结果集
+} http_read_cache_t;
+
+struct http_request;
+
 typedef struct {
-  CURL *curl;
+  CURL *curl;             // 同步请求的句柄，保留最近一次同步请求的响应头和耗时
+  CURLM *multi;           // 执行同步和异步请求，连接在请求之间保持复用
   char *base_url;
+  char *unix_socket;      // Unix 域套接字路径，NULL 表示 TCP
+  result_format_t format; // READ 操作请求的结果集编码格式
+  bool json_body;         // 以 application/json 而不是表单编码发送请求体
+  long timeout_ms;        // 请求超时，同时作为截止时间告知服务端，0 表示不限时
+  char *api_key_header;   // X-Api-Key 请求头，服务端按它而不是对端地址计算配额，NULL 表示不发送
+  http_read_cache_t last_read;
+  bool last_read_cached; // 最近一次 READ 是由 304 复用的缓存
+  size_t max_active;     // 同时进行的请求数上限，超出的请求排队
+  size_t num_active;
+  CURL **idle;           // 空闲的异步请求句柄，最多 max_active 个
+  size_t num_idle;
+  struct http_request *queued; // 等待开始的请求
+  struct http_request *queued_tail;
+  struct http_request *active; // 正在进行的请求
+  struct http_request *done;   // 已完成、没有回调、等待 http_client_receive() 取走的请求
+  struct http_request *done_tail;
+  uint64_t next_id;
 } http_client_t;
 
+// 异步请求的结果
+typedef struct {
+  uint64_t id;
+  int result;     // 含义与对应的同步接口相同
+  char *output;   // 同步接口的 output；由回调得到时，回调返回后释放，要保留就取走并置为 NULL
+  bool cached;    // READ 由 304 复用了缓存的响应
+  void *userdata; // 提交时传入
+} http_completion_t;
+
+// 异步请求完成时在 http_client_poll() 或 http_client_receive() 中调用
+typedef void (*http_client_callback_t)(http_completion_t *completion);
+
+// 批量请求中的一个操作
+typedef struct {
+  const char *operation;
+  const char *table;
+  const char *data;
+  const char *where;
+} http_batch_item_t;
+
+// 批量请求中一个操作的结果，含义与对应的单个操作接口相同
+typedef struct {
+  int result;
+  char *output;
+} http_batch_result_t;
+
 http_client_t *http_client_init(const char *base_url);
 void http_client_cleanup(http_client_t *client);
+void http_client_set_format(http_client_t *client, result_format_t format);
+void http_client_set_json_body(http_client_t *client, bool json_body);
+void http_client_set_timeout(http_client_t *client, long timeout_ms);
+int http_client_set_api_key(http_client_t *client, const char *api_key);
+int http_client_last_timing(http_client_t *client, trace_t *trace, uint64_t *total_us);
+bool http_client_last_read_cached(http_client_t *client);
+int http_client_set_max_active(http_client_t *client, size_t max_active);
+int http_client_submit(http_client_t *client, const char *operation, const char *table,
+                       const char *data, const char *where, http_client_callback_t callback,
+                       void *userdata, uint64_t *id);
+int http_client_poll(http_client_t *client, long timeout_ms);
+int http_client_receive(http_client_t *client, long timeout_ms, http_completion_t *completion);
 int http_client_create(http_client_t *client, const char *table, const char *data, char **output);
-int http_client_read(http_client_t *client, const char *table, const char *where, char **output);
+int http_client_read(http_client_t *client, const char *table, const char *where,
+                     const read_options_t *options, char **output);
+int http_client_read_page(http_client_t *client, const char *table, const char *where,
+                          const read_options_t *options, char **output, char **next_page);
+int http_client_bulk_create(http_client_t *client, const char *table, bulk_format_t format,
+                            FILE *rows, char **output);
+int http_client_read_rowset(http_client_t *client, const char *table, const char *where,
+                            rowset_t **rowset, char **output);
 int http_client_update(http_client_t *client, const char *table, const char *data,
                        const char *where, char **output);
 int http_client_delete(http_client_t *client, const char *table, const char *where, char **output);
+int http_client_execute(http_client_t *client, const char *operation, const char *table,
+                        const char *data, const char *where, const db_params_t *params,
+                        char **output);
+int http_client_batch(http_client_t *client, const http_batch_item_t *items, size_t num_items,
+                      bool transaction, http_batch_result_t *results, char **output);
+int http_client_watch(http_client_t *client, const char *table, const char *cursor, char **events,
+                      char **next_cursor);
+void http_batch_results_free(http_batch_result_t *results, size_t num_items);
+int http_client_parse_response(const char *operation, const char *data, char **output);
+int http_client_parse_rowset(const char *data, size_t size, char **output, rowset_t **rowset);
+int http_client_parse_batch(char *data, size_t size, const http_batch_item_t *items,
+                            size_t num_items, http_batch_result_t *results, char **output);
@@ -1,35 +1,590 @@
+#define _GNU_SOURCE // pthread_setaffinity_np
+
 // clang-format off
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <signal.h>
+#include <strings.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include "http_server.h"
+#include "src/arena.h"
 #include "src/assert.h"
+#include "src/batch.h"
+#include "src/bulk_load.h"
+#include "src/change_feed.h"
+#include "src/clock.h"
+#include "src/compress.h"
+#include "src/db_request.h"
+#include "src/json_request.h"
 #include "src/key.h"
 #include "src/logger.h"
+#include "src/operation.h"
+#include "src/read_options.h"
+#include "src/result_encoder.h"
+#include "src/strbuf.h"
+#include "src/trace.h"
 // clang-format on
 
-// 连接上下文结构
+// SHARD 模式下事件循环单次等待的最长时间，决定了停止服务的响应延迟
+#define SHARD_POLL_INTERVAL_MS 100
+// 流式响应每次交给 microhttpd 的数据块大小
+#define STREAM_BLOCK_SIZE (32 * 1024)
+// 请求内存区域的块大小，常见的单个 CRUD 请求只需要一块
+#define REQUEST_ARENA_SIZE 4096
+// 指标抓取地址
+#define METRICS_URL "/metrics"
+#define METRICS_CONTENT_TYPE "text/plain; version=0.0.4"
+// X-Deadline-Ms 的上限（一天），更大的值视为不合法
+#define DEADLINE_MAX_MS (24ULL * 3600 * 1000)
+// JSON 请求体的长度上限，超过时返回 413
+#define JSON_BODY_MAX_SIZE (64 * 1024 * 1024)
+// 一次变更订阅长轮询的最长时间，没有变更时到点返回新的游标
+#define WATCH_POLL_MAX_MS 30000
+// 一次变更订阅响应的变更累计到该长度后返回，其余的留给下一次
+#define WATCH_MAX_BYTES (1024 * 1024)
+
+#ifndef MHD_HTTP_CONTENT_TOO_LARGE
+#define MHD_HTTP_CONTENT_TOO_LARGE MHD_HTTP_PAYLOAD_TOO_LARGE // microhttpd < 0.9.74
+#endif
+
+// 监听分片：独立的 microhttpd 实例，由绑定到固定 CPU 核的线程驱动
+struct http_shard {
+  struct MHD_Daemon *daemon;
+  pthread_t thread;
+  int cpu;
+  int epoll_fd; // microhttpd 实例内部的 epoll fd，启动线程之前取得
+  atomic_bool stop;
+  bool thread_started;
+};
+
+// 请求处理状态
+typedef enum {
+  CONN_STATE_RECEIVING = 0, // 正在接收 POST 数据
+  CONN_STATE_QUEUED,        // 已交给数据库工作线程，连接处于挂起状态
+  CONN_STATE_DONE,          // 工作线程已生成响应，等待网络线程发送
+} conn_state_t;
+
+// 流式读取上下文
+//
+// 有数据库工作线程时，游标只在工作线程上读取：microhttpd 发送 pending 的同时，
+// 工作线程把下一块编码到 ready；下一块还没准备好时挂起连接，准备好后由工作线程唤醒。
+// 没有工作线程时在网络线程上边读边发
+typedef struct read_stream {
+  db_cursor_t *cursor; // 结果集读完后立即关闭，归还连接池中的连接
+  unsigned long long num_rows;
+  result_encoder_t encoder;
+  strbuf_t pending; // 已编码（压缩）、尚未交给 microhttpd 的数据
+  size_t pending_off;
+  compressor_t *compressor; // 为 NULL 时不压缩
+  strbuf_t raw;             // 压缩时暂存一个发送块的未压缩数据
+  bool finished;
+  worker_pool_t *workers; // 编码下一块的工作线程池，为 NULL 时在网络线程上读取
+  struct MHD_Connection *connection;
+  pthread_mutex_t mutex; // 保护以下状态；producing 期间游标、编码器和 ready 只由工作线程访问
+  strbuf_t ready;        // 工作线程编码好的下一块
+  bool producing;        // 工作线程正在编码下一块
+  bool waiting;          // 网络线程等待下一块，连接已挂起
+  bool released;         // microhttpd 已释放响应，由正在编码的工作线程释放上下文
+  bool broken;           // 编码下一块失败
+  metrics_t *metrics; // 统计发送的字节数
+  // 边发送边收集未压缩的响应体，完整读完后存入 READ 结果缓存；cache 为 NULL 时不收集
+  read_cache_t *cache;
+  char *table;
+  char *where;
+  uint64_t version; // 查询之前读到的表版本号
+  strbuf_t captured;
+  size_t capture_limit;
+} read_stream_t;
+
+// 连接上下文结构，自身、POST 字段和响应都分配在请求内存区域中，请求结束时一次释放
 typedef struct connection_info {
-  struct MHD_PostProcessor *pp;
+  arena_t *arena;
+  struct MHD_PostProcessor *pp; // 表单请求体的解析器，JSON 请求体为 NULL
+  bool json;                    // 请求体是 application/json，整体接收后原地解析
+  bool body_too_large;          // JSON 请求体超过 JSON_BODY_MAX_SIZE
+  char *body;                   // JSON 请求体
+  size_t body_len;
+  size_t body_cap;
   char *operation;
   char *table;
   char *data;
   char *where;
+  char *cursor;        // operation=watch 的游标
+  char *page_size;     // 表单中的 page_size，JSON 请求体直接写入 read_options
+  char *page_token;    // 上一页响应的续读令牌
+  char *columns;       // READ 只返回的列
+  char *order_by;      // READ 的排序
+  char *limit;         // 表单中的 limit，JSON 请求体直接写入 read_options
+  read_options_t read_options; // READ 的分页、选择的列、排序和行数上限
+  const char *read_key;        // 条件和读取参数合成的键，区分结果缓存、在途读取和 ETag
+  db_params_t *params;         // 参数化操作中 '?' 的值，不是参数化操作时为 NULL
+  char *next_page;             // 分页读取的下一页续读令牌，最后一页为 NULL
+  bool watch;          // 变更订阅，不计入数据库操作的指标
+  batch_t batch;       // operation=batch 时的条目
+  bool batch_overflow; // 条目数超过 BATCH_MAX_ITEMS
+  struct MHD_Connection *connection;
+  http_server_t *server;
+  const char *response;  // 工作线程生成的响应
+  size_t response_len;   // 响应长度，只对 result_body 有效（二进制格式中可能含有 '\0'）
+  bool result_body;      // 响应是编码好的结果集，来自 READ 结果缓存或相同的在途读取
+  read_stream_t *stream; // READ 操作的流式响应
+  result_format_t format;      // 由 Accept 头协商的结果集编码格式
+  content_encoding_t encoding; // 由 Accept-Encoding 头协商的压缩方式
+  unsigned int status_code;
+  atomic_int state;
+  bool admitted;      // 已通过准入控制，结束时需要归还名额
+  client_quota_slot_t *client;  // 已通过客户端配额，结束时需要归还并发名额
+  unsigned int retry_after_sec; // 超出客户端配额时建议的等待秒数
+  uint64_t queued_us; // 交给数据库工作线程的时间
+  uint64_t start_us;  // 收到请求的时间
+  uint64_t sent_us;   // 响应交给 microhttpd 发送的时间
+  uint64_t deadline_us; // 客户端给出的截止时间，0 表示不限时
+  bool failed;        // 响应为错误
+  trace_t trace;      // 追踪 ID 和各阶段耗时
+  const char *if_none_match; // If-None-Match 请求头，由 microhttpd 管理
+  char *etag;                // READ 结果的 ETag，查询之前按表的版本号生成；不可缓存时为 NULL
+  bulk_load_t *bulk;   // operation=bulk_create：请求体边接收边切成批次，交给工作线程执行
+  bool bulk_finished;  // 请求体已接收完毕，执行完剩余批次后生成响应
 } connection_info_t;
 
-static http_server_t *global_server = NULL;
+/**
+ * @brief 停止收集响应体
+ *
+ * @param stream 流式读取上下文
+ */
+static void read_stream_uncache(read_stream_t *stream) {
+  stream->cache = NULL;
+  strbuf_free(&stream->captured);
+}
+
+/**
+ * @brief 收集一段编码后的响应体，结果集读完时存入缓存；超过单个条目的上限或读取出错时放弃
+ *
+ * @param stream 流式读取上下文
+ * @param data 数据
+ * @param len 长度
+ */
+static void read_stream_capture(read_stream_t *stream, const char *data, size_t len) {
+  if (!stream->cache) {
+    return;
+  }
+  if (stream->captured.len + len > stream->capture_limit ||
+      strbuf_append(&stream->captured, data, len) != 0) {
+    read_stream_uncache(stream);
+    return;
+  }
+  if (stream->finished) {
+    if (!stream->cursor->failed) {
+      read_cache_put(stream->cache, stream->table, stream->where, stream->encoder.format,
+                     stream->version, stream->captured.data, stream->captured.len);
+    }
+    read_stream_uncache(stream);
+  }
+}
+
+/**
+ * @brief 从游标拉取行并编码，直到输出达到 limit 字节或结果集结束
+ *
+ * @param stream 流式读取上下文
+ * @param out 输出缓冲区
+ * @param limit 输出长度下限
+ * @return int 成功（0）；失败（-1）
+ */
+static int read_stream_fill(read_stream_t *stream, strbuf_t *out, size_t limit) {
+  while (!stream->finished && out->len < limit) {
+    size_t start = out->len;
+    unsigned long *lengths = NULL;
+    MYSQL_ROW row = db_cursor_fetch(stream->cursor, &lengths);
+    int rc;
+    if (row) {
+      rc = result_encoder_row(&stream->encoder, row, lengths, out);
+    } else {
+      // 出错时以错误记录代替正常结尾
+      if (stream->cursor->failed) {
+        const char *last_error = db_manager_last_error(stream->cursor->manager);
+        rc = result_encoder_error(&stream->encoder, last_error ? last_error : "unknown error",
+                                  out);
+      } else {
+        rc = result_encoder_end(&stream->encoder, out);
+      }
+      stream->finished = true;
+    }
+    if (rc != 0) {
+      LOG_ERROR("Failed to encode row for streaming response");
+      return -1;
+    }
+    read_stream_capture(stream, out->data + start, out->len - start);
+  }
+  return 0;
+}
+
+/**
+ * @brief 结果集读完后关闭游标，连接立即归还连接池，不必等客户端收完剩余的数据
+ *
+ * @param stream 流式读取上下文
+ */
+static void read_stream_done(read_stream_t *stream) {
+  if (stream->finished && stream->cursor) {
+    stream->num_rows = stream->cursor->num_rows;
+    db_cursor_close(stream->cursor);
+    stream->cursor = NULL;
+  }
+}
+
+/**
+ * @brief 编码下一段待发送数据：不压缩时至少 limit 字节，压缩时每次压缩一个发送块并刷新，
+ *        保证客户端收到的每个块都能立即解压
+ *
+ * @param stream 流式读取上下文
+ * @param out 输出缓冲区
+ * @param limit 不压缩时的输出长度下限
+ * @return int 成功（0）；失败（-1）
+ */
+static int read_stream_encode(read_stream_t *stream, strbuf_t *out, size_t limit) {
+  int rc;
+  if (!stream->compressor) {
+    rc = read_stream_fill(stream, out, limit);
+  } else {
+    strbuf_reset(&stream->raw);
+    rc = read_stream_fill(stream, &stream->raw, STREAM_BLOCK_SIZE);
+    if (rc == 0) {
+      rc = compressor_write(stream->compressor, stream->raw.data, stream->raw.len,
+                            stream->finished ? COMPRESS_END : COMPRESS_FLUSH, out);
+    }
+  }
+  read_stream_done(stream);
+  return rc;
+}
+
+/**
+ * @brief 在网络线程上准备下一段待发送数据，不压缩时每次编码一行
+ *
+ * @param stream 流式读取上下文
+ * @return int 成功（0）；失败（-1）
+ */
+static int read_stream_next(read_stream_t *stream) {
+  strbuf_reset(&stream->pending);
+  stream->pending_off = 0;
+  return read_stream_encode(stream, &stream->pending, 1);
+}
+
+static void read_stream_free(void *cls);
+
+/**
+ * @brief 工作线程任务：编码下一块到 ready，完成后唤醒等待的连接；响应已被释放时释放上下文
+ *
+ * @param arg 流式读取上下文
+ */
+static void read_stream_produce(void *arg) {
+  read_stream_t *stream = (read_stream_t *)arg;
+  strbuf_reset(&stream->ready);
+  int rc = read_stream_encode(stream, &stream->ready, STREAM_BLOCK_SIZE);
+
+  pthread_mutex_lock(&stream->mutex);
+  stream->producing = false;
+  stream->broken = rc != 0;
+  if (stream->released) {
+    pthread_mutex_unlock(&stream->mutex);
+    read_stream_free(stream);
+    return;
+  }
+  // 连接在持有锁时挂起，看到 waiting 时一定已经挂起
+  struct MHD_Connection *waiting = stream->waiting ? stream->connection : NULL;
+  stream->waiting = false;
+  pthread_mutex_unlock(&stream->mutex);
+  if (waiting) {
+    MHD_resume_connection(waiting);
+  }
+}
+
+/**
+ * @brief 交给工作线程编码下一块；队列已满或正在停止时在当前线程编码
+ *
+ * @param stream 流式读取上下文
+ */
+static void read_stream_request(read_stream_t *stream) {
+  pthread_mutex_lock(&stream->mutex);
+  stream->producing = true;
+  pthread_mutex_unlock(&stream->mutex);
+  if (worker_pool_submit(stream->workers, read_stream_produce, stream) != 0) {
+    read_stream_produce(stream);
+  }
+}
+
+/**
+ * @brief 取出工作线程编码好的下一块，并开始编码再下一块
+ *
+ * @param stream 流式读取上下文
+ * @return int 取到数据（1）；下一块还在编码，连接已挂起（0）；结果已发完（-1）；编码失败（-2）
+ */
+static int read_stream_take(read_stream_t *stream) {
+  pthread_mutex_lock(&stream->mutex);
+  if (stream->producing) {
+    stream->waiting = true;
+    MHD_suspend_connection(stream->connection);
+    pthread_mutex_unlock(&stream->mutex);
+    return 0;
+  }
+  if (stream->broken) {
+    pthread_mutex_unlock(&stream->mutex);
+    return -2;
+  }
+  strbuf_t taken = stream->ready;
+  stream->ready = stream->pending;
+  stream->pending = taken;
+  stream->pending_off = 0;
+  strbuf_reset(&stream->ready);
+  bool finished = stream->finished;
+  pthread_mutex_unlock(&stream->mutex);
+
+  if (!finished) {
+    read_stream_request(stream);
+  }
+  if (stream->pending.len > 0) {
+    return 1;
+  }
+  return finished ? -1 : read_stream_take(stream);
+}
+
+/**
+ * @brief 流式响应读取回调：先发送已编码的数据，不足时再取下一块，
+ *        因此内存中只保留少量行和两个发送块
+ *
+ * @param cls 流式读取上下文
+ * @param pos 已发送的字节数
+ * @param buf 输出缓冲区
+ * @param max 输出缓冲区大小
+ * @return ssize_t 写入的字节数，或 MHD_CONTENT_READER_END_OF_STREAM
+ */
+static ssize_t read_stream_reader(void *cls, uint64_t pos, char *buf, size_t max) {
+  (void)pos;
+  read_stream_t *stream = (read_stream_t *)cls;
+  size_t written = 0;
+
+  while (written < max) {
+    if (stream->pending_off < stream->pending.len) {
+      size_t n = stream->pending.len - stream->pending_off;
+      if (n > max - written) {
+        n = max - written;
+      }
+      memcpy(buf + written, stream->pending.data + stream->pending_off, n);
+      stream->pending_off += n;
+      written += n;
+      continue;
+    }
+
+    if (!stream->workers) {
+      if (stream->finished) {
+        break;
+      }
+      if (read_stream_next(stream) != 0) {
+        return MHD_CONTENT_READER_END_WITH_ERROR;
+      }
+      continue;
+    }
+    // 已经有数据时先交给 microhttpd，下次再取，避免带着数据挂起连接
+    if (written > 0) {
+      break;
+    }
+    int taken = read_stream_take(stream);
+    if (taken == 0) {
+      return 0; // microhttpd 在连接被唤醒后再次调用
+    }
+    if (taken == -2) {
+      return MHD_CONTENT_READER_END_WITH_ERROR;
+    }
+    if (taken == -1) {
+      break;
+    }
+  }
+
+  metrics_add(&metrics_shard(stream->metrics)->bytes_out, written);
+  if (written == 0 && stream->finished) {
+    LOG_DEBUG("Streaming response completed, %llu rows", stream->num_rows);
+    return MHD_CONTENT_READER_END_OF_STREAM;
+  }
+  return (ssize_t)written;
+}
+
+/**
+ * @brief 释放流式读取上下文
+ *
+ * @param cls 流式读取上下文
+ */
+static void read_stream_free(void *cls) {
+  read_stream_t *stream = (read_stream_t *)cls;
+  if (stream) {
+    db_cursor_close(stream->cursor);
+    compressor_destroy(stream->compressor);
+    strbuf_free(&stream->pending);
+    strbuf_free(&stream->raw);
+    strbuf_free(&stream->ready);
+    strbuf_free(&stream->captured);
+    free(stream->table);
+    free(stream->where);
+    pthread_mutex_destroy(&stream->mutex);
+    free(stream);
+  }
+}
+
+/**
+ * @brief 响应发送完毕或连接断开时由 microhttpd 调用：正在编码时交给工作线程在编码完后释放；
+ *        未读完的游标在工作线程上关闭，丢弃剩余的行需要继续读 MySQL
+ *
+ * @param cls 流式读取上下文
+ */
+static void read_stream_release(void *cls) {
+  read_stream_t *stream = (read_stream_t *)cls;
+  pthread_mutex_lock(&stream->mutex);
+  if (stream->producing) {
+    stream->released = true;
+    pthread_mutex_unlock(&stream->mutex);
+    return;
+  }
+  pthread_mutex_unlock(&stream->mutex);
+  if (stream->cursor && stream->workers &&
+      worker_pool_submit(stream->workers, read_stream_free, stream) == 0) {
+    return;
+  }
+  read_stream_free(stream);
+}
+
+/**
+ * @brief 执行查询并创建流式读取上下文，表头预先编码到待发送缓冲区
+ *
+ * @param db_mgr 数据库管理对象
+ * @param table 表
+ * @param where 条件
+ * @param options 读取参数
+ * @param format 结果集编码格式
+ * @param metrics 指标对象
+ * @return read_stream_t* 流式读取上下文，失败返回 NULL
+ */
+static read_stream_t *read_stream_open(db_manager_t *db_mgr, const char *table, const char *where,
+                                       const read_options_t *options, result_format_t format,
+                                       metrics_t *metrics) {
+  read_stream_t *stream = calloc(1, sizeof(read_stream_t));
+  if (!stream) {
+    LOG_ERROR("Failed to allocate memory for read stream");
+    return NULL;
+  }
+
+  stream->cursor = db_manager_read_open(db_mgr, table, where, options);
+  if (!stream->cursor) {
+    free(stream);
+    return NULL;
+  }
+  stream->num_rows = 0;
+
+  strbuf_init(&stream->pending);
+  strbuf_init(&stream->raw);
+  strbuf_init(&stream->ready);
+  strbuf_init(&stream->captured);
+  pthread_mutex_init(&stream->mutex, NULL);
+  stream->metrics = metrics;
+  result_encoder_init(&stream->encoder, format, stream->cursor->fields,
+                      stream->cursor->num_fields);
+  if (result_encoder_begin(&stream->encoder, &stream->pending) != 0) {
+    read_stream_free(stream);
+    return NULL;
+  }
+  if (!stream->cursor->mysql_res) {
+    if (result_encoder_end(&stream->encoder, &stream->pending) != 0) {
+      read_stream_free(stream);
+      return NULL;
+    }
+    stream->finished = true;
+  }
+  return stream;
+}
+
+/**
+ * @brief 开始为 READ 结果缓存收集响应体，需在刚打开、尚未预读任何行时调用
+ *
+ * @param stream 流式读取上下文
+ * @param cache 缓存
+ * @param table 表
+ * @param where 条件，可以为 NULL
+ * @param version 查询之前读到的表版本号
+ */
+static void read_stream_cache(read_stream_t *stream, read_cache_t *cache, const char *table,
+                              const char *where, uint64_t version) {
+  if (stream->finished) {
+    return;
+  }
+  stream->table = strdup(table);
+  stream->where = where ? strdup(where) : NULL;
+  if (!stream->table || (where && !stream->where)) {
+    return;
+  }
+  stream->cache = cache;
+  stream->version = version;
+  stream->capture_limit = read_cache_entry_limit(cache);
+  // 表头已经编码在待发送缓冲区中
+  read_stream_capture(stream, stream->pending.data, stream->pending.len);
+}
 
 /**
- * @brief 信号处理函数
+ * @brief 领头结束在途读取：有请求在等待时预读整个结果（不超过 SINGLE_FLIGHT_MAX_BYTES）交给它们，
+ *        需在启用压缩之前调用，此时待发送缓冲区中是未压缩的响应体
  *
- * @param sig 信号
+ * @param stream 流式读取上下文，查询失败时为 NULL
+ * @param flights 在途读取表
+ * @param call 在途读取
+ * @return int 成功（0）；预读失败（-1）
  */
-static void signal_handler(int sig) {
-  if (global_server) {
-    LOG_INFO("Received signal %d, shutting down HTTP server...", sig);
-    http_server_stop(global_server);
+static int read_stream_share(read_stream_t *stream, single_flight_t *flights,
+                             single_flight_call_t *call) {
+  int rc = 0;
+  const char *body = NULL;
+  if (stream && single_flight_waiters(flights, call) > 0) {
+    rc = read_stream_fill(stream, &stream->pending, SINGLE_FLIGHT_MAX_BYTES);
+    if (rc == 0 && stream->finished && !stream->cursor->failed) {
+      body = stream->pending.data;
+    }
   }
+  single_flight_finish(flights, call, body, body ? stream->pending.len : 0);
+  return rc;
+}
+
+/**
+ * @brief 预读取结果，总量达到 min_size 时启用压缩，较小的结果不压缩直接发送
+ *
+ * @param stream 流式读取上下文
+ * @param encoding 压缩方式
+ * @param min_size 压缩阈值
+ * @return int 成功（0，是否压缩以 stream->compressor 为准）；失败（-1）
+ */
+static int read_stream_compress(read_stream_t *stream, content_encoding_t encoding,
+                                size_t min_size) {
+  if (read_stream_fill(stream, &stream->pending, min_size) != 0) {
+    return -1;
+  }
+  if (stream->finished && stream->pending.len < min_size) {
+    return 0;
+  }
+
+  stream->compressor = compressor_create(encoding);
+  if (!stream->compressor) {
+    LOG_WARN("Failed to create %s compressor, sending uncompressed",
+             content_encoding_name(encoding));
+    return 0;
+  }
+
+  // 已预读的数据作为第一个待压缩块
+  strbuf_t prefetched = stream->pending;
+  stream->pending = stream->raw;
+  stream->raw = prefetched;
+  return compressor_write(stream->compressor, stream->raw.data, stream->raw.len,
+                          stream->finished ? COMPRESS_END : COMPRESS_FLUSH, &stream->pending);
 }
 
 /**
@@ -43,20 +598,181 @@ static void free_connection_info(void *cls) {
     if (con_info->pp) {
       MHD_destroy_post_processor(con_info->pp);
     }
-    if (con_info->operation) {
-      free(con_info->operation);
+    if (con_info->stream) {
+      read_stream_free(con_info->stream);
     }
-    if (con_info->table) {
-      free(con_info->table);
+    bulk_load_destroy(con_info->bulk);
+
+    http_server_t *server = con_info->server;
+    if (con_info->admitted) {
+      admission_leave(&server->admission);
     }
-    if (con_info->data) {
-      free(con_info->data);
+    if (con_info->client) {
+      client_quota_leave(con_info->client);
     }
-    if (con_info->where) {
-      free(con_info->where);
+
+    arena_t *arena = con_info->arena;
+    LOG_DEBUG("Request arena: %zu allocation(s), %zu block(s), %zu byte(s)", arena->num_allocs,
+              arena->num_blocks, arena->bytes);
+    metrics_shard_t *shard = metrics_shard(server->metrics);
+    metrics_add(&shard->arena_allocs, arena->num_allocs);
+    metrics_add(&shard->arena_blocks, arena->num_blocks);
+    metrics_add(&shard->arena_bytes, arena->bytes);
+    arena_destroy(arena);
+  }
+}
+
+/**
+ * @brief 记录一行慢请求日志，包括追踪 ID 和各阶段耗时
+ *
+ * @param con_info 连接上下文
+ * @param total_us 请求总耗时
+ */
+static void log_slow_request(const connection_info_t *con_info, uint64_t total_us) {
+  char phases[256];
+  size_t len = 0;
+  phases[0] = '\0';
+  for (int phase = 0; phase < TRACE_NUM_PHASES && len < sizeof(phases); ++phase) {
+    int n = snprintf(phases + len, sizeof(phases) - len, " %s_ms=%.3f",
+                     trace_phase_name((trace_phase_t)phase),
+                     (double)con_info->trace.phase_us[phase] / 1000);
+    if (n < 0) {
+      break;
     }
-    free(con_info);
+    len += (size_t)n;
   }
+  LOG_WARN("Slow request trace_id=%s operation=%s status=%u failed=%d total_ms=%.3f%s",
+           con_info->trace.id, db_op_name(db_op_from_str(con_info->operation)),
+           con_info->status_code, con_info->failed, (double)total_us / 1000, phases);
+}
+
+/**
+ * @brief 请求结束回调，释放连接上下文
+ *
+ * @param cls 用户自定义数据（未使用）
+ * @param connection microhttpd 连接的 session
+ * @param con_cls 连接上下文
+ * @param toe 结束原因
+ */
+static void request_completed(void *cls, struct MHD_Connection *connection, void **con_cls,
+                              enum MHD_RequestTerminationCode toe) {
+  (void)cls;
+  (void)connection;
+  if (toe != MHD_REQUEST_TERMINATED_COMPLETED_OK) {
+    LOG_DEBUG("Request terminated with code %d", (int)toe);
+  }
+  connection_info_t *con_info = *con_cls;
+  if (con_info) {
+    uint64_t now_us = clock_now_us();
+    if (con_info->sent_us > 0) {
+      con_info->trace.phase_us[TRACE_PHASE_SEND] = now_us - con_info->sent_us;
+    }
+    uint64_t total_us = now_us - con_info->start_us;
+    bool failed = con_info->failed || toe != MHD_REQUEST_TERMINATED_COMPLETED_OK;
+    // 长轮询本来就要等待，计入指标和慢请求日志只会掩盖真正的慢请求
+    if (!con_info->watch) {
+      metrics_record_request(con_info->server->metrics, db_op_from_str(con_info->operation),
+                             failed, total_us);
+    }
+    uint64_t slow_us = con_info->server->conf.slow_request_us;
+    if (!con_info->watch && slow_us > 0 && total_us >= slow_us) {
+      log_slow_request(con_info, total_us);
+    }
+  }
+  free_connection_info(con_info);
+  *con_cls = NULL;
+}
+
+/**
+ * @brief 保存字段值，off 大于 0 表示同一个值的后续分片，追加到已有内容之后
+ *
+ * @param arena 请求内存区域
+ * @param field 字段
+ * @param data 数据
+ * @param off 分片在值中的偏移
+ * @param size 数据长度
+ * @return int 成功（0）；失败（-1）
+ */
+static int store_post_field(arena_t *arena, char **field, const char *data, uint64_t off,
+                            size_t size) {
+  size_t old_len = (off > 0 && *field) ? strlen(*field) : 0;
+  // 分片通常紧接着到达，期间没有其他分配，值可以原地扩展
+  char *ptr = arena_grow(arena, old_len ? *field : NULL, old_len + 1, old_len + size + 1);
+  if (!ptr) {
+    return -1;
+  }
+  memcpy(ptr + old_len, data, size);
+  ptr[old_len + size] = '\0';
+  *field = ptr;
+  return 0;
+}
+
+/**
+ * @brief 保存表单中的一个参数值，每个 param 字段开始一个新参数，值都是字符串
+ *
+ * @param con_info 连接上下文
+ * @param data 分片数据
+ * @param off 分片偏移
+ * @param size 分片大小，空字符串为 0
+ * @return int 成功（0）；内存不足（-1）
+ */
+static int store_param(connection_info_t *con_info, const char *data, uint64_t off,
+                       size_t size) {
+  db_params_t *params = con_info->params;
+  if (!params && !(params = con_info->params = arena_calloc(con_info->arena, sizeof(*params)))) {
+    return -1;
+  }
+  // 超过上限的请求会被拒绝，之后的值都不再保存
+  bool first = off == 0 || params->count == 0;
+  if (params->overflow || (first && params->count == DB_PARAMS_MAX)) {
+    params->overflow = true;
+    return 0;
+  }
+  if (first) {
+    params->values[params->count++] = (db_param_t){.type = DB_PARAM_STRING, .str = NULL};
+  }
+  db_param_t *param = &params->values[params->count - 1];
+  char *str = (char *)param->str;
+  if (store_post_field(con_info->arena, &str, data ? data : "", off, size) != 0) {
+    return -1;
+  }
+  param->str = str;
+  param->len = strlen(str);
+  return 0;
+}
+
+/**
+ * @brief 获取批量请求中当前条目的字段，item_operation 开始一个新条目
+ *
+ * @param con_info 连接上下文
+ * @param key 字段名
+ * @param off 分片偏移
+ * @return char** 字段，不是条目字段或条目数超限返回 NULL
+ */
+static char **batch_item_field(connection_info_t *con_info, const char *key, uint64_t off) {
+  batch_item_t *item = batch_last_item(&con_info->batch);
+  if (strcmp(key, KEY_POST_ITEM_OPERATION) == 0) {
+    if (off == 0) {
+      item = batch_add_item(&con_info->batch);
+      if (!item) {
+        con_info->batch_overflow = true;
+        return NULL;
+      }
+    }
+    return item ? &item->operation : NULL;
+  }
+
+  if (!item || con_info->batch_overflow) {
+    return NULL;
+  }
+  if (strcmp(key, KEY_POST_ITEM_TABLE) == 0) {
+    return &item->table;
+  } else if (strcmp(key, KEY_POST_ITEM_DATA) == 0) {
+    return &item->data;
+  } else if (strcmp(key, KEY_POST_ITEM_WHERE) == 0) {
+    return &item->where;
+  }
+  return NULL;
 }
 
 /**
@@ -81,9 +797,16 @@ static enum MHD_Result post_data_iterator(void *cls, enum MHD_ValueKind kind, co
   (void)filename;
   (void)content_type;
   (void)transfer_encoding;
-  (void)off;
   connection_info_t *con_info = (connection_info_t *)cls;
 
+  // 参数按位置对应 '?'，空字符串也是一个参数
+  if (key != NULL && strcmp(key, KEY_POST_PARAM) == 0) {
+    if (store_param(con_info, data, off, size) != 0) {
+      LOG_ERROR("Failed to allocate memory for field: %s", key);
+      return MHD_NO;
+    }
+    return MHD_YES;
+  }
   if (key == NULL || data == NULL || size == 0) {
     return MHD_YES;
   }
@@ -97,17 +820,30 @@ static enum MHD_Result post_data_iterator(void *cls, enum MHD_ValueKind kind, co
     target_field = &con_info->data;
   } else if (strcmp(key, KEY_POST_WHERE) == 0) {
     target_field = &con_info->where;
+  } else if (strcmp(key, KEY_POST_CURSOR) == 0) {
+    target_field = &con_info->cursor;
+  } else if (strcmp(key, KEY_POST_PAGE_SIZE) == 0) {
+    target_field = &con_info->page_size;
+  } else if (strcmp(key, KEY_POST_PAGE_TOKEN) == 0) {
+    target_field = &con_info->page_token;
+  } else if (strcmp(key, KEY_POST_COLUMNS) == 0) {
+    target_field = &con_info->columns;
+  } else if (strcmp(key, KEY_POST_ORDER_BY) == 0) {
+    target_field = &con_info->order_by;
+  } else if (strcmp(key, KEY_POST_LIMIT) == 0) {
+    target_field = &con_info->limit;
+  } else if (strcmp(key, KEY_POST_TRANSACTION) == 0) {
+    con_info->batch.transaction = (data[0] == '1' || data[0] == 't');
+    return MHD_YES;
+  } else if (strncmp(key, "item_", 5) == 0) {
+    target_field = batch_item_field(con_info, key, off);
+    if (!target_field) {
+      return MHD_YES;
+    }
   }
 
   if (target_field != NULL) {
-    if (*target_field) {
-      free(*target_field);
-    }
-
-    *target_field = malloc(size + 1);
-    if (*target_field) {
-      memcpy(*target_field, data, size);
-      (*target_field)[size] = '\0';
+    if (store_post_field(con_info->arena, target_field, data, off, size) == 0) {
       LOG_DEBUG("Post key %s -> %s", key, *target_field);
     } else {
       LOG_ERROR("Failed to allocate memory for field: %s", key);
@@ -121,145 +857,891 @@ static enum MHD_Result post_data_iterator(void *cls, enum MHD_ValueKind kind, co
 }
 
 /**
- * @brief 将数据库结果集序列化为简单的文本格式
+ * @brief 请求体是否为 JSON，忽略大小写和 charset 等参数
+ *
+ * @param content_type Content-Type 头，可以为 NULL
+ * @return bool 是 application/json 返回 true
+ */
+static bool is_json_content_type(const char *content_type) {
+  size_t len = strlen(KEY_MIME_JSON);
+  return content_type && strncasecmp(content_type, KEY_MIME_JSON, len) == 0 &&
+         (content_type[len] == '\0' || content_type[len] == ';' || content_type[len] == ' ');
+}
+
+/**
+ * @brief 准备接收 JSON 请求体，已知 Content-Length 时按总长一次分配
  *
- * @param result 数据库结果集
- * @return char* 格式化文本
+ * @param con_info 连接上下文
+ * @param content_length Content-Length 头，可以为 NULL
+ * @return int 成功（0）；失败（-1）
  */
-static char *serialize_db_result(db_result_t *result) {
-  if (!result || !result->mysql_res) {
-    return strdup("No sql results\n");
+static int json_body_init(connection_info_t *con_info, const char *content_length) {
+  unsigned long long size = content_length ? strtoull(content_length, NULL, 10) : 0;
+  if (size > JSON_BODY_MAX_SIZE) {
+    size = 0;
   }
+  con_info->body = arena_alloc(con_info->arena, (size_t)size);
+  con_info->body_len = 0;
+  con_info->body_cap = (size_t)size;
+  return con_info->body ? 0 : -1;
+}
 
-  // 计算需要的缓冲区大小
-  size_t buffer_size = 1024;
-  char *buffer = malloc(buffer_size);
-  if (!buffer) {
+/**
+ * @brief 追加 JSON 请求体数据块，容量不足时加倍，超过上限的请求体只记录不保存
+ *
+ * @param con_info 连接上下文
+ * @param data 数据
+ * @param size 数据长度
+ * @return int 成功（0）；失败（-1）
+ */
+static int json_body_append(connection_info_t *con_info, const char *data, size_t size) {
+  if (con_info->body_too_large || size > JSON_BODY_MAX_SIZE - con_info->body_len) {
+    con_info->body_too_large = true;
+    return 0;
+  }
+
+  size_t need = con_info->body_len + size;
+  if (need > con_info->body_cap) {
+    size_t new_cap = con_info->body_cap * 2;
+    if (new_cap < need) {
+      new_cap = need;
+    }
+    char *ptr = arena_grow(con_info->arena, con_info->body, con_info->body_len, new_cap);
+    if (!ptr) {
+      return -1;
+    }
+    con_info->body = ptr;
+    con_info->body_cap = new_cap;
+  }
+  memcpy(con_info->body + con_info->body_len, data, size);
+  con_info->body_len = need;
+  return 0;
+}
+
+/**
+ * @brief 原地解析接收完的 JSON 请求体，字段直接指向请求体内部
+ *
+ * @param con_info 连接上下文
+ * @param status_code 出错时输出 HTTP 状态码
+ * @return const char* 出错时的响应；成功返回 NULL
+ */
+static const char *json_body_parse(connection_info_t *con_info, unsigned int *status_code) {
+  const char *response = NULL;
+  if (con_info->body_too_large) {
+    *status_code = MHD_HTTP_CONTENT_TOO_LARGE;
+    response = arena_sprintf(con_info->arena, "%s Request body exceeds %d bytes", KEY_RESP_ERROR,
+                             JSON_BODY_MAX_SIZE);
+    return response ? response : KEY_RESP_ERROR " Request body too large";
+  }
+
+  json_request_t req;
+  json_request_error_t error;
+  req.batch = &con_info->batch;
+  // 参数数组有 2KB，只为可能带 params 的请求体分配
+  req.params = NULL;
+  if (memmem(con_info->body, con_info->body_len, "\"" KEY_JSON_PARAMS "\"",
+             sizeof(KEY_JSON_PARAMS) + 1) &&
+      !(req.params = arena_alloc(con_info->arena, sizeof(db_params_t)))) {
+    *status_code = MHD_HTTP_INTERNAL_SERVER_ERROR;
+    return KEY_RESP_ERROR " Out of memory";
+  }
+  uint64_t start_us = clock_now_us();
+  int rc = json_request_parse(con_info->body, con_info->body_len, &req, &error);
+  con_info->trace.phase_us[TRACE_PHASE_PARSE] += clock_now_us() - start_us;
+  if (rc != 0) {
+    LOG_WARN("Invalid JSON request body at byte %zu: %s", error.offset, error.message);
+    *status_code = MHD_HTTP_BAD_REQUEST;
+    response = arena_sprintf(con_info->arena, "%s Invalid JSON request body at byte %zu: %s",
+                             KEY_RESP_ERROR, error.offset, error.message);
+    return response ? response : KEY_RESP_ERROR " Invalid JSON request body";
+  }
+
+  con_info->operation = req.operation;
+  con_info->table = req.table;
+  con_info->data = req.data;
+  con_info->where = req.where;
+  con_info->cursor = req.cursor;
+  con_info->read_options.page_size =
+      req.page_size > READ_MAX_PAGE_SIZE ? READ_MAX_PAGE_SIZE + 1 : (unsigned int)req.page_size;
+  con_info->page_token = req.page_token;
+  con_info->columns = req.columns;
+  con_info->order_by = req.order_by;
+  con_info->read_options.limit = (unsigned int)req.limit;
+  con_info->batch_overflow = req.batch_overflow;
+  con_info->params = req.has_params ? req.params : NULL;
+  return NULL;
+}
+
+/**
+ * @brief 解析表单中的非负整数
+ *
+ * @param text 文本
+ * @param value 输出
+ * @return int 成功（0）；不是非负整数或超过 UINT_MAX（-1）
+ */
+static int parse_count(const char *text, unsigned long *value) {
+  char *end = NULL;
+  errno = 0;
+  *value = strtoul(text, &end, 10);
+  return text[0] < '0' || text[0] > '9' || *end != '\0' || errno == ERANGE || *value > UINT_MAX
+             ? -1
+             : 0;
+}
+
+/**
+ * @brief 把参数追加到键中：每个参数以类型开头，字符串转成十六进制，
+ *        键规整空白和引号时不会让不同的参数得到相同的键
+ *
+ * @param key 键
+ * @param params 参数
+ * @return int 成功（0）；内存不足（-1）
+ */
+static int append_params_key(strbuf_t *key, const db_params_t *params) {
+  static const char hex[] = "0123456789abcdef";
+  int rc = 0;
+  for (size_t i = 0; rc == 0 && i < params->count; ++i) {
+    const db_param_t *param = &params->values[i];
+    switch (param->type) {
+    case DB_PARAM_INT:
+      rc = strbuf_appendf(key, "\x1f" "i%lld", param->i);
+      break;
+    case DB_PARAM_DOUBLE:
+      rc = strbuf_appendf(key, "\x1f" "d%.17g", param->d);
+      break;
+    case DB_PARAM_STRING:
+      rc = strbuf_append_str(key, "\x1f" "s");
+      for (size_t j = 0; rc == 0 && j < param->len; ++j) {
+        unsigned char ch = (unsigned char)param->str[j];
+        rc = strbuf_append_char(key, hex[ch >> 4]) || strbuf_append_char(key, hex[ch & 0xF]);
+      }
+      break;
+    default:
+      rc = strbuf_append_str(key, "\x1f" "n");
+      break;
+    }
+  }
+  return rc ? -1 : 0;
+}
+
+/**
+ * @brief 校验 READ 的读取参数，并生成区分结果缓存、在途读取和 ETag 的键
+ *
+ * 列名和排序在查询之前按表结构校验，这里只检查参数之间的组合
+ *
+ * @param con_info 连接上下文
+ * @param status_code 出错时输出 HTTP 状态码
+ * @return const char* 出错时的响应；成功返回 NULL
+ */
+static const char *read_options_parse(connection_info_t *con_info, unsigned int *status_code) {
+  read_options_t *options = &con_info->read_options;
+  unsigned long value = 0;
+  if (con_info->page_size) {
+    if (parse_count(con_info->page_size, &value) != 0) {
+      *status_code = MHD_HTTP_BAD_REQUEST;
+      return KEY_RESP_ERROR " Invalid " KEY_POST_PAGE_SIZE;
+    }
+    options->page_size = value > READ_MAX_PAGE_SIZE ? READ_MAX_PAGE_SIZE + 1 : (unsigned int)value;
+  }
+  if (con_info->limit) {
+    if (parse_count(con_info->limit, &value) != 0) {
+      *status_code = MHD_HTTP_BAD_REQUEST;
+      return KEY_RESP_ERROR " Invalid " KEY_POST_LIMIT;
+    }
+    options->limit = (unsigned int)value;
+  }
+  options->columns = con_info->columns && con_info->columns[0] ? con_info->columns : NULL;
+  options->order_by = con_info->order_by && con_info->order_by[0] ? con_info->order_by : NULL;
+
+  if (options->page_size > READ_MAX_PAGE_SIZE) {
+    *status_code = MHD_HTTP_BAD_REQUEST;
+    return KEY_RESP_ERROR " " KEY_POST_PAGE_SIZE " exceeds " STR_HELPER(READ_MAX_PAGE_SIZE);
+  }
+  if (con_info->page_token && options->page_size == 0) {
+    *status_code = MHD_HTTP_BAD_REQUEST;
+    return KEY_RESP_ERROR " " KEY_POST_PAGE_TOKEN " requires " KEY_POST_PAGE_SIZE;
+  }
+  if (options->page_size > 0 && (options->order_by || options->limit > 0)) {
+    *status_code = MHD_HTTP_BAD_REQUEST;
+    return KEY_RESP_ERROR " " KEY_POST_ORDER_BY " and " KEY_POST_LIMIT
+                          " cannot be combined with " KEY_POST_PAGE_SIZE;
+  }
+  if (con_info->params && con_info->params->overflow) {
+    *status_code = MHD_HTTP_BAD_REQUEST;
+    return KEY_RESP_ERROR " Too many params, at most " STR_HELPER(DB_PARAMS_MAX);
+  }
+  if (con_info->params && options->page_size > 0) {
+    *status_code = MHD_HTTP_BAD_REQUEST;
+    return KEY_RESP_ERROR " params cannot be combined with " KEY_POST_PAGE_SIZE;
+  }
+  options->page_token = con_info->page_token;
+  options->params = con_info->params;
+
+  // 结果随列、排序、行数和参数变化，这些参数以条件中不会出现的分隔符附在条件之后作为键
+  con_info->read_key = con_info->where;
+  if (options->columns || options->order_by || options->limit > 0 || options->params) {
+    strbuf_t key;
+    strbuf_init(&key);
+    int rc = strbuf_appendf(&key, "%s\x1f%s\x1f%s\x1f%u", con_info->where ? con_info->where : "",
+                            options->columns ? options->columns : "",
+                            options->order_by ? options->order_by : "", options->limit);
+    if (rc != 0 || (options->params && append_params_key(&key, options->params) != 0) ||
+        arena_own(con_info->arena, key.data) != 0) {
+      strbuf_free(&key);
+      *status_code = MHD_HTTP_INTERNAL_SERVER_ERROR;
+      return KEY_RESP_ERROR " Out of memory";
+    }
+    con_info->read_key = key.data;
+  }
+  return NULL;
+}
+
+/**
+ * @brief 压缩读取结果，失败时释放流；预读已经读完结果集时立即归还连接
+ *
+ * @param con_info 连接上下文
+ */
+static void read_compress(connection_info_t *con_info) {
+  if (con_info->stream && con_info->encoding != CONTENT_ENCODING_IDENTITY &&
+      read_stream_compress(con_info->stream, con_info->encoding,
+                           con_info->server->conf.compress_min_size) != 0) {
+    read_stream_free(con_info->stream);
+    con_info->stream = NULL;
+  }
+  if (con_info->stream) {
+    read_stream_done(con_info->stream);
+  }
+}
+
+/**
+ * @brief 分页读取：整页读完之后才知道有没有下一页，续读令牌放在响应头中
+ *
+ * 每一页都从上一页最后一行的主键开始查询，不经过结果缓存、不合并，也不生成 ETag
+ *
+ * @param db_mgr 数据库管理对象
+ * @param con_info 连接上下文
+ * @return const char* 出错时的响应；成功返回 NULL，结果保存在 con_info->stream
+ */
+static const char *read_page(db_manager_t *db_mgr, connection_info_t *con_info) {
+  con_info->stream = read_stream_open(db_mgr, con_info->table, con_info->where,
+                                      &con_info->read_options, con_info->format,
+                                      con_info->server->metrics);
+  // 一页最多 READ_MAX_PAGE_SIZE 行，全部预读
+  if (con_info->stream &&
+      read_stream_fill(con_info->stream, &con_info->stream->pending, SIZE_MAX) != 0) {
+    read_stream_free(con_info->stream);
+    con_info->stream = NULL;
+  }
+  if (!con_info->stream) {
+    return db_request_failed(db_mgr, con_info->arena, "Read");
+  }
+  const char *next_page = con_info->stream->cursor->next_page;
+  if (next_page && !(con_info->next_page = arena_strdup(con_info->arena, next_page))) {
+    read_stream_free(con_info->stream);
+    con_info->stream = NULL;
+    return KEY_RESP_ERROR " Out of memory";
+  }
+  read_compress(con_info);
+  if (!con_info->stream) {
+    return db_request_failed(db_mgr, con_info->arena, "Read");
+  }
+  return NULL;
+}
+
+/**
+ * @brief 处理数据库请求
+ *
+ * @param db_mgr 数据库管理对象
+ * @param con_info 连接上下文
+ * @return const char* 响应字符串，属于请求内存区域（或是常量）；READ 操作成功时返回 NULL，
+ * 结果保存在 con_info->stream
+ */
+static const char *handle_db_request(db_manager_t *db_mgr, connection_info_t *con_info) {
+  if (db_op_from_str(con_info->operation) != DB_OP_READ || !con_info->table) {
+    db_request_t req = {
+        .operation = con_info->operation,
+        .table = con_info->table,
+        .data = con_info->data,
+        .where = con_info->where,
+        .batch = &con_info->batch,
+        .batch_overflow = con_info->batch_overflow,
+        .params = con_info->params,
+        .format = con_info->format,
+    };
+    return db_request_execute(db_mgr, &req, con_info->arena, NULL);
+  }
+
+  LOG_INFO("Processing DB operation: %s on table %s", con_info->operation, con_info->table);
+  if (con_info->read_options.page_size > 0) {
+    return read_page(db_mgr, con_info);
+  }
+
+  // 版本号必须在查询之前读取，查询期间的写入只会让存入的结果立即失效
+  uint64_t version = table_version_get(&db_mgr->versions, con_info->table);
+  bool cached = read_cache_wanted(&db_mgr->cache, con_info->table, con_info->read_key);
+
+  // 相同的读取正在进行时等待它的结果，它的结果太大或出错时再自己查询
+  bool leader = false;
+  single_flight_call_t *call = single_flight_join(&db_mgr->flights, con_info->table,
+                                                  con_info->read_key, con_info->format, version,
+                                                  &leader);
+  if (call && !leader) {
+    const char *body = single_flight_wait(&db_mgr->flights, call, con_info->deadline_us,
+                                          con_info->arena, &con_info->response_len);
+    if (body) {
+      con_info->result_body = true;
+      return body;
+    }
+    call = NULL;
+  }
+
+  // 读取结果以流的形式发送，由 read_stream_reader() 边读边编码
+  con_info->stream =
+      read_stream_open(db_mgr, con_info->table, con_info->where, &con_info->read_options,
+                       con_info->format, con_info->server->metrics);
+  if (con_info->stream && cached) {
+    read_stream_cache(con_info->stream, &db_mgr->cache, con_info->table, con_info->read_key,
+                      version);
+  }
+  if (call && read_stream_share(con_info->stream, &db_mgr->flights, call) != 0) {
+    read_stream_free(con_info->stream);
+    con_info->stream = NULL;
+  }
+  read_compress(con_info);
+  if (!con_info->stream) {
+    return db_request_failed(db_mgr, con_info->arena, "Read");
+  }
+  return NULL;
+}
+
+/**
+ * @brief 执行数据库请求，并把数据库各阶段耗时和编码响应的耗时记入追踪上下文
+ *
+ * 数据库阶段耗时和截止时间都按线程保存，必须在执行请求的线程上设置和读取
+ *
+ * @param db_mgr 数据库管理对象
+ * @param con_info 连接上下文
+ * @param status_code 输出状态码，超过截止时间为 504
+ * @return const char* 响应字符串
+ */
+static const char *run_db_request(db_manager_t *db_mgr, connection_info_t *con_info,
+                                  unsigned int *status_code) {
+  uint64_t start_us = clock_now_us();
+  *status_code = MHD_HTTP_OK;
+  if (con_info->deadline_us > 0 && start_us >= con_info->deadline_us) {
+    // 排队期间已经超时，客户端不会再等这个响应
+    LOG_WARN("Deadline exceeded before executing request %s", con_info->trace.id);
+    *status_code = MHD_HTTP_GATEWAY_TIMEOUT;
+    return KEY_RESP_ERROR " Deadline exceeded before the request was executed";
+  }
+
+  db_manager_timing_reset();
+  db_manager_set_deadline(con_info->deadline_us);
+  const char *response = handle_db_request(db_mgr, con_info);
+  uint64_t elapsed_us = clock_now_us() - start_us;
+  if (db_manager_deadline_exceeded()) {
+    *status_code = MHD_HTTP_GATEWAY_TIMEOUT;
+  }
+  db_manager_set_deadline(0);
+
+  db_timing_t timing;
+  db_manager_timing(&timing);
+  uint64_t *phase_us = con_info->trace.phase_us;
+  phase_us[TRACE_PHASE_CONN_WAIT] = timing.conn_wait_us;
+  phase_us[TRACE_PHASE_QUERY] = timing.query_us;
+  phase_us[TRACE_PHASE_RESULT] = timing.result_us;
+  uint64_t db_us = timing.conn_wait_us + timing.query_us + timing.result_us;
+  phase_us[TRACE_PHASE_SERIALIZE] = elapsed_us > db_us ? elapsed_us - db_us : 0;
+  return response;
+}
+
+/**
+ * @brief 数据库任务：在工作线程中执行请求，完成后唤醒挂起的连接
+ *
+ * @param arg 连接上下文
+ */
+static void db_task_run(void *arg) {
+  connection_info_t *con_info = (connection_info_t *)arg;
+
+  uint64_t queue_us = clock_now_us() - con_info->queued_us;
+  con_info->trace.phase_us[TRACE_PHASE_QUEUE] = queue_us;
+  admission_record_delay(&con_info->server->admission, ADMISSION_STAGE_QUEUE, queue_us);
+  unsigned int status_code;
+  con_info->response = run_db_request(con_info->server->db_mgr, con_info, &status_code);
+  con_info->status_code = status_code;
+  atomic_store_explicit(&con_info->state, CONN_STATE_DONE, memory_order_release);
+  MHD_resume_connection(con_info->connection);
+}
+
+/**
+ * @brief 占用一个副本 server_id；同时运行的订阅不超过线程数，总有空闲的
+ *
+ * @param server HTTP 服务器
+ * @return unsigned int 相对 watch_server_id 的偏移
+ */
+static unsigned int watch_claim_id(http_server_t *server) {
+  unsigned long long ids = atomic_load_explicit(&server->watch_ids, memory_order_relaxed);
+  for (;;) {
+    unsigned int bit = (unsigned int)__builtin_ctzll(~ids);
+    if (atomic_compare_exchange_weak_explicit(&server->watch_ids, &ids, ids | 1ULL << bit,
+                                              memory_order_relaxed, memory_order_relaxed)) {
+      return bit;
+    }
+  }
+}
+
+/**
+ * @brief 变更订阅任务：以副本身份读取 binlog，完成后唤醒挂起的连接
+ *
+ * @param arg 连接上下文
+ */
+static void watch_task_run(void *arg) {
+  connection_info_t *con_info = (connection_info_t *)arg;
+  http_server_t *server = con_info->server;
+  uint64_t start_us = clock_now_us();
+  con_info->trace.phase_us[TRACE_PHASE_QUEUE] = start_us - con_info->queued_us;
+
+  change_feed_opts_t opts;
+  unsigned int id = watch_claim_id(server);
+  opts.server_id = server->conf.watch_server_id + id;
+  opts.deadline_us = start_us + (uint64_t)WATCH_POLL_MAX_MS * 1000;
+  if (con_info->deadline_us > 0 && con_info->deadline_us < opts.deadline_us) {
+    opts.deadline_us = con_info->deadline_us;
+  }
+  opts.max_bytes = WATCH_MAX_BYTES;
+  opts.stop = &server->watch_stop;
+
+  strbuf_t out;
+  strbuf_init(&out);
+  const char *error = NULL;
+  change_feed_result_t result = change_feed_poll(server->db_mgr->conn_pool, con_info->table,
+                                                 con_info->cursor, &opts, &out, &error);
+  atomic_fetch_and_explicit(&server->watch_ids, ~(1ULL << id), memory_order_relaxed);
+  con_info->trace.phase_us[TRACE_PHASE_QUERY] = clock_now_us() - start_us;
+
+  con_info->status_code = MHD_HTTP_OK;
+  if (result == CHANGE_FEED_OK && arena_own(con_info->arena, out.data) == 0) {
+    con_info->response = out.data;
+  } else {
+    if (result == CHANGE_FEED_OK) {
+      strbuf_free(&out);
+      error = "Out of memory";
+    } else if (result == CHANGE_FEED_BAD_CURSOR) {
+      con_info->status_code = MHD_HTTP_BAD_REQUEST;
+    }
+    con_info->response = arena_sprintf(con_info->arena, "%s %s", KEY_RESP_ERROR, error);
+  }
+  atomic_store_explicit(&con_info->state, CONN_STATE_DONE, memory_order_release);
+  MHD_resume_connection(con_info->connection);
+}
+
+/**
+ * @brief 把变更订阅交给订阅线程池，挂起连接直到有变更或长轮询超时
+ *
+ * 订阅不经过客户端配额和准入控制：它只占用自己的线程和一条复制连接，不占用数据库连接池
+ *
+ * @param server HTTP 服务器
+ * @param con_info 连接上下文
+ * @param connection microhttpd 连接
+ * @param status_code 失败时输出状态码
+ * @return const char* 已提交返回 NULL，失败返回错误响应
+ */
+static const char *watch_submit(http_server_t *server, connection_info_t *con_info,
+                                struct MHD_Connection *connection, unsigned int *status_code) {
+  con_info->watch = true;
+  if (!server->watchers) {
+    *status_code = MHD_HTTP_BAD_REQUEST;
+    return KEY_RESP_ERROR " Change feed is disabled";
+  }
+  if (!con_info->table || *con_info->table == '\0') {
+    *status_code = MHD_HTTP_BAD_REQUEST;
+    return KEY_RESP_ERROR " Watch requires a table";
+  }
+
+  con_info->queued_us = clock_now_us();
+  con_info->connection = connection;
+  atomic_store_explicit(&con_info->state, CONN_STATE_QUEUED, memory_order_release);
+  MHD_suspend_connection(connection);
+  if (worker_pool_submit(server->watchers, watch_task_run, con_info) != 0) {
+    LOG_WARN("Watch queue is full, rejecting request");
+    con_info->response = KEY_RESP_ERROR " Server busy, too many watchers";
+    con_info->status_code = MHD_HTTP_SERVICE_UNAVAILABLE;
+    atomic_store_explicit(&con_info->state, CONN_STATE_DONE, memory_order_release);
+    MHD_resume_connection(connection);
+  }
+  return NULL;
+}
+
+/**
+ * @brief 添加追踪 ID 和 Server-Timing 响应头，并记录开始发送的时间
+ *
+ * @param con_info 连接上下文
+ * @param response 响应
+ * @param status_code 状态码
+ */
+static void add_trace_headers(connection_info_t *con_info, struct MHD_Response *response,
+                              unsigned int status_code) {
+  char timing[TRACE_SERVER_TIMING_MAX_LEN];
+  MHD_add_response_header(response, TRACE_ID_HEADER, con_info->trace.id);
+  if (trace_format_server_timing(&con_info->trace, timing, sizeof(timing)) == 0) {
+    MHD_add_response_header(response, TRACE_SERVER_TIMING_HEADER, timing);
+  }
+  con_info->status_code = status_code;
+  con_info->sent_us = clock_now_us();
+}
+
+/**
+ * @brief 为 READ 生成 ETag，并判断客户端缓存的结果是否仍然有效
+ *
+ * ETag 在查询之前按表的当前版本号生成，之后的写入只会让它过期，不会让旧结果带上新 ETag
+ *
+ * @param server HTTP 服务器
+ * @param con_info 连接上下文
+ * @return bool If-None-Match 命中返回 true
+ */
+static bool read_not_modified(http_server_t *server, connection_info_t *con_info) {
+  if (db_op_from_str(con_info->operation) != DB_OP_READ || !con_info->table ||
+      con_info->read_options.page_size > 0) {
+    return false;
+  }
+
+  char etag[TABLE_VERSION_ETAG_LEN];
+  if (table_version_etag(&server->db_mgr->versions, con_info->table, con_info->read_key,
+                         con_info->format, etag, sizeof(etag)) != 0) {
+    return false;
+  }
+  con_info->etag = arena_strdup(con_info->arena, etag);
+  return con_info->etag && table_version_etag_match(con_info->if_none_match, etag);
+}
+
+/**
+ * @brief 在 READ 结果缓存中查找响应体，命中时不查询 MySQL，也不占用准入名额
+ *
+ * @param server HTTP 服务器
+ * @param con_info 连接上下文
+ * @return const char* 响应体，属于请求内存区域；未命中返回 NULL
+ */
+static const char *read_cache_hit(http_server_t *server, connection_info_t *con_info) {
+  db_manager_t *db_mgr = server->db_mgr;
+  if (db_op_from_str(con_info->operation) != DB_OP_READ || con_info->read_options.page_size > 0 ||
+      !read_cache_wanted(&db_mgr->cache, con_info->table, con_info->read_key)) {
     return NULL;
   }
 
-  MYSQL_ROW row;
-  MYSQL_FIELD *fields = mysql_fetch_fields(result->mysql_res);
-  int offset = 0;
-
-  // 添加表头
-  for (int i = 0; i < result->num_fields && (size_t)offset < buffer_size - 1; i++) {
-    offset += snprintf(buffer + offset, buffer_size - offset, "%-15s", fields[i].name);
+  uint64_t version = table_version_get(&db_mgr->versions, con_info->table);
+  const char *body = read_cache_get(&db_mgr->cache, con_info->table, con_info->read_key,
+                                    con_info->format, version, con_info->arena,
+                                    &con_info->response_len);
+  con_info->result_body = body != NULL;
+  return body;
+}
+
+/**
+ * @brief 应答 304 Not Modified
+ *
+ * @param con_info 连接上下文
+ * @param connection microhttpd 连接
+ * @return enum MHD_Result 返回值
+ */
+static enum MHD_Result send_not_modified(connection_info_t *con_info,
+                                         struct MHD_Connection *connection) {
+  struct MHD_Response *response =
+      MHD_create_response_from_buffer(0, (void *)"", MHD_RESPMEM_PERSISTENT);
+  if (!response) {
+    LOG_ERROR("Failed to create response");
+    return MHD_NO;
+  }
+
+  LOG_DEBUG("Read of %s not modified, ETag %s", con_info->table, con_info->etag);
+  metrics_add(&metrics_shard(con_info->server->metrics)->not_modified, 1);
+  MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, con_info->etag);
+  add_trace_headers(con_info, response, MHD_HTTP_NOT_MODIFIED);
+  enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_NOT_MODIFIED, response);
+  MHD_destroy_response(response);
+  return ret;
+}
+
+/**
+ * @brief 依次检查客户端配额和准入控制，都通过后请求才能交给数据库执行
+ *
+ * 客户端以 X-Api-Key 请求头识别，没有时以对端地址识别；超出配额返回 429，服务端过载返回 503
+ *
+ * @param server HTTP 服务器
+ * @param con_info 连接上下文
+ * @param connection microhttpd 连接
+ * @param status_code 被拒绝时输出状态码
+ * @return const char* 接纳返回 NULL，拒绝返回错误响应
+ */
+static const char *admit_request(http_server_t *server, connection_info_t *con_info,
+                                 struct MHD_Connection *connection, unsigned int *status_code) {
+  if (client_quota_enabled(&server->quota)) {
+    char id[CLIENT_QUOTA_ID_LEN + 1];
+    const union MHD_ConnectionInfo *info =
+        MHD_get_connection_info(connection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+    client_quota_id(&server->quota,
+                    MHD_lookup_connection_value(connection, MHD_HEADER_KIND, KEY_HEADER_API_KEY),
+                    info ? info->client_addr : NULL, id, sizeof(id));
+    client_quota_result_t result = client_quota_enter(&server->quota, id, clock_now_us(),
+                                                      &con_info->client,
+                                                      &con_info->retry_after_sec);
+    if (result != CLIENT_QUOTA_OK) {
+      LOG_DEBUG("Client %s over quota, rejecting request", id);
+      *status_code = MHD_HTTP_TOO_MANY_REQUESTS;
+      return result == CLIENT_QUOTA_RATE_LIMITED
+                 ? KEY_RESP_ERROR " Rate limit exceeded, try again later"
+                 : KEY_RESP_ERROR " Too many concurrent requests from this client";
+    }
+  }
+
+  // 在途请求超过预算或存在持续排队，立即拒绝，不再让它排在注定超时的队伍里
+  if (!admission_enter(&server->admission)) {
+    LOG_DEBUG("Server overloaded, shedding request");
+    *status_code = MHD_HTTP_SERVICE_UNAVAILABLE;
+    return KEY_RESP_ERROR " Server busy, try again later";
+  }
+  con_info->admitted = true;
+  return NULL;
+}
+
+/**
+ * @brief 执行已凑满的批次，结果记入批量写入，耗时累加到追踪上下文
+ *
+ * 每个批次是一条自动提交的多行 INSERT，失败的批次记录错误后继续执行后面的批次
+ *
+ * @param db_mgr 数据库管理对象
+ * @param con_info 连接上下文
+ */
+static void bulk_execute(db_manager_t *db_mgr, connection_info_t *con_info) {
+  bulk_load_t *load = con_info->bulk;
+  metrics_shard_t *shard = metrics_shard(con_info->server->metrics);
+  db_manager_timing_reset();
+  db_manager_set_deadline(con_info->deadline_us);
+  bulk_batch_t batch;
+  while (bulk_load_take(load, &batch)) {
+    int affected = db_manager_bulk_insert(db_mgr, load->table, batch.sql);
+    metrics_add(&shard->bulk_batches, 1);
+    if (affected < 0) {
+      metrics_add(&shard->bulk_batch_errors, 1);
+    } else {
+      metrics_add(&shard->bulk_rows, (unsigned long long)affected);
+    }
+    bulk_load_record(load, &batch, affected, affected < 0 ? db_manager_last_error(db_mgr) : NULL);
+  }
+  if (db_manager_deadline_exceeded()) {
+    con_info->status_code = MHD_HTTP_GATEWAY_TIMEOUT;
+  }
+  db_manager_set_deadline(0);
+
+  db_timing_t timing;
+  db_manager_timing(&timing);
+  con_info->trace.phase_us[TRACE_PHASE_CONN_WAIT] += timing.conn_wait_us;
+  con_info->trace.phase_us[TRACE_PHASE_QUERY] += timing.query_us;
+}
+
+/**
+ * @brief 生成批量写入的响应：汇总、写入速度和出错的行
+ *
+ * @param con_info 连接上下文
+ * @return const char* 响应，属于请求内存区域（或是常量）
+ */
+static const char *bulk_response(connection_info_t *con_info) {
+  strbuf_t out;
+  strbuf_init(&out);
+  if (bulk_load_summary(con_info->bulk, clock_now_us() - con_info->start_us, &out) != 0 ||
+      arena_own(con_info->arena, out.data) != 0) {
+    strbuf_free(&out);
+    return KEY_RESP_ERROR " Out of memory";
+  }
+  return out.data;
+}
+
+/**
+ * @brief 批量写入任务：在工作线程中执行已凑满的批次，完成后唤醒挂起的连接继续接收请求体；
+ * 请求体已接收完毕时生成响应
+ *
+ * @param arg 连接上下文
+ */
+static void bulk_task_run(void *arg) {
+  connection_info_t *con_info = (connection_info_t *)arg;
+
+  uint64_t queue_us = clock_now_us() - con_info->queued_us;
+  con_info->trace.phase_us[TRACE_PHASE_QUEUE] += queue_us;
+  admission_record_delay(&con_info->server->admission, ADMISSION_STAGE_QUEUE, queue_us);
+  bulk_execute(con_info->server->db_mgr, con_info);
+  conn_state_t state = CONN_STATE_RECEIVING;
+  if (con_info->bulk_finished) {
+    con_info->response = bulk_response(con_info);
+    state = CONN_STATE_DONE;
+  }
+  atomic_store_explicit(&con_info->state, state, memory_order_release);
+  MHD_resume_connection(con_info->connection);
+}
+
+/**
+ * @brief 把已凑满的批次交给数据库工作线程，挂起连接直到执行完毕
+ *
+ * 挂起期间 microhttpd 不再读取请求体，客户端的上传速度因此受数据库写入速度约束，服务端
+ * 只需缓存一个批次；没有工作线程时在网络线程中直接执行
+ *
+ * @param server HTTP 服务器
+ * @param con_info 连接上下文
+ * @param connection microhttpd 连接
+ * @return const char* 请求体接收完毕且在网络线程中执行时返回响应，否则返回 NULL
+ */
+static const char *bulk_submit(http_server_t *server, connection_info_t *con_info,
+                               struct MHD_Connection *connection) {
+  if (!server->workers) {
+    bulk_execute(server->db_mgr, con_info);
+    return con_info->bulk_finished ? bulk_response(con_info) : NULL;
+  }
+
+  con_info->queued_us = clock_now_us();
+  con_info->connection = connection;
+  atomic_store_explicit(&con_info->state, CONN_STATE_QUEUED, memory_order_release);
+  MHD_suspend_connection(connection);
+  if (worker_pool_submit(server->workers, bulk_task_run, con_info) != 0) {
+    // 之后的请求体不再处理，已执行的批次照常报告
+    LOG_WARN("DB worker queue is full, stopping bulk load into %s", con_info->bulk->table);
+    admission_shed(&server->admission);
+    con_info->response =
+        arena_sprintf(con_info->arena, "%s Server busy, DB worker queue is full after %zu of "
+                                       "%zu row(s) inserted",
+                      KEY_RESP_ERROR, con_info->bulk->rows_inserted, con_info->bulk->rows);
+    con_info->status_code = MHD_HTTP_SERVICE_UNAVAILABLE;
+    atomic_store_explicit(&con_info->state, CONN_STATE_DONE, memory_order_release);
+    MHD_resume_connection(connection);
+  }
+  return NULL;
+}
+
+/**
+ * @brief 开始批量写入：操作和表取自 URL 的查询参数，行的格式取自 Content-Type
+ *
+ * 准入控制在收到第一块请求体之前完成，整个上传期间占用一个名额
+ *
+ * @param server HTTP 服务器
+ * @param con_info 连接上下文
+ * @param connection microhttpd 连接
+ * @param status_code 失败时输出状态码
+ * @return const char* 成功返回 NULL，失败返回错误响应
+ */
+static const char *bulk_begin(http_server_t *server, connection_info_t *con_info,
+                              struct MHD_Connection *connection, unsigned int *status_code) {
+  con_info->operation = KEY_OP_BULK_CREATE;
+  const char *table =
+      MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, KEY_POST_TABLE);
+  if (!table || *table == '\0') {
+    *status_code = MHD_HTTP_BAD_REQUEST;
+    return KEY_RESP_ERROR " Missing required fields: table";
+  }
+  con_info->table = arena_strdup(con_info->arena, table);
+
+  bulk_format_t format;
+  if (bulk_format_from_content_type(MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                                                MHD_HTTP_HEADER_CONTENT_TYPE),
+                                    &format) != 0) {
+    *status_code = MHD_HTTP_UNSUPPORTED_MEDIA_TYPE;
+    return KEY_RESP_ERROR " bulk_create takes a " KEY_MIME_CSV " or " KEY_MIME_NDJSON " body";
   }
-  offset += snprintf(buffer + offset, buffer_size - offset, "\n");
 
-  // 添加分隔线
-  for (int i = 0; i < result->num_fields && (size_t)offset < buffer_size - 1; i++) {
-    offset += snprintf(buffer + offset, buffer_size - offset, "%-15s", "---------------");
+  const char *response = admit_request(server, con_info, connection, status_code);
+  if (response) {
+    return response;
   }
-  offset += snprintf(buffer + offset, buffer_size - offset, "\n");
-
-  // 添加数据行
-  while ((row = mysql_fetch_row(result->mysql_res)) && (size_t)offset < buffer_size - 1) {
-    for (int i = 0; i < result->num_fields && (size_t)offset < buffer_size - 1; i++) {
-      offset += snprintf(buffer + offset, buffer_size - offset, "%-15s", row[i] ? row[i] : "NULL");
-    }
-    offset += snprintf(buffer + offset, buffer_size - offset, "\n");
+  if (!con_info->table || !(con_info->bulk = bulk_load_create(table, format))) {
+    *status_code = MHD_HTTP_INTERNAL_SERVER_ERROR;
+    return KEY_RESP_ERROR " Out of memory";
   }
-
-  return buffer;
+  LOG_INFO("Processing DB operation: %s on table %s", con_info->operation, table);
+  return NULL;
 }
 
 /**
- * @brief 处理数据库请求
+ * @brief 解析 X-Deadline-Ms 请求头
  *
- * @param db_mgr 数据库管理对象
- * @param con_info 连接上下文
- * @return char* 响应字符串
+ * @param value 请求头的值，可以为 NULL
+ * @param start_us 收到请求的时间
+ * @return uint64_t 截止时间；没有或不合法时返回 0（不限时）
  */
-static char *handle_db_request(db_manager_t *db_mgr, connection_info_t *con_info) {
-  if (!con_info->operation || !con_info->table) {
-    return strdup(KEY_RESP_ERROR " Missing required fields: operation, table");
+static uint64_t parse_deadline(const char *value, uint64_t start_us) {
+  if (!value) {
+    return 0;
   }
 
-  const char *op_str = con_info->operation;
-  const char *table_str = con_info->table;
-  const char *data_str = con_info->data;
-  const char *where_str = con_info->where;
+  char *end = NULL;
+  errno = 0;
+  unsigned long long ms = strtoull(value, &end, 10);
+  if (end == value || *end != '\0' || errno != 0 || ms == 0 || ms > DEADLINE_MAX_MS) {
+    LOG_WARN("Ignoring invalid %s header: %s", KEY_HEADER_DEADLINE, value);
+    return 0;
+  }
+  return start_us + (uint64_t)ms * 1000;
+}
 
-  LOG_INFO("Processing DB operation: %s on table %s", op_str, table_str);
+/**
+ * @brief 以 Prometheus 文本格式响应 GET /metrics
+ *
+ * @param server 服务器实例
+ * @param connection microhttpd 连接的 session
+ * @return enum MHD_Result 返回值
+ */
+static enum MHD_Result send_metrics(http_server_t *server, struct MHD_Connection *connection) {
+  metrics_snapshot_t snapshot;
+  metrics_snapshot(server->metrics, &snapshot);
 
-  char *response = NULL;
-  char buffer[256];
+  connection_pool_stats_t pool;
+  connection_pool_stats(server->db_mgr->conn_pool, &pool);
+  metrics_gauges_t gauges;
+  gauges.pool_size = pool.pool_size;
+  gauges.active_connections = pool.active_connections;
+  gauges.pool_waiters = pool.waiters;
+  gauges.reconnects = pool.reconnects;
+  gauges.mysql_retries = db_manager_retry_count(server->db_mgr);
+  gauges.killed_queries = query_watchdog_kills(&server->db_mgr->watchdog);
+  gauges.pending_requests = admission_pending(&server->admission);
+  gauges.worker_queue_depth = server->workers ? worker_pool_pending(server->workers) : 0;
+  if (server->wire) {
+    gauges.worker_queue_depth += worker_pool_pending(server->wire->workers);
+  }
+  gauges.shed_requests = admission_shed_count(&server->admission);
+  read_cache_stats_t cache;
+  read_cache_stats(&server->db_mgr->cache, &cache);
+  gauges.read_cache_hits = cache.hits;
+  gauges.read_cache_misses = cache.misses;
+  gauges.read_cache_evictions = cache.evictions;
+  gauges.read_cache_invalidations = cache.invalidations;
+  gauges.read_cache_entries = cache.entries;
+  gauges.read_cache_bytes = cache.bytes;
+  gauges.read_coalesced = single_flight_coalesced(&server->db_mgr->flights);
+  gauges.stmt_cache_hits = pool.stmts.hits;
+  gauges.stmt_cache_misses = pool.stmts.misses;
+  gauges.stmt_cache_evictions = pool.stmts.evictions;
+  gauges.stmt_cache_invalidations = pool.stmts.invalidations;
+  gauges.stmt_cache_hit_ratio = pool.stmts.hit_ratio;
+  gauges.stmt_prepare_us = pool.stmts.prepare_us;
+  gauges.stmt_prepare_saved_us = pool.stmts.saved_us;
 
-  if (strcmp(op_str, KEY_OP_CREATE) == 0) {
-    if (!data_str) {
-      response = strdup(KEY_RESP_ERROR " Missing data field for create operation");
-    } else {
-      int result = db_manager_create_row(db_mgr, table_str, data_str);
-      if (result >= 0) {
-        snprintf(buffer, sizeof(buffer), "%s Created %d row(s)", KEY_RESP_SUCCESS, result);
-        response = strdup(buffer);
-      } else {
-        if (db_mgr->last_error != NULL) {
-          snprintf(buffer, sizeof(buffer), "%s Create operation failed: %s", KEY_RESP_ERROR,
-                   db_mgr->last_error);
-          response = strdup(buffer);
-        } else {
-          response = strdup(KEY_RESP_ERROR " Create operation failed");
-        }
-      }
-    }
-  } else if (strcmp(op_str, KEY_OP_READ) == 0) {
-    db_result_t *db_result = db_manager_read_row(db_mgr, table_str, where_str);
-    if (db_result) {
-      response = serialize_db_result(db_result);
-      db_result_free(db_result);
-    } else {
-      if (db_mgr->last_error != NULL) {
-        snprintf(buffer, sizeof(buffer), "%s Read operation failed: %s", KEY_RESP_ERROR,
-                 db_mgr->last_error);
-        response = strdup(buffer);
-      } else {
-        response = strdup(KEY_RESP_ERROR " Read operation failed");
-      }
-    }
-  } else if (strcmp(op_str, KEY_OP_UPDATE) == 0) {
-    if (!data_str || !where_str) {
-      response = strdup(KEY_RESP_ERROR " Missing data or where field for update operation");
-    } else {
-      int result = db_manager_update_row(db_mgr, table_str, data_str, where_str);
-      if (result >= 0) {
-        snprintf(buffer, sizeof(buffer), "%s Updated %d row(s)", KEY_RESP_SUCCESS, result);
-        response = strdup(buffer);
-      } else {
-        if (db_mgr->last_error != NULL) {
-          snprintf(buffer, sizeof(buffer), "%s Update operation failed: %s", KEY_RESP_ERROR,
-                   db_mgr->last_error);
-          response = strdup(buffer);
-        } else {
-          response = strdup(KEY_RESP_ERROR " Update operation failed");
-        }
-      }
-    }
-  } else if (strcmp(op_str, KEY_OP_DELETE) == 0) {
-    if (!where_str) {
-      response = strdup(KEY_RESP_ERROR " Missing where field for delete operation");
-    } else {
-      int result = db_manager_delete_row(db_mgr, table_str, where_str);
-      if (result >= 0) {
-        snprintf(buffer, sizeof(buffer), "%s Deleted %d row(s)", KEY_RESP_SUCCESS, result);
-        response = strdup(buffer);
-      } else {
-        if (db_mgr->last_error != NULL) {
-          snprintf(buffer, sizeof(buffer), "%s Delete operation failed: %s", KEY_RESP_ERROR,
-                   db_mgr->last_error);
-          response = strdup(buffer);
-        } else {
-          response = strdup(KEY_RESP_ERROR " Delete operation failed");
-        }
-      }
-    }
-  } else {
-    response = strdup(KEY_RESP_ERROR " Unknown operation");
+  strbuf_t body;
+  strbuf_init(&body);
+  if (metrics_render(&snapshot, &gauges, &body) != 0 ||
+      (client_quota_enabled(&server->quota) && client_quota_render(&server->quota, &body) != 0)) {
+    LOG_ERROR("Failed to render metrics");
+    strbuf_free(&body);
+    return MHD_NO;
   }
 
-  return response;
+  size_t len = body.len;
+  char *text = strbuf_detach(&body);
+  struct MHD_Response *response =
+      MHD_create_response_from_buffer(len, text, MHD_RESPMEM_MUST_FREE);
+  if (!response) {
+    LOG_ERROR("Failed to create metrics response");
+    free(text);
+    return MHD_NO;
+  }
+  MHD_add_response_header(response, "Content-Type", METRICS_CONTENT_TYPE);
+  enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+  MHD_destroy_response(response);
+  return ret;
 }
 
 /**
@@ -286,6 +1768,10 @@ static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connect
   LOG_DEBUG("Received request: %s %s %s", method, url, version);
   http_server_t *server = (http_server_t *)cls;
 
+  if (strcmp(method, "GET") == 0 && strcmp(url, METRICS_URL) == 0) {
+    return send_metrics(server, connection);
+  }
+
   // 只支持 POST 方法
   if (strcmp(method, "POST") != 0) {
     const char *error_msg = "Only POST method is supported";
@@ -300,21 +1786,75 @@ static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connect
 
   // 第一次调用，初始化连接上下文
   if (con_info == NULL) {
-    con_info = calloc(1, sizeof(connection_info_t));
+    arena_t *arena = arena_create(REQUEST_ARENA_SIZE);
+    if (!arena) {
+      LOG_ERROR("Failed to allocate connection info");
+      return MHD_NO;
+    }
+    con_info = arena_calloc(arena, sizeof(connection_info_t));
     if (!con_info) {
       LOG_ERROR("Failed to allocate connection info");
+      arena_destroy(arena);
       return MHD_NO;
     }
 
+    con_info->arena = arena;
     con_info->operation = NULL;
     con_info->table = NULL;
     con_info->data = NULL;
     con_info->where = NULL;
-    con_info->pp = MHD_create_post_processor(connection, 8192, post_data_iterator, con_info);
-    if (!con_info->pp) {
-      LOG_ERROR("Failed to create post processor");
-      free_connection_info(con_info);
-      return MHD_NO;
+    batch_init(&con_info->batch, arena);
+    con_info->status_code = MHD_HTTP_OK;
+    con_info->format = result_format_negotiate(
+        MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT));
+    con_info->encoding = server->conf.compress_min_size > 0
+                             ? content_encoding_negotiate(MHD_lookup_connection_value(
+                                   connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING))
+                             : CONTENT_ENCODING_IDENTITY;
+    con_info->server = server;
+    con_info->start_us = clock_now_us();
+    trace_init(&con_info->trace,
+               MHD_lookup_connection_value(connection, MHD_HEADER_KIND, TRACE_ID_HEADER));
+    con_info->deadline_us = parse_deadline(
+        MHD_lookup_connection_value(connection, MHD_HEADER_KIND, KEY_HEADER_DEADLINE),
+        con_info->start_us);
+    con_info->if_none_match =
+        MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH);
+    atomic_init(&con_info->state, CONN_STATE_RECEIVING);
+
+    // 批量写入的请求体是行本身，边接收边写入；开始失败时丢弃请求体，接收完毕后返回错误
+    const char *op =
+        MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, KEY_POST_OPERATION);
+    if (op && strcmp(op, KEY_OP_BULK_CREATE) == 0) {
+      unsigned int status_code = MHD_HTTP_OK;
+      const char *error = bulk_begin(server, con_info, connection, &status_code);
+      if (error) {
+        con_info->response = error;
+        con_info->status_code = status_code;
+        atomic_store_explicit(&con_info->state, CONN_STATE_DONE, memory_order_release);
+      }
+      *con_cls = con_info;
+      return MHD_YES;
+    }
+
+    // JSON 请求体整体接收后原地解析，不经过 post processor
+    con_info->json = is_json_content_type(
+        MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_CONTENT_TYPE));
+    if (con_info->json) {
+      if (json_body_init(con_info, MHD_lookup_connection_value(
+                                       connection, MHD_HEADER_KIND,
+                                       MHD_HTTP_HEADER_CONTENT_LENGTH)) != 0) {
+        LOG_ERROR("Failed to allocate memory for JSON request body");
+        free_connection_info(con_info);
+        return MHD_NO;
+      }
+    } else {
+      con_info->pp = MHD_create_post_processor(connection, 8192, post_data_iterator, con_info);
+      if (!con_info->pp) {
+        LOG_ERROR("Failed to create post processor");
+        free_connection_info(con_info);
+        return MHD_NO;
+      }
     }
 
     *con_cls = con_info;
@@ -324,9 +1864,24 @@ static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connect
   // 处理 POST 数据块
   if (*upload_data_size > 0) {
     LOG_DEBUG("Processing POST data chunk, size: %zu", *upload_data_size);
+    metrics_add(&metrics_shard(server->metrics)->bytes_in, *upload_data_size);
 
-    int ret = MHD_post_process(con_info->pp, upload_data, *upload_data_size);
-    if (ret == MHD_NO) {
+    if (atomic_load_explicit(&con_info->state, memory_order_acquire) == CONN_STATE_DONE) {
+      // 批量写入开始失败或工作线程队列已满，丢弃请求体，接收完毕后返回错误
+    } else if (con_info->bulk) {
+      // 请求体无法继续解析时只丢弃数据；有凑满的批次时挂起连接，执行完再接收
+      if (bulk_load_feed(con_info->bulk, upload_data, *upload_data_size) == 0 &&
+          con_info->bulk->ready_head < con_info->bulk->num_ready) {
+        *upload_data_size = 0;
+        bulk_submit(server, con_info, connection);
+        return MHD_YES;
+      }
+    } else if (con_info->json) {
+      if (json_body_append(con_info, upload_data, *upload_data_size) != 0) {
+        LOG_ERROR("Failed to allocate memory for JSON request body");
+        return MHD_NO;
+      }
+    } else if (MHD_post_process(con_info->pp, upload_data, *upload_data_size) == MHD_NO) {
       LOG_ERROR("Failed to process POST data");
       return MHD_NO;
     }
@@ -338,39 +1893,251 @@ static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connect
   // POST 数据处理完成（upload_data_size == 0）
   LOG_DEBUG("POST data processing completed");
 
-  // 处理数据库请求
-  char *response_str = handle_db_request(server->db_mgr, con_info);
+  const char *response_str = NULL;
+  unsigned int status_code = MHD_HTTP_OK;
+  bool done = atomic_load_explicit(&con_info->state, memory_order_acquire) == CONN_STATE_DONE;
+  if (!done) {
+    // 请求体接收完毕；JSON 请求体的解析耗时由 json_body_parse() 另外累加
+    con_info->trace.phase_us[TRACE_PHASE_PARSE] = clock_now_us() - con_info->start_us;
+  }
+
+  if (done) {
+    // 工作线程已完成，连接被唤醒后发送响应
+    response_str = con_info->response;
+    status_code = con_info->status_code;
+    con_info->response = NULL;
+  } else if (con_info->bulk) {
+    // 请求体接收完毕：剩下的行凑成最后一个批次，执行后应答汇总
+    bulk_load_finish(con_info->bulk);
+    con_info->bulk_finished = true;
+    response_str = bulk_submit(server, con_info, connection);
+    if (!response_str) {
+      return MHD_YES;
+    }
+    status_code = con_info->status_code;
+  } else if (con_info->json &&
+             (response_str = json_body_parse(con_info, &status_code)) != NULL) {
+    // 请求体不合法，不经过准入控制直接返回错误
+  } else if ((response_str = read_options_parse(con_info, &status_code)) != NULL) {
+    // 分页参数不合法
+  } else if (con_info->operation && strcmp(con_info->operation, KEY_OP_WATCH) == 0) {
+    // 变更订阅由单独的线程池长轮询
+    response_str = watch_submit(server, con_info, connection, &status_code);
+    if (!response_str) {
+      return MHD_YES;
+    }
+  } else if (read_not_modified(server, con_info)) {
+    // 表自客户端上次读取以来没有写入，不查询 MySQL，也不占用准入名额
+    return send_not_modified(con_info, connection);
+  } else if ((response_str = read_cache_hit(server, con_info)) != NULL) {
+    // 结果缓存命中，由网络线程直接应答
+  } else if (!con_info->admitted &&
+             (response_str = admit_request(server, con_info, connection, &status_code)) != NULL) {
+    // 超出客户端配额或服务端过载，立即拒绝
+  } else if (server->workers) {
+    // 交给数据库工作线程执行，挂起连接直到响应就绪；必须先挂起再提交，避免工作线程先行唤醒
+    con_info->queued_us = clock_now_us();
+    con_info->connection = connection;
+    atomic_store_explicit(&con_info->state, CONN_STATE_QUEUED, memory_order_release);
+    MHD_suspend_connection(connection);
+    if (worker_pool_submit(server->workers, db_task_run, con_info) != 0) {
+      LOG_WARN("DB worker queue is full, rejecting request");
+      admission_shed(&server->admission);
+      con_info->response = KEY_RESP_ERROR " Server busy, DB worker queue is full";
+      con_info->status_code = MHD_HTTP_SERVICE_UNAVAILABLE;
+      atomic_store_explicit(&con_info->state, CONN_STATE_DONE, memory_order_release);
+      MHD_resume_connection(connection);
+    }
+    return MHD_YES;
+  } else {
+    // 处理数据库请求
+    response_str = run_db_request(server->db_mgr, con_info, &status_code);
+  }
+
+  if (con_info->stream) {
+    // 流式响应：长度未知，HTTP/1.1 下使用 chunked 编码，游标随响应一起释放
+    read_stream_t *stream = con_info->stream;
+    struct MHD_Response *response = MHD_create_response_from_callback(
+        MHD_SIZE_UNKNOWN, STREAM_BLOCK_SIZE, read_stream_reader, stream, read_stream_release);
+    if (!response) {
+      LOG_ERROR("Failed to create streaming response");
+      return MHD_NO;
+    }
+    MHD_add_response_header(response, "Content-Type",
+                            result_format_content_type(con_info->format));
+    if (con_info->stream->compressor) {
+      MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING,
+                              content_encoding_name(con_info->encoding));
+    }
+    if (server->conf.compress_min_size > 0) {
+      MHD_add_response_header(response, MHD_HTTP_HEADER_VARY, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+    }
+    if (con_info->etag) {
+      MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, con_info->etag);
+    }
+    if (con_info->next_page) {
+      MHD_add_response_header(response, KEY_HEADER_NEXT_PAGE, con_info->next_page);
+    }
+    con_info->stream = NULL;
+    add_trace_headers(con_info, response, status_code);
+
+    // 有工作线程时，预读的数据发送期间就开始编码下一块
+    stream->workers = server->workers;
+    stream->connection = connection;
+    if (stream->workers && !stream->finished) {
+      read_stream_request(stream);
+    }
+    enum MHD_Result ret = MHD_queue_response(connection, status_code, response);
+    MHD_destroy_response(response);
+    return ret;
+  }
+
   if (!response_str) {
-    response_str = strdup(KEY_RESP_ERROR " Failed to process request");
+    response_str = KEY_RESP_ERROR " Failed to process request";
   }
 
   LOG_DEBUG("Construct HTTP response:\n%s", response_str);
+  con_info->failed = status_code != MHD_HTTP_OK ||
+                     strncmp(response_str, KEY_RESP_ERROR, strlen(KEY_RESP_ERROR)) == 0;
+
+  // 超过阈值的响应按协商结果压缩，失败时退回不压缩
+  size_t response_len = con_info->result_body ? con_info->response_len : strlen(response_str);
+  bool compressed = false;
+  if (con_info->encoding != CONTENT_ENCODING_IDENTITY &&
+      response_len >= server->conf.compress_min_size) {
+    uint64_t compress_start_us = clock_now_us();
+    strbuf_t body;
+    strbuf_init(&body);
+    if (compress_buffer(con_info->encoding, response_str, response_len, &body) == 0 &&
+        arena_own(con_info->arena, body.data) == 0) {
+      response_len = body.len;
+      response_str = body.data;
+      compressed = true;
+    } else {
+      LOG_WARN("Failed to compress response, sending uncompressed");
+      strbuf_free(&body);
+    }
+    con_info->trace.phase_us[TRACE_PHASE_SERIALIZE] += clock_now_us() - compress_start_us;
+  }
 
-  // 创建 HTTP 响应
+  // 创建 HTTP 响应；响应体是常量或属于请求内存区域，请求结束（响应发送完毕）后才释放
   struct MHD_Response *response = MHD_create_response_from_buffer(
-      strlen(response_str), (void *)response_str, MHD_RESPMEM_MUST_FREE);
+      response_len, (void *)response_str, MHD_RESPMEM_PERSISTENT);
 
   if (!response) {
     LOG_ERROR("Failed to create response");
-    free(response_str);
     return MHD_NO;
   }
 
-  MHD_add_response_header(response, "Content-Type", "text/plain");
+  if (con_info->result_body) {
+    MHD_add_response_header(response, "Content-Type",
+                            result_format_content_type(con_info->format));
+    if (con_info->etag) {
+      MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, con_info->etag);
+    }
+  } else {
+    MHD_add_response_header(response, "Content-Type", con_info->watch && !con_info->failed
+                                                          ? KEY_MIME_NDJSON
+                                                          : KEY_MIME_TEXT);
+  }
+  metrics_add(&metrics_shard(server->metrics)->bytes_out, response_len);
+  if (status_code == MHD_HTTP_SERVICE_UNAVAILABLE) {
+    MHD_add_response_header(response, MHD_HTTP_HEADER_RETRY_AFTER,
+                            STR_HELPER(ADMISSION_RETRY_AFTER_SEC));
+  } else if (status_code == MHD_HTTP_TOO_MANY_REQUESTS) {
+    char retry_after[16];
+    snprintf(retry_after, sizeof(retry_after), "%u", con_info->retry_after_sec);
+    MHD_add_response_header(response, MHD_HTTP_HEADER_RETRY_AFTER, retry_after);
+  }
+  if (compressed) {
+    MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING,
+                            content_encoding_name(con_info->encoding));
+  }
+  if (server->conf.compress_min_size > 0) {
+    MHD_add_response_header(response, MHD_HTTP_HEADER_VARY, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  }
+  add_trace_headers(con_info, response, status_code);
 
-  enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+  enum MHD_Result ret = MHD_queue_response(connection, status_code, response);
   MHD_destroy_response(response);
 
   return ret;
 }
 
+/**
+ * @brief 解析线程模型名称
+ *
+ * @param str 名称字符串（single、pool、shard）
+ * @param mode 解析结果
+ * @return int 成功（0）；失败（-1）
+ */
+int http_thread_mode_parse(const char *str, http_thread_mode_t *mode) {
+  if (!str || !mode) {
+    return -1;
+  }
+
+  if (strcmp(str, "single") == 0) {
+    *mode = HTTP_THREAD_MODE_SINGLE;
+  } else if (strcmp(str, "pool") == 0) {
+    *mode = HTTP_THREAD_MODE_POOL;
+  } else if (strcmp(str, "shard") == 0) {
+    *mode = HTTP_THREAD_MODE_SHARD;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 获取线程模型名称
+ *
+ * @param mode 线程模型
+ * @return const char* 名称字符串
+ */
+const char *http_thread_mode_name(http_thread_mode_t mode) {
+  switch (mode) {
+  case HTTP_THREAD_MODE_SINGLE:
+    return "single";
+  case HTTP_THREAD_MODE_POOL:
+    return "pool";
+  case HTTP_THREAD_MODE_SHARD:
+    return "shard";
+  default:
+    return "unknown";
+  }
+}
+
+/**
+ * @brief 连接池等待时间观察者，计入准入控制的排队延迟
+ *
+ * @param ctx 准入控制对象
+ * @param wait_us 等待时间
+ */
+static void connection_wait_observed(void *ctx, uint64_t wait_us) {
+  admission_record_delay((admission_t *)ctx, ADMISSION_STAGE_CONNECTION, wait_us);
+}
+
 /**
  * @brief 初始化 http server
  *
  * @param db_mgr 数据库管理对象
+ * @param conf 服务配置
  * @return http_server_t* http server 对象
  */
-http_server_t *http_server_init(db_manager_t *db_mgr) {
+http_server_t *http_server_init(db_manager_t *db_mgr, const http_server_conf_t *conf) {
+  DBMNGR_ASSERT(conf);
+  if (conf->num_threads <= 0 || conf->num_workers < 0 ||
+      (conf->num_workers > 0 && conf->queue_size <= 0) || conf->max_watchers < 0 ||
+      conf->max_watchers > HTTP_MAX_WATCHERS) {
+    LOG_ERROR("Invalid HTTP server configuration: threads=%d, workers=%d, queue=%d, watchers=%d",
+              conf->num_threads, conf->num_workers, conf->queue_size, conf->max_watchers);
+    return NULL;
+  }
+  if (!conf->listen_tcp && !conf->unix_path) {
+    LOG_ERROR("Invalid HTTP server configuration: neither TCP nor Unix socket listener enabled");
+    return NULL;
+  }
+
   http_server_t *server = malloc(sizeof(http_server_t));
   if (!server) {
     LOG_ERROR("Failed to allocate memory for HTTP server");
@@ -378,17 +2145,323 @@ http_server_t *http_server_init(db_manager_t *db_mgr) {
   }
 
   server->db_mgr = db_mgr;
+  server->conf = *conf;
   server->running = false;
   server->daemon = NULL;
+  server->shards = NULL;
+  server->num_shards = 0;
+  server->unix_daemon = NULL;
+  server->workers = NULL;
+  server->wire = NULL;
+  server->watchers = NULL;
+  atomic_init(&server->watch_ids, 0);
+  atomic_init(&server->watch_stop, false);
+  server->metrics = metrics_create();
+  if (!server->metrics) {
+    LOG_ERROR("Failed to allocate memory for metrics");
+    free(server);
+    return NULL;
+  }
 
-  global_server = server;
-
-  signal(SIGINT, signal_handler);
-  signal(SIGTERM, signal_handler);
+  // 能同时执行的请求数受连接池大小限制，使用工作线程时还受工作线程数限制
+  int concurrency = db_mgr->conn_pool->pool_size;
+  if (conf->num_workers > 0 && conf->num_workers < concurrency) {
+    concurrency = conf->num_workers;
+  }
+  if (admission_init(&server->admission, conf->max_pending, concurrency, conf->queue_target_us,
+                     conf->queue_interval_us) != 0) {
+    metrics_destroy(server->metrics);
+    free(server);
+    return NULL;
+  }
+  if (client_quota_init(&server->quota, conf->client_rate, conf->client_burst,
+                        conf->client_max_active) != 0) {
+    admission_destroy(&server->admission);
+    metrics_destroy(server->metrics);
+    free(server);
+    return NULL;
+  }
+  if (conf->client_keys && client_quota_load_keys(&server->quota, conf->client_keys) != 0) {
+    client_quota_destroy(&server->quota);
+    admission_destroy(&server->admission);
+    metrics_destroy(server->metrics);
+    free(server);
+    return NULL;
+  }
+  connection_pool_set_wait_observer(db_mgr->conn_pool, connection_wait_observed,
+                                    &server->admission);
 
   return server;
 }
 
+/**
+ * @brief 分片事件循环，驱动外部轮询模式的 microhttpd 实例
+ *
+ * @param arg 分片对象
+ * @return void* NULL
+ */
+static void *shard_loop(void *arg) {
+  http_shard_t *shard = (http_shard_t *)arg;
+
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(shard->cpu, &cpuset);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) {
+    LOG_WARN("Failed to pin HTTP shard to CPU %d", shard->cpu);
+  }
+
+  while (!atomic_load_explicit(&shard->stop, memory_order_acquire)) {
+    int timeout_ms = SHARD_POLL_INTERVAL_MS;
+    unsigned long long mhd_timeout = 0;
+    if (MHD_get_timeout(shard->daemon, &mhd_timeout) == MHD_YES &&
+        mhd_timeout < (unsigned long long)timeout_ms) {
+      timeout_ms = (int)mhd_timeout;
+    }
+
+    struct epoll_event event;
+    epoll_wait(shard->epoll_fd, &event, 1, timeout_ms);
+    MHD_run(shard->daemon);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief 停止并释放所有分片
+ *
+ * @param server http server 对象
+ */
+static void stop_shards(http_server_t *server) {
+  for (int i = 0; i < server->num_shards; ++i) {
+    atomic_store_explicit(&server->shards[i].stop, true, memory_order_release);
+  }
+
+  for (int i = 0; i < server->num_shards; ++i) {
+    http_shard_t *shard = &server->shards[i];
+    if (shard->thread_started) {
+      pthread_join(shard->thread, NULL);
+    }
+    if (shard->daemon) {
+      MHD_stop_daemon(shard->daemon);
+    }
+  }
+
+  free(server->shards);
+  server->shards = NULL;
+  server->num_shards = 0;
+}
+
+/**
+ * @brief 计算 microhttpd 启动标志
+ *
+ * @param server http server 对象
+ * @param flags 线程模型相关的标志
+ * @return unsigned int 完整的启动标志
+ */
+static unsigned int daemon_flags(http_server_t *server, unsigned int flags) {
+  flags |= MHD_USE_DEBUG;
+  if (server->conf.num_workers > 0 || server->conf.max_watchers > 0) {
+    flags |= MHD_ALLOW_SUSPEND_RESUME;
+  }
+  return flags;
+}
+
+/**
+ * @brief 启动 SHARD 模式：每个分片独立监听同一端口（SO_REUSEPORT），由内核做连接负载均衡
+ *
+ * @param server http server 对象
+ * @return int 成功（0）；失败（-1）
+ */
+static int start_shards(http_server_t *server) {
+  int num_shards = server->conf.num_threads;
+  long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (num_cpus <= 0) {
+    num_cpus = 1;
+  }
+
+  server->shards = calloc(num_shards, sizeof(http_shard_t));
+  if (!server->shards) {
+    LOG_ERROR("Failed to allocate memory for HTTP shards");
+    return -1;
+  }
+  server->num_shards = num_shards;
+
+  for (int i = 0; i < num_shards; ++i) {
+    http_shard_t *shard = &server->shards[i];
+    shard->cpu = (int)(i % num_cpus);
+    atomic_init(&shard->stop, false);
+
+    shard->daemon = MHD_start_daemon(
+        daemon_flags(server, MHD_USE_EPOLL), HTTP_PORT, NULL, NULL, &request_handler, server,
+        MHD_OPTION_LISTENING_ADDRESS_REUSE, (unsigned int)1, MHD_OPTION_NOTIFY_COMPLETED,
+        &request_completed, NULL, MHD_OPTION_END);
+    if (!shard->daemon) {
+      LOG_ERROR("Failed to start HTTP shard %d on port %d", i, HTTP_PORT);
+      stop_shards(server);
+      return -1;
+    }
+    // 取不到 epoll fd 的分片无法驱动，但它的 SO_REUSEPORT 套接字仍会分到连接，必须让启动失败
+    const union MHD_DaemonInfo *info =
+        MHD_get_daemon_info(shard->daemon, MHD_DAEMON_INFO_EPOLL_FD);
+    if (!info) {
+      LOG_ERROR("Failed to get epoll fd of HTTP shard %d", i);
+      stop_shards(server);
+      return -1;
+    }
+    shard->epoll_fd = info->epoll_fd;
+
+    if (pthread_create(&shard->thread, NULL, shard_loop, shard) != 0) {
+      LOG_ERROR("Failed to create thread for HTTP shard %d", i);
+      stop_shards(server);
+      return -1;
+    }
+    shard->thread_started = true;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief 按线程模型启动 TCP 监听
+ *
+ * @param server http server 对象
+ * @return int 成功（0）；失败（-1）
+ */
+static int start_tcp(http_server_t *server) {
+  switch (server->conf.thread_mode) {
+  case HTTP_THREAD_MODE_SINGLE:
+    server->daemon = MHD_start_daemon(
+        daemon_flags(server, MHD_USE_INTERNAL_POLLING_THREAD), HTTP_PORT, NULL, NULL,
+        &request_handler, server, MHD_OPTION_NOTIFY_COMPLETED, &request_completed, NULL,
+        MHD_OPTION_END);
+    break;
+  case HTTP_THREAD_MODE_POOL:
+    server->daemon = MHD_start_daemon(
+        daemon_flags(server, MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_EPOLL), HTTP_PORT, NULL,
+        NULL, &request_handler, server, MHD_OPTION_THREAD_POOL_SIZE,
+        (unsigned int)server->conf.num_threads, MHD_OPTION_NOTIFY_COMPLETED, &request_completed,
+        NULL, MHD_OPTION_END);
+    break;
+  case HTTP_THREAD_MODE_SHARD:
+    if (start_shards(server) != 0) {
+      return -1;
+    }
+    break;
+  default:
+    LOG_ERROR("Unknown HTTP thread mode: %d", server->conf.thread_mode);
+    break;
+  }
+
+  if (!server->daemon && !server->shards) {
+    LOG_ERROR("Failed to start HTTP server on port %d", HTTP_PORT);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 创建并监听 Unix 域套接字
+ *
+ * @param path 套接字路径
+ * @param mode 套接字文件权限
+ * @return int 监听套接字；失败（-1）
+ */
+static int unix_listen(const char *path, mode_t mode) {
+  struct sockaddr_un addr;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    LOG_ERROR("Unix socket path too long: %s", path);
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create Unix socket: %s", strerror(errno));
+    return -1;
+  }
+
+  // 上次异常退出会遗留套接字文件导致 bind 失败；能连上则说明另一个实例仍在监听，不能删除
+  struct stat st;
+  if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+      LOG_ERROR("Unix socket %s is in use by another process", path);
+      close(fd);
+      return -1;
+    }
+    unlink(path);
+  }
+
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    LOG_ERROR("Failed to bind Unix socket %s: %s", path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  // 在 listen 之前修改权限，客户端不会在权限生效前连入
+  if (chmod(path, mode) != 0 || listen(fd, SOMAXCONN) != 0) {
+    LOG_ERROR("Failed to listen on Unix socket %s: %s", path, strerror(errno));
+    close(fd);
+    unlink(path);
+    return -1;
+  }
+
+  return fd;
+}
+
+/**
+ * @brief 启动 Unix 域套接字监听，SINGLE 模式使用单个轮询线程，其余模式使用线程池
+ *
+ * @param server http server 对象
+ * @return int 成功（0）；失败（-1）
+ */
+static int start_unix(http_server_t *server) {
+  const char *path = server->conf.unix_path;
+  int fd = unix_listen(path, server->conf.unix_mode);
+  if (fd < 0) {
+    return -1;
+  }
+
+  // 套接字由 microhttpd 接管，停止实例时关闭
+  if (server->conf.thread_mode == HTTP_THREAD_MODE_SINGLE) {
+    server->unix_daemon = MHD_start_daemon(
+        daemon_flags(server, MHD_USE_INTERNAL_POLLING_THREAD), 0, NULL, NULL, &request_handler,
+        server, MHD_OPTION_LISTEN_SOCKET, fd, MHD_OPTION_NOTIFY_COMPLETED, &request_completed,
+        NULL, MHD_OPTION_END);
+  } else {
+    server->unix_daemon = MHD_start_daemon(
+        daemon_flags(server, MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_EPOLL), 0, NULL, NULL,
+        &request_handler, server, MHD_OPTION_LISTEN_SOCKET, fd, MHD_OPTION_THREAD_POOL_SIZE,
+        (unsigned int)server->conf.num_threads, MHD_OPTION_NOTIFY_COMPLETED, &request_completed,
+        NULL, MHD_OPTION_END);
+  }
+
+  if (!server->unix_daemon) {
+    LOG_ERROR("Failed to start HTTP server on Unix socket %s", path);
+    unlink(path);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 停止所有监听实例
+ *
+ * @param server http server 对象
+ */
+static void stop_listeners(http_server_t *server) {
+  if (server->daemon) {
+    MHD_stop_daemon(server->daemon);
+    server->daemon = NULL;
+  }
+  stop_shards(server);
+  if (server->unix_daemon) {
+    MHD_stop_daemon(server->unix_daemon);
+    server->unix_daemon = NULL;
+    unlink(server->conf.unix_path);
+  }
+}
+
 /**
  * @brief 启动 http 服务
  *
@@ -399,17 +2472,66 @@ int http_server_start(http_server_t *server) {
   if (!server)
     return -1;
 
-  server->daemon = MHD_start_daemon(
-      MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_DEBUG, HTTP_PORT, NULL, NULL, &request_handler,
-      server, MHD_OPTION_NOTIFY_COMPLETED, &free_connection_info, NULL, MHD_OPTION_END);
+  if (server->conf.num_workers > 0) {
+    server->workers = worker_pool_create(server->conf.num_workers, server->conf.queue_size);
+    if (!server->workers) {
+      LOG_ERROR("Failed to create DB worker pool");
+      return -1;
+    }
+  }
+  if (server->conf.max_watchers > 0) {
+    // 排队的订阅最多与进行中的一样多，更多的直接返回 503
+    atomic_store(&server->watch_stop, false);
+    server->watchers = worker_pool_create(server->conf.max_watchers, server->conf.max_watchers);
+    if (!server->watchers) {
+      LOG_ERROR("Failed to create watch worker pool");
+      worker_pool_destroy(server->workers);
+      server->workers = NULL;
+      return -1;
+    }
+  }
 
-  if (!server->daemon) {
-    LOG_ERROR("Failed to start HTTP server on port %d", HTTP_PORT);
+  if ((server->conf.listen_tcp && start_tcp(server) != 0) ||
+      (server->conf.unix_path && start_unix(server) != 0)) {
+    stop_listeners(server);
+    worker_pool_destroy(server->workers);
+    server->workers = NULL;
+    worker_pool_destroy(server->watchers);
+    server->watchers = NULL;
     return -1;
   }
 
+  if (server->conf.wire_port > 0) {
+    // 二进制协议的请求总是交给工作线程，一个连接上的多个请求才能并行执行、乱序完成
+    wire_server_conf_t wire_conf;
+    wire_conf.port = server->conf.wire_port;
+    wire_conf.num_workers = server->conf.num_workers > 0 ? server->conf.num_workers
+                                                         : server->db_mgr->conn_pool->pool_size;
+    wire_conf.queue_size = server->conf.queue_size;
+    server->wire = wire_server_start(server->db_mgr, &wire_conf, &server->admission,
+                                     &server->quota, server->metrics);
+    if (!server->wire) {
+      stop_listeners(server);
+      worker_pool_destroy(server->workers);
+      server->workers = NULL;
+      worker_pool_destroy(server->watchers);
+      server->watchers = NULL;
+      return -1;
+    }
+  }
+
   server->running = true;
-  LOG_INFO("HTTP server started on port %d", HTTP_PORT);
+  if (server->conf.listen_tcp) {
+    LOG_INFO("HTTP server listening on port %d", HTTP_PORT);
+  }
+  if (server->conf.unix_path) {
+    LOG_INFO("HTTP server listening on Unix socket %s (mode %04o)", server->conf.unix_path,
+             (unsigned int)server->conf.unix_mode);
+  }
+  LOG_INFO("HTTP server started, mode=%s, threads=%d, db workers=%d, max watchers=%d",
+           http_thread_mode_name(server->conf.thread_mode),
+           server->conf.thread_mode == HTTP_THREAD_MODE_SINGLE ? 1 : server->conf.num_threads,
+           server->conf.num_workers, server->conf.max_watchers);
   return 0;
 }
 
@@ -420,9 +2542,31 @@ int http_server_start(http_server_t *server) {
  */
 void http_server_stop(http_server_t *server) {
   if (server && server->running) {
-    MHD_stop_daemon(server->daemon);
+    wire_server_stop(server->wire);
+    server->wire = NULL;
+    // 先让工作线程执行完排队的任务并唤醒所有挂起的连接，microhttpd 不允许带着挂起连接停止；
+    // 进行中的变更订阅在下一个心跳时返回
+    atomic_store_explicit(&server->watch_stop, true, memory_order_release);
+    worker_pool_shutdown(server->watchers);
+    worker_pool_shutdown(server->workers);
+    stop_listeners(server);
+    worker_pool_destroy(server->workers);
+    server->workers = NULL;
+    worker_pool_destroy(server->watchers);
+    server->watchers = NULL;
     server->running = false;
-    LOG_INFO("HTTP server stopped");
+    LOG_INFO("HTTP server stopped, %llu request(s) shed by admission control",
+             admission_shed_count(&server->admission));
+    metrics_snapshot_t snapshot;
+    metrics_snapshot(server->metrics, &snapshot);
+    unsigned long long requests = 0;
+    for (int op = 0; op < METRICS_NUM_OPS; ++op) {
+      requests += snapshot.requests[op];
+    }
+    if (requests > 0) {
+      LOG_INFO("Request arena: %.2f allocation(s) and %.2f heap block(s) per request",
+               (double)snapshot.arena_allocs / requests, (double)snapshot.arena_blocks / requests);
+    }
   }
 }
 
@@ -436,6 +2580,19 @@ void http_server_destroy(http_server_t *server) {
     return;
 
   http_server_stop(server);
+  connection_pool_set_wait_observer(server->db_mgr->conn_pool, NULL, NULL);
+  admission_destroy(&server->admission);
+  client_quota_destroy(&server->quota);
+  metrics_destroy(server->metrics);
   free(server);
-  global_server = NULL;
+}
+
+/**
+ * @brief 累计被准入控制拒绝的请求数
+ *
+ * @param server http server 对象
+ * @return unsigned long long 请求数
+ */
+unsigned long long http_server_shed_count(http_server_t *server) {
+  return server ? admission_shed_count(&server->admission) : 0;
 }
@@ -1,18 +1,75 @@
 #pragma once
 
 // clang-format off
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/types.h>
 #include <microhttpd.h>
+#include "src/admission.h"
+#include "src/client_quota.h"
 #include "src/db_manager.h"
 #include "src/macro.h"
+#include "src/metrics.h"
+#include "src/wire_server.h"
+#include "src/worker_pool.h"
 // clang-format on
 
+// 同时进行的变更订阅（operation=watch）上限，每个占用一个副本 server_id
+#define HTTP_MAX_WATCHERS 64
+
+// http 服务线程模型
+typedef enum {
+  HTTP_THREAD_MODE_SINGLE = 0, // 单个内部轮询线程
+  HTTP_THREAD_MODE_POOL,       // microhttpd 内部线程池（epoll）
+  HTTP_THREAD_MODE_SHARD,      // 多个 SO_REUSEPORT 监听分片，每个分片绑定一个 CPU 核
+} http_thread_mode_t;
+
+typedef struct {
+  http_thread_mode_t thread_mode;
+  int num_threads; // POOL 模式为线程池大小，SHARD 模式为分片数量
+  int num_workers; // 数据库工作线程数量，0 表示在网络线程中直接执行
+  int queue_size;  // 数据库任务队列容量
+  size_t compress_min_size; // 响应体达到该大小且客户端支持时压缩，0 表示不压缩
+  bool listen_tcp;          // 是否监听 TCP 端口 HTTP_PORT
+  const char *unix_path;    // Unix 域套接字路径，NULL 表示不监听
+  mode_t unix_mode;         // Unix 域套接字文件权限
+  int max_pending;            // 在途请求上限，超出时直接返回 503，0 表示不限
+  uint64_t queue_target_us;   // 排队延迟目标，持续超过时只接纳无需排队的请求
+  uint64_t queue_interval_us; // 判断持续排队的观察窗口
+  uint64_t slow_request_us;   // 耗时达到该值的请求记录一行各阶段耗时，0 表示不记录
+  int wire_port;              // 二进制协议监听端口，0 表示不监听
+  double client_rate;         // 每个客户端每秒的请求数，超出时返回 429，0 表示不限速
+  int client_burst;           // 客户端令牌桶容量，0 表示与 client_rate 相同
+  int client_max_active;      // 每个客户端的在途请求上限，0 表示不限
+  const char *client_keys;    // 已知 API Key 的列表文件，NULL 表示都按对端地址识别客户端
+  int max_watchers;           // 同时进行的变更订阅上限，0 表示不提供变更订阅
+  unsigned int watch_server_id; // 变更订阅连接主库使用的第一个副本 server_id
+} http_server_conf_t;
+
+typedef struct http_shard http_shard_t;
+
 typedef struct {
-  struct MHD_Daemon *daemon;
+  struct MHD_Daemon *daemon; // SINGLE、POOL 模式使用
+  http_shard_t *shards;      // SHARD 模式使用
+  int num_shards;
+  struct MHD_Daemon *unix_daemon; // Unix 域套接字监听实例
   db_manager_t *db_mgr;
+  worker_pool_t *workers; // 数据库工作线程池，为 NULL 时在网络线程中执行
+  admission_t admission;  // 准入控制
+  client_quota_t quota;   // 每个客户端的速率和并发上限，先于准入控制检查
+  metrics_t *metrics;     // GET /metrics 输出的计数器
+  wire_server_t *wire;    // 二进制协议监听器，与 HTTP 共用准入控制和指标
+  worker_pool_t *watchers; // 变更订阅线程池，长轮询不占用数据库工作线程
+  atomic_ullong watch_ids; // 正在使用的副本 server_id，相对 watch_server_id 的位图
+  atomic_bool watch_stop;  // 服务停止时让进行中的变更订阅尽快返回
+  http_server_conf_t conf;
   bool running;
 } http_server_t;
 
-http_server_t *http_server_init(db_manager_t *db_mgr);
+int http_thread_mode_parse(const char *str, http_thread_mode_t *mode);
+const char *http_thread_mode_name(http_thread_mode_t mode);
+http_server_t *http_server_init(db_manager_t *db_mgr, const http_server_conf_t *conf);
 int http_server_start(http_server_t *server);
 void http_server_stop(http_server_t *server);
 void http_server_destroy(http_server_t *server);
+unsigned long long http_server_shed_count(http_server_t *server);
@@ -0,0 +1,133 @@
+// clang-format off
+#include <string.h>
+#include "json_escape.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+// clang-format on
+
+/**
+ * @brief 字节是否需要转义：控制字符、双引号、反斜杠（>= 0x80 的 UTF-8 字节原样输出）
+ */
+static inline int needs_escape(unsigned char ch) { return ch < 0x20 || ch == '"' || ch == '\\'; }
+
+/**
+ * @brief 标量实现，用于 SIMD 处理不足 16 字节的尾部
+ */
+static size_t scan_scalar(const unsigned char *data, size_t len) {
+  size_t i = 0;
+  while (i < len && !needs_escape(data[i])) {
+    ++i;
+  }
+  return i;
+}
+
+/**
+ * @brief 查找第一个需要转义的字节
+ *
+ * x86_64 使用 SSE2、aarch64 使用 NEON 每次检查 16 字节，其他平台退化为逐字节检查
+ *
+ * @param data 数据
+ * @param len 数据长度
+ * @return size_t 第一个需要转义的字节的下标，都不需要转义时返回 len
+ */
+size_t json_escape_scan(const char *data, size_t len) {
+  const unsigned char *ptr = (const unsigned char *)data;
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1F);
+  for (; i + 16 <= len; i += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(ptr + i));
+    // SSE2 只有有符号比较，用 min_epu8(x, 0x1F) == x 判断无符号的 x <= 0x1F
+    __m128i hit = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+        _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+    int mask = _mm_movemask_epi8(hit);
+    if (mask) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  const uint8x16_t quote = vdupq_n_u8('"');
+  const uint8x16_t backslash = vdupq_n_u8('\\');
+  const uint8x16_t control = vdupq_n_u8(0x20);
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t chunk = vld1q_u8(ptr + i);
+    uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)),
+                              vcltq_u8(chunk, control));
+    if (vmaxvq_u8(hit)) {
+      // 命中的块内再逐字节定位
+      return i + scan_scalar(ptr + i, 16);
+    }
+  }
+#endif
+
+  return i + scan_scalar(ptr + i, len - i);
+}
+
+/**
+ * @brief 追加 JSON 字符串内容（不含两侧引号）
+ *
+ * 不需要转义的连续字节整段拷贝
+ *
+ * @param out 输出缓冲区
+ * @param data 数据
+ * @param len 数据长度
+ * @return int 成功（0）；失败（-1）
+ */
+int json_escape_append(strbuf_t *out, const char *data, size_t len) {
+  static const char hex[] = "0123456789abcdef";
+
+  while (len > 0) {
+    size_t run = json_escape_scan(data, len);
+    if (strbuf_append(out, data, run) != 0) {
+      return -1;
+    }
+    if (run == len) {
+      break;
+    }
+
+    unsigned char ch = (unsigned char)data[run];
+    char escaped[6] = {'\\', 0};
+    size_t escaped_len = 2;
+    switch (ch) {
+    case '"':
+    case '\\':
+      escaped[1] = ch;
+      break;
+    case '\b':
+      escaped[1] = 'b';
+      break;
+    case '\f':
+      escaped[1] = 'f';
+      break;
+    case '\n':
+      escaped[1] = 'n';
+      break;
+    case '\r':
+      escaped[1] = 'r';
+      break;
+    case '\t':
+      escaped[1] = 't';
+      break;
+    default:
+      memcpy(escaped + 1, "u00", 3);
+      escaped[4] = hex[ch >> 4];
+      escaped[5] = hex[ch & 0xF];
+      escaped_len = 6;
+      break;
+    }
+    if (strbuf_append(out, escaped, escaped_len) != 0) {
+      return -1;
+    }
+
+    data += run + 1;
+    len -= run + 1;
+  }
+  return 0;
+}
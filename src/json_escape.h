@@ -0,0 +1,9 @@
+#pragma once
+
+// clang-format off
+#include <stddef.h>
+#include "src/strbuf.h"
+// clang-format on
+
+size_t json_escape_scan(const char *data, size_t len);
+int json_escape_append(strbuf_t *out, const char *data, size_t len);
@@ -0,0 +1,770 @@
+// clang-format off
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json_request.h"
+#include "src/json_escape.h"
+#include "src/key.h"
+// clang-format on
+
+// 对象、数组的最大嵌套深度
+#define JSON_MAX_DEPTH 32
+
+// 请求体中有意义的字段
+typedef enum {
+  JSON_KEY_UNKNOWN = 0,
+  JSON_KEY_OPERATION,
+  JSON_KEY_TABLE,
+  JSON_KEY_DATA,
+  JSON_KEY_WHERE,
+  JSON_KEY_TRANSACTION,
+  JSON_KEY_ITEMS,
+  JSON_KEY_CURSOR,
+  JSON_KEY_PAGE_SIZE,
+  JSON_KEY_PAGE_TOKEN,
+  JSON_KEY_COLUMNS,
+  JSON_KEY_ORDER_BY,
+  JSON_KEY_LIMIT,
+  JSON_KEY_PARAMS,
+} json_key_t;
+
+// 完美哈希，做法与 operation.c 相同：(首字符 ^ 长度) & 31 对全部字段名互不冲突
+#define KEY_SLOT(ch, len) ((((unsigned int)(ch)) ^ (unsigned int)(len)) & 31)
+#define KEY_ENTRY(ch, name, key) [KEY_SLOT(ch, sizeof(name) - 1)] = {name, sizeof(name) - 1, key}
+
+static const struct {
+  const char *name;
+  size_t len;
+  json_key_t key;
+} KEY_TABLE[32] = {
+    KEY_ENTRY('o', KEY_POST_OPERATION, JSON_KEY_OPERATION),
+    KEY_ENTRY('t', KEY_POST_TABLE, JSON_KEY_TABLE),
+    KEY_ENTRY('d', KEY_POST_DATA, JSON_KEY_DATA),
+    KEY_ENTRY('w', KEY_POST_WHERE, JSON_KEY_WHERE),
+    KEY_ENTRY('t', KEY_POST_TRANSACTION, JSON_KEY_TRANSACTION),
+    KEY_ENTRY('i', KEY_JSON_ITEMS, JSON_KEY_ITEMS),
+    KEY_ENTRY('c', KEY_POST_CURSOR, JSON_KEY_CURSOR),
+    KEY_ENTRY('p', KEY_POST_PAGE_SIZE, JSON_KEY_PAGE_SIZE),
+    KEY_ENTRY('p', KEY_POST_PAGE_TOKEN, JSON_KEY_PAGE_TOKEN),
+    KEY_ENTRY('c', KEY_POST_COLUMNS, JSON_KEY_COLUMNS),
+    KEY_ENTRY('o', KEY_POST_ORDER_BY, JSON_KEY_ORDER_BY),
+    KEY_ENTRY('l', KEY_POST_LIMIT, JSON_KEY_LIMIT),
+    KEY_ENTRY('p', KEY_JSON_PARAMS, JSON_KEY_PARAMS),
+};
+
+typedef struct {
+  char *start;
+  char *pos;
+  char *end;
+  const char *error;
+  int depth;
+  char *key; // parse_object() 当前成员的字段名
+  size_t key_len;
+} parser_t;
+
+typedef int (*member_fn)(parser_t *p, json_key_t key, void *ctx);
+typedef int (*element_fn)(parser_t *p, void *ctx);
+
+/**
+ * @brief 查找字段名
+ */
+static json_key_t key_lookup(const char *name, size_t len) {
+  if (len == 0) {
+    return JSON_KEY_UNKNOWN;
+  }
+  unsigned int slot = KEY_SLOT(name[0], len);
+  if (KEY_TABLE[slot].len == len && memcmp(KEY_TABLE[slot].name, name, len) == 0) {
+    return KEY_TABLE[slot].key;
+  }
+  return JSON_KEY_UNKNOWN;
+}
+
+/**
+ * @brief 记录错误，错误位置为当前位置
+ */
+static int parse_error(parser_t *p, const char *message) {
+  if (!p->error) {
+    p->error = message;
+  }
+  return -1;
+}
+
+/**
+ * @brief 当前字符，到达末尾时返回 '\0'
+ */
+static char peek(const parser_t *p) { return p->pos < p->end ? *p->pos : '\0'; }
+
+static void skip_ws(parser_t *p) {
+  while (p->pos < p->end &&
+         (*p->pos == ' ' || *p->pos == '\t' || *p->pos == '\n' || *p->pos == '\r')) {
+    ++p->pos;
+  }
+}
+
+static int expect(parser_t *p, char ch, const char *message) {
+  skip_ws(p);
+  if (peek(p) != ch) {
+    return parse_error(p, message);
+  }
+  ++p->pos;
+  return 0;
+}
+
+static int parse_literal(parser_t *p, const char *literal) {
+  size_t len = strlen(literal);
+  if ((size_t)(p->end - p->pos) < len || memcmp(p->pos, literal, len) != 0) {
+    return parse_error(p, "invalid literal");
+  }
+  p->pos += len;
+  return 0;
+}
+
+/**
+ * @brief 解析 4 位十六进制数
+ */
+static int parse_hex4(const char *src, const char *end, unsigned int *out) {
+  if (end - src < 4) {
+    return -1;
+  }
+  unsigned int value = 0;
+  for (int i = 0; i < 4; ++i) {
+    char ch = src[i];
+    value <<= 4;
+    if (ch >= '0' && ch <= '9') {
+      value |= (unsigned int)(ch - '0');
+    } else if (ch >= 'a' && ch <= 'f') {
+      value |= (unsigned int)(ch - 'a' + 10);
+    } else if (ch >= 'A' && ch <= 'F') {
+      value |= (unsigned int)(ch - 'A' + 10);
+    } else {
+      return -1;
+    }
+  }
+  *out = value;
+  return 0;
+}
+
+/**
+ * @brief 将码点编码为 UTF-8
+ *
+ * @return size_t 写入的字节数
+ */
+static size_t utf8_encode(unsigned int cp, char *dst) {
+  if (cp < 0x80) {
+    dst[0] = (char)cp;
+    return 1;
+  }
+  if (cp < 0x800) {
+    dst[0] = (char)(0xC0 | (cp >> 6));
+    dst[1] = (char)(0x80 | (cp & 0x3F));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    dst[0] = (char)(0xE0 | (cp >> 12));
+    dst[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    dst[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  dst[0] = (char)(0xF0 | (cp >> 18));
+  dst[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+  dst[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+  dst[3] = (char)(0x80 | (cp & 0x3F));
+  return 4;
+}
+
+/**
+ * @brief 解析 \uXXXX 转义（含代理对），src 指向 'u' 之后
+ *
+ * @return int 成功（0）；失败（-1）
+ */
+static int parse_unicode_escape(parser_t *p, char **src, char **dst) {
+  unsigned int cp;
+  if (parse_hex4(*src, p->end, &cp) != 0) {
+    return parse_error(p, "invalid \\u escape");
+  }
+  *src += 4;
+  if (cp >= 0xD800 && cp <= 0xDBFF) {
+    unsigned int low;
+    if (p->end - *src < 6 || (*src)[0] != '\\' || (*src)[1] != 'u' ||
+        parse_hex4(*src + 2, p->end, &low) != 0 || low < 0xDC00 || low > 0xDFFF) {
+      return parse_error(p, "invalid surrogate pair");
+    }
+    *src += 6;
+    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+  } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+    return parse_error(p, "invalid surrogate pair");
+  }
+  // 字段以 '\0' 结尾的字符串交给数据库层，不能包含 '\0'
+  if (cp == 0) {
+    return parse_error(p, "\\u0000 is not allowed");
+  }
+  // 转义序列至少 6 字节，编码结果至多 4 字节，写入位置不会超过读取位置
+  *dst += utf8_encode(cp, *dst);
+  return 0;
+}
+
+/**
+ * @brief 原地解析字符串：去掉引号、还原转义并以 '\0' 结尾，没有转义时不移动任何数据
+ *
+ * @param p 解析器，当前位置为左引号
+ * @param out 输出字符串，指向请求体内部
+ * @param out_len 输出字符串长度
+ * @return int 成功（0）；失败（-1）
+ */
+static int parse_string(parser_t *p, char **out, size_t *out_len) {
+  char *start = ++p->pos;
+  char *src = start;
+  char *dst = start;
+
+  for (;;) {
+    // 引号、反斜杠和控制字符以外的字节整段跳过（SIMD）
+    size_t n = json_escape_scan(src, (size_t)(p->end - src));
+    if (dst != src) {
+      memmove(dst, src, n);
+    }
+    src += n;
+    dst += n;
+    p->pos = src;
+
+    if (src >= p->end) {
+      return parse_error(p, "unterminated string");
+    }
+    if (*src == '"') {
+      *dst = '\0';
+      *out = start;
+      *out_len = (size_t)(dst - start);
+      p->pos = src + 1;
+      return 0;
+    }
+    if (*src != '\\') {
+      return parse_error(p, "control character in string");
+    }
+    if (p->end - src < 2) {
+      return parse_error(p, "unterminated string");
+    }
+
+    char esc = src[1];
+    src += 2;
+    switch (esc) {
+    case '"':
+    case '\\':
+    case '/':
+      *dst++ = esc;
+      break;
+    case 'b':
+      *dst++ = '\b';
+      break;
+    case 'f':
+      *dst++ = '\f';
+      break;
+    case 'n':
+      *dst++ = '\n';
+      break;
+    case 'r':
+      *dst++ = '\r';
+      break;
+    case 't':
+      *dst++ = '\t';
+      break;
+    case 'u':
+      if (parse_unicode_escape(p, &src, &dst) != 0) {
+        return -1;
+      }
+      break;
+    default:
+      return parse_error(p, "invalid escape");
+    }
+  }
+}
+
+/**
+ * @brief 跳过数字
+ */
+static int skip_number(parser_t *p) {
+  if (peek(p) == '-') {
+    ++p->pos;
+  }
+  if (peek(p) < '0' || peek(p) > '9') {
+    return parse_error(p, "invalid number");
+  }
+  // 不允许前导零
+  if (*p->pos++ != '0') {
+    while (peek(p) >= '0' && peek(p) <= '9') {
+      ++p->pos;
+    }
+  }
+  if (peek(p) == '.') {
+    ++p->pos;
+    if (peek(p) < '0' || peek(p) > '9') {
+      return parse_error(p, "invalid number");
+    }
+    while (peek(p) >= '0' && peek(p) <= '9') {
+      ++p->pos;
+    }
+  }
+  if (peek(p) == 'e' || peek(p) == 'E') {
+    ++p->pos;
+    if (peek(p) == '+' || peek(p) == '-') {
+      ++p->pos;
+    }
+    if (peek(p) < '0' || peek(p) > '9') {
+      return parse_error(p, "invalid number");
+    }
+    while (peek(p) >= '0' && peek(p) <= '9') {
+      ++p->pos;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief 解析对象，对每个成员调用 member()，调用时当前位置为值的开头
+ */
+static int parse_object(parser_t *p, member_fn member, void *ctx) {
+  if (expect(p, '{', "expected object") != 0) {
+    return -1;
+  }
+  if (++p->depth > JSON_MAX_DEPTH) {
+    return parse_error(p, "nesting too deep");
+  }
+
+  skip_ws(p);
+  if (peek(p) == '}') {
+    ++p->pos;
+    --p->depth;
+    return 0;
+  }
+  for (;;) {
+    skip_ws(p);
+    if (peek(p) != '"') {
+      return parse_error(p, "expected string key");
+    }
+    char *key;
+    size_t key_len;
+    if (parse_string(p, &key, &key_len) != 0 || expect(p, ':', "expected ':'") != 0) {
+      return -1;
+    }
+    skip_ws(p);
+    p->key = key;
+    p->key_len = key_len;
+    if (member(p, key_lookup(key, key_len), ctx) != 0) {
+      return -1;
+    }
+
+    skip_ws(p);
+    if (peek(p) == ',') {
+      ++p->pos;
+      continue;
+    }
+    if (expect(p, '}', "expected ',' or '}'") != 0) {
+      return -1;
+    }
+    --p->depth;
+    return 0;
+  }
+}
+
+/**
+ * @brief 解析数组，对每个元素调用 element()，调用时当前位置为元素的开头
+ */
+static int parse_array(parser_t *p, element_fn element, void *ctx) {
+  if (expect(p, '[', "expected array") != 0) {
+    return -1;
+  }
+  if (++p->depth > JSON_MAX_DEPTH) {
+    return parse_error(p, "nesting too deep");
+  }
+
+  skip_ws(p);
+  if (peek(p) == ']') {
+    ++p->pos;
+    --p->depth;
+    return 0;
+  }
+  for (;;) {
+    skip_ws(p);
+    if (element(p, ctx) != 0) {
+      return -1;
+    }
+
+    skip_ws(p);
+    if (peek(p) == ',') {
+      ++p->pos;
+      continue;
+    }
+    if (expect(p, ']', "expected ',' or ']'") != 0) {
+      return -1;
+    }
+    --p->depth;
+    return 0;
+  }
+}
+
+static int skip_value(parser_t *p);
+
+static int skip_member(parser_t *p, json_key_t key, void *ctx) {
+  (void)key;
+  (void)ctx;
+  return skip_value(p);
+}
+
+static int skip_element(parser_t *p, void *ctx) {
+  (void)ctx;
+  return skip_value(p);
+}
+
+/**
+ * @brief 校验并跳过任意值
+ */
+static int skip_value(parser_t *p) {
+  char *str;
+  size_t len;
+  switch (peek(p)) {
+  case '"':
+    return parse_string(p, &str, &len);
+  case '{':
+    return parse_object(p, skip_member, NULL);
+  case '[':
+    return parse_array(p, skip_element, NULL);
+  case 't':
+    return parse_literal(p, "true");
+  case 'f':
+    return parse_literal(p, "false");
+  case 'n':
+    return parse_literal(p, "null");
+  default:
+    return skip_number(p);
+  }
+}
+
+/**
+ * @brief 解析字符串字段，null 表示未设置
+ */
+static int parse_field(parser_t *p, char **field) {
+  size_t len;
+  if (peek(p) == 'n') {
+    *field = NULL;
+    return parse_literal(p, "null");
+  }
+  if (peek(p) != '"') {
+    return parse_error(p, "expected string or null");
+  }
+  return parse_string(p, field, &len);
+}
+
+/**
+ * @brief 解析非负整数字段，null 表示未设置（0）
+ */
+static int parse_count(parser_t *p, unsigned long *value) {
+  *value = 0;
+  if (peek(p) == 'n') {
+    return parse_literal(p, "null");
+  }
+  if (peek(p) < '0' || peek(p) > '9') {
+    return parse_error(p, "expected non-negative integer or null");
+  }
+  while (peek(p) >= '0' && peek(p) <= '9') {
+    if (*value > (UINT32_MAX - (unsigned long)(peek(p) - '0')) / 10) {
+      return parse_error(p, "integer out of range");
+    }
+    *value = *value * 10 + (unsigned long)(*p->pos++ - '0');
+  }
+  if (peek(p) == '.' || peek(p) == 'e' || peek(p) == 'E') {
+    return parse_error(p, "expected non-negative integer or null");
+  }
+  return 0;
+}
+
+static int parse_bool(parser_t *p, bool *value) {
+  if (peek(p) == 't') {
+    *value = true;
+    return parse_literal(p, "true");
+  }
+  if (peek(p) == 'f') {
+    *value = false;
+    return parse_literal(p, "false");
+  }
+  return parse_error(p, "expected true or false");
+}
+
+/**
+ * @brief 解析数字参数：整数按 long long 发送，小数和指数按 double 发送，
+ *        超出 long long 的整数按原文以字符串发送，由 MySQL 转换，不损失精度
+ */
+static int parse_number_param(parser_t *p, db_param_t *param) {
+  char *start = p->pos;
+  if (skip_number(p) != 0) {
+    return -1;
+  }
+  size_t len = (size_t)(p->pos - start);
+  char text[64];
+  if (len >= sizeof(text)) {
+    return parse_error(p, "number too long");
+  }
+  memcpy(text, start, len);
+  text[len] = '\0';
+
+  errno = 0;
+  if (strcspn(text, ".eE") == len) {
+    param->i = strtoll(text, NULL, 10);
+    param->type = DB_PARAM_INT;
+    if (errno == ERANGE) {
+      param->type = DB_PARAM_STRING;
+      param->str = start;
+      param->len = len;
+    }
+    return 0;
+  }
+  param->d = strtod(text, NULL);
+  param->type = DB_PARAM_DOUBLE;
+  return 0;
+}
+
+static int param_element(parser_t *p, void *ctx) {
+  db_params_t *params = (db_params_t *)ctx;
+  if (params->count >= DB_PARAMS_MAX) {
+    params->overflow = true;
+    return skip_value(p);
+  }
+
+  db_param_t *param = &params->values[params->count];
+  bool value = false;
+  char *str;
+  switch (peek(p)) {
+  case '"':
+    if (parse_string(p, &str, &param->len) != 0) {
+      return -1;
+    }
+    param->type = DB_PARAM_STRING;
+    param->str = str;
+    break;
+  case 't':
+  case 'f':
+    // MySQL 的 BOOL 即 TINYINT(1)
+    if (parse_bool(p, &value) != 0) {
+      return -1;
+    }
+    param->type = DB_PARAM_INT;
+    param->i = value ? 1 : 0;
+    break;
+  case 'n':
+    if (parse_literal(p, "null") != 0) {
+      return -1;
+    }
+    param->type = DB_PARAM_NULL;
+    break;
+  case '{':
+  case '[':
+    return parse_error(p, "expected string, number, boolean or null");
+  default:
+    if (parse_number_param(p, param) != 0) {
+      return -1;
+    }
+  }
+  ++params->count;
+  return 0;
+}
+
+/**
+ * @brief 解析参数数组，null 表示没有参数
+ */
+static int parse_params(parser_t *p, json_request_t *req) {
+  if (peek(p) == 'n') {
+    req->has_params = false;
+    return parse_literal(p, "null");
+  }
+  if (!req->params) {
+    return skip_value(p);
+  }
+  req->params->count = 0;
+  req->params->overflow = false;
+  req->has_params = true;
+  return parse_array(p, param_element, req->params);
+}
+
+static int item_member(parser_t *p, json_key_t key, void *ctx) {
+  batch_item_t *item = (batch_item_t *)ctx;
+  switch (key) {
+  case JSON_KEY_OPERATION:
+    return parse_field(p, &item->operation);
+  case JSON_KEY_TABLE:
+    return parse_field(p, &item->table);
+  case JSON_KEY_DATA:
+    return parse_field(p, &item->data);
+  case JSON_KEY_WHERE:
+    return parse_field(p, &item->where);
+  default:
+    return skip_value(p);
+  }
+}
+
+static int item_element(parser_t *p, void *ctx) {
+  json_request_t *req = (json_request_t *)ctx;
+  if (req->batch->num_items >= BATCH_MAX_ITEMS) {
+    req->batch_overflow = true;
+    return skip_value(p);
+  }
+  batch_item_t *item = batch_add_item(req->batch);
+  if (!item) {
+    return parse_error(p, "out of memory");
+  }
+  return parse_object(p, item_member, item);
+}
+
+static int request_member(parser_t *p, json_key_t key, void *ctx) {
+  json_request_t *req = (json_request_t *)ctx;
+  switch (key) {
+  case JSON_KEY_OPERATION:
+    return parse_field(p, &req->operation);
+  case JSON_KEY_TABLE:
+    return parse_field(p, &req->table);
+  case JSON_KEY_DATA:
+    return parse_field(p, &req->data);
+  case JSON_KEY_WHERE:
+    return parse_field(p, &req->where);
+  case JSON_KEY_TRANSACTION:
+    return parse_bool(p, &req->batch->transaction);
+  case JSON_KEY_ITEMS:
+    return parse_array(p, item_element, req);
+  case JSON_KEY_CURSOR:
+    return parse_field(p, &req->cursor);
+  case JSON_KEY_PAGE_SIZE:
+    return parse_count(p, &req->page_size);
+  case JSON_KEY_PAGE_TOKEN:
+    return parse_field(p, &req->page_token);
+  case JSON_KEY_COLUMNS:
+    return parse_field(p, &req->columns);
+  case JSON_KEY_ORDER_BY:
+    return parse_field(p, &req->order_by);
+  case JSON_KEY_LIMIT:
+    return parse_count(p, &req->limit);
+  case JSON_KEY_PARAMS:
+    return parse_params(p, req);
+  default:
+    return skip_value(p);
+  }
+}
+
+/**
+ * @brief 原地解析 JSON 请求体，字段直接指向请求体内部，不另行分配
+ *
+ * @param body 请求体，解析时会被改写
+ * @param len 请求体长度
+ * @param req 解析结果，req->batch 需要预先初始化，req->params 需要预先设置
+ * @param error 解析失败时的错误信息
+ * @return int 成功（0）；失败（-1）
+ */
+int json_request_parse(char *body, size_t len, json_request_t *req, json_request_error_t *error) {
+  parser_t p = {body, body, body + len, NULL, 0, NULL, 0};
+  req->operation = NULL;
+  req->table = NULL;
+  req->data = NULL;
+  req->where = NULL;
+  req->cursor = NULL;
+  req->page_size = 0;
+  req->page_token = NULL;
+  req->columns = NULL;
+  req->order_by = NULL;
+  req->limit = 0;
+  req->batch_overflow = false;
+  req->has_params = false;
+  if (req->params) {
+    req->params->count = 0;
+    req->params->overflow = false;
+  }
+
+  if (parse_object(&p, request_member, req) == 0) {
+    skip_ws(&p);
+    if (p.pos != p.end) {
+      parse_error(&p, "unexpected data after object");
+    }
+  }
+  if (p.error) {
+    error->message = p.error;
+    error->offset = (size_t)(p.pos - p.start);
+    return -1;
+  }
+  return 0;
+}
+
+static int row_member(parser_t *p, json_key_t key, void *ctx) {
+  (void)key;
+  json_row_t *row = (json_row_t *)ctx;
+  if (row->count >= JSON_ROW_MAX_COLUMNS) {
+    return parse_error(p, "too many columns");
+  }
+
+  json_row_value_t *value = &row->values[row->count];
+  value->name = p->key;
+  value->name_len = p->key_len;
+  value->value = NULL;
+  value->len = 0;
+  char *start = p->pos;
+  char *str;
+  switch (peek(p)) {
+  case '"':
+    if (parse_string(p, &str, &value->len) != 0) {
+      return -1;
+    }
+    value->type = JSON_VALUE_STRING;
+    value->value = str;
+    break;
+  case 't':
+  case 'f': {
+    bool flag = false;
+    if (parse_bool(p, &flag) != 0) {
+      return -1;
+    }
+    value->type = JSON_VALUE_NUMBER;
+    value->value = flag ? "1" : "0";
+    value->len = 1;
+    break;
+  }
+  case 'n':
+    if (parse_literal(p, "null") != 0) {
+      return -1;
+    }
+    value->type = JSON_VALUE_NULL;
+    break;
+  case '{':
+  case '[':
+    return parse_error(p, "expected string, number, boolean or null");
+  default:
+    // 数字的语法已校验，原文可以直接写进语句，不经过 double 而损失精度
+    if (skip_number(p) != 0) {
+      return -1;
+    }
+    value->type = JSON_VALUE_NUMBER;
+    value->value = start;
+    value->len = (size_t)(p->pos - start);
+  }
+  ++row->count;
+  return 0;
+}
+
+/**
+ * @brief 原地解析 NDJSON 批量写入的一行，字段名和值直接指向行内部
+ *
+ * @param line 一行，不含换行符，解析时会被改写
+ * @param len 长度
+ * @param row 解析结果
+ * @param error 解析失败时的错误信息，offset 为在行内的偏移
+ * @return int 成功（0）；失败（-1）
+ */
+int json_row_parse(char *line, size_t len, json_row_t *row, json_request_error_t *error) {
+  parser_t p = {line, line, line + len, NULL, 0, NULL, 0};
+  row->count = 0;
+  if (parse_object(&p, row_member, row) == 0) {
+    skip_ws(&p);
+    if (p.pos != p.end) {
+      parse_error(&p, "unexpected data after object");
+    }
+  }
+  if (p.error) {
+    error->message = p.error;
+    error->offset = (size_t)(p.pos - p.start);
+    return -1;
+  }
+  return 0;
+}
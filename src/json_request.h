@@ -0,0 +1,63 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+#include "src/batch.h"
+#include "src/db_params.h"
+// clang-format on
+
+// JSON 请求体：
+//   {"operation": "...", "table": "...", "data": "...", "where": "...",
+//    "transaction": true, "items": [{"operation": "...", "table": "...", ...}, ...],
+//    "cursor": "...", "page_size": 100, "page_token": "...",
+//    "columns": "id, name", "order_by": "age DESC", "limit": 10, "params": [42, "bob", null]}
+// page_size 和 limit 为非负整数或 null，params 为数组或 null，其余字段值为字符串或 null，
+// 未知字段忽略
+typedef struct {
+  char *operation;
+  char *table;
+  char *data;
+  char *where;
+  char *cursor;            // operation=watch 的游标
+  unsigned long page_size; // operation=read 的每页行数，0 表示不分页
+  char *page_token;        // operation=read 上一页响应的续读令牌
+  char *columns;           // operation=read 只返回的列
+  char *order_by;          // operation=read 的排序
+  unsigned long limit;     // operation=read 最多返回的行数，0 表示不限
+  batch_t *batch;          // items 的条目及 transaction 写入此处
+  bool batch_overflow;     // 条目数超过 BATCH_MAX_ITEMS，多出的条目被忽略
+  db_params_t *params;     // params 的值写入此处，需要预先设置，为 NULL 时忽略 params
+  bool has_params;         // 请求中有 params 数组（可以为空），操作以预处理语句执行
+} json_request_t;
+
+typedef struct {
+  const char *message;
+  size_t offset; // 出错位置在请求体中的偏移
+} json_request_error_t;
+
+// NDJSON 批量写入中一行最多的列数
+#define JSON_ROW_MAX_COLUMNS 1024
+
+typedef enum {
+  JSON_VALUE_NULL = 0,
+  JSON_VALUE_NUMBER, // JSON 数字的原文，只含数字、符号、小数点和指数；true/false 为 1/0
+  JSON_VALUE_STRING, // 已还原转义的字符串，可以含 '\0'
+} json_value_type_t;
+
+typedef struct {
+  const char *name; // 列名，已还原转义
+  size_t name_len;
+  json_value_type_t type;
+  const char *value; // 指向行内部，NULL 值为 NULL
+  size_t len;
+} json_row_value_t;
+
+// NDJSON 批量写入的一行：{"列名": 值, ...}，值为字符串、数字、true/false 或 null
+typedef struct {
+  size_t count;
+  json_row_value_t values[JSON_ROW_MAX_COLUMNS];
+} json_row_t;
+
+int json_request_parse(char *body, size_t len, json_request_t *req, json_request_error_t *error);
+int json_row_parse(char *line, size_t len, json_row_t *row, json_request_error_t *error);
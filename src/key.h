@@ -4,11 +4,50 @@
 #define KEY_POST_TABLE "table"
 #define KEY_POST_DATA "data"
 #define KEY_POST_WHERE "where"
+#define KEY_POST_TRANSACTION "transaction"
+// operation=watch 上次返回的游标（GTID 集合）
+#define KEY_POST_CURSOR "cursor"
+// operation=read 分页：每页行数和上一页响应的续读令牌
+#define KEY_POST_PAGE_SIZE "page_size"
+#define KEY_POST_PAGE_TOKEN "page_token"
+// operation=read 只返回的列、排序和行数上限
+#define KEY_POST_COLUMNS "columns"
+#define KEY_POST_ORDER_BY "order_by"
+#define KEY_POST_LIMIT "limit"
+// 参数化操作中 '?' 的值：表单中每个值一个 param 字段，按出现顺序（都是字符串）
+#define KEY_POST_PARAM "param"
+// 批量操作的条目字段，每个 item_operation 开始一个新条目
+#define KEY_POST_ITEM_OPERATION "item_operation"
+#define KEY_POST_ITEM_TABLE "item_table"
+#define KEY_POST_ITEM_DATA "item_data"
+#define KEY_POST_ITEM_WHERE "item_where"
+// JSON 请求体中批量操作的条目数组
+#define KEY_JSON_ITEMS "items"
+// JSON 请求体中参数化操作的参数数组，元素为字符串、数字、true/false 或 null
+#define KEY_JSON_PARAMS "params"
+
+// 请求头：客户端愿意等待的毫秒数，服务端从收到请求起计算截止时间
+#define KEY_HEADER_DEADLINE "X-Deadline-Ms"
+#define KEY_HEADER_API_KEY "X-Api-Key"
+// 响应头：分页读取的下一页续读令牌，最后一页没有
+#define KEY_HEADER_NEXT_PAGE "X-Next-Page-Token"
 
 #define KEY_RESP_SUCCESS "success:"
 #define KEY_RESP_ERROR "error:"
+#define KEY_RESP_ITEM "item"
 
 #define KEY_OP_CREATE "create"
 #define KEY_OP_READ "read"
 #define KEY_OP_UPDATE "update"
 #define KEY_OP_DELETE "delete"
+#define KEY_OP_BATCH "batch"
+// 批量写入，行以 CSV 或 NDJSON 作为请求体流式上传，操作和表放在 URL 的查询参数中
+#define KEY_OP_BULK_CREATE "bulk_create"
+// 订阅表的行变更，不属于 db_op_t，不经过数据库工作线程
+#define KEY_OP_WATCH "watch"
+
+#define KEY_MIME_TEXT "text/plain"
+#define KEY_MIME_ROWSET "application/x-dbmanager-rowset"
+#define KEY_MIME_JSON "application/json"
+#define KEY_MIME_NDJSON "application/x-ndjson"
+#define KEY_MIME_CSV "text/csv"
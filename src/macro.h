@@ -4,3 +4,5 @@
 #define STR_HELPER(x) STR(x)
 
 #define HTTP_PORT 60001
+// 二进制协议的常用端口，daemon 需要 --binary-port 才会监听
+#define WIRE_PORT 60002
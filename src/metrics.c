@@ -0,0 +1,288 @@
+// clang-format off
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "metrics.h"
+// clang-format on
+
+// 下一个线程使用的分片
+static atomic_uint next_shard = 0;
+// 当前线程使用的分片，UINT_MAX 表示尚未分配
+static _Thread_local unsigned int thread_shard = UINT_MAX;
+
+/**
+ * @brief 创建指标对象，所有计数器清零
+ *
+ * @return metrics_t* 指标对象；失败返回 NULL
+ */
+metrics_t *metrics_create(void) {
+  metrics_t *metrics = aligned_alloc(alignof(metrics_shard_t), sizeof(metrics_t));
+  if (!metrics) {
+    return NULL;
+  }
+  // 全零即为原子计数器的初始状态
+  memset(metrics, 0, sizeof(metrics_t));
+  return metrics;
+}
+
+/**
+ * @brief 销毁指标对象
+ *
+ * @param metrics 指标对象
+ */
+void metrics_destroy(metrics_t *metrics) { free(metrics); }
+
+/**
+ * @brief 获取当前线程的分片；线程固定使用一个分片，线程数不超过分片数时计数互不竞争
+ *
+ * @param metrics 指标对象
+ * @return metrics_shard_t* 分片
+ */
+metrics_shard_t *metrics_shard(metrics_t *metrics) {
+  if (thread_shard == UINT_MAX) {
+    thread_shard = atomic_fetch_add_explicit(&next_shard, 1, memory_order_relaxed) % METRICS_SHARDS;
+  }
+  return &metrics->shards[thread_shard];
+}
+
+/**
+ * @brief 计算延迟所在的桶：上界 METRICS_BUCKET_BASE_US << i 不小于延迟的最小 i
+ *
+ * @param latency_us 延迟
+ * @return int 桶下标，超过最大上界时为 METRICS_LATENCY_BUCKETS（+Inf）
+ */
+int metrics_latency_bucket(uint64_t latency_us) {
+  // 向上取整，写成这样避免 latency_us 接近 UINT64_MAX 时溢出
+  uint64_t units =
+      latency_us / METRICS_BUCKET_BASE_US + (latency_us % METRICS_BUCKET_BASE_US != 0);
+  int bucket = units <= 1 ? 0 : 64 - __builtin_clzll(units - 1);
+  return bucket < METRICS_LATENCY_BUCKETS ? bucket : METRICS_LATENCY_BUCKETS;
+}
+
+/**
+ * @brief 累加计数器，只保证原子性，不建立同步关系
+ *
+ * @param counter 计数器
+ * @param n 增量
+ */
+void metrics_add(atomic_ullong *counter, unsigned long long n) {
+  atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+/**
+ * @brief 记录一个已完成的请求
+ *
+ * @param metrics 指标对象
+ * @param op 操作类型
+ * @param failed 是否失败
+ * @param latency_us 从收到请求到响应结束的时间
+ */
+void metrics_record_request(metrics_t *metrics, db_op_t op, bool failed, uint64_t latency_us) {
+  metrics_shard_t *shard = metrics_shard(metrics);
+  metrics_add(&shard->requests[op], 1);
+  if (failed) {
+    metrics_add(&shard->errors[op], 1);
+  }
+  metrics_add(&shard->latency_sum_us[op], latency_us);
+  metrics_add(&shard->latency_buckets[op][metrics_latency_bucket(latency_us)], 1);
+}
+
+/**
+ * @brief 汇总各分片的计数；与记录并发进行，各计数器之间不保证是同一时刻的值
+ *
+ * @param metrics 指标对象
+ * @param snapshot 输出汇总结果
+ */
+void metrics_snapshot(metrics_t *metrics, metrics_snapshot_t *snapshot) {
+  memset(snapshot, 0, sizeof(metrics_snapshot_t));
+  for (int s = 0; s < METRICS_SHARDS; ++s) {
+    metrics_shard_t *shard = &metrics->shards[s];
+    for (int op = 0; op < METRICS_NUM_OPS; ++op) {
+      snapshot->requests[op] += atomic_load_explicit(&shard->requests[op], memory_order_relaxed);
+      snapshot->errors[op] += atomic_load_explicit(&shard->errors[op], memory_order_relaxed);
+      snapshot->latency_sum_us[op] +=
+          atomic_load_explicit(&shard->latency_sum_us[op], memory_order_relaxed);
+      for (int b = 0; b <= METRICS_LATENCY_BUCKETS; ++b) {
+        snapshot->latency_buckets[op][b] +=
+            atomic_load_explicit(&shard->latency_buckets[op][b], memory_order_relaxed);
+      }
+    }
+    snapshot->bytes_in += atomic_load_explicit(&shard->bytes_in, memory_order_relaxed);
+    snapshot->bytes_out += atomic_load_explicit(&shard->bytes_out, memory_order_relaxed);
+    snapshot->arena_allocs += atomic_load_explicit(&shard->arena_allocs, memory_order_relaxed);
+    snapshot->arena_blocks += atomic_load_explicit(&shard->arena_blocks, memory_order_relaxed);
+    snapshot->arena_bytes += atomic_load_explicit(&shard->arena_bytes, memory_order_relaxed);
+    snapshot->not_modified += atomic_load_explicit(&shard->not_modified, memory_order_relaxed);
+    snapshot->bulk_rows += atomic_load_explicit(&shard->bulk_rows, memory_order_relaxed);
+    snapshot->bulk_batches += atomic_load_explicit(&shard->bulk_batches, memory_order_relaxed);
+    snapshot->bulk_batch_errors +=
+        atomic_load_explicit(&shard->bulk_batch_errors, memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief 输出一个不带标签的指标
+ */
+static int render_metric(strbuf_t *out, const char *name, const char *type, const char *help,
+                         unsigned long long value) {
+  return strbuf_appendf(out, "# HELP " METRIC_PREFIX "%s %s\n# TYPE " METRIC_PREFIX "%s %s\n"
+                             METRIC_PREFIX "%s %llu\n",
+                        name, help, name, type, name, value);
+}
+
+/**
+ * @brief 输出一个小数值的指标，秒数和比例
+ */
+static int render_double(strbuf_t *out, const char *name, const char *type, const char *help,
+                         double value) {
+  return strbuf_appendf(out, "# HELP " METRIC_PREFIX "%s %s\n# TYPE " METRIC_PREFIX "%s %s\n"
+                             METRIC_PREFIX "%s %.6f\n",
+                        name, help, name, type, name, value);
+}
+
+/**
+ * @brief 输出按操作区分的请求数、错误数和延迟直方图
+ */
+static int render_requests(const metrics_snapshot_t *snapshot, strbuf_t *out) {
+  int rc = strbuf_append_str(out, "# HELP " METRIC_PREFIX "requests_total Completed requests.\n"
+                                  "# TYPE " METRIC_PREFIX "requests_total counter\n");
+  for (int op = 0; rc == 0 && op < METRICS_NUM_OPS; ++op) {
+    rc = strbuf_appendf(out, METRIC_PREFIX "requests_total{operation=\"%s\"} %llu\n",
+                        db_op_name((db_op_t)op), snapshot->requests[op]);
+  }
+
+  rc = rc || strbuf_append_str(out,
+                               "# HELP " METRIC_PREFIX "request_errors_total Requests answered "
+                               "with an error.\n"
+                               "# TYPE " METRIC_PREFIX "request_errors_total counter\n");
+  for (int op = 0; rc == 0 && op < METRICS_NUM_OPS; ++op) {
+    rc = strbuf_appendf(out, METRIC_PREFIX "request_errors_total{operation=\"%s\"} %llu\n",
+                        db_op_name((db_op_t)op), snapshot->errors[op]);
+  }
+
+  rc = rc || strbuf_append_str(out,
+                               "# HELP " METRIC_PREFIX "request_duration_seconds Time from "
+                               "receiving a request to finishing its response.\n"
+                               "# TYPE " METRIC_PREFIX "request_duration_seconds histogram\n");
+  for (int op = 0; rc == 0 && op < METRICS_NUM_OPS; ++op) {
+    const char *name = db_op_name((db_op_t)op);
+    unsigned long long cumulative = 0;
+    for (int b = 0; rc == 0 && b < METRICS_LATENCY_BUCKETS; ++b) {
+      cumulative += snapshot->latency_buckets[op][b];
+      rc = strbuf_appendf(out,
+                          METRIC_PREFIX "request_duration_seconds_bucket{operation=\"%s\","
+                                        "le=\"%g\"} %llu\n",
+                          name, (double)((uint64_t)METRICS_BUCKET_BASE_US << b) / 1e6, cumulative);
+    }
+    cumulative += snapshot->latency_buckets[op][METRICS_LATENCY_BUCKETS];
+    rc = rc ||
+         strbuf_appendf(out,
+                        METRIC_PREFIX "request_duration_seconds_bucket{operation=\"%s\","
+                                      "le=\"+Inf\"} %llu\n" METRIC_PREFIX
+                                      "request_duration_seconds_sum{operation=\"%s\"} %.6f\n"
+                                      METRIC_PREFIX
+                                      "request_duration_seconds_count{operation=\"%s\"} %llu\n",
+                        name, cumulative, name, (double)snapshot->latency_sum_us[op] / 1e6, name,
+                        cumulative);
+  }
+  return rc;
+}
+
+/**
+ * @brief 以 Prometheus 文本格式输出全部指标
+ *
+ * @param snapshot 计数器汇总
+ * @param gauges 瞬时值
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int metrics_render(const metrics_snapshot_t *snapshot, const metrics_gauges_t *gauges,
+                   strbuf_t *out) {
+  int rc = render_requests(snapshot, out) ||
+           render_metric(out, "http_received_bytes_total", "counter",
+                         "Request body bytes received.", snapshot->bytes_in) ||
+           render_metric(out, "http_sent_bytes_total", "counter",
+                         "Response body bytes sent, after compression.", snapshot->bytes_out) ||
+           render_metric(out, "request_arena_allocations_total", "counter",
+                         "Allocations carved out of request arenas.", snapshot->arena_allocs) ||
+           render_metric(out, "request_arena_blocks_total", "counter",
+                         "Heap blocks allocated by request arenas.", snapshot->arena_blocks) ||
+           render_metric(out, "request_arena_bytes_total", "counter",
+                         "Bytes allocated from request arenas.", snapshot->arena_bytes) ||
+           render_metric(out, "read_not_modified_total", "counter",
+                         "Reads answered 304 from the table version without querying MySQL.",
+                         snapshot->not_modified) ||
+           render_metric(out, "bulk_rows_total", "counter", "Rows inserted by bulk_create.",
+                         snapshot->bulk_rows) ||
+           render_metric(out, "bulk_batches_total", "counter",
+                         "Multi-row INSERT statements executed by bulk_create.",
+                         snapshot->bulk_batches) ||
+           render_metric(out, "bulk_batch_errors_total", "counter",
+                         "bulk_create batches rejected by MySQL.", snapshot->bulk_batch_errors) ||
+           render_metric(out, "pool_connections", "gauge", "Connections in the MySQL pool.",
+                         (unsigned long long)gauges->pool_size) ||
+           render_metric(out, "pool_active_connections", "gauge", "Pooled connections in use.",
+                         (unsigned long long)gauges->active_connections) ||
+           render_metric(out, "pool_waiters", "gauge",
+                         "Threads waiting for a free pooled connection.",
+                         (unsigned long long)gauges->pool_waiters) ||
+           render_metric(out, "pool_reconnects_total", "counter",
+                         "Pooled connections re-established after a failed health check.",
+                         gauges->reconnects) ||
+           render_metric(out, "mysql_retries_total", "counter",
+                         "Queries retried after a lost connection.", gauges->mysql_retries) ||
+           render_metric(out, "mysql_killed_queries_total", "counter",
+                         "Statements killed after their request deadline passed.",
+                         gauges->killed_queries) ||
+           render_metric(out, "pending_requests", "gauge",
+                         "Admitted requests that are queued or running.",
+                         (unsigned long long)gauges->pending_requests) ||
+           render_metric(out, "worker_queue_depth", "gauge",
+                         "Requests waiting in the DB worker queue.",
+                         (unsigned long long)gauges->worker_queue_depth) ||
+           render_metric(out, "shed_requests_total", "counter",
+                         "Requests rejected with 503 by admission control.",
+                         gauges->shed_requests) ||
+           render_metric(out, "read_cache_hits_total", "counter",
+                         "Reads answered from the result cache.", gauges->read_cache_hits) ||
+           render_metric(out, "read_cache_misses_total", "counter",
+                         "Cacheable reads that had to query MySQL.", gauges->read_cache_misses) ||
+           render_metric(out, "read_cache_evictions_total", "counter",
+                         "Result cache entries evicted to stay within the byte budget.",
+                         gauges->read_cache_evictions) ||
+           render_metric(out, "read_cache_invalidations_total", "counter",
+                         "Result cache entries dropped after a write to their table or expiry.",
+                         gauges->read_cache_invalidations) ||
+           render_metric(out, "read_cache_entries", "gauge", "Entries in the result cache.",
+                         gauges->read_cache_entries) ||
+           render_metric(out, "read_cache_bytes", "gauge",
+                         "Bytes held by the result cache, including keys.",
+                         gauges->read_cache_bytes) ||
+           render_metric(out, "read_coalesced_total", "counter",
+                         "Reads answered with the result of an identical read already in flight.",
+                         gauges->read_coalesced) ||
+           render_metric(out, "stmt_cache_hits_total", "counter",
+                         "Parameterized statements run on a handle already prepared on the "
+                         "connection.",
+                         gauges->stmt_cache_hits) ||
+           render_metric(out, "stmt_cache_misses_total", "counter",
+                         "Parameterized statements that had to be prepared first.",
+                         gauges->stmt_cache_misses) ||
+           render_metric(out, "stmt_cache_evictions_total", "counter",
+                         "Prepared statements closed to stay within the per-connection limit.",
+                         gauges->stmt_cache_evictions) ||
+           render_metric(out, "stmt_cache_invalidations_total", "counter",
+                         "Prepared statements dropped when their connection was re-established.",
+                         gauges->stmt_cache_invalidations) ||
+           render_double(out, "stmt_cache_hit_ratio", "gauge",
+                         "Share of parameterized statements that found a prepared handle.",
+                         gauges->stmt_cache_hit_ratio) ||
+           render_double(out, "stmt_prepare_seconds_total", "counter",
+                         "Time spent preparing statements.",
+                         (double)gauges->stmt_prepare_us / 1e6) ||
+           render_double(out, "stmt_prepare_saved_seconds_total", "counter",
+                         "Estimated prepare time saved by cache hits: hits times the mean "
+                         "prepare time.",
+                         (double)gauges->stmt_prepare_saved_us / 1e6);
+  return rc ? -1 : 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+// clang-format off
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "src/operation.h"
+#include "src/strbuf.h"
+// clang-format on
+
+// 计数器分片数，线程按首次使用的顺序轮流分配到各分片
+#define METRICS_SHARDS 16
+// 延迟直方图的有限桶数，第 i 个桶的上界为 METRICS_BUCKET_BASE_US << i（100us ~ 13.1s）
+#define METRICS_LATENCY_BUCKETS 18
+#define METRICS_BUCKET_BASE_US 100
+#define METRICS_NUM_OPS (DB_OP_BULK_CREATE + 1)
+// 指标名前缀
+#define METRIC_PREFIX "dbmanager_"
+
+// 一个分片的全部计数器，按缓存行对齐，不同分片之间没有伪共享
+typedef struct {
+  alignas(64) atomic_ullong requests[METRICS_NUM_OPS];
+  atomic_ullong errors[METRICS_NUM_OPS];
+  atomic_ullong latency_sum_us[METRICS_NUM_OPS];
+  // 最后一个桶为 +Inf，各桶不累积，输出时再累加
+  atomic_ullong latency_buckets[METRICS_NUM_OPS][METRICS_LATENCY_BUCKETS + 1];
+  atomic_ullong bytes_in;
+  atomic_ullong bytes_out;
+  atomic_ullong arena_allocs; // 请求内存区域内的分配次数
+  atomic_ullong arena_blocks; // 请求内存区域向堆申请内存的次数
+  atomic_ullong arena_bytes;
+  atomic_ullong not_modified; // ETag 未变、以 304 应答而没有查询 MySQL 的 READ
+  atomic_ullong bulk_rows;    // bulk_create 写入的行数
+  atomic_ullong bulk_batches; // bulk_create 执行的多行 INSERT 数
+  atomic_ullong bulk_batch_errors;
+} metrics_shard_t;
+
+typedef struct {
+  metrics_shard_t shards[METRICS_SHARDS];
+} metrics_t;
+
+// 各分片汇总后的计数
+typedef struct {
+  unsigned long long requests[METRICS_NUM_OPS];
+  unsigned long long errors[METRICS_NUM_OPS];
+  unsigned long long latency_sum_us[METRICS_NUM_OPS];
+  unsigned long long latency_buckets[METRICS_NUM_OPS][METRICS_LATENCY_BUCKETS + 1];
+  unsigned long long bytes_in;
+  unsigned long long bytes_out;
+  unsigned long long arena_allocs;
+  unsigned long long arena_blocks;
+  unsigned long long arena_bytes;
+  unsigned long long not_modified;
+  unsigned long long bulk_rows;
+  unsigned long long bulk_batches;
+  unsigned long long bulk_batch_errors;
+} metrics_snapshot_t;
+
+// 抓取时从各模块读取的瞬时值
+typedef struct {
+  int pool_size;
+  int active_connections;
+  int pool_waiters;
+  unsigned long long reconnects;
+  unsigned long long mysql_retries;
+  unsigned long long killed_queries;
+  int pending_requests;
+  int worker_queue_depth;
+  unsigned long long shed_requests;
+  unsigned long long read_cache_hits;
+  unsigned long long read_cache_misses;
+  unsigned long long read_cache_evictions;
+  unsigned long long read_cache_invalidations;
+  unsigned long long read_cache_entries;
+  unsigned long long read_cache_bytes;
+  unsigned long long read_coalesced;
+  unsigned long long stmt_cache_hits;
+  unsigned long long stmt_cache_misses;
+  unsigned long long stmt_cache_evictions;
+  unsigned long long stmt_cache_invalidations;
+  unsigned long long stmt_prepare_us;
+  unsigned long long stmt_prepare_saved_us; // 估计值：命中次数 × 平均准备耗时
+  double stmt_cache_hit_ratio;
+} metrics_gauges_t;
+
+metrics_t *metrics_create(void);
+void metrics_destroy(metrics_t *metrics);
+metrics_shard_t *metrics_shard(metrics_t *metrics);
+int metrics_latency_bucket(uint64_t latency_us);
+void metrics_record_request(metrics_t *metrics, db_op_t op, bool failed, uint64_t latency_us);
+void metrics_add(atomic_ullong *counter, unsigned long long n);
+void metrics_snapshot(metrics_t *metrics, metrics_snapshot_t *snapshot);
+int metrics_render(const metrics_snapshot_t *snapshot, const metrics_gauges_t *gauges,
+                   strbuf_t *out);
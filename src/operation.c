@@ -0,0 +1,73 @@
+// clang-format off
+#include <string.h>
+#include "operation.h"
+#include "src/key.h"
+// clang-format on
+
+// 完美哈希：(首字符 ^ 长度) & 7 对全部操作名互不冲突。新增操作名产生冲突时，重复的指派初始化
+// 会触发 -Woverride-init（-Wextra），需要换一个哈希函数
+#define OP_SLOT(ch, len) ((((unsigned int)(ch)) ^ (unsigned int)(len)) & 7)
+#define OP_ENTRY(ch, name, op) [OP_SLOT(ch, sizeof(name) - 1)] = {name, sizeof(name) - 1, op}
+
+static const struct {
+  const char *name;
+  size_t len;
+  db_op_t op;
+} OP_TABLE[8] = {
+    OP_ENTRY('c', KEY_OP_CREATE, DB_OP_CREATE), OP_ENTRY('r', KEY_OP_READ, DB_OP_READ),
+    OP_ENTRY('u', KEY_OP_UPDATE, DB_OP_UPDATE), OP_ENTRY('d', KEY_OP_DELETE, DB_OP_DELETE),
+    OP_ENTRY('b', KEY_OP_BATCH, DB_OP_BATCH), OP_ENTRY('b', KEY_OP_BULK_CREATE, DB_OP_BULK_CREATE),
+};
+
+/**
+ * @brief 查找操作类型，一次哈希加一次比较
+ *
+ * @param name 操作名（不要求以 '\0' 结尾）
+ * @param len 操作名长度
+ * @return db_op_t 操作类型，未知返回 DB_OP_UNKNOWN
+ */
+db_op_t db_op_lookup(const char *name, size_t len) {
+  if (!name || len == 0) {
+    return DB_OP_UNKNOWN;
+  }
+  unsigned int slot = OP_SLOT(name[0], len);
+  if (OP_TABLE[slot].len == len && memcmp(OP_TABLE[slot].name, name, len) == 0) {
+    return OP_TABLE[slot].op;
+  }
+  return DB_OP_UNKNOWN;
+}
+
+/**
+ * @brief 查找操作类型
+ *
+ * @param name 操作名，可以为 NULL
+ * @return db_op_t 操作类型，未知返回 DB_OP_UNKNOWN
+ */
+db_op_t db_op_from_str(const char *name) {
+  return name ? db_op_lookup(name, strlen(name)) : DB_OP_UNKNOWN;
+}
+
+/**
+ * @brief 获取操作名
+ *
+ * @param op 操作类型
+ * @return const char* 操作名，未知操作返回 "unknown"
+ */
+const char *db_op_name(db_op_t op) {
+  switch (op) {
+  case DB_OP_CREATE:
+    return KEY_OP_CREATE;
+  case DB_OP_READ:
+    return KEY_OP_READ;
+  case DB_OP_UPDATE:
+    return KEY_OP_UPDATE;
+  case DB_OP_DELETE:
+    return KEY_OP_DELETE;
+  case DB_OP_BATCH:
+    return KEY_OP_BATCH;
+  case DB_OP_BULK_CREATE:
+    return KEY_OP_BULK_CREATE;
+  default:
+    return "unknown";
+  }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// clang-format off
+#include <stddef.h>
+// clang-format on
+
+// 数据库操作类型，名称见 key.h 中的 KEY_OP_*
+typedef enum {
+  DB_OP_UNKNOWN = 0,
+  DB_OP_CREATE,
+  DB_OP_READ,
+  DB_OP_UPDATE,
+  DB_OP_DELETE,
+  DB_OP_BATCH,
+  DB_OP_BULK_CREATE,
+} db_op_t;
+
+db_op_t db_op_lookup(const char *name, size_t len);
+db_op_t db_op_from_str(const char *name);
+const char *db_op_name(db_op_t op);
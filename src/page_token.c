@@ -0,0 +1,198 @@
+// clang-format off
+#include <string.h>
+#include "page_token.h"
+// clang-format on
+
+#define FNV32_OFFSET 2166136261U
+#define FNV32_PRIME 16777619U
+
+#define FLAG_NUMERIC 0x01
+
+static const char BASE64URL[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static uint32_t fnv1a32(uint32_t hash, const char *str) {
+  for (const unsigned char *ptr = (const unsigned char *)str; *ptr; ++ptr) {
+    hash = (hash ^ *ptr) * FNV32_PRIME;
+  }
+  return hash;
+}
+
+static int base64url_value(char ch) {
+  const char *pos = ch ? strchr(BASE64URL, ch) : NULL;
+  return pos ? (int)(pos - BASE64URL) : -1;
+}
+
+/**
+ * @brief 查询摘要：表名和条件不同的查询不能互用令牌
+ *
+ * @param table 表名
+ * @param where 条件，可以为 NULL
+ * @return uint32_t 摘要
+ */
+uint32_t page_token_check(const char *table, const char *where) {
+  uint32_t hash = fnv1a32(FNV32_OFFSET, table);
+  hash = (hash ^ 0xFF) * FNV32_PRIME; // 分隔表名和条件
+  return fnv1a32(hash, where ? where : "");
+}
+
+/**
+ * @brief 初始化空令牌
+ *
+ * @param token 令牌
+ * @param check 查询摘要
+ */
+void page_token_init(page_token_t *token, uint32_t check) {
+  token->check = check;
+  token->num_values = 0;
+  token->used = 0;
+}
+
+/**
+ * @brief 追加一个主键值
+ *
+ * @param token 令牌
+ * @param value 值
+ * @param len 长度
+ * @param numeric 是否为数值列
+ * @return int 成功（0）；超过列数或字节数上限（-1）
+ */
+int page_token_add(page_token_t *token, const char *value, size_t len, bool numeric) {
+  if (token->num_values == PAGE_TOKEN_MAX_VALUES || len > PAGE_TOKEN_MAX_BYTES - token->used) {
+    return -1;
+  }
+  size_t i = token->num_values++;
+  token->offsets[i] = token->used;
+  token->lengths[i] = len;
+  token->numeric[i] = numeric;
+  memcpy(token->data + token->used, value, len);
+  token->used += len;
+  return 0;
+}
+
+/**
+ * @brief 取出第 index 个主键值
+ *
+ * @param token 令牌
+ * @param index 下标
+ * @param len 输出长度
+ * @return const char* 值，不以 '\0' 结尾
+ */
+const char *page_token_value(const page_token_t *token, size_t index, size_t *len) {
+  *len = token->lengths[index];
+  return token->data + token->offsets[index];
+}
+
+/**
+ * @brief 编码为 base64url 文本
+ *
+ * @param token 令牌
+ * @param out 输出，追加在已有内容之后
+ * @return int 成功（0）；失败（-1）
+ */
+int page_token_encode(const page_token_t *token, strbuf_t *out) {
+  unsigned char raw[6 + PAGE_TOKEN_MAX_VALUES * 3 + PAGE_TOKEN_MAX_BYTES];
+  size_t n = 0;
+  raw[n++] = PAGE_TOKEN_VERSION;
+  for (int shift = 0; shift < 32; shift += 8) {
+    raw[n++] = (unsigned char)(token->check >> shift);
+  }
+  raw[n++] = (unsigned char)token->num_values;
+  for (size_t i = 0; i < token->num_values; ++i) {
+    raw[n++] = token->numeric[i] ? FLAG_NUMERIC : 0;
+    raw[n++] = (unsigned char)token->lengths[i];
+    raw[n++] = (unsigned char)(token->lengths[i] >> 8);
+    memcpy(raw + n, token->data + token->offsets[i], token->lengths[i]);
+    n += token->lengths[i];
+  }
+
+  if (strbuf_reserve(out, (n + 2) / 3 * 4) != 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < n; i += 3) {
+    uint32_t bits = (uint32_t)raw[i] << 16;
+    bits |= i + 1 < n ? (uint32_t)raw[i + 1] << 8 : 0;
+    bits |= i + 2 < n ? raw[i + 2] : 0;
+    size_t chars = n - i >= 3 ? 4 : n - i + 1;
+    for (size_t j = 0; j < chars; ++j) {
+      out->data[out->len++] = BASE64URL[(bits >> (18 - 6 * j)) & 0x3F];
+    }
+  }
+  out->data[out->len] = '\0';
+  return 0;
+}
+
+/**
+ * @brief 数值列的值只能由数字、符号、小数点和指数组成，拼进语句时不加引号
+ */
+static bool numeric_literal(const char *value, size_t len) {
+  if (len == 0) {
+    return false;
+  }
+  for (size_t i = 0; i < len; ++i) {
+    if (!strchr("0123456789+-.eE", value[i]) || value[i] == '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief 解码客户端送回的令牌并校验
+ *
+ * @param text base64url 文本
+ * @param check 当前查询的摘要
+ * @param token 输出令牌
+ * @return int 成功（0）；格式错误或不属于当前查询（-1）
+ */
+int page_token_decode(const char *text, uint32_t check, page_token_t *token) {
+  unsigned char raw[6 + PAGE_TOKEN_MAX_VALUES * 3 + PAGE_TOKEN_MAX_BYTES];
+  size_t n = 0;
+  uint32_t bits = 0;
+  int num_bits = 0;
+  for (const char *ptr = text; *ptr; ++ptr) {
+    int value = base64url_value(*ptr);
+    if (value < 0) {
+      return -1;
+    }
+    bits = (bits << 6) | (uint32_t)value;
+    num_bits += 6;
+    if (num_bits >= 8) {
+      if (n == sizeof(raw)) {
+        return -1;
+      }
+      num_bits -= 8;
+      raw[n++] = (unsigned char)(bits >> num_bits);
+    }
+  }
+
+  if (n < 6 || raw[0] != PAGE_TOKEN_VERSION) {
+    return -1;
+  }
+  uint32_t token_check = 0;
+  for (int i = 0; i < 4; ++i) {
+    token_check |= (uint32_t)raw[1 + i] << (8 * i);
+  }
+  size_t num_values = raw[5];
+  if (token_check != check || num_values == 0 || num_values > PAGE_TOKEN_MAX_VALUES) {
+    return -1;
+  }
+
+  page_token_init(token, check);
+  size_t pos = 6;
+  for (size_t i = 0; i < num_values; ++i) {
+    if (n - pos < 3) {
+      return -1;
+    }
+    bool numeric = (raw[pos] & FLAG_NUMERIC) != 0;
+    size_t len = raw[pos + 1] | (size_t)raw[pos + 2] << 8;
+    pos += 3;
+    const char *value = (const char *)raw + pos;
+    if (n - pos < len || (numeric && !numeric_literal(value, len)) ||
+        page_token_add(token, value, len, numeric) != 0) {
+      return -1;
+    }
+    pos += len;
+  }
+  return pos == n ? 0 : -1;
+}
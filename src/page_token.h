@@ -0,0 +1,36 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "src/strbuf.h"
+// clang-format on
+
+// 主键最多的列数（InnoDB 索引最多 16 列）
+#define PAGE_TOKEN_MAX_VALUES 16
+// 主键值的总字节数上限（InnoDB 索引键最长 3072 字节）
+#define PAGE_TOKEN_MAX_BYTES 3072
+#define PAGE_TOKEN_VERSION 1
+
+// 续读令牌：上一页最后一行的主键值，下一页从它之后开始（keyset 分页）
+//
+// 编码（整数均为小端序）：version u8 | 查询摘要 u32 | 值个数 u8 |
+//   每个值 { flags u8 | 长度 u16 | 数据 }，整体再做 base64url（不补 '='）
+// 查询摘要由表名和条件得出，令牌只能用于生成它的那个查询
+typedef struct {
+  uint32_t check;
+  size_t num_values;
+  size_t offsets[PAGE_TOKEN_MAX_VALUES];
+  size_t lengths[PAGE_TOKEN_MAX_VALUES];
+  bool numeric[PAGE_TOKEN_MAX_VALUES]; // 数值列，生成语句时不加引号
+  size_t used;
+  char data[PAGE_TOKEN_MAX_BYTES];
+} page_token_t;
+
+uint32_t page_token_check(const char *table, const char *where);
+void page_token_init(page_token_t *token, uint32_t check);
+int page_token_add(page_token_t *token, const char *value, size_t len, bool numeric);
+const char *page_token_value(const page_token_t *token, size_t index, size_t *len);
+int page_token_encode(const page_token_t *token, strbuf_t *out);
+int page_token_decode(const char *text, uint32_t check, page_token_t *token);
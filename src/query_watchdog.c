@@ -0,0 +1,254 @@
+// clang-format off
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+#include "query_watchdog.h"
+#include "src/clock.h"
+#include "src/logger.h"
+// clang-format on
+
+/**
+ * @brief 建立发送 KILL QUERY 的连接，使用与连接池相同的账号
+ *
+ * @param watchdog 监视器
+ * @return int 成功（0）；失败（-1）
+ */
+static int watchdog_connect(query_watchdog_t *watchdog) {
+  watchdog->side = connection_pool_connect(watchdog->pool, "query watchdog");
+  return watchdog->side ? 0 : -1;
+}
+
+/**
+ * @brief 终止一个线程上正在执行的语句；不持有监视器的互斥锁，
+ *        连接上的语句执行完后 query_watchdog_disarm() 会等到 KILL 发送完毕，不会误杀下一条语句
+ *
+ * @param watchdog 监视器
+ * @param connection_id 执行语句的连接编号，用于日志
+ * @param thread_id 执行语句的 MySQL 线程号
+ * @return bool 发送成功返回 true
+ */
+static bool watchdog_kill(query_watchdog_t *watchdog, int connection_id,
+                          unsigned long thread_id) {
+  char sql[64];
+  snprintf(sql, sizeof(sql), "KILL QUERY %lu", thread_id);
+
+  // 旁路连接断开时重连一次
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    if (!watchdog->side && watchdog_connect(watchdog) != 0) {
+      break;
+    }
+    if (mysql_query(watchdog->side, sql) == 0) {
+      LOG_WARN("Deadline exceeded, killed query on connection %d (thread %lu)", connection_id,
+               thread_id);
+      return true;
+    }
+    LOG_ERROR("Failed to kill query on connection %d: %s", connection_id,
+              mysql_error(watchdog->side));
+    mysql_close(watchdog->side);
+    watchdog->side = NULL;
+  }
+  return false;
+}
+
+/**
+ * @brief 监视线程：睡到最早的截止时间，终止所有已经超时的语句
+ *
+ * 互斥锁只保护截止时间等登记信息；KILL QUERY 和旁路连接的重连在锁外进行，
+ * 不会拖慢其他连接上的 arm/disarm
+ *
+ * @param arg 监视器
+ * @return void* NULL
+ */
+static void *watchdog_loop(void *arg) {
+  query_watchdog_t *watchdog = (query_watchdog_t *)arg;
+  connection_pool_t *pool = watchdog->pool;
+
+  pthread_mutex_lock(&watchdog->mutex);
+  while (!watchdog->stop) {
+    uint64_t now_us = clock_now_us();
+    uint64_t next_us = 0;
+    mysql_connection_t *expired = NULL;
+    for (int i = 0; i < pool->pool_size; ++i) {
+      mysql_connection_t *conn = &pool->connections[i];
+      if (conn->deadline_us == 0 || conn->killed) {
+        continue;
+      }
+      if (conn->deadline_us <= now_us) {
+        expired = conn;
+        break;
+      }
+      if (next_us == 0 || conn->deadline_us < next_us) {
+        next_us = conn->deadline_us;
+      }
+    }
+
+    if (expired) {
+      // 发送失败也不再重试，避免空转
+      expired->killed = true;
+      watchdog->killing = expired;
+      int connection_id = expired->connection_id;
+      unsigned long thread_id = expired->thread_id;
+      pthread_mutex_unlock(&watchdog->mutex);
+
+      bool sent = watchdog_kill(watchdog, connection_id, thread_id);
+
+      pthread_mutex_lock(&watchdog->mutex);
+      if (sent) {
+        ++watchdog->kills;
+      }
+      watchdog->killing = NULL;
+      pthread_cond_broadcast(&watchdog->kill_done);
+      continue; // 锁外的这段时间里登记信息可能已经变化，重新扫描
+    }
+
+    watchdog->next_wake_us = next_us;
+    if (next_us == 0) {
+      pthread_cond_wait(&watchdog->cond, &watchdog->mutex);
+    } else {
+      struct timespec abstime = {.tv_sec = (time_t)(next_us / 1000000),
+                                 .tv_nsec = (long)(next_us % 1000000) * 1000};
+      pthread_cond_timedwait(&watchdog->cond, &watchdog->mutex, &abstime);
+    }
+  }
+  pthread_mutex_unlock(&watchdog->mutex);
+
+  if (watchdog->side) {
+    mysql_close(watchdog->side);
+    watchdog->side = NULL;
+  }
+  mysql_thread_end();
+  return NULL;
+}
+
+/**
+ * @brief 启动监视线程
+ *
+ * @param watchdog 监视器
+ * @param pool 被监视的连接池
+ * @return int 成功（0）；失败（-1）
+ */
+int query_watchdog_start(query_watchdog_t *watchdog, connection_pool_t *pool) {
+  watchdog->pool = pool;
+  watchdog->side = NULL;
+  watchdog->started = false;
+  watchdog->stop = false;
+  watchdog->killing = NULL;
+  watchdog->next_wake_us = 0;
+  watchdog->kills = 0;
+
+  if (pthread_mutex_init(&watchdog->mutex, NULL) != 0) {
+    LOG_ERROR("Failed to initialize query watchdog mutex");
+    return -1;
+  }
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  int ret = pthread_cond_init(&watchdog->cond, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+  if (ret != 0) {
+    LOG_ERROR("Failed to initialize query watchdog condition variable");
+    pthread_mutex_destroy(&watchdog->mutex);
+    return -1;
+  }
+  if (pthread_cond_init(&watchdog->kill_done, NULL) != 0) {
+    LOG_ERROR("Failed to initialize query watchdog condition variable");
+    pthread_cond_destroy(&watchdog->cond);
+    pthread_mutex_destroy(&watchdog->mutex);
+    return -1;
+  }
+
+  if (pthread_create(&watchdog->thread, NULL, watchdog_loop, watchdog) != 0) {
+    LOG_ERROR("Failed to start query watchdog thread");
+    pthread_cond_destroy(&watchdog->kill_done);
+    pthread_cond_destroy(&watchdog->cond);
+    pthread_mutex_destroy(&watchdog->mutex);
+    return -1;
+  }
+  watchdog->started = true;
+  return 0;
+}
+
+/**
+ * @brief 停止监视线程，需在销毁连接池之前调用
+ *
+ * @param watchdog 监视器
+ */
+void query_watchdog_stop(query_watchdog_t *watchdog) {
+  if (!watchdog->started) {
+    return;
+  }
+
+  pthread_mutex_lock(&watchdog->mutex);
+  watchdog->stop = true;
+  pthread_cond_signal(&watchdog->cond);
+  pthread_mutex_unlock(&watchdog->mutex);
+
+  pthread_join(watchdog->thread, NULL);
+  pthread_cond_destroy(&watchdog->kill_done);
+  pthread_cond_destroy(&watchdog->cond);
+  pthread_mutex_destroy(&watchdog->mutex);
+  watchdog->started = false;
+}
+
+/**
+ * @brief 登记即将在连接上执行的语句的截止时间
+ *
+ * @param watchdog 监视器
+ * @param conn 连接，由调用者独占
+ * @param deadline_us 截止时间（clock_now_us() 的单调时钟），0 表示不限时，不登记
+ */
+void query_watchdog_arm(query_watchdog_t *watchdog, mysql_connection_t *conn,
+                        uint64_t deadline_us) {
+  if (deadline_us == 0) {
+    return;
+  }
+
+  unsigned long thread_id = mysql_thread_id(conn->mysql_conn);
+  pthread_mutex_lock(&watchdog->mutex);
+  conn->thread_id = thread_id;
+  conn->killed = false;
+  conn->deadline_us = deadline_us;
+  // 只有比监视线程下一次醒来更早的截止时间才需要唤醒它
+  if (watchdog->next_wake_us == 0 || deadline_us < watchdog->next_wake_us) {
+    watchdog->next_wake_us = deadline_us;
+    pthread_cond_signal(&watchdog->cond);
+  }
+  pthread_mutex_unlock(&watchdog->mutex);
+}
+
+/**
+ * @brief 语句执行完毕后注销截止时间；返回后监视线程不会再向这个连接发送 KILL QUERY
+ *
+ * @param watchdog 监视器
+ * @param conn 连接，由调用者独占
+ * @return bool 语句因超时被终止返回 true
+ */
+bool query_watchdog_disarm(query_watchdog_t *watchdog, mysql_connection_t *conn) {
+  if (conn->deadline_us == 0) {
+    return false;
+  }
+
+  pthread_mutex_lock(&watchdog->mutex);
+  // KILL QUERY 正在锁外发送时等它完成，否则它可能落到这个连接的下一条语句上
+  while (watchdog->killing == conn) {
+    pthread_cond_wait(&watchdog->kill_done, &watchdog->mutex);
+  }
+  bool killed = conn->killed;
+  conn->deadline_us = 0;
+  conn->killed = false;
+  pthread_mutex_unlock(&watchdog->mutex);
+  return killed;
+}
+
+/**
+ * @brief 获取累计终止的语句数
+ *
+ * @param watchdog 监视器
+ * @return unsigned long long 终止的语句数
+ */
+unsigned long long query_watchdog_kills(query_watchdog_t *watchdog) {
+  pthread_mutex_lock(&watchdog->mutex);
+  unsigned long long kills = watchdog->kills;
+  pthread_mutex_unlock(&watchdog->mutex);
+  return kills;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// clang-format off
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "src/connection_pool.h"
+// clang-format on
+
+// 截止时间到达后仍在执行的语句，通过一条独立的连接发送 KILL QUERY 终止
+typedef struct {
+  connection_pool_t *pool;
+  MYSQL *side; // 发送 KILL QUERY 的连接，第一次需要时才建立，只由监视线程访问，不需要加锁
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond; // 有新的截止时间或需要退出
+  pthread_cond_t kill_done; // 正在发送的 KILL QUERY 已完成
+  mysql_connection_t *killing; // 正在发送 KILL QUERY 的目标连接，没有时为 NULL
+  uint64_t next_wake_us; // 监视线程下一次醒来的时间，0 表示等待唤醒
+  bool started;
+  bool stop;
+  unsigned long long kills; // 累计终止的语句数
+} query_watchdog_t;
+
+int query_watchdog_start(query_watchdog_t *watchdog, connection_pool_t *pool);
+void query_watchdog_stop(query_watchdog_t *watchdog);
+void query_watchdog_arm(query_watchdog_t *watchdog, mysql_connection_t *conn,
+                        uint64_t deadline_us);
+bool query_watchdog_disarm(query_watchdog_t *watchdog, mysql_connection_t *conn);
+unsigned long long query_watchdog_kills(query_watchdog_t *watchdog);
@@ -0,0 +1,551 @@
+// clang-format off
+#include <ctype.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+#include "read_cache.h"
+#include "src/assert.h"
+#include "src/clock.h"
+#include "src/logger.h"
+#include "src/strbuf.h"
+// clang-format on
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+// 一个缓存的响应体，键和响应体依次存放在 data 中
+typedef struct read_cache_entry {
+  struct read_cache_entry *next;       // 同一个桶中的下一个条目
+  struct read_cache_entry *clock_prev; // CLOCK 环
+  struct read_cache_entry *clock_next;
+  uint64_t hash;
+  uint64_t version;    // 查询之前读到的表版本号
+  uint64_t expires_us; // 过期时间（单调时钟）
+  bool referenced;     // CLOCK 访问位
+  size_t key_len;
+  size_t body_len;
+  char data[];
+} read_cache_entry_t;
+
+static uint64_t fnv1a(const void *data, size_t len) {
+  const unsigned char *bytes = data;
+  uint64_t hash = FNV_OFFSET;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+static size_t entry_size(const read_cache_entry_t *entry) {
+  return sizeof(read_cache_entry_t) + entry->key_len + entry->body_len;
+}
+
+/**
+ * @brief 初始化为未启用的缓存，未启用时查找总是未命中、存入什么也不做
+ *
+ * @param cache 缓存
+ */
+void read_cache_init(read_cache_t *cache) {
+  DBMNGR_ASSERT(cache);
+  memset(cache, 0, sizeof(*cache));
+}
+
+/**
+ * @brief 启用缓存
+ *
+ * @param cache 缓存
+ * @param budget_bytes 全部条目（含键和簿记）的字节数上限，平均分给各分片；0 表示不启用
+ * @param ttl_ms 默认 TTL（毫秒），0 表示只缓存单独设置了 TTL 的表
+ * @return int 成功（0）；失败（-1）
+ */
+int read_cache_enable(read_cache_t *cache, size_t budget_bytes, uint64_t ttl_ms) {
+  DBMNGR_ASSERT(cache);
+  DBMNGR_ASSERT(!cache->enabled);
+  if (budget_bytes == 0) {
+    return 0;
+  }
+
+  cache->shards =
+      aligned_alloc(alignof(read_cache_shard_t), sizeof(read_cache_shard_t) * READ_CACHE_SHARDS);
+  if (!cache->shards) {
+    LOG_ERROR("Failed to allocate read cache shards");
+    return -1;
+  }
+  memset(cache->shards, 0, sizeof(read_cache_shard_t) * READ_CACHE_SHARDS);
+
+  for (size_t i = 0; i < READ_CACHE_SHARDS; ++i) {
+    read_cache_shard_t *shard = &cache->shards[i];
+    shard->buckets = calloc(READ_CACHE_BUCKETS, sizeof(read_cache_entry_t *));
+    if (!shard->buckets || pthread_mutex_init(&shard->mutex, NULL) != 0) {
+      LOG_ERROR("Failed to initialize read cache shard");
+      free(shard->buckets);
+      for (size_t j = 0; j < i; ++j) {
+        pthread_mutex_destroy(&cache->shards[j].mutex);
+        free(cache->shards[j].buckets);
+      }
+      free(cache->shards);
+      cache->shards = NULL;
+      return -1;
+    }
+  }
+
+  cache->shard_budget = budget_bytes / READ_CACHE_SHARDS;
+  cache->ttl_ms = ttl_ms;
+  cache->enabled = true;
+  LOG_INFO("Read cache enabled: %zu bytes, TTL %llu ms", budget_bytes,
+           (unsigned long long)ttl_ms);
+  return 0;
+}
+
+/**
+ * @brief 释放全部条目并销毁缓存
+ *
+ * @param cache 缓存
+ */
+void read_cache_destroy(read_cache_t *cache) {
+  if (!cache || !cache->shards) {
+    return;
+  }
+
+  for (size_t i = 0; i < READ_CACHE_SHARDS; ++i) {
+    read_cache_shard_t *shard = &cache->shards[i];
+    read_cache_entry_t *entry = shard->hand;
+    for (size_t n = 0; n < shard->entries; ++n) {
+      read_cache_entry_t *next = entry->clock_next;
+      free(entry);
+      entry = next;
+    }
+    free(shard->buckets);
+    pthread_mutex_destroy(&shard->mutex);
+  }
+  free(cache->shards);
+  cache->shards = NULL;
+  cache->enabled = false;
+}
+
+/**
+ * @brief 单独设置一张表的 TTL，在启用缓存之后、开始处理请求之前调用
+ *
+ * @param cache 缓存
+ * @param table 表名
+ * @param ttl_ms TTL，0 表示不缓存这张表
+ * @return int 成功（0）；表名不合法或设置的表太多（-1）
+ */
+int read_cache_set_table_ttl(read_cache_t *cache, const char *table, uint64_t ttl_ms) {
+  char key[TABLE_VERSION_NAME_LEN + 1];
+  if (table_version_key(table, key) != 0) {
+    LOG_ERROR("Invalid table name for read cache TTL: %s", table);
+    return -1;
+  }
+
+  for (size_t i = 0; i < cache->num_ttls; ++i) {
+    if (strcmp(cache->ttls[i].table, key) == 0) {
+      cache->ttls[i].ttl_ms = ttl_ms;
+      return 0;
+    }
+  }
+  if (cache->num_ttls == READ_CACHE_MAX_TTLS) {
+    LOG_ERROR("Too many read cache TTLs, at most %d tables", READ_CACHE_MAX_TTLS);
+    return -1;
+  }
+  read_cache_ttl_t *ttl = &cache->ttls[cache->num_ttls++];
+  memcpy(ttl->table, key, sizeof(key));
+  ttl->ttl_ms = ttl_ms;
+  return 0;
+}
+
+/**
+ * @brief 解析并设置各表的 TTL
+ *
+ * @param cache 缓存
+ * @param spec 形如 "orders:500,audit_log:0" 的列表
+ * @return int 成功（0）；格式错误（-1）
+ */
+int read_cache_parse_table_ttls(read_cache_t *cache, const char *spec) {
+  DBMNGR_ASSERT(spec);
+  const char *ptr = spec;
+  while (*ptr) {
+    const char *end = strchr(ptr, ',');
+    size_t len = end ? (size_t)(end - ptr) : strlen(ptr);
+    const char *colon = memchr(ptr, ':', len);
+    if (!colon || colon == ptr || (size_t)(colon - ptr) > TABLE_VERSION_NAME_LEN ||
+        !isdigit((unsigned char)colon[1])) {
+      LOG_ERROR("Invalid read cache TTL '%.*s', expected TABLE:MS", (int)len, ptr);
+      return -1;
+    }
+
+    char table[TABLE_VERSION_NAME_LEN + 1];
+    memcpy(table, ptr, (size_t)(colon - ptr));
+    table[colon - ptr] = '\0';
+    char *num_end = NULL;
+    unsigned long long ttl_ms = strtoull(colon + 1, &num_end, 10);
+    if (num_end != ptr + len) {
+      LOG_ERROR("Invalid read cache TTL '%.*s', expected TABLE:MS", (int)len, ptr);
+      return -1;
+    }
+    if (read_cache_set_table_ttl(cache, table, ttl_ms) != 0) {
+      return -1;
+    }
+    ptr = end ? end + 1 : ptr + len;
+  }
+  return 0;
+}
+
+/**
+ * @brief 单个条目（响应体）的字节数上限，更大的结果不缓存，调用者可以据此提前放弃收集
+ *
+ * @param cache 缓存
+ * @return size_t 上限，未启用时为 0
+ */
+size_t read_cache_entry_limit(const read_cache_t *cache) {
+  return cache->enabled ? cache->shard_budget / READ_CACHE_ENTRY_SHARE : 0;
+}
+
+/**
+ * @brief 查找表的 TTL
+ *
+ * @param cache 缓存
+ * @param key 规整后的表名
+ * @return uint64_t TTL（毫秒）
+ */
+static uint64_t table_ttl(const read_cache_t *cache, const char *key) {
+  for (size_t i = 0; i < cache->num_ttls; ++i) {
+    if (strcmp(cache->ttls[i].table, key) == 0) {
+      return cache->ttls[i].ttl_ms;
+    }
+  }
+  return cache->ttl_ms;
+}
+
+/**
+ * @brief 是否缓存这个查询：缓存已启用、表的 TTL 不为 0，且条件不含随时间或其他表变化的片段
+ *
+ * @param cache 缓存
+ * @param table 表名
+ * @param where 条件，可以为 NULL
+ * @return bool 缓存返回 true
+ */
+bool read_cache_wanted(const read_cache_t *cache, const char *table, const char *where) {
+  char key[TABLE_VERSION_NAME_LEN + 1];
+  return cache->enabled && table && table_version_key(table, key) == 0 &&
+         table_ttl(cache, key) > 0 && table_version_cacheable(table, where);
+}
+
+/**
+ * @brief 规整条件：去掉首尾空白，引号之外的连续空白合并为一个空格，引号之内原样保留
+ *
+ * @param where 条件，可以为 NULL
+ * @param out 输出缓冲区
+ * @return int 成功（0）；内存不足（-1）
+ */
+static int normalize_where(const char *where, strbuf_t *out) {
+  if (!where) {
+    return 0;
+  }
+
+  size_t start = out->len;
+  char quote = '\0';
+  bool space = false;
+  int rc = 0;
+  for (const char *ptr = where; *ptr; ++ptr) {
+    char ch = *ptr;
+    if (quote) {
+      rc |= strbuf_append_char(out, ch);
+      if (ch == '\\' && ptr[1]) {
+        rc |= strbuf_append_char(out, *++ptr);
+      } else if (ch == quote) {
+        quote = '\0';
+      }
+      continue;
+    }
+    if (isspace((unsigned char)ch)) {
+      space = true;
+      continue;
+    }
+    if (space && out->len > start) {
+      rc |= strbuf_append_char(out, ' ');
+    }
+    space = false;
+    if (ch == '\'' || ch == '"' || ch == '`') {
+      quote = ch;
+    }
+    rc |= strbuf_append_char(out, ch);
+  }
+  return rc ? -1 : 0;
+}
+
+/**
+ * @brief 生成 READ 的键：规整后的表名、编码格式、规整后的条件；合并相同的在途读取也用它
+ *
+ * @param table 表名
+ * @param where 条件，可以为 NULL
+ * @param format 编码格式
+ * @param key 输出键，追加到缓冲区末尾
+ * @return int 成功（0）；表名不合法、条件随时间或其他表变化、或内存不足（-1）
+ */
+int read_cache_key(const char *table, const char *where, result_format_t format, strbuf_t *key) {
+  char table_key[TABLE_VERSION_NAME_LEN + 1];
+  if (!table || table_version_key(table, table_key) != 0 ||
+      !table_version_cacheable(table, where)) {
+    return -1;
+  }
+
+  // 表名不含 NUL，以它分隔表名和其余部分
+  int rc = strbuf_append(key, table_key, strlen(table_key) + 1) ||
+           strbuf_append_char(key, (char)('0' + format)) || normalize_where(where, key);
+  return rc ? -1 : 0;
+}
+
+/**
+ * @brief 生成缓存键并查找表的 TTL
+ *
+ * @param cache 缓存
+ * @param table 表名
+ * @param where 条件，可以为 NULL
+ * @param format 编码格式
+ * @param key 输出键
+ * @param ttl_ms 输出表的 TTL
+ * @return int 可以缓存（0）；不缓存或内存不足（-1）
+ */
+static int cache_key(const read_cache_t *cache, const char *table, const char *where,
+                     result_format_t format, strbuf_t *key, uint64_t *ttl_ms) {
+  char table_key[TABLE_VERSION_NAME_LEN + 1];
+  if (!cache->enabled || !table || table_version_key(table, table_key) != 0) {
+    return -1;
+  }
+  *ttl_ms = table_ttl(cache, table_key);
+  if (*ttl_ms == 0) {
+    return -1;
+  }
+  return read_cache_key(table, where, format, key);
+}
+
+static read_cache_shard_t *shard_of(read_cache_t *cache, uint64_t hash) {
+  return &cache->shards[hash % READ_CACHE_SHARDS];
+}
+
+static read_cache_entry_t **bucket_of(read_cache_shard_t *shard, uint64_t hash) {
+  return &shard->buckets[(hash / READ_CACHE_SHARDS) % READ_CACHE_BUCKETS];
+}
+
+/**
+ * @brief 在分片中查找条目，调用者持有分片的锁
+ *
+ * @param shard 分片
+ * @param hash 键的哈希
+ * @param key 键
+ * @param key_len 键长
+ * @return read_cache_entry_t* 条目，不存在返回 NULL
+ */
+static read_cache_entry_t *find_entry(read_cache_shard_t *shard, uint64_t hash, const char *key,
+                                      size_t key_len) {
+  for (read_cache_entry_t *entry = *bucket_of(shard, hash); entry; entry = entry->next) {
+    if (entry->hash == hash && entry->key_len == key_len &&
+        memcmp(entry->data, key, key_len) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief 从哈希桶和 CLOCK 环中移除并释放条目，调用者持有分片的锁
+ *
+ * @param shard 分片
+ * @param entry 条目
+ */
+static void remove_entry(read_cache_shard_t *shard, read_cache_entry_t *entry) {
+  read_cache_entry_t **link = bucket_of(shard, entry->hash);
+  while (*link != entry) {
+    link = &(*link)->next;
+  }
+  *link = entry->next;
+
+  if (entry->clock_next == entry) {
+    shard->hand = NULL;
+  } else {
+    entry->clock_prev->clock_next = entry->clock_next;
+    entry->clock_next->clock_prev = entry->clock_prev;
+    if (shard->hand == entry) {
+      shard->hand = entry->clock_next;
+    }
+  }
+
+  shard->bytes -= entry_size(entry);
+  shard->entries--;
+  free(entry);
+}
+
+/**
+ * @brief 按 CLOCK 淘汰条目，直到放得下 need 字节，调用者持有分片的锁
+ *
+ * @param cache 缓存
+ * @param shard 分片
+ * @param need 新条目的字节数
+ */
+static void make_room(read_cache_t *cache, read_cache_shard_t *shard, size_t need) {
+  while (shard->hand && shard->bytes + need > cache->shard_budget) {
+    read_cache_entry_t *entry = shard->hand;
+    if (entry->referenced) {
+      // 上一轮之后被命中过，再放过一轮
+      entry->referenced = false;
+      shard->hand = entry->clock_next;
+      continue;
+    }
+    remove_entry(shard, entry);
+    shard->evictions++;
+  }
+}
+
+/**
+ * @brief 查找缓存的响应体，命中时复制到请求内存区域
+ *
+ * 表版本号与存入时不同（期间有写入）或已过期的条目在这里丢弃
+ *
+ * @param cache 缓存
+ * @param table 表名
+ * @param where 条件，可以为 NULL
+ * @param format 编码格式
+ * @param version 表的当前版本号
+ * @param arena 请求内存区域
+ * @param len 输出响应体长度
+ * @return const char* 响应体（以 NUL 结尾），未命中或不缓存返回 NULL
+ */
+const char *read_cache_get(read_cache_t *cache, const char *table, const char *where,
+                           result_format_t format, uint64_t version, arena_t *arena, size_t *len) {
+  strbuf_t key;
+  strbuf_init(&key);
+  uint64_t ttl_ms = 0;
+  if (cache_key(cache, table, where, format, &key, &ttl_ms) != 0) {
+    strbuf_free(&key);
+    return NULL;
+  }
+
+  uint64_t hash = fnv1a(key.data, key.len);
+  read_cache_shard_t *shard = shard_of(cache, hash);
+  char *body = NULL;
+  pthread_mutex_lock(&shard->mutex);
+  read_cache_entry_t *entry = find_entry(shard, hash, key.data, key.len);
+  if (entry && (entry->version != version || entry->expires_us <= clock_now_us())) {
+    remove_entry(shard, entry);
+    shard->invalidations++;
+    entry = NULL;
+  }
+  if (entry) {
+    body = arena_alloc(arena, entry->body_len + 1);
+    if (body) {
+      memcpy(body, entry->data + entry->key_len, entry->body_len);
+      body[entry->body_len] = '\0';
+      *len = entry->body_len;
+      entry->referenced = true;
+    }
+  }
+  if (body) {
+    shard->hits++;
+  } else {
+    shard->misses++;
+  }
+  pthread_mutex_unlock(&shard->mutex);
+
+  strbuf_free(&key);
+  return body;
+}
+
+/**
+ * @brief 存入一个完整的响应体
+ *
+ * 同一个键已有条目时，保留版本号更新的那个：两个并发的未命中各自查询，较早读到版本号的
+ * 那个结果可能已经过时
+ *
+ * @param cache 缓存
+ * @param table 表名
+ * @param where 条件，可以为 NULL
+ * @param format 编码格式
+ * @param version 查询之前读到的表版本号
+ * @param body 响应体
+ * @param len 响应体长度
+ */
+void read_cache_put(read_cache_t *cache, const char *table, const char *where,
+                    result_format_t format, uint64_t version, const char *body, size_t len) {
+  if (len > read_cache_entry_limit(cache)) {
+    return;
+  }
+  strbuf_t key;
+  strbuf_init(&key);
+  uint64_t ttl_ms = 0;
+  if (cache_key(cache, table, where, format, &key, &ttl_ms) != 0) {
+    strbuf_free(&key);
+    return;
+  }
+
+  read_cache_entry_t *entry = malloc(sizeof(read_cache_entry_t) + key.len + len);
+  if (!entry) {
+    LOG_WARN("Failed to allocate read cache entry");
+    strbuf_free(&key);
+    return;
+  }
+  entry->hash = fnv1a(key.data, key.len);
+  entry->version = version;
+  entry->expires_us = clock_now_us() + ttl_ms * 1000;
+  entry->referenced = false;
+  entry->key_len = key.len;
+  entry->body_len = len;
+  memcpy(entry->data, key.data, key.len);
+  memcpy(entry->data + key.len, body, len);
+  strbuf_free(&key);
+
+  read_cache_shard_t *shard = shard_of(cache, entry->hash);
+  pthread_mutex_lock(&shard->mutex);
+  read_cache_entry_t *old = find_entry(shard, entry->hash, entry->data, entry->key_len);
+  if (old && old->version > version) {
+    pthread_mutex_unlock(&shard->mutex);
+    free(entry);
+    return;
+  }
+  if (old) {
+    remove_entry(shard, old);
+  }
+  make_room(cache, shard, entry_size(entry));
+
+  read_cache_entry_t **bucket = bucket_of(shard, entry->hash);
+  entry->next = *bucket;
+  *bucket = entry;
+  // 新条目放在指针之前，也就是一轮扫描的最后
+  if (shard->hand) {
+    entry->clock_next = shard->hand;
+    entry->clock_prev = shard->hand->clock_prev;
+    shard->hand->clock_prev->clock_next = entry;
+    shard->hand->clock_prev = entry;
+  } else {
+    entry->clock_next = entry;
+    entry->clock_prev = entry;
+    shard->hand = entry;
+  }
+  shard->bytes += entry_size(entry);
+  shard->entries++;
+  pthread_mutex_unlock(&shard->mutex);
+}
+
+/**
+ * @brief 汇总各分片的统计
+ *
+ * @param cache 缓存
+ * @param stats 输出
+ */
+void read_cache_stats(read_cache_t *cache, read_cache_stats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+  if (!cache->enabled) {
+    return;
+  }
+  for (size_t i = 0; i < READ_CACHE_SHARDS; ++i) {
+    read_cache_shard_t *shard = &cache->shards[i];
+    pthread_mutex_lock(&shard->mutex);
+    stats->hits += shard->hits;
+    stats->misses += shard->misses;
+    stats->evictions += shard->evictions;
+    stats->invalidations += shard->invalidations;
+    stats->entries += shard->entries;
+    stats->bytes += shard->bytes;
+    pthread_mutex_unlock(&shard->mutex);
+  }
+}
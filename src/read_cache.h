@@ -0,0 +1,83 @@
+#pragma once
+
+// clang-format off
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "src/arena.h"
+#include "src/result_encoder.h"
+#include "src/strbuf.h"
+#include "src/table_version.h"
+// clang-format on
+
+// 分片数，每个分片独立加锁和淘汰
+#define READ_CACHE_SHARDS 16
+// 每个分片的哈希桶数
+#define READ_CACHE_BUCKETS 1024
+// 单独设置 TTL 的表的上限
+#define READ_CACHE_MAX_TTLS 64
+// 单个结果最多占分片容量的 1/READ_CACHE_ENTRY_SHARE，更大的结果不缓存，免得一次挤掉整个分片
+#define READ_CACHE_ENTRY_SHARE 8
+
+struct read_cache_entry;
+
+// 一个分片：哈希桶加一个 CLOCK 环，命中时置访问位，淘汰时指针扫过的条目有访问位则放过一轮
+typedef struct {
+  alignas(64) pthread_mutex_t mutex;
+  struct read_cache_entry **buckets;
+  struct read_cache_entry *hand; // CLOCK 指针，环为空时为 NULL
+  size_t bytes;
+  size_t entries;
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;     // 为腾出空间淘汰的条目
+  unsigned long long invalidations; // 因表有写入或过期而丢弃的条目
+} read_cache_shard_t;
+
+// 单独设置 TTL 的表
+typedef struct {
+  char table[TABLE_VERSION_NAME_LEN + 1]; // 规整后的表名，见 table_version_key()
+  uint64_t ttl_ms;                        // 0 表示不缓存这张表
+} read_cache_ttl_t;
+
+/**
+ * READ 结果缓存：以 表 + 规整后的条件 + 编码格式 为键保存编码好的响应体
+ *
+ * 条目记录查询之前读到的表版本号，查找时版本号不同即视为失效，所以任何途径的写入
+ * （CREATE/UPDATE/DELETE、批量、会话、轮询发现的外部写入）都会让这张表的全部条目失效，
+ * 而不必在写入时扫描缓存
+ */
+typedef struct {
+  bool enabled;
+  size_t shard_budget; // 每个分片的字节数上限
+  uint64_t ttl_ms;     // 默认 TTL
+  read_cache_ttl_t ttls[READ_CACHE_MAX_TTLS];
+  size_t num_ttls;
+  read_cache_shard_t *shards;
+} read_cache_t;
+
+// 各分片汇总后的统计
+typedef struct {
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;
+  unsigned long long invalidations;
+  unsigned long long entries;
+  unsigned long long bytes;
+} read_cache_stats_t;
+
+void read_cache_init(read_cache_t *cache);
+int read_cache_enable(read_cache_t *cache, size_t budget_bytes, uint64_t ttl_ms);
+void read_cache_destroy(read_cache_t *cache);
+int read_cache_set_table_ttl(read_cache_t *cache, const char *table, uint64_t ttl_ms);
+int read_cache_parse_table_ttls(read_cache_t *cache, const char *spec);
+size_t read_cache_entry_limit(const read_cache_t *cache);
+int read_cache_key(const char *table, const char *where, result_format_t format, strbuf_t *key);
+bool read_cache_wanted(const read_cache_t *cache, const char *table, const char *where);
+const char *read_cache_get(read_cache_t *cache, const char *table, const char *where,
+                           result_format_t format, uint64_t version, arena_t *arena, size_t *len);
+void read_cache_put(read_cache_t *cache, const char *table, const char *where,
+                    result_format_t format, uint64_t version, const char *body, size_t len);
+void read_cache_stats(read_cache_t *cache, read_cache_stats_t *stats);
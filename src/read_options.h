@@ -0,0 +1,18 @@
+#pragma once
+
+// clang-format off
+#include "src/db_params.h"
+// clang-format on
+
+// 一页最多的行数，整页读完才发送响应头（续读令牌在响应头中）
+#define READ_MAX_PAGE_SIZE 10000
+
+// READ 的可选参数，全部为 0 / NULL 时即 SELECT * FROM table [WHERE where]，服务端和客户端共用
+typedef struct {
+  unsigned int page_size;    // 每页行数，0 表示不分页
+  const char *page_token;    // 上一页响应的续读令牌，NULL 表示第一页
+  const char *columns;       // 逗号分隔的列名，NULL 表示全部列
+  const char *order_by;      // 逗号分隔的 "列名 [ASC|DESC]"，NULL 表示不排序；不能与分页同时使用
+  unsigned int limit;        // 最多返回的行数，0 表示不限；不能与分页同时使用
+  const db_params_t *params; // where 中 '?' 的值，不为 NULL 时以预处理语句执行；不能分页
+} read_options_t;
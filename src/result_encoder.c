@@ -0,0 +1,508 @@
+// clang-format off
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "result_encoder.h"
+#include "src/json_escape.h"
+#include "src/key.h"
+#include "src/rowset.h"
+// clang-format on
+
+#define TEXT_CELL_WIDTH 15
+
+// MySQL 的 binary 字符集编号：BINARY、VARBINARY 和 BLOB 列的字节不一定是合法的 UTF-8
+#define BINARY_CHARSET_NR 63
+
+// NDJSON 中途出错时输出的错误对象的键，以 $ 开头，与列名区分
+#define NDJSON_ERROR_KEY "$error"
+
+/**
+ * @brief 输出一个左对齐、至少 TEXT_CELL_WIDTH 宽的文本单元格（超长内容不截断）
+ *
+ * @param out 输出缓冲区
+ * @param data 单元格数据
+ * @param len 数据长度
+ * @return int 成功（0）；失败（-1）
+ */
+static int text_cell(strbuf_t *out, const char *data, size_t len) {
+  size_t pad = len < TEXT_CELL_WIDTH ? TEXT_CELL_WIDTH - len : 0;
+  if (strbuf_reserve(out, len + pad) != 0) {
+    return -1;
+  }
+  memcpy(out->data + out->len, data, len);
+  memset(out->data + out->len + len, ' ', pad);
+  out->len += len + pad;
+  out->data[out->len] = '\0';
+  return 0;
+}
+
+static int put_u8(strbuf_t *out, uint8_t value) { return strbuf_append_char(out, (char)value); }
+
+static int put_u16(strbuf_t *out, uint16_t value) {
+  unsigned char bytes[2] = {value & 0xFF, value >> 8};
+  return strbuf_append(out, bytes, sizeof(bytes));
+}
+
+static int put_u64(strbuf_t *out, uint64_t value) {
+  unsigned char bytes[8];
+  for (int i = 0; i < 8; ++i) {
+    bytes[i] = (value >> (i * 8)) & 0xFF;
+  }
+  return strbuf_append(out, bytes, sizeof(bytes));
+}
+
+/**
+ * @brief 根据 MySQL 字段类型决定线路编码类型
+ *
+ * DECIMAL 保持文本以免丢失精度，日期时间等类型也按字节串透传
+ *
+ * @param field 字段元数据
+ * @return rowset_type_t 编码类型
+ */
+static rowset_type_t rowset_column_type(const MYSQL_FIELD *field) {
+  switch (field->type) {
+  case MYSQL_TYPE_TINY:
+  case MYSQL_TYPE_SHORT:
+  case MYSQL_TYPE_INT24:
+  case MYSQL_TYPE_LONG:
+  case MYSQL_TYPE_LONGLONG:
+  case MYSQL_TYPE_YEAR:
+    return (field->flags & UNSIGNED_FLAG) ? ROWSET_TYPE_UINT64 : ROWSET_TYPE_INT64;
+  case MYSQL_TYPE_FLOAT:
+  case MYSQL_TYPE_DOUBLE:
+    return ROWSET_TYPE_DOUBLE;
+  default:
+    return ROWSET_TYPE_BYTES;
+  }
+}
+
+/**
+ * @brief 输出二进制表头
+ */
+static int rowset_begin(result_encoder_t *encoder, strbuf_t *out) {
+  int num_fields = encoder->fields ? encoder->num_fields : 0;
+  if (strbuf_append(out, ROWSET_MAGIC, ROWSET_MAGIC_LEN) != 0 ||
+      put_u8(out, ROWSET_VERSION) != 0 || put_u16(out, (uint16_t)num_fields) != 0) {
+    return -1;
+  }
+
+  for (int i = 0; i < num_fields; ++i) {
+    const MYSQL_FIELD *field = &encoder->fields[i];
+    size_t name_len = strlen(field->name);
+    if (put_u8(out, rowset_column_type(field)) != 0 || put_u8(out, (uint8_t)field->type) != 0 ||
+        put_u16(out, (uint16_t)field->flags) != 0 || put_u16(out, (uint16_t)name_len) != 0 ||
+        strbuf_append(out, field->name, name_len) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static unsigned char *store_u64(unsigned char *ptr, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    ptr[i] = (value >> (i * 8)) & 0xFF;
+  }
+  return ptr + 8;
+}
+
+/**
+ * @brief 输出一行二进制数据，数值列由文本转换为定长的原生表示
+ *
+ * 先按最坏情况一次性预留整行空间，之后直接写入，避免逐列检查容量
+ */
+static int rowset_row(result_encoder_t *encoder, MYSQL_ROW row, const unsigned long *lengths,
+                      strbuf_t *out) {
+  size_t bitmap_len = (encoder->num_fields + 7) / 8;
+  size_t need = 1 + bitmap_len;
+  for (int i = 0; i < encoder->num_fields; ++i) {
+    need += 10 + lengths[i]; // varint 最长 10 字节，也覆盖了定长的 8 字节
+  }
+  if (strbuf_reserve(out, need) != 0) {
+    return -1;
+  }
+
+  unsigned char *ptr = (unsigned char *)out->data + out->len;
+  *ptr++ = ROWSET_TAG_ROW;
+  unsigned char *bitmap = ptr;
+  memset(bitmap, 0, bitmap_len);
+  ptr += bitmap_len;
+
+  for (int i = 0; i < encoder->num_fields; ++i) {
+    if (!row[i]) {
+      bitmap[i / 8] |= 1 << (i % 8);
+      continue;
+    }
+
+    switch (rowset_column_type(&encoder->fields[i])) {
+    case ROWSET_TYPE_INT64:
+      ptr = store_u64(ptr, (uint64_t)strtoll(row[i], NULL, 10));
+      break;
+    case ROWSET_TYPE_UINT64:
+      ptr = store_u64(ptr, strtoull(row[i], NULL, 10));
+      break;
+    case ROWSET_TYPE_DOUBLE: {
+      double value = strtod(row[i], NULL);
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      ptr = store_u64(ptr, bits);
+      break;
+    }
+    default: {
+      uint64_t len = lengths[i];
+      do {
+        *ptr++ = (len & 0x7F) | (len > 0x7F ? 0x80 : 0);
+        len >>= 7;
+      } while (len);
+      memcpy(ptr, row[i], lengths[i]);
+      ptr += lengths[i];
+      break;
+    }
+    }
+  }
+
+  out->len = (char *)ptr - out->data;
+  out->data[out->len] = '\0';
+  ++encoder->num_rows;
+  return 0;
+}
+
+/**
+ * @brief 数值列直接输出 MySQL 返回的文本（本身就是合法的 JSON 数字）；
+ *        DECIMAL 输出为字符串，避免 JSON 解析器转换成 double 丢失精度
+ */
+static bool json_is_number(const MYSQL_FIELD *field) {
+  switch (field->type) {
+  case MYSQL_TYPE_TINY:
+  case MYSQL_TYPE_SHORT:
+  case MYSQL_TYPE_INT24:
+  case MYSQL_TYPE_LONG:
+  case MYSQL_TYPE_LONGLONG:
+  case MYSQL_TYPE_YEAR:
+  case MYSQL_TYPE_FLOAT:
+  case MYSQL_TYPE_DOUBLE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief 二进制列（binary 字符集的字符串和 BLOB、BIT、GEOMETRY）在 JSON 中输出为 base64 字符串
+ */
+static bool json_is_binary(const MYSQL_FIELD *field) {
+  switch (field->type) {
+  case MYSQL_TYPE_BIT:
+  case MYSQL_TYPE_GEOMETRY:
+    return true;
+  case MYSQL_TYPE_STRING:
+  case MYSQL_TYPE_VAR_STRING:
+  case MYSQL_TYPE_VARCHAR:
+  case MYSQL_TYPE_TINY_BLOB:
+  case MYSQL_TYPE_MEDIUM_BLOB:
+  case MYSQL_TYPE_LONG_BLOB:
+  case MYSQL_TYPE_BLOB:
+    return field->charsetnr == BINARY_CHARSET_NR;
+  default:
+    return false;
+  }
+}
+
+static size_t base64_length(size_t len) { return (len + 2) / 3 * 4; }
+
+/**
+ * @brief 输出带引号的 base64 字符串（标准字母表，补 '='）
+ *
+ * @param out 输出缓冲区
+ * @param data 数据
+ * @param len 数据长度
+ * @return int 成功（0）；失败（-1）
+ */
+static int json_base64(strbuf_t *out, const unsigned char *data, size_t len) {
+  static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  if (strbuf_reserve(out, base64_length(len) + 2) != 0) {
+    return -1;
+  }
+
+  char *ptr = out->data + out->len;
+  *ptr++ = '"';
+  size_t i = 0;
+  for (; i + 3 <= len; i += 3) {
+    uint32_t value = (uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8 | data[i + 2];
+    *ptr++ = alphabet[value >> 18];
+    *ptr++ = alphabet[(value >> 12) & 0x3F];
+    *ptr++ = alphabet[(value >> 6) & 0x3F];
+    *ptr++ = alphabet[value & 0x3F];
+  }
+  if (i < len) {
+    uint32_t value = (uint32_t)data[i] << 16 | (i + 1 < len ? (uint32_t)data[i + 1] << 8 : 0);
+    *ptr++ = alphabet[value >> 18];
+    *ptr++ = alphabet[(value >> 12) & 0x3F];
+    *ptr++ = i + 1 < len ? alphabet[(value >> 6) & 0x3F] : '=';
+    *ptr++ = '=';
+  }
+  *ptr++ = '"';
+
+  out->len = ptr - out->data;
+  out->data[out->len] = '\0';
+  return 0;
+}
+
+static int json_string(strbuf_t *out, const char *data, size_t len) {
+  return strbuf_append_char(out, '"') || json_escape_append(out, data, len) ||
+         strbuf_append_char(out, '"');
+}
+
+/**
+ * @brief 输出一行 JSON 对象
+ *
+ * 按 mysql_fetch_lengths 的总长度一次性预留空间，不需要转义时整行不会再扩容
+ */
+static int json_row(result_encoder_t *encoder, MYSQL_ROW row, const unsigned long *lengths,
+                    strbuf_t *out) {
+  size_t need = 4;
+  for (int i = 0; i < encoder->num_fields; ++i) {
+    const MYSQL_FIELD *field = &encoder->fields[i];
+    size_t len = json_is_binary(field) ? base64_length(lengths[i]) : lengths[i];
+    need += field->name_length + len + 8;
+  }
+  if (strbuf_reserve(out, need) != 0) {
+    return -1;
+  }
+
+  if (encoder->format == RESULT_FORMAT_JSON && encoder->num_rows > 0 &&
+      strbuf_append_char(out, ',') != 0) {
+    return -1;
+  }
+  if (strbuf_append_char(out, '{') != 0) {
+    return -1;
+  }
+  for (int i = 0; i < encoder->num_fields; ++i) {
+    const MYSQL_FIELD *field = &encoder->fields[i];
+    int rc = (i > 0 ? strbuf_append_char(out, ',') : 0) ||
+             json_string(out, field->name, strlen(field->name)) || strbuf_append_char(out, ':');
+    if (rc == 0) {
+      if (!row[i]) {
+        rc = strbuf_append(out, "null", 4);
+      } else if (json_is_number(field)) {
+        rc = strbuf_append(out, row[i], lengths[i]);
+      } else if (json_is_binary(field)) {
+        rc = json_base64(out, (const unsigned char *)row[i], lengths[i]);
+      } else {
+        rc = json_string(out, row[i], lengths[i]);
+      }
+    }
+    if (rc != 0) {
+      return -1;
+    }
+  }
+  ++encoder->num_rows;
+  return strbuf_append_str(out, encoder->format == RESULT_FORMAT_NDJSON ? "}\n" : "}");
+}
+
+/**
+ * @brief 初始化编码器
+ *
+ * @param encoder 编码器
+ * @param format 编码格式
+ * @param fields 字段元数据（mysql_fetch_fields）
+ * @param num_fields 字段数量
+ */
+void result_encoder_init(result_encoder_t *encoder, result_format_t format,
+                         const MYSQL_FIELD *fields, int num_fields) {
+  encoder->format = format;
+  encoder->fields = fields;
+  encoder->num_fields = num_fields;
+  encoder->num_rows = 0;
+}
+
+/**
+ * @brief 输出表头
+ *
+ * @param encoder 编码器
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int result_encoder_begin(result_encoder_t *encoder, strbuf_t *out) {
+  if (encoder->format == RESULT_FORMAT_ROWSET) {
+    return rowset_begin(encoder, out);
+  }
+  if (encoder->format == RESULT_FORMAT_JSON) {
+    return strbuf_append_str(out, "{\"rows\":[");
+  }
+  if (encoder->format == RESULT_FORMAT_NDJSON) {
+    return 0;
+  }
+  if (!encoder->fields) {
+    return strbuf_append_str(out, "No sql results\n");
+  }
+
+  for (int i = 0; i < encoder->num_fields; ++i) {
+    const char *name = encoder->fields[i].name;
+    if (text_cell(out, name, strlen(name)) != 0) {
+      return -1;
+    }
+  }
+  if (strbuf_append_char(out, '\n') != 0) {
+    return -1;
+  }
+  for (int i = 0; i < encoder->num_fields; ++i) {
+    if (text_cell(out, "---------------", TEXT_CELL_WIDTH) != 0) {
+      return -1;
+    }
+  }
+  return strbuf_append_char(out, '\n');
+}
+
+/**
+ * @brief 输出一行数据
+ *
+ * @param encoder 编码器
+ * @param row 行数据
+ * @param lengths 各列长度（mysql_fetch_lengths）
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int result_encoder_row(result_encoder_t *encoder, MYSQL_ROW row, const unsigned long *lengths,
+                       strbuf_t *out) {
+  if (encoder->format == RESULT_FORMAT_ROWSET) {
+    return rowset_row(encoder, row, lengths, out);
+  }
+  if (encoder->format == RESULT_FORMAT_JSON || encoder->format == RESULT_FORMAT_NDJSON) {
+    return json_row(encoder, row, lengths, out);
+  }
+  for (int i = 0; i < encoder->num_fields; ++i) {
+    int rc = row[i] ? text_cell(out, row[i], lengths[i]) : text_cell(out, "NULL", 4);
+    if (rc != 0) {
+      return -1;
+    }
+  }
+  ++encoder->num_rows;
+  return strbuf_append_char(out, '\n');
+}
+
+/**
+ * @brief 输出结尾
+ *
+ * @param encoder 编码器
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int result_encoder_end(result_encoder_t *encoder, strbuf_t *out) {
+  if (encoder->format == RESULT_FORMAT_ROWSET) {
+    return put_u8(out, ROWSET_TAG_END) || put_u64(out, encoder->num_rows);
+  }
+  if (encoder->format == RESULT_FORMAT_JSON) {
+    return strbuf_appendf(out, "],\"count\":%llu}\n", encoder->num_rows);
+  }
+  return 0;
+}
+
+/**
+ * @brief 输出中途发生的错误（响应头已发送，只能在数据流中告知客户端），代替 result_encoder_end()
+ *
+ * @param encoder 编码器
+ * @param error_msg 错误信息
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int result_encoder_error(result_encoder_t *encoder, const char *error_msg, strbuf_t *out) {
+  if (encoder->format == RESULT_FORMAT_ROWSET) {
+    size_t len = strlen(error_msg);
+    return put_u8(out, ROWSET_TAG_ERROR) || rowset_put_varint(out, len) ||
+           strbuf_append(out, error_msg, len);
+  }
+  if (encoder->format == RESULT_FORMAT_JSON || encoder->format == RESULT_FORMAT_NDJSON) {
+    // JSON 在已输出的行之后关闭数组并附带错误；NDJSON 单独输出一行只有 $error 键的错误对象
+    return strbuf_append_str(out, encoder->format == RESULT_FORMAT_JSON
+                                      ? "],\"error\":"
+                                      : "{\"" NDJSON_ERROR_KEY "\":") ||
+           json_string(out, error_msg, strlen(error_msg)) || strbuf_append_str(out, "}\n");
+  }
+  return strbuf_appendf(out, "%s Read operation failed: %s\n", KEY_RESP_ERROR, error_msg);
+}
+
+/**
+ * @brief 获取编码格式对应的 Content-Type
+ *
+ * @param format 编码格式
+ * @return const char* Content-Type
+ */
+const char *result_format_content_type(result_format_t format) {
+  switch (format) {
+  case RESULT_FORMAT_ROWSET:
+    return KEY_MIME_ROWSET;
+  case RESULT_FORMAT_JSON:
+    return KEY_MIME_JSON;
+  case RESULT_FORMAT_NDJSON:
+    return KEY_MIME_NDJSON;
+  case RESULT_FORMAT_TEXT:
+  default:
+    return KEY_MIME_TEXT;
+  }
+}
+
+/**
+ * @brief 在 Accept 头中查找媒体类型，得到它的权重
+ *
+ * @param accept Accept 头
+ * @param mime 媒体类型
+ * @return double 权重（q 值），未声明时为 1；没有列出时为 0
+ */
+static double accept_weight(const char *accept, const char *mime) {
+  size_t mime_len = strlen(mime);
+  const char *ptr = accept;
+  while (*ptr) {
+    while (*ptr == ' ' || *ptr == '\t' || *ptr == ',') {
+      ++ptr;
+    }
+    const char *comma = strchr(ptr, ',');
+    size_t len = comma ? (size_t)(comma - ptr) : strlen(ptr);
+    const char *semicolon = memchr(ptr, ';', len);
+    size_t name_len = semicolon ? (size_t)(semicolon - ptr) : len;
+    while (name_len > 0 && (ptr[name_len - 1] == ' ' || ptr[name_len - 1] == '\t')) {
+      --name_len;
+    }
+
+    if (name_len == mime_len && strncasecmp(ptr, mime, mime_len) == 0) {
+      const char *q = semicolon ? strstr(semicolon, "q=") : NULL;
+      return q && q < ptr + len ? strtod(q + 2, NULL) : 1.0;
+    }
+    ptr += len;
+  }
+  return 0;
+}
+
+/**
+ * @brief 根据请求的 Accept 头选择编码格式：取权重最高的格式，权重相同时依次优先
+ *        rowset、NDJSON、JSON、文本；都没有列出或权重都为 0 时回退到文本
+ *
+ * @param accept Accept 头，可以为 NULL
+ * @return result_format_t 编码格式
+ */
+result_format_t result_format_negotiate(const char *accept) {
+  static const struct {
+    const char *mime;
+    result_format_t format;
+  } candidates[] = {
+      {KEY_MIME_ROWSET, RESULT_FORMAT_ROWSET},
+      {KEY_MIME_NDJSON, RESULT_FORMAT_NDJSON},
+      {KEY_MIME_JSON, RESULT_FORMAT_JSON},
+      {KEY_MIME_TEXT, RESULT_FORMAT_TEXT},
+  };
+  if (!accept) {
+    return RESULT_FORMAT_TEXT;
+  }
+
+  result_format_t format = RESULT_FORMAT_TEXT;
+  double best = 0;
+  for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i) {
+    double weight = accept_weight(accept, candidates[i].mime);
+    if (weight > best) {
+      best = weight;
+      format = candidates[i].format;
+    }
+  }
+  return format;
+}
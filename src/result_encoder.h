@@ -0,0 +1,32 @@
+#pragma once
+
+// clang-format off
+#include <mysql/mysql.h>
+#include "src/strbuf.h"
+// clang-format on
+
+// 结果集编码格式
+typedef enum {
+  RESULT_FORMAT_TEXT = 0,   // 定宽文本表格
+  RESULT_FORMAT_ROWSET = 1, // 带类型的紧凑二进制格式，见 rowset.h
+  RESULT_FORMAT_JSON = 2,   // {"rows":[{列名:值,...},...],"count":行数}
+  RESULT_FORMAT_NDJSON = 3, // 每行一个 JSON 对象
+} result_format_t;
+
+// 结果集编码器：按 表头 -> 逐行 -> 结尾 的顺序增量输出，单次只需要一行数据常驻内存
+typedef struct {
+  result_format_t format;
+  const MYSQL_FIELD *fields;
+  int num_fields;
+  unsigned long long num_rows;
+} result_encoder_t;
+
+void result_encoder_init(result_encoder_t *encoder, result_format_t format,
+                         const MYSQL_FIELD *fields, int num_fields);
+int result_encoder_begin(result_encoder_t *encoder, strbuf_t *out);
+int result_encoder_row(result_encoder_t *encoder, MYSQL_ROW row, const unsigned long *lengths,
+                       strbuf_t *out);
+int result_encoder_end(result_encoder_t *encoder, strbuf_t *out);
+int result_encoder_error(result_encoder_t *encoder, const char *error_msg, strbuf_t *out);
+const char *result_format_content_type(result_format_t format);
+result_format_t result_format_negotiate(const char *accept);
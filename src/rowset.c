@@ -0,0 +1,380 @@
+// clang-format off
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rowset.h"
+#include "src/key.h"
+// clang-format on
+
+#define TEXT_CELL_WIDTH 15
+
+// 解码游标
+typedef struct {
+  const unsigned char *ptr;
+  const unsigned char *end;
+} rowset_reader_t;
+
+/**
+ * @brief 追加 LEB128 变长整数
+ *
+ * @param out 输出缓冲区
+ * @param value 整数
+ * @return int 成功（0）；失败（-1）
+ */
+int rowset_put_varint(strbuf_t *out, uint64_t value) {
+  unsigned char bytes[10];
+  size_t n = 0;
+  do {
+    unsigned char byte = value & 0x7F;
+    value >>= 7;
+    bytes[n++] = byte | (value ? 0x80 : 0);
+  } while (value);
+  return strbuf_append(out, bytes, n);
+}
+
+static bool read_bytes(rowset_reader_t *reader, void *dst, size_t len) {
+  if ((size_t)(reader->end - reader->ptr) < len) {
+    return false;
+  }
+  memcpy(dst, reader->ptr, len);
+  reader->ptr += len;
+  return true;
+}
+
+static bool read_u8(rowset_reader_t *reader, uint8_t *value) {
+  return read_bytes(reader, value, 1);
+}
+
+static bool read_u16(rowset_reader_t *reader, uint16_t *value) {
+  unsigned char bytes[2];
+  if (!read_bytes(reader, bytes, sizeof(bytes))) {
+    return false;
+  }
+  *value = (uint16_t)(bytes[0] | (bytes[1] << 8));
+  return true;
+}
+
+static bool read_u64(rowset_reader_t *reader, uint64_t *value) {
+  if (reader->end - reader->ptr < 8) {
+    return false;
+  }
+  const unsigned char *bytes = reader->ptr;
+  *value = (uint64_t)bytes[0] | (uint64_t)bytes[1] << 8 | (uint64_t)bytes[2] << 16 |
+           (uint64_t)bytes[3] << 24 | (uint64_t)bytes[4] << 32 | (uint64_t)bytes[5] << 40 |
+           (uint64_t)bytes[6] << 48 | (uint64_t)bytes[7] << 56;
+  reader->ptr += 8;
+  return true;
+}
+
+static bool read_varint(rowset_reader_t *reader, uint64_t *value) {
+  // 绝大多数字段长度小于 128，单字节快速路径
+  if (reader->ptr < reader->end && !(*reader->ptr & 0x80)) {
+    *value = *reader->ptr++;
+    return true;
+  }
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte;
+    if (!read_u8(reader, &byte)) {
+      return false;
+    }
+    *value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief 读取一个长度前缀的字节串（指向原始数据，不拷贝）
+ */
+static bool read_slice(rowset_reader_t *reader, const char **ptr, size_t *len) {
+  uint64_t n;
+  if (!read_varint(reader, &n) || (uint64_t)(reader->end - reader->ptr) < n) {
+    return false;
+  }
+  *ptr = (const char *)reader->ptr;
+  *len = (size_t)n;
+  reader->ptr += n;
+  return true;
+}
+
+/**
+ * @brief 解码表头
+ */
+static bool decode_header(rowset_reader_t *reader, rowset_t *rowset) {
+  char magic[ROWSET_MAGIC_LEN];
+  uint8_t version;
+  uint16_t num_columns;
+  if (!read_bytes(reader, magic, sizeof(magic)) || memcmp(magic, ROWSET_MAGIC, sizeof(magic)) ||
+      !read_u8(reader, &version) || version != ROWSET_VERSION || !read_u16(reader, &num_columns)) {
+    return false;
+  }
+
+  rowset->columns = calloc(num_columns ? num_columns : 1, sizeof(rowset_column_t));
+  if (!rowset->columns) {
+    return false;
+  }
+  rowset->num_columns = num_columns;
+
+  for (int i = 0; i < num_columns; ++i) {
+    rowset_column_t *column = &rowset->columns[i];
+    uint16_t name_len;
+    if (!read_u8(reader, &column->type) || !read_u8(reader, &column->mysql_type) ||
+        !read_u16(reader, &column->flags) || !read_u16(reader, &name_len) ||
+        column->type > ROWSET_TYPE_DOUBLE) {
+      return false;
+    }
+    column->name = malloc(name_len + 1);
+    if (!column->name || !read_bytes(reader, column->name, name_len)) {
+      return false;
+    }
+    column->name[name_len] = '\0';
+  }
+  return true;
+}
+
+/**
+ * @brief 解码一行数据，追加到 values
+ */
+static bool decode_row(rowset_reader_t *reader, rowset_t *rowset, size_t *cap_values) {
+  size_t num_columns = (size_t)rowset->num_columns;
+  size_t need = (rowset->num_rows + 1) * num_columns;
+  if (need > *cap_values) {
+    size_t new_cap = *cap_values ? *cap_values * 2 : 64 * (num_columns ? num_columns : 1);
+    while (new_cap < need) {
+      new_cap *= 2;
+    }
+    rowset_value_t *ptr = realloc(rowset->values, new_cap * sizeof(rowset_value_t));
+    if (!ptr) {
+      return false;
+    }
+    rowset->values = ptr;
+    *cap_values = new_cap;
+  }
+
+  size_t bitmap_len = (num_columns + 7) / 8;
+  if ((size_t)(reader->end - reader->ptr) < bitmap_len) {
+    return false;
+  }
+  const unsigned char *bitmap = reader->ptr;
+  reader->ptr += bitmap_len;
+
+  rowset_value_t *values = rowset->values + rowset->num_rows * num_columns;
+  for (size_t i = 0; i < num_columns; ++i) {
+    rowset_value_t *value = &values[i];
+    value->is_null = (bitmap[i / 8] >> (i % 8)) & 1;
+    if (value->is_null) {
+      continue;
+    }
+
+    switch (rowset->columns[i].type) {
+    case ROWSET_TYPE_INT64:
+    case ROWSET_TYPE_UINT64:
+      if (!read_u64(reader, &value->u64)) {
+        return false;
+      }
+      break;
+    case ROWSET_TYPE_DOUBLE: {
+      uint64_t bits;
+      if (!read_u64(reader, &bits)) {
+        return false;
+      }
+      memcpy(&value->f64, &bits, sizeof(bits));
+      break;
+    }
+    default:
+      if (!read_slice(reader, &value->bytes.ptr, &value->bytes.len)) {
+        return false;
+      }
+      break;
+    }
+  }
+
+  ++rowset->num_rows;
+  return true;
+}
+
+/**
+ * @brief 解码二进制结果集
+ *
+ * @param data 数据
+ * @param len 数据长度
+ * @return rowset_t* 结果集，格式错误返回 NULL
+ */
+rowset_t *rowset_decode(const char *data, size_t len) {
+  rowset_t *rowset = calloc(1, sizeof(rowset_t));
+  if (!rowset) {
+    return NULL;
+  }
+
+  // 字节串类型的值直接指向 raw，不逐个拷贝
+  rowset->raw = malloc(len ? len : 1);
+  if (!rowset->raw) {
+    free(rowset);
+    return NULL;
+  }
+  memcpy(rowset->raw, data, len);
+
+  rowset_reader_t reader = {(const unsigned char *)rowset->raw,
+                            (const unsigned char *)rowset->raw + len};
+  if (!decode_header(&reader, rowset)) {
+    rowset_free(rowset);
+    return NULL;
+  }
+
+  size_t cap_values = 0;
+  while (true) {
+    uint8_t tag;
+    if (!read_u8(&reader, &tag)) {
+      // 数据流被截断
+      rowset_free(rowset);
+      return NULL;
+    }
+
+    if (tag == ROWSET_TAG_ROW) {
+      if (!decode_row(&reader, rowset, &cap_values)) {
+        rowset_free(rowset);
+        return NULL;
+      }
+    } else if (tag == ROWSET_TAG_END) {
+      uint64_t num_rows;
+      if (!read_u64(&reader, &num_rows) || num_rows != rowset->num_rows) {
+        rowset_free(rowset);
+        return NULL;
+      }
+      break;
+    } else if (tag == ROWSET_TAG_ERROR) {
+      const char *msg;
+      size_t msg_len;
+      if (!read_slice(&reader, &msg, &msg_len) || !(rowset->error = malloc(msg_len + 1))) {
+        rowset_free(rowset);
+        return NULL;
+      }
+      memcpy(rowset->error, msg, msg_len);
+      rowset->error[msg_len] = '\0';
+      break;
+    } else {
+      rowset_free(rowset);
+      return NULL;
+    }
+  }
+
+  return rowset;
+}
+
+/**
+ * @brief 获取指定行列的值
+ *
+ * @param rowset 结果集
+ * @param row 行号
+ * @param column 列号
+ * @return const rowset_value_t* 值，越界返回 NULL
+ */
+const rowset_value_t *rowset_value(const rowset_t *rowset, size_t row, int column) {
+  if (!rowset || row >= rowset->num_rows || column < 0 || column >= rowset->num_columns) {
+    return NULL;
+  }
+  return &rowset->values[row * rowset->num_columns + column];
+}
+
+/**
+ * @brief 输出一个左对齐、至少 TEXT_CELL_WIDTH 宽的文本单元格
+ */
+static int text_cell(strbuf_t *out, const char *data, size_t len) {
+  if (strbuf_append(out, data, len) != 0) {
+    return -1;
+  }
+  for (size_t i = len; i < TEXT_CELL_WIDTH; ++i) {
+    if (strbuf_append_char(out, ' ') != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief 按服务端文本格式渲染结果集
+ *
+ * @param rowset 结果集
+ * @param out 输出缓冲区
+ * @return int 成功（0）；失败（-1）
+ */
+int rowset_to_text(const rowset_t *rowset, strbuf_t *out) {
+  for (int i = 0; i < rowset->num_columns; ++i) {
+    if (text_cell(out, rowset->columns[i].name, strlen(rowset->columns[i].name)) != 0) {
+      return -1;
+    }
+  }
+  if (strbuf_append_char(out, '\n') != 0) {
+    return -1;
+  }
+  for (int i = 0; i < rowset->num_columns; ++i) {
+    if (text_cell(out, "---------------", TEXT_CELL_WIDTH) != 0) {
+      return -1;
+    }
+  }
+  if (strbuf_append_char(out, '\n') != 0) {
+    return -1;
+  }
+
+  for (size_t row = 0; row < rowset->num_rows; ++row) {
+    for (int i = 0; i < rowset->num_columns; ++i) {
+      const rowset_value_t *value = rowset_value(rowset, row, i);
+      char number[32];
+      int rc;
+      if (value->is_null) {
+        rc = text_cell(out, "NULL", 4);
+      } else if (rowset->columns[i].type == ROWSET_TYPE_INT64) {
+        rc = text_cell(out, number,
+                       snprintf(number, sizeof(number), "%lld", (long long)value->i64));
+      } else if (rowset->columns[i].type == ROWSET_TYPE_UINT64) {
+        rc = text_cell(out, number,
+                       snprintf(number, sizeof(number), "%llu", (unsigned long long)value->u64));
+      } else if (rowset->columns[i].type == ROWSET_TYPE_DOUBLE) {
+        // 优先用较短的表示，无法精确还原时再用 17 位有效数字
+        int n = snprintf(number, sizeof(number), "%.15g", value->f64);
+        if (strtod(number, NULL) != value->f64) {
+          n = snprintf(number, sizeof(number), "%.17g", value->f64);
+        }
+        rc = text_cell(out, number, n);
+      } else {
+        rc = text_cell(out, value->bytes.ptr, value->bytes.len);
+      }
+      if (rc != 0) {
+        return -1;
+      }
+    }
+    if (strbuf_append_char(out, '\n') != 0) {
+      return -1;
+    }
+  }
+
+  if (rowset->error) {
+    return strbuf_appendf(out, "%s Read operation failed: %s\n", KEY_RESP_ERROR, rowset->error);
+  }
+  return 0;
+}
+
+/**
+ * @brief 释放结果集
+ *
+ * @param rowset 结果集
+ */
+void rowset_free(rowset_t *rowset) {
+  if (!rowset) {
+    return;
+  }
+
+  if (rowset->columns) {
+    for (int i = 0; i < rowset->num_columns; ++i) {
+      free(rowset->columns[i].name);
+    }
+    free(rowset->columns);
+  }
+  free(rowset->values);
+  free(rowset->error);
+  free(rowset->raw);
+  free(rowset);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "src/strbuf.h"
+// clang-format on
+
+// 二进制结果集格式（所有整数均为小端序）：
+//   表头：magic "DBRS" | version u8 | 列数 u16 | 每列 { 编码类型 u8 | MySQL 类型 u8 | flags u16 |
+//         列名长度 u16 | 列名 }
+//   数据行：ROWSET_TAG_ROW | NULL 位图 ceil(列数/8) 字节（第 i 位为 1 表示第 i 列为 NULL）|
+//         每个非 NULL 列 { INT64/UINT64/DOUBLE: 8 字节；BYTES: varint 长度 + 数据 }
+//   结尾：ROWSET_TAG_END | 行数 u64
+//   错误：ROWSET_TAG_ERROR | varint 长度 + 错误信息（之后不再有数据）
+#define ROWSET_MAGIC "DBRS"
+#define ROWSET_MAGIC_LEN 4
+#define ROWSET_VERSION 1
+
+#define ROWSET_TAG_END 0x00
+#define ROWSET_TAG_ROW 0x01
+#define ROWSET_TAG_ERROR 0xFF
+
+// 列值在线路上的编码类型
+typedef enum {
+  ROWSET_TYPE_BYTES = 0,
+  ROWSET_TYPE_INT64 = 1,
+  ROWSET_TYPE_UINT64 = 2,
+  ROWSET_TYPE_DOUBLE = 3,
+} rowset_type_t;
+
+typedef struct {
+  char *name;
+  uint8_t type;       // rowset_type_t
+  uint8_t mysql_type; // enum enum_field_types
+  uint16_t flags;     // MySQL 列标志的低 16 位
+} rowset_column_t;
+
+typedef struct {
+  bool is_null;
+  union {
+    int64_t i64;
+    uint64_t u64;
+    double f64;
+    struct {
+      const char *ptr; // 指向 rowset_t::raw 内部，不以 '\0' 结尾
+      size_t len;
+    } bytes;
+  };
+} rowset_value_t;
+
+// 解码后的结果集，values 按行优先存放，共 num_rows * num_columns 个
+typedef struct {
+  char *raw;
+  int num_columns;
+  rowset_column_t *columns;
+  size_t num_rows;
+  rowset_value_t *values;
+  char *error; // 服务端在数据流中报告的错误
+} rowset_t;
+
+int rowset_put_varint(strbuf_t *out, uint64_t value);
+rowset_t *rowset_decode(const char *data, size_t len);
+const rowset_value_t *rowset_value(const rowset_t *rowset, size_t row, int column);
+int rowset_to_text(const rowset_t *rowset, strbuf_t *out);
+void rowset_free(rowset_t *rowset);
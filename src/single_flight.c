@@ -0,0 +1,294 @@
+// clang-format off
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "single_flight.h"
+#include "src/assert.h"
+#include "src/logger.h"
+#include "src/read_cache.h"
+#include "src/strbuf.h"
+// clang-format on
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+// 一个在途的读取，由领头和全部等待者共同持有，最后一个释放的负责回收
+struct single_flight_call {
+  struct single_flight_call *next; // 同一个桶中的下一个读取
+  uint64_t hash;
+  int waiters; // 等待结果的请求数
+  int refs;    // 领头加上尚未返回的等待者
+  bool done;
+  char *body; // 领头共享的响应体，不共享时为 NULL
+  size_t len;
+  pthread_cond_t cond;
+  size_t key_len;
+  char key[];
+};
+
+static uint64_t fnv1a(const void *data, size_t len) {
+  const unsigned char *bytes = data;
+  uint64_t hash = FNV_OFFSET;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+static single_flight_shard_t *shard_of(single_flight_t *flights, uint64_t hash) {
+  return &flights->shards[hash % SINGLE_FLIGHT_SHARDS];
+}
+
+static single_flight_call_t **bucket_of(single_flight_shard_t *shard, uint64_t hash) {
+  return &shard->buckets[(hash / SINGLE_FLIGHT_SHARDS) % SINGLE_FLIGHT_BUCKETS];
+}
+
+static void call_free(single_flight_call_t *call) {
+  pthread_cond_destroy(&call->cond);
+  free(call->body);
+  free(call);
+}
+
+/**
+ * @brief 初始化
+ *
+ * @param flights 在途读取表
+ * @param enabled 是否合并；不合并时 single_flight_join() 总是返回 NULL
+ * @return int 成功（0）；失败（-1）
+ */
+int single_flight_init(single_flight_t *flights, bool enabled) {
+  DBMNGR_ASSERT(flights);
+  memset(flights, 0, sizeof(*flights));
+  if (!enabled) {
+    return 0;
+  }
+
+  flights->shards = aligned_alloc(alignof(single_flight_shard_t),
+                                  sizeof(single_flight_shard_t) * SINGLE_FLIGHT_SHARDS);
+  if (!flights->shards) {
+    LOG_ERROR("Failed to allocate single-flight shards");
+    return -1;
+  }
+  memset(flights->shards, 0, sizeof(single_flight_shard_t) * SINGLE_FLIGHT_SHARDS);
+  for (size_t i = 0; i < SINGLE_FLIGHT_SHARDS; ++i) {
+    if (pthread_mutex_init(&flights->shards[i].mutex, NULL) != 0) {
+      LOG_ERROR("Failed to initialize single-flight mutex");
+      for (size_t j = 0; j < i; ++j) {
+        pthread_mutex_destroy(&flights->shards[j].mutex);
+      }
+      free(flights->shards);
+      flights->shards = NULL;
+      return -1;
+    }
+  }
+  flights->enabled = true;
+  return 0;
+}
+
+/**
+ * @brief 销毁，调用时不能再有在途的读取
+ *
+ * @param flights 在途读取表
+ */
+void single_flight_destroy(single_flight_t *flights) {
+  if (!flights || !flights->shards) {
+    return;
+  }
+  for (size_t i = 0; i < SINGLE_FLIGHT_SHARDS; ++i) {
+    pthread_mutex_destroy(&flights->shards[i].mutex);
+  }
+  free(flights->shards);
+  flights->shards = NULL;
+  flights->enabled = false;
+}
+
+/**
+ * @brief 加入相同的在途读取，没有时登记为领头
+ *
+ * 领头查询 MySQL 后必须调用 single_flight_finish()；等待者必须调用 single_flight_wait()
+ *
+ * @param flights 在途读取表
+ * @param table 表名
+ * @param where 条件，可以为 NULL
+ * @param format 编码格式
+ * @param version 查询之前读到的表版本号
+ * @param leader 输出是否为领头
+ * @return single_flight_call_t* 在途读取；未启用、读取不能合并或内存不足时返回 NULL
+ */
+single_flight_call_t *single_flight_join(single_flight_t *flights, const char *table,
+                                         const char *where, result_format_t format,
+                                         uint64_t version, bool *leader) {
+  if (!flights->enabled) {
+    return NULL;
+  }
+  strbuf_t key;
+  strbuf_init(&key);
+  if (read_cache_key(table, where, format, &key) != 0 ||
+      strbuf_append(&key, &version, sizeof(version)) != 0) {
+    strbuf_free(&key);
+    return NULL;
+  }
+
+  uint64_t hash = fnv1a(key.data, key.len);
+  single_flight_shard_t *shard = shard_of(flights, hash);
+  single_flight_call_t **bucket = bucket_of(shard, hash);
+  pthread_mutex_lock(&shard->mutex);
+  single_flight_call_t *call = *bucket;
+  while (call && (call->hash != hash || call->key_len != key.len ||
+                  memcmp(call->key, key.data, key.len) != 0)) {
+    call = call->next;
+  }
+  if (call) {
+    call->waiters++;
+    call->refs++;
+    *leader = false;
+    pthread_mutex_unlock(&shard->mutex);
+    strbuf_free(&key);
+    return call;
+  }
+
+  call = calloc(1, sizeof(single_flight_call_t) + key.len);
+  pthread_condattr_t attr;
+  bool attr_ok = pthread_condattr_init(&attr) == 0;
+  bool cond_ok = call && attr_ok && pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0 &&
+                 pthread_cond_init(&call->cond, &attr) == 0;
+  if (attr_ok) {
+    pthread_condattr_destroy(&attr);
+  }
+  if (!cond_ok) {
+    pthread_mutex_unlock(&shard->mutex);
+    LOG_WARN("Failed to register an in-flight read, running it alone");
+    free(call);
+    strbuf_free(&key);
+    return NULL;
+  }
+  call->hash = hash;
+  call->refs = 1;
+  call->key_len = key.len;
+  memcpy(call->key, key.data, key.len);
+  call->next = *bucket;
+  *bucket = call;
+  *leader = true;
+  pthread_mutex_unlock(&shard->mutex);
+  strbuf_free(&key);
+  return call;
+}
+
+/**
+ * @brief 目前等待领头结果的请求数，领头据此决定是否预读整个结果
+ *
+ * @param flights 在途读取表
+ * @param call 在途读取
+ * @return int 等待者数
+ */
+int single_flight_waiters(single_flight_t *flights, single_flight_call_t *call) {
+  single_flight_shard_t *shard = shard_of(flights, call->hash);
+  pthread_mutex_lock(&shard->mutex);
+  int waiters = call->waiters;
+  pthread_mutex_unlock(&shard->mutex);
+  return waiters;
+}
+
+/**
+ * @brief 领头结束读取：不再接受新的等待者，把响应体交给已有的等待者并唤醒它们
+ *
+ * @param flights 在途读取表
+ * @param call 在途读取
+ * @param body 完整的响应体，NULL 表示不共享（出错或结果太大），等待者各自查询
+ * @param len 响应体长度
+ */
+void single_flight_finish(single_flight_t *flights, single_flight_call_t *call, const char *body,
+                          size_t len) {
+  single_flight_shard_t *shard = shard_of(flights, call->hash);
+  pthread_mutex_lock(&shard->mutex);
+  single_flight_call_t **link = bucket_of(shard, call->hash);
+  while (*link != call) {
+    link = &(*link)->next;
+  }
+  *link = call->next;
+  int waiters = call->waiters;
+  pthread_mutex_unlock(&shard->mutex);
+
+  // 已经摘下，不会再有新的等待者，复制时不必持锁
+  char *copy = NULL;
+  if (body && waiters > 0) {
+    copy = malloc(len > 0 ? len : 1);
+    if (copy) {
+      memcpy(copy, body, len);
+    } else {
+      LOG_WARN("Failed to share a read result, %d waiter(s) will query alone", waiters);
+    }
+  }
+
+  pthread_mutex_lock(&shard->mutex);
+  call->done = true;
+  call->body = copy;
+  call->len = len;
+  pthread_cond_broadcast(&call->cond);
+  bool last = --call->refs == 0;
+  pthread_mutex_unlock(&shard->mutex);
+  if (last) {
+    call_free(call);
+  }
+}
+
+/**
+ * @brief 等待领头的结果，复制到请求内存区域
+ *
+ * @param flights 在途读取表
+ * @param call 在途读取
+ * @param deadline_us 截止时间（单调时钟），0 表示一直等待
+ * @param arena 请求内存区域
+ * @param len 输出响应体长度
+ * @return const char* 响应体（以 NUL 结尾）；领头没有共享结果、超过截止时间或内存不足时
+ * 返回 NULL，调用者自行查询
+ */
+const char *single_flight_wait(single_flight_t *flights, single_flight_call_t *call,
+                               uint64_t deadline_us, arena_t *arena, size_t *len) {
+  single_flight_shard_t *shard = shard_of(flights, call->hash);
+  struct timespec ts = {
+      .tv_sec = (time_t)(deadline_us / 1000000),
+      .tv_nsec = (long)(deadline_us % 1000000) * 1000,
+  };
+  pthread_mutex_lock(&shard->mutex);
+  while (!call->done) {
+    if (deadline_us == 0) {
+      pthread_cond_wait(&call->cond, &shard->mutex);
+    } else if (pthread_cond_timedwait(&call->cond, &shard->mutex, &ts) == ETIMEDOUT) {
+      break;
+    }
+  }
+  bool done = call->done;
+  pthread_mutex_unlock(&shard->mutex);
+
+  // 完成之后响应体不再改变，而且持有引用期间不会被释放
+  char *body = NULL;
+  if (done && call->body) {
+    body = arena_alloc(arena, call->len + 1);
+    if (body) {
+      memcpy(body, call->body, call->len);
+      body[call->len] = '\0';
+      *len = call->len;
+      atomic_fetch_add_explicit(&flights->coalesced, 1, memory_order_relaxed);
+    }
+  }
+
+  pthread_mutex_lock(&shard->mutex);
+  bool last = --call->refs == 0;
+  pthread_mutex_unlock(&shard->mutex);
+  if (last) {
+    call_free(call);
+  }
+  return body;
+}
+
+/**
+ * @brief 复制了其他请求结果的读取数
+ *
+ * @param flights 在途读取表
+ * @return unsigned long long 计数
+ */
+unsigned long long single_flight_coalesced(single_flight_t *flights) {
+  return atomic_load_explicit(&flights->coalesced, memory_order_relaxed);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// clang-format off
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "src/arena.h"
+#include "src/result_encoder.h"
+// clang-format on
+
+// 分片数，每个分片独立加锁
+#define SINGLE_FLIGHT_SHARDS 16
+// 每个分片的哈希桶数，同一时刻在途的不同读取不多
+#define SINGLE_FLIGHT_BUCKETS 64
+// 有其他请求等待时，领头的 HTTP 读取最多预读这么多字节的结果交给它们，更大的结果各自查询
+#define SINGLE_FLIGHT_MAX_BYTES (1 << 20)
+
+struct single_flight_call;
+
+typedef struct {
+  alignas(64) pthread_mutex_t mutex;
+  struct single_flight_call *buckets[SINGLE_FLIGHT_BUCKETS];
+} single_flight_shard_t;
+
+/**
+ * 合并相同的在途读取：同一张表、条件、编码格式和表版本号的 READ 同时到达时，只有第一个
+ * （领头）查询 MySQL，其余的等待并复制它编码好的响应体
+ *
+ * 键中含有查询之前读到的表版本号，晚到的请求只会合并到它到达时表尚未被写过的读取上，
+ * 不会读到比自己到达时更旧的数据
+ */
+typedef struct {
+  bool enabled;
+  single_flight_shard_t *shards;
+  atomic_ullong coalesced; // 复制了其他请求结果的读取
+} single_flight_t;
+
+typedef struct single_flight_call single_flight_call_t;
+
+int single_flight_init(single_flight_t *flights, bool enabled);
+void single_flight_destroy(single_flight_t *flights);
+single_flight_call_t *single_flight_join(single_flight_t *flights, const char *table,
+                                         const char *where, result_format_t format,
+                                         uint64_t version, bool *leader);
+int single_flight_waiters(single_flight_t *flights, single_flight_call_t *call);
+void single_flight_finish(single_flight_t *flights, single_flight_call_t *call, const char *body,
+                          size_t len);
+const char *single_flight_wait(single_flight_t *flights, single_flight_call_t *call,
+                               uint64_t deadline_us, arena_t *arena, size_t *len);
+unsigned long long single_flight_coalesced(single_flight_t *flights);
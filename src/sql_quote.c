@@ -0,0 +1,51 @@
+// clang-format off
+#include "sql_quote.h"
+// clang-format on
+
+/**
+ * @brief 追加反引号括起的标识符，标识符中的反引号写两次
+ *
+ * @param out 语句
+ * @param name 标识符（不要求以 '\0' 结尾）
+ * @param len 长度
+ * @return int 成功（0）；失败（-1）
+ */
+int sql_identifier_append(strbuf_t *out, const char *name, size_t len) {
+  int rc = strbuf_append_char(out, '`');
+  for (size_t i = 0; rc == 0 && i < len; ++i) {
+    rc = name[i] == '`' ? strbuf_append(out, "``", 2) : strbuf_append_char(out, name[i]);
+  }
+  return rc != 0 ? -1 : strbuf_append_char(out, '`');
+}
+
+/**
+ * @brief 追加单引号括起的字符串字面量：单引号写两次，'\0' 和反斜杠用反斜杠转义
+ *
+ * 单引号写两次在任何 sql_mode 下都不会结束字面量；反斜杠转义要求会话设置为
+ * SQL_QUOTE_CHARSET 和 SQL_QUOTE_SESSION_SQL_MODE，连接池的连接都是这样设置的
+ *
+ * @param out 语句
+ * @param value 值，可以含 '\0'
+ * @param len 长度
+ * @return int 成功（0）；失败（-1）
+ */
+int sql_string_append(strbuf_t *out, const char *value, size_t len) {
+  int rc = strbuf_reserve(out, len + 2);
+  rc = rc || strbuf_append_char(out, '\'');
+  for (size_t i = 0; rc == 0 && i < len; ++i) {
+    switch (value[i]) {
+    case '\0':
+      rc = strbuf_append(out, "\\0", 2);
+      break;
+    case '\'':
+      rc = strbuf_append(out, "''", 2);
+      break;
+    case '\\':
+      rc = strbuf_append(out, "\\\\", 2);
+      break;
+    default:
+      rc = strbuf_append_char(out, value[i]);
+    }
+  }
+  return rc != 0 ? -1 : strbuf_append_char(out, '\'');
+}
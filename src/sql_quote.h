@@ -0,0 +1,16 @@
+#pragma once
+
+// clang-format off
+#include <stddef.h>
+#include "src/strbuf.h"
+// clang-format on
+
+// sql_string_append() 的转义依赖的会话设置，连接池的每个连接建立后设置：
+// 连接字符集为 utf8mb4（多字节字符的后续字节不会是反斜杠），sql_mode 不含 NO_BACKSLASH_ESCAPES
+#define SQL_QUOTE_CHARSET "utf8mb4"
+#define SQL_QUOTE_SESSION_SQL_MODE                                                                 \
+  "SET SESSION sql_mode = TRIM(BOTH ',' FROM REPLACE(CONCAT(',', @@SESSION.sql_mode, ','), "      \
+  "',NO_BACKSLASH_ESCAPES,', ','))"
+
+int sql_identifier_append(strbuf_t *out, const char *name, size_t len);
+int sql_string_append(strbuf_t *out, const char *value, size_t len);
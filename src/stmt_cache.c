@@ -0,0 +1,178 @@
+// clang-format off
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stmt_cache.h"
+#include "src/assert.h"
+#include "src/clock.h"
+#include "src/logger.h"
+// clang-format on
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+static uint64_t fnv1a(const void *data, size_t len) {
+  const unsigned char *bytes = data;
+  uint64_t hash = FNV_OFFSET;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+static void count(atomic_ullong *counter, unsigned long long value) {
+  atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+/**
+ * @brief 初始化共享计数
+ *
+ * @param counters 计数
+ */
+void stmt_cache_counters_init(stmt_cache_counters_t *counters) {
+  atomic_init(&counters->hits, 0);
+  atomic_init(&counters->misses, 0);
+  atomic_init(&counters->evictions, 0);
+  atomic_init(&counters->invalidations, 0);
+  atomic_init(&counters->prepares, 0);
+  atomic_init(&counters->prepare_us, 0);
+}
+
+/**
+ * @brief 读取计数快照，并估计命中省下的准备耗时
+ *
+ * @param counters 计数
+ * @param stats 输出快照
+ */
+void stmt_cache_counters_stats(stmt_cache_counters_t *counters, stmt_cache_stats_t *stats) {
+  stats->hits = atomic_load_explicit(&counters->hits, memory_order_relaxed);
+  stats->misses = atomic_load_explicit(&counters->misses, memory_order_relaxed);
+  stats->evictions = atomic_load_explicit(&counters->evictions, memory_order_relaxed);
+  stats->invalidations = atomic_load_explicit(&counters->invalidations, memory_order_relaxed);
+  stats->prepares = atomic_load_explicit(&counters->prepares, memory_order_relaxed);
+  stats->prepare_us = atomic_load_explicit(&counters->prepare_us, memory_order_relaxed);
+  unsigned long long lookups = stats->hits + stats->misses;
+  stats->hit_ratio = lookups > 0 ? (double)stats->hits / (double)lookups : 0.0;
+  stats->saved_us =
+      stats->prepares > 0
+          ? (unsigned long long)((double)stats->hits * (double)stats->prepare_us /
+                                 (double)stats->prepares)
+          : 0;
+}
+
+/**
+ * @brief 初始化一个连接上的语句缓存
+ *
+ * @param cache 语句缓存
+ * @param counters 共享计数
+ */
+void stmt_cache_init(stmt_cache_t *cache, stmt_cache_counters_t *counters) {
+  DBMNGR_ASSERT(counters);
+  memset(cache->entries, 0, sizeof(cache->entries));
+  cache->count = 0;
+  cache->tick = 0;
+  cache->thread_id = 0;
+  cache->counters = counters;
+}
+
+/**
+ * @brief 取得语句的预处理句柄，缓存中没有时在连接上准备并缓存，缓存已满时关闭最久未用的语句
+ *
+ * 连接的 MySQL 会话变了（重连）时，之前准备的语句都已在服务器上失效，先全部丢弃
+ *
+ * @param cache 语句缓存
+ * @param mysql 连接，必须是缓存所属的连接
+ * @param sql 语句，值用 '?' 占位
+ * @param error_no 失败时输出错误码，0 表示不是 MySQL 的错误
+ * @param error_msg 失败时输出错误信息
+ * @param size 错误信息缓冲区大小
+ * @return MYSQL_STMT* 预处理句柄，属于缓存，不要关闭；失败返回 NULL
+ */
+MYSQL_STMT *stmt_cache_prepare(stmt_cache_t *cache, MYSQL *mysql, const char *sql,
+                               unsigned int *error_no, char *error_msg, size_t size) {
+  *error_no = 0;
+  unsigned long thread_id = mysql_thread_id(mysql);
+  if (thread_id != cache->thread_id) {
+    stmt_cache_clear(cache);
+    cache->thread_id = thread_id;
+  }
+
+  size_t len = strlen(sql);
+  uint64_t hash = fnv1a(sql, len);
+  ++cache->tick;
+  for (size_t i = 0; i < cache->count; ++i) {
+    stmt_cache_entry_t *entry = &cache->entries[i];
+    if (entry->hash == hash && entry->len == len && memcmp(entry->sql, sql, len) == 0) {
+      entry->last_used = cache->tick;
+      count(&cache->counters->hits, 1);
+      return entry->stmt;
+    }
+  }
+  count(&cache->counters->misses, 1);
+
+  char *copy = malloc(len + 1);
+  MYSQL_STMT *stmt = copy ? mysql_stmt_init(mysql) : NULL;
+  if (!stmt) {
+    LOG_ERROR("Failed to allocate memory for prepared statement");
+    snprintf(error_msg, size, "Out of memory");
+    free(copy);
+    return NULL;
+  }
+  memcpy(copy, sql, len + 1);
+
+  uint64_t start_us = clock_now_us();
+  if (mysql_stmt_prepare(stmt, sql, (unsigned long)len) != 0) {
+    // mysql_stmt_close() 会清除连接上的错误，先取出来
+    *error_no = mysql_stmt_errno(stmt);
+    snprintf(error_msg, size, "%s", mysql_stmt_error(stmt));
+    LOG_WARN("Failed to prepare statement: %s", error_msg);
+    mysql_stmt_close(stmt);
+    free(copy);
+    return NULL;
+  }
+  count(&cache->counters->prepare_us, clock_now_us() - start_us);
+  count(&cache->counters->prepares, 1);
+
+  stmt_cache_entry_t *entry = &cache->entries[cache->count];
+  if (cache->count == STMT_CACHE_CAPACITY) {
+    entry = &cache->entries[0];
+    for (size_t i = 1; i < cache->count; ++i) {
+      if (cache->entries[i].last_used < entry->last_used) {
+        entry = &cache->entries[i];
+      }
+    }
+    LOG_DEBUG("Evicting prepared statement: %s", entry->sql);
+    mysql_stmt_close(entry->stmt);
+    free(entry->sql);
+    count(&cache->counters->evictions, 1);
+  } else {
+    ++cache->count;
+  }
+  entry->stmt = stmt;
+  entry->sql = copy;
+  entry->len = len;
+  entry->hash = hash;
+  entry->last_used = cache->tick;
+  return stmt;
+}
+
+/**
+ * @brief 关闭全部语句，连接重建或关闭时调用
+ *
+ * 在 mysql_close() 之后调用时，mysql_stmt_close() 只释放客户端的内存，不再访问断开的连接
+ *
+ * @param cache 语句缓存
+ */
+void stmt_cache_clear(stmt_cache_t *cache) {
+  if (cache->count > 0) {
+    LOG_DEBUG("Dropping %zu prepared statements", cache->count);
+    count(&cache->counters->invalidations, cache->count);
+  }
+  for (size_t i = 0; i < cache->count; ++i) {
+    mysql_stmt_close(cache->entries[i].stmt);
+    free(cache->entries[i].sql);
+  }
+  memset(cache->entries, 0, sizeof(cache->entries));
+  cache->count = 0;
+  cache->thread_id = 0;
+}
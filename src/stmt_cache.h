@@ -0,0 +1,57 @@
+#pragma once
+
+// clang-format off
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <mysql/mysql.h>
+// clang-format on
+
+// 每个连接缓存的预处理语句数上限，超出后关闭最久未用的语句
+#define STMT_CACHE_CAPACITY 32
+
+// 连接池中全部连接共享的计数
+typedef struct {
+  atomic_ullong hits;
+  atomic_ullong misses;
+  atomic_ullong evictions;
+  atomic_ullong invalidations; // 连接重建后作废的语句
+  atomic_ullong prepares;      // 成功的 mysql_stmt_prepare() 次数
+  atomic_ullong prepare_us;    // 成功的 mysql_stmt_prepare() 累计耗时
+} stmt_cache_counters_t;
+
+// 计数快照
+typedef struct {
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;
+  unsigned long long invalidations;
+  unsigned long long prepares;
+  unsigned long long prepare_us;
+  unsigned long long saved_us; // 命中省下的准备耗时：命中次数 × 平均准备耗时（估计值）
+  double hit_ratio;            // 命中次数 / 查找次数，没有查找过时为 0
+} stmt_cache_stats_t;
+
+typedef struct {
+  MYSQL_STMT *stmt;
+  char *sql; // 值都以参数发送，语句文本就是语句的形状，也是缓存的键
+  size_t len;
+  uint64_t hash;
+  uint64_t last_used;
+} stmt_cache_entry_t;
+
+// 一个连接上准备好的语句，只由持有连接的线程访问，不加锁
+typedef struct {
+  stmt_cache_entry_t entries[STMT_CACHE_CAPACITY];
+  size_t count;
+  uint64_t tick;                   // 每次查找递增，最久未用的语句 last_used 最小
+  unsigned long thread_id;         // 语句所属的 MySQL 会话，会话变了语句就都失效了
+  stmt_cache_counters_t *counters; // 连接池中全部连接共享
+} stmt_cache_t;
+
+void stmt_cache_counters_init(stmt_cache_counters_t *counters);
+void stmt_cache_counters_stats(stmt_cache_counters_t *counters, stmt_cache_stats_t *stats);
+void stmt_cache_init(stmt_cache_t *cache, stmt_cache_counters_t *counters);
+MYSQL_STMT *stmt_cache_prepare(stmt_cache_t *cache, MYSQL *mysql, const char *sql,
+                               unsigned int *error_no, char *error_msg, size_t size);
+void stmt_cache_clear(stmt_cache_t *cache);
@@ -0,0 +1,146 @@
+// clang-format off
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "strbuf.h"
+// clang-format on
+
+#define STRBUF_MIN_CAP 64
+
+/**
+ * @brief 初始化缓冲区（不分配内存）
+ *
+ * @param buf 缓冲区
+ */
+void strbuf_init(strbuf_t *buf) {
+  buf->data = NULL;
+  buf->len = 0;
+  buf->cap = 0;
+}
+
+/**
+ * @brief 保证缓冲区至少还能写入 extra 字节（不含结尾的 '\0'）
+ *
+ * @param buf 缓冲区
+ * @param extra 需要的额外空间
+ * @return int 成功（0）；失败（-1）
+ */
+int strbuf_reserve(strbuf_t *buf, size_t extra) {
+  size_t need = buf->len + extra + 1;
+  if (need <= buf->cap) {
+    return 0;
+  }
+
+  size_t new_cap = buf->cap ? buf->cap : STRBUF_MIN_CAP;
+  while (new_cap < need) {
+    new_cap *= 2;
+  }
+
+  char *ptr = realloc(buf->data, new_cap);
+  if (!ptr) {
+    return -1;
+  }
+  buf->data = ptr;
+  buf->cap = new_cap;
+  return 0;
+}
+
+/**
+ * @brief 追加数据
+ *
+ * @param buf 缓冲区
+ * @param data 数据
+ * @param len 数据长度
+ * @return int 成功（0）；失败（-1）
+ */
+int strbuf_append(strbuf_t *buf, const void *data, size_t len) {
+  if (strbuf_reserve(buf, len) != 0) {
+    return -1;
+  }
+  if (len > 0) {
+    memcpy(buf->data + buf->len, data, len);
+  }
+  buf->len += len;
+  buf->data[buf->len] = '\0';
+  return 0;
+}
+
+/**
+ * @brief 追加字符串
+ *
+ * @param buf 缓冲区
+ * @param str 字符串
+ * @return int 成功（0）；失败（-1）
+ */
+int strbuf_append_str(strbuf_t *buf, const char *str) {
+  return strbuf_append(buf, str, strlen(str));
+}
+
+/**
+ * @brief 追加单个字符
+ *
+ * @param buf 缓冲区
+ * @param ch 字符
+ * @return int 成功（0）；失败（-1）
+ */
+int strbuf_append_char(strbuf_t *buf, char ch) { return strbuf_append(buf, &ch, 1); }
+
+/**
+ * @brief 格式化追加
+ *
+ * @param buf 缓冲区
+ * @param fmt 格式字符串
+ * @return int 成功（0）；失败（-1）
+ */
+int strbuf_appendf(strbuf_t *buf, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(NULL, 0, fmt, args);
+  va_end(args);
+  if (len < 0 || strbuf_reserve(buf, (size_t)len) != 0) {
+    return -1;
+  }
+
+  va_start(args, fmt);
+  vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, args);
+  va_end(args);
+  buf->len += (size_t)len;
+  return 0;
+}
+
+/**
+ * @brief 清空内容，保留已分配的内存
+ *
+ * @param buf 缓冲区
+ */
+void strbuf_reset(strbuf_t *buf) {
+  buf->len = 0;
+  if (buf->data) {
+    buf->data[0] = '\0';
+  }
+}
+
+/**
+ * @brief 取走缓冲区内存，调用方负责 free
+ *
+ * @param buf 缓冲区
+ * @return char* 以 '\0' 结尾的数据
+ */
+char *strbuf_detach(strbuf_t *buf) {
+  char *data = buf->data;
+  if (!data) {
+    data = calloc(1, 1);
+  }
+  strbuf_init(buf);
+  return data;
+}
+
+/**
+ * @brief 释放缓冲区
+ *
+ * @param buf 缓冲区
+ */
+void strbuf_free(strbuf_t *buf) {
+  free(buf->data);
+  strbuf_init(buf);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// clang-format off
+#include <stdarg.h>
+#include <stddef.h>
+// clang-format on
+
+// 可增长的字节缓冲区，data 始终以 '\0' 结尾
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} strbuf_t;
+
+void strbuf_init(strbuf_t *buf);
+int strbuf_reserve(strbuf_t *buf, size_t extra);
+int strbuf_append(strbuf_t *buf, const void *data, size_t len);
+int strbuf_append_str(strbuf_t *buf, const char *str);
+int strbuf_append_char(strbuf_t *buf, char ch);
+int strbuf_appendf(strbuf_t *buf, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void strbuf_reset(strbuf_t *buf);
+char *strbuf_detach(strbuf_t *buf);
+void strbuf_free(strbuf_t *buf);
@@ -0,0 +1,256 @@
+// clang-format off
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "table_schema.h"
+#include "src/clock.h"
+#include "src/logger.h"
+// clang-format on
+
+// MySQL 标识符最长 64 个字符
+#define NAME_MAX_LEN 64
+
+// 按表中的顺序列出各列，以及它在主键中的位置（不属于主键时为 NULL）
+#define SCHEMA_QUERY                                                                              \
+  "SELECT c.COLUMN_NAME, k.ORDINAL_POSITION FROM information_schema.COLUMNS c "                   \
+  "LEFT JOIN information_schema.KEY_COLUMN_USAGE k ON k.TABLE_SCHEMA = c.TABLE_SCHEMA "           \
+  "AND k.TABLE_NAME = c.TABLE_NAME AND k.COLUMN_NAME = c.COLUMN_NAME "                            \
+  "AND k.CONSTRAINT_NAME = 'PRIMARY' "                                                            \
+  "WHERE c.TABLE_SCHEMA = %s AND c.TABLE_NAME = '%s' ORDER BY c.ORDINAL_POSITION"
+
+static void schema_free(table_schema_t *schema) {
+  for (size_t i = 0; i < schema->num_columns; ++i) {
+    free(schema->columns[i]);
+  }
+  free(schema->columns);
+  free(schema->table);
+  free(schema);
+}
+
+/**
+ * @brief 初始化
+ *
+ * @param schemas 表结构缓存
+ * @return int 成功（0）；失败（-1）
+ */
+int table_schemas_init(table_schemas_t *schemas) {
+  schemas->head = NULL;
+  schemas->num_entries = 0;
+  if (pthread_mutex_init(&schemas->mutex, NULL) != 0) {
+    LOG_ERROR("Failed to initialize table schema mutex");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief 销毁，仍被引用的表结构在最后一次释放时回收
+ *
+ * @param schemas 表结构缓存
+ */
+void table_schemas_destroy(table_schemas_t *schemas) {
+  table_schema_t *schema = schemas->head;
+  while (schema) {
+    table_schema_t *next = schema->next;
+    table_schema_release(schema);
+    schema = next;
+  }
+  schemas->head = NULL;
+  schemas->num_entries = 0;
+  pthread_mutex_destroy(&schemas->mutex);
+}
+
+/**
+ * @brief 查找未过期的表结构
+ *
+ * @param schemas 表结构缓存
+ * @param table 表名
+ * @return table_schema_t* 表结构，用完后调用 table_schema_release()；没有或已过期返回 NULL
+ */
+table_schema_t *table_schema_lookup(table_schemas_t *schemas, const char *table) {
+  uint64_t now_us = clock_now_us();
+  pthread_mutex_lock(&schemas->mutex);
+  table_schema_t **link = &schemas->head;
+  while (*link && strcmp((*link)->table, table) != 0) {
+    link = &(*link)->next;
+  }
+  table_schema_t *schema = *link;
+  if (schema && now_us - schema->loaded_us >= (uint64_t)TABLE_SCHEMA_TTL_MS * 1000) {
+    *link = schema->next;
+    --schemas->num_entries;
+    pthread_mutex_unlock(&schemas->mutex);
+    table_schema_release(schema);
+    return NULL;
+  }
+  if (schema) {
+    atomic_fetch_add_explicit(&schema->refs, 1, memory_order_relaxed);
+  }
+  pthread_mutex_unlock(&schemas->mutex);
+  return schema;
+}
+
+/**
+ * @brief 存入刚查到的表结构，替换同名的旧条目；调用者仍持有自己的引用
+ *
+ * @param schemas 表结构缓存
+ * @param schema 表结构
+ */
+void table_schema_store(table_schemas_t *schemas, table_schema_t *schema) {
+  table_schema_t *old = NULL;
+  pthread_mutex_lock(&schemas->mutex);
+  table_schema_t **link = &schemas->head;
+  while (*link && strcmp((*link)->table, schema->table) != 0) {
+    link = &(*link)->next;
+  }
+  if (*link) {
+    old = *link;
+    *link = old->next;
+    --schemas->num_entries;
+  }
+  if (schemas->num_entries < TABLE_SCHEMA_MAX_ENTRIES) {
+    atomic_fetch_add_explicit(&schema->refs, 1, memory_order_relaxed);
+    schema->next = schemas->head;
+    schemas->head = schema;
+    ++schemas->num_entries;
+  }
+  pthread_mutex_unlock(&schemas->mutex);
+  if (old) {
+    table_schema_release(old);
+  }
+}
+
+/**
+ * @brief 释放一个引用
+ *
+ * @param schema 表结构，可以为 NULL
+ */
+void table_schema_release(table_schema_t *schema) {
+  if (schema && atomic_fetch_sub_explicit(&schema->refs, 1, memory_order_acq_rel) == 1) {
+    schema_free(schema);
+  }
+}
+
+/**
+ * @brief 复制标识符，去掉反引号和空白
+ *
+ * @param dst 输出，至少 NAME_MAX_LEN + 1 字节
+ * @param src 标识符
+ * @param len 长度
+ * @return int 成功（0）；为空或过长（-1）
+ */
+static int copy_name(char *dst, const char *src, size_t len) {
+  size_t n = 0;
+  for (size_t i = 0; i < len; ++i) {
+    if (src[i] == '`' || isspace((unsigned char)src[i])) {
+      continue;
+    }
+    if (n == NAME_MAX_LEN) {
+      return -1;
+    }
+    dst[n++] = src[i];
+  }
+  dst[n] = '\0';
+  return n > 0 ? 0 : -1;
+}
+
+/**
+ * @brief 从 information_schema 查询表的列和主键
+ *
+ * @param mysql 连接
+ * @param table 请求中的表名，可以带库名前缀和反引号
+ * @return table_schema_t* 表结构（引用计数为 1）；表不存在或查询失败返回 NULL
+ */
+table_schema_t *table_schema_load(MYSQL *mysql, const char *table) {
+  char db[NAME_MAX_LEN + 1], name[NAME_MAX_LEN + 1];
+  const char *dot = strrchr(table, '.');
+  if ((dot && copy_name(db, table, (size_t)(dot - table)) != 0) ||
+      copy_name(name, dot ? dot + 1 : table, strlen(dot ? dot + 1 : table)) != 0) {
+    LOG_WARN("Invalid table name: %s", table);
+    return NULL;
+  }
+
+  char db_literal[2 * NAME_MAX_LEN + 3] = "DATABASE()";
+  char name_escaped[2 * NAME_MAX_LEN + 1];
+  if (dot) {
+    db_literal[0] = '\'';
+    unsigned long len = mysql_real_escape_string(mysql, db_literal + 1, db, strlen(db));
+    db_literal[len + 1] = '\'';
+    db_literal[len + 2] = '\0';
+  }
+  mysql_real_escape_string(mysql, name_escaped, name, strlen(name));
+  char query[sizeof(SCHEMA_QUERY) + sizeof(db_literal) + sizeof(name_escaped)];
+  snprintf(query, sizeof(query), SCHEMA_QUERY, db_literal, name_escaped);
+
+  if (mysql_query(mysql, query) != 0) {
+    LOG_ERROR("Failed to query schema of %s: %s", table, mysql_error(mysql));
+    return NULL;
+  }
+  MYSQL_RES *res = mysql_store_result(mysql);
+  if (!res) {
+    LOG_ERROR("Failed to store schema of %s: %s", table, mysql_error(mysql));
+    return NULL;
+  }
+
+  size_t num_rows = (size_t)mysql_num_rows(res);
+  table_schema_t *schema = calloc(1, sizeof(table_schema_t));
+  if (!schema || num_rows == 0 || !(schema->columns = calloc(num_rows, sizeof(char *))) ||
+      !(schema->table = strdup(table))) {
+    if (schema && num_rows == 0) {
+      LOG_WARN("Table %s not found in information_schema", table);
+    }
+    mysql_free_result(res);
+    if (schema) {
+      schema_free(schema);
+    }
+    return NULL;
+  }
+
+  MYSQL_ROW row;
+  while ((row = mysql_fetch_row(res)) != NULL) {
+    if (!(schema->columns[schema->num_columns] = strdup(row[0] ? row[0] : ""))) {
+      LOG_ERROR("Failed to allocate memory for schema of %s", table);
+      mysql_free_result(res);
+      schema_free(schema);
+      return NULL;
+    }
+    long position = row[1] ? strtol(row[1], NULL, 10) : 0;
+    if (position > 0 && position <= PAGE_TOKEN_MAX_VALUES) {
+      schema->keys[position - 1] = schema->num_columns;
+      if ((size_t)position > schema->num_keys) {
+        schema->num_keys = (size_t)position;
+      }
+    }
+    ++schema->num_columns;
+  }
+  mysql_free_result(res);
+
+  atomic_init(&schema->refs, 1);
+  schema->loaded_us = clock_now_us();
+  LOG_DEBUG("Loaded schema of %s: %zu columns, %zu key columns", table, schema->num_columns,
+            schema->num_keys);
+  return schema;
+}
+
+/**
+ * @brief 按名称查找列，与 MySQL 一样不区分大小写，名称可以带反引号
+ *
+ * @param schema 表结构
+ * @param name 列名，不必以 '\0' 结尾
+ * @param len 长度
+ * @return int 列在 columns 中的下标；没有这一列返回 -1
+ */
+int table_schema_column(const table_schema_t *schema, const char *name, size_t len) {
+  if (len >= 2 && name[0] == '`' && name[len - 1] == '`') {
+    ++name;
+    len -= 2;
+  }
+  for (size_t i = 0; i < schema->num_columns; ++i) {
+    const char *column = schema->columns[i];
+    if (strncasecmp(column, name, len) == 0 && column[len] == '\0') {
+      return (int)i;
+    }
+  }
+  return -1;
+}
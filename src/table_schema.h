@@ -0,0 +1,42 @@
+#pragma once
+
+// clang-format off
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <mysql/mysql.h>
+#include "src/page_token.h"
+// clang-format on
+
+// 表结构在进程内缓存的时间（毫秒），ALTER TABLE 最迟这么久之后生效
+#define TABLE_SCHEMA_TTL_MS 60000
+// 缓存的表数上限，超出后新查到的表结构用完即弃
+#define TABLE_SCHEMA_MAX_ENTRIES 256
+
+// 一张表的列和主键，发布之后不再修改，由引用计数回收
+typedef struct table_schema {
+  struct table_schema *next; // 缓存链表
+  atomic_int refs;
+  uint64_t loaded_us;
+  char *table; // 请求中的表名，缓存的键
+  size_t num_columns;
+  char **columns; // 按表中的顺序
+  size_t num_keys;
+  size_t keys[PAGE_TOKEN_MAX_VALUES]; // 主键各列在 columns 中的下标，按主键中的顺序
+} table_schema_t;
+
+// 表结构缓存，READ 分页时据此找到主键，选择列和排序时据此校验列名
+typedef struct {
+  pthread_mutex_t mutex;
+  table_schema_t *head;
+  size_t num_entries;
+} table_schemas_t;
+
+int table_schemas_init(table_schemas_t *schemas);
+void table_schemas_destroy(table_schemas_t *schemas);
+table_schema_t *table_schema_lookup(table_schemas_t *schemas, const char *table);
+void table_schema_store(table_schemas_t *schemas, table_schema_t *schema);
+void table_schema_release(table_schema_t *schema);
+table_schema_t *table_schema_load(MYSQL *mysql, const char *table);
+int table_schema_column(const table_schema_t *schema, const char *name, size_t len);
@@ -0,0 +1,392 @@
+#define _GNU_SOURCE // strcasestr
+
+// clang-format off
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "table_version.h"
+#include "src/clock.h"
+#include "src/logger.h"
+// clang-format on
+
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+// 条件中出现这些片段时结果可能随表外的数据或时间变化，不生成 ETag
+static const char *const volatile_fragments[] = {
+    "select",   "rand(",    "now(", "sysdate(",        "curdate(",
+    "curtime(", "current_", "uuid", "unix_timestamp(",
+};
+
+// 查询本库各表最近一次修改的时间；UPDATE_TIME 只精确到秒，最近两秒内修改过的表每次都视为有写入
+#define POLL_QUERY                                                                                \
+  "SELECT TABLE_NAME, UPDATE_TIME, UPDATE_TIME >= NOW() - INTERVAL 2 SECOND "                     \
+  "FROM information_schema.TABLES WHERE TABLE_SCHEMA = DATABASE() AND UPDATE_TIME IS NOT NULL"
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+  const unsigned char *bytes = data;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * @brief 把请求中的表名规整为版本号的键：去掉反引号和库名前缀，转为小写
+ *
+ * 不同写法的同一张表必须对应同一个版本号；不同的表偶尔落到同一个键上只会多失效几次。
+ * READ 结果缓存也用它规整表名
+ *
+ * @param table 表名
+ * @param key 输出键
+ * @return int 成功（0）；表名为空或过长（-1）
+ */
+int table_version_key(const char *table, char key[TABLE_VERSION_NAME_LEN + 1]) {
+  const char *dot = strrchr(table, '.');
+  const char *ptr = dot ? dot + 1 : table;
+  size_t len = 0;
+  for (; *ptr; ++ptr) {
+    if (*ptr == '`' || isspace((unsigned char)*ptr)) {
+      continue;
+    }
+    if (len == TABLE_VERSION_NAME_LEN) {
+      return -1;
+    }
+    key[len++] = (char)tolower((unsigned char)*ptr);
+  }
+  key[len] = '\0';
+  return len > 0 ? 0 : -1;
+}
+
+/**
+ * @brief 查找表的槽位
+ *
+ * @param versions 版本表
+ * @param key 规整后的表名
+ * @param create 不存在时是否登记
+ * @return table_version_slot_t* 槽位；不存在且不登记、或槽位已用完时返回 NULL
+ */
+static table_version_slot_t *find_slot(table_versions_t *versions, const char *key, bool create) {
+  uint64_t hash = fnv1a(FNV_OFFSET, key, strlen(key));
+  size_t start = hash % TABLE_VERSION_SLOTS;
+
+  // 槽位只会被登记、不会被移除，读者按发布顺序看到完整的名字
+  for (size_t i = 0; i < TABLE_VERSION_SLOTS; ++i) {
+    table_version_slot_t *slot = &versions->slots[(start + i) % TABLE_VERSION_SLOTS];
+    if (!atomic_load_explicit(&slot->used, memory_order_acquire)) {
+      break;
+    }
+    if (strcmp(slot->name, key) == 0) {
+      return slot;
+    }
+  }
+  if (!create) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&versions->mutex);
+  table_version_slot_t *found = NULL;
+  for (size_t i = 0; i < TABLE_VERSION_SLOTS && !found; ++i) {
+    table_version_slot_t *slot = &versions->slots[(start + i) % TABLE_VERSION_SLOTS];
+    if (!atomic_load_explicit(&slot->used, memory_order_relaxed)) {
+      snprintf(slot->name, sizeof(slot->name), "%s", key);
+      atomic_store_explicit(&slot->version, 0, memory_order_relaxed);
+      atomic_store_explicit(&slot->used, true, memory_order_release);
+      atomic_fetch_add_explicit(&versions->num_used, 1, memory_order_release);
+      found = slot;
+    } else if (strcmp(slot->name, key) == 0) {
+      found = slot;
+    }
+  }
+  pthread_mutex_unlock(&versions->mutex);
+  if (!found) {
+    LOG_WARN("Table version slots exhausted, %s shares the overflow version", key);
+  }
+  return found;
+}
+
+/**
+ * @brief 初始化版本表
+ *
+ * @param versions 版本表
+ * @return int 成功（0）；失败（-1）
+ */
+int table_versions_init(table_versions_t *versions) {
+  memset(versions, 0, sizeof(table_versions_t));
+  if (pthread_mutex_init(&versions->mutex, NULL) != 0) {
+    LOG_ERROR("Failed to initialize table version mutex");
+    return -1;
+  }
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  versions->epoch = (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+  return 0;
+}
+
+/**
+ * @brief 停止轮询线程并销毁版本表，需在销毁连接池之前调用
+ *
+ * @param versions 版本表
+ */
+void table_versions_destroy(table_versions_t *versions) {
+  if (versions->started) {
+    pthread_mutex_lock(&versions->mutex);
+    versions->stop = true;
+    pthread_cond_signal(&versions->cond);
+    pthread_mutex_unlock(&versions->mutex);
+    pthread_join(versions->thread, NULL);
+    pthread_cond_destroy(&versions->cond);
+    versions->started = false;
+  }
+  pthread_mutex_destroy(&versions->mutex);
+}
+
+/**
+ * @brief 获取表的当前版本号；必须在查询之前读取，查询结果才不会比版本号旧
+ *
+ * @param versions 版本表
+ * @param table 表名
+ * @return uint64_t 版本号
+ */
+uint64_t table_version_get(table_versions_t *versions, const char *table) {
+  char key[TABLE_VERSION_NAME_LEN + 1];
+  if (table_version_key(table, key) != 0) {
+    return atomic_load_explicit(&versions->overflow, memory_order_acquire);
+  }
+  table_version_slot_t *slot = find_slot(versions, key, false);
+  if (slot) {
+    return atomic_load_explicit(&slot->version, memory_order_acquire);
+  }
+  // 没有登记过的表从未写入，版本号为 0；槽位用完后登记不了的表都用溢出版本号
+  bool full = atomic_load_explicit(&versions->num_used, memory_order_acquire) ==
+              TABLE_VERSION_SLOTS;
+  return full ? atomic_load_explicit(&versions->overflow, memory_order_acquire) : 0;
+}
+
+/**
+ * @brief 表有写入，递增版本号；必须在写入对其他会话可见（提交）之后调用
+ *
+ * @param versions 版本表
+ * @param table 表名
+ */
+void table_version_bump(table_versions_t *versions, const char *table) {
+  char key[TABLE_VERSION_NAME_LEN + 1];
+  table_version_slot_t *slot =
+      table_version_key(table, key) == 0 ? find_slot(versions, key, true) : NULL;
+  atomic_fetch_add_explicit(slot ? &slot->version : &versions->overflow, 1, memory_order_acq_rel);
+}
+
+/**
+ * @brief 判断一个 READ 的结果是否只取决于这张表的内容
+ *
+ * 表名只能是单个（可带库名和反引号的）标识符；条件中不能有子查询、随机数或当前时间
+ *
+ * @param table 表名
+ * @param where 条件，可以为 NULL
+ * @return bool 可以生成 ETag 返回 true
+ */
+bool table_version_cacheable(const char *table, const char *where) {
+  if (!table || !*table) {
+    return false;
+  }
+  for (const char *ptr = table; *ptr; ++ptr) {
+    if (!isalnum((unsigned char)*ptr) && !strchr("_$.`", *ptr)) {
+      return false;
+    }
+  }
+  for (size_t i = 0; where && i < sizeof(volatile_fragments) / sizeof(volatile_fragments[0]); ++i) {
+    if (strcasestr(where, volatile_fragments[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief 生成 READ 的弱 ETag：进程纪元、表的版本号和查询（表、条件、结果集格式）的摘要
+ *
+ * @param versions 版本表
+ * @param table 表名
+ * @param where 条件，可以为 NULL
+ * @param format 结果集编码格式
+ * @param etag 输出
+ * @param size 输出缓冲区大小，至少 TABLE_VERSION_ETAG_LEN
+ * @return int 成功（0）；查询不可缓存（-1）
+ */
+int table_version_etag(table_versions_t *versions, const char *table, const char *where,
+                       result_format_t format, char *etag, size_t size) {
+  if (!table_version_cacheable(table, where)) {
+    return -1;
+  }
+
+  uint64_t version = table_version_get(versions, table);
+  uint64_t hash = fnv1a(FNV_OFFSET, table, strlen(table) + 1);
+  // 没有条件和空条件是不同的查询
+  hash = where ? fnv1a(hash, where, strlen(where) + 1) : fnv1a(hash, "\xff", 1);
+  unsigned char fmt = (unsigned char)format;
+  hash = fnv1a(hash, &fmt, 1);
+  int n = snprintf(etag, size, "W/\"%llx-%llx-%016llx\"", (unsigned long long)versions->epoch,
+                   (unsigned long long)version, (unsigned long long)hash);
+  return n > 0 && (size_t)n < size ? 0 : -1;
+}
+
+/**
+ * @brief If-None-Match 是否包含 ETag（弱比较，忽略 W/ 前缀）
+ *
+ * @param if_none_match If-None-Match 请求头，逗号分隔的 ETag 列表或 *，可以为 NULL
+ * @param etag 当前的 ETag
+ * @return bool 命中返回 true
+ */
+bool table_version_etag_match(const char *if_none_match, const char *etag) {
+  if (!if_none_match || !etag) {
+    return false;
+  }
+  if (strncmp(etag, "W/", 2) == 0) {
+    etag += 2;
+  }
+  size_t etag_len = strlen(etag);
+
+  const char *ptr = if_none_match;
+  while (*ptr) {
+    while (*ptr == ' ' || *ptr == '\t' || *ptr == ',') {
+      ++ptr;
+    }
+    const char *end = strchr(ptr, ',');
+    if (!end) {
+      end = ptr + strlen(ptr);
+    }
+    const char *last = end;
+    while (last > ptr && (last[-1] == ' ' || last[-1] == '\t')) {
+      --last;
+    }
+    if (last - ptr == 1 && *ptr == '*') {
+      return true;
+    }
+    if (last - ptr > 2 && strncmp(ptr, "W/", 2) == 0) {
+      ptr += 2;
+    }
+    if ((size_t)(last - ptr) == etag_len && memcmp(ptr, etag, etag_len) == 0) {
+      return true;
+    }
+    ptr = end;
+  }
+  return false;
+}
+
+/**
+ * @brief 轮询一次 information_schema，递增 UPDATE_TIME 变化过的表的版本号
+ *
+ * @param versions 版本表
+ * @param mysql 轮询使用的连接
+ * @return int 成功（0）；查询失败（-1）
+ */
+static int poll_once(table_versions_t *versions, MYSQL *mysql) {
+  if (mysql_query(mysql, POLL_QUERY) != 0) {
+    LOG_ERROR("Failed to poll table update times: %s", mysql_error(mysql));
+    return -1;
+  }
+  MYSQL_RES *res = mysql_store_result(mysql);
+  if (!res) {
+    LOG_ERROR("Failed to store table update times: %s", mysql_error(mysql));
+    return -1;
+  }
+
+  MYSQL_ROW row;
+  while ((row = mysql_fetch_row(res)) != NULL) {
+    if (!row[0] || !row[1]) {
+      continue;
+    }
+    char key[TABLE_VERSION_NAME_LEN + 1];
+    bool recent = row[2] && strcmp(row[2], "1") == 0;
+    table_version_slot_t *slot =
+        table_version_key(row[0], key) == 0 ? find_slot(versions, key, true) : NULL;
+    if (!slot) {
+      if (recent) {
+        atomic_fetch_add_explicit(&versions->overflow, 1, memory_order_acq_rel);
+      }
+      continue;
+    }
+    // seen_update_time 只由轮询线程读写
+    if (recent || strcmp(slot->seen_update_time, row[1]) != 0) {
+      snprintf(slot->seen_update_time, sizeof(slot->seen_update_time), "%s", row[1]);
+      atomic_fetch_add_explicit(&slot->version, 1, memory_order_acq_rel);
+    }
+  }
+  mysql_free_result(res);
+  return 0;
+}
+
+/**
+ * @brief 轮询线程：每隔 poll_ms 检查一次表的修改时间，连接断开后下一轮重连
+ *
+ * @param arg 版本表
+ * @return void* NULL
+ */
+static void *poll_loop(void *arg) {
+  table_versions_t *versions = (table_versions_t *)arg;
+  MYSQL *mysql = NULL;
+
+  pthread_mutex_lock(&versions->mutex);
+  while (!versions->stop) {
+    pthread_mutex_unlock(&versions->mutex);
+    if (!mysql && (mysql = connection_pool_connect(versions->pool, "table version poller"))) {
+      // MySQL 8 默认缓存表统计信息一天，UPDATE_TIME 需要实时值；旧版本没有这个变量，忽略错误
+      mysql_query(mysql, "SET SESSION information_schema_stats_expiry = 0");
+    }
+    if (mysql && poll_once(versions, mysql) != 0) {
+      mysql_close(mysql);
+      mysql = NULL;
+    }
+    pthread_mutex_lock(&versions->mutex);
+
+    uint64_t wake_us = clock_now_us() + (uint64_t)versions->poll_ms * 1000;
+    struct timespec abstime = {.tv_sec = (time_t)(wake_us / 1000000),
+                               .tv_nsec = (long)(wake_us % 1000000) * 1000};
+    while (!versions->stop &&
+           pthread_cond_timedwait(&versions->cond, &versions->mutex, &abstime) == 0) {
+    }
+  }
+  pthread_mutex_unlock(&versions->mutex);
+
+  if (mysql) {
+    mysql_close(mysql);
+  }
+  mysql_thread_end();
+  return NULL;
+}
+
+/**
+ * @brief 启动轮询线程，发现绕过本进程的写入（其他客户端、触发器、外键级联）
+ *
+ * @param versions 版本表
+ * @param pool 连接池，轮询使用相同账号的一条独立连接
+ * @param poll_ms 轮询间隔（毫秒），大于 0
+ * @return int 成功（0）；失败（-1）
+ */
+int table_versions_watch(table_versions_t *versions, connection_pool_t *pool, int poll_ms) {
+  if (versions->started || poll_ms <= 0) {
+    return -1;
+  }
+
+  versions->pool = pool;
+  versions->poll_ms = poll_ms;
+  versions->stop = false;
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  int ret = pthread_cond_init(&versions->cond, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+  if (ret != 0) {
+    LOG_ERROR("Failed to initialize table version condition variable");
+    return -1;
+  }
+  if (pthread_create(&versions->thread, NULL, poll_loop, versions) != 0) {
+    LOG_ERROR("Failed to start table version poller");
+    pthread_cond_destroy(&versions->cond);
+    return -1;
+  }
+  versions->started = true;
+  LOG_INFO("Polling information_schema for table writes every %d ms", poll_ms);
+  return 0;
+}
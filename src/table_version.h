@@ -0,0 +1,55 @@
+#pragma once
+
+// clang-format off
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "src/connection_pool.h"
+#include "src/result_encoder.h"
+// clang-format on
+
+// 记录版本号的表的上限，超出的表共用一个版本号（任何一张写入都让它们的 ETag 失效）
+#define TABLE_VERSION_SLOTS 256
+// MySQL 标识符最长 64 个字符
+#define TABLE_VERSION_NAME_LEN 64
+// W/"<纪元>-<版本号>-<查询摘要>"
+#define TABLE_VERSION_ETAG_LEN 64
+// information_schema.TABLES.UPDATE_TIME 的文本形式
+#define TABLE_VERSION_STAMP_LEN 32
+
+// 一张表的版本号：名字一经发布不再改变，读取时无需加锁
+typedef struct {
+  atomic_bool used;
+  char name[TABLE_VERSION_NAME_LEN + 1];
+  atomic_ullong version;
+  char seen_update_time[TABLE_VERSION_STAMP_LEN]; // 轮询线程上次看到的 UPDATE_TIME
+} table_version_slot_t;
+
+// 每张表一个单调递增的写入版本号，READ 的 ETag 由它和查询共同决定，表没有写入时 ETag 不变
+typedef struct {
+  table_version_slot_t slots[TABLE_VERSION_SLOTS];
+  pthread_mutex_t mutex;  // 登记新表
+  atomic_int num_used;    // 已登记的表数
+  atomic_ullong overflow; // 槽位用完之后的表共用
+  uint64_t epoch;         // 进程启动时间，版本号从 0 重新计数后旧的 ETag 不会误命中
+  // 轮询 information_schema，发现绕过本进程的写入
+  connection_pool_t *pool;
+  int poll_ms;
+  pthread_t thread;
+  pthread_cond_t cond;
+  bool started;
+  bool stop;
+} table_versions_t;
+
+int table_versions_init(table_versions_t *versions);
+void table_versions_destroy(table_versions_t *versions);
+int table_version_key(const char *table, char key[TABLE_VERSION_NAME_LEN + 1]);
+uint64_t table_version_get(table_versions_t *versions, const char *table);
+void table_version_bump(table_versions_t *versions, const char *table);
+bool table_version_cacheable(const char *table, const char *where);
+int table_version_etag(table_versions_t *versions, const char *table, const char *where,
+                       result_format_t format, char *etag, size_t size);
+bool table_version_etag_match(const char *if_none_match, const char *etag);
+int table_versions_watch(table_versions_t *versions, connection_pool_t *pool, int poll_ms);
@@ -0,0 +1,158 @@
+// clang-format off
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+#include "src/clock.h"
+// clang-format on
+
+// Server-Timing 中的阶段名，也用于慢请求日志
+static const char *const PHASE_NAMES[TRACE_NUM_PHASES] = {
+    [TRACE_PHASE_PARSE] = "parse",         [TRACE_PHASE_QUEUE] = "queue",
+    [TRACE_PHASE_CONN_WAIT] = "conn_wait", [TRACE_PHASE_QUERY] = "query",
+    [TRACE_PHASE_RESULT] = "result",       [TRACE_PHASE_SERIALIZE] = "serialize",
+    [TRACE_PHASE_SEND] = "send",
+};
+
+static atomic_ullong trace_seq = 0;
+
+/**
+ * @brief 获取阶段名
+ *
+ * @param phase 阶段
+ * @return const char* 阶段名
+ */
+const char *trace_phase_name(trace_phase_t phase) {
+  return phase >= 0 && phase < TRACE_NUM_PHASES ? PHASE_NAMES[phase] : "unknown";
+}
+
+/**
+ * @brief 检查客户端传入的追踪 ID：1 ~ TRACE_ID_MAX_LEN 个字母、数字、'-'、'_' 或 '.'
+ *
+ * 限制字符集是为了能把 ID 原样写进日志和响应头
+ *
+ * @param id 追踪 ID
+ * @return bool 合法返回 true
+ */
+bool trace_id_valid(const char *id) {
+  if (!id || *id == '\0') {
+    return false;
+  }
+
+  size_t len = 0;
+  for (const char *p = id; *p; ++p, ++len) {
+    char c = *p;
+    if (len >= TRACE_ID_MAX_LEN ||
+        !((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+          c == '-' || c == '_' || c == '.')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief 初始化追踪上下文，沿用合法的客户端追踪 ID，否则生成 16 位十六进制 ID
+ *
+ * @param trace 追踪上下文
+ * @param id 客户端传入的追踪 ID，可以为 NULL
+ */
+void trace_init(trace_t *trace, const char *id) {
+  memset(trace->phase_us, 0, sizeof(trace->phase_us));
+  if (trace_id_valid(id)) {
+    snprintf(trace->id, sizeof(trace->id), "%s", id);
+    return;
+  }
+
+  // 序号保证进程内不重复，splitmix64 把序号和时间打散成看起来随机的 ID
+  uint64_t x = clock_now_us() +
+               atomic_fetch_add_explicit(&trace_seq, 1, memory_order_relaxed) *
+                   0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  snprintf(trace->id, sizeof(trace->id), "%016llx", (unsigned long long)x);
+}
+
+/**
+ * @brief 生成 Server-Timing 头，例如 "parse;dur=0.052, queue;dur=0.000, ..."
+ *
+ * 响应头在发送之前生成，所以不包括发送阶段
+ *
+ * @param trace 追踪上下文
+ * @param buf 输出缓冲区
+ * @param size 缓冲区大小
+ * @return int 成功（0）；缓冲区不足（-1）
+ */
+int trace_format_server_timing(const trace_t *trace, char *buf, size_t size) {
+  size_t len = 0;
+  for (int phase = 0; phase < TRACE_PHASE_SEND; ++phase) {
+    int n = snprintf(buf + len, size - len, "%s%s;dur=%.3f", phase > 0 ? ", " : "",
+                     PHASE_NAMES[phase], (double)trace->phase_us[phase] / 1000);
+    if (n < 0 || (size_t)n >= size - len) {
+      return -1;
+    }
+    len += (size_t)n;
+  }
+  return 0;
+}
+
+/**
+ * @brief 解析 Server-Timing 头，忽略不认识的指标和 dur 以外的参数
+ *
+ * @param header Server-Timing 头
+ * @param trace 输出各阶段耗时，追踪 ID 不变
+ * @return int 解析出的阶段数；失败返回 -1
+ */
+int trace_parse_server_timing(const char *header, trace_t *trace) {
+  if (!header || !trace) {
+    return -1;
+  }
+
+  memset(trace->phase_us, 0, sizeof(trace->phase_us));
+  int count = 0;
+  const char *p = header;
+  while (*p) {
+    while (*p == ' ' || *p == ',') {
+      ++p;
+    }
+    const char *name = p;
+    while (*p && *p != ';' && *p != ',') {
+      ++p;
+    }
+    size_t name_len = (size_t)(p - name);
+    while (name_len > 0 && name[name_len - 1] == ' ') {
+      --name_len;
+    }
+
+    int phase = TRACE_NUM_PHASES;
+    for (int i = 0; i < TRACE_NUM_PHASES; ++i) {
+      if (strlen(PHASE_NAMES[i]) == name_len && memcmp(PHASE_NAMES[i], name, name_len) == 0) {
+        phase = i;
+        break;
+      }
+    }
+
+    // 参数形如 ;dur=1.5;desc="..."，直到下一个逗号结束
+    while (*p == ';') {
+      ++p;
+      while (*p == ' ') {
+        ++p;
+      }
+      if (strncmp(p, "dur=", 4) == 0 && phase < TRACE_NUM_PHASES) {
+        char *end = NULL;
+        double ms = strtod(p + 4, &end);
+        if (end != p + 4 && ms >= 0) {
+          trace->phase_us[phase] = (uint64_t)(ms * 1000 + 0.5);
+          ++count;
+        }
+        p = end;
+      }
+      while (*p && *p != ';' && *p != ',') {
+        ++p;
+      }
+    }
+  }
+  return count;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+// clang-format on
+
+// 请求和响应都使用这个头携带追踪 ID
+#define TRACE_ID_HEADER "X-Trace-Id"
+#define TRACE_SERVER_TIMING_HEADER "Server-Timing"
+// 客户端传入的追踪 ID 的最大长度，超过或含有非法字符时由服务端重新生成
+#define TRACE_ID_MAX_LEN 64
+// Server-Timing 头的最大长度
+#define TRACE_SERVER_TIMING_MAX_LEN 256
+
+// 请求处理的各个阶段，按发生的先后排列
+typedef enum {
+  TRACE_PHASE_PARSE = 0, // 接收并解析请求体
+  TRACE_PHASE_QUEUE,     // 在数据库任务队列中等待
+  TRACE_PHASE_CONN_WAIT, // get_connection() 等待空闲连接
+  TRACE_PHASE_QUERY,     // mysql_query()
+  TRACE_PHASE_RESULT,    // mysql_store_result() / mysql_use_result()
+  TRACE_PHASE_SERIALIZE, // 编码响应
+  TRACE_PHASE_SEND,      // 发送响应（流式读取时包括逐行拉取和编码）
+  TRACE_NUM_PHASES,
+} trace_phase_t;
+
+typedef struct {
+  char id[TRACE_ID_MAX_LEN + 1];
+  uint64_t phase_us[TRACE_NUM_PHASES];
+} trace_t;
+
+const char *trace_phase_name(trace_phase_t phase);
+bool trace_id_valid(const char *id);
+void trace_init(trace_t *trace, const char *id);
+int trace_format_server_timing(const trace_t *trace, char *buf, size_t size);
+int trace_parse_server_timing(const char *header, trace_t *trace);
@@ -0,0 +1,320 @@
+// clang-format off
+#include <string.h>
+#include "wire.h"
+#include "src/logger.h"
+// clang-format on
+
+// 解码游标
+typedef struct {
+  const unsigned char *ptr;
+  const unsigned char *end;
+} wire_reader_t;
+
+static uint32_t load_u32(const unsigned char *bytes) {
+  return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 |
+         (uint32_t)bytes[3] << 24;
+}
+
+static void store_u32(unsigned char *bytes, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    bytes[i] = (value >> (i * 8)) & 0xFF;
+  }
+}
+
+static int put_u8(strbuf_t *out, uint8_t value) { return strbuf_append_char(out, (char)value); }
+
+static int put_u16(strbuf_t *out, uint16_t value) {
+  unsigned char bytes[2] = {value & 0xFF, value >> 8};
+  return strbuf_append(out, bytes, sizeof(bytes));
+}
+
+static int put_u32(strbuf_t *out, uint32_t value) {
+  unsigned char bytes[4];
+  store_u32(bytes, value);
+  return strbuf_append(out, bytes, sizeof(bytes));
+}
+
+static int put_string(strbuf_t *out, const char *str) {
+  if (!str) {
+    return put_u32(out, WIRE_NULL_LEN);
+  }
+  size_t len = strlen(str);
+  return put_u32(out, (uint32_t)len) || strbuf_append(out, str, len);
+}
+
+static bool read_u8(wire_reader_t *reader, uint8_t *value) {
+  if (reader->ptr >= reader->end) {
+    return false;
+  }
+  *value = *reader->ptr++;
+  return true;
+}
+
+static bool read_u32(wire_reader_t *reader, uint32_t *value) {
+  if (reader->end - reader->ptr < 4) {
+    return false;
+  }
+  *value = load_u32(reader->ptr);
+  reader->ptr += 4;
+  return true;
+}
+
+/**
+ * @brief 读取字符串字段，复制到内存区域
+ *
+ * @param reader 解码游标
+ * @param arena 内存区域
+ * @param str 输出字符串，未提供时为 NULL
+ * @return bool 成功返回 true；数据不完整或内存不足返回 false
+ */
+static bool read_string(wire_reader_t *reader, arena_t *arena, char **str) {
+  uint32_t len;
+  if (!read_u32(reader, &len)) {
+    return false;
+  }
+  if (len == WIRE_NULL_LEN) {
+    *str = NULL;
+    return true;
+  }
+  if ((size_t)(reader->end - reader->ptr) < len) {
+    return false;
+  }
+  char *ptr = arena_alloc(arena, (size_t)len + 1);
+  if (!ptr) {
+    return false;
+  }
+  memcpy(ptr, reader->ptr, len);
+  ptr[len] = '\0';
+  reader->ptr += len;
+  *str = ptr;
+  return true;
+}
+
+/**
+ * @brief 从缓冲区头部解析一个帧
+ *
+ * @param buf 已接收的数据
+ * @param len 数据长度
+ * @param frame 输出帧
+ * @return int 完整的帧（1）；数据不足一帧（0）；负载超过上限（-1）
+ */
+int wire_frame_parse(const char *buf, size_t len, wire_frame_t *frame) {
+  if (len < WIRE_HEADER_LEN) {
+    return 0;
+  }
+
+  const unsigned char *bytes = (const unsigned char *)buf;
+  uint32_t payload_len = load_u32(bytes);
+  if (payload_len > WIRE_MAX_PAYLOAD) {
+    LOG_WARN("Binary protocol frame of %u bytes exceeds the limit", payload_len);
+    return -1;
+  }
+  if (len - WIRE_HEADER_LEN < payload_len) {
+    return 0;
+  }
+
+  frame->id = load_u32(bytes + 4);
+  frame->type = bytes[8];
+  frame->payload = buf + WIRE_HEADER_LEN;
+  frame->payload_len = payload_len;
+  frame->frame_len = WIRE_HEADER_LEN + (size_t)payload_len;
+  return 1;
+}
+
+/**
+ * @brief 开始一个帧：写入帧头，负载长度由 wire_frame_end() 回填
+ *
+ * @param out 输出缓冲区
+ * @param id 请求 ID
+ * @param type 帧类型
+ * @param start 输出帧在缓冲区中的起始位置
+ * @return int 成功（0）；失败（-1）
+ */
+int wire_frame_begin(strbuf_t *out, uint32_t id, wire_frame_type_t type, size_t *start) {
+  *start = out->len;
+  return put_u32(out, 0) || put_u32(out, id) || put_u8(out, (uint8_t)type);
+}
+
+/**
+ * @brief 结束一个帧，回填负载长度
+ *
+ * @param out 输出缓冲区
+ * @param start wire_frame_begin() 输出的起始位置
+ */
+void wire_frame_end(strbuf_t *out, size_t start) {
+  store_u32((unsigned char *)out->data + start, (uint32_t)(out->len - start - WIRE_HEADER_LEN));
+}
+
+/**
+ * @brief 开始一个请求帧，写入帧头和请求头
+ *
+ * @param out 输出缓冲区
+ * @param id 请求 ID
+ * @param op 操作
+ * @param format READ 结果集的编码格式
+ * @param flags 请求标志
+ * @param deadline_ms 客户端愿意等待的毫秒数
+ * @param start 输出帧在缓冲区中的起始位置
+ * @return int 成功（0）；失败（-1）
+ */
+static int request_begin(strbuf_t *out, uint32_t id, db_op_t op, result_format_t format,
+                         uint8_t flags, uint32_t deadline_ms, size_t *start) {
+  return wire_frame_begin(out, id, WIRE_FRAME_REQUEST, start) || put_u8(out, (uint8_t)op) ||
+         put_u8(out, (uint8_t)format) || put_u8(out, flags) || put_u32(out, deadline_ms);
+}
+
+/**
+ * @brief 编码单个操作的请求帧
+ *
+ * @param out 输出缓冲区
+ * @param id 请求 ID
+ * @param op 操作
+ * @param format READ 结果集的编码格式
+ * @param deadline_ms 客户端愿意等待的毫秒数，0 表示不限时
+ * @param table 表
+ * @param data 数据，可以为 NULL
+ * @param where 条件，可以为 NULL
+ * @return int 成功（0）；失败（-1）
+ */
+int wire_request_encode(strbuf_t *out, uint32_t id, db_op_t op, result_format_t format,
+                        uint32_t deadline_ms, const char *table, const char *data,
+                        const char *where) {
+  size_t start;
+  if (request_begin(out, id, op, format, 0, deadline_ms, &start) || put_string(out, table) ||
+      put_string(out, data) || put_string(out, where)) {
+    return -1;
+  }
+  wire_frame_end(out, start);
+  return 0;
+}
+
+/**
+ * @brief 开始一个批量请求帧，之后依次调用 wire_batch_item_encode()，最后调用 wire_frame_end()
+ *
+ * @param out 输出缓冲区
+ * @param id 请求 ID
+ * @param num_items 条目数
+ * @param transaction 是否在同一个事务中执行
+ * @param deadline_ms 客户端愿意等待的毫秒数，0 表示不限时
+ * @param start 输出帧在缓冲区中的起始位置
+ * @return int 成功（0）；失败（-1）
+ */
+int wire_batch_begin(strbuf_t *out, uint32_t id, uint32_t num_items, bool transaction,
+                     uint32_t deadline_ms, size_t *start) {
+  return request_begin(out, id, DB_OP_BATCH, RESULT_FORMAT_TEXT,
+                       transaction ? WIRE_FLAG_TRANSACTION : 0, deadline_ms, start) ||
+         put_u32(out, num_items);
+}
+
+/**
+ * @brief 编码批量请求中的一个条目
+ *
+ * @param out 输出缓冲区
+ * @param op 操作
+ * @param table 表
+ * @param data 数据，可以为 NULL
+ * @param where 条件，可以为 NULL
+ * @return int 成功（0）；失败（-1）
+ */
+int wire_batch_item_encode(strbuf_t *out, db_op_t op, const char *table, const char *data,
+                           const char *where) {
+  return put_u8(out, (uint8_t)op) || put_string(out, table) || put_string(out, data) ||
+         put_string(out, where);
+}
+
+/**
+ * @brief 解码请求帧
+ *
+ * 未知的操作解码为 DB_OP_UNKNOWN，与 HTTP 一样由执行时返回错误
+ *
+ * @param frame 请求帧
+ * @param arena 请求内存区域，字符串和批量条目分配在其中
+ * @param req 输出请求
+ * @return int 成功（0）；格式错误或内存不足（-1）
+ */
+int wire_request_decode(const wire_frame_t *frame, arena_t *arena, wire_request_t *req) {
+  wire_reader_t reader = {(const unsigned char *)frame->payload,
+                          (const unsigned char *)frame->payload + frame->payload_len};
+  uint8_t op, format, flags;
+  memset(req, 0, sizeof(wire_request_t));
+  batch_init(&req->batch, arena);
+  if (frame->type != WIRE_FRAME_REQUEST || !read_u8(&reader, &op) ||
+      !read_u8(&reader, &format) || !read_u8(&reader, &flags) ||
+      !read_u32(&reader, &req->deadline_ms) || format > RESULT_FORMAT_NDJSON) {
+    return -1;
+  }
+  req->op = op <= DB_OP_BATCH ? (db_op_t)op : DB_OP_UNKNOWN;
+  req->format = (result_format_t)format;
+
+  if (req->op != DB_OP_BATCH) {
+    if (!read_string(&reader, arena, &req->table) || !read_string(&reader, arena, &req->data) ||
+        !read_string(&reader, arena, &req->where)) {
+      return -1;
+    }
+    return reader.ptr == reader.end ? 0 : -1;
+  }
+
+  uint32_t num_items;
+  if (!read_u32(&reader, &num_items)) {
+    return -1;
+  }
+  req->batch.transaction = (flags & WIRE_FLAG_TRANSACTION) != 0;
+  if (num_items > BATCH_MAX_ITEMS) {
+    // 与 HTTP 一样由执行时返回错误，剩余的条目不再解码
+    req->batch_overflow = true;
+    return 0;
+  }
+  for (uint32_t i = 0; i < num_items; ++i) {
+    uint8_t item_op;
+    batch_item_t *item = batch_add_item(&req->batch);
+    if (!item || !read_u8(&reader, &item_op) || !read_string(&reader, arena, &item->table) ||
+        !read_string(&reader, arena, &item->data) || !read_string(&reader, arena, &item->where)) {
+      return -1;
+    }
+    item->operation =
+        arena_strdup(arena, db_op_name(item_op <= DB_OP_BATCH ? (db_op_t)item_op : DB_OP_UNKNOWN));
+    if (!item->operation) {
+      return -1;
+    }
+  }
+  return reader.ptr == reader.end ? 0 : -1;
+}
+
+/**
+ * @brief 开始一个响应帧，之后追加响应体，最后调用 wire_frame_end()
+ *
+ * @param out 输出缓冲区
+ * @param id 请求 ID
+ * @param status 状态码
+ * @param format 响应体的编码格式
+ * @param start 输出帧在缓冲区中的起始位置
+ * @return int 成功（0）；失败（-1）
+ */
+int wire_response_begin(strbuf_t *out, uint32_t id, unsigned int status, result_format_t format,
+                        size_t *start) {
+  return wire_frame_begin(out, id, WIRE_FRAME_RESPONSE, start) ||
+         put_u16(out, (uint16_t)status) || put_u8(out, (uint8_t)format);
+}
+
+/**
+ * @brief 解码响应帧
+ *
+ * @param frame 响应帧
+ * @param resp 输出响应，响应体指向帧内部
+ * @return int 成功（0）；格式错误（-1）
+ */
+int wire_response_decode(const wire_frame_t *frame, wire_response_t *resp) {
+  if (frame->type != WIRE_FRAME_RESPONSE || frame->payload_len < WIRE_RESPONSE_HEADER_LEN) {
+    return -1;
+  }
+
+  const unsigned char *bytes = (const unsigned char *)frame->payload;
+  resp->status = (unsigned int)(bytes[0] | (bytes[1] << 8));
+  if (bytes[2] > RESULT_FORMAT_NDJSON) {
+    return -1;
+  }
+  resp->format = (result_format_t)bytes[2];
+  resp->body = frame->payload + WIRE_RESPONSE_HEADER_LEN;
+  resp->body_len = frame->payload_len - WIRE_RESPONSE_HEADER_LEN;
+  return 0;
+}
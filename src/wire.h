@@ -0,0 +1,82 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "src/arena.h"
+#include "src/batch.h"
+#include "src/operation.h"
+#include "src/result_encoder.h"
+#include "src/strbuf.h"
+// clang-format on
+
+// 二进制协议：一条 TCP 连接上可以有多个请求同时在途，服务端按完成的先后返回响应，
+// 客户端用请求 ID 把响应对应回请求。所有整数均为小端序：
+//   帧：负载长度 u32 | 请求 ID u32 | 帧类型 u8 | 负载
+//   字符串：长度 u32 | 内容，长度为 WIRE_NULL_LEN 表示未提供该字段
+//   请求：操作 u8（db_op_t）| 结果集格式 u8（result_format_t）| 标志 u8 | 截止毫秒数 u32 |
+//         单个操作 { table | data | where }
+//         批量操作 { 条目数 u32 | 每个条目 { 操作 u8 | table | data | where } }
+//   响应：状态码 u16（含义同 HTTP）| 结果集格式 u8 | 响应体（与 HTTP 响应体相同）
+#define WIRE_HEADER_LEN 9
+#define WIRE_RESPONSE_HEADER_LEN 3
+// 负载长度上限，与 JSON 请求体的上限相同；超过时视为协议错误并断开连接
+#define WIRE_MAX_PAYLOAD (64 * 1024 * 1024)
+#define WIRE_NULL_LEN UINT32_MAX
+// 请求标志：批量操作在同一个事务中执行
+#define WIRE_FLAG_TRANSACTION 0x01
+
+#define WIRE_STATUS_OK 200
+#define WIRE_STATUS_BAD_REQUEST 400
+#define WIRE_STATUS_TOO_MANY_REQUESTS 429
+#define WIRE_STATUS_SERVICE_UNAVAILABLE 503
+#define WIRE_STATUS_GATEWAY_TIMEOUT 504
+
+typedef enum {
+  WIRE_FRAME_REQUEST = 1,
+  WIRE_FRAME_RESPONSE = 2,
+} wire_frame_type_t;
+
+// 缓冲区中一个完整的帧，payload 指向缓冲区内部
+typedef struct {
+  uint32_t id;
+  uint8_t type;
+  const char *payload;
+  size_t payload_len;
+  size_t frame_len; // 包括帧头
+} wire_frame_t;
+
+// 解码后的请求，字符串字段都复制到请求内存区域并以 '\0' 结尾
+typedef struct {
+  db_op_t op;
+  result_format_t format;
+  uint32_t deadline_ms; // 0 表示不限时
+  char *table;
+  char *data;
+  char *where;
+  batch_t batch;       // op 为 DB_OP_BATCH 时的条目
+  bool batch_overflow; // 条目数超过 BATCH_MAX_ITEMS
+} wire_request_t;
+
+typedef struct {
+  unsigned int status;
+  result_format_t format;
+  const char *body; // 指向帧内部，不以 '\0' 结尾
+  size_t body_len;
+} wire_response_t;
+
+int wire_frame_parse(const char *buf, size_t len, wire_frame_t *frame);
+int wire_frame_begin(strbuf_t *out, uint32_t id, wire_frame_type_t type, size_t *start);
+void wire_frame_end(strbuf_t *out, size_t start);
+int wire_request_encode(strbuf_t *out, uint32_t id, db_op_t op, result_format_t format,
+                        uint32_t deadline_ms, const char *table, const char *data,
+                        const char *where);
+int wire_batch_begin(strbuf_t *out, uint32_t id, uint32_t num_items, bool transaction,
+                     uint32_t deadline_ms, size_t *start);
+int wire_batch_item_encode(strbuf_t *out, db_op_t op, const char *table, const char *data,
+                           const char *where);
+int wire_request_decode(const wire_frame_t *frame, arena_t *arena, wire_request_t *req);
+int wire_response_begin(strbuf_t *out, uint32_t id, unsigned int status, result_format_t format,
+                        size_t *start);
+int wire_response_decode(const wire_frame_t *frame, wire_response_t *resp);
@@ -0,0 +1,450 @@
+// clang-format off
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "wire_client.h"
+#include "src/key.h"
+#include "src/logger.h"
+#include "src/operation.h"
+#include "src/wire.h"
+// clang-format on
+
+// 每次从套接字读取的字节数
+#define WIRE_CLIENT_READ_SIZE (64 * 1024)
+
+/**
+ * @brief 连接服务端
+ *
+ * @param address 地址，形如 HOST:PORT
+ * @return int 套接字；失败（-1）
+ */
+static int wire_connect(const char *address) {
+  const char *colon = strrchr(address, ':');
+  if (!colon || colon == address || colon[1] == '\0') {
+    LOG_ERROR("Invalid binary protocol address: %s", address);
+    return -1;
+  }
+  char *host = strndup(address, (size_t)(colon - address));
+  if (!host) {
+    return -1;
+  }
+
+  struct addrinfo hints, *res = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int rc = getaddrinfo(host, colon + 1, &hints, &res);
+  free(host);
+  if (rc != 0) {
+    LOG_ERROR("Failed to resolve %s: %s", address, gai_strerror(rc));
+    return -1;
+  }
+
+  int fd = -1;
+  for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+    if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(res);
+  if (fd < 0) {
+    LOG_ERROR("Failed to connect to %s: %s", address, strerror(errno));
+    return -1;
+  }
+
+  // 流水线中的请求帧很小，不能等 Nagle 凑满一个报文
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return fd;
+}
+
+/**
+ * @brief 初始化二进制协议客户端并建立连接
+ *
+ * @param address 服务端地址，形如 HOST:PORT
+ * @return wire_client_t* 对象，失败返回 NULL
+ */
+wire_client_t *wire_client_init(const char *address) {
+  wire_client_t *client = malloc(sizeof(wire_client_t));
+  if (!client) {
+    LOG_ERROR("Failed to allocate memory for binary protocol client");
+    return NULL;
+  }
+
+  client->fd = wire_connect(address);
+  if (client->fd < 0) {
+    free(client);
+    return NULL;
+  }
+  client->next_id = 1;
+  strbuf_init(&client->out);
+  strbuf_init(&client->in);
+  client->in_off = 0;
+  client->format = RESULT_FORMAT_TEXT;
+  wire_client_set_timeout(client, HTTP_CLIENT_DEFAULT_TIMEOUT_MS);
+
+  LOG_DEBUG("Binary protocol client connected to %s", address);
+  return client;
+}
+
+/**
+ * @brief 关闭连接并销毁客户端
+ *
+ * @param client 对象
+ */
+void wire_client_cleanup(wire_client_t *client) {
+  if (client) {
+    close(client->fd);
+    strbuf_free(&client->out);
+    strbuf_free(&client->in);
+    free(client);
+  }
+}
+
+/**
+ * @brief 设置 READ 操作请求的结果集编码格式
+ *
+ * @param client 客户端
+ * @param format 编码格式
+ */
+void wire_client_set_format(wire_client_t *client, result_format_t format) {
+  if (client) {
+    client->format = format;
+  }
+}
+
+/**
+ * @brief 设置收发超时；每个请求带上截止时间，服务端超时后不再等待连接、终止语句
+ *
+ * @param client 客户端
+ * @param timeout_ms 超时毫秒数，0 表示不限时
+ */
+void wire_client_set_timeout(wire_client_t *client, long timeout_ms) {
+  if (!client || timeout_ms < 0) {
+    return;
+  }
+
+  client->timeout_ms = timeout_ms;
+  struct timeval tv = {.tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000};
+  setsockopt(client->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(client->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+/**
+ * @brief 告知服务端的截止毫秒数
+ *
+ * @param client 客户端
+ * @return uint32_t 毫秒数，0 表示不限时
+ */
+static uint32_t deadline_ms(const wire_client_t *client) {
+  long timeout_ms = client->timeout_ms;
+  if (timeout_ms > 2 * HTTP_CLIENT_DEADLINE_MARGIN_MS) {
+    timeout_ms -= HTTP_CLIENT_DEADLINE_MARGIN_MS;
+  }
+  return timeout_ms > (long)UINT32_MAX ? UINT32_MAX : (uint32_t)timeout_ms;
+}
+
+/**
+ * @brief 把一个请求写入发送缓冲区，不立即发送；wire_client_flush() 或 wire_client_receive()
+ *        时一次写出，多个请求合并成一次系统调用
+ *
+ * @param client 客户端
+ * @param operation 操作类型
+ * @param table 表
+ * @param data 数据，可以为 NULL
+ * @param where 条件，可以为 NULL
+ * @param id 输出请求 ID，用于对应响应
+ * @return int 成功（0）；失败（-1）
+ */
+int wire_client_send(wire_client_t *client, const char *operation, const char *table,
+                     const char *data, const char *where, uint32_t *id) {
+  if (!client || !operation) {
+    return -1;
+  }
+
+  size_t old_len = client->out.len;
+  uint32_t request_id = client->next_id++;
+  if (wire_request_encode(&client->out, request_id, db_op_from_str(operation), client->format,
+                          deadline_ms(client), table, data, where) != 0) {
+    LOG_ERROR("Failed to allocate memory for binary protocol request");
+    client->out.len = old_len;
+    return -1;
+  }
+  if (id) {
+    *id = request_id;
+  }
+  return 0;
+}
+
+/**
+ * @brief 发送缓冲区中的全部请求
+ *
+ * @param client 客户端
+ * @return int 成功（0）；失败（-1）
+ */
+int wire_client_flush(wire_client_t *client) {
+  if (!client) {
+    return -1;
+  }
+
+  size_t off = 0;
+  while (off < client->out.len) {
+    ssize_t n = send(client->fd, client->out.data + off, client->out.len - off, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      LOG_ERROR("Failed to send binary protocol request: %s", strerror(errno));
+      strbuf_reset(&client->out);
+      return -1;
+    }
+    off += (size_t)n;
+  }
+  strbuf_reset(&client->out);
+  return 0;
+}
+
+/**
+ * @brief 取回下一个完成的响应（不一定是最早发送的请求），必要时先发送缓冲区中的请求
+ *
+ * @param client 客户端
+ * @param reply 输出响应，使用完毕后调用 wire_reply_free() 释放
+ * @return int 成功（0）；连接断开、超时或协议错误（-1）
+ */
+int wire_client_receive(wire_client_t *client, wire_reply_t *reply) {
+  if (!client || !reply || wire_client_flush(client) != 0) {
+    return -1;
+  }
+
+  for (;;) {
+    wire_frame_t frame;
+    int rc = wire_frame_parse(client->in.data + client->in_off, client->in.len - client->in_off,
+                              &frame);
+    if (rc < 0) {
+      return -1;
+    }
+    if (rc > 0) {
+      wire_response_t resp;
+      if (wire_response_decode(&frame, &resp) != 0) {
+        LOG_ERROR("Malformed binary protocol response");
+        return -1;
+      }
+      reply->body = malloc(resp.body_len + 1);
+      if (!reply->body) {
+        LOG_ERROR("Failed to allocate memory for binary protocol response");
+        return -1;
+      }
+      memcpy(reply->body, resp.body, resp.body_len);
+      reply->body[resp.body_len] = '\0';
+      reply->body_len = resp.body_len;
+      reply->id = frame.id;
+      reply->status = resp.status;
+      reply->format = resp.format;
+
+      client->in_off += frame.frame_len;
+      if (client->in_off == client->in.len) {
+        strbuf_reset(&client->in);
+        client->in_off = 0;
+      }
+      return 0;
+    }
+
+    // 不完整的帧移到缓冲区开头，再接收更多数据
+    if (client->in_off > 0) {
+      memmove(client->in.data, client->in.data + client->in_off, client->in.len - client->in_off);
+      client->in.len -= client->in_off;
+      client->in_off = 0;
+    }
+    if (strbuf_reserve(&client->in, WIRE_CLIENT_READ_SIZE) != 0) {
+      LOG_ERROR("Failed to allocate memory for binary protocol response");
+      return -1;
+    }
+    ssize_t n = recv(client->fd, client->in.data + client->in.len, WIRE_CLIENT_READ_SIZE, 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      LOG_ERROR("Failed to receive binary protocol response: %s",
+                n == 0 ? "connection closed"
+                       : (errno == EAGAIN || errno == EWOULDBLOCK ? "timed out" : strerror(errno)));
+      return -1;
+    }
+    client->in.len += (size_t)n;
+    client->in.data[client->in.len] = '\0';
+  }
+}
+
+/**
+ * @brief 释放响应
+ *
+ * @param reply 响应
+ */
+void wire_reply_free(wire_reply_t *reply) {
+  if (reply) {
+    free(reply->body);
+    reply->body = NULL;
+  }
+}
+
+/**
+ * @brief 等待指定请求的响应，期间收到的其他响应被丢弃；不要与流水线用法混用
+ *
+ * @param client 客户端
+ * @param id 请求 ID
+ * @param reply 输出响应
+ * @return int 成功（0）；失败（-1）
+ */
+static int wait_reply(wire_client_t *client, uint32_t id, wire_reply_t *reply) {
+  for (;;) {
+    if (wire_client_receive(client, reply) != 0) {
+      return -1;
+    }
+    if (reply->id == id) {
+      return 0;
+    }
+    LOG_WARN("Discarding binary protocol response to request %u", reply->id);
+    wire_reply_free(reply);
+  }
+}
+
+/**
+ * @brief 发送单个操作并等待响应
+ *
+ * @param client 客户端
+ * @param operation 操作类型
+ * @param table 表
+ * @param data 数据
+ * @param where 条件
+ * @param output 输出
+ * @return int 出错返回 -1，成功返回值大于等于 0
+ */
+static int send_wire_request(wire_client_t *client, const char *operation, const char *table,
+                             const char *data, const char *where, char **output) {
+  uint32_t id;
+  wire_reply_t reply;
+  if (wire_client_send(client, operation, table, data, where, &id) != 0 ||
+      wait_reply(client, id, &reply) != 0) {
+    return -1;
+  }
+
+  // 响应体与 HTTP 相同，沿用 http_client 的解析
+  int result = reply.format == RESULT_FORMAT_ROWSET
+                   ? http_client_parse_rowset(reply.body, reply.body_len, output, NULL)
+                   : http_client_parse_response(operation, reply.body, output);
+  wire_reply_free(&reply);
+  return result;
+}
+
+/**
+ * @brief 通过二进制协议发起数据库 create
+ *
+ * @param client 客户端
+ * @param table 表
+ * @param data 数据
+ * @param output 返回值
+ * @return int 出错（-1）；成功（大于等于 0，含义为已生效的条目数）
+ */
+int wire_client_create(wire_client_t *client, const char *table, const char *data, char **output) {
+  return send_wire_request(client, KEY_OP_CREATE, table, data, NULL, output);
+}
+
+/**
+ * @brief 通过二进制协议发起数据库 read
+ *
+ * @param client 客户端
+ * @param table 表
+ * @param where 条件
+ * @param output 返回值
+ * @return int 出错（-1）；成功（1）
+ */
+int wire_client_read(wire_client_t *client, const char *table, const char *where, char **output) {
+  return send_wire_request(client, KEY_OP_READ, table, NULL, where, output);
+}
+
+/**
+ * @brief 通过二进制协议发起数据库 update
+ *
+ * @param client 客户端
+ * @param table 表
+ * @param data 数据
+ * @param where 条件
+ * @param output 返回值
+ * @return int 出错（-1）；成功（大于等于 0，含义为已生效的条目数）
+ */
+int wire_client_update(wire_client_t *client, const char *table, const char *data,
+                       const char *where, char **output) {
+  return send_wire_request(client, KEY_OP_UPDATE, table, data, where, output);
+}
+
+/**
+ * @brief 通过二进制协议发起数据库 delete
+ *
+ * @param client 客户端
+ * @param table 表
+ * @param where 条件
+ * @param output 返回值
+ * @return int 出错（-1）；成功（大于等于 0，含义为已生效的条目数）
+ */
+int wire_client_delete(wire_client_t *client, const char *table, const char *where, char **output) {
+  return send_wire_request(client, KEY_OP_DELETE, table, NULL, where, output);
+}
+
+/**
+ * @brief 通过二进制协议在一个请求中按顺序发起多个数据库操作，含义与 http_client_batch() 相同
+ *
+ * @param client 客户端
+ * @param items 操作列表
+ * @param num_items 操作数量
+ * @param transaction 是否在同一个事务中执行（任一失败则全部回滚）
+ * @param results 输出各操作的结果，使用完毕后调用 http_batch_results_free() 释放
+ * @param output 批量执行的汇总信息
+ * @return int 出错（-1，事务模式下表示已回滚）；成功（已执行的操作数）
+ */
+int wire_client_batch(wire_client_t *client, const http_batch_item_t *items, size_t num_items,
+                      bool transaction, http_batch_result_t *results, char **output) {
+  if (!client || !items || !results || num_items == 0) {
+    return -1;
+  }
+
+  for (size_t i = 0; i < num_items; ++i) {
+    if (!items[i].operation) {
+      LOG_ERROR("Batch item %zu has no operation", i + 1);
+      return -1;
+    }
+    results[i].result = -1;
+    results[i].output = NULL;
+  }
+
+  size_t start;
+  uint32_t id = client->next_id++;
+  int rc = wire_batch_begin(&client->out, id, (uint32_t)num_items, transaction,
+                            deadline_ms(client), &start);
+  for (size_t i = 0; rc == 0 && i < num_items; ++i) {
+    rc = wire_batch_item_encode(&client->out, db_op_from_str(items[i].operation), items[i].table,
+                                items[i].data, items[i].where);
+  }
+  if (rc != 0) {
+    LOG_ERROR("Failed to allocate memory for binary protocol request");
+    client->out.len = start;
+    return -1;
+  }
+  wire_frame_end(&client->out, start);
+
+  wire_reply_t reply;
+  if (wait_reply(client, id, &reply) != 0) {
+    return -1;
+  }
+  int result = http_client_parse_batch(reply.body, reply.body_len, items, num_items, results,
+                                       output);
+  wire_reply_free(&reply);
+  return result;
+}
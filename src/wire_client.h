@@ -0,0 +1,48 @@
+#pragma once
+
+// clang-format off
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "src/http_client.h"
+#include "src/result_encoder.h"
+#include "src/strbuf.h"
+// clang-format on
+
+// 二进制协议客户端，协议见 wire.h。单个操作的接口与 http_client 相同；
+// 流水线用法：多次 wire_client_send() 写入请求，再用 wire_client_receive() 按完成顺序取回响应
+typedef struct {
+  int fd;
+  uint32_t next_id;
+  strbuf_t out; // 尚未发送的请求帧
+  strbuf_t in;  // 已接收、尚未取走的数据
+  size_t in_off;
+  result_format_t format; // READ 操作请求的结果集编码格式
+  long timeout_ms;        // 收发超时，同时作为截止时间告知服务端，0 表示不限时
+} wire_client_t;
+
+// 一个响应，body 以 '\0' 结尾，使用完毕后调用 wire_reply_free() 释放
+typedef struct {
+  uint32_t id;
+  unsigned int status; // 含义同 HTTP 状态码
+  result_format_t format;
+  char *body;
+  size_t body_len;
+} wire_reply_t;
+
+wire_client_t *wire_client_init(const char *address);
+void wire_client_cleanup(wire_client_t *client);
+void wire_client_set_format(wire_client_t *client, result_format_t format);
+void wire_client_set_timeout(wire_client_t *client, long timeout_ms);
+int wire_client_send(wire_client_t *client, const char *operation, const char *table,
+                     const char *data, const char *where, uint32_t *id);
+int wire_client_flush(wire_client_t *client);
+int wire_client_receive(wire_client_t *client, wire_reply_t *reply);
+void wire_reply_free(wire_reply_t *reply);
+int wire_client_create(wire_client_t *client, const char *table, const char *data, char **output);
+int wire_client_read(wire_client_t *client, const char *table, const char *where, char **output);
+int wire_client_update(wire_client_t *client, const char *table, const char *data,
+                       const char *where, char **output);
+int wire_client_delete(wire_client_t *client, const char *table, const char *where, char **output);
+int wire_client_batch(wire_client_t *client, const http_batch_item_t *items, size_t num_items,
+                      bool transaction, http_batch_result_t *results, char **output);
@@ -0,0 +1,652 @@
+#define _GNU_SOURCE // accept4
+
+// clang-format off
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include "wire_server.h"
+#include "src/arena.h"
+#include "src/clock.h"
+#include "src/db_request.h"
+#include "src/key.h"
+#include "src/logger.h"
+#include "src/wire.h"
+// clang-format on
+
+// 事件循环单次等待的最长时间，决定了停止服务的响应延迟
+#define WIRE_POLL_INTERVAL_MS 100
+#define WIRE_MAX_EVENTS 64
+// 每次从套接字读取的字节数
+#define WIRE_READ_SIZE (64 * 1024)
+// 每次唤醒在一个连接上最多读取的字节数，读满后先处理其他连接，剩余的数据留在套接字中
+#define WIRE_READ_BUDGET (4 * WIRE_READ_SIZE)
+// 积压的响应超过这个长度时暂停接收请求
+#define WIRE_OUT_MAX (1024 * 1024)
+// 请求内存区域的块大小
+#define WIRE_ARENA_SIZE 4096
+
+struct wire_conn {
+  int fd;
+  wire_server_t *server;
+  strbuf_t in; // 已接收、尚未解析的数据，只由事件循环线程访问
+  pthread_mutex_t mutex;
+  strbuf_t out; // 待发送的响应，以下字段都受 mutex 保护
+  size_t out_off;
+  bool want_write; // 套接字已写满，改为只等待 EPOLLOUT，剩余数据由事件循环发送，期间不接收请求
+  bool closed;
+  atomic_int refs;     // 事件循环和每个在途请求各持有一个引用，最后一个引用释放时关闭套接字
+  atomic_int inflight; // 在途请求数
+  char client[CLIENT_QUOTA_ID_LEN + 1]; // 按对端地址生成的客户端标识，未启用配额时为空
+  wire_conn_t *prev;
+  wire_conn_t *next;
+};
+
+// 一个在途请求，自身和解码后的字段都分配在请求内存区域中
+typedef struct {
+  wire_conn_t *conn;
+  arena_t *arena;
+  uint32_t id;
+  wire_request_t req;
+  uint64_t start_us;    // 收到请求的时间
+  uint64_t queued_us;   // 交给工作线程的时间
+  uint64_t deadline_us; // 0 表示不限时
+  client_quota_slot_t *client; // 已通过客户端配额，结束时需要归还并发名额
+} wire_task_t;
+
+/**
+ * @brief 释放连接的一个引用
+ *
+ * @param conn 连接
+ */
+static void conn_release(wire_conn_t *conn) {
+  if (atomic_fetch_sub_explicit(&conn->refs, 1, memory_order_acq_rel) != 1) {
+    return;
+  }
+  close(conn->fd);
+  strbuf_free(&conn->in);
+  strbuf_free(&conn->out);
+  pthread_mutex_destroy(&conn->mutex);
+  free(conn);
+}
+
+/**
+ * @brief 尽可能发送待发送的响应，套接字写满时改为只等待 EPOLLOUT，由事件循环继续发送，
+ *        发送完毕后恢复 EPOLLIN；调用者持有连接的互斥锁
+ *
+ * @param conn 连接
+ */
+static void conn_flush_locked(wire_conn_t *conn) {
+  wire_server_t *server = conn->server;
+  while (conn->out_off < conn->out.len) {
+    ssize_t n = send(conn->fd, conn->out.data + conn->out_off, conn->out.len - conn->out_off,
+                     MSG_NOSIGNAL);
+    if (n > 0) {
+      conn->out_off += (size_t)n;
+      metrics_add(&metrics_shard(server->metrics)->bytes_out, (unsigned long long)n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (!conn->want_write) {
+        // 客户端不读取响应时不再读取它的请求，后续请求留在内核缓冲区中，由 TCP 流量控制让它放慢
+        struct epoll_event event = {.events = EPOLLOUT, .data.ptr = conn};
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+        conn->want_write = true;
+      }
+      return;
+    }
+    // 对端已断开，丢弃剩余的响应，由事件循环在读到错误时关闭连接
+    LOG_DEBUG("Failed to send binary protocol response: %s", strerror(errno));
+    break;
+  }
+
+  strbuf_reset(&conn->out);
+  conn->out_off = 0;
+  if (conn->want_write) {
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = conn};
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+    conn->want_write = false;
+  }
+}
+
+/**
+ * @brief 追加一个响应帧并尝试立即发送，可以在任意线程调用
+ *
+ * @param conn 连接
+ * @param id 请求 ID
+ * @param status 状态码
+ * @param format 响应体的编码格式
+ * @param body 响应体
+ * @param len 响应体长度
+ */
+static void conn_respond(wire_conn_t *conn, uint32_t id, unsigned int status,
+                         result_format_t format, const char *body, size_t len) {
+  pthread_mutex_lock(&conn->mutex);
+  if (!conn->closed) {
+    size_t old_len = conn->out.len;
+    size_t start;
+    if (wire_response_begin(&conn->out, id, status, format, &start) != 0 ||
+        strbuf_append(&conn->out, body, len) != 0) {
+      LOG_ERROR("Failed to allocate memory for binary protocol response");
+      conn->out.len = old_len;
+      if (conn->out.data) {
+        conn->out.data[old_len] = '\0';
+      }
+    } else {
+      wire_frame_end(&conn->out, start);
+      // 已注册 EPOLLOUT 说明套接字写满，新的响应排在后面由事件循环发送
+      if (!conn->want_write) {
+        conn_flush_locked(conn);
+      }
+    }
+  }
+  pthread_mutex_unlock(&conn->mutex);
+}
+
+/**
+ * @brief 在工作线程上执行请求，超过截止时间时状态码为 504
+ *
+ * @param server 监听器
+ * @param task 请求
+ * @param status 输出状态码
+ * @param len 输出响应长度
+ * @return const char* 响应，属于请求内存区域（或是常量）
+ */
+static const char *execute_task(wire_server_t *server, wire_task_t *task, unsigned int *status,
+                                size_t *len) {
+  *status = WIRE_STATUS_OK;
+  if (task->deadline_us > 0 && clock_now_us() >= task->deadline_us) {
+    // 排队期间已经超时，客户端不会再等这个响应
+    LOG_WARN("Deadline exceeded before executing binary protocol request %u", task->id);
+    *status = WIRE_STATUS_GATEWAY_TIMEOUT;
+    *len = strlen(KEY_RESP_ERROR " Deadline exceeded before the request was executed");
+    return KEY_RESP_ERROR " Deadline exceeded before the request was executed";
+  }
+
+  wire_request_t *wire_req = &task->req;
+  db_request_t req = {
+      .operation = db_op_name(wire_req->op),
+      .table = wire_req->table,
+      .data = wire_req->data,
+      .where = wire_req->where,
+      .batch = &wire_req->batch,
+      .batch_overflow = wire_req->batch_overflow,
+      .format = wire_req->format,
+  };
+  db_manager_set_deadline(task->deadline_us);
+  const char *response = db_request_execute(server->db_mgr, &req, task->arena, len);
+  if (db_manager_deadline_exceeded()) {
+    *status = WIRE_STATUS_GATEWAY_TIMEOUT;
+  }
+  db_manager_set_deadline(0);
+  return response;
+}
+
+/**
+ * @brief 请求结束：记录指标、归还准入名额、释放请求内存区域和连接引用
+ *
+ * @param task 请求
+ * @param failed 响应为错误
+ */
+static void task_finish(wire_task_t *task, bool failed) {
+  wire_conn_t *conn = task->conn;
+  wire_server_t *server = conn->server;
+  metrics_record_request(server->metrics, task->req.op, failed, clock_now_us() - task->start_us);
+  admission_leave(server->admission);
+  if (task->client) {
+    client_quota_leave(task->client);
+  }
+
+  arena_t *arena = task->arena;
+  metrics_shard_t *shard = metrics_shard(server->metrics);
+  metrics_add(&shard->arena_allocs, arena->num_allocs);
+  metrics_add(&shard->arena_blocks, arena->num_blocks);
+  metrics_add(&shard->arena_bytes, arena->bytes);
+  arena_destroy(arena);
+
+  atomic_fetch_sub_explicit(&conn->inflight, 1, memory_order_relaxed);
+  conn_release(conn);
+}
+
+/**
+ * @brief 工作线程任务：执行请求并把响应写回连接
+ *
+ * @param arg 请求
+ */
+static void wire_task_run(void *arg) {
+  wire_task_t *task = (wire_task_t *)arg;
+  wire_conn_t *conn = task->conn;
+  admission_record_delay(conn->server->admission, ADMISSION_STAGE_QUEUE,
+                         clock_now_us() - task->queued_us);
+
+  unsigned int status;
+  size_t len = 0;
+  const char *response = execute_task(conn->server, task, &status, &len);
+  if (!response) {
+    response = KEY_RESP_ERROR " Failed to process request";
+    len = strlen(response);
+  }
+
+  // 失败的 READ 返回文本错误信息，不是请求的结果集格式
+  bool failed = status != WIRE_STATUS_OK || (len >= strlen(KEY_RESP_ERROR) &&
+                                             strncmp(response, KEY_RESP_ERROR,
+                                                     strlen(KEY_RESP_ERROR)) == 0);
+  result_format_t format =
+      task->req.op == DB_OP_READ && !failed ? task->req.format : RESULT_FORMAT_TEXT;
+  conn_respond(conn, task->id, status, format, response, len);
+  task_finish(task, failed);
+}
+
+/**
+ * @brief 检查连接对应客户端的配额，二进制协议没有 Retry-After，不输出建议的等待时间
+ *
+ * @param task 请求
+ * @return client_quota_result_t 结果；未启用客户端配额时总是 CLIENT_QUOTA_OK
+ */
+static client_quota_result_t task_enter_quota(wire_task_t *task) {
+  wire_conn_t *conn = task->conn;
+  if (!conn->client[0]) {
+    return CLIENT_QUOTA_OK;
+  }
+  unsigned int retry_after_sec;
+  return client_quota_enter(conn->server->quota, conn->client, task->start_us, &task->client,
+                            &retry_after_sec);
+}
+
+/**
+ * @brief 解码一个请求帧，通过客户端配额和准入控制后交给工作线程，否则立即返回错误
+ *
+ * @param conn 连接
+ * @param frame 请求帧
+ */
+static void conn_dispatch(wire_conn_t *conn, const wire_frame_t *frame) {
+  wire_server_t *server = conn->server;
+  uint64_t now_us = clock_now_us();
+  arena_t *arena = arena_create(WIRE_ARENA_SIZE);
+  wire_task_t *task = arena ? arena_calloc(arena, sizeof(wire_task_t)) : NULL;
+  if (!task) {
+    LOG_ERROR("Failed to allocate memory for binary protocol request");
+    if (arena) {
+      arena_destroy(arena);
+    }
+    const char *error_msg = KEY_RESP_ERROR " Out of memory";
+    conn_respond(conn, frame->id, WIRE_STATUS_SERVICE_UNAVAILABLE, RESULT_FORMAT_TEXT, error_msg,
+                 strlen(error_msg));
+    return;
+  }
+  task->conn = conn;
+  task->arena = arena;
+  task->id = frame->id;
+  task->start_us = now_us;
+
+  const char *error_msg;
+  unsigned int status = WIRE_STATUS_SERVICE_UNAVAILABLE;
+  client_quota_result_t quota;
+  if (wire_request_decode(frame, arena, &task->req) != 0) {
+    LOG_WARN("Malformed binary protocol request %u", frame->id);
+    error_msg = KEY_RESP_ERROR " Malformed binary protocol request";
+    status = WIRE_STATUS_BAD_REQUEST;
+  } else if (atomic_load_explicit(&conn->inflight, memory_order_relaxed) >= WIRE_MAX_INFLIGHT) {
+    error_msg = KEY_RESP_ERROR " Too many requests in flight on this connection";
+  } else if ((quota = task_enter_quota(task)) != CLIENT_QUOTA_OK) {
+    LOG_DEBUG("Client %s over quota, rejecting binary protocol request", conn->client);
+    error_msg = quota == CLIENT_QUOTA_RATE_LIMITED
+                    ? KEY_RESP_ERROR " Rate limit exceeded, try again later"
+                    : KEY_RESP_ERROR " Too many concurrent requests from this client";
+    status = WIRE_STATUS_TOO_MANY_REQUESTS;
+  } else if (!admission_enter(server->admission)) {
+    LOG_DEBUG("Server overloaded, shedding binary protocol request");
+    error_msg = KEY_RESP_ERROR " Server busy, try again later";
+  } else {
+    task->queued_us = now_us;
+    task->deadline_us =
+        task->req.deadline_ms > 0 ? now_us + (uint64_t)task->req.deadline_ms * 1000 : 0;
+    atomic_fetch_add_explicit(&conn->inflight, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&conn->refs, 1, memory_order_relaxed);
+    if (worker_pool_submit(server->workers, wire_task_run, task) == 0) {
+      return;
+    }
+    // 事件循环仍持有引用，这里不会释放连接
+    LOG_WARN("DB worker queue is full, rejecting binary protocol request");
+    admission_shed(server->admission);
+    admission_leave(server->admission);
+    atomic_fetch_sub_explicit(&conn->inflight, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&conn->refs, 1, memory_order_relaxed);
+    error_msg = KEY_RESP_ERROR " Server busy, DB worker queue is full";
+  }
+
+  if (task->client) {
+    client_quota_leave(task->client);
+  }
+  conn_respond(conn, frame->id, status, RESULT_FORMAT_TEXT, error_msg, strlen(error_msg));
+  metrics_record_request(server->metrics, task->req.op, true, clock_now_us() - now_us);
+  arena_destroy(arena);
+}
+
+/**
+ * @brief 连接是否接收新的请求：套接字写满或积压的响应过多时暂停，发送完毕后恢复
+ *
+ * @param conn 连接
+ * @return bool 接收新的请求
+ */
+static bool conn_accepting(wire_conn_t *conn) {
+  pthread_mutex_lock(&conn->mutex);
+  bool accepting = !conn->want_write && conn->out.len - conn->out_off <= WIRE_OUT_MAX;
+  pthread_mutex_unlock(&conn->mutex);
+  return accepting;
+}
+
+/**
+ * @brief 分发已接收的完整请求帧；暂停接收时剩余的帧留在缓冲区中，发送完毕后再分发
+ *
+ * @param conn 连接
+ * @return bool 连接仍然可用返回 true；协议错误返回 false
+ */
+static bool conn_process(wire_conn_t *conn) {
+  size_t off = 0;
+  wire_frame_t frame;
+  int rc = 0;
+  while (conn_accepting(conn) &&
+         (rc = wire_frame_parse(conn->in.data + off, conn->in.len - off, &frame)) == 1) {
+    if (frame.type != WIRE_FRAME_REQUEST) {
+      LOG_WARN("Unexpected binary protocol frame type %u", (unsigned int)frame.type);
+      return false;
+    }
+    conn_dispatch(conn, &frame);
+    off += frame.frame_len;
+  }
+  if (rc < 0) {
+    return false;
+  }
+
+  // 不完整的帧移到缓冲区开头，等待后续数据
+  if (off > 0) {
+    memmove(conn->in.data, conn->in.data + off, conn->in.len - off);
+    conn->in.len -= off;
+    conn->in.data[conn->in.len] = '\0';
+  }
+  return true;
+}
+
+/**
+ * @brief 读取套接字上的数据，每读一次就分发其中完整的请求帧；单次最多读取 WIRE_READ_BUDGET
+ *        字节，暂停接收后不再读取
+ *
+ * @param conn 连接
+ * @return bool 连接仍然可用返回 true；对端关闭、出错或协议错误返回 false
+ */
+static bool conn_read(wire_conn_t *conn) {
+  size_t budget = WIRE_READ_BUDGET;
+  while (budget > 0 && conn_accepting(conn)) {
+    if (strbuf_reserve(&conn->in, WIRE_READ_SIZE) != 0) {
+      LOG_ERROR("Failed to allocate memory for binary protocol connection");
+      return false;
+    }
+    ssize_t n = recv(conn->fd, conn->in.data + conn->in.len, WIRE_READ_SIZE, 0);
+    if (n > 0) {
+      conn->in.len += (size_t)n;
+      conn->in.data[conn->in.len] = '\0';
+      metrics_add(&metrics_shard(conn->server->metrics)->bytes_in, (unsigned long long)n);
+      budget -= (size_t)n < budget ? (size_t)n : budget;
+      if (!conn_process(conn)) {
+        return false;
+      }
+      if ((size_t)n < WIRE_READ_SIZE) {
+        break;
+      }
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief 关闭连接：不再收发，在途请求的响应被丢弃，套接字在最后一个引用释放时关闭
+ *
+ * @param server 监听器
+ * @param conn 连接
+ */
+static void conn_close(wire_server_t *server, wire_conn_t *conn) {
+  epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+  pthread_mutex_lock(&conn->mutex);
+  conn->closed = true;
+  pthread_mutex_unlock(&conn->mutex);
+  shutdown(conn->fd, SHUT_RDWR);
+
+  if (conn->prev) {
+    conn->prev->next = conn->next;
+  } else {
+    server->conns = conn->next;
+  }
+  if (conn->next) {
+    conn->next->prev = conn->prev;
+  }
+  conn_release(conn);
+}
+
+/**
+ * @brief 接受所有等待中的连接
+ *
+ * @param server 监听器
+ */
+static void accept_connections(wire_server_t *server) {
+  for (;;) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd = accept4(server->listen_fd, (struct sockaddr *)&addr, &addr_len,
+                     SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        LOG_WARN("Failed to accept binary protocol connection: %s", strerror(errno));
+      }
+      return;
+    }
+
+    // 响应帧很小，不能等 Nagle 凑满一个报文
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    wire_conn_t *conn = calloc(1, sizeof(wire_conn_t));
+    if (!conn || pthread_mutex_init(&conn->mutex, NULL) != 0) {
+      LOG_ERROR("Failed to allocate memory for binary protocol connection");
+      free(conn);
+      close(fd);
+      continue;
+    }
+    conn->fd = fd;
+    conn->server = server;
+    strbuf_init(&conn->in);
+    strbuf_init(&conn->out);
+    atomic_init(&conn->refs, 1);
+    atomic_init(&conn->inflight, 0);
+    if (client_quota_enabled(server->quota)) {
+      // 二进制协议没有请求头，只能按对端地址识别客户端
+      client_quota_id(server->quota, NULL, (struct sockaddr *)&addr, conn->client,
+                      sizeof(conn->client));
+    }
+
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = conn};
+    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+      LOG_ERROR("Failed to register binary protocol connection: %s", strerror(errno));
+      conn_release(conn);
+      continue;
+    }
+    conn->next = server->conns;
+    if (server->conns) {
+      server->conns->prev = conn;
+    }
+    server->conns = conn;
+  }
+}
+
+/**
+ * @brief 事件循环：接受连接、接收请求、继续发送写满时剩余的响应
+ *
+ * @param arg 监听器
+ * @return void* NULL
+ */
+static void *wire_loop(void *arg) {
+  wire_server_t *server = (wire_server_t *)arg;
+  struct epoll_event events[WIRE_MAX_EVENTS];
+
+  while (!atomic_load_explicit(&server->stop, memory_order_acquire)) {
+    int n = epoll_wait(server->epoll_fd, events, WIRE_MAX_EVENTS, WIRE_POLL_INTERVAL_MS);
+    for (int i = 0; i < n; ++i) {
+      wire_conn_t *conn = events[i].data.ptr;
+      if (!conn) {
+        accept_connections(server);
+        continue;
+      }
+      bool ok = true;
+      if (events[i].events & EPOLLOUT) {
+        pthread_mutex_lock(&conn->mutex);
+        conn_flush_locked(conn);
+        pthread_mutex_unlock(&conn->mutex);
+        // 发送完毕后先分发暂停期间留在缓冲区中的请求
+        ok = conn_process(conn);
+      }
+      if (ok && (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+        ok = conn_read(conn);
+      }
+      if (!ok) {
+        conn_close(server, conn);
+      }
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief 创建监听套接字
+ *
+ * @param port 端口
+ * @return int 监听套接字；失败（-1）
+ */
+static int wire_listen(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create binary protocol socket: %s", strerror(errno));
+    return -1;
+  }
+
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons((uint16_t)port);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+    LOG_ERROR("Failed to listen on binary protocol port %d: %s", port, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @brief 启动二进制协议监听器
+ *
+ * @param db_mgr 数据库管理对象
+ * @param conf 配置
+ * @param admission 准入控制
+ * @param quota 客户端配额
+ * @param metrics 指标
+ * @return wire_server_t* 监听器，失败返回 NULL
+ */
+wire_server_t *wire_server_start(db_manager_t *db_mgr, const wire_server_conf_t *conf,
+                                 admission_t *admission, client_quota_t *quota,
+                                 metrics_t *metrics) {
+  if (conf->port <= 0 || conf->port > 65535 || conf->num_workers <= 0 || conf->queue_size <= 0) {
+    LOG_ERROR("Invalid binary protocol configuration: port=%d, workers=%d, queue=%d", conf->port,
+              conf->num_workers, conf->queue_size);
+    return NULL;
+  }
+
+  wire_server_t *server = calloc(1, sizeof(wire_server_t));
+  if (!server) {
+    LOG_ERROR("Failed to allocate memory for binary protocol server");
+    return NULL;
+  }
+  server->conf = *conf;
+  server->db_mgr = db_mgr;
+  server->admission = admission;
+  server->quota = quota;
+  server->metrics = metrics;
+  server->epoll_fd = -1;
+  atomic_init(&server->stop, false);
+
+  server->listen_fd = wire_listen(conf->port);
+  if (server->listen_fd < 0) {
+    wire_server_stop(server);
+    return NULL;
+  }
+  server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+  if (server->epoll_fd < 0 ||
+      epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &event) != 0) {
+    LOG_ERROR("Failed to create epoll instance for binary protocol: %s", strerror(errno));
+    wire_server_stop(server);
+    return NULL;
+  }
+  server->workers = worker_pool_create(conf->num_workers, conf->queue_size);
+  if (!server->workers) {
+    LOG_ERROR("Failed to create binary protocol worker pool");
+    wire_server_stop(server);
+    return NULL;
+  }
+  if (pthread_create(&server->thread, NULL, wire_loop, server) != 0) {
+    LOG_ERROR("Failed to create binary protocol event loop thread");
+    wire_server_stop(server);
+    return NULL;
+  }
+  server->thread_started = true;
+
+  LOG_INFO("Binary protocol listening on port %d, workers=%d", conf->port, conf->num_workers);
+  return server;
+}
+
+/**
+ * @brief 停止并销毁二进制协议监听器：先停止接收新请求，执行完已排队的请求后关闭所有连接
+ *
+ * @param server 监听器
+ */
+void wire_server_stop(wire_server_t *server) {
+  if (!server) {
+    return;
+  }
+
+  atomic_store_explicit(&server->stop, true, memory_order_release);
+  if (server->thread_started) {
+    pthread_join(server->thread, NULL);
+  }
+  // 连接尚未关闭，排队请求的响应仍能写回客户端
+  worker_pool_destroy(server->workers);
+  while (server->conns) {
+    conn_close(server, server->conns);
+  }
+  if (server->epoll_fd >= 0) {
+    close(server->epoll_fd);
+  }
+  if (server->listen_fd >= 0) {
+    close(server->listen_fd);
+  }
+  free(server);
+}
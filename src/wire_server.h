@@ -0,0 +1,45 @@
+#pragma once
+
+// clang-format off
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "src/admission.h"
+#include "src/client_quota.h"
+#include "src/db_manager.h"
+#include "src/metrics.h"
+#include "src/worker_pool.h"
+// clang-format on
+
+// 单个连接上同时在途的请求上限，超出的请求直接返回 503
+#define WIRE_MAX_INFLIGHT 1024
+
+typedef struct {
+  int port;        // 监听的 TCP 端口
+  int num_workers; // 执行请求的工作线程数，决定一个连接上能有多少请求并行执行
+  int queue_size;  // 任务队列容量
+} wire_server_conf_t;
+
+typedef struct wire_conn wire_conn_t;
+
+// 二进制协议监听器：一个 epoll 事件循环线程负责收发，请求交给工作线程执行，
+// 完成的响应由工作线程直接写回连接，不必等待同一连接上更早的请求
+typedef struct {
+  wire_server_conf_t conf;
+  db_manager_t *db_mgr;
+  admission_t *admission; // 与 HTTP 共用的准入控制
+  client_quota_t *quota;  // 与 HTTP 共用的客户端配额，按对端地址识别客户端
+  metrics_t *metrics;     // 与 HTTP 共用的指标
+  worker_pool_t *workers;
+  int listen_fd;
+  int epoll_fd;
+  pthread_t thread;
+  bool thread_started;
+  atomic_bool stop;
+  wire_conn_t *conns; // 所有连接，只由事件循环线程修改
+} wire_server_t;
+
+wire_server_t *wire_server_start(db_manager_t *db_mgr, const wire_server_conf_t *conf,
+                                 admission_t *admission, client_quota_t *quota,
+                                 metrics_t *metrics);
+void wire_server_stop(wire_server_t *server);
@@ -0,0 +1,176 @@
+// clang-format off
+#include <stdlib.h>
+#include "worker_pool.h"
+#include "src/assert.h"
+#include "src/logger.h"
+// clang-format on
+
+/**
+ * @brief 工作线程主循环：从队列中取出任务并执行，关闭时先把剩余任务执行完
+ *
+ * @param arg 工作线程池
+ * @return void* NULL
+ */
+static void *worker_loop(void *arg) {
+  worker_pool_t *pool = (worker_pool_t *)arg;
+
+  while (true) {
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->count == 0 && !pool->shutdown) {
+      pthread_cond_wait(&pool->not_empty, &pool->mutex);
+    }
+
+    if (pool->count == 0 && pool->shutdown) {
+      pthread_mutex_unlock(&pool->mutex);
+      break;
+    }
+
+    worker_task_t task = pool->queue[pool->head];
+    pool->head = (pool->head + 1) % pool->capacity;
+    --pool->count;
+    pthread_mutex_unlock(&pool->mutex);
+
+    task.fn(task.arg);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief 创建工作线程池
+ *
+ * @param num_threads 工作线程数量
+ * @param capacity 任务队列容量
+ * @return worker_pool_t* 工作线程池对象
+ */
+worker_pool_t *worker_pool_create(int num_threads, int capacity) {
+  DBMNGR_ASSERT(num_threads > 0);
+  DBMNGR_ASSERT(capacity > 0);
+
+  worker_pool_t *pool = malloc(sizeof(worker_pool_t));
+  if (!pool) {
+    LOG_ERROR("Failed to allocate memory for worker pool");
+    return NULL;
+  }
+
+  pool->threads = calloc(num_threads, sizeof(pthread_t));
+  pool->queue = malloc(sizeof(worker_task_t) * capacity);
+  if (!pool->threads || !pool->queue) {
+    LOG_ERROR("Failed to allocate memory for worker pool");
+    free(pool->threads);
+    free(pool->queue);
+    free(pool);
+    return NULL;
+  }
+
+  pool->num_threads = 0;
+  pool->capacity = capacity;
+  pool->head = 0;
+  pool->count = 0;
+  pool->shutdown = false;
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->not_empty, NULL);
+
+  for (int i = 0; i < num_threads; ++i) {
+    if (pthread_create(&pool->threads[i], NULL, worker_loop, pool) != 0) {
+      LOG_ERROR("Failed to create worker thread %d", i);
+      worker_pool_destroy(pool);
+      return NULL;
+    }
+    ++pool->num_threads;
+  }
+
+  LOG_INFO("Worker pool created: threads=%d, queue capacity=%d", num_threads, capacity);
+  return pool;
+}
+
+/**
+ * @brief 提交任务，队列已满时立即失败而不是阻塞调用方
+ *
+ * @param pool 工作线程池
+ * @param fn 任务函数
+ * @param arg 任务参数
+ * @return int 成功（0）；队列已满或已关闭（-1）
+ */
+int worker_pool_submit(worker_pool_t *pool, worker_task_fn fn, void *arg) {
+  if (!pool || !fn) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+  if (pool->shutdown || pool->count == pool->capacity) {
+    pthread_mutex_unlock(&pool->mutex);
+    return -1;
+  }
+
+  int tail = (pool->head + pool->count) % pool->capacity;
+  pool->queue[tail].fn = fn;
+  pool->queue[tail].arg = arg;
+  ++pool->count;
+
+  pthread_cond_signal(&pool->not_empty);
+  pthread_mutex_unlock(&pool->mutex);
+  return 0;
+}
+
+/**
+ * @brief 获取排队中的任务数量
+ *
+ * @param pool 工作线程池
+ * @return int 任务数量
+ */
+int worker_pool_pending(worker_pool_t *pool) {
+  if (!pool) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+  int count = pool->count;
+  pthread_mutex_unlock(&pool->mutex);
+  return count;
+}
+
+/**
+ * @brief 关闭工作线程池：拒绝新任务，等待已排队的任务全部执行完毕后回收线程
+ *
+ * @param pool 工作线程池
+ */
+void worker_pool_shutdown(worker_pool_t *pool) {
+  if (!pool) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+  if (pool->shutdown) {
+    pthread_mutex_unlock(&pool->mutex);
+    return;
+  }
+  pool->shutdown = true;
+  pthread_cond_broadcast(&pool->not_empty);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for (int i = 0; i < pool->num_threads; ++i) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  pool->num_threads = 0;
+}
+
+/**
+ * @brief 销毁工作线程池
+ *
+ * @param pool 工作线程池
+ */
+void worker_pool_destroy(worker_pool_t *pool) {
+  if (!pool) {
+    return;
+  }
+
+  worker_pool_shutdown(pool);
+
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_cond_destroy(&pool->not_empty);
+  free(pool->threads);
+  free(pool->queue);
+  free(pool);
+  LOG_INFO("Worker pool destroyed");
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// clang-format off
+#include <pthread.h>
+#include <stdbool.h>
+// clang-format on
+
+typedef void (*worker_task_fn)(void *arg);
+
+typedef struct {
+  worker_task_fn fn;
+  void *arg;
+} worker_task_t;
+
+typedef struct {
+  pthread_t *threads;
+  int num_threads;
+  worker_task_t *queue; // 环形队列，共享资源
+  int capacity;
+  int head;
+  int count;
+  pthread_mutex_t mutex;
+  pthread_cond_t not_empty;
+  bool shutdown;
+} worker_pool_t;
+
+worker_pool_t *worker_pool_create(int num_threads, int capacity);
+int worker_pool_submit(worker_pool_t *pool, worker_task_fn fn, void *arg);
+int worker_pool_pending(worker_pool_t *pool);
+void worker_pool_shutdown(worker_pool_t *pool);
+void worker_pool_destroy(worker_pool_t *pool);
@@ -37,7 +37,8 @@ build/dbmanager --db-host=$MYSQL_HOST \
             --db-user=$MYSQL_USER \
             --db-password=$MYSQL_PASSWORD \
             --db-name=mydb \
-            --pool-size=8 > /dev/null 2>&1 &
+            --pool-size=8 \
+            --unix-socket=/tmp/dbmanager_test.sock > /dev/null 2>&1 &
 PID=$!
 echo "sleep 5s"
 sleep 5
@@ -49,4 +50,13 @@ echo -e "\n---- UPDATE ----"
 build/dbcli update --table=users --data="age=31" --where="id=1"
 echo -e "\n---- DELETE ----"
 build/dbcli delete --table=users --where="id=1"
+echo -e "\n---- BATCH ----"
+printf 'create\tusers\tname=%s,age=25\nread\tusers\t\tage=25\nupdate\tusers\tage=26\tage=25\n' "'Bob'" \
+  | build/dbcli batch --file=- --transaction
+echo -e "\n---- READ (Unix socket) ----"
+build/dbcli read   --url=unix:/tmp/dbmanager_test.sock --table=users --where="age=26"
+echo -e "\n---- JSON BODY ----"
+build/dbcli create --body=json --table=users --data="name='Carol \"C\"',age=40"
+printf 'read\tusers\t\tage=40\ndelete\tusers\t\tage=40\n' \
+  | build/dbcli batch --body=json --file=-
 kill $PID
@@ -0,0 +1,105 @@
+// clang-format off
+#include <unistd.h>
+#include "unity.h"
+#include "src/admission.h"
+// clang-format on
+
+#define TEST_MAX_PENDING 8
+#define TEST_CONCURRENCY 2
+#define TEST_TARGET_US 1000
+#define TEST_INTERVAL_US 50000
+
+static admission_t adm;
+
+void setUp(void) {
+  TEST_ASSERT_EQUAL_INT(0, admission_init(&adm, TEST_MAX_PENDING, TEST_CONCURRENCY,
+                                          TEST_TARGET_US, TEST_INTERVAL_US));
+}
+
+void tearDown(void) {
+  admission_destroy(&adm);
+}
+
+/**
+ * @brief 记录一个窗口的排队延迟，并等到窗口结束
+ */
+static void run_window(admission_stage_t stage, uint64_t delay_us) {
+  admission_record_delay(&adm, stage, delay_us);
+  usleep(TEST_INTERVAL_US + TEST_INTERVAL_US / 2);
+}
+
+void test_admission_pending_budget(void) {
+  for (int i = 0; i < TEST_MAX_PENDING; ++i) {
+    TEST_ASSERT_TRUE(admission_enter(&adm));
+  }
+  TEST_ASSERT_FALSE(admission_enter(&adm));
+  TEST_ASSERT_FALSE(admission_enter(&adm));
+  TEST_ASSERT_EQUAL_UINT64(2, admission_shed_count(&adm));
+
+  admission_leave(&adm);
+  TEST_ASSERT_TRUE(admission_enter(&adm));
+  for (int i = 0; i < TEST_MAX_PENDING; ++i) {
+    admission_leave(&adm);
+  }
+  TEST_ASSERT_EQUAL_INT(0, adm.pending);
+}
+
+void test_admission_disabled(void) {
+  admission_destroy(&adm);
+  TEST_ASSERT_EQUAL_INT(0, admission_init(&adm, 0, TEST_CONCURRENCY, TEST_TARGET_US,
+                                          TEST_INTERVAL_US));
+  for (int i = 0; i < TEST_MAX_PENDING * 4; ++i) {
+    TEST_ASSERT_TRUE(admission_enter(&adm));
+  }
+  TEST_ASSERT_EQUAL_UINT64(0, admission_shed_count(&adm));
+}
+
+void test_admission_standing_queue(void) {
+  // 整个窗口内最小排队延迟超过目标，只接纳无需排队的请求
+  run_window(ADMISSION_STAGE_QUEUE, TEST_TARGET_US * 5);
+  TEST_ASSERT_TRUE(admission_overloaded(&adm));
+  for (int i = 0; i < TEST_CONCURRENCY; ++i) {
+    TEST_ASSERT_TRUE(admission_enter(&adm));
+  }
+  TEST_ASSERT_FALSE(admission_enter(&adm));
+  TEST_ASSERT_EQUAL_UINT64(1, admission_shed_count(&adm));
+
+  // 任一请求没有排队，说明队列已排空
+  admission_record_delay(&adm, ADMISSION_STAGE_QUEUE, TEST_TARGET_US * 5);
+  run_window(ADMISSION_STAGE_QUEUE, 0);
+  TEST_ASSERT_FALSE(admission_overloaded(&adm));
+  TEST_ASSERT_TRUE(admission_enter(&adm));
+}
+
+void test_admission_burst_is_not_overload(void) {
+  // 突发：窗口内有请求排队，但也有请求无需排队
+  admission_record_delay(&adm, ADMISSION_STAGE_CONNECTION, TEST_TARGET_US * 10);
+  run_window(ADMISSION_STAGE_CONNECTION, TEST_TARGET_US / 2);
+  TEST_ASSERT_FALSE(admission_overloaded(&adm));
+}
+
+void test_admission_any_stage_overloaded(void) {
+  admission_record_delay(&adm, ADMISSION_STAGE_QUEUE, 0);
+  run_window(ADMISSION_STAGE_CONNECTION, TEST_TARGET_US * 5);
+  TEST_ASSERT_TRUE(admission_overloaded(&adm));
+}
+
+void test_admission_stale_window(void) {
+  // 过载窗口之后长时间没有流量，旧样本不再生效
+  admission_record_delay(&adm, ADMISSION_STAGE_QUEUE, TEST_TARGET_US * 5);
+  usleep(TEST_INTERVAL_US * 3);
+  TEST_ASSERT_FALSE(admission_overloaded(&adm));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_admission_pending_budget);
+  RUN_TEST(test_admission_disabled);
+  RUN_TEST(test_admission_standing_queue);
+  RUN_TEST(test_admission_burst_is_not_overload);
+  RUN_TEST(test_admission_any_stage_overloaded);
+  RUN_TEST(test_admission_stale_window);
+
+  return UNITY_END();
+}
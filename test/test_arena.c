@@ -0,0 +1,110 @@
+// clang-format off
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "src/arena.h"
+// clang-format on
+
+#define TEST_BLOCK_SIZE 256
+
+static arena_t *arena = NULL;
+
+void setUp(void) {
+  arena = arena_create(TEST_BLOCK_SIZE);
+}
+
+void tearDown(void) {
+  arena_destroy(arena);
+  arena = NULL;
+}
+
+void test_arena_alloc_aligned(void) {
+  TEST_ASSERT_NOT_NULL(arena);
+  for (size_t size = 1; size < 40; size += 7) {
+    void *ptr = arena_alloc(arena, size);
+    TEST_ASSERT_NOT_NULL(ptr);
+    TEST_ASSERT_EQUAL_INT(0, (uintptr_t)ptr % alignof(max_align_t));
+    memset(ptr, 0xab, size);
+  }
+  TEST_ASSERT_EQUAL_INT(6, arena->num_allocs);
+  TEST_ASSERT_EQUAL_INT(1, arena->num_blocks);
+}
+
+void test_arena_new_blocks(void) {
+  // 小分配填满首块后申请新块，大分配独占一个块
+  for (int i = 0; i < 32; ++i) {
+    char *ptr = arena_alloc(arena, 32);
+    TEST_ASSERT_NOT_NULL(ptr);
+    memset(ptr, i, 32);
+  }
+  TEST_ASSERT_GREATER_THAN(1, arena->num_blocks);
+
+  char *small = arena_alloc(arena, 16);
+  size_t blocks = arena->num_blocks;
+  char *big = arena_alloc(arena, TEST_BLOCK_SIZE * 4);
+  TEST_ASSERT_NOT_NULL(big);
+  memset(big, 0xcd, TEST_BLOCK_SIZE * 4);
+  TEST_ASSERT_EQUAL_INT(blocks + 1, arena->num_blocks);
+
+  // 独占块不影响当前块的剩余空间
+  char *next = arena_alloc(arena, 16);
+  TEST_ASSERT_EQUAL_PTR(small + alignof(max_align_t), next);
+}
+
+void test_arena_grow(void) {
+  char *ptr = arena_alloc(arena, 4);
+  memcpy(ptr, "abc", 4);
+  char *grown = arena_grow(arena, ptr, 4, 64);
+  TEST_ASSERT_EQUAL_PTR(ptr, grown);
+  TEST_ASSERT_EQUAL_STRING("abc", grown);
+
+  // 不是最近一次分配，只能复制
+  arena_alloc(arena, 8);
+  char *moved = arena_grow(arena, grown, 64, 128);
+  TEST_ASSERT_NOT_NULL(moved);
+  TEST_ASSERT_TRUE(moved != grown);
+  TEST_ASSERT_EQUAL_STRING("abc", moved);
+
+  // 当前块放不下，复制到新块
+  char *large = arena_grow(arena, moved, 128, TEST_BLOCK_SIZE * 2);
+  TEST_ASSERT_NOT_NULL(large);
+  TEST_ASSERT_EQUAL_STRING("abc", large);
+
+  TEST_ASSERT_EQUAL_PTR(ptr, arena_grow(arena, ptr, 4, 2));
+}
+
+void test_arena_strings(void) {
+  TEST_ASSERT_EQUAL_STRING("hello", arena_strdup(arena, "hello"));
+  TEST_ASSERT_EQUAL_STRING("success: Created 3 row(s)",
+                           arena_sprintf(arena, "%s Created %d row(s)", "success:", 3));
+
+  char wide[TEST_BLOCK_SIZE * 2];
+  memset(wide, 'x', sizeof(wide) - 1);
+  wide[sizeof(wide) - 1] = '\0';
+  char *str = arena_sprintf(arena, "[%s]", wide);
+  TEST_ASSERT_NOT_NULL(str);
+  TEST_ASSERT_EQUAL_size_t(sizeof(wide) + 1, strlen(str));
+  TEST_ASSERT_EQUAL_STRING_LEN(wide, str + 1, sizeof(wide) - 1);
+
+  TEST_ASSERT_EQUAL_STRING("after", arena_strdup(arena, "after"));
+}
+
+void test_arena_own(void) {
+  // 托管的堆内存随内存区域释放，由 ASan 检查泄漏
+  TEST_ASSERT_EQUAL_INT(0, arena_own(arena, malloc(100)));
+  TEST_ASSERT_EQUAL_INT(0, arena_own(arena, strdup("owned")));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_arena_alloc_aligned);
+  RUN_TEST(test_arena_new_blocks);
+  RUN_TEST(test_arena_grow);
+  RUN_TEST(test_arena_strings);
+  RUN_TEST(test_arena_own);
+
+  return UNITY_END();
+}
@@ -0,0 +1,456 @@
+// clang-format off
+#include <stdio.h>
+#include <string.h>
+#include <mysql/mysql.h>
+#include "unity.h"
+#include "src/binlog.h"
+#include "src/gtid.h"
+#include "src/strbuf.h"
+// clang-format on
+
+#define UUID_TEXT "3e11fa47-71ca-11e1-9e33-c80aa9429562"
+
+static const unsigned char UUID[GTID_UUID_LEN] = {0x3e, 0x11, 0xfa, 0x47, 0x71, 0xca, 0x11, 0xe1,
+                                                  0x9e, 0x33, 0xc8, 0x0a, 0xa9, 0x42, 0x95, 0x62};
+
+// 手工构造的事件
+typedef struct {
+  unsigned char data[4096];
+  size_t len;
+} buf_t;
+
+static binlog_decoder_t dec;
+static strbuf_t out;
+
+void setUp(void) {
+  TEST_ASSERT_EQUAL_INT(0, binlog_decoder_init(&dec, "test", "users"));
+  strbuf_init(&out);
+}
+
+void tearDown(void) {
+  binlog_decoder_free(&dec);
+  strbuf_free(&out);
+}
+
+static void put(buf_t *b, const void *data, size_t n) {
+  TEST_ASSERT_TRUE(b->len + n <= sizeof(b->data));
+  memcpy(b->data + b->len, data, n);
+  b->len += n;
+}
+
+// 小端整数
+static void put_u(buf_t *b, uint64_t value, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    unsigned char byte = (unsigned char)(value >> (8 * i));
+    put(b, &byte, 1);
+  }
+}
+
+// 大端整数
+static void put_be(buf_t *b, uint64_t value, size_t n) {
+  for (size_t i = n; i > 0; --i) {
+    unsigned char byte = (unsigned char)(value >> (8 * (i - 1)));
+    put(b, &byte, 1);
+  }
+}
+
+// 长度编码（小于 251）的字符串
+static void put_lenenc_str(buf_t *b, const char *str) {
+  put_u(b, strlen(str), 1);
+  put(b, str, strlen(str));
+}
+
+/**
+ * @brief 加上事件头和 CRC32 占位（解码器不校验）后交给解码器
+ */
+static int feed(unsigned char type, const buf_t *body, binlog_event_kind_t *kind) {
+  buf_t event = {{0}, 0};
+  size_t size = BINLOG_HEADER_LEN + body->len + 4;
+  put_u(&event, 0, 4);
+  put_u(&event, type, 1);
+  put_u(&event, 1, 4);
+  put_u(&event, size, 4);
+  put_u(&event, 0, 4);
+  put_u(&event, 0, 2);
+  put(&event, body->data, body->len);
+  put_u(&event, 0, 4);
+  return binlog_decode(&dec, event.data, event.len, &out, kind);
+}
+
+static void feed_ok(unsigned char type, const buf_t *body, binlog_event_kind_t expected) {
+  binlog_event_kind_t kind;
+  TEST_ASSERT_EQUAL_INT(0, feed(type, body, &kind));
+  TEST_ASSERT_EQUAL_INT(expected, kind);
+}
+
+static void feed_format_description(void) {
+  buf_t b = {{0}, 0};
+  put_u(&b, 4, 2);
+  char version[50] = "8.0.36";
+  put(&b, version, sizeof(version));
+  put_u(&b, 0, 4);
+  put_u(&b, BINLOG_HEADER_LEN, 1);
+  for (int i = 0; i < 41; ++i) {
+    put_u(&b, 0, 1);
+  }
+  put_u(&b, 1, 1); // CRC32
+  feed_ok(BINLOG_FORMAT_DESCRIPTION_EVENT, &b, BINLOG_EVENT_OTHER);
+}
+
+static void feed_gtid(uint64_t gno) {
+  buf_t b = {{0}, 0};
+  put_u(&b, 1, 1);
+  put(&b, UUID, GTID_UUID_LEN);
+  put_u(&b, gno, 8);
+  put_u(&b, 2, 1);  // 逻辑时钟
+  put_u(&b, 0, 8); // last_committed
+  put_u(&b, 0, 8); // sequence_number
+  feed_ok(BINLOG_GTID_EVENT, &b, BINLOG_EVENT_OTHER);
+}
+
+static void feed_query(const char *query, binlog_event_kind_t expected) {
+  buf_t b = {{0}, 0};
+  put_u(&b, 7, 4);
+  put_u(&b, 0, 4);
+  put_u(&b, 4, 1);
+  put_u(&b, 0, 2);
+  put_u(&b, 3, 2);
+  put_u(&b, 0, 3); // 状态变量
+  put(&b, "test", 5);
+  put(&b, query, strlen(query));
+  feed_ok(BINLOG_QUERY_EVENT, &b, expected);
+}
+
+static void feed_xid(binlog_event_kind_t expected) {
+  buf_t b = {{0}, 0};
+  put_u(&b, 42, 8);
+  feed_ok(BINLOG_XID_EVENT, &b, expected);
+}
+
+/**
+ * @brief users(id INT UNSIGNED, name VARCHAR(64), balance DECIMAL(10,2), created DATETIME)
+ */
+static void feed_users_table_map(uint64_t table_id, const char *table, bool with_names) {
+  buf_t b = {{0}, 0};
+  put_u(&b, table_id, 6);
+  put_u(&b, 1, 2);
+  put_lenenc_str(&b, "test");
+  put_u(&b, 0, 1);
+  put_lenenc_str(&b, table);
+  put_u(&b, 0, 1);
+  put_u(&b, 4, 1);
+  unsigned char types[] = {MYSQL_TYPE_LONG, MYSQL_TYPE_VARCHAR, MYSQL_TYPE_NEWDECIMAL,
+                           MYSQL_TYPE_DATETIME2};
+  put(&b, types, sizeof(types));
+  unsigned char meta[] = {0x00, 0x01, 10, 2, 0}; // VARCHAR 256 字节，DECIMAL(10,2)，DATETIME(0)
+  put_u(&b, sizeof(meta), 1);
+  put(&b, meta, sizeof(meta));
+  put_u(&b, 0x0E, 1); // 可为 NULL 的列
+  // 数值列 id、balance 的符号位，id 无符号
+  put_u(&b, 1, 1);
+  put_u(&b, 1, 1);
+  put_u(&b, 0x80, 1);
+  if (with_names) {
+    buf_t names = {{0}, 0};
+    put_lenenc_str(&names, "id");
+    put_lenenc_str(&names, "name");
+    put_lenenc_str(&names, "balance");
+    put_lenenc_str(&names, "created");
+    put_u(&b, 4, 1);
+    put_u(&b, names.len, 1);
+    put(&b, names.data, names.len);
+  }
+  feed_ok(BINLOG_TABLE_MAP_EVENT, &b, BINLOG_EVENT_OTHER);
+}
+
+static uint64_t datetime2(unsigned year, unsigned month, unsigned day, unsigned hour,
+                          unsigned minute, unsigned second) {
+  uint64_t ym = (uint64_t)year * 13 + month;
+  return (ym << 22 | (uint64_t)day << 17 | (uint64_t)hour << 12 | minute << 6 | second) +
+         0x8000000000ULL;
+}
+
+static void put_users_row(buf_t *b, uint32_t id, const char *name, bool negative) {
+  bool null_name = name == NULL;
+  put_u(b, null_name ? 0x02 : 0x00, 1);
+  put_u(b, id, 4);
+  if (!null_name) {
+    put_u(b, strlen(name), 2);
+    put(b, name, strlen(name));
+  }
+  // 1234.56：整数部分 8 位占 4 字节，小数部分 2 位占 1 字节
+  unsigned char decimal[] = {0x80, 0x00, 0x04, 0xD2, 0x38};
+  if (negative) {
+    for (size_t i = 0; i < sizeof(decimal); ++i) {
+      decimal[i] ^= 0xFF;
+    }
+  }
+  put(b, decimal, sizeof(decimal));
+  put_be(b, datetime2(2024, 3, 5, 10, 20, 30), 5);
+}
+
+static void rows_header(buf_t *b, uint64_t table_id, bool update) {
+  put_u(b, table_id, 6);
+  put_u(b, 1, 2);
+  put_u(b, 2, 2); // 没有额外数据
+  put_u(b, 4, 1);
+  put_u(b, 0x0F, 1);
+  if (update) {
+    put_u(b, 0x0F, 1);
+  }
+}
+
+void test_gtid_set_parse_format(void) {
+  gtid_set_t set;
+  gtid_set_init(&set);
+  TEST_ASSERT_EQUAL_INT(
+      0, gtid_set_parse(&set, "3E11FA47-71CA-11E1-9E33-C80AA9429562:1-5:7,\n" UUID_TEXT ":6"));
+  strbuf_t text;
+  strbuf_init(&text);
+  TEST_ASSERT_EQUAL_INT(0, gtid_set_format(&set, &text));
+  TEST_ASSERT_EQUAL_STRING(UUID_TEXT ":1-7", text.data);
+
+  // 不相邻的事务单独成区间，之后补上空缺时合并
+  TEST_ASSERT_EQUAL_INT(0, gtid_set_add(&set, UUID, 10));
+  strbuf_reset(&text);
+  gtid_set_format(&set, &text);
+  TEST_ASSERT_EQUAL_STRING(UUID_TEXT ":1-7:10", text.data);
+  TEST_ASSERT_EQUAL_INT(0, gtid_set_add(&set, UUID, 9));
+  TEST_ASSERT_EQUAL_INT(0, gtid_set_add(&set, UUID, 8));
+  strbuf_reset(&text);
+  gtid_set_format(&set, &text);
+  TEST_ASSERT_EQUAL_STRING(UUID_TEXT ":1-10", text.data);
+  gtid_set_free(&set);
+
+  // 空集合
+  TEST_ASSERT_EQUAL_INT(0, gtid_set_parse(&set, ""));
+  strbuf_reset(&text);
+  TEST_ASSERT_EQUAL_INT(0, gtid_set_format(&set, &text));
+  TEST_ASSERT_EQUAL_STRING("", text.data);
+
+  const char *invalid[] = {UUID_TEXT, UUID_TEXT ":", UUID_TEXT ":0", UUID_TEXT ":5-3",
+                           UUID_TEXT ":1x", "3e11fa47:1", UUID_TEXT ":tag:1"};
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+    gtid_set_free(&set);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(-1, gtid_set_parse(&set, invalid[i]), invalid[i]);
+  }
+  gtid_set_free(&set);
+  strbuf_free(&text);
+}
+
+void test_gtid_set_encode(void) {
+  gtid_set_t set;
+  gtid_set_init(&set);
+  TEST_ASSERT_EQUAL_INT(0, gtid_set_parse(&set, UUID_TEXT ":1-5:7"));
+  strbuf_t encoded;
+  strbuf_init(&encoded);
+  TEST_ASSERT_EQUAL_INT(0, gtid_set_encode(&set, &encoded));
+
+  buf_t expected = {{0}, 0};
+  put_u(&expected, 1, 8);
+  put(&expected, UUID, GTID_UUID_LEN);
+  put_u(&expected, 2, 8);
+  put_u(&expected, 1, 8);
+  put_u(&expected, 6, 8);
+  put_u(&expected, 7, 8);
+  put_u(&expected, 8, 8);
+  TEST_ASSERT_EQUAL_UINT(expected.len, encoded.len);
+  TEST_ASSERT_EQUAL_MEMORY(expected.data, encoded.data, expected.len);
+
+  // 空集合只有服务器数 0
+  gtid_set_free(&set);
+  strbuf_reset(&encoded);
+  TEST_ASSERT_EQUAL_INT(0, gtid_set_encode(&set, &encoded));
+  TEST_ASSERT_EQUAL_UINT(8, encoded.len);
+  strbuf_free(&encoded);
+}
+
+void test_binlog_insert_update_delete(void) {
+  feed_format_description();
+  feed_gtid(12);
+  feed_query("BEGIN", BINLOG_EVENT_OTHER);
+  feed_users_table_map(88, "users", true);
+
+  buf_t b = {{0}, 0};
+  rows_header(&b, 88, false);
+  put_users_row(&b, 4000000000U, "alice", false);
+  put_users_row(&b, 2, NULL, true);
+  feed_ok(BINLOG_WRITE_ROWS_EVENT, &b, BINLOG_EVENT_OTHER);
+  // 提交之前不输出
+  TEST_ASSERT_EQUAL_UINT(0, out.len);
+  feed_xid(BINLOG_EVENT_COMMIT);
+  TEST_ASSERT_TRUE(dec.has_gtid);
+  TEST_ASSERT_EQUAL_UINT64(12, dec.gno);
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"gtid\":\"" UUID_TEXT ":12\",\"table\":\"users\",\"type\":\"insert\",\"row\":"
+      "{\"id\":4000000000,\"name\":\"alice\",\"balance\":\"1234.56\","
+      "\"created\":\"2024-03-05 10:20:30\"}}\n"
+      "{\"gtid\":\"" UUID_TEXT ":12\",\"table\":\"users\",\"type\":\"insert\",\"row\":"
+      "{\"id\":2,\"name\":null,\"balance\":\"-1234.56\",\"created\":\"2024-03-05 10:20:30\"}}\n",
+      out.data);
+
+  // 没有列名时按 @序号输出；UPDATE 输出前后两个镜像
+  strbuf_reset(&out);
+  feed_gtid(13);
+  feed_query("BEGIN", BINLOG_EVENT_OTHER);
+  feed_users_table_map(88, "users", false);
+  b.len = 0;
+  rows_header(&b, 88, true);
+  put_users_row(&b, 1, "a\"b", false);
+  put_users_row(&b, 1, "c", false);
+  feed_ok(BINLOG_UPDATE_ROWS_EVENT, &b, BINLOG_EVENT_OTHER);
+  b.len = 0;
+  rows_header(&b, 88, false);
+  put_users_row(&b, 3, "d", false);
+  feed_ok(BINLOG_DELETE_ROWS_EVENT, &b, BINLOG_EVENT_OTHER);
+  feed_query("COMMIT", BINLOG_EVENT_COMMIT);
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"gtid\":\"" UUID_TEXT ":13\",\"table\":\"users\",\"type\":\"update\",\"before\":"
+      "{\"@1\":1,\"@2\":\"a\\\"b\",\"@3\":\"1234.56\",\"@4\":\"2024-03-05 10:20:30\"},"
+      "\"after\":{\"@1\":1,\"@2\":\"c\",\"@3\":\"1234.56\",\"@4\":\"2024-03-05 10:20:30\"}}\n"
+      "{\"gtid\":\"" UUID_TEXT ":13\",\"table\":\"users\",\"type\":\"delete\",\"row\":"
+      "{\"@1\":3,\"@2\":\"d\",\"@3\":\"1234.56\",\"@4\":\"2024-03-05 10:20:30\"}}\n",
+      out.data);
+}
+
+void test_binlog_other_tables(void) {
+  feed_format_description();
+  feed_gtid(20);
+  feed_query("BEGIN", BINLOG_EVENT_OTHER);
+  feed_users_table_map(90, "orders", true);
+  buf_t b = {{0}, 0};
+  rows_header(&b, 90, false);
+  put_users_row(&b, 1, "x", false);
+  feed_ok(BINLOG_WRITE_ROWS_EVENT, &b, BINLOG_EVENT_OTHER);
+  // 其他表的事务同样结束，调用方据此推进游标
+  feed_xid(BINLOG_EVENT_COMMIT);
+  TEST_ASSERT_EQUAL_UINT64(20, dec.gno);
+  TEST_ASSERT_EQUAL_UINT(0, out.len);
+
+  // DDL 自成一个事务
+  feed_gtid(21);
+  feed_query("ALTER TABLE users ADD COLUMN note TEXT", BINLOG_EVENT_COMMIT);
+  TEST_ASSERT_EQUAL_UINT(0, out.len);
+
+  buf_t empty = {{0}, 0};
+  feed_ok(BINLOG_HEARTBEAT_EVENT_V2, &empty, BINLOG_EVENT_HEARTBEAT);
+
+  // 表结构在事务结束时清空，引用未知表的行事件不合法
+  binlog_event_kind_t kind;
+  TEST_ASSERT_EQUAL_INT(-1, feed(BINLOG_WRITE_ROWS_EVENT, &b, &kind));
+}
+
+void test_binlog_value_types(void) {
+  feed_format_description();
+  feed_gtid(30);
+
+  buf_t b = {{0}, 0};
+  put_u(&b, 7, 6);
+  put_u(&b, 1, 2);
+  put_lenenc_str(&b, "test");
+  put_u(&b, 0, 1);
+  put_lenenc_str(&b, "users");
+  put_u(&b, 0, 1);
+  unsigned char types[] = {MYSQL_TYPE_TINY,   MYSQL_TYPE_LONGLONG, MYSQL_TYPE_DOUBLE,
+                           MYSQL_TYPE_YEAR,   MYSQL_TYPE_DATE,     MYSQL_TYPE_TIME2,
+                           MYSQL_TYPE_STRING, MYSQL_TYPE_STRING,   MYSQL_TYPE_BLOB,
+                           MYSQL_TYPE_BIT,    MYSQL_TYPE_JSON,     MYSQL_TYPE_TIMESTAMP2};
+  put_u(&b, sizeof(types), 1);
+  put(&b, types, sizeof(types));
+  unsigned char meta[] = {
+      8,                     // DOUBLE
+      3,                     // TIME(3)
+      MYSQL_TYPE_STRING, 40, // CHAR(10) utf8mb4
+      MYSQL_TYPE_ENUM, 1,    // ENUM
+      2,                     // TEXT
+      2, 1,                  // BIT(10)
+      4,                     // JSON
+      6,                     // TIMESTAMP(6)
+  };
+  put_u(&b, sizeof(meta), 1);
+  put(&b, meta, sizeof(meta));
+  put_u(&b, 0, 2);
+  feed_ok(BINLOG_TABLE_MAP_EVENT, &b, BINLOG_EVENT_OTHER);
+
+  b.len = 0;
+  put_u(&b, 7, 6);
+  put_u(&b, 1, 2);
+  put_u(&b, 2, 2);
+  put_u(&b, sizeof(types), 1);
+  put_u(&b, 0xFFF, 2);
+  put_u(&b, 0, 2);
+  put_u(&b, 0xFF, 1);            // TINY -1
+  put_u(&b, (uint64_t)-42, 8);   // LONGLONG -42
+  double d = 1.5;
+  put(&b, &d, sizeof(d));        // DOUBLE
+  put_u(&b, 124, 1);             // YEAR 2024
+  put_u(&b, 2024 << 9 | 2 << 5 | 29, 3);
+  // TIME(3) -01:02:03.500：整数部分 -(1h 2m 4s) 加偏移，
+  // 小数部分以 1/10000 秒为单位，借位后为 10000 - 5000
+  int64_t hms = 1 << 12 | 2 << 6 | 4;
+  put_be(&b, (uint64_t)(0x800000 - hms), 3);
+  put_be(&b, (uint64_t)(0x10000 - 5000), 2);
+  put_u(&b, 2, 1);
+  put(&b, "ab", 2);              // CHAR
+  put_u(&b, 3, 1);               // ENUM 序号
+  put_u(&b, 3, 2);
+  put(&b, "t\nx", 3);            // TEXT
+  put_be(&b, 0x201, 2);          // BIT(10)
+  put_u(&b, 2, 4);
+  put(&b, "\x00\x01", 2);        // JSON
+  put_be(&b, 86400, 4);
+  put_be(&b, 123456, 3);         // TIMESTAMP(6)
+  feed_ok(BINLOG_WRITE_ROWS_EVENT, &b, BINLOG_EVENT_OTHER);
+  feed_xid(BINLOG_EVENT_COMMIT);
+
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"gtid\":\"" UUID_TEXT ":30\",\"table\":\"users\",\"type\":\"insert\",\"row\":"
+      "{\"@1\":-1,\"@2\":-42,\"@3\":1.5,\"@4\":2024,\"@5\":\"2024-02-29\","
+      "\"@6\":\"-01:02:03.500\",\"@7\":\"ab\",\"@8\":3,\"@9\":\"t\\nx\",\"@10\":513,"
+      "\"@11\":\"0001\",\"@12\":\"1970-01-02 00:00:00.123456\"}}\n",
+      out.data);
+}
+
+void test_binlog_malformed(void) {
+  feed_format_description();
+  feed_gtid(40);
+  binlog_event_kind_t kind;
+
+  // 事件比事件头还短
+  unsigned char short_event[10] = {0};
+  TEST_ASSERT_EQUAL_INT(-1, binlog_decode(&dec, short_event, sizeof(short_event), &out, &kind));
+
+  // 截断的 TABLE_MAP
+  buf_t b = {{0}, 0};
+  put_u(&b, 7, 6);
+  put_u(&b, 1, 2);
+  put_u(&b, 30, 1);
+  put(&b, "test", 4);
+  TEST_ASSERT_EQUAL_INT(-1, feed(BINLOG_TABLE_MAP_EVENT, &b, &kind));
+
+  // 行镜像比列定义短
+  feed_users_table_map(88, "users", true);
+  b.len = 0;
+  rows_header(&b, 88, false);
+  put_u(&b, 0, 1);
+  put_u(&b, 1, 4);
+  put_u(&b, 200, 2);
+  put(&b, "abc", 3);
+  TEST_ASSERT_EQUAL_INT(-1, feed(BINLOG_WRITE_ROWS_EVENT, &b, &kind));
+
+  // 压缩的事务不支持
+  b.len = 0;
+  put_u(&b, 0, 8);
+  TEST_ASSERT_EQUAL_INT(-1, feed(BINLOG_TRANSACTION_PAYLOAD_EVENT, &b, &kind));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_gtid_set_parse_format);
+  RUN_TEST(test_gtid_set_encode);
+  RUN_TEST(test_binlog_insert_update_delete);
+  RUN_TEST(test_binlog_other_tables);
+  RUN_TEST(test_binlog_value_types);
+  RUN_TEST(test_binlog_malformed);
+  return UNITY_END();
+}
@@ -0,0 +1,241 @@
+// clang-format off
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "src/bulk_load.h"
+#include "src/strbuf.h"
+// clang-format on
+
+static bulk_load_t *load = NULL;
+
+void setUp(void) {}
+
+void tearDown(void) {
+  bulk_load_destroy(load);
+  load = NULL;
+}
+
+/**
+ * @brief 逐字节送入，检验跨分片的记录
+ */
+static int feed_bytes(const char *data) {
+  for (const char *p = data; *p; ++p) {
+    if (bulk_load_feed(load, p, 1) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief 取出全部批次，按成功记录，返回批次数
+ */
+static int take_all(bulk_batch_t *batches, int max) {
+  int n = 0;
+  bulk_batch_t batch;
+  while (n < max && bulk_load_take(load, &batch)) {
+    batches[n] = batch;
+    batches[n].sql = strdup(batch.sql);
+    bulk_load_record(load, &batch, (long long)batch.rows, NULL);
+    ++n;
+  }
+  return n;
+}
+
+static void free_batches(bulk_batch_t *batches, int n) {
+  for (int i = 0; i < n; ++i) {
+    free(batches[i].sql);
+  }
+}
+
+void test_bulk_format_from_content_type(void) {
+  bulk_format_t format;
+  TEST_ASSERT_EQUAL_INT(0, bulk_format_from_content_type("text/csv", &format));
+  TEST_ASSERT_EQUAL_INT(BULK_FORMAT_CSV, format);
+  TEST_ASSERT_EQUAL_INT(0, bulk_format_from_content_type("Text/CSV; charset=utf-8", &format));
+  TEST_ASSERT_EQUAL_INT(BULK_FORMAT_CSV, format);
+  TEST_ASSERT_EQUAL_INT(0, bulk_format_from_content_type("application/x-ndjson", &format));
+  TEST_ASSERT_EQUAL_INT(BULK_FORMAT_NDJSON, format);
+  TEST_ASSERT_EQUAL_INT(-1, bulk_format_from_content_type("application/json", &format));
+  TEST_ASSERT_EQUAL_INT(-1, bulk_format_from_content_type("text/csvx", &format));
+  TEST_ASSERT_EQUAL_INT(-1, bulk_format_from_content_type(NULL, &format));
+}
+
+void test_bulk_load_csv(void) {
+  load = bulk_load_create("users", BULK_FORMAT_CSV);
+  TEST_ASSERT_NOT_NULL(load);
+  // 引号内的逗号、换行和 ""，CRLF 行尾，不加引号的 \N 为 NULL，加引号的 "\N" 是字符串
+  TEST_ASSERT_EQUAL_INT(0, feed_bytes("id,name,note\r\n"
+                                      "1,\"Smith, \"\"J\"\"\",\\N\r\n"
+                                      "\n"
+                                      "2,O'Brien,\"two\nlines\"\r\n"
+                                      "3,x\\y,\"\\N\""));
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_finish(load));
+
+  bulk_batch_t batches[4];
+  TEST_ASSERT_EQUAL_INT(1, take_all(batches, 4));
+  TEST_ASSERT_EQUAL_STRING("INSERT INTO users (`id`, `name`, `note`) VALUES "
+                           "('1', 'Smith, \"J\"', NULL), "
+                           "('2', 'O''Brien', 'two\nlines'), "
+                           "('3', 'x\\\\y', '\\\\N')",
+                           batches[0].sql);
+  TEST_ASSERT_EQUAL_size_t(1, batches[0].first_row);
+  TEST_ASSERT_EQUAL_size_t(3, batches[0].rows);
+  TEST_ASSERT_EQUAL_size_t(3, load->rows_inserted);
+  free_batches(batches, 1);
+
+  strbuf_t out;
+  strbuf_init(&out);
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_summary(load, 1000000, &out));
+  TEST_ASSERT_EQUAL_STRING("success: Inserted 3 of 3 row(s) in 1 batch(es), 0 failed, 3 rows/s\n",
+                           out.data);
+  strbuf_free(&out);
+}
+
+void test_bulk_load_csv_rejects(void) {
+  load = bulk_load_create("t", BULK_FORMAT_CSV);
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_feed(load, "a,b\n1,2\n3\n4,\"x\"y\n5,6\n", 21));
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_finish(load));
+
+  bulk_batch_t batches[4];
+  TEST_ASSERT_EQUAL_INT(1, take_all(batches, 4));
+  TEST_ASSERT_EQUAL_STRING("INSERT INTO t (`a`, `b`) VALUES ('1', '2'), ('5', '6')",
+                           batches[0].sql);
+  free_batches(batches, 1);
+
+  strbuf_t out;
+  strbuf_init(&out);
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_summary(load, 0, &out));
+  TEST_ASSERT_EQUAL_STRING("error: Inserted 2 of 4 row(s) in 1 batch(es), 0 failed, 0 rows/s\n"
+                           "row 2: expected 2 field(s), found 1\n"
+                           "row 3: malformed CSV record\n",
+                           out.data);
+  strbuf_free(&out);
+}
+
+void test_bulk_load_csv_header(void) {
+  load = bulk_load_create("t", BULK_FORMAT_CSV);
+  TEST_ASSERT_EQUAL_INT(-1, bulk_load_feed(load, "a,b,a\n", 6));
+  TEST_ASSERT_EQUAL_STRING("Duplicate column a", load->fatal);
+  bulk_load_destroy(load);
+
+  load = bulk_load_create("t", BULK_FORMAT_CSV);
+  TEST_ASSERT_EQUAL_INT(-1, bulk_load_finish(load));
+  TEST_ASSERT_EQUAL_STRING("Missing CSV header", load->fatal);
+  bulk_load_destroy(load);
+
+  load = bulk_load_create("t", BULK_FORMAT_CSV);
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_feed(load, "a\n\"open", 7));
+  TEST_ASSERT_EQUAL_INT(-1, bulk_load_finish(load));
+  TEST_ASSERT_EQUAL_STRING("Unterminated quoted field in row 1", load->fatal);
+}
+
+void test_bulk_load_ndjson(void) {
+  load = bulk_load_create("t", BULK_FORMAT_NDJSON);
+  TEST_ASSERT_EQUAL_INT(0, feed_bytes("{\"id\": 1, \"name\": \"a'b\", \"score\": 1.5e3}\n"
+                                      "{\"name\": \"\\u00e9\", \"id\": 2}\n"
+                                      "{\"id\": 3, \"nick\": \"x\"}\n"
+                                      "{\"id\": 4, \"id\": 5}\n"
+                                      "not json\n"
+                                      "{\"id\": null, \"score\": false, \"name\": \"z\"}"));
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_finish(load));
+
+  bulk_batch_t batches[4];
+  TEST_ASSERT_EQUAL_INT(1, take_all(batches, 4));
+  // 缺少的列写 DEFAULT，数字保持原文
+  TEST_ASSERT_EQUAL_STRING("INSERT INTO t (`id`, `name`, `score`) VALUES "
+                           "(1, 'a''b', 1.5e3), (2, '\xc3\xa9', DEFAULT), (NULL, 'z', 0)",
+                           batches[0].sql);
+  TEST_ASSERT_EQUAL_size_t(3, batches[0].rows);
+  free_batches(batches, 1);
+
+  strbuf_t out;
+  strbuf_init(&out);
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_summary(load, 0, &out));
+  TEST_ASSERT_EQUAL_STRING("error: Inserted 3 of 6 row(s) in 1 batch(es), 0 failed, 0 rows/s\n"
+                           "row 3: unknown column nick\n"
+                           "row 4: duplicate column id\n"
+                           "row 5: expected object at offset 0\n",
+                           out.data);
+  strbuf_free(&out);
+}
+
+void test_bulk_load_batches(void) {
+  // 按行数和语句长度切分批次，行号连续
+  load = bulk_load_create("t", BULK_FORMAT_CSV);
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_feed(load, "v\n", 2));
+  size_t total = BULK_LOAD_BATCH_ROWS + 10;
+  for (size_t i = 0; i < total; ++i) {
+    TEST_ASSERT_EQUAL_INT(0, bulk_load_feed(load, "x\n", 2));
+  }
+  // 每行约 100 KB，十几行就超过语句长度上限
+  size_t wide = 100 * 1024;
+  char *row = malloc(wide + 1);
+  memset(row, 'y', wide);
+  row[wide] = '\n';
+  for (int i = 0; i < 15; ++i) {
+    TEST_ASSERT_EQUAL_INT(0, bulk_load_feed(load, row, wide + 1));
+  }
+  free(row);
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_finish(load));
+
+  bulk_batch_t batches[8];
+  int n = take_all(batches, 8);
+  TEST_ASSERT_TRUE(n >= 3);
+  TEST_ASSERT_EQUAL_size_t(1, batches[0].first_row);
+  TEST_ASSERT_EQUAL_size_t(BULK_LOAD_BATCH_ROWS, batches[0].rows);
+  size_t next = 1;
+  for (int i = 0; i < n; ++i) {
+    TEST_ASSERT_EQUAL_size_t(next, batches[i].first_row);
+    TEST_ASSERT_TRUE(strlen(batches[i].sql) <= BULK_LOAD_BATCH_BYTES);
+    next += batches[i].rows;
+  }
+  TEST_ASSERT_EQUAL_size_t(total + 15 + 1, next);
+  free_batches(batches, n);
+}
+
+void test_bulk_load_batch_error(void) {
+  load = bulk_load_create("t", BULK_FORMAT_CSV);
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_feed(load, "v\n1\n2\n", 6));
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_finish(load));
+  bulk_batch_t batch;
+  TEST_ASSERT_TRUE(bulk_load_take(load, &batch));
+  bulk_load_record(load, &batch, -1, "Duplicate entry '1' for key 'PRIMARY'");
+  TEST_ASSERT_FALSE(bulk_load_take(load, &batch));
+
+  strbuf_t out;
+  strbuf_init(&out);
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_summary(load, 0, &out));
+  TEST_ASSERT_EQUAL_STRING("error: Inserted 0 of 2 row(s) in 1 batch(es), 1 failed, 0 rows/s\n"
+                           "rows 1-2: Duplicate entry '1' for key 'PRIMARY'\n",
+                           out.data);
+  strbuf_free(&out);
+}
+
+void test_bulk_load_record_limit(void) {
+  load = bulk_load_create("t", BULK_FORMAT_NDJSON);
+  size_t len = BULK_LOAD_MAX_RECORD + 1;
+  char *data = malloc(len);
+  memset(data, ' ', len);
+  TEST_ASSERT_EQUAL_INT(-1, bulk_load_feed(load, data, len));
+  free(data);
+  TEST_ASSERT_TRUE(load->failed);
+  // 之后的数据不再接收
+  TEST_ASSERT_EQUAL_INT(-1, bulk_load_feed(load, "\n", 1));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_bulk_format_from_content_type);
+  RUN_TEST(test_bulk_load_csv);
+  RUN_TEST(test_bulk_load_csv_rejects);
+  RUN_TEST(test_bulk_load_csv_header);
+  RUN_TEST(test_bulk_load_ndjson);
+  RUN_TEST(test_bulk_load_batches);
+  RUN_TEST(test_bulk_load_batch_error);
+  RUN_TEST(test_bulk_load_record_limit);
+
+  return UNITY_END();
+}
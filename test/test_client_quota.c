@@ -0,0 +1,205 @@
+// clang-format off
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "unity.h"
+#include "src/client_quota.h"
+// clang-format on
+
+static client_quota_t quota;
+static client_quota_slot_t *slot;
+static unsigned int retry_after_sec;
+
+void setUp(void) {}
+
+void tearDown(void) { client_quota_destroy(&quota); }
+
+static client_quota_result_t enter(const char *id, uint64_t now_us) {
+  return client_quota_enter(&quota, id, now_us, &slot, &retry_after_sec);
+}
+
+void test_client_quota_rate(void) {
+  // 每秒 10 个、桶容量 3：空闲后可以连发 3 个，之后每 100ms 补充一个
+  TEST_ASSERT_EQUAL_INT(0, client_quota_init(&quota, 10, 3, 0));
+  uint64_t now_us = 1000000;
+  for (int i = 0; i < 3; ++i) {
+    TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("10.0.0.1", now_us));
+    client_quota_leave(slot);
+  }
+  client_quota_slot_t *first = slot;
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_RATE_LIMITED, enter("10.0.0.1", now_us));
+  TEST_ASSERT_NULL(slot);
+  TEST_ASSERT_EQUAL_UINT(1, retry_after_sec);
+
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("10.0.0.1", now_us + 100000));
+  TEST_ASSERT_TRUE(slot == first);
+  client_quota_leave(slot);
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_RATE_LIMITED, enter("10.0.0.1", now_us + 100000));
+
+  // 其他客户端有自己的令牌桶
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("10.0.0.2", now_us));
+  TEST_ASSERT_TRUE(slot != first);
+  client_quota_leave(slot);
+
+  TEST_ASSERT_EQUAL_UINT64(4, atomic_load(&first->admitted));
+  TEST_ASSERT_EQUAL_UINT64(2, atomic_load(&first->rate_limited));
+  TEST_ASSERT_EQUAL_INT(0, atomic_load(&first->active));
+}
+
+void test_client_quota_slow_rate(void) {
+  // 每 4 秒一个：被拒绝时建议等到下一个令牌
+  TEST_ASSERT_EQUAL_INT(0, client_quota_init(&quota, 0.25, 0, 0));
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("10.0.0.1", 0));
+  client_quota_leave(slot);
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_RATE_LIMITED, enter("10.0.0.1", 500000));
+  TEST_ASSERT_EQUAL_UINT(4, retry_after_sec);
+}
+
+void test_client_quota_concurrency(void) {
+  TEST_ASSERT_EQUAL_INT(0, client_quota_init(&quota, 0, 0, 2));
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("key-1", 0));
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("key-1", 0));
+  client_quota_slot_t *held = slot;
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_CONCURRENCY_LIMITED, enter("key-1", 0));
+  TEST_ASSERT_EQUAL_UINT(CLIENT_QUOTA_RETRY_AFTER_SEC, retry_after_sec);
+  TEST_ASSERT_EQUAL_INT(2, atomic_load(&held->active));
+
+  client_quota_leave(held);
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("key-1", 0));
+  TEST_ASSERT_EQUAL_UINT64(1, atomic_load(&held->concurrency_limited));
+}
+
+void test_client_quota_id(void) {
+  TEST_ASSERT_EQUAL_INT(0, client_quota_init(&quota, 0, 0, 1));
+  char id[CLIENT_QUOTA_ID_LEN + 1];
+  struct sockaddr_in addr4 = {.sin_family = AF_INET};
+  inet_pton(AF_INET, "192.168.1.7", &addr4.sin_addr);
+  TEST_ASSERT_EQUAL_INT(0,
+                        client_quota_id(&quota, NULL, (struct sockaddr *)&addr4, id, sizeof(id)));
+  TEST_ASSERT_EQUAL_STRING("192.168.1.7", id);
+
+  struct sockaddr_in6 addr6 = {.sin6_family = AF_INET6};
+  inet_pton(AF_INET6, "::1", &addr6.sin6_addr);
+  TEST_ASSERT_EQUAL_INT(0, client_quota_id(&quota, "", (struct sockaddr *)&addr6, id, sizeof(id)));
+  TEST_ASSERT_EQUAL_STRING("::1", id);
+
+  // 没有配置 Key 时请求头被忽略，客户端不能靠换 Key 得到新的配额
+  TEST_ASSERT_EQUAL_INT(
+      0, client_quota_id(&quota, "secret", (struct sockaddr *)&addr4, id, sizeof(id)));
+  TEST_ASSERT_EQUAL_STRING("192.168.1.7", id);
+
+  char path[] = "/tmp/test_client_keys_XXXXXX";
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  FILE *file = fdopen(fd, "w");
+  fputs("# 每行一个\nsecret\n\nother\r\n", file);
+  fclose(file);
+  TEST_ASSERT_EQUAL_INT(0, client_quota_load_keys(&quota, path));
+  unlink(path);
+  TEST_ASSERT_EQUAL_size_t(2, quota.num_keys);
+  TEST_ASSERT_EQUAL_INT(-1, client_quota_load_keys(&quota, path));
+
+  // 已知的 API Key 优先于地址，指标里只出现摘要
+  TEST_ASSERT_EQUAL_INT(
+      0, client_quota_id(&quota, "secret", (struct sockaddr *)&addr4, id, sizeof(id)));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(id, "key-", 4));
+  TEST_ASSERT_NULL(strstr(id, "secret"));
+  TEST_ASSERT_EQUAL_INT(
+      0, client_quota_id(&quota, "other", (struct sockaddr *)&addr4, id, sizeof(id)));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(id, "key-", 4));
+  TEST_ASSERT_EQUAL_INT(
+      0, client_quota_id(&quota, "guess", (struct sockaddr *)&addr4, id, sizeof(id)));
+  TEST_ASSERT_EQUAL_STRING("192.168.1.7", id);
+
+  TEST_ASSERT_EQUAL_INT(0, client_quota_id(&quota, NULL, NULL, id, sizeof(id)));
+  TEST_ASSERT_EQUAL_STRING("unknown", id);
+}
+
+void test_client_quota_overflow(void) {
+  TEST_ASSERT_EQUAL_INT(0, client_quota_init(&quota, 0, 0, 1));
+  char id[32];
+  client_quota_slot_t *held[CLIENT_QUOTA_SLOTS];
+  for (int i = 0; i < CLIENT_QUOTA_SLOTS; ++i) {
+    snprintf(id, sizeof(id), "client-%d", i);
+    TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter(id, 0));
+    TEST_ASSERT_TRUE(slot != &quota.overflow);
+    held[i] = slot;
+  }
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_CONCURRENCY_LIMITED, enter("client-0", 0));
+
+  // 槽位用完且都在忙时，新客户端共用一个配额
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("late-a", 0));
+  TEST_ASSERT_TRUE(slot == &quota.overflow);
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_CONCURRENCY_LIMITED, enter("late-b", 0));
+  client_quota_leave(&quota.overflow);
+
+  // 空闲的客户端让出槽位，之后再来时重新登记
+  client_quota_leave(held[0]);
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("late-b", 0));
+  TEST_ASSERT_TRUE(slot == held[0]);
+  TEST_ASSERT_EQUAL_STRING("late-b", slot->id);
+  TEST_ASSERT_EQUAL_UINT64(1, atomic_load(&slot->admitted));
+  TEST_ASSERT_EQUAL_UINT64(0, atomic_load(&slot->concurrency_limited));
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("client-0", 0));
+  TEST_ASSERT_TRUE(slot == &quota.overflow);
+  client_quota_leave(slot);
+
+  for (int i = 0; i < CLIENT_QUOTA_SLOTS; ++i) {
+    client_quota_leave(held[i]);
+  }
+}
+
+void test_client_quota_reclaim_rate(void) {
+  // 令牌没有补满的客户端不让出槽位，否则换一个桶就能绕过速率限制
+  TEST_ASSERT_EQUAL_INT(0, client_quota_init(&quota, 1, 1, 0));
+  char id[32];
+  for (int i = 0; i < CLIENT_QUOTA_SLOTS; ++i) {
+    snprintf(id, sizeof(id), "client-%d", i);
+    TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter(id, 0));
+    client_quota_leave(slot);
+  }
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("late", 500000));
+  TEST_ASSERT_TRUE(slot == &quota.overflow);
+  client_quota_leave(slot);
+
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("later", 1000000));
+  TEST_ASSERT_TRUE(slot != &quota.overflow);
+  client_quota_leave(slot);
+}
+
+void test_client_quota_render(void) {
+  TEST_ASSERT_EQUAL_INT(0, client_quota_init(&quota, 0, 0, 1));
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_OK, enter("10.0.0.1", 0));
+  client_quota_slot_t *held = slot;
+  TEST_ASSERT_EQUAL_INT(CLIENT_QUOTA_CONCURRENCY_LIMITED, enter("10.0.0.1", 0));
+
+  strbuf_t out;
+  strbuf_init(&out);
+  TEST_ASSERT_EQUAL_INT(0, client_quota_render(&quota, &out));
+  TEST_ASSERT_NOT_NULL(
+      strstr(out.data, "dbmanager_client_requests_total{client=\"10.0.0.1\"} 1\n"));
+  TEST_ASSERT_NOT_NULL(
+      strstr(out.data, "dbmanager_client_concurrency_limited_total{client=\"10.0.0.1\"} 1\n"));
+  TEST_ASSERT_NOT_NULL(
+      strstr(out.data, "dbmanager_client_active_requests{client=\"10.0.0.1\"} 1\n"));
+  TEST_ASSERT_NULL(strstr(out.data, "client=\"other\""));
+  strbuf_free(&out);
+  client_quota_leave(held);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_client_quota_rate);
+  RUN_TEST(test_client_quota_slow_rate);
+  RUN_TEST(test_client_quota_concurrency);
+  RUN_TEST(test_client_quota_id);
+  RUN_TEST(test_client_quota_overflow);
+  RUN_TEST(test_client_quota_reclaim_rate);
+  RUN_TEST(test_client_quota_render);
+
+  return UNITY_END();
+}
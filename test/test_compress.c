@@ -0,0 +1,145 @@
+// clang-format off
+#include <stdbool.h>
+#include <zlib.h>
+#include <zstd.h>
+#include "unity.h"
+#include "src/compress.h"
+// clang-format on
+
+static strbuf_t out;
+static strbuf_t plain;
+
+void setUp(void) {
+  strbuf_init(&out);
+  strbuf_init(&plain);
+  // 模拟定宽文本表格
+  for (int i = 0; i < 2000; ++i) {
+    strbuf_appendf(&plain, "%-15d%-15s%-15d\n", i, "Alice", 20 + i % 50);
+  }
+}
+
+void tearDown(void) {
+  strbuf_free(&out);
+  strbuf_free(&plain);
+}
+
+/**
+ * @brief 解压 gzip 数据
+ */
+static int gunzip(const strbuf_t *in, strbuf_t *result) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+    return -1;
+  }
+  zs.next_in = (Bytef *)in->data;
+  zs.avail_in = (uInt)in->len;
+  int ret;
+  do {
+    strbuf_reserve(result, 16384);
+    zs.next_out = (Bytef *)result->data + result->len;
+    zs.avail_out = 16384;
+    ret = inflate(&zs, Z_NO_FLUSH);
+    result->len += 16384 - zs.avail_out;
+  } while (ret == Z_OK);
+  inflateEnd(&zs);
+  return ret == Z_STREAM_END ? 0 : -1;
+}
+
+/**
+ * @brief 解压 zstd 数据
+ */
+static int unzstd(const strbuf_t *in, strbuf_t *result) {
+  ZSTD_DStream *zds = ZSTD_createDStream();
+  ZSTD_initDStream(zds);
+  ZSTD_inBuffer input = {in->data, in->len, 0};
+  size_t ret = 1;
+  while (input.pos < input.size) {
+    strbuf_reserve(result, 16384);
+    ZSTD_outBuffer output = {result->data + result->len, 16384, 0};
+    ret = ZSTD_decompressStream(zds, &output, &input);
+    result->len += output.pos;
+    if (ZSTD_isError(ret)) {
+      break;
+    }
+  }
+  ZSTD_freeDStream(zds);
+  return ret == 0 ? 0 : -1;
+}
+
+void test_content_encoding_negotiate(void) {
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_IDENTITY, content_encoding_negotiate(NULL));
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_IDENTITY, content_encoding_negotiate("br, deflate"));
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_GZIP, content_encoding_negotiate("deflate, gzip"));
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_ZSTD, content_encoding_negotiate("gzip, zstd"));
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_GZIP, content_encoding_negotiate("zstd;q=0, GZIP;q=0.5"));
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_GZIP, content_encoding_negotiate("*"));
+  // 显式拒绝的编码不会因为 "*" 被重新选中
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_IDENTITY, content_encoding_negotiate("gzip;q=0, *"));
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_IDENTITY, content_encoding_negotiate("*, gzip;q=0"));
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_IDENTITY, content_encoding_negotiate("*;q=0"));
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_GZIP, content_encoding_negotiate("zstd;q=0, *"));
+  TEST_ASSERT_EQUAL_INT(CONTENT_ENCODING_IDENTITY, content_encoding_negotiate("gzipx, xzstd"));
+}
+
+void test_compress_buffer_gzip(void) {
+  TEST_ASSERT_EQUAL_INT(0, compress_buffer(CONTENT_ENCODING_GZIP, plain.data, plain.len, &out));
+  TEST_ASSERT_LESS_THAN(plain.len / 5, out.len);
+
+  strbuf_t result;
+  strbuf_init(&result);
+  TEST_ASSERT_EQUAL_INT(0, gunzip(&out, &result));
+  TEST_ASSERT_EQUAL_size_t(plain.len, result.len);
+  TEST_ASSERT_EQUAL_MEMORY(plain.data, result.data, plain.len);
+  strbuf_free(&result);
+}
+
+void test_compress_buffer_zstd(void) {
+  TEST_ASSERT_EQUAL_INT(0, compress_buffer(CONTENT_ENCODING_ZSTD, plain.data, plain.len, &out));
+  TEST_ASSERT_LESS_THAN(plain.len / 5, out.len);
+
+  strbuf_t result;
+  strbuf_init(&result);
+  TEST_ASSERT_EQUAL_INT(0, unzstd(&out, &result));
+  TEST_ASSERT_EQUAL_size_t(plain.len, result.len);
+  TEST_ASSERT_EQUAL_MEMORY(plain.data, result.data, plain.len);
+  strbuf_free(&result);
+}
+
+void test_compressor_streaming(void) {
+  // 分块写入并逐块刷新，与流式响应的用法一致
+  content_encoding_t encodings[] = {CONTENT_ENCODING_GZIP, CONTENT_ENCODING_ZSTD};
+  for (size_t e = 0; e < sizeof(encodings) / sizeof(encodings[0]); ++e) {
+    compressor_t *compressor = compressor_create(encodings[e]);
+    TEST_ASSERT_NOT_NULL(compressor);
+
+    strbuf_reset(&out);
+    size_t block = 4096;
+    for (size_t off = 0; off < plain.len; off += block) {
+      size_t len = plain.len - off < block ? plain.len - off : block;
+      bool last = off + len == plain.len;
+      TEST_ASSERT_EQUAL_INT(0, compressor_write(compressor, plain.data + off, len,
+                                                last ? COMPRESS_END : COMPRESS_FLUSH, &out));
+    }
+    compressor_destroy(compressor);
+
+    strbuf_t result;
+    strbuf_init(&result);
+    int rc = encodings[e] == CONTENT_ENCODING_GZIP ? gunzip(&out, &result) : unzstd(&out, &result);
+    TEST_ASSERT_EQUAL_INT(0, rc);
+    TEST_ASSERT_EQUAL_size_t(plain.len, result.len);
+    TEST_ASSERT_EQUAL_MEMORY(plain.data, result.data, plain.len);
+    strbuf_free(&result);
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_content_encoding_negotiate);
+  RUN_TEST(test_compress_buffer_gzip);
+  RUN_TEST(test_compress_buffer_zstd);
+  RUN_TEST(test_compressor_streaming);
+
+  return UNITY_END();
+}
@@ -1,8 +1,10 @@
 // clang-format off
+#include <stdio.h>
 #include <time.h>
 #include <unistd.h>
 #include "unity.h"
 #include "db_test_utils.h"
+#include "src/clock.h"
 #include "src/connection_pool.h"
 // clang-format on
 
@@ -76,6 +78,33 @@ void test_multiple_connections(void) {
   TEST_ASSERT_EQUAL_INT(0, test_pool->active_connections);
 }
 
+void test_get_connection_until_timeout(void) {
+  TEST_ASSERT_NOT_NULL(test_pool);
+
+  mysql_connection_t *conns[3];
+  for (size_t i = 0; i < MAX_POOL_SIZE; ++i) {
+    conns[i] = get_connection(test_pool);
+    TEST_ASSERT_NOT_NULL(conns[i]);
+  }
+
+  // 没有空闲连接，等到截止时间后返回 NULL
+  uint64_t start_us = clock_now_us();
+  mysql_connection_t *conn = get_connection_until(test_pool, start_us + 50 * 1000);
+  TEST_ASSERT_NULL(conn);
+  TEST_ASSERT_GREATER_OR_EQUAL(50 * 1000, clock_now_us() - start_us);
+  TEST_ASSERT_EQUAL_INT(0, test_pool->waiters);
+
+  // 有空闲连接时截止时间不影响获取
+  release_connection(test_pool, conns[0]);
+  conn = get_connection_until(test_pool, clock_now_us() + 50 * 1000);
+  TEST_ASSERT_EQUAL_PTR(conns[0], conn);
+
+  for (size_t i = 0; i < MAX_POOL_SIZE; ++i) {
+    release_connection(test_pool, conns[i]);
+  }
+  TEST_ASSERT_EQUAL_INT(0, test_pool->active_connections);
+}
+
 void test_check_connection_health(void) {
   TEST_ASSERT_NOT_NULL(test_pool);
 
@@ -88,6 +117,57 @@ void test_check_connection_health(void) {
   release_connection(test_pool, conn);
 }
 
+void test_connection_stmt_cache(void) {
+  TEST_ASSERT_NOT_NULL(test_pool);
+
+  mysql_connection_t *conn = get_connection(test_pool);
+  TEST_ASSERT_NOT_NULL(conn);
+  unsigned int error_no = 0;
+  char error_msg[256];
+
+  // 相同的语句只准备一次
+  MYSQL_STMT *stmt = stmt_cache_prepare(&conn->stmts, conn->mysql_conn, "SELECT ?", &error_no,
+                                        error_msg, sizeof(error_msg));
+  TEST_ASSERT_NOT_NULL(stmt);
+  TEST_ASSERT_EQUAL_PTR(stmt, stmt_cache_prepare(&conn->stmts, conn->mysql_conn, "SELECT ?",
+                                                 &error_no, error_msg, sizeof(error_msg)));
+  connection_pool_stats_t stats;
+  connection_pool_stats(test_pool, &stats);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.stmts.hits);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.stmts.misses);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.stmts.prepares);
+  TEST_ASSERT_TRUE(stats.stmts.hit_ratio == 0.5);
+
+  // 缓存满了之后关闭最久未用的语句
+  char sql[64];
+  for (int i = 0; i < STMT_CACHE_CAPACITY; ++i) {
+    snprintf(sql, sizeof(sql), "SELECT ? + %d", i);
+    TEST_ASSERT_NOT_NULL(stmt_cache_prepare(&conn->stmts, conn->mysql_conn, sql, &error_no,
+                                            error_msg, sizeof(error_msg)));
+  }
+  TEST_ASSERT_EQUAL_size_t(STMT_CACHE_CAPACITY, conn->stmts.count);
+  connection_pool_stats(test_pool, &stats);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.stmts.evictions);
+  TEST_ASSERT_NOT_NULL(stmt_cache_prepare(&conn->stmts, conn->mysql_conn, "SELECT ?", &error_no,
+                                          error_msg, sizeof(error_msg)));
+  connection_pool_stats(test_pool, &stats);
+  TEST_ASSERT_EQUAL_UINT64(STMT_CACHE_CAPACITY + 2, stats.stmts.misses);
+
+  // 准备失败的语句不进缓存
+  TEST_ASSERT_NULL(stmt_cache_prepare(&conn->stmts, conn->mysql_conn, "SELEC ?", &error_no,
+                                      error_msg, sizeof(error_msg)));
+  TEST_ASSERT_NOT_EQUAL(0, error_no);
+  TEST_ASSERT_EQUAL_size_t(STMT_CACHE_CAPACITY, conn->stmts.count);
+
+  // 连接重建时全部作废
+  stmt_cache_clear(&conn->stmts);
+  connection_pool_stats(test_pool, &stats);
+  TEST_ASSERT_EQUAL_UINT64(STMT_CACHE_CAPACITY, stats.stmts.invalidations);
+  TEST_ASSERT_EQUAL_size_t(0, conn->stmts.count);
+
+  release_connection(test_pool, conn);
+}
+
 void test_destroy_connection_pool(void) {
   TEST_ASSERT_NOT_NULL(test_pool);
 
@@ -108,7 +188,9 @@ int main(void) {
   RUN_TEST(test_get_and_release_connection);
   RUN_TEST(test_get_connection_from_shutdown_pool);
   RUN_TEST(test_multiple_connections);
+  RUN_TEST(test_get_connection_until_timeout);
   RUN_TEST(test_check_connection_health);
+  RUN_TEST(test_connection_stmt_cache);
   RUN_TEST(test_destroy_connection_pool);
 
   return UNITY_END();
@@ -1,6 +1,10 @@
 // clang-format off
+#include <stdio.h>
+#include <string.h>
 #include "unity.h"
 #include "db_test_utils.h"
+#include "src/bulk_load.h"
+#include "src/clock.h"
 #include "src/db_manager.h"
 // clang-format on
 
@@ -25,7 +29,6 @@ void test_db_manager_init_success(void) {
   TEST_ASSERT_NOT_NULL(test_manager);
   TEST_ASSERT_NOT_NULL(test_manager->conn_pool);
   TEST_ASSERT_EQUAL_INT(DB_MAX_RETRIES, test_manager->max_retries);
-  TEST_ASSERT_NULL(test_manager->last_error);
 }
 
 void test_db_manager_create_row_success(void) {
@@ -60,7 +63,7 @@ void test_db_manager_read_row_success(void) {
   TEST_ASSERT_NOT_NULL(test_manager);
 
   // 读取所有记录
-  db_result_t *result = db_manager_read_row(test_manager, TEST_TABLE, NULL);
+  db_result_t *result = db_manager_read_row(test_manager, TEST_TABLE, NULL, NULL);
   TEST_ASSERT_NOT_NULL(result);
   TEST_ASSERT_EQUAL_INT(3, result->num_rows); // 初始有3条记录
 
@@ -69,7 +72,7 @@ void test_db_manager_read_row_success(void) {
   }
 
   // 带条件读取
-  result = db_manager_read_row(test_manager, TEST_TABLE, "name='Alice'");
+  result = db_manager_read_row(test_manager, TEST_TABLE, "name='Alice'", NULL);
   TEST_ASSERT_NOT_NULL(result);
   TEST_ASSERT_EQUAL_INT(1, result->num_rows); // 只有1条记录满足条件
 
@@ -78,11 +81,217 @@ void test_db_manager_read_row_success(void) {
   }
 }
 
+void test_db_manager_read_row_options(void) {
+  TEST_ASSERT_NOT_NULL(test_manager);
+
+  // 只取两列，按年龄倒序取前两行
+  read_options_t options = {.columns = "name, `AGE`", .order_by = "age DESC", .limit = 2};
+  db_result_t *result = db_manager_read_row(test_manager, TEST_TABLE, NULL, &options);
+  TEST_ASSERT_NOT_NULL(result);
+  if (result) {
+    TEST_ASSERT_EQUAL_INT(2, result->num_rows);
+    TEST_ASSERT_EQUAL_INT(2, result->num_fields);
+    MYSQL_ROW row = mysql_fetch_row(result->mysql_res);
+    TEST_ASSERT_EQUAL_STRING("Charlie", row[0]);
+    TEST_ASSERT_EQUAL_STRING("35", row[1]);
+    db_result_free(result);
+  }
+
+  // 列名和排序按表结构校验，不会拼进语句
+  options = (read_options_t){.columns = "name, password"};
+  TEST_ASSERT_NULL(db_manager_read_row(test_manager, TEST_TABLE, NULL, &options));
+  TEST_ASSERT_NOT_NULL(strstr(db_manager_last_error(test_manager), "password"));
+  options = (read_options_t){.order_by = "age; DROP TABLE test_users"};
+  TEST_ASSERT_NULL(db_manager_read_row(test_manager, TEST_TABLE, NULL, &options));
+  options = (read_options_t){.order_by = "age sideways"};
+  TEST_ASSERT_NULL(db_manager_read_row(test_manager, TEST_TABLE, NULL, &options));
+  TEST_ASSERT_EQUAL_INT(0, test_manager->conn_pool->active_connections);
+}
+
+static int count_row_callback(void *ctx, const db_cursor_t *cursor, MYSQL_ROW row,
+                              const unsigned long *lengths) {
+  (void)cursor;
+  (void)lengths;
+  int *count = (int *)ctx;
+  if (row[0] != NULL) {
+    ++(*count);
+  }
+  return 0;
+}
+
+void test_db_manager_read_row_each_success(void) {
+  TEST_ASSERT_NOT_NULL(test_manager);
+
+  // 流式读取所有记录
+  int count = 0;
+  long long result =
+      db_manager_read_row_each(test_manager, TEST_TABLE, NULL, count_row_callback, &count);
+  TEST_ASSERT_EQUAL_INT(3, result);
+  TEST_ASSERT_EQUAL_INT(3, count);
+
+  // 带条件流式读取
+  count = 0;
+  result = db_manager_read_row_each(test_manager, TEST_TABLE, "name='Alice'", count_row_callback,
+                                    &count);
+  TEST_ASSERT_EQUAL_INT(1, result);
+  TEST_ASSERT_EQUAL_INT(1, count);
+
+  // 游标关闭后连接已归还
+  TEST_ASSERT_EQUAL_INT(0, test_manager->conn_pool->active_connections);
+}
+
+/**
+ * @brief 读完一页，返回行数，next_page 复制到 token（没有下一页时为空串）
+ */
+static int read_page(const char *where, const char *page_token, char *token, size_t size,
+                     char *names) {
+  read_options_t options = {.page_size = 2, .page_token = page_token};
+  db_cursor_t *cursor = db_manager_read_open(test_manager, TEST_TABLE, where, &options);
+  if (!cursor) {
+    return -1;
+  }
+  int count = 0;
+  MYSQL_ROW row;
+  unsigned long *lengths;
+  names[0] = '\0';
+  while ((row = db_cursor_fetch(cursor, &lengths)) != NULL) {
+    strcat(names, row[1]);
+    strcat(names, ",");
+    ++count;
+  }
+  snprintf(token, size, "%s", cursor->next_page ? cursor->next_page : "");
+  db_cursor_close(cursor);
+  return count;
+}
+
+void test_db_manager_read_pages(void) {
+  TEST_ASSERT_NOT_NULL(test_manager);
+
+  // 按主键每页 2 行：第一页带续读令牌，最后一页没有
+  char token[256], next[256], names[64];
+  TEST_ASSERT_EQUAL_INT(2, read_page("age >= 25", NULL, token, sizeof(token), names));
+  TEST_ASSERT_EQUAL_STRING("Alice,Bob,", names);
+  TEST_ASSERT_TRUE(token[0] != '\0');
+  TEST_ASSERT_EQUAL_INT(1, read_page("age >= 25", token, next, sizeof(next), names));
+  TEST_ASSERT_EQUAL_STRING("Charlie,", names);
+  TEST_ASSERT_EQUAL_STRING("", next);
+
+  // 恰好读满一页时也没有下一页
+  TEST_ASSERT_EQUAL_INT(2, read_page("age >= 30", NULL, next, sizeof(next), names));
+  TEST_ASSERT_EQUAL_STRING("", next);
+
+  // 令牌只能用于生成它的查询
+  TEST_ASSERT_EQUAL_INT(-1, read_page("age > 0", token, next, sizeof(next), names));
+  TEST_ASSERT_EQUAL_INT(-1, read_page("age >= 25", "not-a-token", next, sizeof(next), names));
+
+  read_options_t options = {.page_size = READ_MAX_PAGE_SIZE + 1, .page_token = NULL};
+  TEST_ASSERT_NULL(db_manager_read_open(test_manager, TEST_TABLE, NULL, &options));
+  // 分页只能按主键排序，选择的列必须包含主键
+  options = (read_options_t){.page_size = 2, .order_by = "age"};
+  TEST_ASSERT_NULL(db_manager_read_open(test_manager, TEST_TABLE, NULL, &options));
+  options = (read_options_t){.page_size = 2, .columns = "name"};
+  TEST_ASSERT_NULL(db_manager_read_open(test_manager, TEST_TABLE, NULL, &options));
+  TEST_ASSERT_EQUAL_INT(0, test_manager->conn_pool->active_connections);
+}
+
+static void string_param(db_param_t *param, const char *value) {
+  *param = (db_param_t){.type = DB_PARAM_STRING, .str = value, .len = strlen(value)};
+}
+
+void test_db_manager_execute_params(void) {
+  TEST_ASSERT_NOT_NULL(test_manager);
+
+  // 值以二进制协议发送，引号不需要转义；90 个 3 字节字符超过列缓冲区的初始大小
+  char email[300] = "";
+  for (int i = 0; i < 90; ++i) {
+    strcat(email, "\xe2\x82\xac");
+  }
+  db_params_t params = {.count = 3};
+  string_param(&params.values[0], "O'Brien");
+  string_param(&params.values[1], email);
+  params.values[2] = (db_param_t){.type = DB_PARAM_NULL};
+  TEST_ASSERT_EQUAL_INT(1, db_manager_execute_params(test_manager, DB_OP_CREATE, TEST_TABLE,
+                                                     "name = ?, email = ?, age = ?", NULL,
+                                                     &params));
+
+  db_params_t where = {.count = 1};
+  string_param(&where.values[0], "O'Brien");
+  read_options_t options = {.columns = "email, age", .params = &where};
+  for (int round = 0; round < 2; ++round) {
+    db_cursor_t *cursor = db_manager_read_open(test_manager, TEST_TABLE, "name = ?", &options);
+    TEST_ASSERT_NOT_NULL(cursor);
+    unsigned long *lengths = NULL;
+    MYSQL_ROW row = db_cursor_fetch(cursor, &lengths);
+    TEST_ASSERT_NOT_NULL(row);
+    TEST_ASSERT_EQUAL_UINT(strlen(email), lengths[0]);
+    TEST_ASSERT_EQUAL_STRING(email, row[0]);
+    TEST_ASSERT_NULL(row[1]);
+    TEST_ASSERT_NULL(db_cursor_fetch(cursor, &lengths));
+    TEST_ASSERT_FALSE(cursor->failed);
+    db_cursor_close(cursor);
+  }
+  // 第二次读取使用同一个连接上准备好的语句
+  connection_pool_stats_t stats;
+  connection_pool_stats(test_manager->conn_pool, &stats);
+  TEST_ASSERT_TRUE(stats.stmts.hits >= 1);
+
+  params.values[0] = (db_param_t){.type = DB_PARAM_INT, .i = 40};
+  string_param(&params.values[1], "O'Brien");
+  params.count = 2;
+  TEST_ASSERT_EQUAL_INT(1, db_manager_execute_params(test_manager, DB_OP_UPDATE, TEST_TABLE,
+                                                     "age = ?", "name = ?", &params));
+
+  // 参数个数与 '?' 不一致
+  params.count = 1;
+  TEST_ASSERT_EQUAL_INT(-1, db_manager_execute_params(test_manager, DB_OP_DELETE, TEST_TABLE,
+                                                      NULL, "name = ? AND age = ?", &params));
+  TEST_ASSERT_NOT_NULL(strstr(db_manager_last_error(test_manager), "placeholders"));
+  params.count = 2;
+  TEST_ASSERT_EQUAL_INT(1, db_manager_execute_params(test_manager, DB_OP_DELETE, TEST_TABLE,
+                                                     NULL, "age = ? AND name = ?", &params));
+
+  // 参数化读取不能分页，也不能直接取结果集
+  options = (read_options_t){.page_size = 10, .params = &where};
+  TEST_ASSERT_NULL(db_manager_read_open(test_manager, TEST_TABLE, "name = ?", &options));
+  options = (read_options_t){.params = &where};
+  TEST_ASSERT_NULL(db_manager_read_row(test_manager, TEST_TABLE, "name = ?", &options));
+  TEST_ASSERT_EQUAL_INT(0, test_manager->conn_pool->active_connections);
+}
+
+void test_db_manager_bulk_insert(void) {
+  TEST_ASSERT_NOT_NULL(test_manager);
+
+  // bulk_load 生成的多行 INSERT 一次写入全部行，并使表的缓存失效
+  bulk_load_t *load = bulk_load_create(TEST_TABLE, BULK_FORMAT_CSV);
+  TEST_ASSERT_NOT_NULL(load);
+  const char *csv = "name,email,age\nEve,eve@example.com,31\n\"O'Neil\",\\N,\\N\n";
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_feed(load, csv, strlen(csv)));
+  TEST_ASSERT_EQUAL_INT(0, bulk_load_finish(load));
+  bulk_batch_t batch;
+  TEST_ASSERT_TRUE(bulk_load_take(load, &batch));
+  uint64_t version = table_version_get(&test_manager->versions, TEST_TABLE);
+  TEST_ASSERT_EQUAL_INT(2, db_manager_bulk_insert(test_manager, TEST_TABLE, batch.sql));
+  TEST_ASSERT_TRUE(table_version_get(&test_manager->versions, TEST_TABLE) != version);
+  bulk_load_record(load, &batch, 2, NULL);
+  bulk_load_destroy(load);
+
+  MYSQL *conn = db_test_connect();
+  TEST_ASSERT_EQUAL_INT(5, db_test_count_rows(conn, TEST_TABLE));
+  db_test_disconnect(conn);
+
+  // 整个批次失败，没有行写入
+  TEST_ASSERT_EQUAL_INT(-1, db_manager_bulk_insert(test_manager, TEST_TABLE,
+                                                   "INSERT INTO " TEST_TABLE
+                                                   " (`name`, `nope`) VALUES ('a', 'b')"));
+  TEST_ASSERT_NOT_NULL(strstr(db_manager_last_error(test_manager), "nope"));
+  TEST_ASSERT_EQUAL_INT(-1, db_manager_bulk_insert(test_manager, TEST_TABLE, NULL));
+}
+
 void test_db_manager_read_row_invalid_params(void) {
   TEST_ASSERT_NOT_NULL(test_manager);
 
   // 测试空表名
-  db_result_t *result = db_manager_read_row(test_manager, NULL, "name='Alice'");
+  db_result_t *result = db_manager_read_row(test_manager, NULL, "name='Alice'", NULL);
   TEST_ASSERT_NULL(result);
 }
 
@@ -95,7 +304,7 @@ void test_db_manager_update_row_success(void) {
 
   // 验证更新
   db_result_t *read_result =
-      db_manager_read_row(test_manager, TEST_TABLE, "name='Alice' AND age=26");
+      db_manager_read_row(test_manager, TEST_TABLE, "name='Alice' AND age=26", NULL);
   TEST_ASSERT_NOT_NULL(read_result);
   TEST_ASSERT_EQUAL_INT(1, read_result->num_rows);
 
@@ -155,7 +364,37 @@ void test_db_manager_error_handling(void) {
   TEST_ASSERT_EQUAL_INT(-1, result);
 
   // 检查错误信息是否被设置
-  TEST_ASSERT_NOT_NULL(test_manager->last_error);
+  TEST_ASSERT_NOT_NULL(db_manager_last_error(test_manager));
+}
+
+void test_db_manager_deadline_kills_query(void) {
+  TEST_ASSERT_NOT_NULL(test_manager);
+
+  // 每行 SLEEP 1 秒，原有 3 条记录，截止时间之后由监视线程 KILL QUERY
+  uint64_t start_us = clock_now_us();
+  db_manager_set_deadline(start_us + 200 * 1000);
+  int result = db_manager_update_row(test_manager, TEST_TABLE, "age=age+1", "SLEEP(1) = 0");
+  uint64_t elapsed_us = clock_now_us() - start_us;
+  TEST_ASSERT_EQUAL_INT(-1, result);
+  TEST_ASSERT_TRUE(db_manager_deadline_exceeded());
+  TEST_ASSERT_LESS_THAN(1000 * 1000, elapsed_us);
+  TEST_ASSERT_GREATER_OR_EQUAL(1, query_watchdog_kills(&test_manager->watchdog));
+
+  // SELECT 由 MAX_EXECUTION_TIME 在服务端中止
+  db_manager_set_deadline(clock_now_us() + 200 * 1000);
+  db_result_t *rows = db_manager_read_row(test_manager, TEST_TABLE, "SLEEP(1) = 0", NULL);
+  TEST_ASSERT_NULL(rows);
+  TEST_ASSERT_TRUE(db_manager_deadline_exceeded());
+
+  // 连接归还后仍然可用
+  db_manager_set_deadline(0);
+  TEST_ASSERT_FALSE(db_manager_deadline_exceeded());
+  for (size_t i = 0; i < MAX_POOL_SIZE * 2; ++i) {
+    rows = db_manager_read_row(test_manager, TEST_TABLE, NULL, NULL);
+    TEST_ASSERT_NOT_NULL(rows);
+    TEST_ASSERT_EQUAL_INT(3, rows->num_rows);
+    db_result_free(rows);
+  }
 }
 
 int main(void) {
@@ -165,12 +404,18 @@ int main(void) {
   RUN_TEST(test_db_manager_create_row_success);
   RUN_TEST(test_db_manager_create_row_invalid_params);
   RUN_TEST(test_db_manager_read_row_success);
+  RUN_TEST(test_db_manager_read_row_options);
+  RUN_TEST(test_db_manager_read_row_each_success);
+  RUN_TEST(test_db_manager_read_pages);
+  RUN_TEST(test_db_manager_execute_params);
+  RUN_TEST(test_db_manager_bulk_insert);
   RUN_TEST(test_db_manager_read_row_invalid_params);
   RUN_TEST(test_db_manager_update_row_success);
   RUN_TEST(test_db_manager_update_row_invalid_params);
   RUN_TEST(test_db_manager_delete_row_success);
   RUN_TEST(test_db_manager_delete_row_invalid_params);
   RUN_TEST(test_db_manager_error_handling);
+  RUN_TEST(test_db_manager_deadline_kills_query);
 
   return UNITY_END();
 }
@@ -0,0 +1,247 @@
+// clang-format off
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "unity.h"
+#include "src/http_client.h"
+// clang-format on
+
+// 桩服务端处理一个请求的耗时；表名为 slow 的 READ 更慢，用来打乱完成顺序
+#define STUB_DELAY_US 30000
+#define STUB_SLOW_DELAY_US 300000
+
+// 本地的 HTTP 桩：每个连接一个线程，按请求体里的表名回显 READ 结果，记录同时处理的请求数
+static int listen_fd = -1;
+static pthread_t accept_thread;
+static atomic_int handling;
+static atomic_int max_handling;
+static atomic_int num_requests;
+static char base_url[64];
+static http_client_t *client;
+
+/**
+ * @brief 读取一个请求：请求头到空行为止，再按 Content-Length 读取请求体
+ *
+ * @return int 读到（1）；连接已关闭（0）
+ */
+static int stub_read_request(int fd, char *buf, size_t size, char **body) {
+  size_t len = 0;
+  char *end = NULL;
+  while (!(end = len > 0 ? strstr(buf, "\r\n\r\n") : NULL)) {
+    ssize_t n = recv(fd, buf + len, size - 1 - len, 0);
+    if (n <= 0) {
+      return 0;
+    }
+    len += (size_t)n;
+    buf[len] = '\0';
+  }
+  size_t content_length = 0;
+  for (char *line = strstr(buf, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n")) {
+    if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+      content_length = (size_t)strtoul(line + 17, NULL, 10);
+    }
+  }
+  *body = end + 4;
+  size_t want = (size_t)(*body - buf) + content_length;
+  while (len < want && len < size - 1) {
+    ssize_t n = recv(fd, buf + len, size - 1 - len, 0);
+    if (n <= 0) {
+      return 0;
+    }
+    len += (size_t)n;
+  }
+  buf[len] = '\0';
+  return 1;
+}
+
+static void *stub_connection(void *arg) {
+  int fd = (int)(intptr_t)arg;
+  char buf[8192];
+  char *body;
+  while (stub_read_request(fd, buf, sizeof(buf), &body)) {
+    int now = atomic_fetch_add(&handling, 1) + 1;
+    int max = atomic_load(&max_handling);
+    while (now > max && !atomic_compare_exchange_weak(&max_handling, &max, now)) {
+    }
+    atomic_fetch_add(&num_requests, 1);
+
+    char table[32] = "";
+    const char *field = strstr(body, "table=");
+    if (field) {
+      sscanf(field + 6, "%31[^&]", table);
+    }
+    usleep(strcmp(table, "slow") == 0 ? STUB_SLOW_DELAY_US : STUB_DELAY_US);
+
+    char response[256];
+    int body_len = (int)strlen(table) + 5;
+    int n = snprintf(response, sizeof(response),
+                     "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %d\r\n\r\n"
+                     "rows %s",
+                     body_len, table);
+    atomic_fetch_sub(&handling, 1);
+    if (send(fd, response, (size_t)n, MSG_NOSIGNAL) != n) {
+      break;
+    }
+  }
+  close(fd);
+  return NULL;
+}
+
+static void *stub_accept(void *arg) {
+  (void)arg;
+  int fd;
+  while ((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, stub_connection, (void *)(intptr_t)fd) == 0) {
+      pthread_detach(thread);
+    } else {
+      close(fd);
+    }
+  }
+  return NULL;
+}
+
+void setUp(void) {
+  atomic_store(&handling, 0);
+  atomic_store(&max_handling, 0);
+  atomic_store(&num_requests, 0);
+
+  struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  socklen_t addr_len = sizeof(addr);
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  TEST_ASSERT_TRUE(listen_fd >= 0);
+  TEST_ASSERT_EQUAL_INT(0, bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)));
+  TEST_ASSERT_EQUAL_INT(0, listen(listen_fd, 64));
+  TEST_ASSERT_EQUAL_INT(0, getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len));
+  snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%u", ntohs(addr.sin_port));
+  TEST_ASSERT_EQUAL_INT(0, pthread_create(&accept_thread, NULL, stub_accept, NULL));
+
+  client = http_client_init(base_url);
+  TEST_ASSERT_NOT_NULL(client);
+}
+
+void tearDown(void) {
+  http_client_cleanup(client);
+  client = NULL;
+  // shutdown 唤醒阻塞在 accept 中的线程
+  shutdown(listen_fd, SHUT_RDWR);
+  pthread_join(accept_thread, NULL);
+  close(listen_fd);
+}
+
+/**
+ * @brief 取走一个结果，检查它是请求 ID 为 id 的、某个表的 READ 结果
+ */
+static void receive_read(const char *table, uint64_t id) {
+  http_completion_t completion;
+  TEST_ASSERT_EQUAL_INT(1, http_client_receive(client, 5000, &completion));
+  TEST_ASSERT_EQUAL_INT(1, completion.result);
+  char expected[64];
+  snprintf(expected, sizeof(expected), "rows %s", table);
+  TEST_ASSERT_EQUAL_STRING(expected, completion.output);
+  free(completion.output);
+  TEST_ASSERT_EQUAL_UINT64(id, completion.id);
+}
+
+void test_http_client_completion_order(void) {
+  // 同时进行时先完成的先取到，与提交顺序无关
+  uint64_t slow_id, fast_id;
+  TEST_ASSERT_EQUAL_INT(
+      0, http_client_submit(client, "read", "slow", NULL, NULL, NULL, NULL, &slow_id));
+  TEST_ASSERT_EQUAL_INT(
+      0, http_client_submit(client, "read", "fast", NULL, NULL, NULL, NULL, &fast_id));
+  TEST_ASSERT_TRUE(fast_id > slow_id);
+  receive_read("fast", fast_id);
+  receive_read("slow", slow_id);
+
+  // 上限为 1 时请求按提交顺序排队
+  TEST_ASSERT_EQUAL_INT(0, http_client_set_max_active(client, 1));
+  TEST_ASSERT_EQUAL_INT(
+      0, http_client_submit(client, "read", "slow", NULL, NULL, NULL, NULL, &slow_id));
+  TEST_ASSERT_EQUAL_INT(
+      0, http_client_submit(client, "read", "fast", NULL, NULL, NULL, NULL, &fast_id));
+  receive_read("slow", slow_id);
+  receive_read("fast", fast_id);
+
+  http_completion_t completion;
+  TEST_ASSERT_EQUAL_INT(0, http_client_receive(client, 0, &completion));
+}
+
+static void count_completion(http_completion_t *completion) {
+  int *count = completion->userdata;
+  TEST_ASSERT_EQUAL_INT(1, completion->result);
+  ++*count;
+}
+
+void test_http_client_max_active(void) {
+  TEST_ASSERT_EQUAL_INT(0, http_client_set_max_active(client, 2));
+  TEST_ASSERT_EQUAL_INT(-1, http_client_set_max_active(client, 0));
+  int completed = 0;
+  for (int i = 0; i < 6; ++i) {
+    TEST_ASSERT_EQUAL_INT(0, http_client_submit(client, "read", "users", NULL, NULL,
+                                                count_completion, &completed, NULL));
+  }
+  // 超出上限的请求排队，未完成的请求数包括它们
+  TEST_ASSERT_EQUAL_INT(6, http_client_poll(client, 0));
+  TEST_ASSERT_EQUAL_size_t(2, client->num_active);
+
+  int pending;
+  while ((pending = http_client_poll(client, 100)) > 0) {
+    TEST_ASSERT_TRUE(client->num_active <= 2);
+  }
+  TEST_ASSERT_EQUAL_INT(0, pending);
+  TEST_ASSERT_EQUAL_INT(6, completed);
+  TEST_ASSERT_EQUAL_INT(6, atomic_load(&num_requests));
+  TEST_ASSERT_EQUAL_INT(2, atomic_load(&max_handling));
+}
+
+static void unexpected_completion(http_completion_t *completion) {
+  (void)completion;
+  TEST_FAIL_MESSAGE("callback of a discarded request");
+}
+
+void test_http_client_cleanup_pending(void) {
+  // 进行中、排队中和已完成未取走的请求在销毁时都释放，不调用回调（泄漏由 ASan 检查）
+  TEST_ASSERT_EQUAL_INT(0, http_client_set_max_active(client, 2));
+  TEST_ASSERT_EQUAL_INT(0, http_client_submit(client, "read", "fast", NULL, NULL, NULL, NULL,
+                                              NULL));
+  http_completion_t completion;
+  TEST_ASSERT_EQUAL_INT(1, http_client_receive(client, 5000, &completion));
+  free(completion.output);
+  TEST_ASSERT_EQUAL_INT(0, http_client_submit(client, "read", "fast", NULL, NULL, NULL, NULL,
+                                              NULL));
+  while (http_client_poll(client, 100) > 0) {
+  }
+  TEST_ASSERT_NOT_NULL(client->done);
+
+  for (int i = 0; i < 4; ++i) {
+    TEST_ASSERT_EQUAL_INT(0, http_client_submit(client, "read", "slow", NULL, NULL,
+                                                unexpected_completion, NULL, NULL));
+  }
+  while (atomic_load(&handling) < 2) {
+    TEST_ASSERT_EQUAL_INT(4, http_client_poll(client, 10));
+  }
+  TEST_ASSERT_NOT_NULL(client->active);
+  TEST_ASSERT_NOT_NULL(client->queued);
+  // 由 tearDown 销毁
+}
+
+int main(void) {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+  UNITY_BEGIN();
+
+  RUN_TEST(test_http_client_completion_order);
+  RUN_TEST(test_http_client_max_active);
+  RUN_TEST(test_http_client_cleanup_pending);
+
+  int failures = UNITY_END();
+  curl_global_cleanup();
+  return failures;
+}
@@ -0,0 +1,302 @@
+// clang-format off
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "src/arena.h"
+#include "src/json_request.h"
+#include "src/operation.h"
+#include "src/strbuf.h"
+// clang-format on
+
+static arena_t *arena = NULL;
+static batch_t batch;
+static db_params_t params;
+static json_request_t req;
+static json_request_error_t error;
+
+void setUp(void) {
+  arena = arena_create(4096);
+  batch_init(&batch, arena);
+  req.batch = &batch;
+  req.params = &params;
+}
+
+void tearDown(void) {
+  arena_destroy(arena);
+  arena = NULL;
+}
+
+/**
+ * @brief 复制到内存区域后解析（解析会改写请求体）
+ */
+static int parse(const char *json, char **body) {
+  *body = arena_strdup(arena, json);
+  return json_request_parse(*body, strlen(json), &req, &error);
+}
+
+void test_json_request_single(void) {
+  const char *json = " {\"operation\": \"create\", \"table\":\"users\",\n"
+                     "  \"data\": \"name='\\u00e9\\\"x\\\"'\", \"where\": null}\n";
+  char *body;
+  TEST_ASSERT_EQUAL_INT(0, parse(json, &body));
+  TEST_ASSERT_EQUAL_STRING("create", req.operation);
+  TEST_ASSERT_EQUAL_STRING("users", req.table);
+  TEST_ASSERT_EQUAL_STRING("name='\xc3\xa9\"x\"'", req.data);
+  TEST_ASSERT_NULL(req.where);
+  TEST_ASSERT_NULL(req.cursor);
+  TEST_ASSERT_EQUAL_INT(0, batch.num_items);
+
+  // 字段直接指向请求体内部
+  TEST_ASSERT_TRUE(req.table > body && req.table < body + strlen(json));
+}
+
+void test_json_request_escapes(void) {
+  char *body;
+  TEST_ASSERT_EQUAL_INT(
+      0, parse("{\"data\": \"a\\\\b\\/c\\n\\t\\u20ac\\ud83d\\ude00\", \"table\": \"\"}", &body));
+  TEST_ASSERT_EQUAL_STRING("a\\b/c\n\t\xe2\x82\xac\xf0\x9f\x98\x80", req.data);
+  TEST_ASSERT_EQUAL_STRING("", req.table);
+}
+
+void test_json_request_watch(void) {
+  char *body;
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"operation\":\"watch\",\"table\":\"users\","
+                                 "\"cursor\":\"3e11fa47-71ca-11e1-9e33-c80aa9429562:1-5\"}",
+                                 &body));
+  TEST_ASSERT_EQUAL_STRING("watch", req.operation);
+  TEST_ASSERT_EQUAL_STRING("3e11fa47-71ca-11e1-9e33-c80aa9429562:1-5", req.cursor);
+  // watch 不是数据库操作
+  TEST_ASSERT_EQUAL_INT(DB_OP_UNKNOWN, db_op_from_str(req.operation));
+}
+
+void test_json_request_page(void) {
+  char *body;
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"operation\":\"read\",\"table\":\"users\",\"page_size\":100,"
+                                 "\"page_token\":\"AQID-_\"}",
+                                 &body));
+  TEST_ASSERT_EQUAL_UINT(100, req.page_size);
+  TEST_ASSERT_EQUAL_STRING("AQID-_", req.page_token);
+
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"page_size\":null,\"page_token\":null}", &body));
+  TEST_ASSERT_EQUAL_UINT(0, req.page_size);
+  TEST_ASSERT_NULL(req.page_token);
+
+  // 上限为 UINT32_MAX，是否超过一页的行数上限由服务端判断
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"page_size\":4294967295}", &body));
+  TEST_ASSERT_EQUAL_UINT(4294967295UL, req.page_size);
+}
+
+void test_json_request_projection(void) {
+  char *body;
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"operation\":\"read\",\"table\":\"users\","
+                                 "\"columns\":\"id, name\",\"order_by\":\"age DESC, id\","
+                                 "\"limit\":10}",
+                                 &body));
+  TEST_ASSERT_EQUAL_STRING("id, name", req.columns);
+  TEST_ASSERT_EQUAL_STRING("age DESC, id", req.order_by);
+  TEST_ASSERT_EQUAL_UINT(10, req.limit);
+  TEST_ASSERT_EQUAL_UINT(0, req.page_size);
+
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"columns\":null,\"order_by\":null,\"limit\":null}", &body));
+  TEST_ASSERT_NULL(req.columns);
+  TEST_ASSERT_NULL(req.order_by);
+  TEST_ASSERT_EQUAL_UINT(0, req.limit);
+}
+
+static void assert_param(size_t index, db_param_type_t type) {
+  TEST_ASSERT_TRUE(index < params.count);
+  TEST_ASSERT_EQUAL_INT(type, params.values[index].type);
+}
+
+static void assert_string_param(size_t index, const char *expected) {
+  assert_param(index, DB_PARAM_STRING);
+  TEST_ASSERT_EQUAL_size_t(strlen(expected), params.values[index].len);
+  TEST_ASSERT_EQUAL_MEMORY(expected, params.values[index].str, strlen(expected));
+}
+
+void test_json_request_params(void) {
+  char *body;
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"operation\":\"update\",\"table\":\"users\","
+                                 "\"data\":\"name = ?\","
+                                 "\"where\":\"id = ? AND age > ?\",\"params\":[\"bob\\n\", 42, "
+                                 "-1.5e2, true, null, 92233720368547758070, \"\"]}",
+                                 &body));
+  TEST_ASSERT_TRUE(req.has_params);
+  TEST_ASSERT_FALSE(params.overflow);
+  TEST_ASSERT_EQUAL_size_t(7, params.count);
+  assert_string_param(0, "bob\n");
+  assert_param(1, DB_PARAM_INT);
+  TEST_ASSERT_EQUAL_INT64(42, params.values[1].i);
+  assert_param(2, DB_PARAM_DOUBLE);
+  TEST_ASSERT_TRUE(params.values[2].d == -150.0);
+  assert_param(3, DB_PARAM_INT);
+  TEST_ASSERT_EQUAL_INT64(1, params.values[3].i);
+  assert_param(4, DB_PARAM_NULL);
+  // 超出 long long 的整数按原文发送
+  assert_string_param(5, "92233720368547758070");
+  assert_string_param(6, "");
+
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"params\":[]}", &body));
+  TEST_ASSERT_TRUE(req.has_params);
+  TEST_ASSERT_EQUAL_size_t(0, params.count);
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"params\":null}", &body));
+  TEST_ASSERT_FALSE(req.has_params);
+  TEST_ASSERT_EQUAL_INT(0, parse("{\"table\":\"t\"}", &body));
+  TEST_ASSERT_FALSE(req.has_params);
+}
+
+void test_json_request_params_overflow(void) {
+  strbuf_t json;
+  strbuf_init(&json);
+  TEST_ASSERT_EQUAL_INT(0, strbuf_append_str(&json, "{\"params\":[0"));
+  for (int i = 1; i <= DB_PARAMS_MAX; ++i) {
+    TEST_ASSERT_EQUAL_INT(0, strbuf_appendf(&json, ",%d", i));
+  }
+  TEST_ASSERT_EQUAL_INT(0, strbuf_append_str(&json, "]}"));
+
+  char *body;
+  TEST_ASSERT_EQUAL_INT(0, parse(json.data, &body));
+  TEST_ASSERT_TRUE(params.overflow);
+  TEST_ASSERT_EQUAL_size_t(DB_PARAMS_MAX, params.count);
+  TEST_ASSERT_EQUAL_INT64(DB_PARAMS_MAX - 1, params.values[DB_PARAMS_MAX - 1].i);
+  strbuf_free(&json);
+}
+
+void test_json_request_batch(void) {
+  char *body;
+  TEST_ASSERT_EQUAL_INT(
+      0, parse("{\"operation\":\"batch\",\"transaction\":true,\"comment\":{\"a\":[1,-2.5e3,null]},"
+               "\"items\":[{\"operation\":\"create\",\"table\":\"t\",\"data\":\"id=1\"},"
+               "{\"operation\":\"delete\",\"table\":\"t\",\"where\":\"id=2\",\"x\":false},"
+               "{}]}",
+               &body));
+  TEST_ASSERT_EQUAL_STRING("batch", req.operation);
+  TEST_ASSERT_TRUE(batch.transaction);
+  TEST_ASSERT_FALSE(req.batch_overflow);
+  TEST_ASSERT_EQUAL_INT(3, batch.num_items);
+  TEST_ASSERT_EQUAL_STRING("create", batch.items[0].operation);
+  TEST_ASSERT_EQUAL_STRING("id=1", batch.items[0].data);
+  TEST_ASSERT_NULL(batch.items[0].where);
+  TEST_ASSERT_EQUAL_STRING("delete", batch.items[1].operation);
+  TEST_ASSERT_EQUAL_STRING("id=2", batch.items[1].where);
+  TEST_ASSERT_NULL(batch.items[2].operation);
+}
+
+void test_json_request_batch_overflow(void) {
+  strbuf_t json;
+  strbuf_init(&json);
+  TEST_ASSERT_EQUAL_INT(0, strbuf_append_str(&json, "{\"operation\":\"batch\",\"items\":["));
+  for (int i = 0; i <= BATCH_MAX_ITEMS; ++i) {
+    TEST_ASSERT_EQUAL_INT(0, strbuf_appendf(&json, "%s{\"operation\":\"read\",\"table\":\"t\"}",
+                                            i ? "," : ""));
+  }
+  TEST_ASSERT_EQUAL_INT(0, strbuf_append_str(&json, "]}"));
+
+  char *body;
+  TEST_ASSERT_EQUAL_INT(0, parse(json.data, &body));
+  TEST_ASSERT_TRUE(req.batch_overflow);
+  TEST_ASSERT_EQUAL_INT(BATCH_MAX_ITEMS, batch.num_items);
+  strbuf_free(&json);
+}
+
+void test_json_request_malformed(void) {
+  static const struct {
+    const char *json;
+    size_t offset;
+  } cases[] = {
+      {"", 0},
+      {"[]", 0},
+      {"{\"table\": \"t\",}", 14},
+      {"{\"table\": \"t\"", 13},
+      {"{\"table\": \"t}", 13},
+      {"{\"table\": 1}", 10},
+      {"{\"transaction\": \"yes\"}", 16},
+      {"{\"page_size\": -1}", 14},
+      {"{\"page_size\": 1.5}", 15},
+      {"{\"page_size\": 1e3}", 15},
+      {"{\"page_size\": \"10\"}", 14},
+      {"{\"page_size\": 4294967296}", 23},
+      {"{\"limit\": -5}", 10},
+      {"{\"columns\": [\"id\"]}", 12},
+      {"{\"params\": \"x\"}", 11},
+      {"{\"params\": [[1]]}", 12},
+      {"{\"params\": [1.]}", 14},
+      {"{\"data\": \"\\u0000\"}", 10},
+      {"{\"data\": \"\\ud83d\"}", 10},
+      {"{\"data\": \"\\q\"}", 10},
+      {"{\"data\": \"a\nb\"}", 11},
+      {"{\"x\": 01}", 7},
+      {"{\"x\": -}", 7},
+      {"{\"x\": tru}", 6},
+      {"{} {}", 3},
+      {"{\"x\":[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]}", 37},
+  };
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    char *body;
+    char msg[64];
+    snprintf(msg, sizeof(msg), "case %zu", i);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(-1, parse(cases[i].json, &body), msg);
+    TEST_ASSERT_NOT_NULL_MESSAGE(error.message, msg);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(cases[i].offset, error.offset, msg);
+  }
+}
+
+void test_json_row(void) {
+  static json_row_t row;
+  char *line = arena_strdup(arena, "{\"id\": 12345678901234567890, \"name\": \"a\\\"b\", "
+                                   "\"ok\": true, \"note\": null}");
+  TEST_ASSERT_EQUAL_INT(0, json_row_parse(line, strlen(line), &row, &error));
+  TEST_ASSERT_EQUAL_size_t(4, row.count);
+  TEST_ASSERT_EQUAL_INT(JSON_VALUE_NUMBER, row.values[0].type);
+  // 数字保持原文，不经过 double
+  TEST_ASSERT_EQUAL_STRING_LEN("12345678901234567890", row.values[0].value, row.values[0].len);
+  TEST_ASSERT_EQUAL_STRING_LEN("name", row.values[1].name, row.values[1].name_len);
+  TEST_ASSERT_EQUAL_INT(JSON_VALUE_STRING, row.values[1].type);
+  TEST_ASSERT_EQUAL_STRING_LEN("a\"b", row.values[1].value, row.values[1].len);
+  TEST_ASSERT_EQUAL_INT(JSON_VALUE_NUMBER, row.values[2].type);
+  TEST_ASSERT_EQUAL_STRING_LEN("1", row.values[2].value, row.values[2].len);
+  TEST_ASSERT_EQUAL_INT(JSON_VALUE_NULL, row.values[3].type);
+
+  line = arena_strdup(arena, "{\"tags\": [1]}");
+  TEST_ASSERT_EQUAL_INT(-1, json_row_parse(line, strlen(line), &row, &error));
+  TEST_ASSERT_EQUAL_size_t(9, error.offset);
+  line = arena_strdup(arena, "{\"id\": 1} x");
+  TEST_ASSERT_EQUAL_INT(-1, json_row_parse(line, strlen(line), &row, &error));
+}
+
+void test_db_op_lookup(void) {
+  TEST_ASSERT_EQUAL_INT(DB_OP_CREATE, db_op_from_str("create"));
+  TEST_ASSERT_EQUAL_INT(DB_OP_READ, db_op_from_str("read"));
+  TEST_ASSERT_EQUAL_INT(DB_OP_UPDATE, db_op_from_str("update"));
+  TEST_ASSERT_EQUAL_INT(DB_OP_DELETE, db_op_from_str("delete"));
+  TEST_ASSERT_EQUAL_INT(DB_OP_BATCH, db_op_from_str("batch"));
+  TEST_ASSERT_EQUAL_INT(DB_OP_BULK_CREATE, db_op_from_str("bulk_create"));
+  TEST_ASSERT_EQUAL_INT(DB_OP_READ, db_op_lookup("reader", 4));
+
+  TEST_ASSERT_EQUAL_INT(DB_OP_UNKNOWN, db_op_from_str(NULL));
+  TEST_ASSERT_EQUAL_INT(DB_OP_UNKNOWN, db_op_from_str(""));
+  TEST_ASSERT_EQUAL_INT(DB_OP_UNKNOWN, db_op_from_str("rea"));
+  TEST_ASSERT_EQUAL_INT(DB_OP_UNKNOWN, db_op_from_str("CREATE"));
+  TEST_ASSERT_EQUAL_INT(DB_OP_UNKNOWN, db_op_from_str("crate!"));
+  TEST_ASSERT_EQUAL_INT(DB_OP_UNKNOWN, db_op_from_str("upsert"));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_json_request_single);
+  RUN_TEST(test_json_request_escapes);
+  RUN_TEST(test_json_request_watch);
+  RUN_TEST(test_json_request_page);
+  RUN_TEST(test_json_request_projection);
+  RUN_TEST(test_json_request_params);
+  RUN_TEST(test_json_request_params_overflow);
+  RUN_TEST(test_json_request_batch);
+  RUN_TEST(test_json_request_batch_overflow);
+  RUN_TEST(test_json_request_malformed);
+  RUN_TEST(test_json_row);
+  RUN_TEST(test_db_op_lookup);
+
+  return UNITY_END();
+}
@@ -0,0 +1,129 @@
+// clang-format off
+#include <pthread.h>
+#include <string.h>
+#include "unity.h"
+#include "src/metrics.h"
+#include "src/strbuf.h"
+// clang-format on
+
+#define TEST_THREADS 8
+#define TEST_REQUESTS_PER_THREAD 10000
+
+static metrics_t *metrics = NULL;
+
+void setUp(void) {
+  metrics = metrics_create();
+}
+
+void tearDown(void) {
+  metrics_destroy(metrics);
+  metrics = NULL;
+}
+
+void test_metrics_latency_bucket(void) {
+  // 第 i 个桶的上界为 100us << i，上界本身落在该桶内
+  TEST_ASSERT_EQUAL_INT(0, metrics_latency_bucket(0));
+  TEST_ASSERT_EQUAL_INT(0, metrics_latency_bucket(100));
+  TEST_ASSERT_EQUAL_INT(1, metrics_latency_bucket(101));
+  TEST_ASSERT_EQUAL_INT(1, metrics_latency_bucket(200));
+  TEST_ASSERT_EQUAL_INT(2, metrics_latency_bucket(201));
+  TEST_ASSERT_EQUAL_INT(METRICS_LATENCY_BUCKETS - 1,
+                        metrics_latency_bucket((uint64_t)METRICS_BUCKET_BASE_US
+                                               << (METRICS_LATENCY_BUCKETS - 1)));
+  TEST_ASSERT_EQUAL_INT(METRICS_LATENCY_BUCKETS,
+                        metrics_latency_bucket(((uint64_t)METRICS_BUCKET_BASE_US
+                                                << (METRICS_LATENCY_BUCKETS - 1)) +
+                                               1));
+  TEST_ASSERT_EQUAL_INT(METRICS_LATENCY_BUCKETS, metrics_latency_bucket(UINT64_MAX));
+}
+
+static void *record_thread(void *arg) {
+  (void)arg;
+  for (int i = 0; i < TEST_REQUESTS_PER_THREAD; ++i) {
+    metrics_record_request(metrics, DB_OP_READ, i % 10 == 0, 150);
+    metrics_add(&metrics_shard(metrics)->bytes_in, 3);
+  }
+  return NULL;
+}
+
+void test_metrics_concurrent_record(void) {
+  // 多个线程分别写各自的分片，汇总后不丢计数
+  pthread_t threads[TEST_THREADS];
+  for (int i = 0; i < TEST_THREADS; ++i) {
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, record_thread, NULL));
+  }
+  for (int i = 0; i < TEST_THREADS; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  metrics_snapshot_t snapshot;
+  metrics_snapshot(metrics, &snapshot);
+  unsigned long long total = (unsigned long long)TEST_THREADS * TEST_REQUESTS_PER_THREAD;
+  TEST_ASSERT_EQUAL_UINT64(total, snapshot.requests[DB_OP_READ]);
+  TEST_ASSERT_EQUAL_UINT64(total / 10, snapshot.errors[DB_OP_READ]);
+  TEST_ASSERT_EQUAL_UINT64(total * 150, snapshot.latency_sum_us[DB_OP_READ]);
+  TEST_ASSERT_EQUAL_UINT64(total, snapshot.latency_buckets[DB_OP_READ][1]);
+  TEST_ASSERT_EQUAL_UINT64(total * 3, snapshot.bytes_in);
+  TEST_ASSERT_EQUAL_UINT64(0, snapshot.requests[DB_OP_CREATE]);
+}
+
+void test_metrics_render(void) {
+  metrics_record_request(metrics, DB_OP_CREATE, false, 50);
+  metrics_record_request(metrics, DB_OP_CREATE, true, 250);
+  metrics_record_request(metrics, DB_OP_UNKNOWN, true, 10);
+  metrics_record_request(metrics, DB_OP_BULK_CREATE, false, 100);
+  metrics_add(&metrics_shard(metrics)->bulk_rows, 5000);
+  metrics_add(&metrics_shard(metrics)->bulk_batches, 1);
+
+  metrics_snapshot_t snapshot;
+  metrics_snapshot(metrics, &snapshot);
+  metrics_gauges_t gauges = {.pool_size = 4,
+                             .active_connections = 1,
+                             .pending_requests = 2,
+                             .stmt_cache_hits = 3,
+                             .stmt_cache_hit_ratio = 0.75,
+                             .stmt_prepare_saved_us = 1500};
+
+  strbuf_t out;
+  strbuf_init(&out);
+  TEST_ASSERT_EQUAL_INT(0, metrics_render(&snapshot, &gauges, &out));
+  const char *expected[] = {
+      "# TYPE dbmanager_requests_total counter\n",
+      "dbmanager_requests_total{operation=\"create\"} 2\n",
+      "dbmanager_requests_total{operation=\"unknown\"} 1\n",
+      "dbmanager_request_errors_total{operation=\"create\"} 1\n",
+      "# TYPE dbmanager_request_duration_seconds histogram\n",
+      // 直方图的桶是累积的
+      "dbmanager_request_duration_seconds_bucket{operation=\"create\",le=\"0.0001\"} 1\n",
+      "dbmanager_request_duration_seconds_bucket{operation=\"create\",le=\"0.0002\"} 1\n",
+      "dbmanager_request_duration_seconds_bucket{operation=\"create\",le=\"0.0004\"} 2\n",
+      "dbmanager_request_duration_seconds_bucket{operation=\"create\",le=\"+Inf\"} 2\n",
+      "dbmanager_request_duration_seconds_sum{operation=\"create\"} 0.000300\n",
+      "dbmanager_request_duration_seconds_count{operation=\"create\"} 2\n",
+      "dbmanager_requests_total{operation=\"bulk_create\"} 1\n",
+      "dbmanager_bulk_rows_total 5000\n",
+      "dbmanager_bulk_batches_total 1\n",
+      "dbmanager_bulk_batch_errors_total 0\n",
+      "dbmanager_pool_connections 4\n",
+      "dbmanager_pool_active_connections 1\n",
+      "dbmanager_pending_requests 2\n",
+      "dbmanager_shed_requests_total 0\n",
+      "dbmanager_stmt_cache_hits_total 3\n",
+      "dbmanager_stmt_cache_hit_ratio 0.750000\n",
+      "dbmanager_stmt_prepare_saved_seconds_total 0.001500\n",
+  };
+  for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i) {
+    TEST_ASSERT_NOT_NULL_MESSAGE(strstr(out.data, expected[i]), expected[i]);
+  }
+  strbuf_free(&out);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_metrics_latency_bucket);
+  RUN_TEST(test_metrics_concurrent_record);
+  RUN_TEST(test_metrics_render);
+
+  return UNITY_END();
+}
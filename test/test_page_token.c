@@ -0,0 +1,152 @@
+// clang-format off
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "src/page_token.h"
+#include "src/strbuf.h"
+// clang-format on
+
+static page_token_t token, decoded;
+static strbuf_t text;
+
+void setUp(void) {
+  strbuf_init(&text);
+}
+
+void tearDown(void) {
+  strbuf_free(&text);
+}
+
+static void add(const char *value, bool numeric) {
+  TEST_ASSERT_EQUAL_INT(0, page_token_add(&token, value, strlen(value), numeric));
+}
+
+static void assert_value(size_t index, const char *expected, bool numeric) {
+  size_t len = 0;
+  const char *value = page_token_value(&decoded, index, &len);
+  TEST_ASSERT_EQUAL_size_t(strlen(expected), len);
+  TEST_ASSERT_EQUAL_MEMORY(expected, value, len);
+  TEST_ASSERT_TRUE(decoded.numeric[index] == numeric);
+}
+
+void test_page_token_round_trip(void) {
+  uint32_t check = page_token_check("users", "age > 18");
+  page_token_init(&token, check);
+  add("42", true);
+  TEST_ASSERT_EQUAL_INT(0, page_token_encode(&token, &text));
+
+  // base64url，不补 '='，可以原样放进 URL 和响应头
+  TEST_ASSERT_EQUAL_size_t(strspn(text.data, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+                                             "0123456789-_"),
+                           text.len);
+  TEST_ASSERT_EQUAL_INT(0, page_token_decode(text.data, check, &decoded));
+  TEST_ASSERT_EQUAL_size_t(1, decoded.num_values);
+  assert_value(0, "42", true);
+}
+
+void test_page_token_composite(void) {
+  uint32_t check = page_token_check("db.orders", NULL);
+  page_token_init(&token, check);
+  add("-1.5e3", true);
+  add("O'Brien \\ x", false);
+  add("", false);
+  static const char binary[] = {'a', '\0', '\xff', '\n'};
+  TEST_ASSERT_EQUAL_INT(0, page_token_add(&token, binary, sizeof(binary), false));
+  TEST_ASSERT_EQUAL_INT(0, page_token_encode(&token, &text));
+
+  TEST_ASSERT_EQUAL_INT(0, page_token_decode(text.data, check, &decoded));
+  TEST_ASSERT_EQUAL_size_t(4, decoded.num_values);
+  assert_value(0, "-1.5e3", true);
+  assert_value(1, "O'Brien \\ x", false);
+  assert_value(2, "", false);
+  size_t len = 0;
+  const char *value = page_token_value(&decoded, 3, &len);
+  TEST_ASSERT_EQUAL_size_t(sizeof(binary), len);
+  TEST_ASSERT_EQUAL_MEMORY(binary, value, len);
+}
+
+void test_page_token_limits(void) {
+  page_token_init(&token, 0);
+  for (int i = 0; i < PAGE_TOKEN_MAX_VALUES; ++i) {
+    add("1", true);
+  }
+  TEST_ASSERT_EQUAL_INT(-1, page_token_add(&token, "1", 1, true));
+
+  static char big[PAGE_TOKEN_MAX_BYTES + 1];
+  page_token_init(&token, 0);
+  TEST_ASSERT_EQUAL_INT(-1, page_token_add(&token, big, sizeof(big), false));
+  TEST_ASSERT_EQUAL_INT(0, page_token_add(&token, big, PAGE_TOKEN_MAX_BYTES, false));
+  TEST_ASSERT_EQUAL_INT(0, page_token_encode(&token, &text));
+  TEST_ASSERT_EQUAL_INT(0, page_token_decode(text.data, 0, &decoded));
+  TEST_ASSERT_EQUAL_size_t(PAGE_TOKEN_MAX_BYTES, decoded.lengths[0]);
+}
+
+void test_page_token_check_mismatch(void) {
+  // 表名和条件的分界参与摘要
+  TEST_ASSERT_TRUE(page_token_check("ab", "c") != page_token_check("a", "bc"));
+  TEST_ASSERT_EQUAL_UINT32(page_token_check("t", NULL), page_token_check("t", ""));
+
+  uint32_t check = page_token_check("users", "age > 18");
+  page_token_init(&token, check);
+  add("42", true);
+  TEST_ASSERT_EQUAL_INT(0, page_token_encode(&token, &text));
+  TEST_ASSERT_EQUAL_INT(-1, page_token_decode(text.data, page_token_check("users", NULL),
+                                              &decoded));
+  TEST_ASSERT_EQUAL_INT(-1, page_token_decode(text.data, page_token_check("orders", "age > 18"),
+                                              &decoded));
+}
+
+void test_page_token_corrupted(void) {
+  uint32_t check = page_token_check("users", NULL);
+  page_token_init(&token, check);
+  add("alice", false);
+  TEST_ASSERT_EQUAL_INT(0, page_token_encode(&token, &text));
+
+  char copy[64];
+  snprintf(copy, sizeof(copy), "%s", text.data);
+  copy[text.len - 2] = '\0'; // 截断
+  TEST_ASSERT_EQUAL_INT(-1, page_token_decode(copy, check, &decoded));
+
+  snprintf(copy, sizeof(copy), "%sAAAA", text.data); // 多余数据
+  TEST_ASSERT_EQUAL_INT(-1, page_token_decode(copy, check, &decoded));
+
+  snprintf(copy, sizeof(copy), "%s", text.data);
+  copy[3] = '='; // 不在字母表中
+  TEST_ASSERT_EQUAL_INT(-1, page_token_decode(copy, check, &decoded));
+
+  TEST_ASSERT_EQUAL_INT(-1, page_token_decode("", check, &decoded));
+  TEST_ASSERT_EQUAL_INT(-1, page_token_decode("AgAAAAAA", 0, &decoded)); // 版本不对
+}
+
+void test_page_token_numeric_validated(void) {
+  // 数值列的值拼进语句时不加引号，解码时必须只含数字字符
+  uint32_t check = page_token_check("users", NULL);
+  static const char *const bad[] = {"1 OR 1=1", "", "1)", "0x1F"};
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+    page_token_init(&token, check);
+    TEST_ASSERT_EQUAL_INT(0, page_token_add(&token, bad[i], strlen(bad[i]), true));
+    strbuf_reset(&text);
+    TEST_ASSERT_EQUAL_INT(0, page_token_encode(&token, &text));
+    TEST_ASSERT_EQUAL_INT(-1, page_token_decode(text.data, check, &decoded));
+  }
+
+  // 同样的值作为字符串列是合法的
+  page_token_init(&token, check);
+  add("1 OR 1=1", false);
+  strbuf_reset(&text);
+  TEST_ASSERT_EQUAL_INT(0, page_token_encode(&token, &text));
+  TEST_ASSERT_EQUAL_INT(0, page_token_decode(text.data, check, &decoded));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_page_token_round_trip);
+  RUN_TEST(test_page_token_composite);
+  RUN_TEST(test_page_token_limits);
+  RUN_TEST(test_page_token_check_mismatch);
+  RUN_TEST(test_page_token_corrupted);
+  RUN_TEST(test_page_token_numeric_validated);
+
+  return UNITY_END();
+}
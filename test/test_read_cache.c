@@ -0,0 +1,166 @@
+// clang-format off
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "unity.h"
+#include "src/read_cache.h"
+// clang-format on
+
+static read_cache_t cache;
+static arena_t *arena;
+
+void setUp(void) {
+  read_cache_init(&cache);
+  arena = arena_create(4096);
+}
+
+void tearDown(void) {
+  read_cache_destroy(&cache);
+  arena_destroy(arena);
+}
+
+static const char *get(const char *table, const char *where, result_format_t format,
+                       uint64_t version) {
+  size_t len = 0;
+  return read_cache_get(&cache, table, where, format, version, arena, &len);
+}
+
+static void put(const char *table, const char *where, result_format_t format, uint64_t version,
+                const char *body) {
+  read_cache_put(&cache, table, where, format, version, body, strlen(body));
+}
+
+void test_read_cache_disabled(void) {
+  TEST_ASSERT_FALSE(read_cache_wanted(&cache, "users", "id = 1"));
+  put("users", "id = 1", RESULT_FORMAT_TEXT, 0, "row");
+  TEST_ASSERT_NULL(get("users", "id = 1", RESULT_FORMAT_TEXT, 0));
+
+  read_cache_stats_t stats;
+  read_cache_stats(&cache, &stats);
+  TEST_ASSERT_EQUAL_UINT64(0, stats.misses);
+}
+
+void test_read_cache_hit(void) {
+  TEST_ASSERT_EQUAL_INT(0, read_cache_enable(&cache, 1 << 20, 60000));
+  TEST_ASSERT_NULL(get("users", "id = 1", RESULT_FORMAT_TEXT, 3));
+  put("users", "id = 1", RESULT_FORMAT_TEXT, 3, "id | name\n1  | a\n");
+
+  size_t len = 0;
+  const char *body =
+      read_cache_get(&cache, "users", "id = 1", RESULT_FORMAT_TEXT, 3, arena, &len);
+  TEST_ASSERT_EQUAL_STRING("id | name\n1  | a\n", body);
+  TEST_ASSERT_EQUAL_size_t(strlen(body), len);
+
+  // 表名的写法和条件中的空白不影响键，引号内的空白和编码格式影响
+  TEST_ASSERT_NOT_NULL(get("`mydb`.`USERS`", "  id   =\t1 ", RESULT_FORMAT_TEXT, 3));
+  TEST_ASSERT_NULL(get("users", "id = 1", RESULT_FORMAT_JSON, 3));
+  put("users", "name = 'a  b'", RESULT_FORMAT_TEXT, 3, "x");
+  TEST_ASSERT_NOT_NULL(get("users", " name  =  'a  b'", RESULT_FORMAT_TEXT, 3));
+  TEST_ASSERT_NULL(get("users", "name = 'a b'", RESULT_FORMAT_TEXT, 3));
+
+  read_cache_stats_t stats;
+  read_cache_stats(&cache, &stats);
+  TEST_ASSERT_EQUAL_UINT64(3, stats.hits);
+  TEST_ASSERT_EQUAL_UINT64(3, stats.misses);
+  TEST_ASSERT_EQUAL_UINT64(2, stats.entries);
+}
+
+void test_read_cache_binary_body(void) {
+  TEST_ASSERT_EQUAL_INT(0, read_cache_enable(&cache, 1 << 20, 60000));
+  const char rowset[] = {'R', 'S', 0, 1, 0, 'x'};
+  read_cache_put(&cache, "users", NULL, RESULT_FORMAT_ROWSET, 0, rowset, sizeof(rowset));
+
+  size_t len = 0;
+  const char *body = read_cache_get(&cache, "users", NULL, RESULT_FORMAT_ROWSET, 0, arena, &len);
+  TEST_ASSERT_NOT_NULL(body);
+  TEST_ASSERT_EQUAL_size_t(sizeof(rowset), len);
+  TEST_ASSERT_EQUAL_MEMORY(rowset, body, sizeof(rowset));
+}
+
+void test_read_cache_version_invalidates(void) {
+  TEST_ASSERT_EQUAL_INT(0, read_cache_enable(&cache, 1 << 20, 60000));
+  put("users", "id = 1", RESULT_FORMAT_TEXT, 5, "old");
+  put("users", "id = 2", RESULT_FORMAT_TEXT, 5, "old");
+  put("orders", "id = 1", RESULT_FORMAT_TEXT, 9, "order");
+
+  // 写入 users 之后它的版本号变为 6，全部条目失效，其他表不受影响
+  TEST_ASSERT_NULL(get("users", "id = 1", RESULT_FORMAT_TEXT, 6));
+  TEST_ASSERT_NULL(get("users", "id = 2", RESULT_FORMAT_TEXT, 6));
+  TEST_ASSERT_EQUAL_STRING("order", get("orders", "id = 1", RESULT_FORMAT_TEXT, 9));
+
+  // 并发的未命中中，较早读到版本号的结果不能覆盖较新的结果
+  put("users", "id = 1", RESULT_FORMAT_TEXT, 6, "new");
+  put("users", "id = 1", RESULT_FORMAT_TEXT, 5, "old");
+  TEST_ASSERT_EQUAL_STRING("new", get("users", "id = 1", RESULT_FORMAT_TEXT, 6));
+
+  read_cache_stats_t stats;
+  read_cache_stats(&cache, &stats);
+  TEST_ASSERT_EQUAL_UINT64(2, stats.invalidations);
+  TEST_ASSERT_EQUAL_UINT64(2, stats.entries);
+}
+
+void test_read_cache_ttl(void) {
+  TEST_ASSERT_EQUAL_INT(0, read_cache_enable(&cache, 1 << 20, 60000));
+  TEST_ASSERT_EQUAL_INT(0, read_cache_parse_table_ttls(&cache, "sessions:20,audit_log:0"));
+  TEST_ASSERT_FALSE(read_cache_wanted(&cache, "AUDIT_LOG", NULL));
+  TEST_ASSERT_TRUE(read_cache_wanted(&cache, "sessions", NULL));
+  TEST_ASSERT_FALSE(read_cache_wanted(&cache, "sessions", "expires > NOW()"));
+
+  put("audit_log", NULL, RESULT_FORMAT_TEXT, 0, "never");
+  TEST_ASSERT_NULL(get("audit_log", NULL, RESULT_FORMAT_TEXT, 0));
+
+  put("sessions", NULL, RESULT_FORMAT_TEXT, 0, "short");
+  put("users", NULL, RESULT_FORMAT_TEXT, 0, "long");
+  TEST_ASSERT_NOT_NULL(get("sessions", NULL, RESULT_FORMAT_TEXT, 0));
+  usleep(30000);
+  TEST_ASSERT_NULL(get("sessions", NULL, RESULT_FORMAT_TEXT, 0));
+  TEST_ASSERT_NOT_NULL(get("users", NULL, RESULT_FORMAT_TEXT, 0));
+
+  TEST_ASSERT_EQUAL_INT(-1, read_cache_parse_table_ttls(&cache, "users"));
+  TEST_ASSERT_EQUAL_INT(-1, read_cache_parse_table_ttls(&cache, "users:10ms"));
+  TEST_ASSERT_EQUAL_INT(-1, read_cache_parse_table_ttls(&cache, ":10"));
+}
+
+void test_read_cache_eviction(void) {
+  // 每个分片 2KB，放得下几个 200 字节的条目
+  size_t budget = 2048 * READ_CACHE_SHARDS;
+  TEST_ASSERT_EQUAL_INT(0, read_cache_enable(&cache, budget, 60000));
+  char body[201];
+  memset(body, 'x', sizeof(body) - 1);
+  body[sizeof(body) - 1] = '\0';
+
+  put("users", "id = 0", RESULT_FORMAT_TEXT, 0, body);
+  char where[32];
+  for (int i = 1; i <= 1000; ++i) {
+    snprintf(where, sizeof(where), "id = %d", i);
+    put("users", where, RESULT_FORMAT_TEXT, 0, body);
+    // 经常访问的条目每次被 CLOCK 指针扫到时都有访问位，一直不会被淘汰
+    TEST_ASSERT_NOT_NULL(get("users", "id = 0", RESULT_FORMAT_TEXT, 0));
+  }
+
+  read_cache_stats_t stats;
+  read_cache_stats(&cache, &stats);
+  TEST_ASSERT_TRUE(stats.bytes <= budget);
+  TEST_ASSERT_TRUE(stats.evictions > 0);
+  TEST_ASSERT_EQUAL_UINT64(1001, stats.entries + stats.evictions);
+
+  // 超过单个条目上限的结果不缓存
+  char large[512];
+  memset(large, 'y', sizeof(large) - 1);
+  large[sizeof(large) - 1] = '\0';
+  put("users", "id < 100", RESULT_FORMAT_TEXT, 0, large);
+  TEST_ASSERT_NULL(get("users", "id < 100", RESULT_FORMAT_TEXT, 0));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_read_cache_disabled);
+  RUN_TEST(test_read_cache_hit);
+  RUN_TEST(test_read_cache_binary_body);
+  RUN_TEST(test_read_cache_version_invalidates);
+  RUN_TEST(test_read_cache_ttl);
+  RUN_TEST(test_read_cache_eviction);
+
+  return UNITY_END();
+}
@@ -0,0 +1,195 @@
+// clang-format off
+#include "unity.h"
+#include "src/json_escape.h"
+#include "src/result_encoder.h"
+#include "src/rowset.h"
+// clang-format on
+
+#define NUM_FIELDS 3
+
+static MYSQL_FIELD fields[NUM_FIELDS];
+static strbuf_t out;
+
+void setUp(void) {
+  memset(fields, 0, sizeof(fields));
+  fields[0].name = "id";
+  fields[0].type = MYSQL_TYPE_LONGLONG;
+  fields[1].name = "score";
+  fields[1].type = MYSQL_TYPE_DOUBLE;
+  fields[2].name = "name";
+  fields[2].type = MYSQL_TYPE_VAR_STRING;
+  strbuf_init(&out);
+}
+
+void tearDown(void) { strbuf_free(&out); }
+
+/**
+ * @brief 按指定格式编码两行数据，第二行含 NULL
+ */
+static void encode_rows(result_format_t format) {
+  char *row1[NUM_FIELDS] = {"-7", "0.5", "a\"b"};
+  unsigned long lengths1[NUM_FIELDS] = {2, 3, 3};
+  char *row2[NUM_FIELDS] = {"8", NULL, NULL};
+  unsigned long lengths2[NUM_FIELDS] = {1, 0, 0};
+
+  result_encoder_t encoder;
+  result_encoder_init(&encoder, format, fields, NUM_FIELDS);
+  TEST_ASSERT_EQUAL_INT(0, result_encoder_begin(&encoder, &out));
+  TEST_ASSERT_EQUAL_INT(0, result_encoder_row(&encoder, row1, lengths1, &out));
+  TEST_ASSERT_EQUAL_INT(0, result_encoder_row(&encoder, row2, lengths2, &out));
+  TEST_ASSERT_EQUAL_INT(0, result_encoder_end(&encoder, &out));
+}
+
+void test_json_escape_scan(void) {
+  // 超过 16 字节，覆盖 SIMD 路径和标量尾部
+  const char *plain = "abcdefghijklmnopqrstuvwxyz0123456789";
+  TEST_ASSERT_EQUAL_size_t(strlen(plain), json_escape_scan(plain, strlen(plain)));
+  TEST_ASSERT_EQUAL_size_t(20, json_escape_scan("abcdefghijklmnopqrst\"uvw", 24));
+  TEST_ASSERT_EQUAL_size_t(3, json_escape_scan("abc\\", 4));
+  TEST_ASSERT_EQUAL_size_t(17, json_escape_scan("abcdefghijklmnopq\x01", 18));
+  // UTF-8 多字节字符（>= 0x80）不需要转义
+  TEST_ASSERT_EQUAL_size_t(18, json_escape_scan("\xe4\xb8\xad\xe6\x96\x87\xe4\xb8\xad\xe6\x96\x87"
+                                                "\xe4\xb8\xad\xe6\x96\x87",
+                                                18));
+}
+
+void test_json_escape_append(void) {
+  const char input[] = "q\"b\\n\n\t\x1f end";
+  TEST_ASSERT_EQUAL_INT(0, json_escape_append(&out, input, sizeof(input) - 1));
+  TEST_ASSERT_EQUAL_STRING("q\\\"b\\\\n\\n\\t\\u001f end", out.data);
+}
+
+void test_result_encoder_text(void) {
+  encode_rows(RESULT_FORMAT_TEXT);
+  TEST_ASSERT_EQUAL_STRING("id             score          name           \n"
+                           "---------------------------------------------\n"
+                           "-7             0.5            a\"b            \n"
+                           "8              NULL           NULL           \n",
+                           out.data);
+}
+
+void test_result_encoder_json(void) {
+  encode_rows(RESULT_FORMAT_JSON);
+  TEST_ASSERT_EQUAL_STRING("{\"rows\":[{\"id\":-7,\"score\":0.5,\"name\":\"a\\\"b\"},"
+                           "{\"id\":8,\"score\":null,\"name\":null}],\"count\":2}\n",
+                           out.data);
+}
+
+void test_result_encoder_ndjson(void) {
+  encode_rows(RESULT_FORMAT_NDJSON);
+  TEST_ASSERT_EQUAL_STRING("{\"id\":-7,\"score\":0.5,\"name\":\"a\\\"b\"}\n"
+                           "{\"id\":8,\"score\":null,\"name\":null}\n",
+                           out.data);
+}
+
+void test_result_encoder_json_error(void) {
+  result_encoder_t encoder;
+  result_encoder_init(&encoder, RESULT_FORMAT_JSON, fields, NUM_FIELDS);
+  TEST_ASSERT_EQUAL_INT(0, result_encoder_begin(&encoder, &out));
+  TEST_ASSERT_EQUAL_INT(0, result_encoder_error(&encoder, "lost \"connection\"", &out));
+  TEST_ASSERT_EQUAL_STRING("{\"rows\":[],\"error\":\"lost \\\"connection\\\"\"}\n", out.data);
+}
+
+void test_result_encoder_ndjson_error(void) {
+  result_encoder_t encoder;
+  result_encoder_init(&encoder, RESULT_FORMAT_NDJSON, fields, NUM_FIELDS);
+  TEST_ASSERT_EQUAL_INT(0, result_encoder_error(&encoder, "lost connection", &out));
+  TEST_ASSERT_EQUAL_STRING("{\"$error\":\"lost connection\"}\n", out.data);
+}
+
+void test_result_encoder_json_binary(void) {
+  // VARBINARY 和 BLOB 的字节不是合法的 UTF-8，输出为 base64；BIT 不看字符集
+  fields[2].type = MYSQL_TYPE_BLOB;
+  fields[2].charsetnr = 63;
+  fields[1].type = MYSQL_TYPE_BIT;
+  char *row[NUM_FIELDS] = {"1", "\x05", "\xff\x00\xfe\x80"};
+  unsigned long lengths[NUM_FIELDS] = {1, 1, 4};
+
+  result_encoder_t encoder;
+  result_encoder_init(&encoder, RESULT_FORMAT_NDJSON, fields, NUM_FIELDS);
+  TEST_ASSERT_EQUAL_INT(0, result_encoder_row(&encoder, row, lengths, &out));
+  TEST_ASSERT_EQUAL_STRING("{\"id\":1,\"score\":\"BQ==\",\"name\":\"/wD+gA==\"}\n", out.data);
+
+  // 文本字符集的 BLOB（TEXT 列）照常转义
+  fields[2].charsetnr = 255;
+  strbuf_reset(&out);
+  char *text_row[NUM_FIELDS] = {"2", "\x01\x02\x03", "ab"};
+  unsigned long text_lengths[NUM_FIELDS] = {1, 3, 2};
+  TEST_ASSERT_EQUAL_INT(0, result_encoder_row(&encoder, text_row, text_lengths, &out));
+  TEST_ASSERT_EQUAL_STRING("{\"id\":2,\"score\":\"AQID\",\"name\":\"ab\"}\n", out.data);
+}
+
+void test_result_format_negotiate(void) {
+  TEST_ASSERT_EQUAL_INT(RESULT_FORMAT_TEXT, result_format_negotiate(NULL));
+  TEST_ASSERT_EQUAL_INT(RESULT_FORMAT_TEXT, result_format_negotiate("*/*"));
+  TEST_ASSERT_EQUAL_INT(RESULT_FORMAT_JSON, result_format_negotiate("Application/JSON"));
+  TEST_ASSERT_EQUAL_INT(RESULT_FORMAT_NDJSON,
+                        result_format_negotiate("application/json, application/x-ndjson"));
+  TEST_ASSERT_EQUAL_INT(RESULT_FORMAT_JSON, result_format_negotiate("application/json;q=0.9, "
+                                                                     "application/x-ndjson;q=0.5"));
+  // q=0 表示不接受，不能因为出现在头中就被选中
+  TEST_ASSERT_EQUAL_INT(RESULT_FORMAT_TEXT, result_format_negotiate("application/json;q=0"));
+  TEST_ASSERT_EQUAL_INT(RESULT_FORMAT_TEXT,
+                        result_format_negotiate("text/plain, application/json;q=0.5"));
+  // 媒体类型要完整匹配，不能是前缀
+  TEST_ASSERT_EQUAL_INT(RESULT_FORMAT_TEXT, result_format_negotiate("application/json-seq"));
+}
+
+void test_result_encoder_rowset_roundtrip(void) {
+  encode_rows(RESULT_FORMAT_ROWSET);
+
+  rowset_t *rowset = rowset_decode(out.data, out.len);
+  TEST_ASSERT_NOT_NULL(rowset);
+  TEST_ASSERT_EQUAL_INT(NUM_FIELDS, rowset->num_columns);
+  TEST_ASSERT_EQUAL_size_t(2, rowset->num_rows);
+  TEST_ASSERT_EQUAL_STRING("score", rowset->columns[1].name);
+  TEST_ASSERT_EQUAL_INT(ROWSET_TYPE_INT64, rowset->columns[0].type);
+  TEST_ASSERT_EQUAL_INT(ROWSET_TYPE_DOUBLE, rowset->columns[1].type);
+  TEST_ASSERT_EQUAL_INT(ROWSET_TYPE_BYTES, rowset->columns[2].type);
+
+  TEST_ASSERT_EQUAL_INT(-7, rowset_value(rowset, 0, 0)->i64);
+  TEST_ASSERT_EQUAL_DOUBLE(0.5, rowset_value(rowset, 0, 1)->f64);
+  TEST_ASSERT_EQUAL_size_t(3, rowset_value(rowset, 0, 2)->bytes.len);
+  TEST_ASSERT_EQUAL_MEMORY("a\"b", rowset_value(rowset, 0, 2)->bytes.ptr, 3);
+  TEST_ASSERT_FALSE(rowset_value(rowset, 1, 0)->is_null);
+  TEST_ASSERT_TRUE(rowset_value(rowset, 1, 1)->is_null);
+  TEST_ASSERT_TRUE(rowset_value(rowset, 1, 2)->is_null);
+  TEST_ASSERT_NULL(rowset_value(rowset, 2, 0));
+
+  // 文本渲染结果与服务端的文本格式一致
+  strbuf_t text;
+  strbuf_init(&text);
+  TEST_ASSERT_EQUAL_INT(0, rowset_to_text(rowset, &text));
+  rowset_free(rowset);
+  strbuf_reset(&out);
+  encode_rows(RESULT_FORMAT_TEXT);
+  TEST_ASSERT_EQUAL_STRING(out.data, text.data);
+  strbuf_free(&text);
+}
+
+void test_result_encoder_rowset_truncated(void) {
+  encode_rows(RESULT_FORMAT_ROWSET);
+
+  // 缺少结尾的数据流不能被当作完整结果
+  for (size_t len = 0; len < out.len; ++len) {
+    TEST_ASSERT_NULL(rowset_decode(out.data, len));
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_json_escape_scan);
+  RUN_TEST(test_json_escape_append);
+  RUN_TEST(test_result_encoder_text);
+  RUN_TEST(test_result_encoder_json);
+  RUN_TEST(test_result_encoder_ndjson);
+  RUN_TEST(test_result_encoder_json_error);
+  RUN_TEST(test_result_encoder_ndjson_error);
+  RUN_TEST(test_result_encoder_json_binary);
+  RUN_TEST(test_result_format_negotiate);
+  RUN_TEST(test_result_encoder_rowset_roundtrip);
+  RUN_TEST(test_result_encoder_rowset_truncated);
+
+  return UNITY_END();
+}
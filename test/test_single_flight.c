@@ -0,0 +1,173 @@
+// clang-format off
+#include <pthread.h>
+#include <string.h>
+#include "unity.h"
+#include "src/clock.h"
+#include "src/single_flight.h"
+// clang-format on
+
+#define NUM_WAITERS 8
+
+static single_flight_t flights;
+
+typedef struct {
+  single_flight_call_t *call;
+  uint64_t deadline_us;
+  arena_t *arena;
+  const char *body;
+  size_t len;
+} waiter_t;
+
+void setUp(void) { TEST_ASSERT_EQUAL_INT(0, single_flight_init(&flights, true)); }
+
+void tearDown(void) { single_flight_destroy(&flights); }
+
+static void *wait_thread(void *arg) {
+  waiter_t *waiter = arg;
+  waiter->body =
+      single_flight_wait(&flights, waiter->call, waiter->deadline_us, waiter->arena, &waiter->len);
+  return NULL;
+}
+
+static void start_waiters(waiter_t *waiters, pthread_t *threads, int n, uint64_t deadline_us) {
+  for (int i = 0; i < n; ++i) {
+    bool leader = true;
+    waiters[i].call =
+        single_flight_join(&flights, "users", "id = 1", RESULT_FORMAT_JSON, 7, &leader);
+    TEST_ASSERT_NOT_NULL(waiters[i].call);
+    TEST_ASSERT_FALSE(leader);
+    waiters[i].deadline_us = deadline_us;
+    waiters[i].arena = arena_create(1024);
+    pthread_create(&threads[i], NULL, wait_thread, &waiters[i]);
+  }
+}
+
+static void join_waiters(pthread_t *threads, int n) {
+  for (int i = 0; i < n; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+}
+
+static void free_waiters(waiter_t *waiters, int n) {
+  for (int i = 0; i < n; ++i) {
+    arena_destroy(waiters[i].arena);
+  }
+}
+
+void test_single_flight_shares_result(void) {
+  bool leader = false;
+  single_flight_call_t *call =
+      single_flight_join(&flights, "users", "id = 1", RESULT_FORMAT_JSON, 7, &leader);
+  TEST_ASSERT_NOT_NULL(call);
+  TEST_ASSERT_TRUE(leader);
+
+  waiter_t waiters[NUM_WAITERS] = {0};
+  pthread_t threads[NUM_WAITERS];
+  start_waiters(waiters, threads, NUM_WAITERS, 0);
+  TEST_ASSERT_EQUAL_INT(NUM_WAITERS, single_flight_waiters(&flights, call));
+
+  const char body[] = "{\"rows\":[{\"id\":1}],\"count\":1}";
+  single_flight_finish(&flights, call, body, sizeof(body) - 1);
+  join_waiters(threads, NUM_WAITERS);
+  for (int i = 0; i < NUM_WAITERS; ++i) {
+    TEST_ASSERT_EQUAL_STRING(body, waiters[i].body);
+    TEST_ASSERT_EQUAL_size_t(sizeof(body) - 1, waiters[i].len);
+  }
+  free_waiters(waiters, NUM_WAITERS);
+  TEST_ASSERT_EQUAL_UINT64(NUM_WAITERS, single_flight_coalesced(&flights));
+
+  // 结束之后到达的读取重新领头
+  call = single_flight_join(&flights, "users", "id = 1", RESULT_FORMAT_JSON, 7, &leader);
+  TEST_ASSERT_TRUE(leader);
+  single_flight_finish(&flights, call, NULL, 0);
+}
+
+void test_single_flight_key(void) {
+  bool leader = false;
+  single_flight_call_t *call =
+      single_flight_join(&flights, "users", "id = 1", RESULT_FORMAT_JSON, 7, &leader);
+  TEST_ASSERT_TRUE(leader);
+
+  // 写法不同的同一个读取合并
+  bool other_leader = true;
+  single_flight_call_t *same =
+      single_flight_join(&flights, "`USERS`", " id  =  1", RESULT_FORMAT_JSON, 7, &other_leader);
+  TEST_ASSERT_TRUE(same == call);
+  TEST_ASSERT_FALSE(other_leader);
+
+  // 表版本号、格式或条件不同的读取各自领头
+  single_flight_call_t *newer =
+      single_flight_join(&flights, "users", "id = 1", RESULT_FORMAT_JSON, 8, &other_leader);
+  TEST_ASSERT_TRUE(other_leader);
+  single_flight_call_t *text =
+      single_flight_join(&flights, "users", "id = 1", RESULT_FORMAT_TEXT, 7, &other_leader);
+  TEST_ASSERT_TRUE(other_leader);
+  single_flight_call_t *other =
+      single_flight_join(&flights, "users", "id = 2", RESULT_FORMAT_JSON, 7, &other_leader);
+  TEST_ASSERT_TRUE(other_leader);
+
+  // 结果随时间变化的读取不合并
+  TEST_ASSERT_NULL(
+      single_flight_join(&flights, "users", "at > NOW()", RESULT_FORMAT_JSON, 7, &other_leader));
+
+  single_flight_finish(&flights, newer, NULL, 0);
+  single_flight_finish(&flights, text, NULL, 0);
+  single_flight_finish(&flights, other, NULL, 0);
+  single_flight_finish(&flights, call, "x", 1);
+  arena_t *arena = arena_create(1024);
+  size_t len = 0;
+  TEST_ASSERT_EQUAL_STRING("x", single_flight_wait(&flights, same, 0, arena, &len));
+  arena_destroy(arena);
+}
+
+void test_single_flight_not_shared(void) {
+  bool leader = false;
+  single_flight_call_t *call =
+      single_flight_join(&flights, "users", "id = 1", RESULT_FORMAT_JSON, 7, &leader);
+  waiter_t waiters[2] = {0};
+  pthread_t threads[2];
+  start_waiters(waiters, threads, 2, 0);
+
+  // 领头出错或结果太大时等待者各自查询
+  single_flight_finish(&flights, call, NULL, 0);
+  join_waiters(threads, 2);
+  TEST_ASSERT_NULL(waiters[0].body);
+  TEST_ASSERT_NULL(waiters[1].body);
+  free_waiters(waiters, 2);
+  TEST_ASSERT_EQUAL_UINT64(0, single_flight_coalesced(&flights));
+}
+
+void test_single_flight_deadline(void) {
+  bool leader = false;
+  single_flight_call_t *call =
+      single_flight_join(&flights, "users", "id = 1", RESULT_FORMAT_JSON, 7, &leader);
+  waiter_t waiters[1] = {0};
+  pthread_t threads[1];
+  start_waiters(waiters, threads, 1, clock_now_us() + 20000);
+
+  // 等待者到截止时间放弃，领头稍后结束时不受影响
+  join_waiters(threads, 1);
+  TEST_ASSERT_NULL(waiters[0].body);
+  single_flight_finish(&flights, call, "late", 4);
+  free_waiters(waiters, 1);
+}
+
+void test_single_flight_disabled(void) {
+  single_flight_destroy(&flights);
+  TEST_ASSERT_EQUAL_INT(0, single_flight_init(&flights, false));
+  bool leader = false;
+  TEST_ASSERT_NULL(
+      single_flight_join(&flights, "users", "id = 1", RESULT_FORMAT_JSON, 7, &leader));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_single_flight_shares_result);
+  RUN_TEST(test_single_flight_key);
+  RUN_TEST(test_single_flight_not_shared);
+  RUN_TEST(test_single_flight_deadline);
+  RUN_TEST(test_single_flight_disabled);
+
+  return UNITY_END();
+}
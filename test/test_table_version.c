@@ -0,0 +1,100 @@
+// clang-format off
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "src/table_version.h"
+// clang-format on
+
+static table_versions_t versions;
+
+void setUp(void) { table_versions_init(&versions); }
+
+void tearDown(void) { table_versions_destroy(&versions); }
+
+void test_table_version_key(void) {
+  TEST_ASSERT_EQUAL_UINT64(0, table_version_get(&versions, "users"));
+  table_version_bump(&versions, "users");
+  // 反引号、库名前缀和大小写不同的写法是同一张表
+  TEST_ASSERT_EQUAL_UINT64(1, table_version_get(&versions, "users"));
+  TEST_ASSERT_EQUAL_UINT64(1, table_version_get(&versions, "`Users`"));
+  TEST_ASSERT_EQUAL_UINT64(1, table_version_get(&versions, "test.`users`"));
+  TEST_ASSERT_EQUAL_UINT64(0, table_version_get(&versions, "orders"));
+}
+
+void test_table_version_etag(void) {
+  char first[TABLE_VERSION_ETAG_LEN];
+  char second[TABLE_VERSION_ETAG_LEN];
+  TEST_ASSERT_EQUAL_INT(
+      0, table_version_etag(&versions, "users", "id=1", RESULT_FORMAT_JSON, first, sizeof(first)));
+  TEST_ASSERT_EQUAL_INT(0, strncmp(first, "W/\"", 3));
+
+  // 其他表的写入不影响 ETag
+  table_version_bump(&versions, "orders");
+  TEST_ASSERT_EQUAL_INT(0, table_version_etag(&versions, "users", "id=1", RESULT_FORMAT_JSON,
+                                              second, sizeof(second)));
+  TEST_ASSERT_EQUAL_STRING(first, second);
+
+  // 条件、格式不同是不同的查询
+  TEST_ASSERT_EQUAL_INT(0, table_version_etag(&versions, "users", NULL, RESULT_FORMAT_JSON,
+                                              second, sizeof(second)));
+  TEST_ASSERT_NOT_EQUAL(0, strcmp(first, second));
+  TEST_ASSERT_EQUAL_INT(0, table_version_etag(&versions, "users", "id=1", RESULT_FORMAT_TEXT,
+                                              second, sizeof(second)));
+  TEST_ASSERT_NOT_EQUAL(0, strcmp(first, second));
+
+  table_version_bump(&versions, "users");
+  TEST_ASSERT_EQUAL_INT(0, table_version_etag(&versions, "users", "id=1", RESULT_FORMAT_JSON,
+                                              second, sizeof(second)));
+  TEST_ASSERT_NOT_EQUAL(0, strcmp(first, second));
+}
+
+void test_table_version_cacheable(void) {
+  TEST_ASSERT_TRUE(table_version_cacheable("users", NULL));
+  TEST_ASSERT_TRUE(table_version_cacheable("test.`users`", "age > 18"));
+  TEST_ASSERT_FALSE(table_version_cacheable("", NULL));
+  TEST_ASSERT_FALSE(table_version_cacheable("users u JOIN orders o", NULL));
+  TEST_ASSERT_FALSE(table_version_cacheable("users", "id IN (SELECT id FROM orders)"));
+  TEST_ASSERT_FALSE(table_version_cacheable("users", "created_at > NOW() - INTERVAL 1 DAY"));
+  TEST_ASSERT_FALSE(table_version_cacheable("users", "id = FLOOR(RAND() * 10)"));
+
+  char etag[TABLE_VERSION_ETAG_LEN];
+  TEST_ASSERT_EQUAL_INT(-1, table_version_etag(&versions, "users", "ts < now()",
+                                               RESULT_FORMAT_TEXT, etag, sizeof(etag)));
+}
+
+void test_table_version_etag_match(void) {
+  const char *etag = "W/\"1-2-3\"";
+  TEST_ASSERT_TRUE(table_version_etag_match("W/\"1-2-3\"", etag));
+  TEST_ASSERT_TRUE(table_version_etag_match("\"1-2-3\"", etag));
+  TEST_ASSERT_TRUE(table_version_etag_match("\"a\", W/\"1-2-3\" ", etag));
+  TEST_ASSERT_TRUE(table_version_etag_match("*", etag));
+  TEST_ASSERT_FALSE(table_version_etag_match("W/\"1-2-4\"", etag));
+  TEST_ASSERT_FALSE(table_version_etag_match("\"1-2-3", etag));
+  TEST_ASSERT_FALSE(table_version_etag_match("", etag));
+  TEST_ASSERT_FALSE(table_version_etag_match(NULL, etag));
+}
+
+void test_table_version_overflow(void) {
+  char table[16];
+  for (int i = 0; i < TABLE_VERSION_SLOTS; ++i) {
+    snprintf(table, sizeof(table), "t%d", i);
+    table_version_bump(&versions, table);
+  }
+  // 槽位用完之后登记不了的表共用一个版本号，任何一张写入都让它们失效
+  uint64_t before = table_version_get(&versions, "extra_a");
+  table_version_bump(&versions, "extra_b");
+  TEST_ASSERT_EQUAL_UINT64(before + 1, table_version_get(&versions, "extra_a"));
+  TEST_ASSERT_EQUAL_UINT64(1, table_version_get(&versions, "t0"));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_table_version_key);
+  RUN_TEST(test_table_version_etag);
+  RUN_TEST(test_table_version_cacheable);
+  RUN_TEST(test_table_version_etag_match);
+  RUN_TEST(test_table_version_overflow);
+
+  return UNITY_END();
+}
@@ -0,0 +1,87 @@
+// clang-format off
+#include <string.h>
+#include "unity.h"
+#include "src/trace.h"
+// clang-format on
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_trace_id_valid(void) {
+  TEST_ASSERT_TRUE(trace_id_valid("abc-123_x.y"));
+  TEST_ASSERT_FALSE(trace_id_valid(NULL));
+  TEST_ASSERT_FALSE(trace_id_valid(""));
+  TEST_ASSERT_FALSE(trace_id_valid("has space"));
+  TEST_ASSERT_FALSE(trace_id_valid("line\nbreak"));
+
+  char id[TRACE_ID_MAX_LEN + 2];
+  memset(id, 'a', sizeof(id) - 1);
+  id[sizeof(id) - 1] = '\0';
+  TEST_ASSERT_FALSE(trace_id_valid(id));
+  id[TRACE_ID_MAX_LEN] = '\0';
+  TEST_ASSERT_TRUE(trace_id_valid(id));
+}
+
+void test_trace_init(void) {
+  // 合法的客户端 ID 原样沿用，否则生成 16 位十六进制 ID
+  trace_t trace;
+  trace_init(&trace, "client-id");
+  TEST_ASSERT_EQUAL_STRING("client-id", trace.id);
+
+  trace_t a, b;
+  trace_init(&a, "bad id");
+  trace_init(&b, NULL);
+  TEST_ASSERT_EQUAL_size_t(16, strlen(a.id));
+  TEST_ASSERT_EQUAL_size_t(strspn(a.id, "0123456789abcdef"), strlen(a.id));
+  TEST_ASSERT_TRUE(strcmp(a.id, b.id) != 0);
+  TEST_ASSERT_EQUAL_UINT64(0, a.phase_us[TRACE_PHASE_QUERY]);
+}
+
+void test_trace_server_timing_round_trip(void) {
+  trace_t trace;
+  trace_init(&trace, NULL);
+  for (int phase = 0; phase < TRACE_NUM_PHASES; ++phase) {
+    trace.phase_us[phase] = 1000 * (uint64_t)phase + 52;
+  }
+
+  char header[TRACE_SERVER_TIMING_MAX_LEN];
+  TEST_ASSERT_EQUAL_INT(0, trace_format_server_timing(&trace, header, sizeof(header)));
+  TEST_ASSERT_NOT_NULL(strstr(header, "parse;dur=0.052, queue;dur=1.052, conn_wait;dur=2.052"));
+  // 发送阶段在响应头生成之后才结束，不出现在 Server-Timing 中
+  TEST_ASSERT_NULL(strstr(header, "send"));
+
+  trace_t parsed;
+  TEST_ASSERT_EQUAL_INT(TRACE_PHASE_SEND, trace_parse_server_timing(header, &parsed));
+  for (int phase = 0; phase < TRACE_PHASE_SEND; ++phase) {
+    TEST_ASSERT_EQUAL_UINT64(trace.phase_us[phase], parsed.phase_us[phase]);
+  }
+  TEST_ASSERT_EQUAL_UINT64(0, parsed.phase_us[TRACE_PHASE_SEND]);
+
+  char small[32];
+  TEST_ASSERT_EQUAL_INT(-1, trace_format_server_timing(&trace, small, sizeof(small)));
+}
+
+void test_trace_parse_foreign_header(void) {
+  // 其他代理追加的指标和 dur 以外的参数被忽略
+  trace_t trace;
+  TEST_ASSERT_EQUAL_INT(
+      2, trace_parse_server_timing("cdn-cache;desc=HIT, query;desc=\"db\";dur=1.5,edge;dur=3,"
+                                   " parse ;dur=0.25",
+                                   &trace));
+  TEST_ASSERT_EQUAL_UINT64(1500, trace.phase_us[TRACE_PHASE_QUERY]);
+  TEST_ASSERT_EQUAL_UINT64(250, trace.phase_us[TRACE_PHASE_PARSE]);
+  TEST_ASSERT_EQUAL_INT(0, trace_parse_server_timing("", &trace));
+  TEST_ASSERT_EQUAL_INT(-1, trace_parse_server_timing(NULL, &trace));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_trace_id_valid);
+  RUN_TEST(test_trace_init);
+  RUN_TEST(test_trace_server_timing_round_trip);
+  RUN_TEST(test_trace_parse_foreign_header);
+
+  return UNITY_END();
+}
@@ -0,0 +1,158 @@
+// clang-format off
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "src/arena.h"
+#include "src/strbuf.h"
+#include "src/wire.h"
+// clang-format on
+
+static arena_t *arena = NULL;
+static strbuf_t buf;
+static wire_frame_t frame;
+static wire_request_t req;
+
+void setUp(void) {
+  arena = arena_create(4096);
+  strbuf_init(&buf);
+}
+
+void tearDown(void) {
+  strbuf_free(&buf);
+  arena_destroy(arena);
+  arena = NULL;
+}
+
+void test_wire_request_roundtrip(void) {
+  TEST_ASSERT_EQUAL_INT(0, wire_request_encode(&buf, 7, DB_OP_READ, RESULT_FORMAT_JSON, 1500,
+                                               "users", NULL, "id=1"));
+  TEST_ASSERT_EQUAL_INT(1, wire_frame_parse(buf.data, buf.len, &frame));
+  TEST_ASSERT_EQUAL_UINT32(7, frame.id);
+  TEST_ASSERT_EQUAL_size_t(buf.len, frame.frame_len);
+
+  TEST_ASSERT_EQUAL_INT(0, wire_request_decode(&frame, arena, &req));
+  TEST_ASSERT_EQUAL_INT(DB_OP_READ, req.op);
+  TEST_ASSERT_EQUAL_INT(RESULT_FORMAT_JSON, req.format);
+  TEST_ASSERT_EQUAL_UINT32(1500, req.deadline_ms);
+  TEST_ASSERT_EQUAL_STRING("users", req.table);
+  TEST_ASSERT_NULL(req.data);
+  TEST_ASSERT_EQUAL_STRING("id=1", req.where);
+}
+
+void test_wire_frame_partial(void) {
+  // 两个帧连续写入，逐字节到达时只有收齐才能解析
+  TEST_ASSERT_EQUAL_INT(0, wire_request_encode(&buf, 1, DB_OP_CREATE, RESULT_FORMAT_TEXT, 0,
+                                               "users", "name='a'", NULL));
+  size_t first_len = buf.len;
+  TEST_ASSERT_EQUAL_INT(0, wire_request_encode(&buf, 2, DB_OP_DELETE, RESULT_FORMAT_TEXT, 0,
+                                               "users", NULL, "id=2"));
+  for (size_t len = 0; len < first_len; ++len) {
+    TEST_ASSERT_EQUAL_INT(0, wire_frame_parse(buf.data, len, &frame));
+  }
+  TEST_ASSERT_EQUAL_INT(1, wire_frame_parse(buf.data, first_len, &frame));
+  TEST_ASSERT_EQUAL_UINT32(1, frame.id);
+
+  TEST_ASSERT_EQUAL_INT(1, wire_frame_parse(buf.data + first_len, buf.len - first_len, &frame));
+  TEST_ASSERT_EQUAL_UINT32(2, frame.id);
+  TEST_ASSERT_EQUAL_INT(0, wire_request_decode(&frame, arena, &req));
+  TEST_ASSERT_EQUAL_INT(DB_OP_DELETE, req.op);
+  TEST_ASSERT_EQUAL_STRING("id=2", req.where);
+}
+
+void test_wire_frame_oversize(void) {
+  // 负载长度 WIRE_MAX_PAYLOAD + 1，不必等数据收齐就能判定
+  const unsigned char header[WIRE_HEADER_LEN] = {0x01, 0x00, 0x00, 0x04, 0, 0, 0, 0, 1};
+  TEST_ASSERT_EQUAL_INT(-1, wire_frame_parse((const char *)header, sizeof(header), &frame));
+}
+
+void test_wire_batch(void) {
+  size_t start;
+  TEST_ASSERT_EQUAL_INT(0, wire_batch_begin(&buf, 3, 2, true, 0, &start));
+  TEST_ASSERT_EQUAL_INT(0, wire_batch_item_encode(&buf, DB_OP_CREATE, "users", "name='a'", NULL));
+  TEST_ASSERT_EQUAL_INT(0, wire_batch_item_encode(&buf, 42, "users", NULL, NULL));
+  wire_frame_end(&buf, start);
+
+  TEST_ASSERT_EQUAL_INT(1, wire_frame_parse(buf.data, buf.len, &frame));
+  TEST_ASSERT_EQUAL_INT(0, wire_request_decode(&frame, arena, &req));
+  TEST_ASSERT_EQUAL_INT(DB_OP_BATCH, req.op);
+  TEST_ASSERT_TRUE(req.batch.transaction);
+  TEST_ASSERT_FALSE(req.batch_overflow);
+  TEST_ASSERT_EQUAL_size_t(2, req.batch.num_items);
+  TEST_ASSERT_EQUAL_STRING("create", req.batch.items[0].operation);
+  TEST_ASSERT_EQUAL_STRING("name='a'", req.batch.items[0].data);
+  // 未知的操作留给执行时报错
+  TEST_ASSERT_EQUAL_STRING("unknown", req.batch.items[1].operation);
+}
+
+void test_wire_batch_overflow(void) {
+  size_t start;
+  TEST_ASSERT_EQUAL_INT(0, wire_batch_begin(&buf, 4, BATCH_MAX_ITEMS + 1, false, 0, &start));
+  wire_frame_end(&buf, start);
+
+  TEST_ASSERT_EQUAL_INT(1, wire_frame_parse(buf.data, buf.len, &frame));
+  TEST_ASSERT_EQUAL_INT(0, wire_request_decode(&frame, arena, &req));
+  TEST_ASSERT_TRUE(req.batch_overflow);
+  TEST_ASSERT_EQUAL_size_t(0, req.batch.num_items);
+}
+
+void test_wire_request_malformed(void) {
+  // 截断的字符串
+  TEST_ASSERT_EQUAL_INT(0, wire_request_encode(&buf, 5, DB_OP_READ, RESULT_FORMAT_TEXT, 0,
+                                               "users", NULL, NULL));
+  TEST_ASSERT_EQUAL_INT(1, wire_frame_parse(buf.data, buf.len, &frame));
+  frame.payload_len -= 2;
+  TEST_ASSERT_EQUAL_INT(-1, wire_request_decode(&frame, arena, &req));
+
+  // 多余的字节
+  TEST_ASSERT_EQUAL_INT(0, strbuf_append_char(&buf, 'x'));
+  ((unsigned char *)buf.data)[0] += 1;
+  TEST_ASSERT_EQUAL_INT(1, wire_frame_parse(buf.data, buf.len, &frame));
+  TEST_ASSERT_EQUAL_INT(-1, wire_request_decode(&frame, arena, &req));
+
+  // 未知的结果集格式
+  strbuf_reset(&buf);
+  TEST_ASSERT_EQUAL_INT(0, wire_request_encode(&buf, 6, DB_OP_READ, RESULT_FORMAT_NDJSON + 1, 0,
+                                               "users", NULL, NULL));
+  TEST_ASSERT_EQUAL_INT(1, wire_frame_parse(buf.data, buf.len, &frame));
+  TEST_ASSERT_EQUAL_INT(-1, wire_request_decode(&frame, arena, &req));
+
+  // 响应帧不能当作请求
+  strbuf_reset(&buf);
+  size_t start;
+  TEST_ASSERT_EQUAL_INT(0, wire_response_begin(&buf, 8, WIRE_STATUS_OK, RESULT_FORMAT_TEXT,
+                                               &start));
+  wire_frame_end(&buf, start);
+  TEST_ASSERT_EQUAL_INT(1, wire_frame_parse(buf.data, buf.len, &frame));
+  TEST_ASSERT_EQUAL_INT(-1, wire_request_decode(&frame, arena, &req));
+}
+
+void test_wire_response_roundtrip(void) {
+  size_t start;
+  TEST_ASSERT_EQUAL_INT(0, wire_response_begin(&buf, 9, WIRE_STATUS_GATEWAY_TIMEOUT,
+                                               RESULT_FORMAT_ROWSET, &start));
+  TEST_ASSERT_EQUAL_INT(0, strbuf_append(&buf, "a\0b", 3));
+  wire_frame_end(&buf, start);
+
+  wire_response_t resp;
+  TEST_ASSERT_EQUAL_INT(1, wire_frame_parse(buf.data, buf.len, &frame));
+  TEST_ASSERT_EQUAL_UINT32(9, frame.id);
+  TEST_ASSERT_EQUAL_INT(0, wire_response_decode(&frame, &resp));
+  TEST_ASSERT_EQUAL_UINT(WIRE_STATUS_GATEWAY_TIMEOUT, resp.status);
+  TEST_ASSERT_EQUAL_INT(RESULT_FORMAT_ROWSET, resp.format);
+  TEST_ASSERT_EQUAL_size_t(3, resp.body_len);
+  TEST_ASSERT_EQUAL_MEMORY("a\0b", resp.body, 3);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_wire_request_roundtrip);
+  RUN_TEST(test_wire_frame_partial);
+  RUN_TEST(test_wire_frame_oversize);
+  RUN_TEST(test_wire_batch);
+  RUN_TEST(test_wire_batch_overflow);
+  RUN_TEST(test_wire_request_malformed);
+  RUN_TEST(test_wire_response_roundtrip);
+
+  return UNITY_END();
+}